@@ -1,4 +1,5 @@
 MOTO_GUI = 'moto-gui'
+MOTO_BENCH = 'moto-bench'
 
 CC  = 'gcc'
 CXX = 'g++'
@@ -10,6 +11,7 @@ LIBS   = ['gomp', 'GL', 'GLU', 'GLEW']
 CPPFLAGS = ['-DMOTO_WITH_WOBJ_MESH_LOADER',
             # '-DMOTO_MBM_MESH_LOADER',
             # '-DMOTO_RIB_MESH_LOADER',
+            # '-DMOTO_WITH_OSMESA', # Headless rendering, add 'OSMesa' to LIBS.
             ]
 
 
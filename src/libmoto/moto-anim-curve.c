@@ -0,0 +1,296 @@
+#include <math.h>
+#include <string.h>
+
+#include "libmotoutil/numdef.h"
+
+#include "moto-anim-curve.h"
+
+#define NEWTON_ITERATIONS 4
+#define BISECTION_ITERATIONS 16
+
+/* bezier */
+
+static inline gfloat bezier(gfloat p0, gfloat p1, gfloat p2, gfloat p3, gfloat u)
+{
+    gfloat v = 1 - u;
+    return v*v*v*p0 + 3*v*v*u*p1 + 3*v*u*u*p2 + u*u*u*p3;
+}
+
+static inline gfloat bezier_derivative(gfloat p0, gfloat p1, gfloat p2, gfloat p3, gfloat u)
+{
+    gfloat v = 1 - u;
+    return 3*(v*v*(p1 - p0) + 2*v*u*(p2 - p1) + u*u*(p3 - p2));
+}
+
+gfloat moto_anim_bezier_eval(gfloat x0, gfloat y0, gfloat x1, gfloat y1,
+        gfloat x2, gfloat y2, gfloat x3, gfloat y3, gfloat x)
+{
+    gfloat width = x3 - x0;
+    if(width < MICRO)
+        return y0;
+
+    /* Solving x(u) = x with a few Newton steps starting from linear guess. */
+    gfloat u = (x - x0)/width;
+    gint i;
+    for(i = 0; i < NEWTON_ITERATIONS; i++)
+    {
+        gfloat dx = bezier(x0, x1, x2, x3, u) - x;
+        if(fabs(dx) < MICRO)
+            return bezier(y0, y1, y2, y3, u);
+
+        gfloat d = bezier_derivative(x0, x1, x2, x3, u);
+        if(fabs(d) < MICRO)
+            break;
+        u -= dx/d;
+    }
+
+    u = (u < 0) ? 0 : ((u > 1) ? 1 : u);
+    if(fabs(bezier(x0, x1, x2, x3, u) - x) >= MICRO)
+    {
+        /* Newton didn't converge (flat handles). Bisection is always safe
+         * because x(u) is monotonic. */
+        gfloat lo = 0, hi = 1;
+        for(i = 0; i < BISECTION_ITERATIONS; i++)
+        {
+            u = (lo + hi)/2;
+            if(bezier(x0, x1, x2, x3, u) < x)
+                lo = u;
+            else
+                hi = u;
+        }
+    }
+
+    return bezier(y0, y1, y2, y3, u);
+}
+
+/* class MotoAnimCurve */
+
+MotoAnimCurve *moto_anim_curve_new(void)
+{
+    MotoAnimCurve *self = g_slice_new(MotoAnimCurve);
+
+    self->times     = NULL;
+    self->keys      = NULL;
+    self->keys_num  = 0;
+    self->keys_size = 0;
+    self->cursor    = 0;
+
+    return self;
+}
+
+void moto_anim_curve_free(MotoAnimCurve *self)
+{
+    g_free(self->times);
+    g_free(self->keys);
+    g_slice_free(MotoAnimCurve, self);
+}
+
+MotoAnimCurve *moto_anim_curve_new_copy(MotoAnimCurve *self)
+{
+    MotoAnimCurve *copy = moto_anim_curve_new();
+
+    copy->keys_num  = self->keys_num;
+    copy->keys_size = self->keys_num;
+    copy->times = g_memdup(self->times, sizeof(gfloat)*self->keys_num);
+    copy->keys  = g_memdup(self->keys, sizeof(MotoAnimKey)*self->keys_num);
+
+    return copy;
+}
+
+guint moto_anim_curve_get_keys_num(MotoAnimCurve *self)
+{
+    return self->keys_num;
+}
+
+static void reserve(MotoAnimCurve *self, guint size)
+{
+    if(size <= self->keys_size)
+        return;
+
+    self->keys_size = max(size, self->keys_size*2);
+    self->times = g_renew(gfloat, self->times, self->keys_size);
+    self->keys  = g_renew(MotoAnimKey, self->keys, self->keys_size);
+}
+
+guint moto_anim_curve_set_key(MotoAnimCurve *self, gfloat time, gfloat value, MotoKeyInterp interp)
+{
+    /* First key with time greater or equal. */
+    guint lo = 0, hi = self->keys_num;
+    while(lo < hi)
+    {
+        guint mid = (lo + hi)/2;
+        if(self->times[mid] < time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    MotoAnimKey *key;
+    if(lo < self->keys_num && fabs(self->times[lo] - time) < MICRO)
+    {
+        key = self->keys + lo;
+    }
+    else
+    {
+        reserve(self, self->keys_num + 1);
+
+        guint tail = self->keys_num - lo;
+        memmove(self->times + lo + 1, self->times + lo, sizeof(gfloat)*tail);
+        memmove(self->keys + lo + 1, self->keys + lo, sizeof(MotoAnimKey)*tail);
+        self->keys_num++;
+
+        key = self->keys + lo;
+        key->in_dx  = key->in_dy  = 0;
+        key->out_dx = key->out_dy = 0;
+    }
+
+    self->times[lo] = time;
+    key->value  = value;
+    key->interp = interp;
+
+    return lo;
+}
+
+void moto_anim_curve_set_key_handles(MotoAnimCurve *self, guint index,
+        gfloat in_dx, gfloat in_dy, gfloat out_dx, gfloat out_dy)
+{
+    g_return_if_fail(index < self->keys_num);
+
+    MotoAnimKey *key = self->keys + index;
+    key->in_dx  = min(in_dx, 0);
+    key->in_dy  = in_dy;
+    key->out_dx = max(out_dx, 0);
+    key->out_dy = out_dy;
+}
+
+void moto_anim_curve_delete_key(MotoAnimCurve *self, guint index)
+{
+    g_return_if_fail(index < self->keys_num);
+
+    guint tail = self->keys_num - index - 1;
+    memmove(self->times + index, self->times + index + 1, sizeof(gfloat)*tail);
+    memmove(self->keys + index, self->keys + index + 1, sizeof(MotoAnimKey)*tail);
+    self->keys_num--;
+
+    self->cursor = 0;
+}
+
+void moto_anim_curve_clear(MotoAnimCurve *self)
+{
+    self->keys_num = 0;
+    self->cursor = 0;
+}
+
+gfloat moto_anim_curve_get_key_time(MotoAnimCurve *self, guint index)
+{
+    g_return_val_if_fail(index < self->keys_num, 0);
+    return self->times[index];
+}
+
+MotoAnimKey *moto_anim_curve_get_key(MotoAnimCurve *self, guint index)
+{
+    g_return_val_if_fail(index < self->keys_num, NULL);
+    return self->keys + index;
+}
+
+void moto_anim_curve_shift_keys(MotoAnimCurve *self, guint index, gfloat offset)
+{
+    guint i;
+    for(i = index; i < self->keys_num; i++)
+        self->times[i] += offset;
+}
+
+gint moto_anim_curve_find_segment(MotoAnimCurve *self, gfloat time)
+{
+    guint num = self->keys_num;
+    if( ! num || time < self->times[0])
+        return -1;
+
+    const gfloat *times = self->times;
+
+    /* Sequential playback: the same or the next segment. */
+    guint c = self->cursor;
+    if(c < num && times[c] <= time)
+    {
+        if(c + 1 >= num || time < times[c + 1])
+            return c;
+        if(c + 2 >= num || time < times[c + 2])
+            return self->cursor = c + 1;
+    }
+
+    /* Last key with time less or equal. */
+    guint lo = 0, hi = num;
+    while(hi - lo > 1)
+    {
+        guint mid = (lo + hi)/2;
+        if(times[mid] <= time)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return self->cursor = lo;
+}
+
+static gfloat eval_segment(MotoAnimCurve *self, guint i, gfloat time)
+{
+    const MotoAnimKey *k0 = self->keys + i;
+    const MotoAnimKey *k1 = k0 + 1;
+    gfloat t0 = self->times[i];
+    gfloat t1 = self->times[i + 1];
+    gfloat width = t1 - t0;
+
+    switch(k0->interp)
+    {
+        case MOTO_KEY_INTERP_CONSTANT:
+            return k0->value;
+        case MOTO_KEY_INTERP_LINEAR:
+            return k0->value + (k1->value - k0->value)*(time - t0)/width;
+        case MOTO_KEY_INTERP_BEZIER:
+        {
+            gfloat third = width/3;
+            gfloat ox = (0 == k0->out_dx) ? third : min(k0->out_dx, width);
+            gfloat oy = (0 == k0->out_dx) ? 0 : k0->out_dy;
+            gfloat ix = (0 == k1->in_dx) ? -third : max(k1->in_dx, -width);
+            gfloat iy = (0 == k1->in_dx) ? 0 : k1->in_dy;
+
+            return moto_anim_bezier_eval(t0, k0->value, t0 + ox, k0->value + oy,
+                                         t1 + ix, k1->value + iy, t1, k1->value, time);
+        }
+        case MOTO_KEY_INTERP_HERMITE:
+        {
+            /* Tangents are slopes of handles. */
+            gfloat m0 = (0 == k0->out_dx) ? 0 : k0->out_dy/k0->out_dx;
+            gfloat m1 = (0 == k1->in_dx) ? 0 : k1->in_dy/k1->in_dx;
+            gfloat u  = (time - t0)/width;
+            gfloat u2 = u*u;
+            gfloat u3 = u2*u;
+
+            return (2*u3 - 3*u2 + 1)*k0->value + (u3 - 2*u2 + u)*width*m0 + \
+                   (-2*u3 + 3*u2)*k1->value + (u3 - u2)*width*m1;
+        }
+    }
+
+    return k0->value;
+}
+
+gfloat moto_anim_curve_eval(MotoAnimCurve *self, gfloat time)
+{
+    if( ! self->keys_num)
+        return 0;
+
+    gint i = moto_anim_curve_find_segment(self, time);
+    if(i < 0)
+        return self->keys[0].value;
+    if((guint)i + 1 >= self->keys_num)
+        return self->keys[self->keys_num - 1].value;
+
+    return eval_segment(self, i, time);
+}
+
+void moto_anim_curve_eval_array(MotoAnimCurve **curves, guint num, gfloat time, gfloat *values)
+{
+    guint i;
+    for(i = 0; i < num; i++)
+        values[i] = moto_anim_curve_eval(curves[i], time);
+}
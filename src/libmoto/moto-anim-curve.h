@@ -0,0 +1,93 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_ANIM_CURVE_H__
+#define __MOTO_ANIM_CURVE_H__
+
+#include <glib.h>
+
+#include "moto-enums.h"
+
+G_BEGIN_DECLS
+
+typedef struct _MotoAnimKey MotoAnimKey;
+typedef struct _MotoAnimCurve MotoAnimCurve;
+
+/* Handles are relative to key. Zero dx of handle means automatic one
+ * (flat tangent at one third of segment). */
+struct _MotoAnimKey
+{
+    gfloat value;
+    gfloat in_dx, in_dy;
+    gfloat out_dx, out_dy;
+    MotoKeyInterp interp; /* Interpolation of segment starting at this key. */
+};
+
+/* Keys are kept sorted by time in contiguous arrays. Times are separated
+ * from other data of keys to make segment lookup cache friendly. */
+struct _MotoAnimCurve
+{
+    gfloat *times;
+    MotoAnimKey *keys;
+    guint keys_num;
+    guint keys_size;
+
+    /* Segment found by last lookup. Sequential playback doesn't need binary search.
+     * Not thread-safe: the same curve must not be evaluated from several threads. */
+    guint cursor;
+};
+
+MotoAnimCurve *moto_anim_curve_new(void);
+void moto_anim_curve_free(MotoAnimCurve *self);
+
+MotoAnimCurve *moto_anim_curve_new_copy(MotoAnimCurve *self);
+
+guint moto_anim_curve_get_keys_num(MotoAnimCurve *self);
+
+/* Returns index of key. Key with the same time is replaced. */
+guint moto_anim_curve_set_key(MotoAnimCurve *self, gfloat time, gfloat value, MotoKeyInterp interp);
+void moto_anim_curve_set_key_handles(MotoAnimCurve *self, guint index,
+        gfloat in_dx, gfloat in_dy, gfloat out_dx, gfloat out_dy);
+void moto_anim_curve_delete_key(MotoAnimCurve *self, guint index);
+void moto_anim_curve_clear(MotoAnimCurve *self);
+
+gfloat moto_anim_curve_get_key_time(MotoAnimCurve *self, guint index);
+MotoAnimKey *moto_anim_curve_get_key(MotoAnimCurve *self, guint index);
+
+/* Shifts times of keys starting from index. Order of keys must stay the same. */
+void moto_anim_curve_shift_keys(MotoAnimCurve *self, guint index, gfloat offset);
+
+/* Returns index of key starting segment which contains time or -1 if time is before first key. */
+gint moto_anim_curve_find_segment(MotoAnimCurve *self, gfloat time);
+
+gfloat moto_anim_curve_eval(MotoAnimCurve *self, gfloat time);
+
+/* Evaluates all curves for the same time. */
+void moto_anim_curve_eval_array(MotoAnimCurve **curves, guint num, gfloat time, gfloat *values);
+
+/* Value of cubic bezier (x0, y0)-(x1, y1)-(x2, y2)-(x3, y3) at x.
+ * x must be monotonic along curve: x0 <= x1, x2 <= x3. */
+gfloat moto_anim_bezier_eval(gfloat x0, gfloat y0, gfloat x1, gfloat y1,
+        gfloat x2, gfloat y2, gfloat x3, gfloat y3, gfloat x);
+
+G_END_DECLS
+
+#endif /* __MOTO_ANIM_CURVE_H__ */
@@ -1,7 +1,12 @@
 #include "libmotoutil/moto-gl.h"
+#include "libmotoutil/numdef.h"
 
 #include "moto-anim-node.h"
 
+/* forwards */
+
+static void moto_anim_node_update(MotoNode *self);
+
 /* class AnimNode */
 
 typedef struct _MotoAnimNodePriv MotoAnimNodePriv;
@@ -13,15 +18,20 @@ static GObjectClass *anim_node_parent_class = NULL;
 struct _MotoAnimNodePriv
 {
     gboolean prepared;
+
+    /* Animators are segments between keys. */
+    MotoAnimCurve *curve;
 };
 
-/*
 static void
 moto_anim_node_finalize(GObject *obj)
 {
+    MotoAnimNodePriv *priv = MOTO_ANIM_NODE_GET_PRIVATE(obj);
+
+    moto_anim_curve_free(priv->curve);
+
     anim_node_parent_class->finalize(obj);
 }
-*/
 
 static void
 moto_anim_node_init(MotoAnimNode *self)
@@ -31,27 +41,107 @@ moto_anim_node_init(MotoAnimNode *self)
 
     moto_node_add_params(node,
             "time", "Time", G_TYPE_FLOAT, MOTO_PARAM_MODE_INOUT, 0.0f, NULL, "Time",
+            "value", "Value", G_TYPE_FLOAT, MOTO_PARAM_MODE_OUT, 0.0f, NULL, "Value",
             NULL);
 
     priv->prepared = FALSE;
+    priv->curve = moto_anim_curve_new();
 }
 
 static void
 moto_anim_node_class_init(MotoAnimNodeClass *klass)
 {
     GObjectClass *goclass = (GObjectClass *)klass;
+    MotoNodeClass *nclass = (MotoNodeClass *)klass;
 
     anim_node_parent_class = (GObjectClass *)(g_type_class_peek_parent(klass));
 
-    // goclass->finalize = moto_anim_node_finalize;
+    goclass->finalize = moto_anim_node_finalize;
+
+    nclass->update = moto_anim_node_update;
 
     g_type_class_add_private(klass, sizeof(MotoAnimNodePriv));
 }
 
-G_DEFINE_ABSTRACT_TYPE(MotoAnimNode, moto_anim_node, MOTO_TYPE_NODE);
+G_DEFINE_TYPE(MotoAnimNode, moto_anim_node, MOTO_TYPE_NODE);
+
+/* Methods of class AnimNode */
+
+MotoAnimNode *moto_anim_node_new(const gchar *name)
+{
+    MotoAnimNode *self = (MotoAnimNode *)g_object_new(MOTO_TYPE_ANIM_NODE, NULL);
+    MotoNode *node = (MotoNode *)self;
+
+    moto_node_set_name(node, name);
+
+    return self;
+}
+
+MotoAnimCurve *moto_anim_node_get_curve(MotoAnimNode *self)
+{
+    return MOTO_ANIM_NODE_GET_PRIVATE(self)->curve;
+}
+
+void moto_anim_node_set_value(MotoAnimNode *self, gfloat value)
+{
+    MotoNode *node = (MotoNode *)self;
+
+    moto_node_set_updating(node, TRUE);
+    moto_node_set_param_float(node, "value", value);
+    moto_node_set_updating(node, FALSE);
+    moto_node_mark_as_updated(node);
+}
+
+static void moto_anim_node_update(MotoNode *self)
+{
+    MotoAnimNodePriv *priv = MOTO_ANIM_NODE_GET_PRIVATE(self);
+
+    gfloat time;
+    moto_node_get_param_float(self, "time", & time);
+
+    moto_node_set_param_float(self, "value", moto_anim_curve_eval(priv->curve, time));
+}
+
+guint moto_anim_node_get_animators_num(MotoAnimNode *self)
+{
+    guint keys_num = moto_anim_curve_get_keys_num(MOTO_ANIM_NODE_GET_PRIVATE(self)->curve);
+    return (keys_num > 1) ? keys_num - 1 : 0;
+}
 
 gint moto_anim_node_insert_animator(MotoAnimNode *self, gint index, gfloat width)
-{}
+{
+    MotoAnimNodePriv *priv = MOTO_ANIM_NODE_GET_PRIVATE(self);
+    MotoAnimCurve *curve = priv->curve;
+
+    if(width < MICRO)
+        return -1;
+
+    guint num = moto_anim_node_get_animators_num(self);
+    if(index < 0 || index > num)
+        index = num;
+
+    if( ! num)
+    {
+        moto_anim_curve_clear(curve);
+        moto_anim_curve_set_key(curve, 0, 0, MOTO_KEY_INTERP_BEZIER);
+        moto_anim_curve_set_key(curve, width, 0, MOTO_KEY_INTERP_BEZIER);
+        return 0;
+    }
+
+    /* New animator starts where the old one with the same index started.
+     * Following keys are moved by width so animation before index doesn't change. */
+    gfloat start = moto_anim_curve_get_key_time(curve, index);
+    MotoAnimKey *key = moto_anim_curve_get_key(curve, index);
+    gfloat value = key->value;
+    MotoKeyInterp interp = key->interp;
+
+    moto_anim_curve_shift_keys(curve, index, width);
+    moto_anim_curve_set_key(curve, start, value, interp);
+
+    /* Keys changed so output must be recalculated. */
+    moto_anim_node_update((MotoNode *)self);
+    return index;
+}
 
 gint moto_anim_node_append_animator(MotoAnimNode *self, gfloat width)
 {
@@ -64,4 +154,26 @@ gint moto_anim_node_prepend_animator(MotoAnimNode *self, gfloat width)
 }
 
 void moto_anim_node_delete_animator(MotoAnimNode *self, guint index)
-{}
+{
+    MotoAnimNodePriv *priv = MOTO_ANIM_NODE_GET_PRIVATE(self);
+    MotoAnimCurve *curve = priv->curve;
+
+    guint num = moto_anim_node_get_animators_num(self);
+    if(index >= num)
+        return;
+
+    if(1 == num)
+    {
+        moto_anim_curve_clear(curve);
+    }
+    else
+    {
+        gfloat width = moto_anim_curve_get_key_time(curve, index + 1) - \
+                       moto_anim_curve_get_key_time(curve, index);
+
+        moto_anim_curve_delete_key(curve, index + 1);
+        moto_anim_curve_shift_keys(curve, index + 1, -width);
+    }
+
+    moto_anim_node_update((MotoNode *)self);
+}
@@ -24,6 +24,7 @@
 
 #include "moto-node.h"
 #include "moto-bound.h"
+#include "moto-anim-curve.h"
 
 G_BEGIN_DECLS
 
@@ -51,8 +52,19 @@ GType moto_anim_node_get_type(void);
 #define MOTO_IS_ANIM_NODE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),MOTO_TYPE_ANIM_NODE))
 #define MOTO_ANIM_NODE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),MOTO_TYPE_ANIM_NODE, MotoAnimNodeClass))
 
+MotoAnimNode *moto_anim_node_new(const gchar *name);
+
+/* Keys of the curve may be edited directly. */
+MotoAnimCurve *moto_anim_node_get_curve(MotoAnimNode *self);
+
+/* Sets value of curve evaluated outside of update (see moto_anim_curve_eval_array).
+ * Node becomes updated. */
+void moto_anim_node_set_value(MotoAnimNode *self, gfloat value);
+
 void moto_anim_node_foreach_animator_type(MotoAnimNode *self);
 
+guint moto_anim_node_get_animators_num(MotoAnimNode *self);
+
 gint moto_anim_node_insert_animator(MotoAnimNode *self, gint index, gfloat width);
 gint moto_anim_node_append_animator(MotoAnimNode *self, gfloat width);
 gint moto_anim_node_prepend_animator(MotoAnimNode *self, gfloat width);
@@ -0,0 +1,745 @@
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "moto-messager.h"
+#include "moto-time-node.h"
+#include "moto-op-node.h"
+#include "moto-autosave.h"
+
+#define JOURNAL_MAGIC "MOTOJRN"
+#define JOURNAL_VERSION 3
+#define JOURNAL_BYTE_ORDER 0x01020304
+/* Journal is rewritten when it's bigger than both. */
+#define JOURNAL_COMPACT_SIZE (1 << 20)
+#define JOURNAL_COMPACT_FACTOR 4
+
+/* Parents of nodes recorded in journal. Ids of nodes start from 1.
+ * Time node isn't in hierarchy of scene. */
+#define SCENE_PARENT_ID 0
+#define TIME_PARENT_ID  G_MAXUINT32
+
+enum
+{
+    RECORD_NODE = 1,
+    RECORD_DELETE,
+    RECORD_COMMIT, /* End of snapshot. */
+};
+
+typedef struct _MotoJournalHeader
+{
+    gchar magic[8];
+    guint32 version;
+    guint32 byte_order;
+} MotoJournalHeader;
+
+typedef struct _MotoJournalRecordHeader
+{
+    guint32 kind;
+    guint32 size;
+    guint32 checksum;
+    guint32 reserved;
+} MotoJournalRecordHeader;
+
+/* Captured node. Records are never changed after creation, so the same record
+ * is shared by table of known nodes and writer jobs.
+ * Nodes are identified by ids, names of siblings may be the same.
+ * Payload of node:
+ *   guint32 id, guint32 parent id, string name, string type
+ *   guint32 size, dump of params (see moto_node_get_dump)
+ *   guint32 size, selection of op node (see moto_shape_selection_dump)
+ *   guint32 links_num, links_num * {string param, guint32 source id, string source param}
+ * Payload of deletion: guint32 id */
+typedef struct _MotoJournalRecord
+{
+    gint ref_count;
+    guint32 kind;
+    GByteArray *payload;
+} MotoJournalRecord;
+
+typedef struct _MotoAutosaveEntry
+{
+    guint32 parent;
+    gchar *name;
+    MotoJournalRecord *record;
+    guint serial; /* Last snapshot where node was found. */
+} MotoAutosaveEntry;
+
+typedef struct _MotoAutosaveJob
+{
+    GPtrArray *changed;
+    GPtrArray *all; /* For rewriting of journal. */
+} MotoAutosaveJob;
+
+struct _MotoAutosave
+{
+    MotoSceneNode *scene;
+    GString *filename;
+
+    /* Used only by thread which makes snapshots. */
+    GHashTable *entries; /* node id -> MotoAutosaveEntry */
+    GTimeVal stamp;
+    guint serial;
+
+    gint pending;
+
+    /* Used only by writer. */
+    GThreadPool *pool;
+    FILE *journal;
+    glong size, base_size;
+};
+
+static MotoJournalRecord *record_new(guint32 kind)
+{
+    MotoJournalRecord *record = g_slice_new(MotoJournalRecord);
+    record->ref_count = 1;
+    record->kind = kind;
+    record->payload = g_byte_array_new();
+    return record;
+}
+
+static MotoJournalRecord *record_ref(MotoJournalRecord *record)
+{
+    g_atomic_int_inc(& record->ref_count);
+    return record;
+}
+
+static void record_unref(MotoJournalRecord *record)
+{
+    if( ! g_atomic_int_dec_and_test(& record->ref_count))
+        return;
+    g_byte_array_free(record->payload, TRUE);
+    g_slice_free(MotoJournalRecord, record);
+}
+
+static void entry_free(MotoAutosaveEntry *entry)
+{
+    g_free(entry->name);
+    if(entry->record)
+        record_unref(entry->record);
+    g_slice_free(MotoAutosaveEntry, entry);
+}
+
+static void job_free(MotoAutosaveJob *job)
+{
+    g_ptr_array_foreach(job->changed, (GFunc)record_unref, NULL);
+    g_ptr_array_foreach(job->all, (GFunc)record_unref, NULL);
+    g_ptr_array_free(job->changed, TRUE);
+    g_ptr_array_free(job->all, TRUE);
+    g_slice_free(MotoAutosaveJob, job);
+}
+
+/* FNV-1a */
+static guint32 checksum(const guint8 *data, gsize size)
+{
+    guint32 h = 2166136261u;
+    const guint8 *end = data + size;
+    for(; data < end; data++)
+        h = (h ^ *data) * 16777619u;
+    return h;
+}
+
+static void append_uint(GByteArray *a, guint32 v)
+{
+    g_byte_array_append(a, (const guint8 *)& v, sizeof(v));
+}
+
+static void append_padded(GByteArray *a, gconstpointer data, gsize size)
+{
+    static const guint8 zero[4] = {0, 0, 0, 0};
+    g_byte_array_append(a, data, size);
+    if(size % 4)
+        g_byte_array_append(a, zero, 4 - size % 4);
+}
+
+static void append_string(GByteArray *a, const gchar *str)
+{
+    guint32 len = strlen(str);
+    append_uint(a, len);
+    append_padded(a, str, len);
+}
+
+/* Writer */
+
+static gboolean write_record(FILE *file, guint32 kind, GByteArray *payload)
+{
+    MotoJournalRecordHeader header = {kind, 0, checksum(NULL, 0), 0};
+    if(payload)
+    {
+        header.size = payload->len;
+        header.checksum = checksum(payload->data, payload->len);
+    }
+
+    if(fwrite(& header, sizeof(header), 1, file) != 1)
+        return FALSE;
+    return ! payload || ! payload->len || fwrite(payload->data, payload->len, 1, file) == 1;
+}
+
+static gboolean write_records(FILE *file, GPtrArray *records)
+{
+    guint i;
+    for(i = 0; i < records->len; i++)
+    {
+        MotoJournalRecord *record = (MotoJournalRecord *)g_ptr_array_index(records, i);
+        if( ! write_record(file, record->kind, record->payload))
+            return FALSE;
+    }
+    return write_record(file, RECORD_COMMIT, NULL) && ! fflush(file);
+}
+
+/* Journal is written anew into temporary file and replaces old one only
+ * when complete, so crash while compacting keeps the old journal. */
+static void rewrite_journal(MotoAutosave *self, GPtrArray *records)
+{
+    if(self->journal)
+    {
+        fclose(self->journal);
+        self->journal = NULL;
+    }
+
+    gchar *tmp = g_strconcat(self->filename->str, ".tmp", NULL);
+    FILE *file = fopen(tmp, "wb");
+    if( ! file)
+    {
+        moto_warning("Can't open autosave journal \"%s\" for writing", tmp);
+        g_free(tmp);
+        return;
+    }
+
+    MotoJournalHeader header = {JOURNAL_MAGIC, JOURNAL_VERSION, JOURNAL_BYTE_ORDER};
+    gboolean ok = fwrite(& header, sizeof(header), 1, file) == 1 && write_records(file, records);
+    ok = ! fclose(file) && ok;
+
+    if( ! ok || g_rename(tmp, self->filename->str))
+    {
+        moto_warning("Can't write autosave journal \"%s\"", self->filename->str);
+        g_unlink(tmp);
+        g_free(tmp);
+        return;
+    }
+    g_free(tmp);
+
+    self->journal = fopen(self->filename->str, "ab");
+    if( ! self->journal)
+    {
+        moto_warning("Can't open autosave journal \"%s\" for appending", self->filename->str);
+        return;
+    }
+    self->size = self->base_size = ftell(self->journal);
+}
+
+static void write_job(MotoAutosaveJob *job, MotoAutosave *self)
+{
+    if( ! self->journal ||
+        self->size > MAX(JOURNAL_COMPACT_SIZE, self->base_size*JOURNAL_COMPACT_FACTOR))
+    {
+        rewrite_journal(self, job->all);
+    }
+    else if(write_records(self->journal, job->changed))
+    {
+        self->size = ftell(self->journal);
+    }
+    else
+    {
+        /* Possibly torn tail is dropped by next rewrite. */
+        moto_warning("Can't append to autosave journal \"%s\"", self->filename->str);
+        fclose(self->journal);
+        self->journal = NULL;
+    }
+
+    job_free(job);
+    g_atomic_int_add(& self->pending, -1);
+}
+
+MotoAutosave *moto_autosave_new(MotoSceneNode *scene, const gchar *filename)
+{
+    MotoAutosave *self = g_slice_new(MotoAutosave);
+
+    GError *error = NULL;
+    self->pool = g_thread_pool_new((GFunc)write_job, self, 1, TRUE, & error);
+    if( ! self->pool)
+    {
+        moto_error("Can't start autosave writer: %s", error->message);
+        g_error_free(error);
+        g_slice_free(MotoAutosave, self);
+        return NULL;
+    }
+
+    self->scene = g_object_ref(scene);
+    self->filename = g_string_new(filename);
+
+    self->entries = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+        NULL, (GDestroyNotify)entry_free);
+    self->stamp.tv_sec = 0;
+    self->stamp.tv_usec = 0;
+    self->serial = 0;
+    self->pending = 0;
+
+    self->journal = NULL;
+    self->size = self->base_size = 0;
+
+    return self;
+}
+
+void moto_autosave_free(MotoAutosave *self)
+{
+    g_thread_pool_free(self->pool, FALSE, TRUE);
+
+    if(self->journal)
+        fclose(self->journal);
+
+    g_hash_table_destroy(self->entries);
+    g_string_free(self->filename, TRUE);
+    g_object_unref(self->scene);
+    g_slice_free(MotoAutosave, self);
+}
+
+const gchar *moto_autosave_get_filename(MotoAutosave *self)
+{
+    return self->filename->str;
+}
+
+/* Capturing */
+
+typedef struct _MotoAutosaveCapture
+{
+    GHashTable *known; /* Captured nodes. */
+    GByteArray *payload;
+    guint32 links_num;
+    const GTimeVal *stamp;
+    gboolean changed;
+} MotoAutosaveCapture;
+
+static void collect_tree(MotoNode *node, guint32 parent, GPtrArray *nodes, GArray *parents,
+        GHashTable *known)
+{
+    GList *l = moto_node_get_children(node);
+    for(; l; l = g_list_next(l))
+    {
+        MotoNode *child = (MotoNode *)l->data;
+        g_ptr_array_add(nodes, child);
+        g_array_append_val(parents, parent);
+        g_hash_table_insert(known, child, child);
+        collect_tree(child, moto_node_get_id(child), nodes, parents, known);
+    }
+}
+
+static gboolean not_older(const GTimeVal *a, const GTimeVal *b)
+{
+    return a->tv_sec > b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_usec >= b->tv_usec);
+}
+
+static void check_param(MotoNode *node, MotoParam *param, MotoAutosaveCapture *c)
+{
+    if( ! (moto_param_get_mode(param) & MOTO_PARAM_MODE_IN))
+        return;
+    if(not_older(moto_param_get_last_modified(param), c->stamp))
+        c->changed = TRUE;
+}
+
+/* Selections and other edits which aren't in params. */
+static void check_node(MotoNode *node, MotoAutosaveCapture *c)
+{
+    if(not_older(moto_node_get_last_edited(node), c->stamp))
+        c->changed = TRUE;
+    else
+        moto_node_foreach_param(node, (MotoNodeForeachParamFunc)check_param, c);
+}
+
+static void capture_link(MotoNode *node, MotoParam *param, MotoAutosaveCapture *c)
+{
+    MotoParam *source = moto_param_get_source(param);
+    MotoNode *source_node = (source) ? moto_param_get_node(source) : NULL;
+    if( ! source_node || ! g_hash_table_lookup(c->known, source_node))
+        return;
+
+    c->links_num++;
+    append_string(c->payload, moto_param_get_name(param));
+    append_uint(c->payload, moto_node_get_id(source_node));
+    append_string(c->payload, moto_param_get_name(source));
+}
+
+static MotoJournalRecord *capture_node(MotoNode *node, guint32 parent, MotoAutosaveCapture *c)
+{
+    MotoJournalRecord *record = record_new(RECORD_NODE);
+    GByteArray *a = record->payload;
+
+    append_uint(a, moto_node_get_id(node));
+    append_uint(a, parent);
+    append_string(a, moto_node_get_name(node));
+    append_string(a, moto_node_get_type_name(node));
+
+    glong size = 0;
+    gconstpointer dump = moto_node_get_dump(node, & size);
+    append_uint(a, size);
+    append_padded(a, dump, size);
+
+    /* Dump of selection is made of words, so it needs no padding. */
+    guint selection_offset = a->len;
+    append_uint(a, 0);
+    if(MOTO_IS_OP_NODE(node) && moto_op_node_get_selection((MotoOpNode *)node))
+    {
+        moto_shape_selection_dump(moto_op_node_get_selection((MotoOpNode *)node), a);
+        guint32 selection_size = a->len - selection_offset - sizeof(guint32);
+        memcpy(a->data + selection_offset, & selection_size, sizeof(guint32));
+    }
+
+    guint links_offset = a->len;
+    append_uint(a, 0);
+    c->payload = a;
+    c->links_num = 0;
+    moto_node_foreach_param(node, (MotoNodeForeachParamFunc)capture_link, c);
+    memcpy(a->data + links_offset, & c->links_num, sizeof(guint32));
+
+    return record;
+}
+
+typedef struct _MotoAutosaveSweep
+{
+    guint serial;
+    GPtrArray *changed;
+} MotoAutosaveSweep;
+
+static gboolean sweep_entry(gpointer key, MotoAutosaveEntry *entry, MotoAutosaveSweep *sweep)
+{
+    if(entry->serial == sweep->serial)
+        return FALSE;
+
+    MotoJournalRecord *record = record_new(RECORD_DELETE);
+    append_uint(record->payload, GPOINTER_TO_UINT(key));
+    g_ptr_array_add(sweep->changed, record);
+    return TRUE;
+}
+
+gboolean moto_autosave_snapshot(MotoAutosave *self)
+{
+    if(g_atomic_int_get(& self->pending))
+        return FALSE;
+
+    GTimeVal stamp;
+    g_get_current_time(& stamp);
+    self->serial++;
+
+    GPtrArray *nodes = g_ptr_array_new();
+    GArray *parents = g_array_new(FALSE, FALSE, sizeof(guint32));
+    GHashTable *known = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    MotoNode *time_node = (MotoNode *)moto_scene_node_get_time_node(self->scene);
+    guint32 time_parent = TIME_PARENT_ID;
+    g_ptr_array_add(nodes, time_node);
+    g_array_append_val(parents, time_parent);
+    g_hash_table_insert(known, time_node, time_node);
+    collect_tree((MotoNode *)self->scene, SCENE_PARENT_ID, nodes, parents, known);
+
+    MotoAutosaveJob *job = g_slice_new(MotoAutosaveJob);
+    job->changed = g_ptr_array_new();
+    job->all = g_ptr_array_sized_new(nodes->len);
+
+    /* Links refer to ids, so renamed or moved node is the only one captured again. */
+    MotoAutosaveCapture c = {known, NULL, 0, & self->stamp, FALSE};
+    guint i;
+    for(i = 0; i < nodes->len; i++)
+    {
+        MotoNode *node = (MotoNode *)g_ptr_array_index(nodes, i);
+        guint32 parent = g_array_index(parents, guint32, i);
+        const gchar *name = moto_node_get_name(node);
+        gpointer id = GUINT_TO_POINTER(moto_node_get_id(node));
+
+        MotoAutosaveEntry *entry = g_hash_table_lookup(self->entries, id);
+        c.changed = FALSE;
+        if( ! entry)
+        {
+            entry = g_slice_new(MotoAutosaveEntry);
+            entry->parent = parent;
+            entry->name = g_strdup(name);
+            entry->record = NULL;
+            g_hash_table_insert(self->entries, id, entry);
+        }
+        else if(entry->parent != parent || strcmp(entry->name, name))
+        {
+            entry->parent = parent;
+            g_free(entry->name);
+            entry->name = g_strdup(name);
+            c.changed = TRUE;
+        }
+        entry->serial = self->serial;
+
+        c.changed = c.changed || ! entry->record;
+        if( ! c.changed)
+            check_node(node, & c);
+
+        if(c.changed)
+        {
+            if(entry->record)
+                record_unref(entry->record);
+            entry->record = capture_node(node, parent, & c);
+            g_ptr_array_add(job->changed, record_ref(entry->record));
+        }
+        g_ptr_array_add(job->all, record_ref(entry->record));
+    }
+
+    MotoAutosaveSweep sweep = {self->serial, job->changed};
+    g_hash_table_foreach_remove(self->entries, (GHRFunc)sweep_entry, & sweep);
+
+    g_hash_table_destroy(known);
+    g_array_free(parents, TRUE);
+    g_ptr_array_free(nodes, TRUE);
+
+    self->stamp = stamp;
+
+    if( ! job->changed->len)
+    {
+        job_free(job);
+        return TRUE;
+    }
+
+    g_atomic_int_inc(& self->pending);
+    g_thread_pool_push(self->pool, job, NULL);
+    return TRUE;
+}
+
+/* Recovery */
+
+typedef struct _MotoJournalReader
+{
+    const guint8 *data;
+    const guint8 *end;
+} MotoJournalReader;
+
+static gboolean read_uint(MotoJournalReader *r, guint32 *v)
+{
+    if(r->data + sizeof(guint32) > r->end)
+        return FALSE;
+    memcpy(v, r->data, sizeof(guint32));
+    r->data += sizeof(guint32);
+    return TRUE;
+}
+
+static gboolean read_bytes(MotoJournalReader *r, guint32 size, const guint8 **bytes)
+{
+    gsize padded = (size + 3) & ~(gsize)3;
+    if(padded > (gsize)(r->end - r->data))
+        return FALSE;
+    *bytes = r->data;
+    r->data += padded;
+    return TRUE;
+}
+
+static gchar *read_string(MotoJournalReader *r)
+{
+    guint32 len;
+    const guint8 *bytes;
+    if( ! read_uint(r, & len) || ! read_bytes(r, len, & bytes))
+        return NULL;
+    return g_strndup((const gchar *)bytes, len);
+}
+
+static void apply_record(GHashTable *state, const MotoJournalRecordHeader *header)
+{
+    MotoJournalReader r = {(const guint8 *)(header + 1), (const guint8 *)(header + 1) + header->size};
+    guint32 id;
+    if( ! read_uint(& r, & id))
+        return;
+
+    if(RECORD_NODE == header->kind)
+        g_hash_table_replace(state, GUINT_TO_POINTER(id), (gpointer)header);
+    else
+        g_hash_table_remove(state, GUINT_TO_POINTER(id));
+}
+
+typedef struct _MotoJournalNode
+{
+    guint32 parent;
+    gchar *name;
+    gchar *type_name;
+    guint32 size;
+    const guint8 *dump;
+    guint32 selection_size;
+    const guint8 *selection;
+} MotoJournalNode;
+
+/* Reads record of node up to its links. Strings are freed by caller. */
+static gboolean read_node(MotoJournalReader *r, MotoJournalNode *n)
+{
+    guint32 id;
+    n->name = n->type_name = NULL;
+    if( ! read_uint(r, & id) || ! read_uint(r, & n->parent))
+        return FALSE;
+    n->name = read_string(r);
+    n->type_name = (n->name) ? read_string(r) : NULL;
+    return n->type_name && read_uint(r, & n->size) && read_bytes(r, n->size, & n->dump) &&
+        read_uint(r, & n->selection_size) && read_bytes(r, n->selection_size, & n->selection);
+}
+
+static void recover_selection(MotoNode *node, MotoJournalNode *n)
+{
+    if( ! n->selection_size || ! MOTO_IS_OP_NODE(node))
+        return;
+
+    gsize size = n->selection_size;
+    MotoShapeSelection *selection = moto_shape_selection_new_from_dump(n->selection, & size);
+    if( ! selection)
+    {
+        moto_warning("Selection of node '%s' from autosave is corrupted", n->name);
+        return;
+    }
+
+    moto_op_node_set_selection((MotoOpNode *)node, selection);
+    moto_shape_selection_free(selection);
+}
+
+static MotoNode *recover_node(MotoSceneNode *scene, GHashTable *state, GHashTable *nodes, guint32 id)
+{
+    gpointer node = NULL;
+    if(g_hash_table_lookup_extended(nodes, GUINT_TO_POINTER(id), NULL, & node))
+        return (MotoNode *)node;
+    /* Not created yet or failed, also breaks cycles in broken journal. */
+    g_hash_table_insert(nodes, GUINT_TO_POINTER(id), NULL);
+
+    const MotoJournalRecordHeader *rh = g_hash_table_lookup(state, GUINT_TO_POINTER(id));
+    if( ! rh)
+        return NULL;
+
+    MotoJournalReader r = {(const guint8 *)(rh + 1), (const guint8 *)(rh + 1) + rh->size};
+    MotoJournalNode n;
+    if( ! read_node(& r, & n))
+    {
+        g_free(n.name);
+        g_free(n.type_name);
+        return NULL;
+    }
+
+    if(TIME_PARENT_ID == n.parent)
+        node = moto_scene_node_get_time_node(scene);
+    else
+    {
+        MotoNode *parent = (SCENE_PARENT_ID == n.parent) ? (MotoNode *)scene :
+            recover_node(scene, state, nodes, n.parent);
+        if(parent)
+            node = moto_node_create_child_by_name(parent, n.type_name, n.name);
+    }
+
+    if(node)
+    {
+        moto_node_set_dump((MotoNode *)node, n.dump, n.size, NULL);
+        recover_selection((MotoNode *)node, & n);
+        g_hash_table_insert(nodes, GUINT_TO_POINTER(id), node);
+    }
+    else
+        moto_warning("Node '%s' of type '%s' from autosave isn't created", n.name, n.type_name);
+
+    g_free(n.name);
+    g_free(n.type_name);
+    return (MotoNode *)node;
+}
+
+static void link_node(MotoNode *node, GHashTable *nodes, MotoJournalReader *r)
+{
+    guint32 num, i;
+    if( ! read_uint(r, & num))
+        return;
+
+    for(i = 0; i < num; i++)
+    {
+        guint32 source_id;
+        gchar *name = read_string(r);
+        gchar *source_name = (name && read_uint(r, & source_id)) ? read_string(r) : NULL;
+        if( ! source_name)
+        {
+            g_free(name);
+            return;
+        }
+
+        MotoNode *source_node = g_hash_table_lookup(nodes, GUINT_TO_POINTER(source_id));
+        MotoParam *param  = moto_node_get_param(node, name);
+        MotoParam *source = (source_node) ? moto_node_get_param(source_node, source_name) : NULL;
+        if(param && source)
+            moto_param_link(param, source);
+
+        g_free(name);
+        g_free(source_name);
+    }
+}
+
+gboolean moto_autosave_recover(MotoSceneNode *scene, const gchar *filename)
+{
+    gchar *data;
+    gsize size;
+    GError *error = NULL;
+    if( ! g_file_get_contents(filename, & data, & size, & error))
+    {
+        moto_error("Can't read autosave journal \"%s\": %s", filename, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    const MotoJournalHeader *header = (const MotoJournalHeader *)data;
+    if(size < sizeof(MotoJournalHeader) || memcmp(header->magic, JOURNAL_MAGIC, sizeof(header->magic)) ||
+       header->version != JOURNAL_VERSION || header->byte_order != JOURNAL_BYTE_ORDER)
+    {
+        moto_error("File \"%s\" isn't autosave journal or has unsupported version", filename);
+        g_free(data);
+        return FALSE;
+    }
+
+    /* Latest record for each node. Records of snapshot are applied only
+     * when its end is found, so torn snapshot is ignored. */
+    GHashTable *state = g_hash_table_new(g_direct_hash, g_direct_equal);
+    GPtrArray *snapshot = g_ptr_array_new();
+
+    const guint8 *p = (const guint8 *)data + sizeof(MotoJournalHeader);
+    const guint8 *end = (const guint8 *)data + size;
+    while((gsize)(end - p) >= sizeof(MotoJournalRecordHeader))
+    {
+        const MotoJournalRecordHeader *rh = (const MotoJournalRecordHeader *)p;
+        const guint8 *payload = p + sizeof(MotoJournalRecordHeader);
+        if(rh->size > (gsize)(end - payload) || checksum(payload, rh->size) != rh->checksum)
+            break;
+
+        if(RECORD_COMMIT == rh->kind)
+        {
+            guint i;
+            for(i = 0; i < snapshot->len; i++)
+                apply_record(state, g_ptr_array_index(snapshot, i));
+            g_ptr_array_set_size(snapshot, 0);
+        }
+        else
+            g_ptr_array_add(snapshot, (gpointer)rh);
+
+        p = payload + rh->size;
+    }
+
+    if(snapshot->len)
+        moto_warning("Last snapshot in autosave journal \"%s\" is incomplete and skipped", filename);
+    g_ptr_array_free(snapshot, TRUE);
+
+    /* Parents are created before children. */
+    GList *ids = g_hash_table_get_keys(state);
+    GHashTable *nodes = g_hash_table_new(g_direct_hash, g_direct_equal);
+    GList *l;
+    for(l = ids; l; l = g_list_next(l))
+        recover_node(scene, state, nodes, GPOINTER_TO_UINT(l->data));
+
+    /* Links after all nodes are created. */
+    for(l = ids; l; l = g_list_next(l))
+    {
+        MotoNode *node = g_hash_table_lookup(nodes, l->data);
+        if( ! node)
+            continue;
+
+        const MotoJournalRecordHeader *rh = g_hash_table_lookup(state, l->data);
+        MotoJournalReader r = {(const guint8 *)(rh + 1), (const guint8 *)(rh + 1) + rh->size};
+        MotoJournalNode n;
+        if(read_node(& r, & n))
+            link_node(node, nodes, & r);
+        g_free(n.name);
+        g_free(n.type_name);
+    }
+
+    g_list_free(ids);
+    g_hash_table_destroy(nodes);
+    g_hash_table_destroy(state);
+    g_free(data);
+
+    return TRUE;
+}
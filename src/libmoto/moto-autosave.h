@@ -0,0 +1,54 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_AUTOSAVE_H__
+#define __MOTO_AUTOSAVE_H__
+
+#include "moto-scene-node.h"
+
+G_BEGIN_DECLS
+
+/* Autosave journal of scene. Each snapshot captures on calling thread only
+ * nodes whose params or selections were changed since previous snapshot (see
+ * moto_param_get_last_modified and moto_node_get_last_edited) and writer
+ * thread appends them to journal. Captures of unchanged nodes are shared
+ * between snapshots, so writer may rewrite the whole journal from them when
+ * it grows too much.
+ * Geometry isn't journaled, only params, links and selections of op nodes. */
+
+typedef struct _MotoAutosave MotoAutosave;
+
+MotoAutosave *moto_autosave_new(MotoSceneNode *scene, const gchar *filename);
+/* Waits for writer. */
+void moto_autosave_free(MotoAutosave *self);
+
+const gchar *moto_autosave_get_filename(MotoAutosave *self);
+
+/* Returns FALSE if writer is still busy with previous snapshot. Changes
+ * aren't lost in this case and go into the next one. */
+gboolean moto_autosave_snapshot(MotoAutosave *self);
+
+/* Creates nodes from journal in scene. Only complete snapshots are restored. */
+gboolean moto_autosave_recover(MotoSceneNode *scene, const gchar *filename);
+
+G_END_DECLS
+
+#endif /* __MOTO_AUTOSAVE_H__ */
@@ -188,26 +188,32 @@ void moto_bitmask_toggle_fast(MotoBitmask *self, guint32 index)
         moto_bitmask_set_fast(self, index);
 }
 
-guint32* moto_bitmask_create_array_32(MotoBitmask* self)
+void moto_bitmask_fill_array_32(MotoBitmask* self, guint32 *array)
 {
-    guint32* array = (guint32*)g_try_malloc(sizeof(guint32)*self->set_num);
-
     guint32 i, j = 0;
     for(i = 0; i < self->bits_num; i++)
         if(moto_bitmask_is_set_fast(self, i))
             array[j++] = i;
-
-    return array;
 }
 
-guint16* moto_bitmask_create_array_16(MotoBitmask* self)
+void moto_bitmask_fill_array_16(MotoBitmask* self, guint16 *array)
 {
-    guint16* array = (guint16*)g_try_malloc(sizeof(guint16)*self->set_num);
-
     guint16 i, j = 0;
     for(i = 0; i < self->bits_num; i++)
         if(moto_bitmask_is_set_fast(self, i))
             array[j++] = i;
+}
 
+guint32* moto_bitmask_create_array_32(MotoBitmask* self)
+{
+    guint32* array = (guint32*)g_try_malloc(sizeof(guint32)*self->set_num);
+    moto_bitmask_fill_array_32(self, array);
+    return array;
+}
+
+guint16* moto_bitmask_create_array_16(MotoBitmask* self)
+{
+    guint16* array = (guint16*)g_try_malloc(sizeof(guint16)*self->set_num);
+    moto_bitmask_fill_array_16(self, array);
     return array;
 }
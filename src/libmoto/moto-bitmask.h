@@ -60,6 +60,10 @@ void moto_bitmask_set_fast(MotoBitmask *self, guint32 index);
 void moto_bitmask_unset_fast(MotoBitmask *self, guint32 index);
 void moto_bitmask_toggle_fast(MotoBitmask *self, guint32 index);
 
+/* Array must have place for moto_bitmask_get_set_num indecies. */
+void moto_bitmask_fill_array_32(MotoBitmask* self, guint32 *array);
+void moto_bitmask_fill_array_16(MotoBitmask* self, guint16 *array);
+
 guint32* moto_bitmask_create_array_32(MotoBitmask* self);
 guint16* moto_bitmask_create_array_16(MotoBitmask* self);
 
@@ -0,0 +1,580 @@
+#include <string.h>
+#include <math.h>
+
+#include "libmotoutil/numdef.h"
+
+#include "moto-types.h"
+#include "moto-messager.h"
+#include "moto-copyable.h"
+#include "moto-point-cloud.h"
+#include "moto-time-node.h"
+#include "moto-cache-node.h"
+
+/* forwards */
+
+static void moto_cache_node_update(MotoNode *self);
+static void moto_cache_node_param_changed(MotoNode *self, MotoParam *param);
+
+/* class MotoCacheNode */
+
+typedef struct _MotoCacheFrame MotoCacheFrame;
+typedef struct _MotoCacheNodePriv MotoCacheNodePriv;
+
+#define MOTO_CACHE_NODE_GET_PRIVATE(obj) \
+    G_TYPE_INSTANCE_GET_PRIVATE(obj, MOTO_TYPE_CACHE_NODE, MotoCacheNodePriv)
+
+static GObjectClass *cache_node_parent_class = NULL;
+
+/* Delta frames keep differences from the previous frame quantized to 8 bits.
+ * Each DELTA_KEY_INTERVAL frame is a key one, so random access decodes
+ * a few frames only. */
+#define DELTA_KEY_INTERVAL 16
+
+typedef enum
+{
+    FRAME_FLOAT,
+    FRAME_QUANTIZED,
+    FRAME_DELTA
+} MotoCacheFrameKind;
+
+struct _MotoCacheFrame
+{
+    gfloat time;
+
+    /* Copy of the whole shape when its structure differs from the shared one. */
+    MotoShape *shape;
+
+    /* Packed xyz of points and normals. */
+    MotoCacheFrameKind kind;
+    gpointer points;
+    gpointer normals;
+
+    /* Range of quantized values for points [0] and normals [1]. */
+    gfloat origin[2][3];
+    gfloat scale[2][3];
+};
+
+struct _MotoCacheNodePriv
+{
+    gboolean baking;
+
+    /* Structure shared by all frames which have no own shape. */
+    MotoShape *topology;
+    gsize v_num;
+
+    GArray *frames;
+    gboolean quantized;
+    gboolean delta;
+
+    /* Decoded previous frame, deltas are taken against it while baking. */
+    gfloat *base_points;
+    gfloat *base_normals;
+    guint since_key;
+
+    guint cursor;
+    gint decoded;
+};
+
+static void free_frame(MotoCacheFrame *frame)
+{
+    if(frame->shape)
+        g_object_unref(frame->shape);
+    g_free(frame->points);
+    g_free(frame->normals);
+}
+
+static void
+moto_cache_node_dispose(GObject *obj)
+{
+    moto_cache_node_clear((MotoCacheNode *)obj);
+
+    cache_node_parent_class->dispose(obj);
+}
+
+static void
+moto_cache_node_finalize(GObject *obj)
+{
+    MotoCacheNodePriv *priv = MOTO_CACHE_NODE_GET_PRIVATE(obj);
+
+    g_array_free(priv->frames, TRUE);
+
+    cache_node_parent_class->finalize(obj);
+}
+
+static void
+moto_cache_node_init(MotoCacheNode *self)
+{
+    MotoNode *node = (MotoNode *)self;
+    MotoCacheNodePriv *priv = MOTO_CACHE_NODE_GET_PRIVATE(self);
+
+    priv->baking    = FALSE;
+    priv->topology  = NULL;
+    priv->v_num     = 0;
+    priv->frames    = g_array_new(FALSE, FALSE, sizeof(MotoCacheFrame));
+    priv->quantized = FALSE;
+    priv->delta     = FALSE;
+    priv->base_points  = NULL;
+    priv->base_normals = NULL;
+    priv->since_key = 0;
+    priv->cursor    = 0;
+    priv->decoded   = -1;
+
+    moto_node_add_params(node,
+            "in",       "Input Shape", MOTO_TYPE_SHAPE, MOTO_PARAM_MODE_IN,    NULL,  NULL, "Shape",
+            "time",     "Time",        MOTO_TYPE_FLOAT, MOTO_PARAM_MODE_INOUT, 0.0f,  NULL, "Time",
+            "playback", "Playback",    MOTO_TYPE_BOOL,  MOTO_PARAM_MODE_INOUT, TRUE,  NULL, "Cache",
+            "quantize", "Quantize",    MOTO_TYPE_BOOL,  MOTO_PARAM_MODE_INOUT, FALSE, NULL, "Cache",
+            "delta",    "Delta",       MOTO_TYPE_BOOL,  MOTO_PARAM_MODE_INOUT, FALSE, NULL, "Cache",
+            NULL);
+}
+
+static void
+moto_cache_node_class_init(MotoCacheNodeClass *klass)
+{
+    g_type_class_add_private(klass, sizeof(MotoCacheNodePriv));
+
+    cache_node_parent_class = (GObjectClass *)g_type_class_peek_parent(klass);
+
+    GObjectClass *goclass = G_OBJECT_CLASS(klass);
+    MotoNodeClass *nclass = (MotoNodeClass *)klass;
+
+    goclass->dispose    = moto_cache_node_dispose;
+    goclass->finalize   = moto_cache_node_finalize;
+
+    nclass->update = moto_cache_node_update;
+    nclass->param_changed = moto_cache_node_param_changed;
+}
+
+G_DEFINE_TYPE(MotoCacheNode, moto_cache_node, MOTO_TYPE_SHAPE_NODE);
+
+/* Methods of class MotoCacheNode */
+
+MotoCacheNode *moto_cache_node_new(const gchar *name)
+{
+    MotoCacheNode *self = (MotoCacheNode *)g_object_new(MOTO_TYPE_CACHE_NODE, NULL);
+    MotoNode *node = (MotoNode *)self;
+
+    moto_node_set_name(node, name);
+
+    return self;
+}
+
+static void mark_upstream_for_update(MotoNode *node);
+
+static void mark_source_for_update(MotoNode *node, MotoParam *param, gpointer user_data)
+{
+    MotoParam *src = moto_param_get_source(param);
+    if(src)
+        mark_upstream_for_update(moto_param_get_node(src));
+}
+
+static void mark_upstream_for_update(MotoNode *node)
+{
+    if( ! moto_node_is_animated(node) || moto_node_needs_update(node))
+        return;
+    moto_node_mark_for_update(node);
+    moto_node_foreach_param(node, mark_source_for_update, NULL);
+}
+
+/* While frames are played the upstream graph isn't needed, so it's cut off
+ * from time. When playback stops it's updated on next scene update.
+ * Cut changes flags of other nodes, so it's applied only when playback or
+ * frames are changed and never from update. */
+static void update_time_cut(MotoCacheNode *self)
+{
+    MotoNode *node = (MotoNode *)self;
+    MotoCacheNodePriv *priv = MOTO_CACHE_NODE_GET_PRIVATE(self);
+    MotoParam *in = moto_node_get_param(node, "in");
+
+    gboolean playback = FALSE;
+    moto_node_get_param_boolean(node, "playback", & playback);
+    gboolean cut = playback && ! priv->baking && priv->frames->len > 0;
+
+    moto_param_set_time_cut(in, cut);
+
+    MotoParam *src = moto_param_get_source(in);
+    if( ! cut && src)
+        mark_upstream_for_update(moto_param_get_node(src));
+}
+
+void moto_cache_node_clear(MotoCacheNode *self)
+{
+    MotoCacheNodePriv *priv = MOTO_CACHE_NODE_GET_PRIVATE(self);
+
+    guint i;
+    for(i = 0; i < priv->frames->len; i++)
+        free_frame(& g_array_index(priv->frames, MotoCacheFrame, i));
+    g_array_set_size(priv->frames, 0);
+
+    if(priv->topology)
+    {
+        g_object_unref(priv->topology);
+        priv->topology = NULL;
+    }
+    g_free(priv->base_points);
+    g_free(priv->base_normals);
+    priv->base_points  = NULL;
+    priv->base_normals = NULL;
+    priv->since_key = 0;
+    priv->v_num   = 0;
+    priv->cursor  = 0;
+    priv->decoded = -1;
+
+    update_time_cut(self);
+}
+
+guint moto_cache_node_get_frames_num(MotoCacheNode *self)
+{
+    return MOTO_CACHE_NODE_GET_PRIVATE(self)->frames->len;
+}
+
+gsize moto_cache_node_get_size(MotoCacheNode *self)
+{
+    MotoCacheNodePriv *priv = MOTO_CACHE_NODE_GET_PRIVATE(self);
+
+    static const gsize value_sizes[] = {sizeof(gfloat), sizeof(guint16), sizeof(guint8)};
+    gsize size = 0;
+
+    guint i;
+    for(i = 0; i < priv->frames->len; i++)
+    {
+        MotoCacheFrame *frame = & g_array_index(priv->frames, MotoCacheFrame, i);
+        size += sizeof(MotoCacheFrame);
+        if(frame->points)
+            size += 2*3*priv->v_num*value_sizes[frame->kind];
+    }
+
+    return size;
+}
+
+/* Plain data of point clouds has 4 floats per point. */
+
+/* Values (minus base if any) are quantized inside of their bound. */
+static void get_range(const gfloat *values, const gfloat *base, gsize v_num, gfloat levels,
+        gfloat *origin, gfloat *scale)
+{
+    gfloat lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+    gsize i;
+    gint j;
+
+    for(i = 0; i < v_num; i++)
+        for(j = 0; j < 3; j++)
+        {
+            gfloat c = values[i*4 + j] - ((base) ? base[i*4 + j] : 0);
+            if( ! i || c < lo[j]) lo[j] = c;
+            if( ! i || c > hi[j]) hi[j] = c;
+        }
+
+    for(j = 0; j < 3; j++)
+    {
+        origin[j] = lo[j];
+        scale[j]  = (hi[j] - lo[j] < MICRO) ? 0 : (hi[j] - lo[j])/levels;
+    }
+}
+
+static gpointer encode_values(MotoCacheFrameKind kind, const gfloat *values, const gfloat *base,
+        gsize v_num, gfloat *origin, gfloat *scale)
+{
+    gsize i;
+    gint j;
+
+    if(FRAME_FLOAT == kind)
+    {
+        gfloat *data = g_new(gfloat, 3*v_num), *v = data;
+        for(i = 0; i < v_num; i++, v += 3, values += 4)
+            memcpy(v, values, 3*sizeof(gfloat));
+        return data;
+    }
+
+    if(FRAME_QUANTIZED == kind)
+    {
+        get_range(values, NULL, v_num, 65535, origin, scale);
+
+        guint16 *data = g_new(guint16, 3*v_num), *v = data;
+        for(i = 0; i < v_num; i++, v += 3, values += 4)
+            for(j = 0; j < 3; j++)
+                v[j] = (scale[j] > 0) ? (guint16)((values[j] - origin[j])/scale[j] + 0.5f) : 0;
+        return data;
+    }
+
+    get_range(values, base, v_num, 255, origin, scale);
+
+    guint8 *data = g_new(guint8, 3*v_num), *v = data;
+    for(i = 0; i < v_num; i++, v += 3, values += 4, base += 4)
+        for(j = 0; j < 3; j++)
+            v[j] = (scale[j] > 0) ? (guint8)((values[j] - base[j] - origin[j])/scale[j] + 0.5f) : 0;
+    return data;
+}
+
+/* Delta frame is added to values which must contain the previous frame. */
+static void decode_values(MotoCacheFrameKind kind, gconstpointer data, gfloat *values, gsize v_num,
+        const gfloat *origin, const gfloat *scale)
+{
+    gsize i;
+    gint j;
+
+    if(FRAME_FLOAT == kind)
+    {
+        const gfloat *v = data;
+        for(i = 0; i < v_num; i++, v += 3, values += 4)
+            memcpy(values, v, 3*sizeof(gfloat));
+    }
+    else if(FRAME_QUANTIZED == kind)
+    {
+        const guint16 *v = data;
+        for(i = 0; i < v_num; i++, v += 3, values += 4)
+            for(j = 0; j < 3; j++)
+                values[j] = origin[j] + v[j]*scale[j];
+    }
+    else
+    {
+        const guint8 *v = data;
+        for(i = 0; i < v_num; i++, v += 3, values += 4)
+            for(j = 0; j < 3; j++)
+                values[j] += origin[j] + v[j]*scale[j];
+    }
+}
+
+static void encode_frame(MotoCacheFrame *frame, MotoCacheFrameKind kind,
+        const gfloat *points, const gfloat *normals, const gfloat *base_points, const gfloat *base_normals,
+        gsize v_num)
+{
+    frame->kind    = kind;
+    frame->points  = encode_values(kind, points, base_points, v_num, frame->origin[0], frame->scale[0]);
+    frame->normals = encode_values(kind, normals, base_normals, v_num, frame->origin[1], frame->scale[1]);
+}
+
+static void decode_frame(MotoCacheFrame *frame, gfloat *points, gfloat *normals, gsize v_num)
+{
+    decode_values(frame->kind, frame->points, points, v_num, frame->origin[0], frame->scale[0]);
+    decode_values(frame->kind, frame->normals, normals, v_num, frame->origin[1], frame->scale[1]);
+}
+
+static gboolean has_same_struct(MotoShape *a, MotoShape *b)
+{
+    return G_TYPE_FROM_INSTANCE(a) == G_TYPE_FROM_INSTANCE(b) && \
+           moto_shape_is_struct_the_same(a, b);
+}
+
+static gboolean store_frame(MotoCacheNode *self, MotoShape *in, gfloat time)
+{
+    MotoCacheNodePriv *priv = MOTO_CACHE_NODE_GET_PRIVATE(self);
+
+    if( ! MOTO_IS_COPYABLE(in))
+    {
+        moto_error("Shape of type \"%s\" can't be copied to cache.", G_OBJECT_TYPE_NAME(in));
+        return FALSE;
+    }
+
+    MotoCacheFrame frame;
+    memset(& frame, 0, sizeof(MotoCacheFrame));
+    frame.time = time;
+
+    gboolean plain = MOTO_IS_POINTCLOUD(in) && \
+        moto_pointcloud_can_provide_plain_data((MotoPointCloud *)in);
+
+    if(plain && ! priv->topology)
+    {
+        priv->topology = (MotoShape *)moto_copyable_copy((MotoCopyable *)in);
+    }
+
+    if(plain && has_same_struct(priv->topology, in))
+    {
+        gfloat *points, *normals;
+        gsize v_num;
+        moto_pointcloud_get_plain_data((MotoPointCloud *)in, & points, & normals, & v_num);
+        priv->v_num = v_num;
+
+        MotoCacheFrameKind kind = (priv->quantized) ? FRAME_QUANTIZED : FRAME_FLOAT;
+        if(priv->delta && priv->since_key % DELTA_KEY_INTERVAL)
+            kind = FRAME_DELTA;
+        encode_frame(& frame, kind, points, normals, priv->base_points, priv->base_normals, v_num);
+
+        /* Deltas are taken against decoded frame, so errors aren't accumulated. */
+        if(priv->delta)
+        {
+            if( ! priv->base_points)
+            {
+                priv->base_points  = g_new0(gfloat, 4*v_num);
+                priv->base_normals = g_new0(gfloat, 4*v_num);
+            }
+            decode_frame(& frame, priv->base_points, priv->base_normals, v_num);
+        }
+        priv->since_key++;
+    }
+    else
+    {
+        frame.shape = (MotoShape *)moto_copyable_copy((MotoCopyable *)in);
+        priv->since_key = 0;
+    }
+
+    g_array_append_val(priv->frames, frame);
+    return TRUE;
+}
+
+gboolean moto_cache_node_bake(MotoCacheNode *self, MotoSceneNode *scene,
+        gfloat start, gfloat end, gfloat step)
+{
+    MotoNode *node = (MotoNode *)self;
+    MotoCacheNodePriv *priv = MOTO_CACHE_NODE_GET_PRIVATE(self);
+
+    if(step < MICRO || end < start)
+    {
+        moto_error("Invalid frame range for baking [%f, %f] with step %f.", start, end, step);
+        return FALSE;
+    }
+
+    MotoParam *time = moto_param_get_source(moto_node_get_param(node, "time"));
+    if( ! time)
+    {
+        moto_error("Time of cache node \"%s\" isn't linked. Nothing to bake.", moto_node_get_name(node));
+        return FALSE;
+    }
+    gfloat old_time = moto_param_get_float(time);
+
+    /* Scene time is used if cache follows time node so only animated nodes are updated. */
+    gboolean scene_time = MOTO_IS_TIME_NODE(moto_param_get_node(time));
+    if(scene_time)
+        old_time = moto_scene_node_get_current_time(scene);
+
+    moto_cache_node_clear(self);
+    moto_node_get_param_boolean(node, "quantize", & priv->quantized);
+    moto_node_get_param_boolean(node, "delta", & priv->delta);
+
+    gboolean ok = TRUE;
+    priv->baking = TRUE;
+
+    guint i, num = (guint)floor((end - start)/step + MICRO) + 1;
+    for(i = 0; ok && i < num; i++)
+    {
+        gfloat t = start + i*step;
+        if(scene_time)
+        {
+            moto_scene_node_set_current_time(scene, t);
+        }
+        else
+        {
+            moto_param_set_float(time, t);
+            moto_scene_node_update(scene);
+        }
+
+        MotoShape *in = NULL;
+        moto_node_get_param_object(node, "in", (GObject **)& in);
+        if( ! in)
+        {
+            moto_error("Cache node \"%s\" has no input shape at time %f.", moto_node_get_name(node), t);
+            ok = FALSE;
+            break;
+        }
+
+        ok = store_frame(self, in, t);
+    }
+
+    priv->baking = FALSE;
+    if( ! ok)
+        moto_cache_node_clear(self);
+
+    g_free(priv->base_points);
+    g_free(priv->base_normals);
+    priv->base_points  = NULL;
+    priv->base_normals = NULL;
+    update_time_cut(self);
+
+    if(scene_time)
+    {
+        moto_scene_node_set_current_time(scene, old_time);
+    }
+    else
+    {
+        moto_param_set_float(time, old_time);
+        moto_scene_node_update(scene);
+    }
+
+    return ok;
+}
+
+/* Last frame with time less or equal. Playback is sequential mostly so
+ * the previous result is checked first. */
+static guint find_frame(MotoCacheNodePriv *priv, gfloat time)
+{
+    GArray *frames = priv->frames;
+    guint num = frames->len;
+
+    guint c = priv->cursor;
+    if(c < num && g_array_index(frames, MotoCacheFrame, c).time <= time + MICRO)
+    {
+        if(c + 1 >= num || time + MICRO < g_array_index(frames, MotoCacheFrame, c + 1).time)
+            return c;
+    }
+
+    guint lo = 0, hi = num;
+    while(hi - lo > 1)
+    {
+        guint mid = (lo + hi)/2;
+        if(g_array_index(frames, MotoCacheFrame, mid).time <= time + MICRO)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return priv->cursor = lo;
+}
+
+static void moto_cache_node_param_changed(MotoNode *self, MotoParam *param)
+{
+    if(param == moto_node_get_param(self, "playback"))
+        update_time_cut((MotoCacheNode *)self);
+}
+
+static void moto_cache_node_update(MotoNode *self)
+{
+    MotoCacheNodePriv *priv = MOTO_CACHE_NODE_GET_PRIVATE(self);
+
+    gboolean playback;
+    moto_node_get_param_boolean(self, "playback", & playback);
+
+    MotoShape *out = NULL;
+    if(priv->baking || ! playback || ! priv->frames->len)
+    {
+        moto_node_get_param_object(self, "in", (GObject **)& out);
+        priv->decoded = -1;
+    }
+    else
+    {
+        gfloat time;
+        moto_node_get_param_float(self, "time", & time);
+
+        guint i = find_frame(priv, time);
+        MotoCacheFrame *frame = & g_array_index(priv->frames, MotoCacheFrame, i);
+
+        if(frame->shape)
+        {
+            out = frame->shape;
+        }
+        else
+        {
+            out = priv->topology;
+            if((gint)i != priv->decoded)
+            {
+                gfloat *points, *normals;
+                gsize v_num;
+                moto_pointcloud_get_plain_data((MotoPointCloud *)out, & points, & normals, & v_num);
+
+                /* Delta frame needs the previous one, otherwise decoding starts from the key frame. */
+                guint first = i;
+                if(priv->decoded < 0 || (guint)priv->decoded + 1 != i)
+                    while(first > 0 && FRAME_DELTA == g_array_index(priv->frames, MotoCacheFrame, first).kind)
+                        first--;
+
+                for(; first <= i; first++)
+                    decode_frame(& g_array_index(priv->frames, MotoCacheFrame, first), points, normals, v_num);
+                moto_shape_update_bound(out);
+                priv->decoded = i;
+            }
+        }
+    }
+
+    moto_node_set_param_object(self, "out", (GObject *)out);
+
+    ((MotoNodeClass *)cache_node_parent_class)->update(self);
+}
@@ -0,0 +1,73 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_CACHE_NODE_H__
+#define __MOTO_CACHE_NODE_H__
+
+#include "moto-shape-node.h"
+#include "moto-scene-node.h"
+
+G_BEGIN_DECLS
+
+typedef struct _MotoCacheNode MotoCacheNode;
+typedef struct _MotoCacheNodeClass MotoCacheNodeClass;
+
+/* class MotoCacheNode */
+
+/* Stores evaluated frames of the input shape and serves them on playback
+ * so upstream graph isn't evaluated while scrubbing. Frames may be quantized
+ * to 16 bits or delta encoded against the previous frame in 8 bits.
+ * Frames are kept in memory only, there is no on-disk store. */
+
+struct _MotoCacheNode
+{
+    MotoShapeNode parent;
+};
+
+struct _MotoCacheNodeClass
+{
+    MotoShapeNodeClass parent;
+};
+
+GType moto_cache_node_get_type(void);
+
+#define MOTO_TYPE_CACHE_NODE (moto_cache_node_get_type())
+#define MOTO_CACHE_NODE(obj)  (G_TYPE_CHECK_INSTANCE_CAST ((obj), MOTO_TYPE_CACHE_NODE, MotoCacheNode))
+#define MOTO_CACHE_NODE_CLASS(klass)  (G_TYPE_CHECK_CLASS_CAST ((klass), MOTO_TYPE_CACHE_NODE, MotoCacheNodeClass))
+#define MOTO_IS_CACHE_NODE(obj)  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),MOTO_TYPE_CACHE_NODE))
+#define MOTO_IS_CACHE_NODE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),MOTO_TYPE_CACHE_NODE))
+#define MOTO_CACHE_NODE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),MOTO_TYPE_CACHE_NODE, MotoCacheNodeClass))
+
+MotoCacheNode *moto_cache_node_new(const gchar *name);
+
+/* Evaluates scene for each frame from start to end and stores input shape.
+ * Time is driven through the source of "time" param so it must be linked. */
+gboolean moto_cache_node_bake(MotoCacheNode *self, MotoSceneNode *scene,
+        gfloat start, gfloat end, gfloat step);
+void moto_cache_node_clear(MotoCacheNode *self);
+
+guint moto_cache_node_get_frames_num(MotoCacheNode *self);
+/* Memory used by stored frames in bytes. */
+gsize moto_cache_node_get_size(MotoCacheNode *self);
+
+G_END_DECLS
+
+#endif /* __MOTO_CACHE_NODE_H__ */
@@ -22,6 +22,10 @@ struct _MotoCubeNodePriv
     gboolean disposed;
 
     MotoMesh *mesh;
+    /* Topology of mesh. While it's the same only coords are rewritten, normals
+     * of box don't depend on its size. */
+    gint div_x, div_y, div_z;
+    gint signs;
 
     MotoBound *bound;
     gboolean bound_calculated;
@@ -57,6 +61,8 @@ moto_cube_node_init(MotoCubeNode *self)
     priv->disposed = FALSE;
 
     priv->mesh = NULL;
+    priv->div_x = priv->div_y = priv->div_z = 0;
+    priv->signs = 0;
 
     gfloat size[3] = {1, 1, 1};
     gint   divs[3] = {3, 3, 3};
@@ -120,6 +126,11 @@ MotoCubeNode *moto_cube_node_new(const gchar *name)
     return self;
 }
 
+static gint get_signs(gfloat x, gfloat y, gfloat z)
+{
+    return ((x > 0) - (x < 0) + 1) | (((y > 0) - (y < 0) + 1) << 2) | (((z > 0) - (z < 0) + 1) << 4);
+}
+
 #define get_v(x, y, z) \
     ((0 == (x)) ? (y)*(div_z+1) + (z) : ((div_x) == (x)) ? v_num - (div_y+1)*(div_z+1) + (y)*(div_z+1) + (z) : \
         (div_y-1)*(div_z-1) + (div_y+div_z)*2*(x) + ((0 == (y)) ? (z) : ((div_y) == (y)) ? (div_z-1) + 2*(y) + (z) : \
@@ -153,20 +164,19 @@ static void moto_cube_node_update_mesh(MotoCubeNode *self)
     guint e_num = (div_x + div_y)*2 * (div_z + 1) + (div_x + div_y)*2*div_z + div_x*(div_y-1)*2 + div_y*(div_x-1)*2;
     guint f_num = div_x*div_y*2 + div_x*div_z*2 + div_y*div_z*2;
 
-    gboolean new_mesh = FALSE;
-    if(priv->mesh)
+    gint signs = get_signs(size_x, size_y, size_z);
+
+    gboolean new_mesh = ( ! priv->mesh) || div_x != priv->div_x || div_y != priv->div_y ||
+                        div_z != priv->div_z || signs != priv->signs;
+    if(new_mesh)
     {
-        if(v_num != priv->mesh->v_num || e_num != priv->mesh->e_num || f_num != priv->mesh->f_num)
-        {
+        if(priv->mesh)
             g_object_unref(priv->mesh);
-            priv->mesh = moto_mesh_new(v_num, e_num, f_num, f_num*4);
-            new_mesh = TRUE;
-        }
-    }
-    else
-    {
         priv->mesh = moto_mesh_new(v_num, e_num, f_num, f_num*4);
-        new_mesh = TRUE;
+        priv->div_x = div_x;
+        priv->div_y = div_y;
+        priv->div_z = div_z;
+        priv->signs = signs;
     }
 
     MotoMesh *mesh = priv->mesh;
@@ -381,7 +391,10 @@ static void moto_cube_node_update_mesh(MotoCubeNode *self)
     }
 
     priv->bound_calculated = FALSE;
-    moto_shape_prepare((MotoShape*)mesh);
+    if(new_mesh)
+        moto_shape_prepare((MotoShape*)mesh);
+    else
+        moto_mesh_update_coords(mesh, FALSE);
     moto_node_set_param_object(node, "out", (GObject*)mesh);
 }
 #undef get_v
@@ -20,6 +20,10 @@ static GObjectClass *cylinder_node_parent_class = NULL;
 struct _MotoCylinderNodePriv
 {
     MotoMesh *mesh;
+    /* Topology of mesh. While it's the same coords are rewritten in place. */
+    gint rows, cols;
+    gboolean cap0, cap1;
+    gint cap0_divs, cap1_divs;
 };
 
 static void
@@ -46,6 +50,9 @@ moto_cylinder_node_init(MotoCylinderNode *self)
     self->priv = g_slice_new(MotoCylinderNodePriv);
 
     self->priv->mesh = NULL;
+    self->priv->rows = self->priv->cols = 0;
+    self->priv->cap0 = self->priv->cap1 = FALSE;
+    self->priv->cap0_divs = self->priv->cap1_divs = 0;
 
     gfloat radius[4] = {1, 1, 1, 1};
     gint divs[2] = {3, 10};
@@ -296,20 +303,21 @@ static void moto_cylinder_node_update_mesh(MotoCylinderNode *self)
         }
     }
 
-    gboolean new_mesh = FALSE;
-    if(self->priv->mesh)
-    {
-        if(v_num != self->priv->mesh->v_num || e_num != self->priv->mesh->e_num || f_num != self->priv->mesh->f_num)
-        {
-            g_object_unref(self->priv->mesh);
-            self->priv->mesh = moto_mesh_new(v_num, e_num, f_num, f_v_num);
-            new_mesh = TRUE;
-        }
-    }
-    else
+    MotoCylinderNodePriv *priv = self->priv;
+    gboolean new_mesh = ( ! priv->mesh) || rows != priv->rows || cols != priv->cols ||
+                        cap0 != priv->cap0 || cap1 != priv->cap1 ||
+                        cap0_divs != priv->cap0_divs || cap1_divs != priv->cap1_divs;
+    if(new_mesh)
     {
-        self->priv->mesh = moto_mesh_new(v_num, e_num, f_num, f_v_num);
-        new_mesh = TRUE;
+        if(priv->mesh)
+            g_object_unref(priv->mesh);
+        priv->mesh = moto_mesh_new(v_num, e_num, f_num, f_v_num);
+        priv->rows = rows;
+        priv->cols = cols;
+        priv->cap0 = cap0;
+        priv->cap1 = cap1;
+        priv->cap0_divs = cap0_divs;
+        priv->cap1_divs = cap1_divs;
     }
 
     MotoMesh *mesh = self->priv->mesh;
@@ -630,7 +638,11 @@ static void moto_cylinder_node_update_mesh(MotoCylinderNode *self)
         }
     }
 
-    if(!moto_shape_prepare((MotoShape*)mesh))
+    /* Faces are set again since cap verts are placed while they are built,
+     * but connectivity and tesselation are kept. */
+    if( ! new_mesh)
+        moto_mesh_update_coords(mesh, TRUE);
+    else if(!moto_shape_prepare((MotoShape*)mesh))
     {
         moto_error("Error while preparing mesh of MotoCylinderNode\n");
     }
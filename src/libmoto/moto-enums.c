@@ -120,3 +120,22 @@ GType moto_array_mode_get_type(void)
     }
     return type;
 }
+
+/* MotoKeyInterp */
+
+GType moto_key_interp_get_type(void)
+{
+    static GType type = 0;
+    if(0 == type)
+    {
+        static GEnumValue values[] = {
+            {MOTO_KEY_INTERP_CONSTANT, "KEY_INTERP_CONSTANT", "Constant"},
+            {MOTO_KEY_INTERP_LINEAR,   "KEY_INTERP_LINEAR",   "Linear"},
+            {MOTO_KEY_INTERP_BEZIER,   "KEY_INTERP_BEZIER",   "Bezier"},
+            {MOTO_KEY_INTERP_HERMITE,  "KEY_INTERP_HERMITE",  "Hermite"},
+            {0, NULL, NULL},
+        };
+        type = g_enum_register_static("MotoKeyInterp", values);
+    }
+    return type;
+}
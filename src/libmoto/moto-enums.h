@@ -96,6 +96,18 @@ GType moto_array_mode_get_type(void);
 
 #define MOTO_TYPE_ARRAY_MODE (moto_array_mode_get_type())
 
+typedef enum _MotoKeyInterp
+{
+    MOTO_KEY_INTERP_CONSTANT,
+    MOTO_KEY_INTERP_LINEAR,
+    MOTO_KEY_INTERP_BEZIER,
+    MOTO_KEY_INTERP_HERMITE,
+} MotoKeyInterp;
+
+GType moto_key_interp_get_type(void);
+
+#define MOTO_TYPE_KEY_INTERP (moto_key_interp_get_type())
+
 G_END_DECLS
 
 #endif /* __MOTO_ENUMS__ */
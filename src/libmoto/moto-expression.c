@@ -0,0 +1,637 @@
+#include <math.h>
+#include <string.h>
+
+#include "libmotoutil/numdef.h"
+
+#include "moto-expression.h"
+
+/* Stack bytecode */
+
+typedef double (*MotoExpressionFunc1)(double);
+typedef double (*MotoExpressionFunc2)(double, double);
+
+typedef enum
+{
+    OP_CONST,
+    OP_VALUE,
+    OP_SOURCE,
+    OP_TIME,
+    OP_NEG,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_POW,
+    OP_INDEX,
+    OP_PACK,
+    OP_FUNC1,
+    OP_FUNC2
+} OpCode;
+
+typedef struct _Op Op;
+
+struct _Op
+{
+    OpCode code;
+    guint arg;
+    gfloat c;
+    MotoExpressionFunc1 func1;
+    MotoExpressionFunc2 func2;
+    gboolean is_int; /* Constant is int or function gives int of ints. */
+};
+
+struct _MotoExpression
+{
+    Op *ops;
+    guint ops_num;
+    guint stack_size;
+    guint vars;
+};
+
+/* functions */
+
+static double radians(double x)
+{
+    return x*RAD_PER_DEG;
+}
+
+static double degrees(double x)
+{
+    return x*DEG_PER_RAD;
+}
+
+typedef struct _Func Func;
+
+struct _Func
+{
+    const gchar *name;
+    gint args_num; /* -1 means two or more arguments folded by func2 */
+    MotoExpressionFunc1 func1;
+    MotoExpressionFunc2 func2;
+    gboolean is_int; /* Result of ints is int as in Python. */
+};
+
+static const Func funcs[] =
+{
+    {"sin",     1, sin,     NULL},
+    {"cos",     1, cos,     NULL},
+    {"tan",     1, tan,     NULL},
+    {"asin",    1, asin,    NULL},
+    {"acos",    1, acos,    NULL},
+    {"atan",    1, atan,    NULL},
+    {"sinh",    1, sinh,    NULL},
+    {"cosh",    1, cosh,    NULL},
+    {"tanh",    1, tanh,    NULL},
+    {"sqrt",    1, sqrt,    NULL},
+    {"exp",     1, exp,     NULL},
+    {"log",     1, log,     NULL},
+    {"log10",   1, log10,   NULL},
+    {"abs",     1, fabs,    NULL, TRUE},
+    {"fabs",    1, fabs,    NULL},
+    {"floor",   1, floor,   NULL},
+    {"ceil",    1, ceil,    NULL},
+    {"radians", 1, radians, NULL},
+    {"degrees", 1, degrees, NULL},
+    {"pow",     2, NULL,    pow},
+    {"atan2",   2, NULL,    atan2},
+    {"fmod",    2, NULL,    fmod},
+    {"hypot",   2, NULL,    hypot},
+    {"min",    -1, NULL,    fmin, TRUE},
+    {"max",    -1, NULL,    fmax, TRUE},
+    {NULL,      0, NULL,    NULL}
+};
+
+static const Func *find_func(const gchar *name)
+{
+    const Func *f;
+    for(f = funcs; f->name; f++)
+        if(0 == strcmp(f->name, name))
+            return f;
+    return NULL;
+}
+
+/* evaluation */
+
+static gboolean apply_unary(MotoExpressionValue *a, const Op *op)
+{
+    guint i;
+    for(i = 0; i < a->size; i++)
+    {
+        if(OP_NEG == op->code)
+            a->v[i] = -a->v[i];
+        else
+            a->v[i] = (gfloat)op->func1(a->v[i]);
+    }
+    if(OP_NEG != op->code)
+        a->is_int = a->is_int && op->is_int;
+    return TRUE;
+}
+
+static gboolean apply_binary(MotoExpressionValue *a, const MotoExpressionValue *b, const Op *op)
+{
+    if(a->size != b->size && a->size != 1 && b->size != 1)
+        return FALSE;
+
+    guint size = max(a->size, b->size);
+    gboolean is_int = a->is_int && b->is_int;
+    if(OP_FUNC2 == op->code)
+        is_int = is_int && op->is_int;
+
+    guint i;
+    for(i = 0; i < size; i++)
+    {
+        gfloat x = a->v[(1 == a->size) ? 0 : i];
+        gfloat y = b->v[(1 == b->size) ? 0 : i];
+        gfloat r;
+
+        switch(op->code)
+        {
+            case OP_ADD: r = x + y; break;
+            case OP_SUB: r = x - y; break;
+            case OP_MUL: r = x * y; break;
+            case OP_DIV:
+                if(0 == y)
+                    return FALSE;
+                r = (a->is_int && b->is_int) ? floor((gdouble)x / y) : x / y;
+            break;
+            case OP_MOD:
+                if(0 == y)
+                    return FALSE;
+                /* Result has the sign of divisor as in Python. */
+                r = fmod(x, y);
+                if(r != 0 && ((r < 0) != (y < 0)))
+                    r += y;
+            break;
+            case OP_POW:
+                /* Negative power of int is float. */
+                is_int = is_int && y >= 0;
+                r = pow(x, y);
+            break;
+            case OP_FUNC2: r = (gfloat)op->func2(x, y); break;
+            default:
+                return FALSE;
+        }
+
+        a->v[i] = r;
+    }
+    a->size = size;
+    a->is_int = is_int;
+
+    return TRUE;
+}
+
+gboolean moto_expression_eval(MotoExpression *self,
+        const MotoExpressionContext *ctx, MotoExpressionValue *result)
+{
+    MotoExpressionValue stack[self->stack_size];
+    gint top = -1;
+
+    guint i, j;
+    for(i = 0; i < self->ops_num; i++)
+    {
+        const Op *op = self->ops + i;
+        switch(op->code)
+        {
+            case OP_CONST:
+                ++top;
+                stack[top].size = 1;
+                stack[top].v[0] = op->c;
+                stack[top].is_int = op->is_int;
+            break;
+            case OP_VALUE:
+                stack[++top] = ctx->value;
+            break;
+            case OP_SOURCE:
+                if( ! ctx->has_source)
+                    return FALSE;
+                stack[++top] = ctx->source;
+            break;
+            case OP_TIME:
+                ++top;
+                stack[top].size = 1;
+                stack[top].v[0] = ctx->time;
+                stack[top].is_int = FALSE;
+            break;
+            case OP_NEG:
+            case OP_FUNC1:
+                apply_unary(stack + top, op);
+            break;
+            case OP_INDEX:
+                if(op->arg >= stack[top].size)
+                    return FALSE;
+                stack[top].v[0] = stack[top].v[op->arg];
+                stack[top].size = 1;
+            break;
+            case OP_PACK:
+            {
+                MotoExpressionValue *items = stack + top - op->arg + 1;
+                for(j = 0; j < op->arg; j++)
+                {
+                    if(items[j].size != 1)
+                        return FALSE;
+                    items[0].v[j] = items[j].v[0];
+                    items[0].is_int = items[0].is_int && items[j].is_int;
+                }
+                items[0].size = op->arg;
+                top -= op->arg - 1;
+            }
+            break;
+            default:
+                if( ! apply_binary(stack + top - 1, stack + top, op))
+                    return FALSE;
+                --top;
+            break;
+        }
+    }
+
+    if(0 != top)
+        return FALSE;
+
+    *result = stack[0];
+    return TRUE;
+}
+
+/* parsing */
+
+typedef struct _Parser Parser;
+
+struct _Parser
+{
+    const gchar *pos;
+    GArray *ops;
+    gint depth;
+    gint max_depth;
+    guint vars;
+};
+
+static gboolean parse_expr(Parser *p);
+static gboolean parse_unary(Parser *p);
+
+static void skip_spaces(Parser *p)
+{
+    while(g_ascii_isspace(*p->pos))
+        p->pos++;
+}
+
+static gboolean accept(Parser *p, const gchar *token)
+{
+    skip_spaces(p);
+    gsize len = strlen(token);
+    if(strncmp(p->pos, token, len))
+        return FALSE;
+    p->pos += len;
+    return TRUE;
+}
+
+static Op *last_op(Parser *p, guint back)
+{
+    if(p->ops->len < back)
+        return NULL;
+    return & g_array_index(p->ops, Op, p->ops->len - back);
+}
+
+static gboolean is_const(Op *op)
+{
+    return op && OP_CONST == op->code;
+}
+
+static void emit(Parser *p, Op *op, gint pops)
+{
+    /* Folding operations on constants. */
+    if(OP_NEG == op->code || OP_FUNC1 == op->code)
+    {
+        Op *a = last_op(p, 1);
+        if(is_const(a))
+        {
+            MotoExpressionValue va = {1, {a->c}, a->is_int};
+            apply_unary(& va, op);
+            a->c = va.v[0];
+            a->is_int = va.is_int;
+            return;
+        }
+    }
+    else if(2 == pops && OP_PACK != op->code)
+    {
+        Op *a = last_op(p, 2);
+        Op *b = last_op(p, 1);
+        MotoExpressionValue va, vb;
+        if(is_const(a) && is_const(b))
+        {
+            va.size = 1; va.v[0] = a->c; va.is_int = a->is_int;
+            vb.size = 1; vb.v[0] = b->c; vb.is_int = b->is_int;
+            if(apply_binary(& va, & vb, op))
+            {
+                a->c = va.v[0];
+                a->is_int = va.is_int;
+                g_array_set_size(p->ops, p->ops->len - 1);
+                p->depth--;
+                return;
+            }
+        }
+    }
+
+    g_array_append_val(p->ops, *op);
+    p->depth += 1 - pops;
+    p->max_depth = max(p->max_depth, p->depth);
+}
+
+static void emit_simple(Parser *p, OpCode code, gint pops)
+{
+    Op op = {code, 0, 0, NULL, NULL};
+    emit(p, & op, pops);
+}
+
+static gboolean parse_name(Parser *p, gchar *name, gsize size)
+{
+    skip_spaces(p);
+    if( ! g_ascii_isalpha(*p->pos) && '_' != *p->pos)
+        return FALSE;
+
+    gsize len = 0;
+    while(g_ascii_isalnum(*p->pos) || '_' == *p->pos || '.' == *p->pos)
+    {
+        if(len + 1 >= size)
+            return FALSE;
+        name[len++] = *p->pos++;
+    }
+    name[len] = '\0';
+
+    /* Functions and constants from Python module "math" are the same. */
+    if(g_str_has_prefix(name, "math."))
+        memmove(name, name + 5, len - 4);
+
+    return NULL == strchr(name, '.');
+}
+
+static gboolean parse_call(Parser *p, const Func *f)
+{
+    gint args_num = 0;
+    if( ! accept(p, ")"))
+    {
+        do
+        {
+            if( ! parse_expr(p))
+                return FALSE;
+            ++args_num;
+
+            if(-1 == f->args_num && args_num > 1)
+            {
+                Op op = {OP_FUNC2, 0, 0, NULL, f->func2, f->is_int};
+                emit(p, & op, 2);
+            }
+        }
+        while(accept(p, ","));
+
+        if( ! accept(p, ")"))
+            return FALSE;
+    }
+
+    if(-1 == f->args_num)
+        return args_num > 1;
+    if(args_num != f->args_num)
+        return FALSE;
+
+    Op op = {(1 == args_num) ? OP_FUNC1 : OP_FUNC2, 0, 0, f->func1, f->func2, f->is_int};
+    emit(p, & op, args_num);
+    return TRUE;
+}
+
+static gboolean parse_primary(Parser *p)
+{
+    skip_spaces(p);
+
+    if(g_ascii_isdigit(*p->pos) || ('.' == *p->pos && g_ascii_isdigit(p->pos[1])))
+    {
+        gchar *end;
+        Op op = {OP_CONST, 0, (gfloat)g_ascii_strtod(p->pos, & end), NULL, NULL};
+        if(end == p->pos)
+            return FALSE;
+
+        /* Literal of digits only is int. Octal, hex, long and complex ones are left to Python. */
+        gsize digits = strspn(p->pos, "0123456789");
+        op.is_int = digits == (gsize)(end - p->pos);
+        if(g_ascii_isalpha(*end) || ('0' == *p->pos && (op.is_int ? digits > 1 : 'x' == g_ascii_tolower(p->pos[1]))))
+            return FALSE;
+        p->pos = end;
+        emit(p, & op, 0);
+        return TRUE;
+    }
+
+    if(accept(p, "("))
+    {
+        if( ! parse_expr(p))
+            return FALSE;
+
+        /* Tuple of scalars becomes vector. */
+        guint items_num = 1;
+        gboolean tuple = FALSE;
+        while(accept(p, ","))
+        {
+            tuple = TRUE;
+            if(accept(p, ")"))
+                goto close;
+            if( ! parse_expr(p) || ++items_num > MOTO_EXPRESSION_MAX_SIZE)
+                return FALSE;
+        }
+        if( ! accept(p, ")"))
+            return FALSE;
+close:
+        if(tuple)
+        {
+            Op op = {OP_PACK, items_num, 0, NULL, NULL};
+            emit(p, & op, items_num);
+        }
+        return TRUE;
+    }
+
+    gchar name[32];
+    if( ! parse_name(p, name, sizeof(name)))
+        return FALSE;
+
+    if(accept(p, "("))
+    {
+        const Func *f = find_func(name);
+        if( ! f)
+            return FALSE;
+        return parse_call(p, f);
+    }
+
+    if(0 == strcmp(name, "v"))
+    {
+        p->vars |= MOTO_EXPRESSION_VAR_VALUE;
+        emit_simple(p, OP_VALUE, 0);
+    }
+    else if(0 == strcmp(name, "s"))
+    {
+        p->vars |= MOTO_EXPRESSION_VAR_SOURCE;
+        emit_simple(p, OP_SOURCE, 0);
+    }
+    else if(0 == strcmp(name, "t") || 0 == strcmp(name, "time"))
+    {
+        p->vars |= MOTO_EXPRESSION_VAR_TIME;
+        emit_simple(p, OP_TIME, 0);
+    }
+    else if(0 == strcmp(name, "pi"))
+    {
+        Op op = {OP_CONST, 0, (gfloat)PI, NULL, NULL};
+        emit(p, & op, 0);
+    }
+    else if(0 == strcmp(name, "e"))
+    {
+        Op op = {OP_CONST, 0, (gfloat)G_E, NULL, NULL};
+        emit(p, & op, 0);
+    }
+    else
+        return FALSE; /* Unknown name, let Python deal with it. */
+
+    return TRUE;
+}
+
+static gboolean parse_postfix(Parser *p)
+{
+    if( ! parse_primary(p))
+        return FALSE;
+
+    while(accept(p, "["))
+    {
+        skip_spaces(p);
+        gchar *end;
+        guint64 index = g_ascii_strtoull(p->pos, & end, 10);
+        if(end == p->pos || index >= MOTO_EXPRESSION_MAX_SIZE)
+            return FALSE;
+        p->pos = end;
+
+        if( ! accept(p, "]"))
+            return FALSE;
+
+        Op op = {OP_INDEX, (guint)index, 0, NULL, NULL};
+        emit(p, & op, 1);
+    }
+
+    return TRUE;
+}
+
+static gboolean parse_power(Parser *p)
+{
+    if( ! parse_postfix(p))
+        return FALSE;
+
+    /* "**" is right associative and binds tighter than unary minus on the left. */
+    if(accept(p, "**"))
+    {
+        if( ! parse_unary(p))
+            return FALSE;
+        emit_simple(p, OP_POW, 2);
+    }
+
+    return TRUE;
+}
+
+static gboolean parse_unary(Parser *p)
+{
+    if(accept(p, "-"))
+    {
+        if( ! parse_unary(p))
+            return FALSE;
+        emit_simple(p, OP_NEG, 1);
+        return TRUE;
+    }
+    if(accept(p, "+"))
+        return parse_unary(p);
+
+    return parse_power(p);
+}
+
+static gboolean parse_term(Parser *p)
+{
+    if( ! parse_unary(p))
+        return FALSE;
+
+    while(TRUE)
+    {
+        OpCode code;
+        skip_spaces(p);
+        if('*' == p->pos[0] && '*' != p->pos[1])
+            code = OP_MUL;
+        else if('/' == p->pos[0] && '/' != p->pos[1])
+            code = OP_DIV;
+        else if('%' == p->pos[0])
+            code = OP_MOD;
+        else
+            break;
+
+        p->pos++;
+        if( ! parse_unary(p))
+            return FALSE;
+        emit_simple(p, code, 2);
+    }
+
+    return TRUE;
+}
+
+static gboolean parse_expr(Parser *p)
+{
+    if( ! parse_term(p))
+        return FALSE;
+
+    while(TRUE)
+    {
+        OpCode code;
+        if(accept(p, "+"))
+            code = OP_ADD;
+        else if(accept(p, "-"))
+            code = OP_SUB;
+        else
+            break;
+
+        if( ! parse_term(p))
+            return FALSE;
+        emit_simple(p, code, 2);
+    }
+
+    return TRUE;
+}
+
+/* class MotoExpression */
+
+MotoExpression *moto_expression_new(const gchar *body)
+{
+    /* Multi-line bodies are Python functions. */
+    if( ! body || strchr(body, '\n'))
+        return NULL;
+
+    Parser p;
+    p.pos = body;
+    p.ops = g_array_new(FALSE, FALSE, sizeof(Op));
+    p.depth = 0;
+    p.max_depth = 0;
+    p.vars = 0;
+
+    gboolean ok = parse_expr(& p);
+    skip_spaces(& p);
+    if( ! ok || '\0' != *p.pos || 1 != p.depth)
+    {
+        g_array_free(p.ops, TRUE);
+        return NULL;
+    }
+
+    MotoExpression *self = g_slice_new(MotoExpression);
+    self->ops_num    = p.ops->len;
+    self->ops        = (Op *)g_array_free(p.ops, FALSE);
+    self->stack_size = p.max_depth;
+    self->vars       = p.vars;
+
+    return self;
+}
+
+void moto_expression_free(MotoExpression *self)
+{
+    g_free(self->ops);
+    g_slice_free(MotoExpression, self);
+}
+
+guint moto_expression_get_vars(MotoExpression *self)
+{
+    return self->vars;
+}
@@ -0,0 +1,74 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_EXPRESSION_H__
+#define __MOTO_EXPRESSION_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Native compiled expressions.
+ * Handles arithmetic/trigonometric subset of param expressions without calling Python.
+ * Expression is parsed once into stack bytecode and evaluated on gfloat vectors.
+ * Evaluation doesn't touch any global state so it may be done from several threads. */
+
+#define MOTO_EXPRESSION_MAX_SIZE 4
+
+typedef struct _MotoExpression MotoExpression;
+typedef struct _MotoExpressionValue MotoExpressionValue;
+typedef struct _MotoExpressionContext MotoExpressionContext;
+
+typedef enum
+{
+    MOTO_EXPRESSION_VAR_VALUE  = 1 << 0, /* v */
+    MOTO_EXPRESSION_VAR_SOURCE = 1 << 1, /* s */
+    MOTO_EXPRESSION_VAR_TIME   = 1 << 2  /* t, time */
+} MotoExpressionVar;
+
+struct _MotoExpressionValue
+{
+    guint size;
+    gfloat v[MOTO_EXPRESSION_MAX_SIZE];
+    gboolean is_int; /* As in Python 2, "/" of ints floors. */
+};
+
+struct _MotoExpressionContext
+{
+    MotoExpressionValue value;
+    MotoExpressionValue source;
+    gboolean has_source;
+    gfloat time;
+};
+
+/* Returns NULL if body contains constructs not supported natively. */
+MotoExpression *moto_expression_new(const gchar *body);
+void moto_expression_free(MotoExpression *self);
+
+/* Bitwise OR of MotoExpressionVar used by expression. */
+guint moto_expression_get_vars(MotoExpression *self);
+
+gboolean moto_expression_eval(MotoExpression *self,
+        const MotoExpressionContext *ctx, MotoExpressionValue *result);
+
+G_END_DECLS
+
+#endif /* __MOTO_EXPRESSION_H__ */
@@ -1,4 +1,5 @@
 #include <math.h>
+#include <string.h>
 
 #include "moto-types.h"
 #include "moto-enums.h"
@@ -16,12 +17,47 @@ static MotoMesh *moto_extrude_node_perform(MotoOpNode *self, MotoShape *in, gboo
 
 /* class MotoExtrudeNode */
 
+#define MOTO_EXTRUDE_NODE_GET_PRIVATE(obj) \
+    G_TYPE_INSTANCE_GET_PRIVATE(obj, MOTO_TYPE_EXTRUDE_NODE, MotoExtrudeNodePriv)
+
 static GObjectClass *extrude_node_parent_class = NULL;
 
+/* Topology of last result. While it's the same only positions are updated. */
+typedef struct _MotoExtrudeNodePriv
+{
+    MotoMesh *mesh;
+    guint in_stamp;
+    guint sections;
+    MotoBitmask *faces;
+} MotoExtrudeNodePriv;
+
+static void forget_topology(MotoExtrudeNodePriv *priv)
+{
+    if(priv->mesh)
+        g_object_unref(priv->mesh);
+    priv->mesh = NULL;
+
+    if(priv->faces)
+        moto_bitmask_free(priv->faces);
+    priv->faces = NULL;
+}
+
+static void
+moto_extrude_node_dispose(GObject *obj)
+{
+    forget_topology(MOTO_EXTRUDE_NODE_GET_PRIVATE(obj));
+
+    extrude_node_parent_class->dispose(obj);
+}
+
 static void
 moto_extrude_node_init(MotoExtrudeNode *self)
 {
     MotoNode *node = (MotoNode *)self;
+    MotoExtrudeNodePriv *priv = MOTO_EXTRUDE_NODE_GET_PRIVATE(self);
+
+    priv->mesh  = NULL;
+    priv->faces = NULL;
 
     gfloat lt[] = {0, 0, 0.1};
     gfloat lr[] = {0, 0, 0};
@@ -44,8 +80,14 @@ moto_extrude_node_init(MotoExtrudeNode *self)
 static void
 moto_extrude_node_class_init(MotoExtrudeNodeClass *klass)
 {
+    g_type_class_add_private(klass, sizeof(MotoExtrudeNodePriv));
+
     extrude_node_parent_class = (GObjectClass *)g_type_class_peek_parent(klass);
 
+    GObjectClass *goclass = G_OBJECT_CLASS(klass);
+    goclass->dispose = moto_extrude_node_dispose;
+
+    /* Output isn't cached since it's changed in place when only offsets change. */
     MotoOpNodeClass *moclass = (MotoOpNodeClass *)klass;
     moclass->perform = moto_extrude_node_perform;
 }
@@ -64,6 +106,31 @@ MotoExtrudeNode *moto_extrude_node_new(const gchar *name)
     return self;
 }
 
+static gboolean is_topology_the_same(MotoExtrudeNodePriv *priv, MotoMesh *in,
+        MotoShapeSelection *selection, guint sections)
+{
+    if( ! priv->mesh || ! selection || priv->sections != sections ||
+        priv->in_stamp != moto_shape_get_stamp((MotoShape *)in))
+        return FALSE;
+
+    MotoBitmask *faces = selection->faces;
+    return faces->bits_num == priv->faces->bits_num &&
+        ! memcmp(faces->bits, priv->faces->bits, (faces->bits_num + 31)/32*sizeof(guint32));
+}
+
+static void remember_topology(MotoExtrudeNodePriv *priv, MotoMesh *mesh, MotoMesh *in,
+        MotoShapeSelection *selection, guint sections)
+{
+    forget_topology(priv);
+    if( ! mesh || ! selection)
+        return;
+
+    priv->mesh      = g_object_ref(mesh);
+    priv->in_stamp  = moto_shape_get_stamp((MotoShape *)in);
+    priv->sections  = sections;
+    priv->faces     = moto_bitmask_new_copy(selection->faces);
+}
+
 static MotoMesh *moto_extrude_node_perform(MotoOpNode *self, MotoShape *in, gboolean *the_same)
 {
     *the_same = FALSE;
@@ -96,17 +163,32 @@ static MotoMesh *moto_extrude_node_perform(MotoOpNode *self, MotoShape *in, gboo
 
     MotoShapeSelection *selection = moto_op_node_get_selection(self);
 
+    MotoExtrudeNodePriv *priv = MOTO_EXTRUDE_NODE_GET_PRIVATE(self);
     MotoMesh *mesh = NULL;
     switch(mode)
     {
         case MOTO_EXTRUDE_MODE_VERTS:
+            forget_topology(priv);
             mesh = moto_mesh_extrude_verts(in_mesh, selection, sections, ltz);
         break;
         case MOTO_EXTRUDE_MODE_EDGES:
             ;// mesh = moto_mesh_extrude_edges(in_mesh, selection, sections, length);
         break;
         case MOTO_EXTRUDE_MODE_FACES:
+            if(is_topology_the_same(priv, in_mesh, selection, sections) &&
+               moto_mesh_extrude_faces_update(priv->mesh, in_mesh, selection, sections,
+                    ltx, lty, ltz, lrx, lry, lrz, lsx, lsy, lsz))
+            {
+                /* Op node keeps its reference only while mesh is its output. */
+                GObject *out = NULL;
+                moto_node_get_param_object(node, "out", & out);
+                *the_same = (out == (GObject *)priv->mesh);
+                return (*the_same) ? priv->mesh : g_object_ref(priv->mesh);
+            }
+
             mesh = moto_mesh_extrude_faces(in_mesh, selection, sections, ltx, lty, ltz, lrx, lry, lrz, lsx, lsy, lsz);
+            remember_topology(priv, mesh, in_mesh, selection, sections);
+            return mesh;
         break;
         case MOTO_EXTRUDE_MODE_REGION:
             ; // mesh = moto_mesh_extrude_region(in_mesh, selection, sections, length);
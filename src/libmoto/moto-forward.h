@@ -37,6 +37,10 @@ typedef struct _MotoSceneNodePriv MotoSceneNodePriv;
 typedef struct _MotoObjectNode MotoObjectNode;
 typedef struct _MotoObjectNodeClass MotoObjectNodeClass;
 
+typedef struct _MotoTimeNode MotoTimeNode;
+typedef struct _MotoTimeNodeClass MotoTimeNodeClass;
+typedef struct _MotoTimeNodePriv MotoTimeNodePriv;
+
 typedef struct _MotoNode MotoNode;
 typedef struct _MotoNodeClass MotoNodeClass;
 typedef void (*MotoNodeUpdateMethod)(MotoNode *self);
@@ -46,6 +50,7 @@ typedef struct _MotoVariationClass MotoVariationClass;
 
 typedef struct _MotoParam MotoParam;
 typedef struct _MotoParamClass MotoParamClass;
+typedef void (*MotoNodeParamChangedMethod)(MotoNode *self, MotoParam *param);
 
 typedef struct _MotoManipulator MotoManipulator;
 typedef struct _MotoManipulatorClass MotoManipulatorClass;
@@ -56,6 +61,8 @@ typedef struct _MotoHandleClass MotoHandleClass;
 typedef struct _MotoLibrary MotoLibrary;
 typedef struct _MotoLibraryClass MotoLibraryClass;
 
+typedef struct _MotoShapeCache MotoShapeCache;
+
 G_END_DECLS
 
 #endif /* __MOTO_FORWARD_H__ */
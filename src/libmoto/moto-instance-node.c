@@ -0,0 +1,621 @@
+#include <string.h>
+#include <math.h>
+
+#include "libmotoutil/moto-gl.h"
+#include "libmotoutil/xform.h"
+#include "libmotoutil/numdef.h"
+
+#include "moto-types.h"
+#include "moto-messager.h"
+#include "moto-point-cloud.h"
+#include "moto-mesh.h"
+#include "moto-scene-node.h"
+#include "moto-instance-node.h"
+
+/* forwards */
+
+static void moto_instance_node_update(MotoNode *self);
+static void moto_instance_node_calc_bound(MotoObjectNode *self, MotoBound *bound);
+static void moto_instance_node_draw_shape(MotoObjectNode *self, MotoShapeNode *shape);
+static gboolean moto_instance_node_intersect(MotoObjectNode *self, MotoRay *ray,
+    gfloat extent, gfloat *dist);
+static gboolean moto_instance_node_button_press(MotoObjectNode *self,
+    gint x, gint y, gint width, gint height, MotoRay *ray,
+    MotoTransformInfo *tinfo);
+
+/* class MotoInstanceNode */
+
+/* Rows of affine transform and color, 64 bytes per instance.
+ * The same layout is uploaded into buffer for instanced drawing. */
+typedef struct _MotoInstance
+{
+    gfloat rows[12];
+    gfloat color[4];
+} MotoInstance;
+
+typedef struct _MotoInstanceNodePriv MotoInstanceNodePriv;
+
+#define MOTO_INSTANCE_NODE_GET_PRIVATE(obj) \
+    G_TYPE_INSTANCE_GET_PRIVATE(obj, MOTO_TYPE_INSTANCE_NODE, MotoInstanceNodePriv)
+
+static GObjectClass *instance_node_parent_class = NULL;
+
+struct _MotoInstanceNodePriv
+{
+    guint num;
+    MotoInstance *instances;
+
+    GLuint ibuf;
+    gboolean ibuf_dirty;
+
+    gint picked;
+};
+
+static void
+moto_instance_node_dispose(GObject *obj)
+{
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(obj);
+
+    if(priv->ibuf && moto_gl_is_vbo_supported())
+        glDeleteBuffersARB(1, & priv->ibuf);
+    priv->ibuf = 0;
+
+    instance_node_parent_class->dispose(obj);
+}
+
+static void
+moto_instance_node_finalize(GObject *obj)
+{
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(obj);
+
+    g_free(priv->instances);
+
+    instance_node_parent_class->finalize(obj);
+}
+
+static void
+moto_instance_node_init(MotoInstanceNode *self)
+{
+    MotoNode *node = (MotoNode *)self;
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(self);
+
+    priv->num        = 0;
+    priv->instances  = NULL;
+    priv->ibuf       = 0;
+    priv->ibuf_dirty = TRUE;
+    priv->picked     = -1;
+
+    moto_node_add_params(node,
+            "points", "Scatter Points", MOTO_TYPE_SHAPE, MOTO_PARAM_MODE_IN,    NULL, NULL, "Instances",
+            "align",  "Align to Normals", MOTO_TYPE_BOOL,  MOTO_PARAM_MODE_INOUT, TRUE, NULL, "Instances",
+            "scale",  "Instance Scale", MOTO_TYPE_FLOAT, MOTO_PARAM_MODE_INOUT, 1.0f, NULL, "Instances",
+            NULL);
+}
+
+static void
+moto_instance_node_class_init(MotoInstanceNodeClass *klass)
+{
+    g_type_class_add_private(klass, sizeof(MotoInstanceNodePriv));
+
+    instance_node_parent_class = (GObjectClass *)g_type_class_peek_parent(klass);
+
+    GObjectClass *goclass = G_OBJECT_CLASS(klass);
+    MotoNodeClass *nclass = (MotoNodeClass *)klass;
+    MotoObjectNodeClass *oclass = (MotoObjectNodeClass *)klass;
+
+    goclass->dispose    = moto_instance_node_dispose;
+    goclass->finalize   = moto_instance_node_finalize;
+
+    nclass->update = moto_instance_node_update;
+
+    oclass->calc_bound   = moto_instance_node_calc_bound;
+    oclass->draw_shape   = moto_instance_node_draw_shape;
+    oclass->intersect    = moto_instance_node_intersect;
+    oclass->button_press = moto_instance_node_button_press;
+}
+
+G_DEFINE_TYPE(MotoInstanceNode, moto_instance_node, MOTO_TYPE_OBJECT_NODE);
+
+/* Methods of class MotoInstanceNode */
+
+MotoInstanceNode *moto_instance_node_new(const gchar *name)
+{
+    MotoInstanceNode *self = (MotoInstanceNode *)g_object_new(MOTO_TYPE_INSTANCE_NODE, NULL);
+    MotoNode *node = (MotoNode *)self;
+
+    moto_node_set_name(node, name);
+
+    return self;
+}
+
+static void instance_set_identity(MotoInstance *inst)
+{
+    memset(inst, 0, sizeof(MotoInstance));
+    inst->rows[0] = inst->rows[5] = inst->rows[10] = 1;
+    inst->color[0] = inst->color[1] = inst->color[2] = inst->color[3] = 1;
+}
+
+/* Rows of affine part from column-major matrix and back. */
+static void instance_set_matrix(MotoInstance *inst, const gfloat m[16])
+{
+    gint r;
+    for(r = 0; r < 3; r++)
+    {
+        inst->rows[r*4]     = m[r];
+        inst->rows[r*4 + 1] = m[4 + r];
+        inst->rows[r*4 + 2] = m[8 + r];
+        inst->rows[r*4 + 3] = m[12 + r];
+    }
+}
+
+static void instance_get_matrix(const MotoInstance *inst, gfloat m[16])
+{
+    gint r;
+    for(r = 0; r < 3; r++)
+    {
+        m[r]      = inst->rows[r*4];
+        m[4 + r]  = inst->rows[r*4 + 1];
+        m[8 + r]  = inst->rows[r*4 + 2];
+        m[12 + r] = inst->rows[r*4 + 3];
+    }
+    m[3] = m[7] = m[11] = 0;
+    m[15] = 1;
+}
+
+void moto_instance_node_set_instances_num(MotoInstanceNode *self, guint num)
+{
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(self);
+
+    if(num == priv->num)
+        return;
+
+    priv->instances = g_renew(MotoInstance, priv->instances, num);
+
+    guint i;
+    for(i = priv->num; i < num; i++)
+        instance_set_identity(priv->instances + i);
+
+    priv->num = num;
+    priv->ibuf_dirty = TRUE;
+    if(priv->picked >= (gint)num)
+        priv->picked = -1;
+}
+
+guint moto_instance_node_get_instances_num(MotoInstanceNode *self)
+{
+    return MOTO_INSTANCE_NODE_GET_PRIVATE(self)->num;
+}
+
+void moto_instance_node_set_instance(MotoInstanceNode *self, guint index,
+        const gfloat matrix[16], const gfloat color[4])
+{
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(self);
+
+    if(index >= priv->num)
+    {
+        moto_error("Instance %u is out of range (%u instances)", index, priv->num);
+        return;
+    }
+
+    MotoInstance *inst = priv->instances + index;
+    instance_set_matrix(inst, matrix);
+    if(color)
+        memcpy(inst->color, color, sizeof(inst->color));
+
+    priv->ibuf_dirty = TRUE;
+}
+
+void moto_instance_node_get_instance(MotoInstanceNode *self, guint index,
+        gfloat matrix[16], gfloat color[4])
+{
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(self);
+
+    if(index >= priv->num)
+    {
+        moto_error("Instance %u is out of range (%u instances)", index, priv->num);
+        return;
+    }
+
+    MotoInstance *inst = priv->instances + index;
+    if(matrix)
+        instance_get_matrix(inst, matrix);
+    if(color)
+        memcpy(color, inst->color, sizeof(inst->color));
+}
+
+gint moto_instance_node_get_picked_instance(MotoInstanceNode *self)
+{
+    return MOTO_INSTANCE_NODE_GET_PRIVATE(self)->picked;
+}
+
+/* Scattering */
+
+typedef struct _MotoScatterData
+{
+    MotoInstanceNode *self;
+    guint index;
+    gboolean align;
+    gfloat scale;
+} MotoScatterData;
+
+static void scatter_point(MotoPointCloud *ptc,
+        gfloat point[3], gfloat normal[3], gpointer user_data)
+{
+    MotoScatterData *sd = (MotoScatterData *)user_data;
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(sd->self);
+
+    if(sd->index >= priv->num)
+        moto_instance_node_set_instances_num(sd->self, max(16, priv->num*2));
+
+    MotoInstance *inst = priv->instances + sd->index++;
+    gfloat s = sd->scale;
+
+    /* Z axis of instance goes along normal. */
+    gfloat x[3], y[3], z[3] = {0, 0, 1}, lenbuf;
+    if(sd->align && normal && vector3_length(normal) > MICRO)
+    {
+        vector3_copy(z, normal);
+        vector3_normalize(z, lenbuf);
+    }
+    gfloat up[3] = {0, 0, 1};
+    if(fabs(z[2]) > 0.9)
+        vector3_set(up, 1, 0, 0);
+    vector3_cross(x, up, z);
+    vector3_normalize(x, lenbuf);
+    vector3_cross(y, z, x);
+
+    gint r;
+    for(r = 0; r < 3; r++)
+    {
+        inst->rows[r*4]     = x[r]*s;
+        inst->rows[r*4 + 1] = y[r]*s;
+        inst->rows[r*4 + 2] = z[r]*s;
+        inst->rows[r*4 + 3] = point[r];
+    }
+    inst->color[0] = inst->color[1] = inst->color[2] = inst->color[3] = 1;
+}
+
+static void moto_instance_node_scatter(MotoInstanceNode *self, MotoPointCloud *points)
+{
+    MotoNode *node = (MotoNode *)self;
+
+    MotoScatterData sd;
+    sd.self  = self;
+    sd.index = 0;
+    sd.align = TRUE;
+    sd.scale = 1;
+    moto_node_get_param_boolean(node, "align", & sd.align);
+    moto_node_get_param_float(node, "scale", & sd.scale);
+
+    if(moto_pointcloud_can_provide_plain_data(points))
+    {
+        gfloat *p = NULL, *n = NULL;
+        gsize size = 0;
+        moto_pointcloud_get_plain_data(points, & p, & n, & size);
+
+        moto_instance_node_set_instances_num(self, size);
+
+        /* Plain data is MotoVector per point. */
+        const gsize stride = sizeof(MotoVector)/sizeof(gfloat);
+        gsize i;
+        for(i = 0; i < size; i++)
+            scatter_point(points, p + i*stride, (n) ? n + i*stride : NULL, & sd);
+    }
+    else
+    {
+        moto_pointcloud_foreach_point(points, scatter_point, & sd);
+    }
+
+    moto_instance_node_set_instances_num(self, sd.index);
+    MOTO_INSTANCE_NODE_GET_PRIVATE(self)->ibuf_dirty = TRUE;
+}
+
+static void moto_instance_node_update(MotoNode *self)
+{
+    MotoShape *points = NULL;
+    moto_node_get_param_object(self, "points", (GObject **)& points);
+    if(points && MOTO_IS_POINTCLOUD(points))
+        moto_instance_node_scatter((MotoInstanceNode *)self, (MotoPointCloud *)points);
+
+    ((MotoNodeClass *)instance_node_parent_class)->update(self);
+}
+
+/* Bound and picking */
+
+static gboolean get_shape_bound(MotoObjectNode *self, MotoBound *bound)
+{
+    MotoShapeNode *shape_node = moto_object_node_get_shape(self);
+    if( ! shape_node)
+        return FALSE;
+
+    MotoShape *shape = moto_shape_node_get_shape(shape_node);
+    if( ! shape || ! MOTO_IS_MESH(shape))
+        return FALSE;
+
+    moto_mesh_calc_bound((MotoMesh *)shape, bound);
+    return TRUE;
+}
+
+static void moto_instance_node_calc_bound(MotoObjectNode *self, MotoBound *bound)
+{
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(self);
+
+    MotoBound sb;
+    if( ! priv->num || ! get_shape_bound(self, & sb))
+    {
+        moto_bound_set(bound, 0, 0, 0, 0, 0, 0);
+        return;
+    }
+
+    gfloat b[6] = {MACRO, -MACRO, MACRO, -MACRO, MACRO, -MACRO};
+    guint i;
+    gint c, r;
+    for(i = 0; i < priv->num; i++)
+    {
+        const gfloat *rows = priv->instances[i].rows;
+        for(c = 0; c < 8; c++)
+        {
+            gfloat p[3] = {sb.bound[c&1], sb.bound[2 + ((c>>1)&1)], sb.bound[4 + ((c>>2)&1)]};
+            for(r = 0; r < 3; r++)
+            {
+                const gfloat *row = rows + r*4;
+                gfloat v = row[0]*p[0] + row[1]*p[1] + row[2]*p[2] + row[3];
+                b[r*2]     = min(b[r*2], v);
+                b[r*2 + 1] = max(b[r*2 + 1], v);
+            }
+        }
+    }
+
+    moto_bound_set(bound, b[0], b[1], b[2], b[3], b[4], b[5]);
+}
+
+/* Ray goes into space of each instance through inverse of its transform.
+ * Ray isn't normalized there so distances of all instances are comparable. */
+static gboolean moto_instance_node_intersect(MotoObjectNode *self, MotoRay *ray,
+    gfloat extent, gfloat *dist)
+{
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(self);
+    priv->picked = -1;
+
+    MotoBound sb, bb;
+    if( ! priv->num || ! get_shape_bound(self, & sb))
+        return FALSE;
+    moto_bound_set_extended(& bb, & sb, extent);
+
+    gfloat m[16], im[16], ambuf[16], detbuf;
+    gfloat best = MACRO;
+    guint i;
+    for(i = 0; i < priv->num; i++)
+    {
+        instance_get_matrix(priv->instances + i, m);
+        matrix44_inverse(im, m, ambuf, detbuf);
+        if(fabs(detbuf) < MICRO)
+            continue;
+
+        MotoRay r;
+        moto_ray_set_transformed(& r, ray, im);
+
+        gfloat d;
+        if(moto_ray_intersect_bound_dist(& r, & d, bb.bound) && d > MICRO && d < best)
+        {
+            best = d;
+            priv->picked = i;
+        }
+    }
+
+    if(priv->picked < 0)
+        return FALSE;
+
+    *dist = best;
+    return TRUE;
+}
+
+static gboolean moto_instance_node_button_press(MotoObjectNode *self,
+    gint x, gint y, gint width, gint height, MotoRay *ray,
+    MotoTransformInfo *tinfo)
+{
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(self);
+    MotoObjectNodeClass *parent = (MotoObjectNodeClass *)instance_node_parent_class;
+
+    if(priv->picked < 0 || priv->picked >= (gint)priv->num)
+        return FALSE;
+
+    /* Components are selected on picked instance. */
+    gfloat m[16], im[16], ambuf[16], detbuf;
+    instance_get_matrix(priv->instances + priv->picked, m);
+    matrix44_inverse(im, m, ambuf, detbuf);
+    if(fabs(detbuf) < MICRO)
+        return FALSE;
+
+    MotoRay r;
+    moto_ray_set_transformed(& r, ray, im);
+    moto_ray_normalize(& r);
+
+    MotoTransformInfo tinfo2 = *tinfo;
+    matrix44_mult(tinfo2.model, tinfo->model, m);
+
+    return parent->button_press(self, x, y, width, height, & r, & tinfo2);
+}
+
+/* Drawing */
+
+enum
+{
+    ATTRIB_ROW0 = 1,
+    ATTRIB_ROW1,
+    ATTRIB_ROW2,
+    ATTRIB_COLOR
+};
+
+static const gchar *instance_vertex_shader =
+    "attribute vec4 row0;\n"
+    "attribute vec4 row1;\n"
+    "attribute vec4 row2;\n"
+    "attribute vec4 color;\n"
+    "varying vec3 normal;\n"
+    "varying vec4 diffuse;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 p = vec4(dot(row0, gl_Vertex), dot(row1, gl_Vertex), dot(row2, gl_Vertex), 1.0);\n"
+    "    vec3 n = vec3(dot(row0.xyz, gl_Normal), dot(row1.xyz, gl_Normal), dot(row2.xyz, gl_Normal));\n"
+    "    normal = gl_NormalMatrix * n;\n"
+    "    diffuse = color;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * p;\n"
+    "}\n";
+
+static const gchar *instance_fragment_shader =
+    "varying vec3 normal;\n"
+    "varying vec4 diffuse;\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 l = normalize(gl_LightSource[0].position.xyz);\n"
+    "    float d = abs(dot(normalize(normal), l));\n"
+    "    gl_FragColor = vec4(diffuse.rgb*(0.2 + 0.8*d), diffuse.a);\n"
+    "}\n";
+
+static GLhandleARB compile_shader(GLenum type, const gchar *source)
+{
+    GLhandleARB shader = glCreateShaderObjectARB(type);
+    glShaderSourceARB(shader, 1, & source, NULL);
+    glCompileShaderARB(shader);
+
+    GLint ok = 0;
+    glGetObjectParameterivARB(shader, GL_OBJECT_COMPILE_STATUS_ARB, & ok);
+    if( ! ok)
+    {
+        gchar log[1024];
+        glGetInfoLogARB(shader, sizeof(log), NULL, log);
+        moto_error("Can't compile instancing shader: %s", log);
+        glDeleteObjectARB(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+/* Program is shared by all instance nodes. It's built once on first use. */
+static GLhandleARB get_program(void)
+{
+    static GLhandleARB program = 0;
+    static gboolean failed = FALSE;
+
+    if(program || failed)
+        return program;
+
+    failed = TRUE;
+
+    GLhandleARB vs = compile_shader(GL_VERTEX_SHADER_ARB, instance_vertex_shader);
+    GLhandleARB fs = compile_shader(GL_FRAGMENT_SHADER_ARB, instance_fragment_shader);
+    if( ! vs || ! fs)
+        return 0;
+
+    GLhandleARB p = glCreateProgramObjectARB();
+    glAttachObjectARB(p, vs);
+    glAttachObjectARB(p, fs);
+    glBindAttribLocationARB(p, ATTRIB_ROW0,  "row0");
+    glBindAttribLocationARB(p, ATTRIB_ROW1,  "row1");
+    glBindAttribLocationARB(p, ATTRIB_ROW2,  "row2");
+    glBindAttribLocationARB(p, ATTRIB_COLOR, "color");
+    glLinkProgramARB(p);
+    glDeleteObjectARB(vs);
+    glDeleteObjectARB(fs);
+
+    GLint ok = 0;
+    glGetObjectParameterivARB(p, GL_OBJECT_LINK_STATUS_ARB, & ok);
+    if( ! ok)
+    {
+        moto_error("Can't link instancing shader");
+        glDeleteObjectARB(p);
+        return 0;
+    }
+
+    program = p;
+    failed = FALSE;
+    return program;
+}
+
+static gboolean moto_instance_node_draw_instanced(MotoInstanceNode *self,
+    MotoShapeNode *shape, MotoDrawMode draw_mode)
+{
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(self);
+
+    if( ! GLEW_ARB_instanced_arrays || ! moto_gl_is_vbo_supported() ||
+        ! moto_gl_is_glsl_supported())
+        return FALSE;
+
+    GLhandleARB program = get_program();
+    if( ! program)
+        return FALSE;
+
+    if( ! priv->ibuf)
+        glGenBuffersARB(1, & priv->ibuf);
+
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, priv->ibuf);
+    if(priv->ibuf_dirty)
+    {
+        glBufferDataARB(GL_ARRAY_BUFFER_ARB, sizeof(MotoInstance)*priv->num,
+                priv->instances, GL_STATIC_DRAW_ARB);
+        priv->ibuf_dirty = FALSE;
+    }
+
+    gint i;
+    for(i = 0; i < 4; i++)
+    {
+        glEnableVertexAttribArrayARB(ATTRIB_ROW0 + i);
+        glVertexAttribPointerARB(ATTRIB_ROW0 + i, 4, GL_FLOAT, GL_FALSE,
+                sizeof(MotoInstance), (GLubyte *)NULL + sizeof(GLfloat)*4*i);
+        glVertexAttribDivisorARB(ATTRIB_ROW0 + i, 1);
+    }
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+    MotoSceneNode *scene_node = moto_node_get_scene_node((MotoNode *)self);
+
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    if(scene_node && moto_scene_node_get_cull_faces(scene_node))
+        glEnable(GL_CULL_FACE);
+    else
+        glDisable(GL_CULL_FACE);
+
+    glUseProgramObjectARB(program);
+    gboolean drawn = moto_shape_node_draw_instanced(shape, draw_mode, priv->num);
+    glUseProgramObjectARB(0);
+
+    glPopAttrib();
+
+    for(i = 0; i < 4; i++)
+    {
+        glVertexAttribDivisorARB(ATTRIB_ROW0 + i, 0);
+        glDisableVertexAttribArrayARB(ATTRIB_ROW0 + i);
+    }
+
+    return drawn;
+}
+
+static void moto_instance_node_draw_shape(MotoObjectNode *self, MotoShapeNode *shape)
+{
+    MotoInstanceNodePriv *priv = MOTO_INSTANCE_NODE_GET_PRIVATE(self);
+
+    if( ! priv->num)
+        return;
+
+    MotoDrawMode draw_mode = moto_object_node_get_draw_mode(self);
+    MotoSelectionMode selection_mode = moto_object_node_get_selection_mode(self);
+
+    if(MOTO_SELECTION_MODE_OBJECT == selection_mode &&
+       moto_instance_node_draw_instanced((MotoInstanceNode *)self, shape, draw_mode))
+        return;
+
+    /* Without instancing every instance is still drawn from the same buffers of shape. */
+    MotoShapeSelection *selection = moto_object_node_get_selection(self);
+    gfloat m[16];
+    guint i;
+    for(i = 0; i < priv->num; i++)
+    {
+        instance_get_matrix(priv->instances + i, m);
+
+        glPushMatrix();
+        glMultMatrixf(m);
+        moto_shape_node_draw(shape, draw_mode, selection, selection_mode);
+        glPopMatrix();
+    }
+}
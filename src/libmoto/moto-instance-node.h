@@ -0,0 +1,74 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_INSTANCE_NODE_H__
+#define __MOTO_INSTANCE_NODE_H__
+
+#include "moto-object-node.h"
+
+G_BEGIN_DECLS
+
+typedef struct _MotoInstanceNode MotoInstanceNode;
+typedef struct _MotoInstanceNodeClass MotoInstanceNodeClass;
+
+/* class MotoInstanceNode */
+
+/* Draws one shape many times. Each instance is only a transform and a color,
+ * so geometry and its buffers are shared by all instances.
+ * If "points" is linked to a point cloud instances are placed on its points. */
+
+struct _MotoInstanceNode
+{
+    MotoObjectNode parent;
+};
+
+struct _MotoInstanceNodeClass
+{
+    MotoObjectNodeClass parent;
+};
+
+GType moto_instance_node_get_type(void);
+
+#define MOTO_TYPE_INSTANCE_NODE (moto_instance_node_get_type())
+#define MOTO_INSTANCE_NODE(obj)  (G_TYPE_CHECK_INSTANCE_CAST ((obj), MOTO_TYPE_INSTANCE_NODE, MotoInstanceNode))
+#define MOTO_INSTANCE_NODE_CLASS(klass)  (G_TYPE_CHECK_CLASS_CAST ((klass), MOTO_TYPE_INSTANCE_NODE, MotoInstanceNodeClass))
+#define MOTO_IS_INSTANCE_NODE(obj)  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),MOTO_TYPE_INSTANCE_NODE))
+#define MOTO_IS_INSTANCE_NODE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),MOTO_TYPE_INSTANCE_NODE))
+#define MOTO_INSTANCE_NODE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),MOTO_TYPE_INSTANCE_NODE, MotoInstanceNodeClass))
+
+MotoInstanceNode *moto_instance_node_new(const gchar *name);
+
+/* New instances have identity transform and white color. */
+void moto_instance_node_set_instances_num(MotoInstanceNode *self, guint num);
+guint moto_instance_node_get_instances_num(MotoInstanceNode *self);
+
+/* Matrix is in local space of node. Color may be NULL to keep the current one. */
+void moto_instance_node_set_instance(MotoInstanceNode *self, guint index,
+        const gfloat matrix[16], const gfloat color[4]);
+void moto_instance_node_get_instance(MotoInstanceNode *self, guint index,
+        gfloat matrix[16], gfloat color[4]);
+
+/* Instance hit by the last intersection test or -1. */
+gint moto_instance_node_get_picked_instance(MotoInstanceNode *self);
+
+G_END_DECLS
+
+#endif /* __MOTO_INSTANCE_NODE_H__ */
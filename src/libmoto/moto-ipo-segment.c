@@ -1,6 +1,7 @@
 #include "libmotoutil/numdef.h"
 
 #include "moto-ipo-segment.h"
+#include "moto-anim-curve.h"
 #include "moto-messager.h"
 
 /* IpoFunction */
@@ -27,39 +28,42 @@ gfloat linear_ipo_get_value(MotoIpoSegment *ipo_segment, gfloat arg)
     if(length < MICRO)
         return ipo_segment->_start_y;
 
-    return ipo_segment->_start_y*(arg - ipo_segment->_start_x)/length + \
-           ipo_segment->_end_y*(ipo_segment->_end_x - arg)/length;
+    return ipo_segment->_start_y*(ipo_segment->_end_x - arg)/length + \
+           ipo_segment->_end_y*(arg - ipo_segment->_start_x)/length;
 }
 
 gfloat bezier_ipo_get_value(MotoIpoSegment *ipo_segment, gfloat arg)
 {
-    /* TODO: Temporary using of linear interpolation. */
-    return linear_ipo_get_value(ipo_segment, arg);
+    /* Handles are relative to start and end points. */
+    gfloat length = ipo_segment->_end_x - ipo_segment->_start_x;
+    gfloat start_handle_x = CLAMP(ipo_segment->start_handle_x, 0, length);
+    gfloat end_handle_x   = CLAMP(ipo_segment->end_handle_x, -length, 0);
+
+    return moto_anim_bezier_eval(
+            ipo_segment->_start_x, ipo_segment->_start_y,
+            ipo_segment->_start_x + start_handle_x, ipo_segment->_start_y + ipo_segment->start_handle_y,
+            ipo_segment->_end_x + end_handle_x, ipo_segment->_end_y + ipo_segment->end_handle_y,
+            ipo_segment->_end_x, ipo_segment->_end_y, arg);
 }
 
-static GSList *_ipo_functions = NULL;
-static gboolean _ipo_functions_initialized = FALSE;
+static GHashTable *_ipo_functions = NULL;
+
+static void add_ipo_function(MotoIpoFunction *func)
+{
+    g_hash_table_insert(_ipo_functions, func->name->str, func);
+}
 
 static MotoIpoFunction *get_ipo_function(const gchar *func_name)
 {
-    if( ! _ipo_functions_initialized)
+    if( ! _ipo_functions)
     {
-        _ipo_functions = g_slist_append(_ipo_functions,
-                moto_ipo_function_new("linear", linear_ipo_get_value));
-        _ipo_functions = g_slist_append(_ipo_functions,
-                moto_ipo_function_new("bezier", bezier_ipo_get_value));
+        _ipo_functions = g_hash_table_new(g_str_hash, g_str_equal);
 
-        _ipo_functions_initialized = TRUE;
+        add_ipo_function(moto_ipo_function_new("linear", linear_ipo_get_value));
+        add_ipo_function(moto_ipo_function_new("bezier", bezier_ipo_get_value));
     }
 
-    GSList *l = _ipo_functions;
-    for(; l; l = g_slist_next(l))
-    {
-        if(g_utf8_collate(func_name, ((MotoIpoFunction *)l->data)->name->str) == 0)
-            return (MotoIpoFunction *)l->data;
-    }
-
-    return NULL;
+    return (MotoIpoFunction *)g_hash_table_lookup(_ipo_functions, func_name);
 }
 
 /* class IpoSegment */
@@ -86,6 +90,11 @@ moto_ipo_segment_init(MotoIpoSegment *self)
     self->_start_y = 0;
     self->_end_y = 0;
 
+    self->start_handle_x = 0;
+    self->start_handle_y = 0;
+    self->end_handle_x = 0;
+    self->end_handle_y = 0;
+
     self->func_object = NULL;
     self->func = NULL;
 }
@@ -138,6 +147,7 @@ void moto_ipo_segment_set_function(MotoIpoSegment *self, const gchar *func_name)
         g_string_printf(msg, "I can't set function for interpolation segment. Interpolation function \"%s\" does not exist.", func_name);
         moto_error(msg->str);
         g_string_free(msg, TRUE);
+        return;
     }
 
     self->func_object = func_object;
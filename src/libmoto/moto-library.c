@@ -50,6 +50,9 @@ struct _MotoLibraryPriv
     GData *slots;
     GMutex *new_slot_mutex;
     GMutex *new_entry_mutex;
+
+    GHashTable *assets;
+    GMutex *assets_mutex;
 };
 
 static void
@@ -63,6 +66,9 @@ moto_library_dispose(GObject *obj)
     g_mutex_free(self->priv->new_slot_mutex);
     g_mutex_free(self->priv->new_entry_mutex);
 
+    g_hash_table_destroy(self->priv->assets);
+    g_mutex_free(self->priv->assets_mutex);
+
     g_slice_free(MotoLibraryPriv, self->priv);
 
     G_OBJECT_CLASS(library_parent_class)->dispose(obj);
@@ -83,6 +89,9 @@ moto_library_init(MotoLibrary *self)
     self->priv->new_slot_mutex = g_mutex_new();
     self->priv->new_entry_mutex = g_mutex_new();
 
+    self->priv->assets = g_hash_table_new_full(g_str_hash, g_str_equal,
+        g_free, g_object_unref);
+    self->priv->assets_mutex = g_mutex_new();
 }
 
 static void
@@ -191,3 +200,52 @@ void moto_library_foreach(MotoLibrary *self, const gchar *slot_name,
     LibForeachUserData lfud = {func, user_data};
     g_datalist_foreach(& slot->dl, lib_foreach, & lfud);
 }
+
+GObject *moto_library_get_asset(MotoLibrary *self, const gchar *hash)
+{
+    g_mutex_lock(self->priv->assets_mutex);
+    GObject *asset = g_hash_table_lookup(self->priv->assets, hash);
+    if(asset)
+        g_object_ref(asset);
+    g_mutex_unlock(self->priv->assets_mutex);
+
+    return asset;
+}
+
+GObject *moto_library_add_asset(MotoLibrary *self, const gchar *hash, GObject *asset)
+{
+    g_mutex_lock(self->priv->assets_mutex);
+    GObject *old = g_hash_table_lookup(self->priv->assets, hash);
+    if(old)
+        asset = old;
+    else
+        g_hash_table_insert(self->priv->assets, g_strdup(hash), g_object_ref(asset));
+    g_object_ref(asset);
+    g_mutex_unlock(self->priv->assets_mutex);
+
+    return asset;
+}
+
+guint moto_library_get_assets_num(MotoLibrary *self)
+{
+    g_mutex_lock(self->priv->assets_mutex);
+    guint num = g_hash_table_size(self->priv->assets);
+    g_mutex_unlock(self->priv->assets_mutex);
+
+    return num;
+}
+
+static gboolean is_unused_asset(gpointer key, GObject *asset, gpointer user_data)
+{
+    /* New references are taken only under lock, so count may only go down. */
+    return 1 == g_atomic_int_get((gint *)& asset->ref_count);
+}
+
+guint moto_library_collect_assets(MotoLibrary *self)
+{
+    g_mutex_lock(self->priv->assets_mutex);
+    guint num = g_hash_table_foreach_remove(self->priv->assets, (GHRFunc)is_unused_asset, NULL);
+    g_mutex_unlock(self->priv->assets_mutex);
+
+    return num;
+}
@@ -70,6 +70,16 @@ gpointer moto_library_get_entry(MotoLibrary *self,
 void moto_library_foreach(MotoLibrary *self, const gchar *slot_name,
         MotoLibraryForeachFunc func, gpointer user_data);
 
+/* Assets shared by scenes (e.g. geometry of referenced files) keyed by hash of
+ * their content. Getter returns new reference or NULL. Adding returns new
+ * reference to asset which is already in library with the same hash, so
+ * identical data loaded at once by two threads is kept only once. */
+GObject *moto_library_get_asset(MotoLibrary *self, const gchar *hash);
+GObject *moto_library_add_asset(MotoLibrary *self, const gchar *hash, GObject *asset);
+guint moto_library_get_assets_num(MotoLibrary *self);
+/* Frees assets which aren't used by anyone except library. */
+guint moto_library_collect_assets(MotoLibrary *self);
+
 G_END_DECLS
 
 #endif /* __MOTO_LIBRARY_H__ */
@@ -0,0 +1,203 @@
+#include "moto-mem-pool.h"
+
+/* Pool */
+
+#define CLASSES_NUM 96
+#define MIN_CLASS_SIZE 1024
+#define HEADER_SIZE 32
+
+/* Lies right before memory given to user. */
+typedef struct _MotoMemBlock MotoMemBlock;
+struct _MotoMemBlock
+{
+    gpointer raw;
+    gsize size;
+    guint cls; /* CLASSES_NUM for blocks which aren't cached */
+    MotoMemBlock *next;
+};
+
+#define get_block(mem) ((MotoMemBlock *)((guint8 *)(mem) - HEADER_SIZE))
+
+static MotoMemBlock *pool_classes[CLASSES_NUM];
+static gsize pool_cached = 0;
+G_LOCK_DEFINE_STATIC(pool);
+
+/* Sizes of classes grow by quarter, so block is at most 25% larger than requested. */
+static guint get_class(gsize size, gsize *class_size)
+{
+    gsize s = MIN_CLASS_SIZE;
+    guint cls = 0;
+    while(s < size && cls < CLASSES_NUM)
+    {
+        s = moto_mem_pool_align(s + s/4);
+        cls++;
+    }
+
+    *class_size = (cls < CLASSES_NUM) ? s : moto_mem_pool_align(size);
+    return cls;
+}
+
+gpointer moto_mem_pool_alloc(gsize size)
+{
+    gsize class_size;
+    guint cls = get_class(size, & class_size);
+
+    MotoMemBlock *block = NULL;
+    if(cls < CLASSES_NUM)
+    {
+        G_LOCK(pool);
+        block = pool_classes[cls];
+        if(block)
+        {
+            pool_classes[cls] = block->next;
+            pool_cached -= block->size;
+        }
+        G_UNLOCK(pool);
+
+        if(block)
+            return (guint8 *)block + HEADER_SIZE;
+    }
+
+    guint8 *raw = (guint8 *)g_try_malloc(class_size + HEADER_SIZE + MOTO_MEM_POOL_ALIGN - 1);
+    if( ! raw)
+        return NULL;
+
+    guint8 *mem = (guint8 *)moto_mem_pool_align((gsize)raw + HEADER_SIZE);
+    block = get_block(mem);
+    block->raw  = raw;
+    block->size = class_size;
+    block->cls  = cls;
+    block->next = NULL;
+
+    return mem;
+}
+
+void moto_mem_pool_free(gpointer mem)
+{
+    if( ! mem)
+        return;
+
+    MotoMemBlock *block = get_block(mem);
+    if(block->cls < CLASSES_NUM)
+    {
+        G_LOCK(pool);
+        gboolean cached = pool_cached + block->size <= MOTO_MEM_POOL_MAX_CACHED;
+        if(cached)
+        {
+            block->next = pool_classes[block->cls];
+            pool_classes[block->cls] = block;
+            pool_cached += block->size;
+        }
+        G_UNLOCK(pool);
+
+        if(cached)
+            return;
+    }
+
+    g_free(block->raw);
+}
+
+void moto_mem_pool_trim(void)
+{
+    G_LOCK(pool);
+    guint i;
+    for(i = 0; i < CLASSES_NUM; i++)
+    {
+        while(pool_classes[i])
+        {
+            MotoMemBlock *block = pool_classes[i];
+            pool_classes[i] = block->next;
+            g_free(block->raw);
+        }
+    }
+    pool_cached = 0;
+    G_UNLOCK(pool);
+}
+
+/* Scratch */
+
+#define SCRATCH_CHUNKS_NUM 24
+#define SCRATCH_MIN_CHUNK (256*1024)
+
+/* Chunks are used one after another, each next one is twice larger. */
+typedef struct _MotoScratch
+{
+    guint8 *chunks[SCRATCH_CHUNKS_NUM];
+    gsize sizes[SCRATCH_CHUNKS_NUM];
+    guint chunk;
+    gsize offset;
+} MotoScratch;
+
+static GStaticPrivate scratch_key = G_STATIC_PRIVATE_INIT;
+
+static void scratch_destroy(gpointer data)
+{
+    MotoScratch *scratch = (MotoScratch *)data;
+
+    guint i;
+    for(i = 0; i < SCRATCH_CHUNKS_NUM; i++)
+        moto_mem_pool_free(scratch->chunks[i]);
+    g_slice_free(MotoScratch, scratch);
+}
+
+static MotoScratch *get_scratch(void)
+{
+    MotoScratch *scratch = (MotoScratch *)g_static_private_get(& scratch_key);
+    if( ! scratch)
+    {
+        scratch = g_slice_new0(MotoScratch);
+        g_static_private_set(& scratch_key, scratch, scratch_destroy);
+    }
+    return scratch;
+}
+
+gpointer moto_scratch_alloc(gsize size)
+{
+    MotoScratch *scratch = get_scratch();
+    size = moto_mem_pool_align(MAX(size, 1));
+
+    while(scratch->chunk < SCRATCH_CHUNKS_NUM)
+    {
+        guint c = scratch->chunk;
+        if( ! scratch->chunks[c])
+        {
+            gsize chunk_size = (c) ? scratch->sizes[c-1]*2 : SCRATCH_MIN_CHUNK;
+            scratch->sizes[c]  = MAX(chunk_size, size);
+            scratch->chunks[c] = (guint8 *)moto_mem_pool_alloc(scratch->sizes[c]);
+            if( ! scratch->chunks[c])
+                return NULL;
+        }
+
+        if(scratch->offset + size <= scratch->sizes[c])
+        {
+            gpointer mem = scratch->chunks[c] + scratch->offset;
+            scratch->offset += size;
+            return mem;
+        }
+
+        scratch->chunk++;
+        scratch->offset = 0;
+    }
+
+    return NULL;
+}
+
+void moto_scratch_free(gpointer mem)
+{
+    if( ! mem)
+        return;
+
+    MotoScratch *scratch = get_scratch();
+
+    gint c;
+    for(c = MIN(scratch->chunk, SCRATCH_CHUNKS_NUM - 1); c >= 0; c--)
+    {
+        guint8 *chunk = scratch->chunks[c];
+        if(chunk && (guint8 *)mem >= chunk && (guint8 *)mem < chunk + scratch->sizes[c])
+        {
+            scratch->chunk  = c;
+            scratch->offset = (guint8 *)mem - chunk;
+            return;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_MEM_POOL_H__
+#define __MOTO_MEM_POOL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Blocks aligned for SSE. Released blocks are kept in size classes and given
+ * back for requests of close size, so objects recreated on each evaluation
+ * don't go to system allocator. */
+
+#define MOTO_MEM_POOL_ALIGN 16
+#define MOTO_MEM_POOL_MAX_CACHED (64*1024*1024)
+
+#define moto_mem_pool_align(size) \
+    (((size) + MOTO_MEM_POOL_ALIGN - 1) & ~((gsize)MOTO_MEM_POOL_ALIGN - 1))
+
+/* Returns NULL if memory can't be allocated. Content is undefined. */
+gpointer moto_mem_pool_alloc(gsize size);
+void moto_mem_pool_free(gpointer mem);
+/* Frees all cached blocks. */
+void moto_mem_pool_trim(void);
+
+/* Per-thread scratch arena for temporaries of one call. Memory is released in
+ * reverse order, moto_scratch_free releases the block and everything allocated
+ * after it. Chunks of arena are kept, so repeated calls don't allocate. */
+
+gpointer moto_scratch_alloc(gsize size);
+void moto_scratch_free(gpointer mem);
+
+G_END_DECLS
+
+#endif /* __MOTO_MEM_POOL_H__ */
@@ -9,6 +9,7 @@
 #include "moto-library.h"
 #include "moto-messager.h"
 #include "moto-mesh-loader.h"
+#include "moto-profiler.h"
 #include "libmotoutil/xform.h"
 
 /* forwards */
@@ -69,6 +70,7 @@ moto_mesh_file_node_init(MotoMeshFileNode *self)
             "filename", "Filename", MOTO_TYPE_FILENAME, MOTO_PARAM_MODE_INOUT, "", pspec, "General",
             "lock",     "Lock", MOTO_TYPE_BOOL, MOTO_PARAM_MODE_INOUT, TRUE, pspec, "General",
             "watch",    "Watch", MOTO_TYPE_BOOL, MOTO_PARAM_MODE_INOUT, TRUE, pspec, "General",
+            "compact",  "Compact", MOTO_TYPE_BOOL, MOTO_PARAM_MODE_INOUT, FALSE, pspec, "General",
             NULL);
 
     priv->bound = moto_bound_new(0, 0, 0, 0, 0, 0);
@@ -167,11 +169,18 @@ static void moto_mesh_file_node_update_mesh(MotoMeshFileNode *self)
     if(priv->mesh)
         g_object_unref(priv->mesh);
 
+    MOTO_PROFILE_BEGIN(scope);
     priv->mesh = moto_mesh_file_node_load(self, filename);
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_IO, moto_node_get_interned_name(node), self);
     if(priv->mesh)
     {
         moto_info("Mesh '%s' loaded successfully", filename);
         moto_shape_prepare((MotoShape*)priv->mesh);
+
+        gboolean compact;
+        moto_node_get_param_boolean(node, "compact", &compact);
+        if(compact)
+            moto_mesh_pack(priv->mesh);
     }
 
     priv->bound_calculated = FALSE;
@@ -197,8 +206,10 @@ static MotoBound *moto_mesh_file_node_get_bound(MotoShapeNode *self)
 
     if( ! priv->bound_calculated)
     {
-        if(priv->mesh)
-            moto_mesh_calc_bound(priv->mesh, priv->bound);
+        /* Mesh may be restored from scene dump without loading file. */
+        MotoShape *shape = (priv->mesh) ? (MotoShape *)priv->mesh : moto_shape_node_get_shape(self);
+        if(shape && MOTO_IS_MESH(shape))
+            moto_mesh_calc_bound((MotoMesh *)shape, priv->bound);
         else
             moto_bound_set(priv->bound, 0, 0, 0, 0, 0, 0);
 
@@ -0,0 +1,981 @@
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "libmotoutil/numdef.h"
+
+#include "moto-mesh-lod.h"
+
+#define LOD_MAX_LEVELS 6
+#define LOD_MIN_TRIANGLES 64
+
+/* Weight of planes which keep open borders in place. */
+#define BOUNDARY_WEIGHT 100.0
+
+/* Collapse is rejected if normal of any triangle turns more than this (cosine). */
+#define MIN_NORMAL_DOT 0.2
+
+/* Symmetric 4x4 matrix: a2 ab ac ad b2 bc bd c2 cd d2. Planes are weighted
+ * by area and error is divided by the whole area, so it's a mean squared
+ * distance in units of mesh. */
+typedef struct _Quadric
+{
+    gdouble m[10];
+    gdouble area;
+} Quadric;
+
+typedef struct _Collapse
+{
+    gdouble cost;
+    guint32 v0, v1;
+    guint32 stamp0, stamp1;
+    gdouble pos[3];
+} Collapse;
+
+typedef struct _TriList
+{
+    guint32 *data;
+    guint num, size;
+} TriList;
+
+typedef struct _Simplifier
+{
+    guint v_num;
+    gdouble *pos;
+    Quadric *quadrics;
+    guint32 *stamps;
+    gboolean *v_alive;
+    TriList *v_tris;
+
+    guint t_num;
+    guint t_alive_num;
+    guint32 *tris;
+    gboolean *t_alive;
+
+    Collapse *heap;
+    guint heap_num, heap_size;
+} Simplifier;
+
+/* quadrics */
+
+static void quadric_add_plane(Quadric *q, gdouble a, gdouble b, gdouble c, gdouble d, gdouble w)
+{
+    gdouble *m = q->m;
+    m[0] += w*a*a; m[1] += w*a*b; m[2] += w*a*c; m[3] += w*a*d;
+    m[4] += w*b*b; m[5] += w*b*c; m[6] += w*b*d;
+    m[7] += w*c*c; m[8] += w*c*d;
+    m[9] += w*d*d;
+}
+
+static void quadric_add(Quadric *q, const Quadric *other)
+{
+    gint i;
+    for(i = 0; i < 10; i++)
+        q->m[i] += other->m[i];
+    q->area += other->area;
+}
+
+static gdouble quadric_eval(const Quadric *q, const gdouble *p)
+{
+    const gdouble *m = q->m;
+    gdouble x = p[0], y = p[1], z = p[2];
+    gdouble e = m[0]*x*x + 2*m[1]*x*y + 2*m[2]*x*z + 2*m[3]*x + \
+                m[4]*y*y + 2*m[5]*y*z + 2*m[6]*y + \
+                m[7]*z*z + 2*m[8]*z + m[9];
+    if(q->area > 0)
+        e /= q->area;
+    return (e > 0) ? e : 0;
+}
+
+/* Point minimizing quadric. Returns FALSE if matrix is singular. */
+static gboolean quadric_optimize(const Quadric *q, gdouble *p)
+{
+    const gdouble *m = q->m;
+    gdouble a = m[0], b = m[1], c = m[2];
+    gdouble d = m[4], e = m[5], f = m[7];
+
+    gdouble c00 = d*f - e*e;
+    gdouble c01 = c*e - b*f;
+    gdouble c02 = b*e - c*d;
+    gdouble det = a*c00 + b*c01 + c*c02;
+
+    gdouble scale = fabs(a) + fabs(d) + fabs(f);
+    if(fabs(det) <= 1e-12*scale*scale*scale)
+        return FALSE;
+
+    gdouble c11 = a*f - c*c;
+    gdouble c12 = b*c - a*e;
+    gdouble c22 = a*d - b*b;
+
+    gdouble rx = -m[3], ry = -m[6], rz = -m[8];
+    p[0] = (c00*rx + c01*ry + c02*rz)/det;
+    p[1] = (c01*rx + c11*ry + c12*rz)/det;
+    p[2] = (c02*rx + c12*ry + c22*rz)/det;
+    return TRUE;
+}
+
+static void tri_normal(const gdouble *p0, const gdouble *p1, const gdouble *p2, gdouble *n)
+{
+    gdouble u[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    gdouble v[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    n[0] = u[1]*v[2] - u[2]*v[1];
+    n[1] = u[2]*v[0] - u[0]*v[2];
+    n[2] = u[0]*v[1] - u[1]*v[0];
+}
+
+/* heap of collapses by cost */
+
+static void heap_push(Simplifier *s, const Collapse *c)
+{
+    if(s->heap_num >= s->heap_size)
+    {
+        s->heap_size = max(64, s->heap_size*2);
+        s->heap = g_renew(Collapse, s->heap, s->heap_size);
+    }
+
+    guint i = s->heap_num++;
+    while(i > 0)
+    {
+        guint parent = (i - 1)/2;
+        if(s->heap[parent].cost <= c->cost)
+            break;
+        s->heap[i] = s->heap[parent];
+        i = parent;
+    }
+    s->heap[i] = *c;
+}
+
+static void heap_pop(Simplifier *s, Collapse *c)
+{
+    *c = s->heap[0];
+
+    Collapse last = s->heap[--s->heap_num];
+    guint i = 0;
+    for(;;)
+    {
+        guint child = i*2 + 1;
+        if(child >= s->heap_num)
+            break;
+        if(child + 1 < s->heap_num && s->heap[child + 1].cost < s->heap[child].cost)
+            child++;
+        if(last.cost <= s->heap[child].cost)
+            break;
+        s->heap[i] = s->heap[child];
+        i = child;
+    }
+    if(s->heap_num)
+        s->heap[i] = last;
+}
+
+static void push_collapse(Simplifier *s, guint32 v0, guint32 v1)
+{
+    Collapse c;
+    Quadric q = s->quadrics[v0];
+    quadric_add(& q, s->quadrics + v1);
+
+    const gdouble *p0 = s->pos + v0*3;
+    const gdouble *p1 = s->pos + v1*3;
+
+    if( ! quadric_optimize(& q, c.pos))
+    {
+        /* Choosing best of ends and middle. */
+        gdouble mid[3] = {(p0[0] + p1[0])/2, (p0[1] + p1[1])/2, (p0[2] + p1[2])/2};
+        const gdouble *candidates[3] = {p0, p1, mid};
+        gdouble best = G_MAXDOUBLE;
+        gint i;
+        for(i = 0; i < 3; i++)
+        {
+            gdouble e = quadric_eval(& q, candidates[i]);
+            if(e < best)
+            {
+                best = e;
+                memcpy(c.pos, candidates[i], sizeof(gdouble)*3);
+            }
+        }
+    }
+
+    c.cost   = quadric_eval(& q, c.pos);
+    c.v0     = v0;
+    c.v1     = v1;
+    c.stamp0 = s->stamps[v0];
+    c.stamp1 = s->stamps[v1];
+    heap_push(s, & c);
+}
+
+/* triangle lists of verts */
+
+static void tri_list_append(TriList *l, guint32 t)
+{
+    if(l->num >= l->size)
+    {
+        l->size = max(8, l->size*2);
+        l->data = g_renew(guint32, l->data, l->size);
+    }
+    l->data[l->num++] = t;
+}
+
+static gint compare_edges(gconstpointer a, gconstpointer b)
+{
+    guint64 ea = *(const guint64 *)a;
+    guint64 eb = *(const guint64 *)b;
+    return (ea < eb) ? -1 : ((ea > eb) ? 1 : 0);
+}
+
+static void simplifier_init(Simplifier *s, const gfloat *v_coords, guint v_num,
+        const guint32 *t_verts, guint t_num)
+{
+    guint i, j;
+
+    memset(s, 0, sizeof(Simplifier));
+
+    s->v_num = v_num;
+    s->pos      = g_new(gdouble, v_num*3);
+    s->quadrics = g_new0(Quadric, v_num);
+    s->stamps   = g_new0(guint32, v_num);
+    s->v_alive  = g_new(gboolean, v_num);
+    s->v_tris   = g_new0(TriList, v_num);
+    for(i = 0; i < v_num*3; i++)
+        s->pos[i] = v_coords[i];
+    for(i = 0; i < v_num; i++)
+        s->v_alive[i] = TRUE;
+
+    s->t_num = t_num;
+    s->t_alive_num = t_num;
+    s->tris    = g_memdup(t_verts, sizeof(guint32)*t_num*3);
+    s->t_alive = g_new(gboolean, t_num);
+
+    /* Plane quadrics weighted by area. */
+    for(i = 0; i < t_num; i++)
+    {
+        guint32 *t = s->tris + i*3;
+        s->t_alive[i] = TRUE;
+
+        gdouble n[3];
+        tri_normal(s->pos + t[0]*3, s->pos + t[1]*3, s->pos + t[2]*3, n);
+        gdouble len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if(len > 0)
+        {
+            n[0] /= len; n[1] /= len; n[2] /= len;
+            gdouble *p = s->pos + t[0]*3;
+            gdouble d = -(n[0]*p[0] + n[1]*p[1] + n[2]*p[2]);
+            for(j = 0; j < 3; j++)
+            {
+                quadric_add_plane(s->quadrics + t[j], n[0], n[1], n[2], d, len/2);
+                s->quadrics[t[j]].area += len/2;
+            }
+        }
+
+        for(j = 0; j < 3; j++)
+            tri_list_append(s->v_tris + t[j], i);
+    }
+
+    /* Unique edges as sorted (min << 32 | max) keys. Edges used by one
+     * triangle are borders which get perpendicular planes. */
+    guint64 *edges = g_new(guint64, t_num*3);
+    for(i = 0; i < t_num; i++)
+    {
+        guint32 *t = s->tris + i*3;
+        for(j = 0; j < 3; j++)
+        {
+            guint64 a = t[j], b = t[(j + 1)%3];
+            edges[i*3 + j] = (a < b) ? (a << 32 | b) : (b << 32 | a);
+        }
+    }
+    qsort(edges, t_num*3, sizeof(guint64), compare_edges);
+
+    for(i = 0; i < t_num*3; )
+    {
+        guint k = i + 1;
+        while(k < t_num*3 && edges[k] == edges[i])
+            k++;
+
+        guint32 a = (guint32)(edges[i] >> 32);
+        guint32 b = (guint32)(edges[i] & 0xFFFFFFFF);
+        if(a != b)
+        {
+            if(1 == k - i)
+            {
+                /* Finding triangle of border edge. */
+                TriList *l = s->v_tris + a;
+                guint ti;
+                for(ti = 0; ti < l->num; ti++)
+                {
+                    guint32 *t = s->tris + l->data[ti]*3;
+                    if(t[0] == b || t[1] == b || t[2] == b)
+                        break;
+                }
+
+                if(ti < l->num)
+                {
+                    guint32 *t = s->tris + l->data[ti]*3;
+                    gdouble n[3];
+                    tri_normal(s->pos + t[0]*3, s->pos + t[1]*3, s->pos + t[2]*3, n);
+
+                    gdouble *pa = s->pos + a*3;
+                    gdouble *pb = s->pos + b*3;
+                    gdouble e[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+                    gdouble m[3] = {e[1]*n[2] - e[2]*n[1], e[2]*n[0] - e[0]*n[2], e[0]*n[1] - e[1]*n[0]};
+                    gdouble len = sqrt(m[0]*m[0] + m[1]*m[1] + m[2]*m[2]);
+                    if(len > 0)
+                    {
+                        m[0] /= len; m[1] /= len; m[2] /= len;
+                        gdouble d = -(m[0]*pa[0] + m[1]*pa[1] + m[2]*pa[2]);
+                        gdouble w = BOUNDARY_WEIGHT*(e[0]*e[0] + e[1]*e[1] + e[2]*e[2]);
+                        quadric_add_plane(s->quadrics + a, m[0], m[1], m[2], d, w);
+                        quadric_add_plane(s->quadrics + b, m[0], m[1], m[2], d, w);
+                    }
+                }
+            }
+        }
+
+        i = k;
+    }
+
+    for(i = 0; i < t_num*3; )
+    {
+        guint k = i + 1;
+        while(k < t_num*3 && edges[k] == edges[i])
+            k++;
+
+        guint32 a = (guint32)(edges[i] >> 32);
+        guint32 b = (guint32)(edges[i] & 0xFFFFFFFF);
+        if(a != b)
+            push_collapse(s, a, b);
+
+        i = k;
+    }
+
+    g_free(edges);
+}
+
+static void simplifier_free(Simplifier *s)
+{
+    guint i;
+    for(i = 0; i < s->v_num; i++)
+        g_free(s->v_tris[i].data);
+
+    g_free(s->pos);
+    g_free(s->quadrics);
+    g_free(s->stamps);
+    g_free(s->v_alive);
+    g_free(s->v_tris);
+    g_free(s->tris);
+    g_free(s->t_alive);
+    g_free(s->heap);
+}
+
+/* Checks that no triangle around v (except ones with other) flips when v moves to pos. */
+static gboolean check_flips(Simplifier *s, guint32 v, guint32 other, const gdouble *pos)
+{
+    TriList *l = s->v_tris + v;
+    guint i, j;
+    for(i = 0; i < l->num; i++)
+    {
+        guint32 ti = l->data[i];
+        if( ! s->t_alive[ti])
+            continue;
+
+        guint32 *t = s->tris + ti*3;
+        if(t[0] == other || t[1] == other || t[2] == other)
+            continue;
+
+        const gdouble *p[3];
+        const gdouble *q[3];
+        for(j = 0; j < 3; j++)
+        {
+            p[j] = s->pos + t[j]*3;
+            q[j] = (t[j] == v) ? pos : p[j];
+        }
+
+        gdouble n0[3], n1[3];
+        tri_normal(p[0], p[1], p[2], n0);
+        tri_normal(q[0], q[1], q[2], n1);
+
+        gdouble l0 = sqrt(n0[0]*n0[0] + n0[1]*n0[1] + n0[2]*n0[2]);
+        gdouble l1 = sqrt(n1[0]*n1[0] + n1[1]*n1[1] + n1[2]*n1[2]);
+        if(l1 <= 0)
+            return FALSE;
+        if(l0 <= 0)
+            continue;
+
+        if((n0[0]*n1[0] + n0[1]*n1[1] + n0[2]*n1[2])/(l0*l1) < MIN_NORMAL_DOT)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void collapse(Simplifier *s, const Collapse *c)
+{
+    guint32 v0 = c->v0, v1 = c->v1;
+    guint i, j;
+
+    memcpy(s->pos + v0*3, c->pos, sizeof(gdouble)*3);
+    quadric_add(s->quadrics + v0, s->quadrics + v1);
+    s->v_alive[v1] = FALSE;
+    s->stamps[v0]++;
+
+    /* Triangles of v1 go to v0, ones having both die. */
+    TriList *l1 = s->v_tris + v1;
+    for(i = 0; i < l1->num; i++)
+    {
+        guint32 ti = l1->data[i];
+        if( ! s->t_alive[ti])
+            continue;
+
+        guint32 *t = s->tris + ti*3;
+        if(t[0] == v0 || t[1] == v0 || t[2] == v0)
+        {
+            s->t_alive[ti] = FALSE;
+            s->t_alive_num--;
+            continue;
+        }
+
+        for(j = 0; j < 3; j++)
+            if(t[j] == v1)
+                t[j] = v0;
+        tri_list_append(s->v_tris + v0, ti);
+    }
+    g_free(l1->data);
+    memset(l1, 0, sizeof(TriList));
+
+    /* Compacting list and collecting neighbours. */
+    TriList *l0 = s->v_tris + v0;
+    guint n = 0;
+    for(i = 0; i < l0->num; i++)
+    {
+        guint32 ti = l0->data[i];
+        if(s->t_alive[ti])
+            l0->data[n++] = ti;
+    }
+    l0->num = n;
+
+    for(i = 0; i < l0->num; i++)
+    {
+        guint32 *t = s->tris + l0->data[i]*3;
+        for(j = 0; j < 3; j++)
+        {
+            /* Edges may be pushed twice, the more expensive one is skipped as outdated. */
+            if(t[j] != v0)
+                push_collapse(s, min(v0, t[j]), max(v0, t[j]));
+        }
+    }
+}
+
+static MotoMeshLodLevel *simplifier_result(Simplifier *s)
+{
+    MotoMeshLodLevel *level = g_slice_new(MotoMeshLodLevel);
+    guint i, j;
+
+    guint32 *remap = g_new(guint32, s->v_num);
+    for(i = 0; i < s->v_num; i++)
+        remap[i] = G_MAXUINT32;
+
+    level->t_num = s->t_alive_num;
+    level->t_verts = g_new(guint32, level->t_num*3);
+
+    guint v_num = 0, t_num = 0;
+    for(i = 0; i < s->t_num; i++)
+    {
+        if( ! s->t_alive[i])
+            continue;
+
+        guint32 *t = s->tris + i*3;
+        for(j = 0; j < 3; j++)
+        {
+            if(G_MAXUINT32 == remap[t[j]])
+                remap[t[j]] = v_num++;
+            level->t_verts[t_num*3 + j] = remap[t[j]];
+        }
+        t_num++;
+    }
+
+    level->v_num = v_num;
+    level->v_coords  = g_new(gfloat, v_num*3);
+    level->v_normals = g_new0(gfloat, v_num*3);
+    for(i = 0; i < s->v_num; i++)
+    {
+        if(G_MAXUINT32 == remap[i])
+            continue;
+        for(j = 0; j < 3; j++)
+            level->v_coords[remap[i]*3 + j] = s->pos[i*3 + j];
+    }
+
+    /* Area weighted normals. */
+    for(i = 0; i < level->t_num; i++)
+    {
+        guint32 *t = level->t_verts + i*3;
+        gdouble p[3][3], n[3];
+        for(j = 0; j < 3; j++)
+        {
+            p[j][0] = level->v_coords[t[j]*3];
+            p[j][1] = level->v_coords[t[j]*3 + 1];
+            p[j][2] = level->v_coords[t[j]*3 + 2];
+        }
+        tri_normal(p[0], p[1], p[2], n);
+        for(j = 0; j < 3; j++)
+        {
+            level->v_normals[t[j]*3]     += n[0];
+            level->v_normals[t[j]*3 + 1] += n[1];
+            level->v_normals[t[j]*3 + 2] += n[2];
+        }
+    }
+    for(i = 0; i < v_num; i++)
+    {
+        gfloat *n = level->v_normals + i*3;
+        gfloat len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if(len > 0)
+        {
+            n[0] /= len; n[1] /= len; n[2] /= len;
+        }
+    }
+
+    g_free(remap);
+    return level;
+}
+
+/* Uniform grid of triangles of level for distance queries. */
+typedef struct _TriGrid
+{
+    gdouble min[3];
+    gdouble cell;
+    gint dim[3];
+    guint *offsets; /* Triangles of cell i are tris[offsets[i]] .. tris[offsets[i+1]]. */
+    guint32 *tris;
+} TriGrid;
+
+static void tri_grid_get_cell(TriGrid *g, const gdouble *p, gint *c)
+{
+    gint j;
+    for(j = 0; j < 3; j++)
+        c[j] = CLAMP((gint)floor((p[j] - g->min[j])/g->cell), 0, g->dim[j] - 1);
+}
+
+static void tri_grid_get_range(TriGrid *g, MotoMeshLodLevel *l, guint ti, gint *lo, gint *hi)
+{
+    const guint32 *t = l->t_verts + ti*3;
+    gdouble tmin[3], tmax[3];
+    gint j, k;
+    for(j = 0; j < 3; j++)
+    {
+        tmin[j] = tmax[j] = l->v_coords[t[0]*3 + j];
+        for(k = 1; k < 3; k++)
+        {
+            tmin[j] = min(tmin[j], l->v_coords[t[k]*3 + j]);
+            tmax[j] = max(tmax[j], l->v_coords[t[k]*3 + j]);
+        }
+    }
+    tri_grid_get_cell(g, tmin, lo);
+    tri_grid_get_cell(g, tmax, hi);
+}
+
+static void tri_grid_init(TriGrid *g, MotoMeshLodLevel *l)
+{
+    gdouble max_p[3];
+    guint i, j;
+    gint x, y, z;
+
+    for(j = 0; j < 3; j++)
+    {
+        g->min[j] = max_p[j] = (l->v_num) ? l->v_coords[j] : 0;
+        for(i = 1; i < l->v_num; i++)
+        {
+            g->min[j] = min(g->min[j], l->v_coords[i*3 + j]);
+            max_p[j]  = max(max_p[j], l->v_coords[i*3 + j]);
+        }
+    }
+
+    /* About one triangle per cell of the largest side. */
+    gdouble ext = max(max_p[0] - g->min[0], max(max_p[1] - g->min[1], max_p[2] - g->min[2]));
+    gint n = max(1, (gint)ceil(pow(l->t_num, 1.0/3)));
+    g->cell = (ext > 0) ? ext/n : 1;
+    guint cells = 1;
+    for(j = 0; j < 3; j++)
+    {
+        g->dim[j] = (gint)((max_p[j] - g->min[j])/g->cell) + 1;
+        cells *= g->dim[j];
+    }
+
+    g->offsets = g_new0(guint, cells + 1);
+    gint lo[3], hi[3];
+    for(i = 0; i < l->t_num; i++)
+    {
+        tri_grid_get_range(g, l, i, lo, hi);
+        for(z = lo[2]; z <= hi[2]; z++)
+            for(y = lo[1]; y <= hi[1]; y++)
+                for(x = lo[0]; x <= hi[0]; x++)
+                    g->offsets[(z*g->dim[1] + y)*g->dim[0] + x + 1]++;
+    }
+    for(i = 0; i < cells; i++)
+        g->offsets[i + 1] += g->offsets[i];
+
+    guint *fill = g_memdup(g->offsets, sizeof(guint)*cells);
+    g->tris = g_new(guint32, g->offsets[cells]);
+    for(i = 0; i < l->t_num; i++)
+    {
+        tri_grid_get_range(g, l, i, lo, hi);
+        for(z = lo[2]; z <= hi[2]; z++)
+            for(y = lo[1]; y <= hi[1]; y++)
+                for(x = lo[0]; x <= hi[0]; x++)
+                    g->tris[fill[(z*g->dim[1] + y)*g->dim[0] + x]++] = i;
+    }
+    g_free(fill);
+}
+
+static void tri_grid_free(TriGrid *g)
+{
+    g_free(g->offsets);
+    g_free(g->tris);
+}
+
+static gdouble dot3(const gdouble *a, const gdouble *b)
+{
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+/* Squared distance from p to triangle abc (closest point by regions of Voronoi). */
+static gdouble tri_distance2(const gdouble *p, const gdouble *a, const gdouble *b, const gdouble *c)
+{
+    gdouble ab[3], ac[3], ap[3], bp[3], cp[3], q[3];
+    gint j;
+    for(j = 0; j < 3; j++)
+    {
+        ab[j] = b[j] - a[j]; ac[j] = c[j] - a[j];
+        ap[j] = p[j] - a[j]; bp[j] = p[j] - b[j]; cp[j] = p[j] - c[j];
+    }
+
+    gdouble d1 = dot3(ab, ap), d2 = dot3(ac, ap);
+    gdouble d3 = dot3(ab, bp), d4 = dot3(ac, bp);
+    gdouble d5 = dot3(ab, cp), d6 = dot3(ac, cp);
+    gdouble va = d3*d6 - d5*d4, vb = d5*d2 - d1*d6, vc = d1*d4 - d3*d2;
+
+    if(d1 <= 0 && d2 <= 0)
+        return dot3(ap, ap);
+    if(d3 >= 0 && d4 <= d3)
+        return dot3(bp, bp);
+    if(d6 >= 0 && d5 <= d6)
+        return dot3(cp, cp);
+
+    if(vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        gdouble v = d1/(d1 - d3);
+        for(j = 0; j < 3; j++) q[j] = a[j] + v*ab[j];
+    }
+    else if(vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        gdouble w = d2/(d2 - d6);
+        for(j = 0; j < 3; j++) q[j] = a[j] + w*ac[j];
+    }
+    else if(va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+    {
+        gdouble w = (d4 - d3)/((d4 - d3) + (d5 - d6));
+        for(j = 0; j < 3; j++) q[j] = b[j] + w*(c[j] - b[j]);
+    }
+    else
+    {
+        gdouble sum = va + vb + vc;
+        gdouble v = (sum != 0) ? vb/sum : 0, w = (sum != 0) ? vc/sum : 0;
+        for(j = 0; j < 3; j++) q[j] = a[j] + v*ab[j] + w*ac[j];
+    }
+
+    for(j = 0; j < 3; j++)
+        q[j] = p[j] - q[j];
+    return dot3(q, q);
+}
+
+/* Distance from p to surface of level. Rings of cells around p are searched
+ * until the nearest triangle is closer than the next ring. */
+static gdouble tri_grid_distance(TriGrid *g, MotoMeshLodLevel *l, const gdouble *p)
+{
+    gint c[3];
+    tri_grid_get_cell(g, p, c);
+
+    gdouble best = G_MAXDOUBLE;
+    gint k, x, y, z, j;
+    gint max_k = max(g->dim[0], max(g->dim[1], g->dim[2]));
+    for(k = 0; k <= max_k; k++)
+    {
+        for(z = max(0, c[2] - k); z <= min(g->dim[2] - 1, c[2] + k); z++)
+            for(y = max(0, c[1] - k); y <= min(g->dim[1] - 1, c[1] + k); y++)
+                for(x = max(0, c[0] - k); x <= min(g->dim[0] - 1, c[0] + k); x++)
+                {
+                    if(abs(x - c[0]) != k && abs(y - c[1]) != k && abs(z - c[2]) != k)
+                        continue;
+
+                    guint cell = (z*g->dim[1] + y)*g->dim[0] + x;
+                    guint i;
+                    for(i = g->offsets[cell]; i < g->offsets[cell + 1]; i++)
+                    {
+                        const guint32 *t = l->t_verts + g->tris[i]*3;
+                        gdouble v[3][3];
+                        for(j = 0; j < 9; j++)
+                            v[j/3][j%3] = l->v_coords[t[j/3]*3 + j%3];
+                        gdouble d2 = tri_distance2(p, v[0], v[1], v[2]);
+                        best = min(best, d2);
+                    }
+                }
+
+        if(best < G_MAXDOUBLE && sqrt(best) <= k*g->cell)
+            break;
+    }
+
+    return (best < G_MAXDOUBLE) ? sqrt(best) : 0;
+}
+
+/* Max distance from used verts of source to simplified surface, in units of mesh. */
+static gdouble measure_error(MotoMeshLodLevel *level, const gfloat *v_coords, guint v_num,
+        const guint32 *t_verts, guint t_num)
+{
+    if( ! level->t_num)
+        return 0;
+
+    gboolean *used = g_new0(gboolean, v_num);
+    guint i;
+    for(i = 0; i < t_num*3; i++)
+        used[t_verts[i]] = TRUE;
+
+    TriGrid g;
+    tri_grid_init(& g, level);
+
+    gdouble error = 0;
+    for(i = 0; i < v_num; i++)
+    {
+        if( ! used[i])
+            continue;
+        gdouble p[3] = {v_coords[i*3], v_coords[i*3 + 1], v_coords[i*3 + 2]};
+        gdouble d = tri_grid_distance(& g, level, p);
+        error = max(error, d);
+    }
+
+    tri_grid_free(& g);
+    g_free(used);
+    return error;
+}
+
+MotoMeshLodLevel *moto_mesh_lod_level_new_simplified(const gfloat *v_coords, guint v_num,
+        const guint32 *t_verts, guint t_num, guint target_t_num, gfloat max_error)
+{
+    Simplifier s;
+    simplifier_init(& s, v_coords, v_num, t_verts, t_num);
+
+    gdouble cost_limit = (max_error > 0) ? (gdouble)max_error*max_error : G_MAXDOUBLE;
+
+    Collapse c;
+    while(s.t_alive_num > target_t_num && s.heap_num)
+    {
+        heap_pop(& s, & c);
+
+        if( ! s.v_alive[c.v0] || ! s.v_alive[c.v1] ||
+            c.stamp0 != s.stamps[c.v0] || c.stamp1 != s.stamps[c.v1])
+            continue;
+
+        if(c.cost > cost_limit)
+            break;
+
+        if( ! check_flips(& s, c.v0, c.v1, c.pos) || ! check_flips(& s, c.v1, c.v0, c.pos))
+            continue;
+
+        collapse(& s, & c);
+    }
+
+    MotoMeshLodLevel *level = simplifier_result(& s);
+    simplifier_free(& s);
+
+    level->error = measure_error(level, v_coords, v_num, t_verts, t_num);
+    return level;
+}
+
+void moto_mesh_lod_level_free(MotoMeshLodLevel *self)
+{
+    g_free(self->v_coords);
+    g_free(self->v_normals);
+    g_free(self->t_verts);
+    g_slice_free(MotoMeshLodLevel, self);
+}
+
+/* MotoMeshLod */
+
+struct _MotoMeshLod
+{
+    volatile gint ref_count;
+    volatile gint ready;
+    volatile gint cancelled;
+
+    /* Input is copied, so mesh may be changed while building. */
+    MotoMeshLodLevel *source;
+
+    GPtrArray *levels;
+};
+
+static GThreadPool *lod_pool = NULL;
+
+static void moto_mesh_lod_build(MotoMeshLod *self)
+{
+    MotoMeshLodLevel *prev = self->source;
+    guint i;
+    for(i = 0; i < LOD_MAX_LEVELS; i++)
+    {
+        if(g_atomic_int_get(& self->cancelled))
+            break;
+
+        guint target = prev->t_num/2;
+        if(target < LOD_MIN_TRIANGLES)
+            break;
+
+        MotoMeshLodLevel *level = moto_mesh_lod_level_new_simplified(prev->v_coords, prev->v_num,
+                prev->t_verts, prev->t_num, target, 0);
+
+        /* Nothing to collapse anymore. */
+        if(level->t_num > prev->t_num*9/10)
+        {
+            moto_mesh_lod_level_free(level);
+            break;
+        }
+
+        /* Errors of levels are accumulated because each one is built from previous. */
+        level->error += prev->error;
+
+        g_ptr_array_add(self->levels, level);
+        prev = level;
+    }
+
+    moto_mesh_lod_level_free(self->source);
+    self->source = NULL;
+
+    g_atomic_int_set(& self->ready, TRUE);
+}
+
+static void build_job(gpointer data, gpointer user_data)
+{
+    MotoMeshLod *self = (MotoMeshLod *)data;
+    moto_mesh_lod_build(self);
+    moto_mesh_lod_unref(self);
+}
+
+/* Triangles from tesselation or fans for not tesselated faces. */
+static MotoMeshLodLevel *level_from_mesh(MotoMesh *mesh)
+{
+    MotoMeshLodLevel *level = g_slice_new0(MotoMeshLodLevel);
+    guint i, j;
+
+    level->v_num = mesh->v_num;
+    level->v_coords = g_new(gfloat, mesh->v_num*3);
+    moto_mesh_decode_verts(mesh, 0, mesh->v_num, level->v_coords, sizeof(gfloat)*3, NULL, 0);
+
+    if(mesh->tesselated && ! mesh->b32 && mesh->f_tess_verts)
+    {
+        level->t_num = mesh->f_tess_num;
+        level->t_verts = g_new(guint32, level->t_num*3);
+        for(i = 0; i < level->t_num*3; i++)
+            level->t_verts[i] = mesh->f_tess_verts16[i];
+        return level;
+    }
+
+    for(i = 0; i < mesh->f_num; i++)
+    {
+        guint start = (0 == i) ? 0 : ((mesh->b32) ? mesh->f_data32[i-1].v_offset : mesh->f_data16[i-1].v_offset);
+        guint end = (mesh->b32) ? mesh->f_data32[i].v_offset : mesh->f_data16[i].v_offset;
+        if(end - start > 2)
+            level->t_num += end - start - 2;
+    }
+
+    level->t_verts = g_new(guint32, level->t_num*3);
+    guint32 *t = level->t_verts;
+    for(i = 0; i < mesh->f_num; i++)
+    {
+        guint start = (0 == i) ? 0 : ((mesh->b32) ? mesh->f_data32[i-1].v_offset : mesh->f_data16[i-1].v_offset);
+        guint end = (mesh->b32) ? mesh->f_data32[i].v_offset : mesh->f_data16[i].v_offset;
+        for(j = start + 1; j + 1 < end; j++)
+        {
+            *(t++) = (mesh->b32) ? mesh->f_verts32[start] : mesh->f_verts16[start];
+            *(t++) = (mesh->b32) ? mesh->f_verts32[j]     : mesh->f_verts16[j];
+            *(t++) = (mesh->b32) ? mesh->f_verts32[j + 1] : mesh->f_verts16[j + 1];
+        }
+    }
+
+    return level;
+}
+
+MotoMeshLod *moto_mesh_lod_new(MotoMesh *mesh, gboolean background)
+{
+    MotoMeshLod *self = g_slice_new(MotoMeshLod);
+
+    self->ref_count = 1;
+    self->ready     = FALSE;
+    self->cancelled = FALSE;
+    self->source    = level_from_mesh(mesh);
+    self->levels    = g_ptr_array_new();
+
+    if(background && g_thread_supported())
+    {
+        if( ! lod_pool)
+            lod_pool = g_thread_pool_new(build_job, NULL, 1, FALSE, NULL);
+
+        if(lod_pool)
+        {
+            g_thread_pool_push(lod_pool, moto_mesh_lod_ref(self), NULL);
+            return self;
+        }
+    }
+
+    moto_mesh_lod_build(self);
+    return self;
+}
+
+MotoMeshLod *moto_mesh_lod_ref(MotoMeshLod *self)
+{
+    g_atomic_int_inc(& self->ref_count);
+    return self;
+}
+
+void moto_mesh_lod_unref(MotoMeshLod *self)
+{
+    if( ! g_atomic_int_dec_and_test(& self->ref_count))
+    {
+        /* Only job in progress holds it, nobody needs result. */
+        if(1 == g_atomic_int_get(& self->ref_count) && ! moto_mesh_lod_is_ready(self))
+            g_atomic_int_set(& self->cancelled, TRUE);
+        return;
+    }
+
+    guint i;
+    for(i = 0; i < self->levels->len; i++)
+        moto_mesh_lod_level_free((MotoMeshLodLevel *)g_ptr_array_index(self->levels, i));
+    g_ptr_array_free(self->levels, TRUE);
+
+    if(self->source)
+        moto_mesh_lod_level_free(self->source);
+
+    g_slice_free(MotoMeshLod, self);
+}
+
+gboolean moto_mesh_lod_is_ready(MotoMeshLod *self)
+{
+    return g_atomic_int_get(& self->ready);
+}
+
+guint moto_mesh_lod_get_levels_num(MotoMeshLod *self)
+{
+    if( ! moto_mesh_lod_is_ready(self))
+        return 0;
+    return self->levels->len;
+}
+
+MotoMeshLodLevel *moto_mesh_lod_get_level(MotoMeshLod *self, guint index)
+{
+    g_return_val_if_fail(index < moto_mesh_lod_get_levels_num(self), NULL);
+    return (MotoMeshLodLevel *)g_ptr_array_index(self->levels, index);
+}
+
+guint moto_mesh_lod_choose_level(MotoMeshLod *self, gfloat pixels_per_unit, gfloat tolerance)
+{
+    guint num = moto_mesh_lod_get_levels_num(self);
+    guint i, level = 0;
+    for(i = 0; i < num; i++)
+    {
+        MotoMeshLodLevel *l = (MotoMeshLodLevel *)g_ptr_array_index(self->levels, i);
+        if(l->error*pixels_per_unit > tolerance)
+            break;
+        level = i + 1;
+    }
+    return level;
+}
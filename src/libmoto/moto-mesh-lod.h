@@ -0,0 +1,73 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_MESH_LOD_H__
+#define __MOTO_MESH_LOD_H__
+
+#include <glib.h>
+
+#include "moto-mesh.h"
+
+G_BEGIN_DECLS
+
+typedef struct _MotoMeshLodLevel MotoMeshLodLevel;
+typedef struct _MotoMeshLod MotoMeshLod;
+
+/* Simplified triangle mesh. Coords and normals are packed as xyz. */
+struct _MotoMeshLodLevel
+{
+    guint v_num;
+    gfloat *v_coords;
+    gfloat *v_normals;
+
+    guint t_num;
+    guint32 *t_verts;
+
+    /* Max distance from verts of source to this surface in units of mesh. */
+    gfloat error;
+};
+
+/* Quadric error edge collapse until triangles number is not greater than target_t_num
+ * or next collapse costs more than max_error. Cost is root mean square distance
+ * of new vert to planes of merged faces. Zero max_error means no limit.
+ * Works on plain arrays and doesn't need GL, so it may be run in any thread. */
+MotoMeshLodLevel *moto_mesh_lod_level_new_simplified(const gfloat *v_coords, guint v_num,
+        const guint32 *t_verts, guint t_num, guint target_t_num, gfloat max_error);
+void moto_mesh_lod_level_free(MotoMeshLodLevel *self);
+
+/* Chain of levels, each one has about half triangles of previous.
+ * Level 0 is the original mesh and isn't stored. */
+MotoMeshLod *moto_mesh_lod_new(MotoMesh *mesh, gboolean background);
+MotoMeshLod *moto_mesh_lod_ref(MotoMeshLod *self);
+void moto_mesh_lod_unref(MotoMeshLod *self);
+
+/* Levels are available only after chain is ready. */
+gboolean moto_mesh_lod_is_ready(MotoMeshLod *self);
+guint moto_mesh_lod_get_levels_num(MotoMeshLod *self);
+MotoMeshLodLevel *moto_mesh_lod_get_level(MotoMeshLod *self, guint index);
+
+/* Coarsest level which error is not greater than tolerance pixels
+ * when one unit of mesh space takes pixels_per_unit on screen. */
+guint moto_mesh_lod_choose_level(MotoMeshLod *self, gfloat pixels_per_unit, gfloat tolerance);
+
+G_END_DECLS
+
+#endif /* __MOTO_MESH_LOD_H__ */
@@ -0,0 +1,1064 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "moto-messager.h"
+#include "moto-parallel.h"
+#include "moto-mesh-subdiv.h"
+
+#define INVALID G_MAXUINT32
+
+/* Sharpness of hard edges. Greater than any number of levels. */
+#define HARD_SHARPNESS 1000.0f
+
+/* Refined mesh must fit in 32 bit indices, meshes up to 16 bit limit use 16 bit ones. */
+#define MAX_INDEX (G_MAXUINT32 - 1)
+
+/* Rows are split between threads only when there are enough of them. */
+#define PARALLEL_MIN_ROWS 2048
+
+typedef struct _Edge
+{
+    guint32 v0, v1; /* v0 < v1 */
+    guint32 f0, f1; /* f1 is invalid for border */
+    gfloat sharpness;
+} Edge;
+
+/* Topology of one level of refinement. Faces are stored as vertex loops. */
+typedef struct _Level
+{
+    guint v_num;
+    guint f_num;
+    guint32 *f_offsets; /* f_num + 1 */
+    guint32 *f_verts;
+
+    guint e_num;
+    Edge *edges;        /* Sorted by verts. */
+    guint32 *f_edges;   /* Edge from each vert of face to the next one. */
+
+    guint32 *v_edge_offsets;
+    guint32 *v_edges;
+    guint32 *v_face_offsets;
+    guint32 *v_faces;
+
+    /* Extraordinary verts and verts on creases. */
+    guint8 *v_features;
+} Level;
+
+/* Each row is weighted sum of verts of cage. */
+typedef struct _Stencils
+{
+    guint num;
+    guint32 *offsets; /* num + 1 */
+    guint32 *indices;
+    gfloat *weights;
+} Stencils;
+
+/* Rows which are built serially, weights of verts of previous level. */
+typedef struct _Rows
+{
+    GArray *offsets;
+    GArray *indices;
+    GArray *weights;
+} Rows;
+
+typedef struct _Entry
+{
+    guint32 index;
+    gfloat weight;
+} Entry;
+
+typedef struct _Corner
+{
+    guint32 v0, v1;
+    guint32 f;
+    guint32 i; /* in f_verts */
+} Corner;
+
+struct _MotoMeshSubdiv
+{
+    guint64 cage_hash;
+    guint requested_levels;
+    gboolean adaptive;
+
+    guint levels;
+    Level *level; /* Last one. */
+    Stencils *stencils;
+
+    /* Attributes of faces and corners. Corners are tracked only when cage
+     * has attributes of them. */
+    Stencils *f_stencils;
+    Stencils *fv_stencils;
+};
+
+/* Topology */
+
+static int corner_cmp(const void *a, const void *b)
+{
+    const Corner *ca = (const Corner *)a;
+    const Corner *cb = (const Corner *)b;
+
+    if(ca->v0 != cb->v0)
+        return (ca->v0 < cb->v0) ? -1 : 1;
+    if(ca->v1 != cb->v1)
+        return (ca->v1 < cb->v1) ? -1 : 1;
+    return (ca->f < cb->f) ? -1 : (ca->f > cb->f);
+}
+
+/* Edges shared by more than two faces are treated as border ones. */
+static void build_edges(Level *l)
+{
+    guint c_num = l->f_offsets[l->f_num];
+    Corner *corners = g_new(Corner, c_num);
+
+    guint f, i;
+    for(f = 0; f < l->f_num; f++)
+    {
+        guint start = l->f_offsets[f], end = l->f_offsets[f + 1];
+        for(i = start; i < end; i++)
+        {
+            guint32 a = l->f_verts[i];
+            guint32 b = l->f_verts[(i + 1 < end) ? i + 1 : start];
+            corners[i].v0 = MIN(a, b);
+            corners[i].v1 = MAX(a, b);
+            corners[i].f  = f;
+            corners[i].i  = i;
+        }
+    }
+    qsort(corners, c_num, sizeof(Corner), corner_cmp);
+
+    l->edges   = g_new(Edge, c_num);
+    l->f_edges = g_new(guint32, c_num);
+    l->e_num   = 0;
+    for(i = 0; i < c_num;)
+    {
+        guint j = i + 1;
+        while(j < c_num && corners[j].v0 == corners[i].v0 && corners[j].v1 == corners[i].v1)
+            j++;
+
+        Edge *e = l->edges + l->e_num;
+        e->v0 = corners[i].v0;
+        e->v1 = corners[i].v1;
+        e->f0 = corners[i].f;
+        e->f1 = (j - i == 2) ? corners[i + 1].f : INVALID;
+        e->sharpness = 0;
+
+        for(; i < j; i++)
+            l->f_edges[corners[i].i] = l->e_num;
+        l->e_num++;
+    }
+
+    g_free(corners);
+}
+
+static guint32 find_edge(Level *l, guint32 a, guint32 b)
+{
+    guint32 v0 = MIN(a, b), v1 = MAX(a, b);
+    guint lo = 0, hi = l->e_num;
+    while(lo < hi)
+    {
+        guint mid = (lo + hi)/2;
+        Edge *e = l->edges + mid;
+        if(e->v0 < v0 || (e->v0 == v0 && e->v1 < v1))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if(lo < l->e_num && l->edges[lo].v0 == v0 && l->edges[lo].v1 == v1)
+        return lo;
+    return INVALID;
+}
+
+static void build_incidence(Level *l)
+{
+    guint i;
+
+    l->v_edge_offsets = g_new0(guint32, l->v_num + 1);
+    for(i = 0; i < l->e_num; i++)
+    {
+        l->v_edge_offsets[l->edges[i].v0 + 1]++;
+        l->v_edge_offsets[l->edges[i].v1 + 1]++;
+    }
+    for(i = 0; i < l->v_num; i++)
+        l->v_edge_offsets[i + 1] += l->v_edge_offsets[i];
+
+    guint32 *fill = g_memdup(l->v_edge_offsets, sizeof(guint32)*l->v_num);
+    l->v_edges = g_new(guint32, l->e_num*2);
+    for(i = 0; i < l->e_num; i++)
+    {
+        l->v_edges[fill[l->edges[i].v0]++] = i;
+        l->v_edges[fill[l->edges[i].v1]++] = i;
+    }
+
+    guint c_num = l->f_offsets[l->f_num];
+    l->v_face_offsets = g_new0(guint32, l->v_num + 1);
+    for(i = 0; i < c_num; i++)
+        l->v_face_offsets[l->f_verts[i] + 1]++;
+    for(i = 0; i < l->v_num; i++)
+        l->v_face_offsets[i + 1] += l->v_face_offsets[i];
+
+    memcpy(fill, l->v_face_offsets, sizeof(guint32)*l->v_num);
+    l->v_faces = g_new(guint32, c_num);
+    guint f;
+    for(f = 0; f < l->f_num; f++)
+        for(i = l->f_offsets[f]; i < l->f_offsets[f + 1]; i++)
+            l->v_faces[fill[l->f_verts[i]]++] = f;
+
+    g_free(fill);
+}
+
+static void level_free(Level *l)
+{
+    g_free(l->f_offsets);
+    g_free(l->f_verts);
+    g_free(l->edges);
+    g_free(l->f_edges);
+    g_free(l->v_edge_offsets);
+    g_free(l->v_edges);
+    g_free(l->v_face_offsets);
+    g_free(l->v_faces);
+    g_free(l->v_features);
+    g_slice_free(Level, l);
+}
+
+static gboolean is_sharp(Edge *e)
+{
+    return INVALID == e->f1 || e->sharpness > 0;
+}
+
+/* Weight of sharp rule, fractional sharpness blends it with smooth one. */
+static gfloat sharp_weight(Edge *e)
+{
+    return (INVALID == e->f1) ? 1 : MIN(e->sharpness, 1);
+}
+
+static void find_features(Level *l)
+{
+    l->v_features = g_new0(guint8, l->v_num);
+
+    guint v, i;
+    for(v = 0; v < l->v_num; v++)
+    {
+        guint valence = l->v_edge_offsets[v + 1] - l->v_edge_offsets[v];
+        gboolean sharp = FALSE;
+        for(i = l->v_edge_offsets[v]; i < l->v_edge_offsets[v + 1]; i++)
+            sharp = sharp || is_sharp(l->edges + l->v_edges[i]);
+
+        l->v_features[v] = (valence && valence != 4) || sharp;
+    }
+}
+
+/* Cage */
+
+static guint32 cage_face_end(MotoMesh *cage, guint f)
+{
+    return (cage->b32) ? cage->f_data32[f].v_offset : cage->f_data16[f].v_offset;
+}
+
+static guint32 cage_index(MotoMesh *cage, gpointer array, guint i)
+{
+    return (cage->b32) ? ((guint32 *)array)[i] : ((guint16 *)array)[i];
+}
+
+static gfloat cage_edge_sharpness(MotoMesh *cage, guint e)
+{
+    /* Hard flags are read by bytes since they are stored by 16 or 32 bit words. */
+    if(cage->e_hard_flags && (((guint8 *)cage->e_hard_flags)[e/8] & (1 << (e%8))))
+        return HARD_SHARPNESS;
+    if(cage->e_use_creases && cage->e_creases)
+        return MAX(cage->e_creases[e], 0);
+    return 0;
+}
+
+/* FNV-1a */
+static guint64 hash_bytes(guint64 h, gconstpointer data, gsize size)
+{
+    const guint8 *p = (const guint8 *)data;
+    const guint8 *end = p + size;
+    for(; p < end; p++)
+        h = (h ^ *p) * G_GUINT64_CONSTANT(1099511628211);
+    return h;
+}
+
+/* Topology and creases. Positions and tesselation don't matter. */
+static guint64 hash_cage(MotoMesh *cage)
+{
+    guint64 h = G_GUINT64_CONSTANT(14695981039346656037);
+    h = hash_bytes(h, & cage->v_num, sizeof(cage->v_num));
+    h = hash_bytes(h, & cage->f_num, sizeof(cage->f_num));
+
+    guint i;
+    for(i = 0; i < cage->f_num; i++)
+    {
+        guint32 end = cage_face_end(cage, i);
+        h = hash_bytes(h, & end, sizeof(end));
+    }
+    h = hash_bytes(h, cage->f_verts, cage->f_v_num*moto_mesh_get_index_size(cage));
+
+    if(cage->e_verts)
+    {
+        h = hash_bytes(h, cage->e_verts, cage->e_num*2*moto_mesh_get_index_size(cage));
+        for(i = 0; i < cage->e_num; i++)
+        {
+            gfloat s = cage_edge_sharpness(cage, i);
+            h = hash_bytes(h, & s, sizeof(s));
+        }
+    }
+
+    return h;
+}
+
+static Level *level_new_from_cage(MotoMesh *cage)
+{
+    Level *l = g_slice_new0(Level);
+
+    l->v_num = cage->v_num;
+    l->f_num = cage->f_num;
+    l->f_offsets = g_new(guint32, l->f_num + 1);
+    l->f_verts   = g_new(guint32, cage->f_v_num);
+
+    guint i;
+    l->f_offsets[0] = 0;
+    for(i = 0; i < l->f_num; i++)
+        l->f_offsets[i + 1] = cage_face_end(cage, i);
+    for(i = 0; i < cage->f_v_num; i++)
+        l->f_verts[i] = cage_index(cage, cage->f_verts, i);
+
+    build_edges(l);
+    build_incidence(l);
+
+    if(cage->e_verts)
+    {
+        for(i = 0; i < cage->e_num; i++)
+        {
+            guint32 a = cage_index(cage, cage->e_verts, i*2);
+            guint32 b = cage_index(cage, cage->e_verts, i*2 + 1);
+            if(a >= l->v_num || b >= l->v_num)
+                continue;
+
+            guint32 e = find_edge(l, a, b);
+            if(INVALID != e)
+                l->edges[e].sharpness = cage_edge_sharpness(cage, i);
+        }
+    }
+
+    find_features(l);
+
+    return l;
+}
+
+/* Refinement rules. Rows are combinations of verts of previous level. */
+
+static void rows_init(Rows *rows)
+{
+    rows->offsets = g_array_new(FALSE, FALSE, sizeof(guint32));
+    rows->indices = g_array_new(FALSE, FALSE, sizeof(guint32));
+    rows->weights = g_array_new(FALSE, FALSE, sizeof(gfloat));
+}
+
+static void rows_clear(Rows *rows)
+{
+    g_array_free(rows->offsets, TRUE);
+    g_array_free(rows->indices, TRUE);
+    g_array_free(rows->weights, TRUE);
+}
+
+static void rows_add(Rows *rows, guint32 index, gfloat weight)
+{
+    g_array_append_val(rows->indices, index);
+    g_array_append_val(rows->weights, weight);
+}
+
+static void rows_end(Rows *rows)
+{
+    guint32 offset = rows->indices->len;
+    g_array_append_val(rows->offsets, offset);
+}
+
+static void add_face_point(Rows *rows, Level *l, guint f, gfloat scale)
+{
+    guint start = l->f_offsets[f], end = l->f_offsets[f + 1];
+    gfloat w = scale/(end - start);
+
+    guint i;
+    for(i = start; i < end; i++)
+        rows_add(rows, l->f_verts[i], w);
+}
+
+static void add_edge_point(Rows *rows, Level *l, Edge *e)
+{
+    gfloat t = sharp_weight(e);
+
+    rows_add(rows, e->v0, t/2);
+    rows_add(rows, e->v1, t/2);
+
+    if(t < 1)
+    {
+        gfloat s = 1 - t;
+        rows_add(rows, e->v0, s/4);
+        rows_add(rows, e->v1, s/4);
+        add_face_point(rows, l, e->f0, s/4);
+        add_face_point(rows, l, e->f1, s/4);
+    }
+}
+
+static guint32 other_vert(Edge *e, guint32 v)
+{
+    return (e->v0 == v) ? e->v1 : e->v0;
+}
+
+static void add_vertex_point(Rows *rows, Level *l, guint32 v)
+{
+    guint n = l->v_edge_offsets[v + 1] - l->v_edge_offsets[v];
+
+    guint32 sharp[2];
+    guint sharp_num = 0;
+    gfloat t = 0;
+    gboolean border = FALSE;
+
+    guint i;
+    for(i = l->v_edge_offsets[v]; i < l->v_edge_offsets[v + 1]; i++)
+    {
+        Edge *e = l->edges + l->v_edges[i];
+        if( ! is_sharp(e))
+            continue;
+
+        if(sharp_num < 2)
+            sharp[sharp_num] = other_vert(e, v);
+        sharp_num++;
+        t += sharp_weight(e);
+        border = border || INVALID == e->f1;
+    }
+    t = (sharp_num < 2) ? 0 : MIN(t/sharp_num, 1);
+
+    /* Smooth rule is defined only for interior verts. */
+    if(border || n < 3)
+        t = 1;
+
+    if(t > 0)
+    {
+        if(2 == sharp_num)
+        {
+            rows_add(rows, v, t*3/4);
+            rows_add(rows, sharp[0], t/8);
+            rows_add(rows, sharp[1], t/8);
+        }
+        else
+            rows_add(rows, v, t);
+    }
+
+    if(t < 1)
+    {
+        gfloat s = 1 - t;
+        gfloat nn = (gfloat)n*n;
+
+        rows_add(rows, v, s*(n - 2)/n);
+        for(i = l->v_edge_offsets[v]; i < l->v_edge_offsets[v + 1]; i++)
+            rows_add(rows, other_vert(l->edges + l->v_edges[i], v), s/nn);
+        for(i = l->v_face_offsets[v]; i < l->v_face_offsets[v + 1]; i++)
+            add_face_point(rows, l, l->v_faces[i], s/nn);
+    }
+}
+
+static gboolean touches_refined_face(Level *l, const guint8 *refined, guint32 v)
+{
+    guint i;
+    for(i = l->v_face_offsets[v]; i < l->v_face_offsets[v + 1]; i++)
+        if(refined[l->v_faces[i]])
+            return TRUE;
+    return FALSE;
+}
+
+static gboolean is_edge_refined(Edge *e, const guint8 *refined)
+{
+    return refined[e->f0] || (INVALID != e->f1 && refined[e->f1]);
+}
+
+/* Sizes of next level, FALSE if they don't fit in 32 bit mesh. */
+static gboolean check_refined_size(Level *l, const guint8 *refined)
+{
+    guint64 v_num = l->v_num, f_num = 0, e_num = l->e_num;
+
+    guint i;
+    for(i = 0; i < l->e_num; i++)
+        if(is_edge_refined(l->edges + i, refined))
+        {
+            v_num++;
+            e_num++;
+        }
+
+    guint64 fv_num = 0;
+    for(i = 0; i < l->f_num; i++)
+    {
+        guint start = l->f_offsets[i], end = l->f_offsets[i + 1];
+        if(refined[i])
+        {
+            v_num++;
+            f_num += end - start;
+            e_num += end - start;
+            fv_num += (end - start)*4;
+        }
+        else
+        {
+            guint j;
+            f_num++;
+            for(j = start; j < end; j++)
+                fv_num += (is_edge_refined(l->edges + l->f_edges[j], refined)) ? 2 : 1;
+        }
+    }
+
+    return v_num <= MAX_INDEX && f_num <= MAX_INDEX && e_num*2 <= MAX_INDEX && fv_num <= MAX_INDEX;
+}
+
+/* Child verts are vertex points (with the same indices as parent verts),
+ * then edge points of refined edges and face points of refined faces. */
+/* Children of face take its attributes. Corners are interpolated linearly
+ * inside of parent face, so seams of UVs are kept. */
+static void add_face_rows(Rows *f_rows, Rows *fv_rows, Level *p, guint f,
+    const guint32 *ep, gboolean refined)
+{
+    guint start = p->f_offsets[f], end = p->f_offsets[f + 1];
+    guint j, k;
+
+    if( ! refined)
+    {
+        rows_add(f_rows, f, 1);
+        rows_end(f_rows);
+    }
+
+    for(j = start; j < end; j++)
+    {
+        guint prev = (j > start) ? j - 1 : end - 1;
+        guint next = (j < end - 1) ? j + 1 : start;
+
+        if(refined)
+        {
+            rows_add(f_rows, f, 1);
+            rows_end(f_rows);
+        }
+        if( ! fv_rows)
+            continue;
+
+        rows_add(fv_rows, j, 1);
+        rows_end(fv_rows);
+
+        if(refined || INVALID != ep[p->f_edges[j]])
+        {
+            rows_add(fv_rows, j, 0.5f);
+            rows_add(fv_rows, next, 0.5f);
+            rows_end(fv_rows);
+        }
+
+        if(refined)
+        {
+            for(k = start; k < end; k++)
+                rows_add(fv_rows, k, 1.0f/(end - start));
+            rows_end(fv_rows);
+
+            rows_add(fv_rows, prev, 0.5f);
+            rows_add(fv_rows, j, 0.5f);
+            rows_end(fv_rows);
+        }
+    }
+}
+
+static Level *refine(Level *p, const guint8 *refined, Rows *rows, Rows *f_rows, Rows *fv_rows)
+{
+    guint32 *ep = g_new(guint32, p->e_num);
+    guint32 *fp = g_new(guint32, p->f_num);
+
+    guint i, j;
+    guint ne = 0, nf = 0;
+    for(i = 0; i < p->e_num; i++)
+        ep[i] = is_edge_refined(p->edges + i, refined) ? p->v_num + ne++ : INVALID;
+    for(i = 0; i < p->f_num; i++)
+        fp[i] = (refined[i]) ? p->v_num + ne + nf++ : INVALID;
+
+    guint32 *ep_edges = g_new(guint32, ne);
+    for(i = 0; i < p->e_num; i++)
+        if(INVALID != ep[i])
+            ep_edges[ep[i] - p->v_num] = i;
+
+    Level *c = g_slice_new0(Level);
+    c->v_num = p->v_num + ne + nf;
+
+    /* Faces */
+    guint f_num = 0, f_v_num = 0;
+    for(i = 0; i < p->f_num; i++)
+    {
+        guint start = p->f_offsets[i], end = p->f_offsets[i + 1];
+        if(refined[i])
+        {
+            f_num += end - start;
+            f_v_num += (end - start)*4;
+        }
+        else
+        {
+            f_num++;
+            f_v_num += end - start;
+            for(j = start; j < end; j++)
+                if(INVALID != ep[p->f_edges[j]])
+                    f_v_num++;
+        }
+    }
+
+    c->f_num = f_num;
+    c->f_offsets = g_new(guint32, f_num + 1);
+    c->f_verts   = g_new(guint32, f_v_num);
+
+    guint cf = 0, co = 0;
+    c->f_offsets[0] = 0;
+    for(i = 0; i < p->f_num; i++)
+    {
+        guint start = p->f_offsets[i], end = p->f_offsets[i + 1];
+        if(refined[i])
+        {
+            for(j = start; j < end; j++)
+            {
+                guint prev = (j > start) ? j - 1 : end - 1;
+                c->f_verts[co++] = p->f_verts[j];
+                c->f_verts[co++] = ep[p->f_edges[j]];
+                c->f_verts[co++] = fp[i];
+                c->f_verts[co++] = ep[p->f_edges[prev]];
+                c->f_offsets[++cf] = co;
+            }
+        }
+        else
+        {
+            /* Edge points of refined neighbours are inserted, so there are no cracks. */
+            for(j = start; j < end; j++)
+            {
+                c->f_verts[co++] = p->f_verts[j];
+                if(INVALID != ep[p->f_edges[j]])
+                    c->f_verts[co++] = ep[p->f_edges[j]];
+            }
+            c->f_offsets[++cf] = co;
+        }
+    }
+    g_assert(cf == f_num && co == f_v_num);
+
+    for(i = 0; i < p->f_num; i++)
+        add_face_rows(f_rows, fv_rows, p, i, ep, refined[i]);
+
+    /* Rules */
+    for(i = 0; i < p->v_num; i++)
+    {
+        if(touches_refined_face(p, refined, i))
+            add_vertex_point(rows, p, i);
+        else
+            rows_add(rows, i, 1);
+        rows_end(rows);
+    }
+    for(i = 0; i < ne; i++)
+    {
+        add_edge_point(rows, p, p->edges + ep_edges[i]);
+        rows_end(rows);
+    }
+    for(i = 0; i < p->f_num; i++)
+        if(refined[i])
+        {
+            add_face_point(rows, p, i, 1);
+            rows_end(rows);
+        }
+
+    build_edges(c);
+    build_incidence(c);
+
+    /* Halves of edges are less sharp by one, not refined edges keep sharpness. */
+    guint pe_end = p->v_num + ne;
+    for(i = 0; i < c->e_num; i++)
+    {
+        Edge *e = c->edges + i;
+        if(e->v1 < p->v_num)
+        {
+            guint32 pe = find_edge(p, e->v0, e->v1);
+            if(INVALID != pe)
+                e->sharpness = p->edges[pe].sharpness;
+        }
+        else if(e->v0 < p->v_num && e->v1 < pe_end)
+        {
+            Edge *pe = p->edges + ep_edges[e->v1 - p->v_num];
+            if(pe->v0 == e->v0 || pe->v1 == e->v0)
+                e->sharpness = MAX(pe->sharpness - 1, 0);
+        }
+    }
+
+    c->v_features = g_new0(guint8, c->v_num);
+    memcpy(c->v_features, p->v_features, p->v_num);
+    for(i = 0; i < ne; i++)
+    {
+        Edge *pe = p->edges + ep_edges[i];
+        c->v_features[p->v_num + i] = INVALID == pe->f1 || pe->sharpness > 1;
+    }
+    for(i = 0, j = 0; i < p->f_num; i++)
+        if(refined[i])
+            c->v_features[pe_end + j++] = (p->f_offsets[i + 1] - p->f_offsets[i]) != 4;
+
+    g_free(ep);
+    g_free(fp);
+    g_free(ep_edges);
+
+    return c;
+}
+
+/* Stencils */
+
+static void stencils_free(Stencils *s)
+{
+    g_free(s->offsets);
+    g_free(s->indices);
+    g_free(s->weights);
+    g_slice_free(Stencils, s);
+}
+
+static Stencils *stencils_new_identity(guint num)
+{
+    Stencils *s = g_slice_new(Stencils);
+    s->num = num;
+    s->offsets = g_new(guint32, num + 1);
+    s->indices = g_new(guint32, num);
+    s->weights = g_new(gfloat, num);
+
+    guint i;
+    for(i = 0; i < num; i++)
+    {
+        s->offsets[i] = i;
+        s->indices[i] = i;
+        s->weights[i] = 1;
+    }
+    s->offsets[num] = num;
+
+    return s;
+}
+
+static int entry_cmp(const void *a, const void *b)
+{
+    guint32 ia = ((const Entry *)a)->index;
+    guint32 ib = ((const Entry *)b)->index;
+    return (ia < ib) ? -1 : (ia > ib);
+}
+
+typedef struct _ComposeData
+{
+    Stencils *src;
+    guint32 *offsets;
+    guint32 *indices;
+    gfloat *weights;
+
+    guint32 *sizes;
+    GArray *out_indices[MOTO_PARALLEL_MAX_CHUNKS];
+    GArray *out_weights[MOTO_PARALLEL_MAX_CHUNKS];
+} ComposeData;
+
+/* Child row is combination of parent rows, each of them is over verts of cage. */
+static void compose_range(gpointer data, guint chunk, guint begin, guint end)
+{
+    ComposeData *cd = (ComposeData *)data;
+    Stencils *src = cd->src;
+    GArray *indices = cd->out_indices[chunk];
+    GArray *weights = cd->out_weights[chunk];
+    GArray *entries = g_array_new(FALSE, FALSE, sizeof(Entry));
+
+    guint r, i, j;
+    for(r = begin; r < end; r++)
+    {
+        g_array_set_size(entries, 0);
+        for(i = cd->offsets[r]; i < cd->offsets[r + 1]; i++)
+        {
+            guint32 p = cd->indices[i];
+            gfloat a = cd->weights[i];
+            for(j = src->offsets[p]; j < src->offsets[p + 1]; j++)
+            {
+                Entry entry = {src->indices[j], a*src->weights[j]};
+                g_array_append_val(entries, entry);
+            }
+        }
+        qsort(entries->data, entries->len, sizeof(Entry), entry_cmp);
+
+        guint size = 0;
+        Entry *e = (Entry *)entries->data;
+        for(i = 0; i < entries->len;)
+        {
+            Entry sum = e[i];
+            for(i++; i < entries->len && e[i].index == sum.index; i++)
+                sum.weight += e[i].weight;
+
+            g_array_append_val(indices, sum.index);
+            g_array_append_val(weights, sum.weight);
+            size++;
+        }
+        cd->sizes[r] = size;
+    }
+
+    g_array_free(entries, TRUE);
+}
+
+static Stencils *compose(Stencils *src, Rows *rows)
+{
+    guint num = rows->offsets->len - 1;
+    guint chunks = moto_parallel_get_chunks_num(num, PARALLEL_MIN_ROWS);
+
+    ComposeData cd;
+    cd.src     = src;
+    cd.offsets = (guint32 *)rows->offsets->data;
+    cd.indices = (guint32 *)rows->indices->data;
+    cd.weights = (gfloat *)rows->weights->data;
+    cd.sizes   = g_new(guint32, num);
+
+    guint i;
+    for(i = 0; i < chunks; i++)
+    {
+        cd.out_indices[i] = g_array_new(FALSE, FALSE, sizeof(guint32));
+        cd.out_weights[i] = g_array_new(FALSE, FALSE, sizeof(gfloat));
+    }
+
+    moto_parallel_for(compose_range, & cd, num, PARALLEL_MIN_ROWS);
+
+    /* Chunks are consecutive, so rows are joined in order. */
+    Stencils *s = g_slice_new(Stencils);
+    s->num = num;
+    s->offsets = g_new(guint32, num + 1);
+    s->offsets[0] = 0;
+    for(i = 0; i < num; i++)
+        s->offsets[i + 1] = s->offsets[i] + cd.sizes[i];
+
+    s->indices = g_new(guint32, s->offsets[num]);
+    s->weights = g_new(gfloat, s->offsets[num]);
+    guint32 offset = 0;
+    for(i = 0; i < chunks; i++)
+    {
+        memcpy(s->indices + offset, cd.out_indices[i]->data, sizeof(guint32)*cd.out_indices[i]->len);
+        memcpy(s->weights + offset, cd.out_weights[i]->data, sizeof(gfloat)*cd.out_weights[i]->len);
+        offset += cd.out_indices[i]->len;
+
+        g_array_free(cd.out_indices[i], TRUE);
+        g_array_free(cd.out_weights[i], TRUE);
+    }
+    g_free(cd.sizes);
+
+    return s;
+}
+
+static Stencils *compose_and_free(Stencils *src, Rows *rows)
+{
+    Stencils *s = compose(src, rows);
+    stencils_free(src);
+    return s;
+}
+
+static gboolean has_face_vert_attrs(MotoMesh *cage)
+{
+    guint i;
+    for(i = 0; i < moto_mesh_get_attrs_num(cage); i++)
+    {
+        MotoMeshAttr *attr = moto_mesh_get_attr(cage, i);
+        if(attr && MOTO_MESH_ATTR_FACE_VERT == attr->domain)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* class MotoMeshSubdiv */
+
+MotoMeshSubdiv *moto_mesh_subdiv_new(MotoMesh *cage, guint levels, gboolean adaptive)
+{
+    MotoMeshSubdiv *self = g_slice_new(MotoMeshSubdiv);
+    self->cage_hash = hash_cage(cage);
+    self->requested_levels = levels;
+    self->adaptive = adaptive;
+    self->levels   = 0;
+    self->level    = level_new_from_cage(cage);
+    self->stencils = stencils_new_identity(cage->v_num);
+    self->f_stencils  = stencils_new_identity(cage->f_num);
+    self->fv_stencils = (has_face_vert_attrs(cage)) ? stencils_new_identity(cage->f_v_num) : NULL;
+
+    guint8 *refined = NULL;
+    for(; self->levels < levels; self->levels++)
+    {
+        Level *l = self->level;
+        refined = g_realloc(refined, l->f_num);
+
+        gboolean any = FALSE;
+        guint i, j;
+        for(i = 0; i < l->f_num; i++)
+        {
+            refined[i] = ! adaptive || 0 == self->levels;
+            for(j = l->f_offsets[i]; j < l->f_offsets[i + 1] && ! refined[i]; j++)
+                refined[i] = l->v_features[l->f_verts[j]];
+            any = any || refined[i];
+        }
+        if( ! any)
+            break;
+
+        if( ! check_refined_size(l, refined))
+        {
+            moto_warning("Subdivided mesh is limited by %u levels, more ones don't fit in 32 bit indices",
+                self->levels);
+            break;
+        }
+
+        Rows rows, f_rows, fv_rows;
+        rows_init(& rows);
+        rows_init(& f_rows);
+        rows_init(& fv_rows);
+        rows_end(& rows);
+        rows_end(& f_rows);
+        rows_end(& fv_rows);
+
+        self->level = refine(l, refined, & rows, & f_rows, (self->fv_stencils) ? & fv_rows : NULL);
+        level_free(l);
+
+        self->stencils    = compose_and_free(self->stencils, & rows);
+        self->f_stencils  = compose_and_free(self->f_stencils, & f_rows);
+        if(self->fv_stencils)
+            self->fv_stencils = compose_and_free(self->fv_stencils, & fv_rows);
+
+        rows_clear(& rows);
+        rows_clear(& f_rows);
+        rows_clear(& fv_rows);
+    }
+    g_free(refined);
+
+    return self;
+}
+
+void moto_mesh_subdiv_free(MotoMeshSubdiv *self)
+{
+    level_free(self->level);
+    stencils_free(self->stencils);
+    stencils_free(self->f_stencils);
+    if(self->fv_stencils)
+        stencils_free(self->fv_stencils);
+    g_slice_free(MotoMeshSubdiv, self);
+}
+
+gboolean moto_mesh_subdiv_matches(MotoMeshSubdiv *self, MotoMesh *cage,
+        guint levels, gboolean adaptive)
+{
+    return self->requested_levels == levels && self->adaptive == adaptive &&
+        (self->fv_stencils || ! has_face_vert_attrs(cage)) &&
+        self->cage_hash == hash_cage(cage);
+}
+
+guint moto_mesh_subdiv_get_levels(MotoMeshSubdiv *self)
+{
+    return self->levels;
+}
+
+guint moto_mesh_subdiv_get_v_num(MotoMeshSubdiv *self)
+{
+    return self->level->v_num;
+}
+
+guint moto_mesh_subdiv_get_f_num(MotoMeshSubdiv *self)
+{
+    return self->level->f_num;
+}
+
+typedef struct _EvalData
+{
+    Stencils *stencils;
+    MotoVector *src;
+    MotoVector *dst;
+} EvalData;
+
+static void eval_range(gpointer data, guint chunk, guint begin, guint end)
+{
+    EvalData *ed = (EvalData *)data;
+    Stencils *s = ed->stencils;
+
+    guint r, i;
+    for(r = begin; r < end; r++)
+    {
+        gfloat x = 0, y = 0, z = 0;
+        for(i = s->offsets[r]; i < s->offsets[r + 1]; i++)
+        {
+            MotoVector *v = ed->src + s->indices[i];
+            gfloat w = s->weights[i];
+            x += w*v->x;
+            y += w*v->y;
+            z += w*v->z;
+        }
+
+        MotoVector *v = ed->dst + r;
+        v->x = x;
+        v->y = y;
+        v->z = z;
+        v->w = 1;
+    }
+}
+
+static void eval_positions(MotoMeshSubdiv *self, MotoMesh *cage, MotoMesh *mesh)
+{
+    EvalData ed = {self->stencils, cage->v_coords, mesh->v_coords};
+    moto_parallel_for(eval_range, & ed, self->stencils->num, PARALLEL_MIN_ROWS);
+}
+
+/* Attributes of mesh are interpolated from ones of cage by the same stencils. */
+static void eval_attrs(MotoMeshSubdiv *self, MotoMesh *cage, MotoMesh *mesh)
+{
+    guint i;
+    for(i = 0; i < moto_mesh_get_attrs_num(cage); i++)
+    {
+        MotoMeshAttr *src = moto_mesh_get_attr(cage, i);
+        if( ! src)
+            continue;
+
+        Stencils *s = self->stencils;
+        if(MOTO_MESH_ATTR_FACE == src->domain)
+            s = self->f_stencils;
+        else if(MOTO_MESH_ATTR_FACE_VERT == src->domain)
+            s = self->fv_stencils;
+        if( ! s)
+            continue;
+
+        MotoMeshAttr *dst = moto_mesh_get_attr_like(mesh, src);
+        if(dst)
+            moto_mesh_attr_interpolate(dst, src, s->offsets, s->indices, s->weights);
+    }
+}
+
+MotoMesh *moto_mesh_subdiv_create_mesh(MotoMeshSubdiv *self, MotoMesh *cage)
+{
+    Level *l = self->level;
+    MotoMesh *mesh = moto_mesh_new(l->v_num, l->e_num, l->f_num, l->f_offsets[l->f_num]);
+    if( ! mesh)
+        return NULL;
+
+    /* Mesh takes 32 bit indices when it's too big for 16 bit ones. */
+    guint i;
+    if(mesh->b32)
+    {
+        for(i = 0; i < l->f_num; i++)
+            mesh->f_data32[i].v_offset = l->f_offsets[i + 1];
+        memcpy(mesh->f_verts32, l->f_verts, l->f_offsets[l->f_num]*sizeof(guint32));
+    }
+    else
+    {
+        for(i = 0; i < l->f_num; i++)
+            mesh->f_data16[i].v_offset = l->f_offsets[i + 1];
+        for(i = 0; i < l->f_offsets[l->f_num]; i++)
+            mesh->f_verts16[i] = l->f_verts[i];
+    }
+
+    eval_positions(self, cage, mesh);
+    eval_attrs(self, cage, mesh);
+
+    if( ! moto_mesh_prepare(mesh))
+    {
+        g_object_unref(mesh);
+        return NULL;
+    }
+    return mesh;
+}
+
+void moto_mesh_subdiv_apply(MotoMeshSubdiv *self, MotoMesh *cage, MotoMesh *mesh)
+{
+    eval_positions(self, cage, mesh);
+    eval_attrs(self, cage, mesh);
+
+    /* Topology is the same, so tesselation of create_mesh is kept. */
+    moto_mesh_calc_normals(mesh);
+    moto_shape_update_bound((MotoShape *)mesh);
+    moto_shape_touch((MotoShape *)mesh);
+}
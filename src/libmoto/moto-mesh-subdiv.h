@@ -0,0 +1,60 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_MESH_SUBDIV_H__
+#define __MOTO_MESH_SUBDIV_H__
+
+#include <glib.h>
+
+#include "moto-mesh.h"
+
+G_BEGIN_DECLS
+
+typedef struct _MotoMeshSubdiv MotoMeshSubdiv;
+
+/* Catmull-Clark refinement of cage topology. Each vert of refined mesh is
+ * a stencil (weighted sum of verts of cage), so when only positions of cage
+ * change refined mesh is updated by moto_mesh_subdiv_apply.
+ *
+ * Sharpness of edges is taken from e_creases and e_hard_flags of cage, border
+ * edges are sharp. In adaptive mode only first level is uniform, following
+ * ones refine only faces touching extraordinary verts and creases. Edge points
+ * are inserted into not refined neighbours, so there are no cracks. */
+MotoMeshSubdiv *moto_mesh_subdiv_new(MotoMesh *cage, guint levels, gboolean adaptive);
+void moto_mesh_subdiv_free(MotoMeshSubdiv *self);
+
+/* TRUE if cage has the same topology and creases as one subdiv is made from. */
+gboolean moto_mesh_subdiv_matches(MotoMeshSubdiv *self, MotoMesh *cage,
+        guint levels, gboolean adaptive);
+
+guint moto_mesh_subdiv_get_levels(MotoMeshSubdiv *self);
+guint moto_mesh_subdiv_get_v_num(MotoMeshSubdiv *self);
+guint moto_mesh_subdiv_get_f_num(MotoMeshSubdiv *self);
+
+/* New refined mesh with positions from cage. */
+MotoMesh *moto_mesh_subdiv_create_mesh(MotoMeshSubdiv *self, MotoMesh *cage);
+
+/* Rewrites positions and normals of mesh made by create_mesh in place. */
+void moto_mesh_subdiv_apply(MotoMeshSubdiv *self, MotoMesh *cage, MotoMesh *mesh);
+
+G_END_DECLS
+
+#endif /* __MOTO_MESH_SUBDIV_H__ */
@@ -0,0 +1,456 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "moto-messager.h"
+#include "moto-parallel.h"
+#include "moto-mesh-weld.h"
+
+#define INVALID G_MAXUINT32
+
+/* Verts and faces are split between threads only when there are enough of them. */
+#define PARALLEL_MIN_ITEMS 4096
+
+/* Uniform grid with cell of welding distance. Cells are hashed into buckets,
+ * verts of each bucket are sorted by index. */
+typedef struct _WeldGrid
+{
+    gfloat cell;
+    guint32 mask;
+    guint32 *offsets; /* buckets + 1 */
+    guint32 *verts;
+    guint32 *v_buckets;
+} WeldGrid;
+
+typedef struct _WeldData
+{
+    MotoMesh *mesh;
+    gfloat distance2;
+    WeldGrid grid;
+
+    guint32 *nearest; /* The first vert within distance, it may be the vert itself. */
+    guint32 *rep;     /* The first vert of group. */
+
+    guint32 *f_verts;   /* Loops with representative verts at the same offsets. */
+    guint32 *f_corners; /* Source corners of f_verts, for attributes of corners. */
+    guint32 *f_sizes; /* Zero for degenerate faces. */
+    guint64 *f_hashes;
+} WeldData;
+
+typedef struct _WeldFaceKey
+{
+    guint64 hash;
+    guint32 size;
+    guint32 index;
+} WeldFaceKey;
+
+static guint32 get_index(MotoMesh *mesh, gpointer array, guint i)
+{
+    return (mesh->b32) ? ((guint32 *)array)[i] : ((guint16 *)array)[i];
+}
+
+static guint32 get_face_start(MotoMesh *mesh, guint fi)
+{
+    if(0 == fi)
+        return 0;
+    return (mesh->b32) ? mesh->f_data32[fi-1].v_offset : mesh->f_data16[fi-1].v_offset;
+}
+
+static gint64 get_cell(gfloat coord, gfloat cell)
+{
+    gdouble c = floor(coord/cell);
+    return (gint64)CLAMP(c, -1e15, 1e15);
+}
+
+static guint32 hash_cell(gint64 x, gint64 y, gint64 z)
+{
+    return (guint32)(x*73856093 ^ y*19349663 ^ z*83492791);
+}
+
+static void bucket_range(gpointer data, guint chunk, guint begin, guint end)
+{
+    WeldData *wd = (WeldData *)data;
+    WeldGrid *g = & wd->grid;
+
+    guint i;
+    for(i = begin; i < end; i++)
+    {
+        MotoVector *v = wd->mesh->v_coords + i;
+        g->v_buckets[i] = hash_cell(get_cell(v->x, g->cell),
+                                    get_cell(v->y, g->cell),
+                                    get_cell(v->z, g->cell)) & g->mask;
+    }
+}
+
+static void build_grid(WeldData *wd, gfloat cell)
+{
+    WeldGrid *g = & wd->grid;
+    guint v_num = wd->mesh->v_num;
+
+    guint buckets = 1;
+    while(buckets < v_num*2)
+        buckets <<= 1;
+
+    g->cell = cell;
+    g->mask = buckets - 1;
+    g->v_buckets = g_new(guint32, v_num);
+    moto_parallel_for(bucket_range, wd, v_num, PARALLEL_MIN_ITEMS);
+
+    /* Counting sort keeps order of verts in buckets. */
+    g->offsets = g_new0(guint32, buckets + 1);
+    guint i;
+    for(i = 0; i < v_num; i++)
+        g->offsets[g->v_buckets[i] + 1]++;
+    for(i = 0; i < buckets; i++)
+        g->offsets[i + 1] += g->offsets[i];
+
+    guint32 *fill = g_memdup(g->offsets, sizeof(guint32)*buckets);
+    g->verts = g_new(guint32, v_num);
+    for(i = 0; i < v_num; i++)
+        g->verts[fill[g->v_buckets[i]]++] = i;
+    g_free(fill);
+}
+
+static void nearest_range(gpointer data, guint chunk, guint begin, guint end)
+{
+    WeldData *wd = (WeldData *)data;
+    WeldGrid *g = & wd->grid;
+    MotoVector *coords = wd->mesh->v_coords;
+
+    guint i, k;
+    gint dx, dy, dz;
+    for(i = begin; i < end; i++)
+    {
+        MotoVector *v = coords + i;
+        gint64 cx = get_cell(v->x, g->cell);
+        gint64 cy = get_cell(v->y, g->cell);
+        gint64 cz = get_cell(v->z, g->cell);
+
+        guint32 best = i;
+        for(dx = -1; dx <= 1; dx++)
+            for(dy = -1; dy <= 1; dy++)
+                for(dz = -1; dz <= 1; dz++)
+                {
+                    guint32 b = hash_cell(cx + dx, cy + dy, cz + dz) & g->mask;
+                    for(k = g->offsets[b]; k < g->offsets[b + 1]; k++)
+                    {
+                        guint32 j = g->verts[k];
+                        if(j >= best)
+                            break;
+
+                        MotoVector *u = coords + j;
+                        gfloat x = u->x - v->x, y = u->y - v->y, z = u->z - v->z;
+                        if(x*x + y*y + z*z <= wd->distance2)
+                        {
+                            best = j;
+                            break;
+                        }
+                    }
+                }
+        wd->nearest[i] = best;
+    }
+}
+
+static int guint32_cmp(const void *a, const void *b)
+{
+    guint32 ia = *(const guint32 *)a, ib = *(const guint32 *)b;
+    return (ia < ib) ? -1 : (ia > ib);
+}
+
+/* FNV-1a over sorted verts, so order and orientation of loop don't matter. */
+static guint64 hash_face(guint32 *verts, guint32 size)
+{
+    guint32 sorted[size];
+    memcpy(sorted, verts, sizeof(guint32)*size);
+    qsort(sorted, size, sizeof(guint32), guint32_cmp);
+
+    guint64 h = G_GUINT64_CONSTANT(14695981039346656037);
+    const guint8 *p = (const guint8 *)sorted;
+    const guint8 *end = p + sizeof(guint32)*size;
+    for(; p < end; p++)
+        h = (h ^ *p) * G_GUINT64_CONSTANT(1099511628211);
+    return h;
+}
+
+static void face_range(gpointer data, guint chunk, guint begin, guint end)
+{
+    WeldData *wd = (WeldData *)data;
+    MotoMesh *mesh = wd->mesh;
+
+    guint fi, i;
+    for(fi = begin; fi < end; fi++)
+    {
+        guint32 start = get_face_start(mesh, fi);
+        guint32 v_num = get_face_start(mesh, fi + 1) - start;
+        guint32 *loop = wd->f_verts + start;
+
+        /* Edges collapsed by welding are removed from loop. */
+        guint32 size = 0;
+        for(i = 0; i < v_num; i++)
+        {
+            guint32 v = wd->rep[get_index(mesh, mesh->f_verts, start + i)];
+            if(0 == size || loop[size - 1] != v)
+            {
+                wd->f_corners[start + size] = start + i;
+                loop[size++] = v;
+            }
+        }
+        while(size > 1 && loop[size - 1] == loop[0])
+            size--;
+
+        wd->f_sizes[fi]  = (size < 3) ? 0 : size;
+        wd->f_hashes[fi] = (size < 3) ? 0 : hash_face(loop, size);
+    }
+}
+
+static int face_key_cmp(const void *a, const void *b)
+{
+    const WeldFaceKey *ka = (const WeldFaceKey *)a;
+    const WeldFaceKey *kb = (const WeldFaceKey *)b;
+
+    if(ka->hash != kb->hash)
+        return (ka->hash < kb->hash) ? -1 : 1;
+    if(ka->size != kb->size)
+        return (ka->size < kb->size) ? -1 : 1;
+    return (ka->index < kb->index) ? -1 : (ka->index > kb->index);
+}
+
+static gboolean is_face_the_same(WeldData *wd, guint32 a, guint32 b)
+{
+    guint32 size = wd->f_sizes[a];
+    guint32 sa[size], sb[size];
+    memcpy(sa, wd->f_verts + get_face_start(wd->mesh, a), sizeof(guint32)*size);
+    memcpy(sb, wd->f_verts + get_face_start(wd->mesh, b), sizeof(guint32)*size);
+    qsort(sa, size, sizeof(guint32), guint32_cmp);
+    qsort(sb, size, sizeof(guint32), guint32_cmp);
+    return 0 == memcmp(sa, sb, sizeof(guint32)*size);
+}
+
+/* The first of equal faces is kept. */
+static void remove_duplicate_faces(WeldData *wd)
+{
+    guint f_num = wd->mesh->f_num;
+    WeldFaceKey *keys = g_new(WeldFaceKey, f_num);
+
+    guint i, j, num = 0;
+    for(i = 0; i < f_num; i++)
+    {
+        if( ! wd->f_sizes[i])
+            continue;
+        keys[num].hash  = wd->f_hashes[i];
+        keys[num].size  = wd->f_sizes[i];
+        keys[num].index = i;
+        num++;
+    }
+    qsort(keys, num, sizeof(WeldFaceKey), face_key_cmp);
+
+    for(i = 0; i < num;)
+    {
+        guint end = i + 1;
+        while(end < num && keys[end].hash == keys[i].hash && keys[end].size == keys[i].size)
+            end++;
+
+        for(; i < end; i++)
+        {
+            if( ! wd->f_sizes[keys[i].index])
+                continue;
+            for(j = i + 1; j < end; j++)
+                if(wd->f_sizes[keys[j].index] && is_face_the_same(wd, keys[i].index, keys[j].index))
+                    wd->f_sizes[keys[j].index] = 0;
+        }
+    }
+
+    g_free(keys);
+}
+
+/* Edges of mesh take flags and creases of source edges between the same verts.
+ * Edge is hard if any of merged edges is hard, crease is the greatest one. */
+static void weld_edges(MotoMesh *mesh, MotoMesh *self, const guint32 *v_remap)
+{
+    gboolean hard = FALSE;
+    guint i;
+    for(i = 0; self->e_hard_flags && i < self->e_num/32 + 1; i++)
+        hard = hard || self->e_hard_flags[i];
+    gboolean creases = self->e_use_creases && self->e_creases;
+    if( ! self->e_num || ! mesh->e_num || ( ! hard && ! creases))
+        return;
+
+    /* Source edges listed by the less new vert. */
+    guint32 *first = g_new(guint32, mesh->v_num);
+    guint32 *next  = g_new(guint32, self->e_num);
+    for(i = 0; i < mesh->v_num; i++)
+        first[i] = INVALID;
+    for(i = 0; i < self->e_num; i++)
+    {
+        guint32 a = v_remap[get_index(self, self->e_verts, i*2)];
+        guint32 b = v_remap[get_index(self, self->e_verts, i*2 + 1)];
+        next[i] = INVALID;
+        if(INVALID == a || INVALID == b || a == b)
+            continue;
+        next[i] = first[MIN(a, b)];
+        first[MIN(a, b)] = i;
+    }
+
+    if(creases)
+    {
+        mesh->e_use_creases = TRUE;
+        mesh->e_creases = g_new0(gfloat, mesh->e_num);
+    }
+
+    for(i = 0; i < mesh->e_num; i++)
+    {
+        guint32 a = get_index(mesh, mesh->e_verts, i*2);
+        guint32 b = get_index(mesh, mesh->e_verts, i*2 + 1);
+
+        guint32 ei;
+        for(ei = first[MIN(a, b)]; ei != INVALID; ei = next[ei])
+        {
+            guint32 ea = v_remap[get_index(self, self->e_verts, ei*2)];
+            guint32 eb = v_remap[get_index(self, self->e_verts, ei*2 + 1)];
+            if(MAX(ea, eb) != MAX(a, b))
+                continue;
+
+            if(hard && (self->e_hard_flags[ei/32] & (1u << (ei%32))))
+                mesh->e_hard_flags[i/32] |= 1u << (i%32);
+            if(creases)
+                mesh->e_creases[i] = MAX(mesh->e_creases[i], self->e_creases[ei]);
+        }
+    }
+
+    g_free(first);
+    g_free(next);
+}
+
+/* Verts take attributes of the first vert of their group and corners take
+ * attributes of source corners which are left in loops. */
+static void weld_attrs(WeldData *wd, MotoMesh *mesh, const guint32 *remap)
+{
+    MotoMesh *self = wd->mesh;
+    guint32 *v_remap = g_new(guint32, self->v_num);
+    guint32 *v_map   = g_new(guint32, mesh->v_num);
+    guint32 *f_map   = g_new(guint32, mesh->f_num);
+    guint32 *fv_map  = g_new(guint32, mesh->f_v_num);
+
+    guint i, j;
+    for(i = 0; i < self->v_num; i++)
+    {
+        v_remap[i] = remap[wd->rep[i]];
+        if(INVALID != remap[i])
+            v_map[remap[i]] = i;
+    }
+
+    guint32 fi = 0, offset = 0;
+    for(i = 0; i < self->f_num; i++)
+    {
+        if( ! wd->f_sizes[i])
+            continue;
+
+        guint32 start = get_face_start(self, i);
+        for(j = 0; j < wd->f_sizes[i]; j++)
+            fv_map[offset++] = wd->f_corners[start + j];
+        f_map[fi++] = i;
+    }
+
+    moto_mesh_copy_attrs(mesh, self, v_map, f_map, fv_map);
+    weld_edges(mesh, self, v_remap);
+
+    g_free(v_remap);
+    g_free(v_map);
+    g_free(f_map);
+    g_free(fv_map);
+}
+
+MotoMesh *moto_mesh_weld(MotoMesh *self, gfloat distance, gboolean duplicate_faces)
+{
+    WeldData wd;
+    wd.mesh = self;
+    wd.distance2 = distance*distance;
+
+    guint v_num = self->v_num;
+    guint f_num = self->f_num;
+    guint i, j;
+
+    /* Zero distance merges only verts in the same place. */
+    build_grid(& wd, MAX(distance, 1e-6));
+
+    wd.nearest = g_new(guint32, v_num);
+    moto_parallel_for(nearest_range, & wd, v_num, PARALLEL_MIN_ITEMS);
+
+    /* Nearest vert has less index, so its group is already known. */
+    wd.rep = g_new(guint32, v_num);
+    for(i = 0; i < v_num; i++)
+        wd.rep[i] = (wd.nearest[i] == i) ? i : wd.rep[wd.nearest[i]];
+
+    wd.f_verts  = g_new(guint32, self->f_v_num);
+    wd.f_corners = g_new(guint32, self->f_v_num);
+    wd.f_sizes  = g_new(guint32, f_num);
+    wd.f_hashes = g_new(guint64, f_num);
+    moto_parallel_for(face_range, & wd, f_num, PARALLEL_MIN_ITEMS);
+
+    if(duplicate_faces)
+        remove_duplicate_faces(& wd);
+
+    /* Only verts of remaining faces are kept. */
+    guint32 *remap = g_new(guint32, v_num);
+    for(i = 0; i < v_num; i++)
+        remap[i] = INVALID;
+
+    guint new_f_num = 0, new_f_v_num = 0, new_v_num = 0;
+    for(i = 0; i < f_num; i++)
+    {
+        if( ! wd.f_sizes[i])
+            continue;
+
+        guint32 *loop = wd.f_verts + get_face_start(self, i);
+        for(j = 0; j < wd.f_sizes[i]; j++)
+            if(INVALID == remap[loop[j]])
+                remap[loop[j]] = new_v_num++;
+
+        new_f_num++;
+        new_f_v_num += wd.f_sizes[i];
+    }
+
+    MotoMesh *mesh = (new_f_num) ? moto_mesh_new(new_v_num, 0, new_f_num, new_f_v_num) : NULL;
+    if(mesh)
+    {
+        for(i = 0; i < v_num; i++)
+            if(INVALID != remap[i])
+                mesh->v_coords[remap[i]] = self->v_coords[i];
+
+        guint32 fi = 0, offset = 0;
+        for(i = 0; i < f_num; i++)
+        {
+            if( ! wd.f_sizes[i])
+                continue;
+
+            guint32 *loop = wd.f_verts + get_face_start(self, i);
+            for(j = 0; j < wd.f_sizes[i]; j++)
+                loop[j] = remap[loop[j]];
+
+            offset += wd.f_sizes[i];
+            moto_mesh_set_face(mesh, fi++, offset, loop);
+        }
+
+        if( ! moto_mesh_prepare(mesh))
+        {
+            moto_warning("Welded mesh has edges shared by more than two faces");
+            g_object_unref(mesh);
+            mesh = NULL;
+        }
+        else
+            weld_attrs(& wd, mesh, remap);
+    }
+
+    g_free(remap);
+    g_free(wd.f_verts);
+    g_free(wd.f_corners);
+    g_free(wd.f_sizes);
+    g_free(wd.f_hashes);
+    g_free(wd.rep);
+    g_free(wd.nearest);
+    g_free(wd.grid.offsets);
+    g_free(wd.grid.verts);
+    g_free(wd.grid.v_buckets);
+
+    return mesh;
+}
@@ -0,0 +1,41 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_MESH_WELD_H__
+#define __MOTO_MESH_WELD_H__
+
+#include <glib.h>
+
+#include "moto-mesh.h"
+
+G_BEGIN_DECLS
+
+/* Merges verts which are closer than distance and rebuilds connectivity once.
+ * Neighbours are found with uniform spatial hash in parallel, vert takes place
+ * of the first vert of its group. Faces which lose verts below three are
+ * removed, duplicate faces (the same verts in any order) are removed too if
+ * duplicate_faces is TRUE. Attributes, hard flags and creases of edges are
+ * kept. Returns new mesh or NULL if result isn't valid. */
+MotoMesh *moto_mesh_weld(MotoMesh *self, gfloat distance, gboolean duplicate_faces);
+
+G_END_DECLS
+
+#endif /* __MOTO_MESH_WELD_H__ */
@@ -1,14 +1,13 @@
 #include <string.h>
 
-#ifdef __SSE__
-#include <xmmintrin.h>
-#endif
-
 #include "moto-mesh.h"
+#include "moto-mem-pool.h"
 #include "moto-copyable.h"
 #include "moto-point-cloud.h"
 #include "moto-edge-list.h"
 #include "moto-messager.h"
+#include "moto-parallel.h"
+#include "moto-profiler.h"
 #include "libmotoutil/xform.h"
 
 #ifndef CALLBACK
@@ -36,13 +35,29 @@ static void moto_mesh_select_inverse(MotoShape* self,
 
 static GObjectClass *mesh_parent_class = NULL;
 
-static void
-free_attr(GQuark key_id, gpointer data, gpointer user_data)
+static void free_attr(MotoMeshAttr *attr)
 {
-    MotoMeshVertAttr *attr = (MotoMeshVertAttr *)data;
+    if( ! attr)
+        return;
 
-    g_free(attr->data);
-    g_slice_free(MotoMeshVertAttr, attr);
+    moto_mem_pool_free(attr->data);
+    g_slice_free(MotoMeshAttr, attr);
+}
+
+/* Arrays may be reallocated after moto_mesh_new, only those out of block are freed. */
+static void free_array(MotoMesh *self, gpointer array)
+{
+    guint8 *block = (guint8 *)self->block;
+    if(block && (guint8 *)array >= block && (guint8 *)array < block + self->block_size)
+        return;
+    g_free(array);
+}
+
+static gpointer carve_array(guint8 **ptr, gsize size)
+{
+    gpointer array = *ptr;
+    *ptr += moto_mem_pool_align(size);
+    return array;
 }
 
 static void
@@ -51,31 +66,37 @@ moto_mesh_dispose(GObject *obj)
     MotoMesh *self = (MotoMesh *)obj;
 
     // Free verts
-    g_free(self->v_data);
-#ifdef __SSE__
-    _mm_free(self->v_coords);
-    _mm_free(self->v_normals);
-#else
-    g_free(self->v_coords);
-    g_free(self->v_normals);
-#endif
-    g_datalist_foreach(& self->v_attrs, free_attr, NULL);
-    g_datalist_clear(& self->v_attrs);
+    free_array(self, self->v_data);
+    free_array(self, self->v_coords);
+    free_array(self, self->v_normals);
+
+    // Free attributes
+    if(self->attrs)
+    {
+        guint i;
+        for(i = 0; i < self->attrs->len; i++)
+            free_attr((MotoMeshAttr *)g_ptr_array_index(self->attrs, i));
+        g_ptr_array_free(self->attrs, TRUE);
+        self->attrs = NULL;
+    }
 
     // Free edges
-    g_free(self->e_verts);
-    g_free(self->e_hard_flags);
+    free_array(self, self->e_verts);
+    free_array(self, self->e_hard_flags);
     g_free(self->e_creases);
 
     // Free faces
-    g_free(self->f_data);
-    g_free(self->f_verts);
+    free_array(self, self->f_data);
+    free_array(self, self->f_verts);
     g_free(self->f_tess_verts);
-    g_free(self->f_normals);
+    free_array(self, self->f_normals);
     g_free(self->f_hidden_flags);
 
     // Free half-edge data
-    g_free(self->he_data);
+    free_array(self, self->he_data);
+
+    moto_mem_pool_free(self->block);
+    self->block = NULL;
 
     G_OBJECT_CLASS(mesh_parent_class)->dispose(obj);
 }
@@ -93,7 +114,7 @@ moto_mesh_init(MotoMesh *self)
     self->v_data    = NULL;
     self->v_coords  = NULL;
     self->v_normals = NULL;
-    g_datalist_init(& self->v_attrs);
+    self->v_packed  = NULL;
 
     self->e_num     = 0;
     self->e_verts   = NULL;
@@ -113,6 +134,11 @@ moto_mesh_init(MotoMesh *self)
 
     self->he_calculated = FALSE;
     self->he_data = NULL;
+
+    self->attrs = g_ptr_array_new();
+
+    self->block = NULL;
+    self->block_size = 0;
 }
 
 static void
@@ -160,41 +186,46 @@ MotoMesh *moto_mesh_new(guint v_num, guint e_num, guint f_num, guint f_verts_num
 
     guint num, i;
 
+    /* All arrays are carved from one block, so mesh recreated with close
+     * sizes takes memory of previous one from pool. */
+    gsize index_size   = moto_mesh_get_index_size(self);
+    gsize v_data_size  = ((self->b32) ? sizeof(MotoMeshVert32) : sizeof(MotoMeshVert16)) * v_num;
+    gsize f_data_size  = ((self->b32) ? sizeof(MotoMeshFace32) : sizeof(MotoMeshFace16)) * f_num;
+    gsize he_data_size = ((self->b32) ? sizeof(MotoHalfEdge32) : sizeof(MotoHalfEdge16)) * he_num;
+    gsize e_flags_size = sizeof(guint32) * (e_num/32 + 1);
+
+    gsize size = moto_mem_pool_align(v_data_size) +
+                 moto_mem_pool_align(sizeof(MotoVector) * v_num)*2 +
+                 moto_mem_pool_align(index_size * f_verts_num) +
+                 moto_mem_pool_align(f_data_size) +
+                 moto_mem_pool_align(sizeof(MotoVector) * f_num);
+    if(e_num)
+        size += moto_mem_pool_align(index_size * e_num * 2) +
+                moto_mem_pool_align(e_flags_size) +
+                moto_mem_pool_align(he_data_size);
+
+    self->block = moto_mem_pool_alloc(size);
+    if( ! self->block)
+    {
+        moto_error("Can't allocate %" G_GSIZE_FORMAT " bytes for mesh", size);
+        g_object_unref(self);
+        return NULL;
+    }
+    self->block_size = size;
+    guint8 *ptr = (guint8 *)self->block;
+
     self->v_num = v_num;
-    self->v_data    = (self->b32) ? g_try_malloc(sizeof(MotoMeshVert32) * v_num):
-                                    g_try_malloc(sizeof(MotoMeshVert16) * v_num);
-    if( ! self->v_data)
-        ; // TODO
-#ifdef __SSE__
-    self->v_coords  = (MotoVector *)_mm_malloc(sizeof(MotoVector) * v_num, 16);
-#else
-    self->v_coords  = (MotoVector *)g_try_malloc(sizeof(MotoVector) * v_num);
-#endif
-    if( ! self->v_coords)
-        ; // TODO
-#ifdef __SSE__
-    self->v_normals = (MotoVector *)_mm_malloc(sizeof(MotoVector) * v_num, 16);
-#else
-    self->v_normals = (MotoVector *)g_try_malloc(sizeof(MotoVector) * v_num);
-#endif
-    if( ! self->v_normals)
-        ; // TODO
+    self->v_data    = carve_array(& ptr, v_data_size);
+    self->v_coords  = (MotoVector *)carve_array(& ptr, sizeof(MotoVector) * v_num);
+    self->v_normals = (MotoVector *)carve_array(& ptr, sizeof(MotoVector) * v_num);
 
-    num = f_num/32 + 1;
     self->f_num     = f_num;
     self->f_v_num   = f_verts_num;
-    self->f_verts   = (self->b32) ? g_try_malloc(sizeof(guint32) * f_verts_num):
-                                    g_try_malloc(sizeof(guint16) * f_verts_num);
-    if( ! self->f_verts)
-        ; // TODO
-    self->f_data    = (self->b32) ? g_try_malloc(sizeof(MotoMeshFace32) * f_num):
-                                    g_try_malloc(sizeof(MotoMeshFace16) * f_num);
-    if( ! self->f_data)
-        ; // TODO
-    self->f_normals = (MotoVector *)g_try_malloc(sizeof(MotoVector) * f_num);
-    if( ! self->f_normals)
-        ; // TODO
+    self->f_verts   = carve_array(& ptr, index_size * f_verts_num);
+    self->f_data    = carve_array(& ptr, f_data_size);
+    self->f_normals = (MotoVector *)carve_array(& ptr, sizeof(MotoVector) * f_num);
     /*
+    num = f_num/32 + 1;
     self->f_use_hidden = TRUE;
     self->f_hidden_flags  = (guint32 *)g_try_malloc(sizeof(guint32) * num);
     for(i = 0; i < num; i++)
@@ -222,17 +253,12 @@ MotoMesh *moto_mesh_new(guint v_num, guint e_num, guint f_num, guint f_verts_num
     {
         num = e_num/32 + 1;
         self->e_num     = e_num;
-        self->e_verts = g_try_malloc(moto_mesh_get_index_size(self) * e_num * 2);
-        self->e_hard_flags  = (guint32 *)g_try_malloc(sizeof(guint32) * num);
-        if( ! self->e_verts)
-            ; // TODO
+        self->e_verts = carve_array(& ptr, index_size * e_num * 2);
+        self->e_hard_flags  = (guint32 *)carve_array(& ptr, e_flags_size);
         for(i = 0; i < num; i++)
             self->e_hard_flags[i] = 0;
 
-        self->he_data = (self->b32) ? g_try_malloc(sizeof(MotoHalfEdge32) * he_num):
-                                      g_try_malloc(sizeof(MotoHalfEdge16) * he_num);
-        if( ! self->he_data)
-            ; // TODO
+        self->he_data = carve_array(& ptr, he_data_size);
         // Fill in half edges with invalid indecies.
         if(self->b32)
         {
@@ -266,8 +292,14 @@ MotoMesh *moto_mesh_new_copy(MotoMesh *other)
     self->tesselated = other->tesselated;
     self->f_tess_num = other->f_tess_num;
 
-    memcpy(self->v_coords, other->v_coords, sizeof(MotoVector)*self->v_num);
-    memcpy(self->v_normals, other->v_normals, sizeof(MotoVector)*self->v_num);
+    if(moto_mesh_is_packed(other))
+        moto_mesh_decode_verts(other, 0, other->v_num,
+            (gfloat *)self->v_coords, sizeof(MotoVector), (gfloat *)self->v_normals, sizeof(MotoVector));
+    else
+    {
+        memcpy(self->v_coords, other->v_coords, sizeof(MotoVector)*self->v_num);
+        memcpy(self->v_normals, other->v_normals, sizeof(MotoVector)*self->v_num);
+    }
 
     if(self->b32)
     {
@@ -300,6 +332,8 @@ MotoMesh *moto_mesh_new_copy(MotoMesh *other)
         memcpy(self->he_data, other->he_data, sizeof(MotoHalfEdge16) * self->e_num * 2);
     }
 
+    moto_mesh_copy_attrs(self, other, NULL, NULL, NULL);
+
     // moto_mesh_prepare(self);
     return self;
 }
@@ -320,48 +354,681 @@ void moto_mesh_copy(MotoMesh *self, MotoMesh *other)
     */
 }
 
-MotoMeshVertAttr *moto_mesh_add_attr(MotoMesh *self, const gchar *attr_name, guint chnum)
+/* Packing */
+
+G_LOCK_DEFINE_STATIC(packing);
+
+#define QUANT_MAX 65535
+#define SNORM_MAX 32767
+
+typedef struct _BlockArray
+{
+    gpointer *array;
+    gsize size;
+} BlockArray;
+
+/* Arrays of block besides coords and normals of verts. */
+static guint get_block_arrays(MotoMesh *self, BlockArray *arrays)
+{
+    gsize index_size = moto_mesh_get_index_size(self);
+    gsize v_data_size = (self->b32) ? sizeof(MotoMeshVert32) : sizeof(MotoMeshVert16);
+    gsize f_data_size = (self->b32) ? sizeof(MotoMeshFace32) : sizeof(MotoMeshFace16);
+    gsize he_size     = (self->b32) ? sizeof(MotoHalfEdge32) : sizeof(MotoHalfEdge16);
+
+    BlockArray all[] = {
+        {& self->v_data, v_data_size * self->v_num},
+        {& self->f_verts, index_size * self->f_v_num},
+        {& self->f_data, f_data_size * self->f_num},
+        {(gpointer *)& self->f_normals, sizeof(MotoVector) * self->f_num},
+        {& self->e_verts, index_size * self->e_num * 2},
+        {(gpointer *)& self->e_hard_flags, sizeof(guint32) * (self->e_num/32 + 1)},
+        {& self->he_data, he_size * self->e_num * 2}};
+
+    guint8 *block = (guint8 *)self->block;
+    guint i, num = 0;
+    for(i = 0; i < G_N_ELEMENTS(all); i++)
+    {
+        guint8 *p = (guint8 *)*all[i].array;
+        /* Empty array may point right to the end of block. */
+        if(block && p >= block && p <= block + self->block_size)
+            arrays[num++] = all[i];
+    }
+    return num;
+}
+
+/* Copies arrays of block to new one which has extra_size bytes at start.
+ * Old block is still in use by verts and must be released by caller. */
+static guint8 *move_to_new_block(MotoMesh *self, gsize extra_size, gsize *size)
 {
-    /*
-    MotoMeshVertAttr *attr = moto_mesh_get_attr(self, attr_name);
+    BlockArray arrays[8];
+    guint num = get_block_arrays(self, arrays);
 
-    if(attr)
+    guint i;
+    *size = moto_mem_pool_align(extra_size);
+    for(i = 0; i < num; i++)
+        *size += moto_mem_pool_align(arrays[i].size);
+
+    guint8 *block = (guint8 *)moto_mem_pool_alloc(*size);
+    if( ! block)
+    {
+        moto_error("Can't allocate %" G_GSIZE_FORMAT " bytes for mesh", *size);
+        return NULL;
+    }
+
+    guint8 *ptr = block + moto_mem_pool_align(extra_size);
+    for(i = 0; i < num; i++)
     {
-        GString *msg = g_string_new("Mesh already has attribute with name \"");
-        g_string_append(msg, attr_name);
-        g_string_append(msg, "\". I won't create it.");
-        moto_warning(msg->str);
-        g_string_free(msg, TRUE);
-        return attr;
+        gpointer array = carve_array(& ptr, arrays[i].size);
+        memcpy(array, *arrays[i].array, arrays[i].size);
+        *arrays[i].array = array;
     }
+    return block;
+}
 
-    attr = g_slice_new(MotoMeshVertAttr);
+static void replace_block(MotoMesh *self, guint8 *block, gsize size)
+{
+    moto_mem_pool_free(self->block);
+    self->block = block;
+    self->block_size = size;
+}
 
-    attr->name = g_string_new(attr_name);
-    attr->chnum = chnum;
-    attr->data = (gfloat *)g_try_malloc(sizeof(gfloat)*self->v_num);
+static gfloat sign_not_zero(gfloat value)
+{
+    return (value < 0) ? -1 : 1;
+}
 
-    self->verts_attrs = g_slist_append(self->verts_attrs, attr);
+static gint16 snorm(gfloat value)
+{
+    value = CLAMP(value, -1, 1)*SNORM_MAX;
+    return (gint16)(value + sign_not_zero(value)*0.5f);
+}
 
-    return attr;
-    */
-    return NULL;
+/* Normal is projected on octahedron which lower half is folded up. */
+static void encode_normal(gint16 *out, MotoVector *n)
+{
+    gfloat l = fabs(n->x) + fabs(n->y) + fabs(n->z);
+    gfloat u = 0, v = 0;
+    if(l > 0)
+    {
+        u = n->x/l;
+        v = n->y/l;
+        if(n->z < 0)
+        {
+            gfloat t = (1 - fabs(v))*sign_not_zero(u);
+            v = (1 - fabs(u))*sign_not_zero(v);
+            u = t;
+        }
+    }
+    out[0] = snorm(u);
+    out[1] = snorm(v);
 }
 
-MotoMeshVertAttr *moto_mesh_get_attr(MotoMesh *self, const gchar *attr_name)
+static void decode_normal(gfloat *out, const gint16 *in)
 {
-    /*
-    GSList *attr = self->verts_attrs;
-    for(; attr; attr = g_slist_next(attr))
+    gfloat u = (gfloat)in[0]/SNORM_MAX;
+    gfloat v = (gfloat)in[1]/SNORM_MAX;
+    gfloat z = 1 - fabs(u) - fabs(v);
+    if(z < 0)
     {
-        if(g_utf8_collate(attr_name, ((MotoMeshVertAttr *)attr->data)->name->str) == 0)
+        gfloat t = (1 - fabs(v))*sign_not_zero(u);
+        v = (1 - fabs(u))*sign_not_zero(v);
+        u = t;
+    }
+
+    gfloat l = sqrt(u*u + v*v + z*z);
+    out[0] = u/l;
+    out[1] = v/l;
+    out[2] = z/l;
+}
+
+gboolean moto_mesh_pack(MotoMesh *self)
+{
+    if( ! self->v_num)
+        return FALSE;
+
+    G_LOCK(packing);
+
+    if(self->v_packed)
+    {
+        G_UNLOCK(packing);
+        return TRUE;
+    }
+
+    gsize size;
+    guint8 *block = move_to_new_block(self, sizeof(MotoPackedVert) * self->v_num, & size);
+    if( ! block)
+    {
+        G_UNLOCK(packing);
+        return FALSE;
+    }
+    MotoPackedVert *packed = (MotoPackedVert *)block;
+
+    guint i, j;
+    gfloat min[3], max[3];
+    for(j = 0; j < 3; j++)
+        min[j] = max[j] = ((gfloat *)self->v_coords)[j];
+    for(i = 1; i < self->v_num; i++)
+    {
+        gfloat *p = (gfloat *)(self->v_coords + i);
+        for(j = 0; j < 3; j++)
         {
-            return (MotoMeshVertAttr *)attr->data;
+            min[j] = MIN(min[j], p[j]);
+            max[j] = MAX(max[j], p[j]);
+        }
+    }
+
+    for(j = 0; j < 3; j++)
+    {
+        self->v_pack_origin[j] = min[j];
+        self->v_pack_step[j]   = (max[j] - min[j])/QUANT_MAX;
+    }
+
+    for(i = 0; i < self->v_num; i++)
+    {
+        gfloat *p = (gfloat *)(self->v_coords + i);
+        for(j = 0; j < 3; j++)
+        {
+            gfloat q = (self->v_pack_step[j] > 0) ? (p[j] - min[j])/self->v_pack_step[j] + 0.5f : 0;
+            packed[i].coords[j] = (guint16)MIN(q, QUANT_MAX);
+        }
+        encode_normal(packed[i].normal, self->v_normals + i);
+    }
+
+    free_array(self, self->v_coords);
+    free_array(self, self->v_normals);
+    replace_block(self, block, size);
+
+    self->v_coords  = NULL;
+    self->v_normals = NULL;
+    self->v_packed  = packed;
+
+    G_UNLOCK(packing);
+    return TRUE;
+}
+
+gboolean moto_mesh_unpack(MotoMesh *self)
+{
+    if( ! self->v_packed)
+        return TRUE;
+
+    G_LOCK(packing);
+
+    /* Mesh may be unpacked by another thread while we were waiting. */
+    if( ! self->v_packed)
+    {
+        G_UNLOCK(packing);
+        return TRUE;
+    }
+
+    gsize v_size = moto_mem_pool_align(sizeof(MotoVector) * self->v_num);
+    gsize size;
+    guint8 *block = move_to_new_block(self, v_size*2, & size);
+    if( ! block)
+    {
+        G_UNLOCK(packing);
+        return FALSE;
+    }
+
+    MotoVector *coords  = (MotoVector *)block;
+    MotoVector *normals = (MotoVector *)(block + v_size);
+    moto_mesh_decode_verts(self, 0, self->v_num,
+        (gfloat *)coords, sizeof(MotoVector), (gfloat *)normals, sizeof(MotoVector));
+
+    guint i;
+    for(i = 0; i < self->v_num; i++)
+    {
+        coords[i].w  = 1;
+        normals[i].w = 0;
+    }
+
+    replace_block(self, block, size);
+
+    self->v_coords  = coords;
+    self->v_normals = normals;
+    self->v_packed  = NULL;
+
+    G_UNLOCK(packing);
+    return TRUE;
+}
+
+void moto_mesh_decode_verts(MotoMesh *self, guint begin, guint end,
+        gfloat *coords, gsize coords_stride, gfloat *normals, gsize normals_stride)
+{
+    guint i, j;
+    for(i = begin; i < end; i++)
+    {
+        gfloat *c = (gfloat *)((guint8 *)coords + (i - begin)*coords_stride);
+        gfloat *n = (gfloat *)((guint8 *)normals + (i - begin)*normals_stride);
+
+        if( ! self->v_packed)
+        {
+            if(coords)
+                memcpy(c, self->v_coords + i, sizeof(gfloat)*3);
+            if(normals)
+                memcpy(n, self->v_normals + i, sizeof(gfloat)*3);
+            continue;
+        }
+
+        MotoPackedVert *v = self->v_packed + i;
+        if(coords)
+            for(j = 0; j < 3; j++)
+                c[j] = self->v_pack_origin[j] + v->coords[j]*self->v_pack_step[j];
+        if(normals)
+            decode_normal(n, v->normal);
+    }
+}
+
+/* Attributes */
+
+/* Elements are interpolated by threads only when there are enough of them. */
+#define PARALLEL_MIN_ELEMS 4096
+
+static gboolean is_attr_like(MotoMeshAttr *attr,
+    MotoMeshAttrType type, MotoMeshAttrDomain domain, guint chnum)
+{
+    return attr->type == type && attr->domain == domain && attr->chnum == chnum;
+}
+
+static MotoMeshAttr *find_attr(MotoMesh *self, GQuark name, MotoMeshAttrHandle *handle)
+{
+    guint i;
+    for(i = 0; i < self->attrs->len; i++)
+    {
+        MotoMeshAttr *attr = (MotoMeshAttr *)g_ptr_array_index(self->attrs, i);
+        if(attr && attr->name == name)
+        {
+            if(handle)
+                *handle = i;
+            return attr;
         }
     }
     return NULL;
-    */
-    return NULL;
+}
+
+static MotoMeshAttrHandle add_attr(MotoMesh *self, GQuark name,
+    MotoMeshAttrType type, MotoMeshAttrDomain domain, guint chnum)
+{
+    guint num = moto_mesh_get_domain_num(self, domain);
+    gsize ch_size = moto_mem_pool_align(moto_mesh_attr_type_size(type) * num);
+    gsize size = ch_size * chnum;
+
+    gpointer data = moto_mem_pool_alloc(MAX(size, 1));
+    if( ! data)
+    {
+        moto_error("Can't allocate %" G_GSIZE_FORMAT " bytes for attribute \"%s\"",
+            size, g_quark_to_string(name));
+        return MOTO_MESH_ATTR_INVALID;
+    }
+    memset(data, 0, size);
+
+    MotoMeshAttr *attr = g_slice_new(MotoMeshAttr);
+    attr->name    = name;
+    attr->type    = type;
+    attr->domain  = domain;
+    attr->chnum   = chnum;
+    attr->num     = num;
+    attr->ch_size = ch_size;
+    attr->data    = data;
+
+    /* Slots of removed attributes are reused. */
+    guint i;
+    for(i = 0; i < self->attrs->len; i++)
+    {
+        if( ! g_ptr_array_index(self->attrs, i))
+        {
+            g_ptr_array_index(self->attrs, i) = attr;
+            return i;
+        }
+    }
+    g_ptr_array_add(self->attrs, attr);
+    return self->attrs->len - 1;
+}
+
+gsize moto_mesh_attr_type_size(MotoMeshAttrType type)
+{
+    switch(type)
+    {
+        case MOTO_MESH_ATTR_FLOAT:
+        case MOTO_MESH_ATTR_INT:
+            return 4;
+        case MOTO_MESH_ATTR_HALF:
+            return 2;
+        case MOTO_MESH_ATTR_BYTE:
+            return 1;
+    }
+    return 0;
+}
+
+guint moto_mesh_get_domain_num(MotoMesh *self, MotoMeshAttrDomain domain)
+{
+    switch(domain)
+    {
+        case MOTO_MESH_ATTR_VERT:
+            return self->v_num;
+        case MOTO_MESH_ATTR_FACE:
+            return self->f_num;
+        case MOTO_MESH_ATTR_FACE_VERT:
+            return self->f_v_num;
+    }
+    return 0;
+}
+
+MotoMeshAttrHandle moto_mesh_add_attr(MotoMesh *self, const gchar *name,
+        MotoMeshAttrType type, MotoMeshAttrDomain domain, guint chnum)
+{
+    if(chnum < 1)
+    {
+        moto_warning("Attribute \"%s\" must have at least one channel", name);
+        return MOTO_MESH_ATTR_INVALID;
+    }
+
+    GQuark quark = g_quark_from_string(name);
+    MotoMeshAttrHandle handle;
+    MotoMeshAttr *attr = find_attr(self, quark, & handle);
+    if(attr)
+    {
+        if(is_attr_like(attr, type, domain, chnum))
+            return handle;
+
+        moto_warning("Mesh already has attribute \"%s\" of another layout. I won't create it.", name);
+        return MOTO_MESH_ATTR_INVALID;
+    }
+
+    return add_attr(self, quark, type, domain, chnum);
+}
+
+MotoMeshAttrHandle moto_mesh_find_attr(MotoMesh *self, const gchar *name)
+{
+    GQuark quark = g_quark_try_string(name);
+    MotoMeshAttrHandle handle;
+    if( ! quark || ! find_attr(self, quark, & handle))
+        return MOTO_MESH_ATTR_INVALID;
+    return handle;
+}
+
+void moto_mesh_remove_attr(MotoMesh *self, MotoMeshAttrHandle handle)
+{
+    MotoMeshAttr *attr = moto_mesh_get_attr(self, handle);
+    if( ! attr)
+        return;
+
+    free_attr(attr);
+    g_ptr_array_index(self->attrs, handle) = NULL;
+}
+
+MotoMeshAttr *moto_mesh_get_attr(MotoMesh *self, MotoMeshAttrHandle handle)
+{
+    if(handle >= self->attrs->len)
+        return NULL;
+    return (MotoMeshAttr *)g_ptr_array_index(self->attrs, handle);
+}
+
+MotoMeshAttr *moto_mesh_get_attr_like(MotoMesh *self, MotoMeshAttr *other)
+{
+    MotoMeshAttrHandle handle;
+    MotoMeshAttr *attr = find_attr(self, other->name, & handle);
+    if(attr)
+    {
+        if(is_attr_like(attr, other->type, other->domain, other->chnum))
+            return attr;
+        moto_mesh_remove_attr(self, handle);
+    }
+
+    return moto_mesh_get_attr(self,
+        add_attr(self, other->name, other->type, other->domain, other->chnum));
+}
+
+static gboolean has_attrs(MotoMesh *self)
+{
+    guint i;
+    for(i = 0; i < self->attrs->len; i++)
+        if(g_ptr_array_index(self->attrs, i))
+            return TRUE;
+    return FALSE;
+}
+
+gfloat moto_mesh_attr_get_value(MotoMeshAttr *attr, guint ch, guint i)
+{
+    switch(attr->type)
+    {
+        case MOTO_MESH_ATTR_FLOAT:
+            return moto_mesh_attr_float(attr, ch)[i];
+        case MOTO_MESH_ATTR_INT:
+            return moto_mesh_attr_int(attr, ch)[i];
+        case MOTO_MESH_ATTR_HALF:
+            return moto_half_to_float(moto_mesh_attr_half(attr, ch)[i]);
+        case MOTO_MESH_ATTR_BYTE:
+            return moto_mesh_attr_byte(attr, ch)[i];
+    }
+    return 0;
+}
+
+void moto_mesh_attr_set_value(MotoMeshAttr *attr, guint ch, guint i, gfloat value)
+{
+    switch(attr->type)
+    {
+        case MOTO_MESH_ATTR_FLOAT:
+            moto_mesh_attr_float(attr, ch)[i] = value;
+            break;
+        case MOTO_MESH_ATTR_INT:
+            moto_mesh_attr_int(attr, ch)[i] = (gint32)value;
+            break;
+        case MOTO_MESH_ATTR_HALF:
+            moto_mesh_attr_half(attr, ch)[i] = moto_float_to_half(value);
+            break;
+        case MOTO_MESH_ATTR_BYTE:
+            moto_mesh_attr_byte(attr, ch)[i] = (guint8)CLAMP(value, 0, 255);
+            break;
+    }
+}
+
+typedef union
+{
+    gfloat f;
+    guint32 u;
+} FloatBits;
+
+gfloat moto_half_to_float(guint16 value)
+{
+    guint32 sign = (guint32)(value & 0x8000) << 16;
+    guint32 exp  = (value >> 10) & 0x1f;
+    guint32 mant = value & 0x3ff;
+
+    FloatBits bits;
+    if(0 == exp)
+    {
+        /* Zero and denormals */
+        bits.f = mant * (1.0f/16777216.0f);
+        bits.u |= sign;
+    }
+    else if(31 == exp)
+        bits.u = sign | 0x7f800000 | (mant << 13);
+    else
+        bits.u = sign | ((exp + 112) << 23) | (mant << 13);
+
+    return bits.f;
+}
+
+guint16 moto_float_to_half(gfloat value)
+{
+    FloatBits bits;
+    bits.f = value;
+
+    guint32 sign = (bits.u >> 16) & 0x8000;
+    guint32 fexp = (bits.u >> 23) & 0xff;
+    guint32 mant = bits.u & 0x7fffff;
+    gint32 exp = (gint32)fexp - 127 + 15;
+
+    if(0xff == fexp)
+        return sign | 0x7c00 | ((mant) ? 0x200 : 0);
+    if(exp >= 31)
+        return sign | 0x7c00;
+    if(exp <= 0)
+    {
+        if(exp < -10)
+            return sign;
+
+        /* Denormal, rounded to nearest. */
+        mant |= 0x800000;
+        guint32 shift = 14 - exp;
+        guint32 h = mant >> shift;
+        if((mant >> (shift - 1)) & 1)
+            h++;
+        return sign | h;
+    }
+
+    /* Carry of rounding goes to exponent as it should. */
+    guint32 h = sign | (exp << 10) | (mant >> 13);
+    if(mant & 0x1000)
+        h++;
+    return h;
+}
+
+#define GATHER(type) \
+    { \
+        type *d = (type *)dst; \
+        const type *s = (const type *)src; \
+        for(i = 0; i < num; i++) \
+            d[i] = (map[i] < src_num) ? s[map[i]] : 0; \
+    }
+
+static void gather_channel(gpointer dst, gconstpointer src, gsize elem_size,
+    guint num, const guint32 *map, guint src_num)
+{
+    guint i;
+    switch(elem_size)
+    {
+        case 4:
+            GATHER(guint32);
+            break;
+        case 2:
+            GATHER(guint16);
+            break;
+        case 1:
+            GATHER(guint8);
+            break;
+    }
+}
+
+#undef GATHER
+
+void moto_mesh_copy_attrs(MotoMesh *self, MotoMesh *other,
+        const guint32 *v_map, const guint32 *f_map, const guint32 *fv_map)
+{
+    guint i, ch;
+    for(i = 0; i < other->attrs->len; i++)
+    {
+        MotoMeshAttr *src = (MotoMeshAttr *)g_ptr_array_index(other->attrs, i);
+        if( ! src)
+            continue;
+
+        MotoMeshAttr *dst = moto_mesh_get_attr_like(self, src);
+        if( ! dst)
+            continue;
+
+        const guint32 *map = fv_map;
+        if(MOTO_MESH_ATTR_VERT == src->domain)
+            map = v_map;
+        else if(MOTO_MESH_ATTR_FACE == src->domain)
+            map = f_map;
+
+        gsize elem_size = moto_mesh_attr_type_size(src->type);
+        for(ch = 0; ch < src->chnum; ch++)
+        {
+            gpointer d = moto_mesh_attr_channel(dst, ch);
+            gconstpointer s = moto_mesh_attr_channel(src, ch);
+            if(map)
+                gather_channel(d, s, elem_size, dst->num, map, src->num);
+            else if(dst->num == src->num)
+                memcpy(d, s, elem_size * dst->num);
+            else
+                memset(d, 0, elem_size * dst->num);
+        }
+    }
+}
+
+typedef struct _InterpolateData
+{
+    MotoMeshAttr *dst;
+    MotoMeshAttr *src;
+    const guint32 *offsets;
+    const guint32 *indices;
+    const gfloat *weights;
+} InterpolateData;
+
+static void interpolate_range(gpointer data, guint chunk, guint begin, guint end)
+{
+    InterpolateData *id = (InterpolateData *)data;
+    MotoMeshAttr *dst = id->dst;
+    MotoMeshAttr *src = id->src;
+
+    guint ch, r, i;
+    for(ch = 0; ch < dst->chnum; ch++)
+    {
+        if(MOTO_MESH_ATTR_FLOAT == dst->type)
+        {
+            gfloat *d = moto_mesh_attr_float(dst, ch);
+            const gfloat *s = moto_mesh_attr_float(src, ch);
+            for(r = begin; r < end; r++)
+            {
+                gfloat sum = 0;
+                for(i = id->offsets[r]; i < id->offsets[r + 1]; i++)
+                    sum += id->weights[i]*s[id->indices[i]];
+                d[r] = sum;
+            }
+        }
+        else if(MOTO_MESH_ATTR_HALF == dst->type)
+        {
+            guint16 *d = moto_mesh_attr_half(dst, ch);
+            const guint16 *s = moto_mesh_attr_half(src, ch);
+            for(r = begin; r < end; r++)
+            {
+                gfloat sum = 0;
+                for(i = id->offsets[r]; i < id->offsets[r + 1]; i++)
+                    sum += id->weights[i]*moto_half_to_float(s[id->indices[i]]);
+                d[r] = moto_float_to_half(sum);
+            }
+        }
+        else
+        {
+            /* Ids and flags can't be blended. */
+            gsize size = moto_mesh_attr_type_size(dst->type);
+            guint8 *d = moto_mesh_attr_byte(dst, ch);
+            const guint8 *s = moto_mesh_attr_byte(src, ch);
+            for(r = begin; r < end; r++)
+            {
+                guint32 best = G_MAXUINT32;
+                gfloat best_weight = -G_MAXFLOAT;
+                for(i = id->offsets[r]; i < id->offsets[r + 1]; i++)
+                {
+                    if(id->weights[i] > best_weight)
+                    {
+                        best = id->indices[i];
+                        best_weight = id->weights[i];
+                    }
+                }
+
+                if(best < src->num)
+                    memcpy(d + r*size, s + best*size, size);
+                else
+                    memset(d + r*size, 0, size);
+            }
+        }
+    }
+}
+
+void moto_mesh_attr_interpolate(MotoMeshAttr *dst, MotoMeshAttr *src,
+        const guint32 *offsets, const guint32 *indices, const gfloat *weights)
+{
+    if( ! is_attr_like(dst, src->type, src->domain, src->chnum))
+    {
+        moto_warning("Attribute \"%s\" can't be interpolated from one of another layout",
+            g_quark_to_string(dst->name));
+        return;
+    }
+
+    InterpolateData id = {dst, src, offsets, indices, weights};
+    moto_parallel_for(interpolate_range, & id, dst->num, PARALLEL_MIN_ELEMS);
 }
 
 /*
@@ -456,6 +1123,8 @@ static void tess_cb_begin_data(GLenum type, void* user_data)
 
 void moto_mesh_tesselate_faces(MotoMesh *self)
 {
+    MOTO_PROFILE_BEGIN(scope);
+
     if(self->f_tess_verts)
     {
         g_free(self->f_tess_verts);
@@ -570,47 +1239,89 @@ void moto_mesh_tesselate_faces(MotoMesh *self)
         self->f_tess_num = td.tess_num/3;
     }
     self->tesselated = TRUE;
+
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_TESSELATE, "tesselate_faces", NULL);
 }
 
-/* Newell's method */
-void moto_mesh_calc_faces_normals(MotoMesh *self)
+static void calc_face_normal16(MotoMesh *self, guint16 fi)
 {
     gfloat tmp;
 
-    if(self->b32)
+    self->f_normals[fi].x = 0;
+    self->f_normals[fi].y = 0;
+    self->f_normals[fi].z = 0;
+
+    MotoVector *vert, *nvert;
+
+    MotoMeshFace16 *f_data = (MotoMeshFace16 *)self->f_data;
+    guint16 *f_verts = (guint16 *)self->f_verts;
+    guint start = (0 == fi) ? 0: f_data[fi-1].v_offset;
+    guint v_num = f_data[fi].v_offset - start;
+    guint16 vi;
+    for(vi = 0; vi < v_num; vi++)
     {
-        guint32 fi;
-        guint32 vi;
-        for(fi = 0; fi < self->f_num; fi++)
-        {
-            self->f_normals[fi].x = 0;
-            self->f_normals[fi].y = 0;
-            self->f_normals[fi].z = 0;
+        vert  = & self->v_coords[f_verts[start + vi]];
+        nvert = & self->v_coords[f_verts[start + (vi + 1)%v_num]];
 
-            MotoVector *vert, *nvert;
+        self->f_normals[fi].x += (vert->y - nvert->y)*(vert->z + nvert->z);
+        self->f_normals[fi].y += (vert->z - nvert->z)*(vert->x + nvert->x);
+        self->f_normals[fi].z += (vert->x - nvert->x)*(vert->y + nvert->y);
+    }
 
-            MotoMeshFace32 *f_data = (MotoMeshFace32 *)self->f_data;
-            guint32 *f_verts = (guint32 *)self->f_verts;
-            guint start = (0 == fi) ? 0: f_data[fi-1].v_offset;
-            guint v_num = f_data[fi].v_offset - start;
-            for(vi = 0; vi < v_num-1; vi++)
-            {
-                vert  = & self->v_coords[f_verts[start + vi]];
-                nvert = & self->v_coords[f_verts[start + (vi + 1)%v_num]];
+    gfloat *normal = (gfloat *)(self->f_normals + fi);
+    vector3_normalize(normal, tmp);
+}
 
-                self->f_normals[fi].x += (vert->y - nvert->y)*(vert->z + nvert->z);
-                self->f_normals[fi].y += (vert->z - nvert->z)*(vert->x + nvert->x);
-                self->f_normals[fi].z += (vert->x - nvert->x)*(vert->y + nvert->y);
-            }
+static void calc_vert_normal16(MotoMesh *self, guint16 vi)
+{
+    MotoMeshVert16 *v_data  = (MotoMeshVert16 *)self->v_data;
+    MotoHalfEdge16 *he_data = (MotoHalfEdge16 *)self->he_data;
 
-            gfloat *normal = (gfloat *)(self->f_normals + fi);
-            vector3_normalize(normal, tmp);
+    gfloat *normal = (gfloat *) & self->v_normals[vi];
+    vector3_zero(normal);
+
+    guint16 begin   = v_data[vi].half_edge;
+    guint16 he      = begin;
+    do
+    {
+        if(moto_mesh_is_index_valid(self, he))
+        {
+            if(moto_mesh_is_index_valid(self, he_data[he].f_left))
+            {
+                gfloat *fnormal = (gfloat *) & self->f_normals[he_data[he].f_left];
+                vector3_add(normal, fnormal);
+            }
         }
+        else
+            break;
+
+        guint16 next = he_data[moto_half_edge_pair(he)].next;
+        he = next;
+    }
+    while(he != begin);
+
+    gfloat len = vector3_length(normal);
+    if(len)
+    {
+        vector3_normalize(normal, len);
     }
     else
     {
-        guint16 fi;
-        guint16 vi;
+        vector3_set(normal, 0, 1, 0); // fake normal for null vector
+    }
+}
+
+/* Newell's method */
+void moto_mesh_calc_faces_normals(MotoMesh *self)
+{
+    MOTO_PROFILE_BEGIN(scope);
+
+    gfloat tmp;
+
+    if(self->b32)
+    {
+        guint32 fi;
+        guint32 vi;
         for(fi = 0; fi < self->f_num; fi++)
         {
             self->f_normals[fi].x = 0;
@@ -619,11 +1330,11 @@ void moto_mesh_calc_faces_normals(MotoMesh *self)
 
             MotoVector *vert, *nvert;
 
-            MotoMeshFace16 *f_data = (MotoMeshFace16 *)self->f_data;
-            guint16 *f_verts = (guint16 *)self->f_verts;
+            MotoMeshFace32 *f_data = (MotoMeshFace32 *)self->f_data;
+            guint32 *f_verts = (guint32 *)self->f_verts;
             guint start = (0 == fi) ? 0: f_data[fi-1].v_offset;
             guint v_num = f_data[fi].v_offset - start;
-            for(vi = 0; vi < v_num; vi++)
+            for(vi = 0; vi < v_num-1; vi++)
             {
                 vert  = & self->v_coords[f_verts[start + vi]];
                 nvert = & self->v_coords[f_verts[start + (vi + 1)%v_num]];
@@ -632,70 +1343,38 @@ void moto_mesh_calc_faces_normals(MotoMesh *self)
                 self->f_normals[fi].y += (vert->z - nvert->z)*(vert->x + nvert->x);
                 self->f_normals[fi].z += (vert->x - nvert->x)*(vert->y + nvert->y);
             }
-
-            gfloat *normal = (gfloat *)(self->f_normals + fi);
-            vector3_normalize(normal, tmp);
-        }
-    }
-}
-
-void moto_mesh_calc_verts_normals(MotoMesh *self)
-{
-    if(self->b32)
-    {
-        MotoMeshVert32 *v_data  = (MotoMeshVert32 *)self->v_data;
-        MotoHalfEdge32 *he_data = (MotoHalfEdge32 *)self->he_data;
-
-        guint32 vi;
-        for(vi = 0; vi < self->v_num; vi++)
-        {
-            gfloat *normal = (gfloat *) & self->v_normals[vi];
-            vector3_zero(normal);
-
-            guint32 begin   = v_data[vi].half_edge;
-            guint32 he      = begin;
-            do
-            {
-                if(moto_mesh_is_index_valid(self, he))
-                {
-                    if(moto_mesh_is_index_valid(self, he_data[he].f_left))
-                    {
-                        gfloat *fnormal = (gfloat *) & self->f_normals[he_data[he].f_left];
-                        vector3_add(normal, fnormal);
-                    }
-                }
-                else
-                    break;
-
-                guint32 next = he_data[moto_half_edge_pair(he)].next;
-                he = next;
-            }
-            while(he != begin);
-
-            gfloat len = vector3_length(normal);
-            if(len)
-            {
-                vector3_normalize(normal, len);
-            }
-            else
-            {
-                vector3_set(normal, 0, 1, 0); // fake normal for null vector
-            }
+
+            gfloat *normal = (gfloat *)(self->f_normals + fi);
+            vector3_normalize(normal, tmp);
         }
     }
     else
     {
-        MotoMeshVert16 *v_data  = (MotoMeshVert16 *)self->v_data;
-        MotoHalfEdge16 *he_data = (MotoHalfEdge16 *)self->he_data;
+        guint16 fi;
+        for(fi = 0; fi < self->f_num; fi++)
+            calc_face_normal16(self, fi);
+    }
 
-        guint16 vi;
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_NORMALS, "calc_faces_normals", NULL);
+}
+
+void moto_mesh_calc_verts_normals(MotoMesh *self)
+{
+    MOTO_PROFILE_BEGIN(scope);
+
+    if(self->b32)
+    {
+        MotoMeshVert32 *v_data  = (MotoMeshVert32 *)self->v_data;
+        MotoHalfEdge32 *he_data = (MotoHalfEdge32 *)self->he_data;
+
+        guint32 vi;
         for(vi = 0; vi < self->v_num; vi++)
         {
             gfloat *normal = (gfloat *) & self->v_normals[vi];
             vector3_zero(normal);
 
-            guint16 begin   = v_data[vi].half_edge;
-            guint16 he      = begin;
+            guint32 begin   = v_data[vi].half_edge;
+            guint32 he      = begin;
             do
             {
                 if(moto_mesh_is_index_valid(self, he))
@@ -709,7 +1388,7 @@ void moto_mesh_calc_verts_normals(MotoMesh *self)
                 else
                     break;
 
-                guint16 next = he_data[moto_half_edge_pair(he)].next;
+                guint32 next = he_data[moto_half_edge_pair(he)].next;
                 he = next;
             }
             while(he != begin);
@@ -725,6 +1404,14 @@ void moto_mesh_calc_verts_normals(MotoMesh *self)
             }
         }
     }
+    else
+    {
+        guint16 vi;
+        for(vi = 0; vi < self->v_num; vi++)
+            calc_vert_normal16(self, vi);
+    }
+
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_NORMALS, "calc_verts_normals", NULL);
 }
 
 void moto_mesh_calc_normals(MotoMesh *self)
@@ -733,6 +1420,16 @@ void moto_mesh_calc_normals(MotoMesh *self)
     moto_mesh_calc_verts_normals(self);
 }
 
+void moto_mesh_update_coords(MotoMesh *self, gboolean verts_normals)
+{
+    moto_mesh_calc_faces_normals(self);
+    if(verts_normals)
+        moto_mesh_calc_verts_normals(self);
+
+    moto_mesh_update_bound((MotoShape *)self);
+    moto_shape_touch((MotoShape *)self);
+}
+
 gboolean moto_mesh_set_face(MotoMesh *self, guint32 fi, guint32 v_offset, guint32 *verts)
 {
     if(self->b32)
@@ -792,7 +1489,7 @@ static void moto_mesh_convert_16to32(MotoMesh *self)
     {
         v_data32[i].half_edge = v_data16[i].half_edge;
     }
-    g_free(self->v_data);
+    free_array(self, self->v_data);
     self->v_data = v_data32;
 
     /* Converting faces. */
@@ -803,7 +1500,7 @@ static void moto_mesh_convert_16to32(MotoMesh *self)
         f_data32[i].v_offset  = f_data16[i].v_offset;
         f_data32[i].half_edge = f_data16[i].half_edge;
     }
-    g_free(self->f_data);
+    free_array(self, self->f_data);
     self->f_data = f_data32;
 
     guint32 *f_verts32 = (guint32 *)g_try_malloc(sizeof(guint32)*self->f_num);
@@ -812,7 +1509,7 @@ static void moto_mesh_convert_16to32(MotoMesh *self)
     {
         f_verts32[i] = f_verts16[i];
     }
-    g_free(self->f_verts);
+    free_array(self, self->f_verts);
     self->f_verts = f_verts32;
 
     if(self->tesselated)
@@ -836,7 +1533,7 @@ static void moto_mesh_convert_16to32(MotoMesh *self)
         {
             e_verts32[i] = e_verts16[i];
         }
-        g_free(self->e_verts);
+        free_array(self, self->e_verts);
         self->e_verts = e_verts32;
 
         if(self->he_data)
@@ -849,7 +1546,7 @@ static void moto_mesh_convert_16to32(MotoMesh *self)
                 he_data32[i].prev   = he_data16[i].prev;
                 he_data32[i].f_left = he_data16[i].f_left;
             }
-            g_free(self->he_data);
+            free_array(self, self->he_data);
             self->he_data = he_data32;
         }
     }
@@ -1030,7 +1727,7 @@ gboolean moto_mesh_update_he_data(MotoMesh *self)
         MOTO_DECLARE_MESH_DATA_32(self);
 
         MotoEdgeList** v_edges = \
-            (MotoEdgeList**)g_try_malloc(sizeof(MotoEdgeList*)*self->v_num);
+            (MotoEdgeList**)moto_scratch_alloc(sizeof(MotoEdgeList*)*self->v_num);
         memset(v_edges, 0, sizeof(MotoEdgeList*)*self->v_num);
 
         guint32 cei = 0;
@@ -1038,7 +1735,10 @@ gboolean moto_mesh_update_he_data(MotoMesh *self)
         for(fi = 0; fi < self->f_num; fi++)
         {
             if(!moto_mesh_is_index_valid(self, fi))
+            {
+                moto_scratch_free(v_edges);
                 return FALSE;
+            }
 
             guint32 start = (0 == fi) ? 0: f_data[fi-1].v_offset;
             guint32 v_num = f_data[fi].v_offset - start;
@@ -1113,14 +1813,14 @@ gboolean moto_mesh_update_he_data(MotoMesh *self)
         guint i;
         for(i = 0; i < self->v_num; i++)
             moto_edge_list_remove_all(v_edges[i]);
-        g_free(v_edges);
+        moto_scratch_free(v_edges);
     }
     else
     {
         MOTO_DECLARE_MESH_DATA_16(self);
 
         MotoEdgeList16** v_edges = \
-            (MotoEdgeList16**)g_try_malloc(sizeof(MotoEdgeList16*)*self->v_num);
+            (MotoEdgeList16**)moto_scratch_alloc(sizeof(MotoEdgeList16*)*self->v_num);
         memset(v_edges, 0, sizeof(MotoEdgeList16*)*self->v_num);
 
         guint16 cei = 0;
@@ -1129,6 +1829,7 @@ gboolean moto_mesh_update_he_data(MotoMesh *self)
         {
             if(!moto_mesh_is_index_valid(self, fi))
             {
+                moto_scratch_free(v_edges);
                 return FALSE;
             }
 
@@ -1146,7 +1847,7 @@ gboolean moto_mesh_update_he_data(MotoMesh *self)
                 ei = moto_edge_list16_find_edge_and_remove( & v_edges[nvi], e_verts, vi, nvi);
                 if(ei != moto_edge_list16_find_edge_and_remove( & v_edges[vi], e_verts, vi, nvi))
                 {
-                    g_free(v_edges);
+                    moto_scratch_free(v_edges);
                     return FALSE;
                 }
 
@@ -1206,7 +1907,7 @@ gboolean moto_mesh_update_he_data(MotoMesh *self)
         guint i;
         for(i = 0; i < self->v_num; i++)
             moto_edge_list16_remove_all(v_edges[i]);
-        g_free(v_edges);
+        moto_scratch_free(v_edges);
     }
 
     self->he_calculated = TRUE;
@@ -1226,14 +1927,30 @@ gboolean moto_mesh_prepare(MotoMesh *self)
     return TRUE;
 }
 
+/* Faces, their verts and edges are compared, so buffers built from topology
+ * of one mesh may be reused for another one. */
 gboolean moto_mesh_is_struct_the_same(MotoMesh *self, MotoMesh* other)
 {
+    if(self == other)
+        return TRUE;
+
     if(self->v_num != other->v_num || self->e_num != other->e_num ||
-       self->f_num != other->f_num)
+       self->f_num != other->f_num || self->f_v_num != other->f_v_num ||
+       self->b32 != other->b32)
     {
         return FALSE;
     }
 
+    gsize index_size = moto_mesh_get_index_size(self);
+    gsize f_data_size = (self->b32) ? sizeof(MotoMeshFace32) : sizeof(MotoMeshFace16);
+
+    if(memcmp(self->f_data, other->f_data, f_data_size * self->f_num) ||
+       memcmp(self->f_verts, other->f_verts, index_size * self->f_v_num))
+        return FALSE;
+
+    if(self->e_num && memcmp(self->e_verts, other->e_verts, index_size * self->e_num * 2))
+        return FALSE;
+
     return TRUE;
 }
 
@@ -1268,6 +1985,18 @@ gboolean moto_mesh_intersect_face(MotoMesh *self, guint fi, MotoRay *ray, gfloat
 
 void moto_mesh_calc_bound(MotoMesh* self, MotoBound* bound)
 {
+    if(moto_mesh_is_packed(self))
+    {
+        /* Quantisation range is the bound itself. */
+        gfloat *o = self->v_pack_origin;
+        gfloat *s = self->v_pack_step;
+        moto_bound_set(bound,
+            MIN(o[0], 0), MAX(o[0] + s[0]*QUANT_MAX, 0),
+            MIN(o[1], 0), MAX(o[1] + s[1]*QUANT_MAX, 0),
+            MIN(o[2], 0), MAX(o[2] + s[2]*QUANT_MAX, 0));
+        return;
+    }
+
     gfloat min_x = 0;
     gfloat max_x = 0;
     gfloat min_y = 0;
@@ -1395,6 +2124,21 @@ static void moto_mesh_select_inverse(MotoShape* self,
     }
 }
 
+/* Indecies of set bits in scratch memory of thread, released with moto_scratch_free. */
+static guint32 *scratch_array_32(MotoBitmask *bitmask)
+{
+    guint32 *array = (guint32 *)moto_scratch_alloc(sizeof(guint32)*moto_bitmask_get_set_num(bitmask));
+    moto_bitmask_fill_array_32(bitmask, array);
+    return array;
+}
+
+static guint16 *scratch_array_16(MotoBitmask *bitmask)
+{
+    guint16 *array = (guint16 *)moto_scratch_alloc(sizeof(guint16)*moto_bitmask_get_set_num(bitmask));
+    moto_bitmask_fill_array_16(bitmask, array);
+    return array;
+}
+
 void moto_mesh_select_more_verts(MotoMesh *self, MotoShapeSelection *selection)
 {
     if(moto_shape_selection_get_selected_v_num(selection) == self->v_num)
@@ -1407,7 +2151,7 @@ void moto_mesh_select_more_verts(MotoMesh *self, MotoShapeSelection *selection)
         guint32 *e_verts = (guint32 *)self->e_verts;
 
         guint32* selected = \
-            (guint32*)g_try_malloc(sizeof(guint32)*moto_shape_selection_get_selected_v_num(selection));
+            (guint32*)moto_scratch_alloc(sizeof(guint32)*moto_shape_selection_get_selected_v_num(selection));
 
         guint32 i, j = 0;
         for(i = 0; i < self->v_num; i++)
@@ -1437,7 +2181,7 @@ void moto_mesh_select_more_verts(MotoMesh *self, MotoShapeSelection *selection)
             while(he != begin);
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
     else
     {
@@ -1446,7 +2190,7 @@ void moto_mesh_select_more_verts(MotoMesh *self, MotoShapeSelection *selection)
         guint16 *e_verts = (guint16 *)self->e_verts;
 
         guint16* selected = \
-            (guint16*)g_try_malloc(sizeof(guint16)*moto_shape_selection_get_selected_v_num(selection));
+            (guint16*)moto_scratch_alloc(sizeof(guint16)*moto_shape_selection_get_selected_v_num(selection));
 
         guint16 i, j = 0;
         for(i = 0; i < self->v_num; i++)
@@ -1501,7 +2245,7 @@ void moto_mesh_select_more_verts(MotoMesh *self, MotoShapeSelection *selection)
             }
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
 }
 
@@ -1517,7 +2261,7 @@ void moto_mesh_select_less_verts(MotoMesh *self, MotoShapeSelection *selection)
         guint32 *e_verts = (guint32 *)self->e_verts;
 
         guint32 num = moto_shape_selection_get_selected_v_num(selection);
-        guint32* selected = (guint32*)g_try_malloc(sizeof(guint32)*num*2);
+        guint32* selected = (guint32*)moto_scratch_alloc(sizeof(guint32)*num*2);
         guint32* for_deselection = selected + num;
 
         guint32 i, j = 0;
@@ -1559,7 +2303,7 @@ void moto_mesh_select_less_verts(MotoMesh *self, MotoShapeSelection *selection)
         for(i = 0; i < j; i++)
             moto_shape_selection_deselect_vertex(selection, for_deselection[i]);
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
     else
     {
@@ -1568,7 +2312,7 @@ void moto_mesh_select_less_verts(MotoMesh *self, MotoShapeSelection *selection)
         guint16 *e_verts = (guint16 *)self->e_verts;
 
         guint16 num = moto_shape_selection_get_selected_v_num(selection);
-        guint16* selected = (guint16*)g_try_malloc(sizeof(guint16)*num*2);
+        guint16* selected = (guint16*)moto_scratch_alloc(sizeof(guint16)*num*2);
         guint16* for_deselection = selected + num;
 
         guint16 i, j = 0;
@@ -1610,7 +2354,7 @@ void moto_mesh_select_less_verts(MotoMesh *self, MotoShapeSelection *selection)
         for(i = 0; i < j; i++)
             moto_shape_selection_deselect_vertex(selection, for_deselection[i]);
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
 }
 
@@ -1631,7 +2375,7 @@ void moto_mesh_select_more_edges(MotoMesh *self, MotoShapeSelection *selection)
         guint32 *e_verts = (guint32 *)self->e_verts;
 
         guint32* selected = \
-            (guint32*)g_try_malloc(sizeof(guint32)*moto_shape_selection_get_selected_e_num(selection));
+            (guint32*)moto_scratch_alloc(sizeof(guint32)*moto_shape_selection_get_selected_e_num(selection));
 
         guint32 i, j = 0;
         for(i = 0; i < self->e_num; i++)
@@ -1683,7 +2427,7 @@ void moto_mesh_select_more_edges(MotoMesh *self, MotoShapeSelection *selection)
             while(he != begin);
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
     else
     {
@@ -1692,7 +2436,7 @@ void moto_mesh_select_more_edges(MotoMesh *self, MotoShapeSelection *selection)
         guint16 *e_verts = (guint16 *)self->e_verts;
 
         guint16* selected = \
-            (guint16*)g_try_malloc(sizeof(guint16)*moto_shape_selection_get_selected_e_num(selection));
+            (guint16*)moto_scratch_alloc(sizeof(guint16)*moto_shape_selection_get_selected_e_num(selection));
 
         guint16 i, j = 0;
         for(i = 0; i < self->e_num; i++)
@@ -1788,7 +2532,7 @@ void moto_mesh_select_more_edges(MotoMesh *self, MotoShapeSelection *selection)
             }
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
 }
 
@@ -1804,7 +2548,7 @@ void moto_mesh_select_less_edges(MotoMesh *self, MotoShapeSelection *selection)
         guint32 *e_verts = (guint32 *)self->e_verts;
 
         guint32 num = moto_shape_selection_get_selected_e_num(selection);
-        guint32* selected = (guint32*)g_try_malloc(sizeof(guint32)*num*2);
+        guint32* selected = (guint32*)moto_scratch_alloc(sizeof(guint32)*num*2);
         guint32* for_deselection = selected + num;
 
         guint32 i, j = 0;
@@ -1890,7 +2634,7 @@ void moto_mesh_select_less_edges(MotoMesh *self, MotoShapeSelection *selection)
         for(i = 0; i < j; i++)
             moto_shape_selection_deselect_edge(selection, for_deselection[i]);
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
     else
     {
@@ -1899,7 +2643,7 @@ void moto_mesh_select_less_edges(MotoMesh *self, MotoShapeSelection *selection)
         guint16 *e_verts = (guint16 *)self->e_verts;
 
         guint16 num = moto_shape_selection_get_selected_e_num(selection);
-        guint16* selected = (guint16*)g_try_malloc(sizeof(guint16)*num*2);
+        guint16* selected = (guint16*)moto_scratch_alloc(sizeof(guint16)*num*2);
         guint16* for_deselection = selected + num;
 
         guint16 i, j = 0;
@@ -1985,7 +2729,7 @@ void moto_mesh_select_less_edges(MotoMesh *self, MotoShapeSelection *selection)
         for(i = 0; i < j; i++)
             moto_shape_selection_deselect_edge(selection, for_deselection[i]);
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
 }
 
@@ -2007,7 +2751,7 @@ void moto_mesh_select_more_faces(MotoMesh *self, MotoShapeSelection *selection)
         guint32 *f_verts  = (guint32 *)self->f_verts;
 
         guint32* selected = \
-            (guint32*)g_try_malloc(sizeof(guint32)*moto_shape_selection_get_selected_f_num(selection));
+            (guint32*)moto_scratch_alloc(sizeof(guint32)*moto_shape_selection_get_selected_f_num(selection));
 
         guint32 i, j = 0;
         for(i = 0; i < self->f_num; i++)
@@ -2044,7 +2788,7 @@ void moto_mesh_select_more_faces(MotoMesh *self, MotoShapeSelection *selection)
             }
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
     else
     {
@@ -2054,7 +2798,7 @@ void moto_mesh_select_more_faces(MotoMesh *self, MotoShapeSelection *selection)
         guint16 *f_verts  = (guint16 *)self->f_verts;
 
         guint16* selected = \
-            (guint16*)g_try_malloc(sizeof(guint16)*moto_shape_selection_get_selected_f_num(selection));
+            (guint16*)moto_scratch_alloc(sizeof(guint16)*moto_shape_selection_get_selected_f_num(selection));
 
         guint16 i, j = 0;
         for(i = 0; i < self->f_num; i++)
@@ -2091,7 +2835,7 @@ void moto_mesh_select_more_faces(MotoMesh *self, MotoShapeSelection *selection)
             }
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
 }
 
@@ -2108,7 +2852,7 @@ void moto_mesh_select_less_faces(MotoMesh *self, MotoShapeSelection *selection)
         guint32 *f_verts  = (guint32 *)self->f_verts;
 
         guint32 num = moto_shape_selection_get_selected_f_num(selection);
-        guint32* selected = (guint32*)g_try_malloc(sizeof(guint32)*num*2);
+        guint32* selected = (guint32*)moto_scratch_alloc(sizeof(guint32)*num*2);
         guint32* for_deselection = selected + num;
 
         guint32 i, j = 0, k = 0;
@@ -2163,7 +2907,7 @@ void moto_mesh_select_less_faces(MotoMesh *self, MotoShapeSelection *selection)
         for(i = 0; i < k; i++)
             moto_shape_selection_deselect_face(selection, for_deselection[i]);
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
     else
     {
@@ -2173,7 +2917,7 @@ void moto_mesh_select_less_faces(MotoMesh *self, MotoShapeSelection *selection)
         guint16 *f_verts  = (guint16 *)self->f_verts;
 
         guint16 num = moto_shape_selection_get_selected_f_num(selection);
-        guint16* selected = (guint16*)g_try_malloc(sizeof(guint16)*num*2);
+        guint16* selected = (guint16*)moto_scratch_alloc(sizeof(guint16)*num*2);
         guint16* for_deselection = selected + num;
 
         guint16 i, j = 0, k = 0;
@@ -2228,7 +2972,7 @@ void moto_mesh_select_less_faces(MotoMesh *self, MotoShapeSelection *selection)
         for(i = 0; i < k; i++)
             moto_shape_selection_deselect_face(selection, for_deselection[i]);
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
 }
 
@@ -2250,7 +2994,7 @@ void moto_mesh_update_selection_from_verts(MotoMesh *self, MotoShapeSelection *s
         MOTO_DECLARE_MESH_DATA_32(self);
 
         guint selected_v_num = moto_bitmask_get_set_num(selection->verts);
-        guint32 *selected    = moto_bitmask_create_array_32(selection->verts);
+        guint32 *selected    = scratch_array_32(selection->verts);
 
         guint32 i;
         for(i = 0; i < selected_v_num; ++i)
@@ -2308,14 +3052,14 @@ void moto_mesh_update_selection_from_verts(MotoMesh *self, MotoShapeSelection *s
             }
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
     else
     {
         MOTO_DECLARE_MESH_DATA_16(self);
 
         guint selected_v_num = moto_bitmask_get_set_num(selection->verts);
-        guint16 *selected    = moto_bitmask_create_array_16(selection->verts);
+        guint16 *selected    = scratch_array_16(selection->verts);
 
         guint16 i;
         for(i = 0; i < selected_v_num; ++i)
@@ -2373,7 +3117,7 @@ void moto_mesh_update_selection_from_verts(MotoMesh *self, MotoShapeSelection *s
             }
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
 }
 
@@ -2390,7 +3134,7 @@ void moto_mesh_update_selection_from_edges(MotoMesh *self, MotoShapeSelection *s
         MOTO_DECLARE_MESH_DATA_32(self);
 
         guint selected_e_num = moto_bitmask_get_set_num(selection->edges);
-        guint32 *selected    = moto_bitmask_create_array_32(selection->edges);
+        guint32 *selected    = scratch_array_32(selection->edges);
 
         guint32 i;
         for(i = 0; i < selected_e_num; ++i)
@@ -2408,14 +3152,14 @@ void moto_mesh_update_selection_from_edges(MotoMesh *self, MotoShapeSelection *s
                 moto_bitmask_set(selection->faces, he_data[pair].f_left);
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
     else
     {
         MOTO_DECLARE_MESH_DATA_16(self);
 
         guint selected_e_num = moto_bitmask_get_set_num(selection->edges);
-        guint16 *selected    = moto_bitmask_create_array_16(selection->edges);
+        guint16 *selected    = scratch_array_16(selection->edges);
 
         guint16 i;
         for(i = 0; i < selected_e_num; ++i)
@@ -2433,7 +3177,7 @@ void moto_mesh_update_selection_from_edges(MotoMesh *self, MotoShapeSelection *s
                 moto_bitmask_set(selection->faces, he_data[pair].f_left);
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
 }
 
@@ -2450,7 +3194,7 @@ void moto_mesh_update_selection_from_faces(MotoMesh *self, MotoShapeSelection *s
         MOTO_DECLARE_MESH_DATA_32(self);
 
         guint32 selected_f_num = moto_bitmask_get_set_num(selection->faces);
-        guint32 *selected = moto_bitmask_create_array_32(selection->faces);
+        guint32 *selected = scratch_array_32(selection->faces);
 
         guint32 i;
         for(i = 0; i < selected_f_num; ++i)
@@ -2471,14 +3215,14 @@ void moto_mesh_update_selection_from_faces(MotoMesh *self, MotoShapeSelection *s
             while(he != begin);
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
     else
     {
         MOTO_DECLARE_MESH_DATA_16(self);
 
         guint16 selected_f_num = moto_bitmask_get_set_num(selection->faces);
-        guint16 *selected = moto_bitmask_create_array_16(selection->faces);
+        guint16 *selected = scratch_array_16(selection->faces);
 
         guint16 i;
         for(i = 0; i < selected_f_num; ++i)
@@ -2504,7 +3248,7 @@ void moto_mesh_update_selection_from_faces(MotoMesh *self, MotoShapeSelection *s
             while(he != begin);
         }
 
-        g_free(selected);
+        moto_scratch_free(selected);
     }
 }
 
@@ -2616,50 +3360,29 @@ guint moto_mesh_get_v_edges_num(MotoMesh *self, guint vi)
     return result;
 }
 
-MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
-    MotoShapeSelection *selection, guint sections,
-    gfloat ltx, gfloat lty, gfloat ltz,
-    gfloat lrx, gfloat lry, gfloat lrz,
-    gfloat lsx, gfloat lsy, gfloat lsz)
-{
-    if(!selection)
-        return moto_mesh_new_copy(self);
-
-    guint selected_f_num = moto_shape_selection_get_selected_f_num(selection);
-    if(sections < 1 || selected_f_num < 1)
-    {
-        return moto_mesh_new_copy(self);
-    }
-
-    selection = moto_mesh_adapt_selection(self, selection);
-    selected_f_num = moto_shape_selection_get_selected_f_num(selection);
-    if(selected_f_num < 1)
-    {
-        moto_shape_selection_free(selection);
-        return moto_mesh_new_copy(self);
-    }
+/* Extrusion of faces is done in two phases. Topology depends only on selection
+ * and number of sections, positions of new verts are set after it by
+ * extrude_faces_move and may be rewritten in place. */
 
+static MotoMesh *extrude_faces_topology(MotoMesh *self,
+    guint16 *selected, guint selected_f_num, guint sections)
+{
     guint f_num = self->f_num;
     guint e_num = self->e_num;
     guint v_num = self->v_num;
     guint f_v_num = self->f_v_num;
 
-    guint16 *selected = moto_bitmask_create_array_16(selection->faces);
-
     MotoMeshFace16 *self_f_data = (MotoMeshFace16*)self->f_data;
     guint16 *self_f_verts = (guint16*)self->f_verts;
 
     guint16 i;
-    for(i = 0; i < self->f_num; i++)
+    for(i = 0; i < selected_f_num; i++)
     {
-        if(moto_shape_selection_check_face(selection, i))
-        {
-            guint16 num = moto_mesh_get_face_v_num(self, i)*sections;
-            v_num += num;
-            e_num += num*2;
-            f_num += num;
-            f_v_num += num*4;
-        }
+        guint16 num = moto_mesh_get_face_v_num(self, selected[i])*sections;
+        v_num += num;
+        e_num += num*2;
+        f_num += num;
+        f_v_num += num*4;
     }
 
     MotoMesh *mesh = moto_mesh_new(v_num, e_num, f_num, f_v_num);
@@ -2671,14 +3394,6 @@ MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
     memcpy(mesh->e_verts, self->e_verts, sizeof(guint16)*self->e_num*2);
     memcpy(mesh->f_verts, self->f_verts, sizeof(guint16)*self->f_v_num);
 
-    gfloat sltx = ltx/sections;
-    gfloat slty = lty/sections;
-    gfloat sltz = ltz/sections;
-
-    lrx *= RAD_PER_DEG;
-    lry *= RAD_PER_DEG;
-    lrz *= RAD_PER_DEG;
-
     guint16 fi = self->f_num;
     guint16 vi = self->v_num;
     guint16 v_offset = mesh->f_data16[self->f_num - 1].v_offset;
@@ -2688,7 +3403,6 @@ MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
         guint16 si = selected[i];
         guint v_num = moto_mesh_get_face_v_num(mesh, si);
         guint16 vs = self_f_data[si].v_offset - v_num;
-        gfloat *normal = (gfloat*)(self->f_normals + si);
 
         guint16 prev_vloop[v_num];
         guint16 vloop[v_num];
@@ -2699,6 +3413,83 @@ MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
         size_t loop_size = sizeof(guint16)*v_num;
         memcpy(vloop, self_f_verts + vs, loop_size);
 
+        for(j = 0; j < sections; ++j)
+        {
+            // Update vertex loops.
+            memcpy(prev_vloop, vloop, loop_size);
+            for(k = 0; k < v_num; ++k)
+            {
+                vloop[k] = vi++;
+            }
+
+            // Calculating side faces.
+            for(k = 0; k < v_num; ++k)
+            {
+                prev_vloop_v0 = prev_vloop[k];
+                prev_vloop_v1 = prev_vloop[(k+1)%v_num];
+                vloop_v0      = vloop[k];
+                vloop_v1      = vloop[(k+1)%v_num];
+
+                mesh->f_data16[fi].v_offset = v_offset + 4;
+                mesh->f_verts16[v_offset+3] = prev_vloop_v0;
+                mesh->f_verts16[v_offset+2] = vloop_v0;
+                mesh->f_verts16[v_offset+1] = vloop_v1;
+                mesh->f_verts16[v_offset]   = prev_vloop_v1;
+                v_offset += 4;
+
+                ++fi;
+            }
+        }
+
+        // Setting hat. Value of v_offset for extruded face is not changed.
+        memcpy(mesh->f_verts16 + mesh->f_data16[si].v_offset - v_num, vloop, loop_size);
+    }
+    g_assert(vi == mesh->v_num);
+    g_assert(fi == mesh->f_num);
+
+    return mesh;
+}
+
+/* Sets coords of verts added by extrude_faces_topology. Verts of each section
+ * of each extruded face follow each other. */
+static void extrude_faces_move(MotoMesh *mesh, MotoMesh *self,
+    guint16 *selected, guint selected_f_num, guint sections,
+    gfloat ltx, gfloat lty, gfloat ltz,
+    gfloat lrx, gfloat lry, gfloat lrz,
+    gfloat lsx, gfloat lsy, gfloat lsz)
+{
+    MotoMeshFace16 *self_f_data = (MotoMeshFace16*)self->f_data;
+    guint16 *self_f_verts = (guint16*)self->f_verts;
+
+    gfloat sltx = ltx/sections;
+    gfloat slty = lty/sections;
+    gfloat sltz = ltz/sections;
+
+    lrx *= RAD_PER_DEG;
+    lry *= RAD_PER_DEG;
+    lrz *= RAD_PER_DEG;
+
+    gfloat lrxm[16];
+    matrix44_rotate_x(lrxm, lrx);
+    gfloat lrym[16];
+    matrix44_rotate_y(lrym, lry);
+    gfloat lrzm[16];
+    matrix44_rotate_z(lrzm, lrz);
+    gfloat lrm[16], tmpm[16];
+    matrix44_mult(lrm, lrxm, lrym);
+    memcpy(tmpm, lrm, sizeof(gfloat)*16);
+    matrix44_mult(lrm, tmpm, lrzm);
+
+    guint16 vi = self->v_num;
+    guint i, j, k;
+    for(i = 0; i < selected_f_num; ++i)
+    {
+        guint16 si = selected[i];
+        guint v_num = moto_mesh_get_face_v_num(self, si);
+        guint16 vs = self_f_data[si].v_offset - v_num;
+        guint16 *vloop = self_f_verts + vs;
+        gfloat *normal = (gfloat*)(self->f_normals + si);
+
         gfloat z[] = {0, 0, 1};
         gfloat axis[3];
         gfloat tmp;
@@ -2711,9 +3502,9 @@ MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
         MotoVector center = {0, 0, 0};
         for(j = 0; j < v_num; ++j)
         {
-            v_coords[j].x = mesh->v_coords[vloop[j]].x;
-            v_coords[j].y = mesh->v_coords[vloop[j]].y;
-            v_coords[j].z = mesh->v_coords[vloop[j]].z;
+            v_coords[j].x = self->v_coords[vloop[j]].x;
+            v_coords[j].y = self->v_coords[vloop[j]].y;
+            v_coords[j].z = self->v_coords[vloop[j]].z;
             center.x += v_coords[j].x;
             center.y += v_coords[j].y;
             center.z += v_coords[j].z;
@@ -2722,7 +3513,7 @@ MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
         center.y /= v_num;
         center.z /= v_num;
 
-        gfloat m[16], im[16], tmpm[16];
+        gfloat m[16], im[16];
         if(c == 1)
         {
             matrix44_identity(im);
@@ -2746,39 +3537,15 @@ MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
             point3_transform((gfloat*)&v_coords[j], m, tmp);
         }
 
-        gfloat lrxm[16];
-        matrix44_rotate_x(lrxm, lrx);
-        gfloat lrym[16];
-        matrix44_rotate_y(lrym, lry);
-        gfloat lrzm[16];
-        matrix44_rotate_z(lrzm, lrz);
-        gfloat lrm[16];
-        matrix44_mult(lrm, lrxm, lrym);
-        memcpy(tmpm, lrm, sizeof(gfloat)*16);
-        matrix44_mult(lrm, tmpm, lrzm);
-
         for(j = 0; j < sections; ++j)
         {
-            // Update vertex loops.
-            memcpy(prev_vloop, vloop, loop_size);
-            for(k = 0; k < v_num; ++k)
-            {
-                vloop[k] = vi++;
-            }
+            gfloat jj = j + 1;
+            gfloat fac = jj/sections;
 
-            // Calculating side faces and moving verts.
             for(k = 0; k < v_num; ++k)
             {
-                prev_vloop_v0 = prev_vloop[k];
-                prev_vloop_v1 = prev_vloop[(k+1)%v_num];
-                vloop_v0      = vloop[k];
-                vloop_v1      = vloop[(k+1)%v_num];
-
                 gfloat *c = (gfloat*)(v_coords + k);
-                gfloat *p = (gfloat*)(mesh->v_coords + vloop_v0);
-
-                gfloat jj = j + 1;
-                gfloat fac = jj/sections;
+                gfloat *p = (gfloat*)(mesh->v_coords + vi++);
 
                 // SRT
                 gfloat pp[3] = {(1-fac + fac*lsx)*c[0], (1-fac + fac*lsy)*c[1], (1-fac + fac*lsz)*c[2]};
@@ -2788,26 +3555,102 @@ MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
                 pp[2] = p[2] + sltz*jj;
 
                 point3_transform(p, im, pp);
+            }
+        }
+    }
+}
 
-                mesh->f_data16[fi].v_offset = v_offset + 4;
-                mesh->f_verts16[v_offset+3] = prev_vloop_v0;
-                mesh->f_verts16[v_offset+2] = vloop_v0;
-                mesh->f_verts16[v_offset+1] = vloop_v1;
-                mesh->f_verts16[v_offset]   = prev_vloop_v1;
-                v_offset += 4;
+/* New verts and side faces take attributes of verts and corners of extruded face. */
+static void extrude_faces_attrs(MotoMesh *mesh, MotoMesh *self,
+    guint16 *selected, guint selected_f_num, guint sections)
+{
+    if( ! has_attrs(self))
+        return;
 
-                ++fi;
+    guint32 *v_map  = (guint32 *)moto_scratch_alloc(sizeof(guint32) * mesh->v_num);
+    guint32 *f_map  = (guint32 *)moto_scratch_alloc(sizeof(guint32) * mesh->f_num);
+    guint32 *fv_map = (guint32 *)moto_scratch_alloc(sizeof(guint32) * mesh->f_v_num);
+
+    guint i, j, k;
+    for(i = 0; i < self->v_num; i++)
+        v_map[i] = i;
+    for(i = 0; i < self->f_num; i++)
+        f_map[i] = i;
+    for(i = 0; i < self->f_v_num; i++)
+        fv_map[i] = i;
+
+    guint vi = self->v_num, fi = self->f_num, fvi = self->f_v_num;
+    for(i = 0; i < selected_f_num; i++)
+    {
+        guint16 si = selected[i];
+        guint v_num = moto_mesh_get_face_v_num(self, si);
+        guint32 vs = self->f_data16[si].v_offset - v_num;
+        for(j = 0; j < sections; j++)
+        {
+            for(k = 0; k < v_num; k++)
+                v_map[vi++] = self->f_verts16[vs + k];
+
+            // Corners of side faces are in order of extrude_faces_topology.
+            for(k = 0; k < v_num; k++)
+            {
+                guint32 next = vs + (k + 1)%v_num;
+                f_map[fi++]   = si;
+                fv_map[fvi++] = next;
+                fv_map[fvi++] = next;
+                fv_map[fvi++] = vs + k;
+                fv_map[fvi++] = vs + k;
             }
         }
+    }
 
-        // Setting hat. Value of v_offset for extruded face is not changed.
-        memcpy(mesh->f_verts16 + mesh->f_data16[si].v_offset - v_num, vloop, loop_size);
+    moto_mesh_copy_attrs(mesh, self, v_map, f_map, fv_map);
+
+    moto_scratch_free(v_map);
+}
+
+/* Faces of selection which exist in self. */
+static guint16 *create_selected_faces(MotoMesh *self, MotoShapeSelection *selection, guint *num)
+{
+    guint16 *selected = scratch_array_16(selection->faces);
+    guint set_num = moto_bitmask_get_set_num(selection->faces);
+
+    guint i;
+    *num = 0;
+    for(i = 0; i < set_num; i++)
+        if(selected[i] < self->f_num)
+            selected[(*num)++] = selected[i];
+
+    return selected;
+}
+
+MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
+    MotoShapeSelection *selection, guint sections,
+    gfloat ltx, gfloat lty, gfloat ltz,
+    gfloat lrx, gfloat lry, gfloat lrz,
+    gfloat lsx, gfloat lsy, gfloat lsz)
+{
+    if(!selection)
+        return moto_mesh_new_copy(self);
+
+    guint selected_f_num = moto_shape_selection_get_selected_f_num(selection);
+    if(sections < 1 || selected_f_num < 1)
+    {
+        return moto_mesh_new_copy(self);
     }
-    g_assert(vi == mesh->v_num);
-    g_assert(fi == mesh->f_num);
 
-    g_free(selected);
-    moto_shape_selection_free(selection);
+    guint16 *selected = create_selected_faces(self, selection, & selected_f_num);
+    if(selected_f_num < 1)
+    {
+        moto_scratch_free(selected);
+        return moto_mesh_new_copy(self);
+    }
+
+    MotoMesh *mesh = extrude_faces_topology(self, selected, selected_f_num, sections);
+    extrude_faces_attrs(mesh, self, selected, selected_f_num, sections);
+    extrude_faces_move(mesh, self, selected, selected_f_num, sections,
+        ltx, lty, ltz, lrx, lry, lrz, lsx, lsy, lsz);
+
+    moto_scratch_free(selected);
     if(!moto_mesh_prepare(mesh))
     {
         g_object_unref(mesh);
@@ -2816,6 +3659,72 @@ MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
     return mesh;
 }
 
+gboolean moto_mesh_extrude_faces_update(MotoMesh *mesh, MotoMesh *self,
+    MotoShapeSelection *selection, guint sections,
+    gfloat ltx, gfloat lty, gfloat ltz,
+    gfloat lrx, gfloat lry, gfloat lrz,
+    gfloat lsx, gfloat lsy, gfloat lsz)
+{
+    if( ! selection || sections < 1 || mesh->b32 || self->b32)
+        return FALSE;
+
+    guint selected_f_num;
+    guint16 *selected = create_selected_faces(self, selection, & selected_f_num);
+
+    guint i, j, added = 0;
+    for(i = 0; i < selected_f_num; i++)
+        added += moto_mesh_get_face_v_num(self, selected[i])*sections;
+
+    if(selected_f_num < 1 || mesh->v_num != self->v_num + added || mesh->f_num != self->f_num + added)
+    {
+        moto_scratch_free(selected);
+        return FALSE;
+    }
+
+    /* Attributes were copied by moto_mesh_extrude_faces and don't depend on positions. */
+    extrude_faces_move(mesh, self, selected, selected_f_num, sections,
+        ltx, lty, ltz, lrx, lry, lrz, lsx, lsy, lsz);
+
+    /* Only hats and side faces are moved. Tesselation is kept since hats are
+     * affine images of extruded faces. */
+    for(i = 0; i < selected_f_num; i++)
+        calc_face_normal16(mesh, selected[i]);
+    for(i = self->f_num; i < mesh->f_num; i++)
+        calc_face_normal16(mesh, i);
+
+    MotoMeshFace16 *self_f_data = (MotoMeshFace16*)self->f_data;
+    for(i = 0; i < selected_f_num; i++)
+    {
+        guint16 si = selected[i];
+        guint v_num = moto_mesh_get_face_v_num(self, si);
+        guint16 vs = self_f_data[si].v_offset - v_num;
+        for(j = 0; j < v_num; j++)
+            calc_vert_normal16(mesh, self->f_verts16[vs + j]);
+    }
+    for(i = self->v_num; i < mesh->v_num; i++)
+        calc_vert_normal16(mesh, i);
+
+    /* Bound of new verts is joined with bound of source mesh. */
+    gfloat b[6];
+    memcpy(b, moto_shape_get_bound((MotoShape *)self)->bound, sizeof(b));
+    for(i = self->v_num; i < mesh->v_num; i++)
+    {
+        MotoVector *v = mesh->v_coords + i;
+        b[0] = MIN(b[0], v->x);
+        b[1] = MAX(b[1], v->x);
+        b[2] = MIN(b[2], v->y);
+        b[3] = MAX(b[3], v->y);
+        b[4] = MIN(b[4], v->z);
+        b[5] = MAX(b[5], v->z);
+    }
+    moto_bound_set(moto_shape_get_bound((MotoShape *)mesh), b[0], b[1], b[2], b[3], b[4], b[5]);
+
+    moto_shape_touch((MotoShape *)mesh);
+
+    moto_scratch_free(selected);
+    return TRUE;
+}
+
 MotoMesh* moto_mesh_extrude_verts(MotoMesh *self,
     MotoShapeSelection *selection, guint sections,
     gfloat length)
@@ -2833,7 +3742,7 @@ MotoMesh* moto_mesh_extrude_verts(MotoMesh *self,
     guint f_num   = self->f_num;
     guint f_v_num = self->f_v_num;
 
-    guint16 *selected = moto_bitmask_create_array_16(selection->verts);
+    guint16 *selected = scratch_array_16(selection->verts);
 
     guint16 i;
     for(i = 0; i < v_num; ++i)
@@ -2883,7 +3792,7 @@ MotoMesh* moto_mesh_extrude_verts(MotoMesh *self,
     g_assert(vi == mesh->v_num);
     g_assert(fi == mesh->f_num);
 
-    g_free(selected);
+    moto_scratch_free(selected);
     moto_shape_selection_free(selection);
     if(!moto_mesh_prepare(mesh))
     {
@@ -2942,7 +3851,7 @@ MotoMesh* moto_mesh_remove(MotoMesh *self,
     guint16 f_num   = self->f_num - selected_f_num;
     guint16 f_v_num = self->f_v_num;
 
-    guint16 *selected = moto_bitmask_create_array_16(selection->faces);
+    guint16 *selected = scratch_array_16(selection->faces);
 
     MOTO_DECLARE_MESH_DATA_16(self);
 
@@ -3048,6 +3957,15 @@ MotoMesh* moto_mesh_remove(MotoMesh *self,
 
     MotoMesh *mesh = moto_mesh_new(v_num, e_num, f_num, f_v_num);
 
+    // Sources of elements which are left, for attributes.
+    guint32 *v_map = NULL, *f_map = NULL, *fv_map = NULL;
+    if(has_attrs(self))
+    {
+        v_map  = (guint32 *)moto_scratch_alloc(sizeof(guint32) * mesh->v_num);
+        f_map  = (guint32 *)moto_scratch_alloc(sizeof(guint32) * mesh->f_num);
+        fv_map = (guint32 *)moto_scratch_alloc(sizeof(guint32) * mesh->f_v_num);
+    }
+
     guint16 fi = 0;
     guint16 v_offset = 0;
     for(i = 0; i < self->f_num; ++i)
@@ -3062,6 +3980,14 @@ MotoMesh* moto_mesh_remove(MotoMesh *self,
             ((guint16*)self->f_verts) + f_data[i].v_offset - f_v_num,
             sizeof(guint16)*f_v_num);
 
+        if(f_map)
+        {
+            guint j;
+            f_map[fi] = i;
+            for(j = 0; j < f_v_num; j++)
+                fv_map[v_offset + j] = f_data[i].v_offset - f_v_num + j;
+        }
+
         v_offset += f_v_num;
         ((MotoMeshFace16*)mesh->f_data)[fi].v_offset = v_offset;
         ++fi;
@@ -3073,6 +3999,8 @@ MotoMesh* moto_mesh_remove(MotoMesh *self,
         if( ! moto_shape_selection_check_vertex(for_removing, i))
         {
             mesh->v_coords[vi] = self->v_coords[i];
+            if(v_map)
+                v_map[vi] = i;
 
             guint16 *f_verts = (guint16*)mesh->f_verts;
             guint16 j;
@@ -3086,7 +4014,13 @@ MotoMesh* moto_mesh_remove(MotoMesh *self,
         }
     }
 
-    g_free(selected);
+    if(v_map)
+    {
+        moto_mesh_copy_attrs(mesh, self, v_map, f_map, fv_map);
+        moto_scratch_free(v_map);
+    }
+
+    moto_scratch_free(selected);
     moto_shape_selection_free(for_removing);
     moto_shape_selection_free(selection);
     if(!moto_mesh_prepare(mesh))
@@ -3104,6 +4038,7 @@ __moto_mesh_foreach_point(MotoPointCloud *self,
     MotoPointCloudForeachPointFunc func, gpointer user_data)
 {
     MotoMesh *mesh = MOTO_MESH(self);
+    moto_mesh_unpack(mesh);
 
     guint32 i;
     for(i = 0; i < mesh->v_num; i++)
@@ -3121,6 +4056,7 @@ __moto_mesh_get_plain_data(MotoPointCloud *self,
     gfloat **points, gfloat **normals, gsize *size)
 {
     MotoMesh *mesh = MOTO_MESH(self);
+    moto_mesh_unpack(mesh);
 
     *points  = (gfloat *)(mesh->v_coords);
     *normals = (gfloat *)(mesh->v_normals);
@@ -45,7 +45,8 @@ typedef struct _MotoMeshFace32 MotoMeshFace32;
 typedef struct _MotoHalfEdge16 MotoHalfEdge16;
 typedef struct _MotoHalfEdge32 MotoHalfEdge32;
 
-typedef struct _MotoMeshVertAttr MotoMeshVertAttr;
+typedef struct _MotoMeshAttr MotoMeshAttr;
+typedef struct _MotoPackedVert MotoPackedVert;
 
 typedef void (*MotoMeshForeachVertexFunc)(MotoMesh *mesh,
         gpointer vert, gpointer user_data);
@@ -86,10 +87,44 @@ struct _MotoMeshFace32
     guint32 half_edge;
 };
 
-struct _MotoMeshVertAttr
+typedef enum
 {
+    MOTO_MESH_ATTR_FLOAT,
+    MOTO_MESH_ATTR_INT,
+    MOTO_MESH_ATTR_HALF,
+    MOTO_MESH_ATTR_BYTE
+} MotoMeshAttrType;
+
+typedef enum
+{
+    MOTO_MESH_ATTR_VERT,
+    MOTO_MESH_ATTR_FACE,
+    MOTO_MESH_ATTR_FACE_VERT /* Corner of face, indexed like f_verts. */
+} MotoMeshAttrDomain;
+
+/* Index of attribute in mesh. It stays valid until attribute is removed. */
+typedef guint MotoMeshAttrHandle;
+#define MOTO_MESH_ATTR_INVALID G_MAXUINT
+
+/* Channels are stored one after another (SoA) and each of them is aligned,
+ * so channel may be given to deformers and exporters without copying. */
+struct _MotoMeshAttr
+{
+    GQuark name;
+    MotoMeshAttrType type;
+    MotoMeshAttrDomain domain;
     guint chnum;
-    gfloat *data;
+    guint num;      /* Elements in each channel. */
+    gsize ch_size;  /* Aligned size of channel in bytes. */
+    gpointer data;
+};
+
+/* Vert of packed mesh. Position is quantised inside of bound and normal is
+ * projected on octahedron. */
+struct _MotoPackedVert
+{
+    guint16 coords[3];
+    gint16 normal[2];
 };
 
 struct _MotoHalfEdge16
@@ -137,9 +172,10 @@ struct _MotoMesh
     };
     MotoVector *v_coords;
     MotoVector *v_normals;
-    GData *v_attrs;
-    GData *e_attrs;
-    GData *f_attrs;
+    // Verts of packed mesh. v_coords and v_normals are NULL while it's set.
+    MotoPackedVert *v_packed;
+    gfloat v_pack_origin[3];
+    gfloat v_pack_step[3];
 
     // Edges
     guint e_num;
@@ -193,6 +229,13 @@ struct _MotoMesh
         MotoHalfEdge16 *he_data16;
         MotoHalfEdge32 *he_data32;
     };
+
+    // Attributes, handle is index in array. Removed ones are NULL.
+    GPtrArray *attrs;
+
+    // Block of pool which arrays of moto_mesh_new are carved from.
+    gpointer block;
+    gsize block_size;
 };
 
 struct _MotoMeshClass
@@ -251,10 +294,69 @@ void moto_mesh_calc_faces_normals(MotoMesh *self);
 void moto_mesh_calc_verts_normals(MotoMesh *self);
 void moto_mesh_calc_normals(MotoMesh *self);
 
+/* Finishes change of v_coords which kept topology instead of moto_shape_prepare.
+ * Half-edges and tesselation are kept, face normals and bound are recalculated
+ * and shape is touched. Vert normals are recalculated only if verts_normals is
+ * TRUE, so caller may write them itself. */
+void moto_mesh_update_coords(MotoMesh *self, gboolean verts_normals);
+
 gboolean moto_mesh_set_face(MotoMesh *self, guint32 fi, guint32 v_offset, guint32 *f_verts);
 
-MotoMeshVertAttr * moto_mesh_add_attr(MotoMesh *self, const gchar *attr_name, guint chnum);
-MotoMeshVertAttr *moto_mesh_get_attr(MotoMesh *self, const gchar *attr_name);
+/* Packing keeps each vert in 10 bytes instead of 32 for meshes which aren't
+ * edited. Topology and attributes stay as they are. While mesh is packed
+ * v_coords and v_normals are NULL, so code which reads them must unpack it
+ * first, drawing and export decode verts on demand. */
+gboolean moto_mesh_pack(MotoMesh *self);
+gboolean moto_mesh_unpack(MotoMesh *self);
+#define moto_mesh_is_packed(mesh) (NULL != (mesh)->v_packed)
+/* Writes 3 floats of coords and normals of verts [begin, end) either mesh is
+ * packed or not. Strides are in bytes, any of arrays may be NULL. */
+void moto_mesh_decode_verts(MotoMesh *self, guint begin, guint end,
+        gfloat *coords, gsize coords_stride, gfloat *normals, gsize normals_stride);
+
+/* Attributes */
+
+/* New attribute is filled with zeros. If mesh already has attribute with
+ * the same name it's returned when layout is the same, otherwise result is
+ * MOTO_MESH_ATTR_INVALID. */
+MotoMeshAttrHandle moto_mesh_add_attr(MotoMesh *self, const gchar *name,
+        MotoMeshAttrType type, MotoMeshAttrDomain domain, guint chnum);
+MotoMeshAttrHandle moto_mesh_find_attr(MotoMesh *self, const gchar *name);
+void moto_mesh_remove_attr(MotoMesh *self, MotoMeshAttrHandle handle);
+/* NULL for invalid or removed handle. */
+MotoMeshAttr *moto_mesh_get_attr(MotoMesh *self, MotoMeshAttrHandle handle);
+/* Attribute of self with name and layout of other, it's added when needed. */
+MotoMeshAttr *moto_mesh_get_attr_like(MotoMesh *self, MotoMeshAttr *other);
+
+#define moto_mesh_get_attrs_num(mesh) ((mesh)->attrs->len)
+
+guint moto_mesh_get_domain_num(MotoMesh *self, MotoMeshAttrDomain domain);
+gsize moto_mesh_attr_type_size(MotoMeshAttrType type);
+
+#define moto_mesh_attr_channel(attr, ch) \
+    ((gpointer)((guint8 *)(attr)->data + (ch)*(attr)->ch_size))
+#define moto_mesh_attr_float(attr, ch) ((gfloat *)moto_mesh_attr_channel(attr, ch))
+#define moto_mesh_attr_int(attr, ch)   ((gint32 *)moto_mesh_attr_channel(attr, ch))
+#define moto_mesh_attr_half(attr, ch)  ((guint16 *)moto_mesh_attr_channel(attr, ch))
+#define moto_mesh_attr_byte(attr, ch)  ((guint8 *)moto_mesh_attr_channel(attr, ch))
+
+/* Access to single values of any type, slow but convenient. */
+gfloat moto_mesh_attr_get_value(MotoMeshAttr *attr, guint ch, guint i);
+void moto_mesh_attr_set_value(MotoMeshAttr *attr, guint ch, guint i, gfloat value);
+
+gfloat moto_half_to_float(guint16 value);
+guint16 moto_float_to_half(gfloat value);
+
+/* Adds attributes of other to self. Element i of each domain is copied from
+ * element map[i] of other, invalid index gives zeros. Without map elements
+ * are copied one to one if domain has the same size in both meshes. */
+void moto_mesh_copy_attrs(MotoMesh *self, MotoMesh *other,
+        const guint32 *v_map, const guint32 *f_map, const guint32 *fv_map);
+
+/* Element i of dst is sum of elements of src with weights from offsets[i]
+ * to offsets[i+1]. Int and byte attributes take element of greatest weight. */
+void moto_mesh_attr_interpolate(MotoMeshAttr *dst, MotoMeshAttr *src,
+        const guint32 *offsets, const guint32 *indices, const gfloat *weights);
 
 void moto_mesh_foreach_vertex(MotoMesh *self,
         MotoMeshForeachVertexFunc func, gpointer user_data);
@@ -284,6 +386,8 @@ guint moto_mesh_get_face_v_num(MotoMesh *self, guint fi);
 guint moto_mesh_get_v_edges_num(MotoMesh *self, guint vi);
 
 gboolean moto_mesh_update_he_data(MotoMesh *self);
+/* Builds half edges, normals, tesselation and bound after faces are set. */
+gboolean moto_mesh_prepare(MotoMesh *self);
 
 gboolean moto_mesh_intersect_face(MotoMesh *self, guint fi, MotoRay *ray, gfloat *dist);
 
@@ -295,6 +399,14 @@ MotoMesh* moto_mesh_extrude_faces(MotoMesh *self,
     gfloat ltx, gfloat lty, gfloat ltz,
     gfloat lrx, gfloat lry, gfloat lrz,
     gfloat lsx, gfloat lsy, gfloat lsz);
+/* Rewrites in place positions of verts of mesh which is made by extrude_faces
+ * from self with the same selection and sections. Only new verts and faces
+ * around them are recalculated, attributes are kept. FALSE if mesh doesn't match. */
+gboolean moto_mesh_extrude_faces_update(MotoMesh *mesh, MotoMesh *self,
+    MotoShapeSelection *selection, guint sections,
+    gfloat ltx, gfloat lty, gfloat ltz,
+    gfloat lrx, gfloat lry, gfloat lrz,
+    gfloat lsx, gfloat lsy, gfloat lsz);
 
 MotoMesh* moto_mesh_extrude_region(MotoMesh *self,
     MotoShapeSelection *selection, guint sections,
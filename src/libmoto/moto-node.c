@@ -5,18 +5,22 @@
 #include "libmotoutil/moto-mapped-list.h"
 
 #include "moto-types.h"
+#include "moto-expression.h"
 #include "moto-param-spec.h"
 #include "moto-filename.h"
 
 #include "moto-node.h"
 #include "moto-scene-node.h"
 #include "moto-messager.h"
+#include "moto-profiler.h"
 #include "moto-variation.h"
 
 /* forwards */
 
 static void moto_param_update(MotoParam *self);
 static void moto_param_mark_for_update(MotoParam *self);
+static void moto_param_update_time_dependency(MotoParam *self);
+static void materialize_value(MotoParam *self);
 
 /* enums */
 
@@ -97,10 +101,16 @@ struct _MotoNodePriv
     GList *children;
 
     gboolean ready;
+    gboolean updating; /* Params written while TRUE aren't user edits. */
+
+    /* Cached when params are linked or expressions are changed. */
+    gboolean time_source;
+    gboolean animated;
 
     guint id;
 
     GString *name;
+    const gchar *interned_name; /* Interned on renaming, not on each use. */
     MotoSceneNode *scene_node;
 
     MotoMappedList params;
@@ -113,6 +123,9 @@ struct _MotoNodePriv
 
     /* For exporting optimization. */
     GTimeVal last_modified;
+    GTimeVal last_edited; /* Edits of node which aren't in params. */
+
+    GByteArray *dump; /* Reused by moto_node_get_dump. */
 };
 
 struct _MotoParamPriv
@@ -129,6 +142,8 @@ struct _MotoParamPriv
     GSList *dests;
 
     gboolean ready;
+    gboolean time_dependent; /* Only for IN params. Cached at link time. */
+    gboolean time_cut;       /* Source isn't followed in time. See moto_param_set_time_cut(). */
 
     /* Used for determing which IN params this OUT depends on.
      * Only for params with MOTO_PARAM_MODE_OUT flag. */
@@ -137,7 +152,11 @@ struct _MotoParamPriv
     gboolean scriptable; // Only hint for param editor
     gboolean use_expression;
     GString *expression;
+    MotoExpression *native_expression; /* NULL if expression needs Python. */
     PyObject *expression_function;
+    PyObject *expression_args; /* Reused between evaluations. */
+    gboolean batch_evaluated;  /* Result of moto_param_eval_batch() isn't used yet. */
+    gboolean batch_status;
 
     GString *name;
     GString *title;
@@ -147,6 +166,11 @@ struct _MotoParamPriv
     gboolean hidden;
     GTimeVal last_modified; /* For exporting optimization. */
 
+    /* Value is produced on first access, e.g. shape restored from dump. */
+    MotoParamLazyFunc lazy_func;
+    gpointer lazy_data;
+    GDestroyNotify lazy_destroy;
+
     /* GList *notes; // ??? */
 };
 
@@ -159,6 +183,9 @@ struct _MotoParamPriv
 
 static GObjectClass *node_parent_class = NULL;
 
+/* Changed each time when some node becomes animated or static. */
+static guint time_dependency_stamp = 0;
+
 static void
 moto_node_dispose(GObject *obj)
 {
@@ -168,6 +195,8 @@ moto_node_dispose(GObject *obj)
     priv->disposed = TRUE;
 
     g_string_free(priv->name, TRUE);
+    if(priv->dump)
+        g_byte_array_free(priv->dump, TRUE);
     moto_mapped_list_free_all(& priv->params, unref_gobject);
     moto_mapped_list_free_all(& priv->pgroups, (GFunc)free_group);
 
@@ -191,9 +220,14 @@ moto_node_init(MotoNode *self)
 
     priv->ready = FALSE;
 
-    static guint id = 0;
+    priv->time_source = FALSE;
+    priv->animated    = FALSE;
+
+    static volatile gint id = 0;
+    priv->id = g_atomic_int_exchange_and_add(& id, 1) + 1;
 
     priv->name = g_string_new("");
+    priv->interned_name = g_intern_static_string("");
     priv->scene_node = NULL;
 
     moto_mapped_list_init(& priv->params);
@@ -201,6 +235,8 @@ moto_node_init(MotoNode *self)
 
     priv->hidden = FALSE;
     g_get_current_time(& priv->last_modified);
+    priv->last_edited = priv->last_modified;
+    priv->dump = NULL;
 
     priv->tags = NULL;
 
@@ -224,6 +260,7 @@ moto_node_class_init(MotoNodeClass *klass)
     g_datalist_init(& klass->actions);
 
     klass->update = NULL;
+    klass->param_changed = NULL;
 
     g_type_class_add_private(goclass, sizeof(MotoNodePriv));
 }
@@ -364,6 +401,39 @@ void moto_node_set_parent(MotoNode *self, MotoNode *parent)
     }
 
     priv->parent = parent;
+
+    /* Set of animated nodes in the scene may be changed. */
+    if(priv->animated)
+        g_atomic_int_inc((gint *)& time_dependency_stamp);
+}
+
+static void set_scene_node_recursive(MotoNode *node, MotoSceneNode *scene_node)
+{
+    moto_node_set_scene_node(node, scene_node);
+
+    GList *l = MOTO_NODE_GET_PRIVATE(node)->children;
+    for(; l; l = g_list_next(l))
+        set_scene_node_recursive((MotoNode *)l->data, scene_node);
+}
+
+void moto_node_add_child(MotoNode *self, MotoNode *child)
+{
+    MotoNodePriv *priv = MOTO_NODE_GET_PRIVATE(self);
+    MotoNode *old = moto_node_get_parent(child);
+    if(old == self)
+        return;
+
+    /* List of children owns the node. */
+    if(old)
+    {
+        MotoNodePriv *old_priv = MOTO_NODE_GET_PRIVATE(old);
+        old_priv->children = g_list_remove(old_priv->children, child);
+    }
+
+    moto_node_set_parent(child, self);
+    priv->children = g_list_append(priv->children, child);
+
+    set_scene_node_recursive(child, moto_node_get_scene_node(self));
 }
 
 void moto_node_do_action(MotoNode *self, const gchar *action_name)
@@ -395,6 +465,13 @@ void moto_node_set_name(MotoNode *self, const gchar *name)
 {
     MotoNodePriv *priv = MOTO_NODE_GET_PRIVATE(self);
     g_string_assign(priv->name, name);
+    priv->interned_name = g_intern_string(name);
+}
+
+const gchar *moto_node_get_interned_name(MotoNode *self)
+{
+    MotoNodePriv *priv = MOTO_NODE_GET_PRIVATE(self);
+    return priv->interned_name;
 }
 
 const gchar *moto_node_get_full_name(MotoNode *self)
@@ -440,6 +517,10 @@ static void check_param_source_ready(MotoParam *param, gboolean *ready)
     if( ! *ready)
         return;
 
+    /* Source of cut param isn't updated in time, so it isn't waited for. */
+    if(MOTO_PARAM_GET_PRIVATE(param)->time_cut)
+        return;
+
     MotoParam *source = moto_param_get_source(param);
     if(source)
     {
@@ -464,6 +545,33 @@ gboolean moto_node_needs_update(MotoNode *self)
     return ! MOTO_NODE_GET_PRIVATE(self)->ready;
 }
 
+void moto_node_mark_for_update(MotoNode *self)
+{
+    MOTO_NODE_GET_PRIVATE(self)->ready = FALSE;
+}
+
+void moto_node_mark_as_updated(MotoNode *self)
+{
+    MOTO_NODE_GET_PRIVATE(self)->ready = TRUE;
+}
+
+void moto_node_set_updating(MotoNode *self, gboolean updating)
+{
+    MOTO_NODE_GET_PRIVATE(self)->updating = updating;
+}
+
+static void collect_python_param(MotoParam *param, GPtrArray *params)
+{
+    if(moto_param_needs_python(param))
+        g_ptr_array_add(params, param);
+}
+
+void moto_node_collect_python_params(MotoNode *self, GPtrArray *params)
+{
+    moto_mapped_list_foreach(& MOTO_NODE_GET_PRIVATE(self)->params,
+        (GFunc)collect_python_param, params);
+}
+
 guint moto_node_get_id(MotoNode *self)
 {
     MotoNodePriv *priv = MOTO_NODE_GET_PRIVATE(self);
@@ -1524,6 +1632,317 @@ void moto_node_restore_from_variation(MotoNode *self, MotoVariation *variation)
     moto_mapped_list_foreach(& priv->params, (GFunc)restore_param, variation);
 }
 
+/* Dump of node params. Values are native endian and 4 bytes aligned:
+ *   guint32 params_num
+ *   params_num * {guint32 id, guint32 kind, string name, value, guint32 use_expression, string expression}
+ * where string is guint32 length followed by padded bytes. Params of unsupported
+ * types and outputs have kind DUMP_NONE and no value. */
+
+enum
+{
+    DUMP_NONE,
+    DUMP_BOOLEAN,
+    DUMP_INT,
+    DUMP_UINT,
+    DUMP_FLOAT,
+    DUMP_DOUBLE,
+    DUMP_ENUM,
+    DUMP_STRING,
+    DUMP_VECTOR,
+    DUMP_FLOAT_ARRAY,
+};
+
+static gsize get_vector_size(GType type)
+{
+    if(type == MOTO_TYPE_BOOL2) return 2*sizeof(gboolean);
+    if(type == MOTO_TYPE_BOOL3) return 3*sizeof(gboolean);
+    if(type == MOTO_TYPE_BOOL4) return 4*sizeof(gboolean);
+    if(type == MOTO_TYPE_INT2) return 2*sizeof(gint);
+    if(type == MOTO_TYPE_INT3) return 3*sizeof(gint);
+    if(type == MOTO_TYPE_INT4) return 4*sizeof(gint);
+    if(type == MOTO_TYPE_FLOAT2) return 2*sizeof(gfloat);
+    if(type == MOTO_TYPE_FLOAT3) return 3*sizeof(gfloat);
+    if(type == MOTO_TYPE_FLOAT4) return 4*sizeof(gfloat);
+    return 0;
+}
+
+static guint get_dump_kind(GType type)
+{
+    if(G_TYPE_BOOLEAN == type) return DUMP_BOOLEAN;
+    if(G_TYPE_INT == type)     return DUMP_INT;
+    if(G_TYPE_UINT == type)    return DUMP_UINT;
+    if(G_TYPE_FLOAT == type)   return DUMP_FLOAT;
+    if(G_TYPE_DOUBLE == type)  return DUMP_DOUBLE;
+    if(g_type_is_a(type, G_TYPE_STRING)) return DUMP_STRING;
+    if(G_TYPE_IS_ENUM(type))   return DUMP_ENUM;
+    if(MOTO_TYPE_FLOAT_ARRAY == type) return DUMP_FLOAT_ARRAY;
+    if(get_vector_size(type))  return DUMP_VECTOR;
+    return DUMP_NONE;
+}
+
+static void dump_append(GByteArray *dump, gconstpointer data, gsize size)
+{
+    static const guint8 zero[4] = {0, 0, 0, 0};
+    g_byte_array_append(dump, data, size);
+    if(size % 4)
+        g_byte_array_append(dump, zero, 4 - size % 4);
+}
+
+static void dump_append_uint(GByteArray *dump, guint32 v)
+{
+    g_byte_array_append(dump, (const guint8 *)& v, sizeof(v));
+}
+
+static void dump_append_string(GByteArray *dump, const gchar *str)
+{
+    guint32 len = (str) ? strlen(str) : 0;
+    dump_append_uint(dump, len);
+    dump_append(dump, str, len);
+}
+
+static void dump_param(MotoParam *param, GByteArray *dump)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(param);
+
+    /* Outputs are results of update. They are saved without values only
+     * because their ids are needed for restoring of links. */
+    GValue *v = & priv->value;
+    guint kind = DUMP_NONE;
+    if(priv->mode & MOTO_PARAM_MODE_IN)
+        kind = get_dump_kind(G_VALUE_TYPE(v));
+
+    /* Count of params is in the beginning. */
+    (*(guint32 *)dump->data)++;
+
+    dump_append_uint(dump, priv->id);
+    dump_append_uint(dump, kind);
+    dump_append_string(dump, priv->name->str);
+
+    switch(kind)
+    {
+        case DUMP_BOOLEAN:
+            dump_append_uint(dump, g_value_get_boolean(v));
+        break;
+        case DUMP_INT:
+            dump_append_uint(dump, (guint32)g_value_get_int(v));
+        break;
+        case DUMP_UINT:
+            dump_append_uint(dump, g_value_get_uint(v));
+        break;
+        case DUMP_FLOAT:
+        {
+            gfloat f = g_value_get_float(v);
+            dump_append(dump, & f, sizeof(f));
+        }
+        break;
+        case DUMP_DOUBLE:
+        {
+            gdouble d = g_value_get_double(v);
+            dump_append(dump, & d, sizeof(d));
+        }
+        break;
+        case DUMP_ENUM:
+            dump_append_uint(dump, (guint32)g_value_get_enum(v));
+        break;
+        case DUMP_STRING:
+            dump_append_string(dump, g_value_get_string(v));
+        break;
+        case DUMP_VECTOR:
+        {
+            gsize size = get_vector_size(G_VALUE_TYPE(v));
+            dump_append_uint(dump, size);
+            dump_append(dump, g_value_peek_pointer(v), size);
+        }
+        break;
+        case DUMP_FLOAT_ARRAY:
+        {
+            gsize size = 0;
+            gfloat *data = moto_value_get_float_array(v, & size);
+            dump_append_uint(dump, size*sizeof(gfloat));
+            dump_append(dump, data, size*sizeof(gfloat));
+        }
+        break;
+    }
+
+    dump_append_uint(dump, priv->use_expression);
+    dump_append_string(dump, priv->expression->str);
+}
+
+gconstpointer moto_node_get_dump(MotoNode *self, glong *numbytes)
+{
+    MotoNodePriv *priv = MOTO_NODE_GET_PRIVATE(self);
+
+    if( ! priv->dump)
+        priv->dump = g_byte_array_new();
+    g_byte_array_set_size(priv->dump, 0);
+
+    dump_append_uint(priv->dump, 0);
+    moto_mapped_list_foreach(& priv->params, (GFunc)dump_param, priv->dump);
+
+    *numbytes = priv->dump->len;
+    return priv->dump->data;
+}
+
+typedef struct _MotoDumpReader
+{
+    const guint8 *data;
+    const guint8 *end;
+} MotoDumpReader;
+
+static gboolean read_uint(MotoDumpReader *r, guint32 *v)
+{
+    if(r->data + sizeof(guint32) > r->end)
+        return FALSE;
+    memcpy(v, r->data, sizeof(guint32));
+    r->data += sizeof(guint32);
+    return TRUE;
+}
+
+static gboolean read_bytes(MotoDumpReader *r, gsize size, const guint8 **bytes)
+{
+    gsize padded = (size + 3) & ~(gsize)3;
+    if(r->data + padded > r->end)
+        return FALSE;
+    *bytes = r->data;
+    r->data += padded;
+    return TRUE;
+}
+
+static gboolean read_string(MotoDumpReader *r, GString *str)
+{
+    guint32 len;
+    const guint8 *bytes;
+    if( ! read_uint(r, & len) || ! read_bytes(r, len, & bytes))
+        return FALSE;
+    g_string_truncate(str, 0);
+    g_string_append_len(str, (const gchar *)bytes, len);
+    return TRUE;
+}
+
+static gboolean restore_dumped_param(MotoNode *self, MotoDumpReader *r,
+        GString *name, GString *expr, GHashTable *ids)
+{
+    guint32 id, kind, raw, size;
+    const guint8 *bytes = NULL;
+
+    if( ! read_uint(r, & id) || ! read_uint(r, & kind) || ! read_string(r, name))
+        return FALSE;
+
+    switch(kind)
+    {
+        case DUMP_NONE:
+        break;
+        case DUMP_DOUBLE:
+            if( ! read_bytes(r, sizeof(gdouble), & bytes))
+                return FALSE;
+        break;
+        case DUMP_STRING:
+            if( ! read_string(r, expr))
+                return FALSE;
+            bytes = (const guint8 *)expr->str;
+        break;
+        case DUMP_VECTOR:
+        case DUMP_FLOAT_ARRAY:
+            if( ! read_uint(r, & size) || ! read_bytes(r, size, & bytes))
+                return FALSE;
+        break;
+        default:
+            if( ! read_uint(r, & raw))
+                return FALSE;
+        break;
+    }
+
+    MotoParam *param = moto_node_get_param(self, name->str);
+    if( ! param)
+    {
+        moto_warning("Node '%s' has no param '%s' from dump",
+            moto_node_get_name(self), name->str);
+    }
+    else
+    {
+        GValue *v = moto_param_get_value(param);
+        GType type = G_VALUE_TYPE(v);
+        if(kind != get_dump_kind(type))
+        {
+            if(DUMP_NONE != kind)
+                moto_warning("Type of param '%s' of node '%s' is changed, value isn't restored",
+                    name->str, moto_node_get_name(self));
+        }
+        else
+        {
+            gfloat f;
+            switch(kind)
+            {
+                case DUMP_BOOLEAN: g_value_set_boolean(v, raw);       break;
+                case DUMP_INT:     g_value_set_int(v, (gint32)raw);   break;
+                case DUMP_UINT:    g_value_set_uint(v, raw);          break;
+                case DUMP_ENUM:    g_value_set_enum(v, (gint32)raw);  break;
+                case DUMP_STRING:  g_value_set_string(v, expr->str);  break;
+                case DUMP_FLOAT:
+                    memcpy(& f, & raw, sizeof(f));
+                    g_value_set_float(v, f);
+                break;
+                case DUMP_DOUBLE:
+                {
+                    gdouble d;
+                    memcpy(& d, bytes, sizeof(d));
+                    g_value_set_double(v, d);
+                }
+                break;
+                case DUMP_VECTOR:
+                    if(size == get_vector_size(type))
+                        memcpy(g_value_peek_pointer(v), bytes, size);
+                break;
+                case DUMP_FLOAT_ARRAY:
+                    moto_value_set_float_array(v, (const gfloat *)bytes, size/sizeof(gfloat));
+                break;
+            }
+            moto_param_notify_dests(param);
+        }
+
+        if(ids)
+            g_hash_table_insert(ids, GUINT_TO_POINTER(id), param);
+    }
+
+    guint32 use_expression;
+    if( ! read_uint(r, & use_expression) || ! read_string(r, expr))
+        return FALSE;
+
+    if(param && (use_expression || expr->len))
+    {
+        moto_param_set_expression(param, expr->str);
+        moto_param_set_use_expression(param, use_expression);
+    }
+
+    return TRUE;
+}
+
+gboolean moto_node_set_dump(MotoNode *self, gconstpointer dump, glong numbytes,
+        GHashTable *ids)
+{
+    MotoDumpReader r = {dump, (const guint8 *)dump + numbytes};
+
+    guint32 num, i;
+    if( ! read_uint(& r, & num))
+        return FALSE;
+
+    GString *name = g_string_new("");
+    GString *expr = g_string_new("");
+
+    gboolean ok = TRUE;
+    for(i = 0; i < num && ok; i++)
+        ok = restore_dumped_param(self, & r, name, expr, ids);
+
+    g_string_free(name, TRUE);
+    g_string_free(expr, TRUE);
+
+    if( ! ok)
+        moto_error("Dump of node '%s' is corrupted", moto_node_get_name(self));
+
+    moto_node_mark_for_update(self);
+    return ok;
+}
+
 static void update_param(MotoParam *param, gpointer user_data)
 {
     if( ! MOTO_PARAM_GET_PRIVATE(param)->ready)
@@ -1535,13 +1954,19 @@ void moto_node_update(MotoNode *self)
     MotoNodePriv  *priv  = MOTO_NODE_GET_PRIVATE(self);
     MotoNodeClass *klass = MOTO_NODE_GET_CLASS(self);
 
+    MOTO_PROFILE_BEGIN(scope);
+
     moto_mapped_list_foreach( & priv->params, (GFunc)update_param, NULL);
 
+    priv->updating = TRUE;
     if(klass->update)
         klass->update(self);
+    priv->updating = FALSE;
 
     moto_node_update_last_modified(self);
     priv->ready = TRUE;
+
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_UPDATE, moto_node_get_interned_name(self), self);
 }
 
 const GTimeVal *moto_node_get_last_modified(MotoNode *self)
@@ -1556,6 +1981,18 @@ void moto_node_update_last_modified(MotoNode *self)
     g_get_current_time(& priv->last_modified);
 }
 
+const GTimeVal *moto_node_get_last_edited(MotoNode *self)
+{
+    MotoNodePriv *priv = MOTO_NODE_GET_PRIVATE(self);
+    return & priv->last_edited;
+}
+
+void moto_node_touch(MotoNode *self)
+{
+    MotoNodePriv *priv = MOTO_NODE_GET_PRIVATE(self);
+    g_get_current_time(& priv->last_edited);
+}
+
 void moto_node_set_tag(MotoNode *self, const gchar *tag)
 {
     MotoNodePriv *priv = MOTO_NODE_GET_PRIVATE(self);
@@ -1644,18 +2081,81 @@ gboolean moto_node_depends_on(MotoNode *self, MotoNode *other)
 }
 
 gboolean moto_node_is_animated(MotoNode *self)
+{
+    return MOTO_NODE_GET_PRIVATE(self)->animated;
+}
+
+static void update_dests_time_dependency(MotoParam *param, gpointer user_data)
+{
+    if( ! (moto_param_get_mode(param) & MOTO_PARAM_MODE_OUT))
+        return;
+
+    GSList *dest = MOTO_PARAM_GET_PRIVATE(param)->dests;
+    for(; dest; dest = g_slist_next(dest))
+        moto_param_update_time_dependency((MotoParam *)dest->data);
+}
+
+/* Recalculates animated flag of the node and if it's changed passes it to
+ * all dependent nodes. Called only when graph or expressions are changed. */
+static void moto_node_update_time_dependency(MotoNode *self)
 {
     MotoNodePriv *priv = MOTO_NODE_GET_PRIVATE(self);
 
+    gboolean animated = priv->time_source;
+
+    GSList *p = priv->params.sl;
+    for(; p && ! animated; p = g_slist_next(p))
+        animated = MOTO_PARAM_GET_PRIVATE(p->data)->time_dependent;
+
+    if(animated == priv->animated)
+        return;
+    priv->animated = animated;
+    g_atomic_int_inc((gint *)& time_dependency_stamp);
+
+    moto_mapped_list_foreach(& priv->params, (GFunc)update_dests_time_dependency, NULL);
+}
+
+void moto_node_set_time_source(MotoNode *self, gboolean time_source)
+{
+    MOTO_NODE_GET_PRIVATE(self)->time_source = time_source;
+    moto_node_update_time_dependency(self);
+}
+
+static gboolean is_param_time_cut(MotoParam *param)
+{
+    if( ! (moto_param_get_mode(param) & MOTO_PARAM_MODE_OUT))
+        return TRUE;
+
+    GSList *dest = MOTO_PARAM_GET_PRIVATE(param)->dests;
+    for(; dest; dest = g_slist_next(dest))
+    {
+        MotoParamPriv *dp = MOTO_PARAM_GET_PRIVATE(dest->data);
+        if( ! dp->time_cut && ! (dp->node && moto_node_is_time_cut(dp->node)))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean moto_node_is_time_cut(MotoNode *self)
+{
+    MotoNodePriv *priv = MOTO_NODE_GET_PRIVATE(self);
+
+    gboolean has_dests = FALSE;
     GSList *p = priv->params.sl;
     for(; p; p = g_slist_next(p))
     {
         MotoParam *param = (MotoParam *)p->data;
-        if(moto_param_is_animated(param))
-            return TRUE;
+        if( ! is_param_time_cut(param))
+            return FALSE;
+        if((moto_param_get_mode(param) & MOTO_PARAM_MODE_OUT) && MOTO_PARAM_GET_PRIVATE(param)->dests)
+            has_dests = TRUE;
     }
+    return has_dests;
+}
 
-    return FALSE;
+guint moto_node_get_time_dependency_stamp(void)
+{
+    return (guint)g_atomic_int_get((gint *)& time_dependency_stamp);
 }
 
 /* class MotoParam */
@@ -1681,6 +2181,25 @@ moto_param_dispose(GObject *obj)
     if(priv->depends_on_params) // FIXME: Remove depends_on_params?
         g_ptr_array_free(priv->depends_on_params, TRUE);
     g_string_free(priv->expression, TRUE);
+    if(priv->native_expression)
+        moto_expression_free(priv->native_expression);
+
+    /* Param may be disposed by any thread, so GIL is taken.
+     * Interpreter may be already finalized with the last system. */
+    if((priv->expression_function || priv->expression_args) && Py_IsInitialized())
+    {
+        PyGILState_STATE gstate = PyGILState_Ensure();
+        Py_XDECREF(priv->expression_function);
+        Py_XDECREF(priv->expression_args);
+        PyGILState_Release(gstate);
+    }
+    priv->expression_function = NULL;
+    priv->expression_args = NULL;
+
+    if(priv->lazy_destroy)
+        priv->lazy_destroy(priv->lazy_data);
+    priv->lazy_func = NULL;
+    priv->lazy_destroy = NULL;
 
     param_parent_class->dispose(obj);
 }
@@ -1699,22 +2218,28 @@ moto_param_init(MotoParam *self)
 
     priv->is_static = FALSE;
 
-    static guint id = 0;
+    static volatile gint id = 0;
     // FIXME: Implement generating unique ids correcly even when
     // scene loaded from file and params are saved in variations.
-    priv->id = ++id;
+    priv->id = g_atomic_int_exchange_and_add(& id, 1) + 1;
 
     priv->source = NULL;
     priv->dests = NULL;
 
     priv->ready = FALSE;
+    priv->time_dependent = FALSE;
+    priv->time_cut = FALSE;
 
     priv->depends_on_params = NULL;
 
     priv->scriptable     = TRUE;
     priv->use_expression = FALSE;
     priv->expression = g_string_new("");
+    priv->native_expression = NULL;
     priv->expression_function = NULL;
+    priv->expression_args = NULL;
+    priv->batch_evaluated = FALSE;
+    priv->batch_status = FALSE;
 
     priv->name = g_string_new("");
     priv->title = g_string_new("");
@@ -1725,6 +2250,10 @@ moto_param_init(MotoParam *self)
 
     priv->hidden = FALSE;
     g_get_current_time(& priv->last_modified);
+
+    priv->lazy_func = NULL;
+    priv->lazy_data = NULL;
+    priv->lazy_destroy = NULL;
 }
 
 static void
@@ -1884,9 +2413,74 @@ guint moto_param_get_id(MotoParam *self)
     return priv->id;
 }
 
+const GTimeVal *moto_param_get_last_modified(MotoParam *self)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+    return & priv->last_modified;
+}
+
+/* Called on every change made by user (value, link or expression). */
+static void touch_param(MotoParam *self)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+    g_get_current_time(& priv->last_modified);
+}
+
+/* Lazy values may be requested from several update threads at once. */
+G_LOCK_DEFINE_STATIC(lazy_value);
+
+static void materialize_value(MotoParam *self)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+
+    G_LOCK(lazy_value);
+    if(priv->lazy_func)
+    {
+        priv->lazy_func(self, & priv->value, priv->lazy_data);
+        if(priv->lazy_destroy)
+            priv->lazy_destroy(priv->lazy_data);
+        priv->lazy_func = NULL;
+        priv->lazy_data = NULL;
+        priv->lazy_destroy = NULL;
+    }
+    G_UNLOCK(lazy_value);
+}
+
+void moto_param_set_lazy_value(MotoParam *self, MotoParamLazyFunc func,
+        gpointer user_data, GDestroyNotify destroy)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+
+    G_LOCK(lazy_value);
+    if(priv->lazy_destroy)
+        priv->lazy_destroy(priv->lazy_data);
+    priv->lazy_func = func;
+    priv->lazy_data = user_data;
+    priv->lazy_destroy = destroy;
+    G_UNLOCK(lazy_value);
+}
+
+/* Pending lazy value is dropped when a new value is set, otherwise it
+ * would be materialized later over the new one. */
+static GValue *get_value_to_set(MotoParam *self)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+
+    if(priv->lazy_func)
+        moto_param_set_lazy_value(self, NULL, NULL, NULL);
+    return & priv->value;
+}
+
+gboolean moto_param_has_lazy_value(MotoParam *self)
+{
+    return MOTO_PARAM_GET_PRIVATE(self)->lazy_func != NULL;
+}
+
 GValue *moto_param_get_value(MotoParam *self)
 {
     MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+    if(priv->lazy_func)
+        materialize_value(self);
     return & priv->value;
 }
 
@@ -1935,6 +2529,8 @@ gint moto_param_get_enum(MotoParam *self)
 GObject *moto_param_get_object(MotoParam *self)
 {
     MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+    if(priv->lazy_func)
+        materialize_value(self);
     return g_value_get_object(& priv->value);
 }
 
@@ -2036,50 +2632,43 @@ void moto_param_get_4fv(MotoParam *self, gfloat *v)
 
 void moto_param_set_boolean(MotoParam *self, gboolean value)
 {
-    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
-    g_value_set_boolean( & priv->value, value);
+    g_value_set_boolean(get_value_to_set(self), value);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_int(MotoParam *self, gint value)
 {
-    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
-    g_value_set_int(& priv->value, value);
+    g_value_set_int(get_value_to_set(self), value);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_float(MotoParam *self, gfloat value)
 {
-    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
-    g_value_set_float(& priv->value, value);
+    g_value_set_float(get_value_to_set(self), value);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_string(MotoParam *self, const gchar *value)
 {
-    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
-    g_value_set_string(& priv->value, value);
+    g_value_set_string(get_value_to_set(self), value);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_pointer(MotoParam *self, gpointer value)
 {
-    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
-    g_value_set_pointer(& priv->value, value);
+    g_value_set_pointer(get_value_to_set(self), value);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_enum(MotoParam *self, gint value)
 {
-    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
-    g_value_set_enum(& priv->value, value);
+    g_value_set_enum(get_value_to_set(self), value);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_object(MotoParam *self, GObject *value)
 {
-    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
-    g_value_set_object(& priv->value, value);
+    g_value_set_object(get_value_to_set(self), value);
     moto_param_notify_dests(self);
 }
 
@@ -2087,37 +2676,37 @@ void moto_param_set_object(MotoParam *self, GObject *value)
 
 void moto_param_set_2b(MotoParam *self, gboolean v0, gboolean v1)
 {
-    moto_value_set_bool2(moto_param_get_value(self), v0, v1);
+    moto_value_set_bool2(get_value_to_set(self), v0, v1);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_2bv(MotoParam *self, const gboolean *v)
 {
-    moto_value_set_bool2_v(moto_param_get_value(self), v);
+    moto_value_set_bool2_v(get_value_to_set(self), v);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_3b(MotoParam *self, gboolean v0, gboolean v1, gboolean v2)
 {
-    moto_value_set_bool3(moto_param_get_value(self), v0, v1, v2);
+    moto_value_set_bool3(get_value_to_set(self), v0, v1, v2);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_3bv(MotoParam *self, const gboolean *v)
 {
-    moto_value_set_bool3_v(moto_param_get_value(self), v);
+    moto_value_set_bool3_v(get_value_to_set(self), v);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_4b(MotoParam *self, gboolean v0, gboolean v1, gboolean v2, gboolean v3)
 {
-    moto_value_set_bool4(moto_param_get_value(self), v0, v1, v2, v3);
+    moto_value_set_bool4(get_value_to_set(self), v0, v1, v2, v3);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_4bv(MotoParam *self, const gboolean *v)
 {
-    moto_value_set_bool4_v(moto_param_get_value(self), v);
+    moto_value_set_bool4_v(get_value_to_set(self), v);
     moto_param_notify_dests(self);
 }
 
@@ -2125,37 +2714,37 @@ void moto_param_set_4bv(MotoParam *self, const gboolean *v)
 
 void moto_param_set_2i(MotoParam *self, gint v0, gint v1)
 {
-    moto_value_set_int2(moto_param_get_value(self), v0, v1);
+    moto_value_set_int2(get_value_to_set(self), v0, v1);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_2iv(MotoParam *self, const gint *v)
 {
-    moto_value_set_int2_v(moto_param_get_value(self), v);
+    moto_value_set_int2_v(get_value_to_set(self), v);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_3i(MotoParam *self, gint v0, gint v1, gint v2)
 {
-    moto_value_set_int3(moto_param_get_value(self), v0, v1, v2);
+    moto_value_set_int3(get_value_to_set(self), v0, v1, v2);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_3iv(MotoParam *self, const gint *v)
 {
-    moto_value_set_int3_v(moto_param_get_value(self), v);
+    moto_value_set_int3_v(get_value_to_set(self), v);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_4i(MotoParam *self, gint v0, gint v1, gint v2, gint v3)
 {
-    moto_value_set_int4(moto_param_get_value(self), v0, v1, v2, v3);
+    moto_value_set_int4(get_value_to_set(self), v0, v1, v2, v3);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_4iv(MotoParam *self, const gint *v)
 {
-    moto_value_set_int4_v(moto_param_get_value(self), v);
+    moto_value_set_int4_v(get_value_to_set(self), v);
     moto_param_notify_dests(self);
 }
 
@@ -2163,37 +2752,37 @@ void moto_param_set_4iv(MotoParam *self, const gint *v)
 
 void moto_param_set_2f(MotoParam *self, gfloat v0, gfloat v1)
 {
-    moto_value_set_float2(moto_param_get_value(self), v0, v1);
+    moto_value_set_float2(get_value_to_set(self), v0, v1);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_2fv(MotoParam *self, const gfloat *v)
 {
-    moto_value_set_float2_v(moto_param_get_value(self), v);
+    moto_value_set_float2_v(get_value_to_set(self), v);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_3f(MotoParam *self, gfloat v0, gfloat v1, gfloat v2)
 {
-    moto_value_set_float3(moto_param_get_value(self), v0, v1, v2);
+    moto_value_set_float3(get_value_to_set(self), v0, v1, v2);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_3fv(MotoParam *self, const gfloat *v)
 {
-    moto_value_set_float3_v(moto_param_get_value(self), v);
+    moto_value_set_float3_v(get_value_to_set(self), v);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_4f(MotoParam *self, gfloat v0, gfloat v1, gfloat v2, gfloat v3)
 {
-    moto_value_set_float4(moto_param_get_value(self), v0, v1, v2, v3);
+    moto_value_set_float4(get_value_to_set(self), v0, v1, v2, v3);
     moto_param_notify_dests(self);
 }
 
 void moto_param_set_4fv(MotoParam *self, const gfloat *v)
 {
-    moto_value_set_float4_v(moto_param_get_value(self), v);
+    moto_value_set_float4_v(get_value_to_set(self), v);
     moto_param_notify_dests(self);
 }
 
@@ -2208,6 +2797,8 @@ disconnect_on_source_deleted(MotoParam *param, GObject *where_the_object_was)
 {
     MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(param);
     priv->source = NULL;
+
+    moto_param_update_time_dependency(param);
 }
 
 static void
@@ -2286,6 +2877,8 @@ void moto_param_link(MotoParam *self, MotoParam *src)
     priv->source = src;
     src_priv->dests = g_slist_append(src_priv->dests, self);
 
+    touch_param(self);
+    moto_param_update_time_dependency(self);
     moto_param_mark_for_update(self);
 }
 
@@ -2303,12 +2896,17 @@ void moto_param_unlink_source(MotoParam *self)
 
     src_priv->dests = g_slist_remove(src_priv->dests, self);
     priv->source = NULL;
+
+    touch_param(self);
+    moto_param_update_time_dependency(self);
 }
 
 static void null_source(gpointer data, gpointer user_data)
 {
     MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(data);
     priv->source = NULL;
+
+    moto_param_update_time_dependency((MotoParam *)data);
 }
 
 void moto_param_unlink_dests(MotoParam *self)
@@ -2354,36 +2952,73 @@ gboolean moto_param_is_animated(MotoParam *self)
 {
     MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
 
-    if(priv->mode & MOTO_PARAM_MODE_IN)
-    {
-        /* Evaluation order: value, source, expression (can use value and source).
-         * If expresion is invalid source is used if it's not NULL else value of param. */
-        if(priv->use_expression)
-        {
-            return TRUE;
-        }
-        else if(priv->source)
-        {
-            return moto_param_is_animated(priv->source);
-        }
-    }
+    if((priv->mode & MOTO_PARAM_MODE_IN) && priv->time_dependent)
+        return TRUE;
+
     if(priv->mode & MOTO_PARAM_MODE_OUT)
     {
-        if(priv->depends_on_params)
+        /* Without explicit dependencies output follows the whole node. */
+        if( ! priv->depends_on_params)
+            return priv->node && moto_node_is_animated(priv->node);
+
+        guint i;
+        for(i = 0; i < priv->depends_on_params->len; i++)
         {
-            guint i;
-            for(i = 0; i < priv->depends_on_params->len; i++)
-            {
-                MotoParam *dp = (MotoParam *)g_ptr_array_index(priv->depends_on_params, i);
-                if(moto_param_is_animated(dp))
-                    return TRUE;
-            }
+            MotoParam *dp = (MotoParam *)g_ptr_array_index(priv->depends_on_params, i);
+            if(moto_param_is_animated(dp))
+                return TRUE;
         }
     }
 
     return FALSE;
 }
 
+static gboolean calc_time_dependency(MotoParam *self)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+
+    if( ! (priv->mode & MOTO_PARAM_MODE_IN))
+        return FALSE;
+
+    /* Evaluation order: value, source, expression (can use value and source).
+     * Python expressions may use anything so they are always animated. */
+    if(priv->use_expression)
+    {
+        if( ! priv->native_expression)
+            return TRUE;
+        if(moto_expression_get_vars(priv->native_expression) & MOTO_EXPRESSION_VAR_TIME)
+            return TRUE;
+    }
+
+    return priv->source && ! priv->time_cut && moto_param_is_animated(priv->source);
+}
+
+static void moto_param_update_time_dependency(MotoParam *self)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+
+    gboolean time_dependent = calc_time_dependency(self);
+    if(time_dependent == priv->time_dependent)
+        return;
+    priv->time_dependent = time_dependent;
+
+    if(priv->node)
+        moto_node_update_time_dependency(priv->node);
+}
+
+void moto_param_set_time_cut(MotoParam *self, gboolean cut)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+
+    if(priv->time_cut == cut)
+        return;
+    priv->time_cut = cut;
+
+    /* Lists of animated nodes are rebuilt even if flag of node isn't changed. */
+    g_atomic_int_inc((gint *)& time_dependency_stamp);
+    moto_param_update_time_dependency(self);
+}
+
 MotoNode *moto_param_get_node(MotoParam *self)
 {
     MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
@@ -2397,6 +3032,120 @@ gboolean moto_param_is_static(MotoParam *self)
 
 // Dealing with expressions
 
+/* Returns number of components of types supported by native expressions or 0. */
+static guint get_value_layout(GType type, gchar *kind)
+{
+    gchar k;
+    guint size;
+
+    if(MOTO_TYPE_FLOAT == type)       { k = 'f'; size = 1; }
+    else if(MOTO_TYPE_FLOAT2 == type) { k = 'f'; size = 2; }
+    else if(MOTO_TYPE_FLOAT3 == type) { k = 'f'; size = 3; }
+    else if(MOTO_TYPE_FLOAT4 == type) { k = 'f'; size = 4; }
+    else if(MOTO_TYPE_INT == type)    { k = 'i'; size = 1; }
+    else if(MOTO_TYPE_INT2 == type)   { k = 'i'; size = 2; }
+    else if(MOTO_TYPE_INT3 == type)   { k = 'i'; size = 3; }
+    else if(MOTO_TYPE_INT4 == type)   { k = 'i'; size = 4; }
+    else if(MOTO_TYPE_BOOL == type)   { k = 'b'; size = 1; }
+    else if(MOTO_TYPE_BOOL2 == type)  { k = 'b'; size = 2; }
+    else if(MOTO_TYPE_BOOL3 == type)  { k = 'b'; size = 3; }
+    else if(MOTO_TYPE_BOOL4 == type)  { k = 'b'; size = 4; }
+    else
+        return 0;
+
+    if(kind)
+        *kind = k;
+    return size;
+}
+
+static gboolean expression_value_from_GValue(MotoExpressionValue *ev, GValue *v)
+{
+    gchar kind;
+    guint size = get_value_layout(G_VALUE_TYPE(v), & kind);
+    if( ! size)
+        return FALSE;
+
+    ev->size = size;
+    ev->is_int = 'f' != kind;
+    if(1 == size)
+    {
+        switch(kind)
+        {
+            case 'f': ev->v[0] = g_value_get_float(v); break;
+            case 'i': ev->v[0] = g_value_get_int(v); break;
+            case 'b': ev->v[0] = g_value_get_boolean(v); break;
+        }
+        return TRUE;
+    }
+
+    gpointer p = g_value_peek_pointer(v);
+    guint i;
+    for(i = 0; i < size; i++)
+    {
+        switch(kind)
+        {
+            case 'f': ev->v[i] = ((gfloat *)p)[i]; break;
+            case 'i': ev->v[i] = ((gint *)p)[i]; break;
+            case 'b': ev->v[i] = ((gboolean *)p)[i]; break;
+        }
+    }
+    return TRUE;
+}
+
+static gboolean expression_value_to_GValue(const MotoExpressionValue *ev, GValue *v)
+{
+    gchar kind;
+    guint size = get_value_layout(G_VALUE_TYPE(v), & kind);
+    if( ! size || (ev->size != size && ev->size != 1))
+        return FALSE;
+
+    if(1 == size)
+    {
+        switch(kind)
+        {
+            case 'f': g_value_set_float(v, ev->v[0]); break;
+            case 'i': g_value_set_int(v, (gint)ev->v[0]); break;
+            case 'b': g_value_set_boolean(v, 0 != ev->v[0]); break;
+        }
+        return TRUE;
+    }
+
+    /* Scalar result is broadcasted to all components. */
+    gpointer p = g_value_peek_pointer(v);
+    guint i;
+    for(i = 0; i < size; i++)
+    {
+        gfloat x = ev->v[(1 == ev->size) ? 0 : i];
+        switch(kind)
+        {
+            case 'f': ((gfloat *)p)[i] = x; break;
+            case 'i': ((gint *)p)[i] = (gint)x; break;
+            case 'b': ((gboolean *)p)[i] = (0 != x); break;
+        }
+    }
+    return TRUE;
+}
+
+static gboolean param_eval_native(MotoParam *self)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+
+    MotoExpressionContext ctx;
+    if( ! expression_value_from_GValue(& ctx.value, & priv->value))
+        return FALSE;
+
+    ctx.has_source = priv->source && \
+        expression_value_from_GValue(& ctx.source, moto_param_get_value(priv->source));
+    MotoSceneNode *scene_node = priv->node ? moto_node_get_scene_node(priv->node) : NULL;
+    ctx.time = scene_node ? moto_scene_node_get_current_time(scene_node) : 0;
+
+    MotoExpressionValue result;
+    if( ! moto_expression_eval(priv->native_expression, & ctx, & result))
+        return FALSE;
+
+    return expression_value_to_GValue(& result, & priv->value);
+}
+
 void moto_param_set_scriptable(MotoParam *self, gboolean scriptable)
 {
     MOTO_PARAM_GET_PRIVATE(self)->scriptable = scriptable;
@@ -2410,6 +3159,8 @@ gboolean moto_param_get_scriptable(MotoParam *self)
 void moto_param_set_use_expression(MotoParam *self, gboolean use)
 {
     MOTO_PARAM_GET_PRIVATE(self)->use_expression = use;
+    touch_param(self);
+    moto_param_update_time_dependency(self);
     if(use)
         moto_param_eval(self);
 }
@@ -2423,14 +3174,35 @@ void moto_param_set_expression(MotoParam *self, const gchar *body)
 {
     MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
     g_string_assign(priv->expression, body);
+    touch_param(self);
 
-    if(priv->expression_function)
+    if(priv->native_expression)
     {
-        Py_DECREF(priv->expression_function);
+        moto_expression_free(priv->native_expression);
+        priv->native_expression = NULL;
     }
+    priv->batch_evaluated = FALSE;
+
+    /* Python is used only if expression can't be compiled natively
+     * or type of param isn't supported by native expressions. */
+    if(get_value_layout(G_VALUE_TYPE(& priv->value), NULL))
+        priv->native_expression = moto_expression_new(body);
+    moto_param_update_time_dependency(self);
 
-    priv->expression_function = \
-        moto_PyFunction_from_args_and_body("(p=None, v=None, s=None)", body);
+    if( ! priv->expression_function && ! priv->expression_args && priv->native_expression)
+        return;
+
+    PyGILState_STATE gstate = PyGILState_Ensure();
+
+    Py_XDECREF(priv->expression_function);
+    Py_XDECREF(priv->expression_args);
+    priv->expression_function = NULL;
+    priv->expression_args = NULL;
+    if( ! priv->native_expression)
+        priv->expression_function = \
+            moto_PyFunction_from_args_and_body("(p=None, v=None, s=None, t=0.0, time=0.0)", body);
+
+    PyGILState_Release(gstate);
 }
 
 const gchar *moto_param_get_expression(MotoParam *self)
@@ -2439,30 +3211,44 @@ const gchar *moto_param_get_expression(MotoParam *self)
     return priv->expression->str;
 }
 
-gboolean moto_param_eval(MotoParam *self)
+static void set_arg(PyObject *args, Py_ssize_t i, PyObject *obj)
+{
+    if( ! obj)
+    {
+        Py_INCREF(Py_None);
+        obj = Py_None;
+    }
+    PyTuple_SetItem(args, i, obj);
+}
+
+/* Must be called with GIL held. */
+static gboolean param_eval_python(MotoParam *self)
 {
     MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
 
-    PyObject *result = NULL;
-    if(priv->expression_function)
+    if( ! priv->expression_function)
+        return FALSE;
+
+    /* Tuple is reused if function didn't keep reference to it. */
+    PyObject *args = priv->expression_args;
+    if( ! args || Py_REFCNT(args) > 1)
     {
-        PyObject *args = PyTuple_New(3);
-        PyTuple_SetItem(args, 0, PyString_FromString(moto_param_get_name(self)));
+        Py_XDECREF(args);
+        args = priv->expression_args = PyTuple_New(5);
+        set_arg(args, 0, PyString_FromString(moto_param_get_name(self)));
+    }
 
-        PyTuple_SetItem(args, 1, moto_PyObject_from_GValue( & priv->value));
+    set_arg(args, 1, moto_PyObject_from_GValue( & priv->value));
+    set_arg(args, 2, priv->source ? moto_PyObject_from_GValue(moto_param_get_value(priv->source)) : NULL);
 
-        if(priv->source)
-        {
-            PyTuple_SetItem(args, 2, moto_PyObject_from_GValue(moto_param_get_value(priv->source)));
-        }
-        else
-        {
-            Py_INCREF(Py_None);
-            PyTuple_SetItem(args, 2, Py_None);
-        }
+    /* Time is the same as for native expressions. */
+    MotoSceneNode *scene_node = priv->node ? moto_node_get_scene_node(priv->node) : NULL;
+    PyObject *time = PyFloat_FromDouble(scene_node ? moto_scene_node_get_current_time(scene_node) : 0);
+    Py_XINCREF(time);
+    set_arg(args, 3, time);
+    set_arg(args, 4, time);
 
-        result = PyObject_CallObject(priv->expression_function, args);
-    }
+    PyObject *result = PyObject_CallObject(priv->expression_function, args);
 
     gboolean status = FALSE;
     if(result)
@@ -2470,22 +3256,83 @@ gboolean moto_param_eval(MotoParam *self)
         status = moto_GValue_from_PyObject(moto_param_get_value(self), result);
         Py_DECREF(result);
     }
+    else
+    {
+        PyErr_Clear();
+    }
+
+    return status;
+}
+
+gboolean moto_param_eval(MotoParam *self)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+
+    if(priv->native_expression)
+        return param_eval_native(self);
+
+    if( ! priv->expression_function)
+        return FALSE;
+
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    gboolean status = param_eval_python(self);
+    PyGILState_Release(gstate);
 
     return status;
 }
 
+gboolean moto_param_needs_python(MotoParam *self)
+{
+    MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
+    return priv->use_expression && priv->expression_function;
+}
+
+void moto_param_eval_batch(GPtrArray *params)
+{
+    if( ! params->len)
+        return;
+
+    PyGILState_STATE gstate = PyGILState_Ensure();
+
+    guint i;
+    for(i = 0; i < params->len; i++)
+    {
+        MotoParam *param = (MotoParam *)g_ptr_array_index(params, i);
+        MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(param);
+
+        priv->batch_status = param_eval_python(param);
+        priv->batch_evaluated = TRUE;
+    }
+
+    PyGILState_Release(gstate);
+}
+
 static void moto_param_update(MotoParam *self)
 {
     MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
 
     gboolean use_source = TRUE;
 
-    if(priv->use_expression && moto_param_eval(self)) // Always update if expression is used
-        use_source = FALSE;
+    if(priv->use_expression) // Always update if expression is used
+    {
+        gboolean evaluated;
+        if(priv->batch_evaluated)
+        {
+            evaluated = priv->batch_status;
+            priv->batch_evaluated = FALSE;
+        }
+        else
+            evaluated = moto_param_eval(self);
+
+        if(evaluated)
+            use_source = FALSE;
+    }
 
     if(use_source && priv->source)
     {
         MotoParamPriv *src_priv = MOTO_PARAM_GET_PRIVATE(priv->source);
+        if(src_priv->lazy_func)
+            materialize_value(priv->source);
 
 
         GType dst_type = G_VALUE_TYPE(&priv->value);
@@ -2520,6 +3367,18 @@ void moto_param_notify_dests(MotoParam *self)
 {
     MotoParamPriv *priv = MOTO_PARAM_GET_PRIVATE(self);
 
+    /* Setters of values always notify so this is the place to track changes.
+     * Nodes also write their own params while updating, that isn't an edit. */
+    MotoNode *node = moto_param_get_node(self);
+    if( ! node || ! MOTO_NODE_GET_PRIVATE(node)->updating)
+    {
+        touch_param(self);
+
+        MotoNodeClass *klass = (node) ? MOTO_NODE_GET_CLASS(node) : NULL;
+        if(klass && klass->param_changed)
+            klass->param_changed(node, self);
+    }
+
     if( ! (priv->mode & MOTO_PARAM_MODE_OUT))
         return;
 
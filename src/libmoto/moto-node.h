@@ -33,6 +33,7 @@ typedef void (*MotoNodeActionFunc)(MotoNode *node);
 typedef void (*MotoNodeForeachParamFunc)(MotoNode *node, MotoParam *param, gpointer user_data);
 typedef void (*MotoNodeForeachGroupFunc)(MotoNode *node, const gchar *group, gpointer user_data);
 typedef void (*MotoNodeForeachParamInGroupFunc)(MotoNode *node, const gchar *group, MotoParam *param, gpointer user_data);
+typedef void (*MotoParamLazyFunc)(MotoParam *param, GValue *value, gpointer user_data);
 
 typedef enum
 {
@@ -59,6 +60,9 @@ struct _MotoNodeClass
 
     /* Virtual Table */
     MotoNodeUpdateMethod update;
+    /* Called when param is changed outside of update of node (by user or loading).
+     * Unlike update it's never called from pool threads, so it may affect other nodes. */
+    MotoNodeParamChangedMethod param_changed;
 
     /* Signals */
     guint source_changed_signal_id;
@@ -86,6 +90,8 @@ void moto_node_foreach_children(MotoNode *self, GFunc func, gpointer user_data);
 
 MotoNode *moto_node_get_parent(MotoNode *self);
 void moto_node_set_parent(MotoNode *self, MotoNode *parent);
+/* Moves child with all its subtree from its parent into self. */
+void moto_node_add_child(MotoNode *self, MotoNode *child);
 
 void moto_node_do_action(MotoNode *self, const gchar *action_name);
 /* TODO: Make as moto_node_class_set_action */
@@ -93,6 +99,8 @@ void moto_node_set_action(MotoNode *self, const gchar *action_name, MotoNodeActi
 
 const gchar *moto_node_get_name(MotoNode *self);
 void moto_node_set_name(MotoNode *self, const gchar *name);
+/* The same name as string which lives forever, for samples of profiler. */
+const gchar *moto_node_get_interned_name(MotoNode *self);
 const gchar *moto_node_get_full_name(MotoNode *self);
 const gchar *moto_node_get_type_name(MotoNode *self);
 
@@ -105,6 +113,16 @@ gboolean moto_node_is_valid(MotoNode *self);
 gboolean moto_node_is_independent(MotoNode *self);
 gboolean moto_node_is_ready_to_update(MotoNode *self);
 gboolean moto_node_needs_update(MotoNode *self);
+void moto_node_mark_for_update(MotoNode *self);
+/* Node is considered up to date without update, e.g. when outputs are restored from dump. */
+void moto_node_mark_as_updated(MotoNode *self);
+/* Params written while node is updating aren't edits (see moto_param_get_last_modified).
+ * Flag is set by moto_node_update, it's set explicitly only when results of node
+ * are computed outside of update. */
+void moto_node_set_updating(MotoNode *self, gboolean updating);
+
+/* Appends params which expressions need Python to evaluate. */
+void moto_node_collect_python_params(MotoNode *self, GPtrArray *params);
 
 void moto_node_define_param_group(MotoNode* self, const char* name);
 
@@ -219,6 +237,11 @@ void moto_node_restore_from_variation(MotoNode *self, MotoVariation *variation);
 const GTimeVal *moto_node_get_last_modified(MotoNode *self);
 void moto_node_update_last_modified(MotoNode *self);
 
+/* Time of last edit of node which isn't change of param (e.g. selection of op node).
+ * Edits of params are tracked by moto_param_get_last_modified. */
+const GTimeVal *moto_node_get_last_edited(MotoNode *self);
+void moto_node_touch(MotoNode *self);
+
 /* Get manipulator wth given name or NULL if not found. */
 MotoManipulator *moto_node_get_manipulator(MotoNode *self, const gchar *name);
 /* Get first manipulator in the list or NULL if node has no manipulators. */
@@ -231,8 +254,13 @@ void moto_node_set_tag(MotoNode *self, const gchar *tag);
 void moto_node_del_tag(MotoNode *self, const gchar *tag); 
 gboolean moto_node_has_tag(MotoNode *self, const gchar *tag);
 
-/* Get dump for saving. */
+/* Get dump of params for saving. Only values of inputs are saved, other
+ * params are there for ids. Valid until next call. */
 gconstpointer moto_node_get_dump(MotoNode *self, glong *numbytes);
+/* Restores params from dump. If ids isn't NULL each restored param is inserted
+ * into it with its saved id as the key, so links may be restored after. */
+gboolean moto_node_set_dump(MotoNode *self, gconstpointer dump, glong numbytes,
+        GHashTable *ids);
 
 /* Update node internals. This must not affect on other nodes. */
 void moto_node_update(MotoNode *self);
@@ -249,9 +277,20 @@ MotoLibrary *moto_node_get_library(MotoNode *self);
 gboolean moto_node_depends_on(MotoNode *self, MotoNode *other);
 
 /* Returns TRUE if node changes during animation or FALSE otherwise.
- * Used for optimization. */
+ * Used for optimization. Flag is cached when params are linked so the call is cheap. */
 gboolean moto_node_is_animated(MotoNode *self);
 
+/* TRUE if all outputs of node go to params with cut time dependency only
+ * (directly or through other such nodes). These nodes aren't updated when
+ * time is changed even if they are animated. */
+gboolean moto_node_is_time_cut(MotoNode *self);
+
+/* Node which outputs are changed by time itself (e.g. MotoTimeNode). */
+void moto_node_set_time_source(MotoNode *self, gboolean time_source);
+
+/* Changed each time when some node becomes animated or static. */
+guint moto_node_get_time_dependency_stamp(void);
+
 /* class MotoParam */
 
 struct _MotoParam
@@ -294,6 +333,8 @@ MotoParamMode moto_param_get_mode(MotoParam *self);
 MotoParamSpec *moto_param_get_spec(MotoParam *self);
 
 guint moto_param_get_id(MotoParam *self);
+/* Time of last change of value, link or expression made outside of update of node. */
+const GTimeVal *moto_param_get_last_modified(MotoParam *self);
 
 GType moto_param_get_value_type(MotoParam *self);
 
@@ -385,12 +426,25 @@ void moto_param_set_use_expression(MotoParam *self, gboolean use);
 gboolean moto_param_get_use_expression(MotoParam *self);
 
 gboolean moto_param_eval(MotoParam *self);
+gboolean moto_param_needs_python(MotoParam *self);
+
+/* Evaluates Python expressions of all params holding GIL only once.
+ * Results are used by next update of params instead of evaluating again. */
+void moto_param_eval_batch(GPtrArray *params);
 
+/* Expression may use value (v), source (s), name of param (p), current time of
+ * scene (t, time) and functions of math. Python is used only for expressions
+ * which can't be compiled natively, see moto_expression_new. */
 void moto_param_set_expression(MotoParam *self, const gchar *body);
 const gchar *moto_param_get_expression(MotoParam *self);
 
 GValue *moto_param_get_value(MotoParam *self);
 
+/* Func is called once on first access to value instead of loading it beforehand. */
+void moto_param_set_lazy_value(MotoParam *self, MotoParamLazyFunc func,
+        gpointer user_data, GDestroyNotify destroy);
+gboolean moto_param_has_lazy_value(MotoParam *self);
+
 /* Valid only if mode is IN or INOUT and does nothing else. */
 MotoParam *moto_param_get_source(MotoParam *self);
 void moto_param_link(MotoParam *self, MotoParam *src);
@@ -410,6 +464,10 @@ gboolean moto_param_is_valid(MotoParam *self);
 
 gboolean moto_param_is_animated(MotoParam *self);
 
+/* IN param with cut time dependency doesn't follow animation of its source,
+ * e.g. input of cache node while cached frames are played. */
+void moto_param_set_time_cut(MotoParam *self, gboolean cut);
+
 G_END_DECLS
 
 #endif /* __MOTO_NODE_H__ */
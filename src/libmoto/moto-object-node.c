@@ -26,6 +26,14 @@ void moto_object_node_set_scale(MotoObjectNode *self, gfloat x, gfloat y, gfloat
 
 static void moto_object_node_update(MotoNode *self);
 
+static void moto_object_node_calc_bound_DEFAULT(MotoObjectNode *self, MotoBound *bound);
+static void moto_object_node_draw_shape_DEFAULT(MotoObjectNode *self, MotoShapeNode *shape);
+static gboolean moto_object_node_intersect_DEFAULT(MotoObjectNode *self, MotoRay *ray,
+    gfloat extent, gfloat *dist);
+static gboolean moto_object_node_button_press_DEFAULT(MotoObjectNode *self,
+    gint x, gint y, gint width, gint height, MotoRay *ray,
+    MotoTransformInfo *tinfo);
+
 // static void moto_object_node_convert_camera_transform(MotoObjectNode *self);
 
 /* enums */
@@ -194,6 +202,11 @@ moto_object_node_class_init(MotoObjectNodeClass *klass)
 
     nclass->update = moto_object_node_update;
 
+    klass->calc_bound   = moto_object_node_calc_bound_DEFAULT;
+    klass->draw_shape   = moto_object_node_draw_shape_DEFAULT;
+    klass->intersect    = moto_object_node_intersect_DEFAULT;
+    klass->button_press = moto_object_node_button_press_DEFAULT;
+
     goclass->dispose = moto_object_node_dispose;
     goclass->finalize = moto_object_node_finalize;
 }
@@ -412,25 +425,30 @@ static void update_global_bound(MotoObjectNode *self)
     // self->priv->global_bound_calculated = TRUE;
 }
 
-static void update_local_bound(MotoObjectNode *self)
+static void moto_object_node_calc_bound_DEFAULT(MotoObjectNode *self, MotoBound *bound)
 {
     MotoShapeNode* shape_node = \
         moto_object_node_get_shape(self);
     if(!shape_node)
     {
-        moto_bound_set(self->priv->local_bound, 0, 0, 0, 0, 0, 0);
+        moto_bound_set(bound, 0, 0, 0, 0, 0, 0);
         return;
     }
 
     MotoShape* shape = moto_shape_node_get_shape(shape_node);
     if(!shape || !MOTO_IS_MESH(shape))
     {
-        moto_bound_set(self->priv->local_bound, 0, 0, 0, 0, 0, 0);
+        moto_bound_set(bound, 0, 0, 0, 0, 0, 0);
         return;
     }
 
     MotoMesh* mesh = (MotoMesh*)shape;
-    moto_mesh_calc_bound(mesh, self->priv->local_bound);
+    moto_mesh_calc_bound(mesh, bound);
+}
+
+static void update_local_bound(MotoObjectNode *self)
+{
+    MOTO_OBJECT_NODE_GET_CLASS(self)->calc_bound(self, self->priv->local_bound);
 
     self->priv->local_bound_calculated = TRUE;
 }
@@ -655,6 +673,63 @@ MotoDrawMode moto_object_node_get_draw_mode(MotoObjectNode* self)
     return moto_scene_node_get_draw_mode(scene);
 }
 
+/* How many pixels one unit of shape space takes on screen.
+ * Current modelview matrix must already contain transform of object. */
+static gfloat calc_pixels_per_unit(MotoShapeNode *shape)
+{
+    MotoBound *b = moto_shape_node_get_bound(shape);
+    if( ! b)
+        return G_MAXFLOAT;
+
+    GLdouble model[16], proj[16];
+    GLint view[4];
+    glGetDoublev(GL_MODELVIEW_MATRIX, model);
+    glGetDoublev(GL_PROJECTION_MATRIX, proj);
+    glGetIntegerv(GL_VIEWPORT, view);
+
+    GLdouble lo[2] = {G_MAXDOUBLE, G_MAXDOUBLE}, hi[2] = {-G_MAXDOUBLE, -G_MAXDOUBLE};
+    gint i;
+    for(i = 0; i < 8; i++)
+    {
+        GLdouble wx, wy, wz;
+        gluProject(b->bound[(i&1)], b->bound[2 + ((i>>1)&1)], b->bound[4 + ((i>>2)&1)],
+            model, proj, view, & wx, & wy, & wz);
+
+        /* Bound crosses near or far plane, size on screen is unknown. */
+        if(wz < 0 || wz > 1)
+            return G_MAXFLOAT;
+
+        lo[0] = min(lo[0], wx); hi[0] = max(hi[0], wx);
+        lo[1] = min(lo[1], wy); hi[1] = max(hi[1], wy);
+    }
+
+    gfloat dx = b->bound[1] - b->bound[0];
+    gfloat dy = b->bound[3] - b->bound[2];
+    gfloat dz = b->bound[5] - b->bound[4];
+    gfloat diag = sqrt(dx*dx + dy*dy + dz*dz);
+    if(diag < MICRO)
+        return G_MAXFLOAT;
+
+    return max(hi[0] - lo[0], hi[1] - lo[1]) / diag;
+}
+
+static void moto_object_node_draw_shape_DEFAULT(MotoObjectNode *self, MotoShapeNode *shape)
+{
+    MotoSelectionMode selection_mode = moto_object_node_get_selection_mode(self);
+    if(MOTO_SELECTION_MODE_OBJECT == selection_mode &&
+       moto_shape_node_draw_lod(shape, moto_object_node_get_draw_mode(self),
+            calc_pixels_per_unit(shape)))
+    {
+        /* Simplified level is drawn. */
+        return;
+    }
+
+    moto_shape_node_draw(shape,
+        moto_object_node_get_draw_mode(self),
+        moto_object_node_get_selection(self),
+        selection_mode);
+}
+
 void moto_object_node_draw(MotoObjectNode *self)
 {
     gboolean visible;
@@ -675,12 +750,7 @@ void moto_object_node_draw(MotoObjectNode *self)
 
     MotoShapeNode* shape = moto_object_node_get_shape(self);
     if(shape)
-    {
-        moto_shape_node_draw(shape,
-            moto_object_node_get_draw_mode(self),
-            moto_object_node_get_selection(self),
-            moto_object_node_get_selection_mode(self));
-    }
+        MOTO_OBJECT_NODE_GET_CLASS(self)->draw_shape(self, shape);
 
     glPopMatrix();
 
@@ -1223,9 +1293,33 @@ static void moto_object_node_update(MotoNode *self)
     }
 }
 
+gboolean moto_object_node_intersect(MotoObjectNode *self, MotoRay *ray,
+    gfloat extent, gfloat *dist)
+{
+    return MOTO_OBJECT_NODE_GET_CLASS(self)->intersect(self, ray, extent, dist);
+}
+
+static gboolean moto_object_node_intersect_DEFAULT(MotoObjectNode *self, MotoRay *ray,
+    gfloat extent, gfloat *dist)
+{
+    MotoBound *b = moto_object_node_get_bound(self, FALSE);
+    MotoBound bb;
+    moto_bound_set_extended(& bb, b, extent);
+
+    return moto_ray_intersect_bound_dist(ray, dist, bb.bound);
+}
+
 gboolean moto_object_node_button_press(MotoObjectNode *self,
     gint x, gint y, gint width, gint height, MotoRay *ray,
     MotoTransformInfo *tinfo)
+{
+    return MOTO_OBJECT_NODE_GET_CLASS(self)->button_press(self,
+            x, y, width, height, ray, tinfo);
+}
+
+static gboolean moto_object_node_button_press_DEFAULT(MotoObjectNode *self,
+    gint x, gint y, gint width, gint height, MotoRay *ray,
+    MotoTransformInfo *tinfo)
 {
     MotoShapeNode* shape_node = \
         moto_object_node_get_shape(self);
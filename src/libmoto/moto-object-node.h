@@ -36,6 +36,13 @@ G_BEGIN_DECLS
 typedef struct _MotoObjectNodePriv MotoObjectNodePriv;
 
 typedef const MotoBound *(*MotoObjectNodeGetBoundMethod)(MotoObjectNode *self);
+typedef void (*MotoObjectNodeCalcBoundMethod)(MotoObjectNode *self, MotoBound *bound);
+typedef void (*MotoObjectNodeDrawShapeMethod)(MotoObjectNode *self, MotoShapeNode *shape);
+typedef gboolean (*MotoObjectNodeIntersectMethod)(MotoObjectNode *self, MotoRay *ray,
+    gfloat extent, gfloat *dist);
+typedef gboolean (*MotoObjectNodeButtonPressMethod)(MotoObjectNode *self,
+    gint x, gint y, gint width, gint height, MotoRay *ray,
+    MotoTransformInfo *tinfo);
 
 typedef enum
 {
@@ -76,6 +83,12 @@ struct _MotoObjectNodeClass
 {
     MotoNodeClass parent;
 
+    /* All in local space of object. */
+    MotoObjectNodeCalcBoundMethod calc_bound;
+    MotoObjectNodeDrawShapeMethod draw_shape;
+    MotoObjectNodeIntersectMethod intersect;
+    MotoObjectNodeButtonPressMethod button_press;
+
     /* signals */
     guint button_press_signal_id;
     guint button_release_signal_id;
@@ -124,9 +137,17 @@ void moto_object_node_set_rotate_order(MotoObjectNode *self, MotoRotateOrder ord
 
 void moto_object_node_set_translate(MotoObjectNode *self, gfloat x, gfloat y, gfloat z);
 
+/* Parent whose transform is applied on top of own one. */
+MotoObjectNode *moto_object_node_get_parent(MotoObjectNode *self);
+void moto_object_node_set_parent(MotoObjectNode *self, MotoObjectNode *parent);
+
 gfloat *moto_object_node_get_matrix(MotoObjectNode *self, gboolean global);
 gfloat *moto_object_node_get_inverse_matrix(MotoObjectNode *self, gboolean global);
 
+/* Ray is in local space of object. */
+gboolean moto_object_node_intersect(MotoObjectNode *self, MotoRay *ray,
+    gfloat extent, gfloat *dist);
+
 gboolean moto_object_node_button_press(MotoObjectNode *self,
     gint x, gint y, gint width, gint height, MotoRay *ray,
     MotoTransformInfo *tinfo);
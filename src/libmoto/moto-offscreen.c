@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "libmotoutil/moto-gl.h"
+
+#ifdef MOTO_WITH_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+#include "moto-messager.h"
+#include "moto-profiler.h"
+#include "moto-offscreen.h"
+
+struct _MotoOffscreen
+{
+    gint width, height;
+    guint8 *pixels;
+
+#ifdef MOTO_WITH_OSMESA
+    OSMesaContext context;
+#endif
+};
+
+MotoOffscreen *moto_offscreen_new(gint width, gint height)
+{
+#ifdef MOTO_WITH_OSMESA
+    if(width <= 0 || height <= 0)
+    {
+        moto_error("Wrong size of offscreen buffer: %dx%d", width, height);
+        return NULL;
+    }
+
+    MotoOffscreen *self = g_slice_new(MotoOffscreen);
+    self->width  = width;
+    self->height = height;
+    self->pixels = g_try_malloc(width*height*4);
+    if( ! self->pixels)
+    {
+        moto_error("Not enough memory for offscreen buffer %dx%d", width, height);
+        g_slice_free(MotoOffscreen, self);
+        return NULL;
+    }
+
+    self->context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 8, 0, NULL);
+    if( ! self->context)
+    {
+        moto_error("Can't create OSMesa context");
+        g_free(self->pixels);
+        g_slice_free(MotoOffscreen, self);
+        return NULL;
+    }
+
+    if( ! OSMesaMakeCurrent(self->context, self->pixels, GL_UNSIGNED_BYTE, width, height))
+    {
+        moto_error("Can't make OSMesa context current");
+        moto_offscreen_free(self);
+        return NULL;
+    }
+
+    /* Rows of buffer go from top as in image files. */
+    OSMesaPixelStore(OSMESA_Y_UP, 0);
+
+    moto_gl_init();
+
+    return self;
+#else
+    moto_error("Moto is built without offscreen rendering (MOTO_WITH_OSMESA)");
+    return NULL;
+#endif
+}
+
+void moto_offscreen_free(MotoOffscreen *self)
+{
+#ifdef MOTO_WITH_OSMESA
+    if(self->context)
+        OSMesaDestroyContext(self->context);
+#endif
+    g_free(self->pixels);
+    g_slice_free(MotoOffscreen, self);
+}
+
+gint moto_offscreen_get_width(MotoOffscreen *self)
+{
+    return self->width;
+}
+
+gint moto_offscreen_get_height(MotoOffscreen *self)
+{
+    return self->height;
+}
+
+const guint8 *moto_offscreen_get_pixels(MotoOffscreen *self)
+{
+    return self->pixels;
+}
+
+/* Returns time of building of render buffers, it's measured by profiler
+ * inside of draw, so scene is drawn only once per frame. */
+static gdouble draw(MotoOffscreen *self, MotoSceneNode *scene)
+{
+    guint frame = moto_profiler_get_frame();
+    gboolean enabled = moto_profiler_is_enabled();
+    moto_profiler_enable(TRUE);
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    moto_scene_node_draw(scene, self->width, self->height);
+    glFinish();
+
+    moto_profiler_enable(enabled);
+
+    guint64 build = 0;
+    GArray *samples = moto_profiler_get_samples(frame);
+    guint i;
+    for(i = 0; i < samples->len; i++)
+    {
+        MotoProfileSample *s = & g_array_index(samples, MotoProfileSample, i);
+        if(MOTO_PROFILE_BUILD == s->category)
+            build += s->end - s->begin;
+    }
+    g_array_free(samples, TRUE);
+
+    return (gdouble)build/G_USEC_PER_SEC;
+}
+
+gboolean moto_offscreen_render_frame(MotoOffscreen *self, MotoSceneNode *scene,
+        gfloat time, MotoOffscreenTiming *timing)
+{
+#ifdef MOTO_WITH_OSMESA
+    if( ! OSMesaMakeCurrent(self->context, self->pixels, GL_UNSIGNED_BYTE, self->width, self->height))
+    {
+        moto_error("Can't make OSMesa context current");
+        return FALSE;
+    }
+#endif
+
+    GTimer *timer = g_timer_new();
+
+    moto_scene_node_set_current_time(scene, time);
+    moto_scene_node_update(scene);
+    gdouble update = g_timer_elapsed(timer, NULL);
+
+    /* Second pass would make animated shapes look stable for LOD. */
+    g_timer_start(timer);
+    gdouble build = draw(self, scene);
+    gdouble total = g_timer_elapsed(timer, NULL);
+
+    g_timer_destroy(timer);
+
+    if(timing)
+    {
+        timing->time   = time;
+        timing->update = update;
+        timing->build  = build;
+        timing->draw   = MAX(total - build, 0);
+    }
+
+    return GL_NO_ERROR == glGetError();
+}
+
+gboolean moto_offscreen_write_ppm(MotoOffscreen *self, const gchar *filename)
+{
+    FILE *file = fopen(filename, "wb");
+    if( ! file)
+    {
+        moto_error("Can't open file \"%s\" for writing", filename);
+        return FALSE;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", self->width, self->height);
+
+    guint8 *row = g_malloc(self->width*3);
+    gboolean ok = TRUE;
+    gint x, y;
+    for(y = 0; y < self->height && ok; y++)
+    {
+        const guint8 *p = self->pixels + y*self->width*4;
+        for(x = 0; x < self->width; x++, p += 4)
+        {
+            row[x*3]     = p[0];
+            row[x*3 + 1] = p[1];
+            row[x*3 + 2] = p[2];
+        }
+        ok = (fwrite(row, 3, self->width, file) == (gsize)self->width);
+    }
+    g_free(row);
+
+    if(fclose(file) || ! ok)
+    {
+        moto_error("Can't write file \"%s\"", filename);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+guint moto_offscreen_render_range(MotoOffscreen *self, MotoSceneNode *scene,
+        gfloat start, gfloat end, gfloat step,
+        const gchar *pattern, const gchar *report)
+{
+    if(step <= 0)
+    {
+        moto_error("Step of frame range must be positive (%f)", step);
+        return 0;
+    }
+
+    FILE *rep = NULL;
+    if(report)
+    {
+        rep = fopen(report, "w");
+        if( ! rep)
+            moto_warning("Can't open report file \"%s\", timings won't be written", report);
+        else
+            fprintf(rep, "frame,time,update,build,draw\n");
+    }
+
+    MotoOffscreenTiming total = {0, 0, 0, 0};
+    guint frames = 0;
+
+    /* Time is computed from frame number so error of step isn't accumulated. */
+    gfloat time;
+    for(time = start; time <= end + step*0.001; time = start + frames*step)
+    {
+        MotoOffscreenTiming t = {time, 0, 0, 0};
+        if( ! moto_offscreen_render_frame(self, scene, time, & t))
+            moto_warning("GL error while rendering frame at time %f", time);
+        frames++;
+
+        total.update += t.update;
+        total.build  += t.build;
+        total.draw   += t.draw;
+
+        if(pattern)
+        {
+            gchar *filename = g_strdup_printf(pattern, frames);
+            moto_offscreen_write_ppm(self, filename);
+            g_free(filename);
+        }
+
+        if(rep)
+            fprintf(rep, "%u,%f,%f,%f,%f\n", frames, t.time, t.update, t.build, t.draw);
+    }
+
+    if(rep)
+        fclose(rep);
+
+    if(frames)
+        moto_info("Rendered %u frames %dx%d: update %.3f ms, build %.3f ms, draw %.3f ms per frame",
+            frames, self->width, self->height,
+            total.update*1000/frames, total.build*1000/frames, total.draw*1000/frames);
+
+    return frames;
+}
@@ -0,0 +1,75 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_OFFSCREEN_H__
+#define __MOTO_OFFSCREEN_H__
+
+#include <glib.h>
+
+#include "moto-scene-node.h"
+
+G_BEGIN_DECLS
+
+/* Headless viewport. Scene is drawn into in-memory RGBA buffer through
+ * software GL context, so playblasts and viewport benchmarks run without
+ * display and GPU. Requires build with MOTO_WITH_OSMESA. */
+
+typedef struct _MotoOffscreen MotoOffscreen;
+typedef struct _MotoOffscreenTiming MotoOffscreenTiming;
+
+/* Seconds spent for one frame. */
+struct _MotoOffscreenTiming
+{
+    gfloat time;
+    gdouble update; /* Evaluation of graph for time. */
+    gdouble build;  /* Creation and update of render buffers. */
+    gdouble draw;   /* Drawing from ready buffers. */
+};
+
+/* Returns NULL if context can't be created. */
+MotoOffscreen *moto_offscreen_new(gint width, gint height);
+void moto_offscreen_free(MotoOffscreen *self);
+
+gint moto_offscreen_get_width(MotoOffscreen *self);
+gint moto_offscreen_get_height(MotoOffscreen *self);
+
+/* Rows go from top to bottom, 4 bytes per pixel. */
+const guint8 *moto_offscreen_get_pixels(MotoOffscreen *self);
+
+/* Sets time of scene, updates and draws it. Timing may be NULL. */
+gboolean moto_offscreen_render_frame(MotoOffscreen *self, MotoSceneNode *scene,
+        gfloat time, MotoOffscreenTiming *timing);
+
+/* Writes last rendered frame as binary PPM. */
+gboolean moto_offscreen_write_ppm(MotoOffscreen *self, const gchar *filename);
+
+/* Renders frames from start to end (inclusive) with step.
+ * If pattern isn't NULL each frame is written to file named by printf-like
+ * pattern with number of frame counted from 1 (e.g. "blast.%04d.ppm").
+ * If report isn't NULL timings of frames are written there as CSV.
+ * Returns number of rendered frames. */
+guint moto_offscreen_render_range(MotoOffscreen *self, MotoSceneNode *scene,
+        gfloat start, gfloat end, gfloat step,
+        const gchar *pattern, const gchar *report);
+
+G_END_DECLS
+
+#endif /* __MOTO_OFFSCREEN_H__ */
@@ -3,7 +3,11 @@
 #include "moto-enums.h"
 #include "moto-param-spec.h"
 #include "moto-shape.h"
+#include "moto-mesh.h"
+#include "moto-shape-cache.h"
+#include "moto-scene-node.h"
 #include "moto-op-node.h"
+#include "moto-profiler.h"
 
 /* forwards */
 
@@ -67,6 +71,7 @@ moto_op_node_class_init(MotoOpNodeClass *klass)
     goclass->finalize   = moto_op_node_finalize;
 
     klass->perform   = NULL;
+    klass->cache_output = FALSE;
 
     nclass->update = moto_op_node_update;
 
@@ -96,6 +101,8 @@ void moto_op_node_set_selection(MotoOpNode *self,
         moto_shape_selection_free(priv->selection);
 
     priv->selection = moto_shape_selection_copy(selection);
+
+    moto_node_touch((MotoNode *)self);
 }
 
 MotoShapeSelection *moto_op_node_get_selection(MotoOpNode *self)
@@ -135,10 +142,38 @@ static void moto_op_node_update(MotoNode *self)
     moto_node_get_param_boolean(self, "active", &active);
     if(active)
     {
-        geom = moto_op_node_perform((MotoOpNode*)self, in, &the_same);
+        MotoSceneNode *scene = moto_node_get_scene_node(self);
+        MotoShapeCache *cache = NULL;
+        gchar *key = NULL;
+        if(MOTO_OP_NODE_GET_CLASS(self)->cache_output && scene)
+        {
+            cache = moto_scene_node_get_shape_cache(scene);
+            key = moto_op_node_get_cache_key((MotoOpNode *)self, in);
+        }
+
+        /* Cached shape has new reference as a new one from perform. */
+        MotoShape *cached = (key) ? moto_shape_cache_lookup(cache, key) : NULL;
+        if(cached)
+            geom = cached;
+        else
+        {
+            /* Operations edit verts, so packed mesh is expanded once here. */
+            if(MOTO_IS_MESH(in))
+                moto_mesh_unpack((MotoMesh *)in);
+            geom = moto_op_node_perform((MotoOpNode*)self, in, &the_same);
+            if(key && geom && geom != in && ! the_same)
+                moto_shape_cache_insert(cache, key, geom);
+        }
+        g_free(key);
+
         if(!the_same && old_geom && (old_geom != in))
             g_object_unref(old_geom);
     }
+    else if(old_geom && old_geom != in)
+    {
+        /* Result of perform isn't kept while node is inactive. */
+        g_object_unref(old_geom);
+    }
 
     moto_node_set_param_object(self, "out", (GObject *)geom);
 
@@ -151,8 +186,55 @@ MotoShape *moto_op_node_perform(MotoOpNode *self, MotoShape *in, gboolean *the_s
 {
     MotoOpNodeClass *klass = MOTO_OP_NODE_GET_CLASS(self);
 
-    if(klass->perform)
-        return klass->perform(self, in, the_same);
+    if( ! klass->perform)
+        return NULL;
+
+    MOTO_PROFILE_BEGIN(scope);
+    MotoShape *out = klass->perform(self, in, the_same);
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_PERFORM, moto_node_get_interned_name((MotoNode *)self), self);
+
+    return out;
+}
+
+/* FNV-1a */
+static guint64 hash_bytes(guint64 h, gconstpointer data, gsize size)
+{
+    const guint8 *p = (const guint8 *)data;
+    const guint8 *end = p + size;
+    for(; p < end; p++)
+        h = (h ^ *p) * G_GUINT64_CONSTANT(1099511628211);
+    return h;
+}
+
+static guint64 hash_bitmask(guint64 h, MotoBitmask *mask)
+{
+    if( ! mask)
+        return h;
+    h = hash_bytes(h, & mask->bits_num, sizeof(mask->bits_num));
+    return hash_bytes(h, mask->bits, (mask->bits_num + 31)/32*sizeof(guint32));
+}
+
+gchar *moto_op_node_get_cache_key(MotoOpNode *self, MotoShape *in)
+{
+    MotoNode *node = (MotoNode *)self;
+    MotoShapeSelection *selection = moto_op_node_get_selection(self);
+    guint64 h = G_GUINT64_CONSTANT(14695981039346656037);
+
+    /* Values of all inputs with expressions. Dump also has ids of params,
+     * so keys of different nodes never match. */
+    glong size;
+    gconstpointer dump = moto_node_get_dump(node, & size);
+    h = hash_bytes(h, dump, size);
+
+    guint stamp = (in) ? moto_shape_get_stamp(in) : 0;
+    h = hash_bytes(h, & stamp, sizeof(stamp));
+
+    if(selection)
+    {
+        h = hash_bitmask(h, selection->verts);
+        h = hash_bitmask(h, selection->edges);
+        h = hash_bitmask(h, selection->faces);
+    }
 
-    return NULL;
+    return g_strdup_printf("%s-%" G_GINT64_MODIFIER "x", moto_node_get_type_name(node), h);
 }
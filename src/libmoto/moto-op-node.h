@@ -45,6 +45,9 @@ struct _MotoOpNodeClass
     MotoShapeNodeClass parent;
 
     MotoOpPerformMethod perform;
+    /* Results are kept in shape cache of scene. Only for ops which make
+     * a new shape each time and don't change it in place after. */
+    gboolean cache_output;
 };
 
 GType moto_op_node_get_type(void);
@@ -62,6 +65,9 @@ MotoShapeSelection *moto_op_node_get_selection(MotoOpNode *self);
 
 MotoShape *moto_op_node_perform(MotoOpNode *self, MotoShape *in, gboolean *the_same);
 
+/* Hash of input shape, values of params and selection. Must be freed. */
+gchar *moto_op_node_get_cache_key(MotoOpNode *self, MotoShape *in);
+
 G_END_DECLS
 
 #endif /* __MOTO_OP_NODE_H__ */
@@ -0,0 +1,89 @@
+#include "moto-parallel.h"
+
+typedef struct _MotoParallelBatch
+{
+    GMutex *mutex;
+    GCond *cond;
+    guint pending;
+} MotoParallelBatch;
+
+typedef struct _MotoParallelRange
+{
+    MotoParallelFunc func;
+    gpointer data;
+    guint chunk, begin, end;
+    MotoParallelBatch *batch;
+} MotoParallelRange;
+
+static GThreadPool *parallel_pool = NULL;
+G_LOCK_DEFINE_STATIC(parallel_pool);
+
+static void run_range(gpointer data, gpointer user_data)
+{
+    MotoParallelRange *range = (MotoParallelRange *)data;
+    range->func(range->data, range->chunk, range->begin, range->end);
+
+    MotoParallelBatch *batch = range->batch;
+    g_mutex_lock(batch->mutex);
+    if(0 == --batch->pending)
+        g_cond_signal(batch->cond);
+    g_mutex_unlock(batch->mutex);
+}
+
+static GThreadPool *get_pool(void)
+{
+    G_LOCK(parallel_pool);
+    if( ! parallel_pool && g_thread_supported())
+        parallel_pool = g_thread_pool_new(run_range, NULL, MOTO_PARALLEL_THREADS, FALSE, NULL);
+    G_UNLOCK(parallel_pool);
+
+    return parallel_pool;
+}
+
+guint moto_parallel_get_chunks_num(guint num, guint min_num)
+{
+    return (num < MAX(min_num, 2)) ? 1 : MIN(num, MOTO_PARALLEL_MAX_CHUNKS);
+}
+
+void moto_parallel_for(MotoParallelFunc func, gpointer data, guint num, guint min_num)
+{
+    guint chunks = moto_parallel_get_chunks_num(num, min_num);
+    GThreadPool *pool = (chunks > 1) ? get_pool() : NULL;
+
+    MotoParallelRange ranges[MOTO_PARALLEL_MAX_CHUNKS];
+    MotoParallelBatch batch;
+    batch.pending = chunks - 1;
+    if(pool)
+    {
+        batch.mutex = g_mutex_new();
+        batch.cond  = g_cond_new();
+    }
+
+    guint i;
+    for(i = 0; i < chunks; i++)
+    {
+        MotoParallelRange *range = ranges + i;
+        range->func  = func;
+        range->data  = data;
+        range->chunk = i;
+        range->begin = (guint)((guint64)num*i/chunks);
+        range->end   = (guint)((guint64)num*(i + 1)/chunks);
+        range->batch = & batch;
+
+        if(pool && i < chunks - 1)
+            g_thread_pool_push(pool, range, NULL);
+        else
+            func(data, i, range->begin, range->end);
+    }
+
+    if(pool)
+    {
+        g_mutex_lock(batch.mutex);
+        while(batch.pending > 0)
+            g_cond_wait(batch.cond, batch.mutex);
+        g_mutex_unlock(batch.mutex);
+
+        g_mutex_free(batch.mutex);
+        g_cond_free(batch.cond);
+    }
+}
@@ -0,0 +1,47 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_PARALLEL_H__
+#define __MOTO_PARALLEL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Work on ranges of arrays split between threads of shared pool. */
+
+#define MOTO_PARALLEL_THREADS 4
+#define MOTO_PARALLEL_MAX_CHUNKS (MOTO_PARALLEL_THREADS*4)
+
+typedef void (*MotoParallelFunc)(gpointer data, guint chunk, guint begin, guint end);
+
+/* Range is split only when it has at least min_num items. */
+guint moto_parallel_get_chunks_num(guint num, guint min_num);
+
+/* Calls func for consecutive chunks of [0, num) and waits for all of them.
+ * Chunk index is less than moto_parallel_get_chunks_num(num, min_num).
+ * Calling thread does the last chunk itself. Pool is separate from one of scene,
+ * so it may be used from updates of nodes. */
+void moto_parallel_for(MotoParallelFunc func, gpointer data, guint num, guint min_num);
+
+G_END_DECLS
+
+#endif /* __MOTO_PARALLEL_H__ */
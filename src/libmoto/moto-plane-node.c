@@ -1,6 +1,7 @@
 #include "libmotoutil/numdef.h"
 #include "moto-types.h"
 #include "moto-param-spec.h"
+#include "moto-parallel.h"
 #include "moto-plane-node.h"
 #include "moto-mesh.h"
 
@@ -40,6 +41,10 @@ struct _MotoPlaneNodePriv
     gboolean disposed;
 
     MotoMesh *mesh;
+    /* Topology of mesh. While it's the same only coords are rewritten. */
+    gint div_x, div_y;
+    MotoOrientation orientation;
+    gint signs;
 
     MotoBound *bound;
     gboolean bound_calculated;
@@ -74,6 +79,9 @@ moto_plane_node_init(MotoPlaneNode *self)
     priv->disposed = FALSE;
 
     priv->mesh = NULL;
+    priv->div_x = priv->div_y = 0;
+    priv->orientation = MOTO_ORIENTATION_ZX;
+    priv->signs = 0;
 
     gfloat size[2] = {10, 10};
     gint divs[2] = {10, 10};
@@ -127,6 +135,32 @@ MotoPlaneNode *moto_plane_node_new(const gchar *name)
     return self;
 }
 
+/* Coords are calculated in parallel when plane is dense enough. */
+#define PARALLEL_MIN_VERTS 4096
+
+typedef struct _PlaneCoords
+{
+    MotoMesh *mesh;
+    gint div_y;
+    guint axes[3]; /* Axes of mesh for x and y of plane and its normal. */
+    gfloat x0, y0;
+    gfloat step_x, step_y;
+} PlaneCoords;
+
+static void plane_coords_range(gpointer data, guint chunk, guint begin, guint end)
+{
+    PlaneCoords *pc = (PlaneCoords *)data;
+
+    guint vi;
+    for(vi = begin; vi < end; vi++)
+    {
+        gfloat *p = (gfloat *)(pc->mesh->v_coords + vi);
+        p[pc->axes[0]] = pc->x0 + pc->step_x * (vi / (pc->div_y+1));
+        p[pc->axes[1]] = pc->y0 + pc->step_y * (vi % (pc->div_y+1));
+        p[pc->axes[2]] = 0;
+    }
+}
+
 #define e_x_num (div_x*(div_y+1))
 #define e_y_num (div_y*(div_x+1))
 
@@ -160,24 +194,44 @@ static void moto_plane_node_update_mesh(MotoPlaneNode *self)
     guint e_num = div_x*(div_y+1) + (div_x+1)*div_y;
     guint f_num = div_x*div_y;
 
-    gboolean new_mesh = FALSE;
-    if(priv->mesh)
+    gint signs = ((size_x > 0) - (size_x < 0) + 1) | (((size_y > 0) - (size_y < 0) + 1) << 2);
+
+    gboolean new_mesh = ( ! priv->mesh) || div_x != priv->div_x || div_y != priv->div_y ||
+                        orientation != priv->orientation || signs != priv->signs;
+    if(new_mesh)
     {
-        if(v_num != priv->mesh->v_num || e_num != priv->mesh->e_num || f_num != priv->mesh->f_num)
-        {
+        if(priv->mesh)
             g_object_unref(priv->mesh);
-            priv->mesh = moto_mesh_new(v_num, e_num, f_num, f_num*4);
-            new_mesh = TRUE;
-        }
-    }
-    else
-    {
         priv->mesh = moto_mesh_new(v_num, e_num, f_num, f_num*4);
-        new_mesh = TRUE;
+        priv->div_x = div_x;
+        priv->div_y = div_y;
+        priv->orientation = orientation;
+        priv->signs = signs;
     }
 
     MotoMesh *mesh = priv->mesh;
 
+    PlaneCoords pc;
+    pc.mesh = mesh;
+    pc.div_y = div_y;
+    pc.x0 = -hsx;
+    pc.y0 = -hsy;
+    pc.step_x = size_x/div_x;
+    pc.step_y = size_y/div_y;
+    switch(orientation)
+    {
+        case MOTO_ORIENTATION_YZ:
+            pc.axes[0] = 1; pc.axes[1] = 2; pc.axes[2] = 0;
+        break;
+        case MOTO_ORIENTATION_XY:
+            pc.axes[0] = 0; pc.axes[1] = 1; pc.axes[2] = 2;
+        break;
+        default:
+            pc.axes[0] = 0; pc.axes[1] = 2; pc.axes[2] = 1;
+        break;
+    }
+    moto_parallel_for(plane_coords_range, & pc, v_num, PARALLEL_MIN_VERTS);
+
     if(mesh->b32)
     {
         MotoMeshFace32 *f_data  = (MotoMeshFace32 *)mesh->f_data;
@@ -190,41 +244,7 @@ static void moto_plane_node_update_mesh(MotoPlaneNode *self)
             n += 4;
         }
 
-        guint32 vi = 0, fi = 0;
-        if(MOTO_ORIENTATION_YZ == orientation)
-        {
-            for(i = 0; i < div_x+1; i++)
-                for(j = 0; j < div_y+1; j++)
-                {
-                    mesh->v_coords[vi].x = 0;
-                    mesh->v_coords[vi].y = -hsx + size_x/div_x * i;
-                    mesh->v_coords[vi].z = -hsy + size_y/div_y * j;
-                    vi++;
-                }
-        }
-        else if(MOTO_ORIENTATION_ZX == orientation)
-        {
-            for(i = 0; i < div_x+1; i++)
-                for(j = 0; j < div_y+1; j++)
-                {
-                    mesh->v_coords[vi].x = -hsx + size_x/div_x * i;
-                    mesh->v_coords[vi].y = 0;
-                    mesh->v_coords[vi].z = -hsy + size_y/div_y * j;
-                    vi++;
-                }
-        }
-        else if(MOTO_ORIENTATION_XY == orientation)
-        {
-            for(i = 0; i < div_x+1; i++)
-                for(j = 0; j < div_y+1; j++)
-                {
-                    mesh->v_coords[vi].x = -hsx + size_x/div_x * i;
-                    mesh->v_coords[vi].y = -hsy + size_y/div_y * j;
-                    mesh->v_coords[vi].z = 0;
-                    vi++;
-                }
-        }
-
+        guint32 fi = 0;
         if(new_mesh)
         {
             for(i = 0; i < div_x; i++)
@@ -255,41 +275,7 @@ static void moto_plane_node_update_mesh(MotoPlaneNode *self)
             n += 4;
         }
 
-        guint16 vi = 0, fi = 0;
-        if(MOTO_ORIENTATION_YZ == orientation)
-        {
-            for(i = 0; i < div_x+1; i++)
-                for(j = 0; j < div_y+1; j++)
-                {
-                    mesh->v_coords[vi].x = 0;
-                    mesh->v_coords[vi].y = -hsx + size_x/div_x * i;
-                    mesh->v_coords[vi].z = -hsy + size_y/div_y * j;
-                    vi++;
-                }
-        }
-        else if(MOTO_ORIENTATION_ZX == orientation)
-        {
-            for(i = 0; i < div_x+1; i++)
-                for(j = 0; j < div_y+1; j++)
-                {
-                    mesh->v_coords[vi].x = -hsx + size_x/div_x * i;
-                    mesh->v_coords[vi].y = 0;
-                    mesh->v_coords[vi].z = -hsy + size_y/div_y * j;
-                    vi++;
-                }
-        }
-        else if(MOTO_ORIENTATION_XY == orientation)
-        {
-            for(i = 0; i < div_x+1; i++)
-                for(j = 0; j < div_y+1; j++)
-                {
-                    mesh->v_coords[vi].x = -hsx + size_x/div_x * i;
-                    mesh->v_coords[vi].y = -hsy + size_y/div_y * j;
-                    mesh->v_coords[vi].z = 0;
-                    vi++;
-                }
-        }
-
+        guint16 fi = 0;
         if(new_mesh)
         {
             for(i = 0; i < div_x; i++)
@@ -310,7 +296,10 @@ static void moto_plane_node_update_mesh(MotoPlaneNode *self)
     }
 
     priv->bound_calculated = FALSE;
-    moto_shape_prepare((MotoShape*)mesh);
+    if(new_mesh)
+        moto_shape_prepare((MotoShape*)mesh);
+    else
+        moto_mesh_update_coords(mesh, FALSE);
     moto_node_set_param_object(node, "out", (GObject*)mesh);
 }
 #undef e_x_num
@@ -0,0 +1,360 @@
+#include <Python.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "moto-messager.h"
+#include "moto-profiler.h"
+
+#define RING_SIZE 16384
+
+/* Written only by its thread. Others read samples before head and drop ones
+ * which may be overwritten while reading. Head counts all samples since
+ * clearing and wraps as slots do (size is power of 2). */
+typedef struct _MotoProfileRing MotoProfileRing;
+struct _MotoProfileRing
+{
+    MotoProfileSample samples[RING_SIZE];
+    volatile gint head;
+    volatile gint full;
+    guint stamp;
+    guint thread;
+    MotoProfileRing *next;
+};
+
+volatile gboolean moto_profiler_enabled = FALSE;
+
+static volatile gint current_frame = 0;
+static volatile gint clear_stamp = 0;
+
+static GTimer *timer = NULL;
+static MotoProfileRing *rings = NULL;
+static guint rings_num = 0;
+G_LOCK_DEFINE_STATIC(rings);
+
+static GStaticPrivate ring_key = G_STATIC_PRIVATE_INIT;
+
+static const gchar *category_names[] =
+    {"update", "perform", "normals", "tesselate", "draw", "select", "io", "build"};
+
+void moto_profiler_enable(gboolean enable)
+{
+    G_LOCK(rings);
+    if( ! timer)
+        timer = g_timer_new();
+    G_UNLOCK(rings);
+
+    moto_profiler_enabled = enable;
+}
+
+void moto_profiler_clear(void)
+{
+    g_atomic_int_inc(& clear_stamp);
+}
+
+void moto_profiler_next_frame(void)
+{
+    g_atomic_int_inc(& current_frame);
+}
+
+guint moto_profiler_get_frame(void)
+{
+    return (guint)g_atomic_int_get(& current_frame);
+}
+
+guint64 moto_profiler_now(void)
+{
+    gulong micro;
+    gdouble seconds = g_timer_elapsed(timer, & micro);
+    return (guint64)seconds*G_USEC_PER_SEC + micro + 1;
+}
+
+/* Rings of finished threads are kept for collecting. */
+static MotoProfileRing *get_ring(void)
+{
+    MotoProfileRing *ring = (MotoProfileRing *)g_static_private_get(& ring_key);
+    if( ! ring)
+    {
+        ring = g_new0(MotoProfileRing, 1);
+        ring->stamp = g_atomic_int_get(& clear_stamp);
+
+        G_LOCK(rings);
+        ring->thread = ++rings_num;
+        ring->next = rings;
+        rings = ring;
+        G_UNLOCK(rings);
+
+        g_static_private_set(& ring_key, ring, NULL);
+    }
+    return ring;
+}
+
+void moto_profiler_add(guint64 begin, MotoProfileCategory category,
+        const gchar *name, gconstpointer node)
+{
+    MotoProfileRing *ring = get_ring();
+
+    guint stamp = g_atomic_int_get(& clear_stamp);
+    if(ring->stamp != stamp)
+    {
+        g_atomic_int_set(& ring->head, 0);
+        g_atomic_int_set(& ring->full, FALSE);
+        ring->stamp = stamp;
+    }
+
+    guint head = (guint)ring->head;
+    MotoProfileSample *s = ring->samples + head % RING_SIZE;
+    s->node     = node;
+    s->name     = name;
+    s->category = category;
+    s->frame    = g_atomic_int_get(& current_frame);
+    s->thread   = ring->thread;
+    s->begin    = begin;
+    s->end      = moto_profiler_now();
+
+    if(RING_SIZE == head + 1)
+        g_atomic_int_set(& ring->full, TRUE);
+    g_atomic_int_set(& ring->head, (gint)(head + 1));
+}
+
+const gchar *moto_profile_category_get_name(MotoProfileCategory category)
+{
+    if(category >= MOTO_PROFILE_CATEGORIES_NUM)
+        return "unknown";
+    return category_names[category];
+}
+
+/* Collecting */
+
+static gint compare_begin(gconstpointer a, gconstpointer b)
+{
+    const MotoProfileSample *sa = (const MotoProfileSample *)a;
+    const MotoProfileSample *sb = (const MotoProfileSample *)b;
+    return (sa->begin < sb->begin) ? -1 : (sa->begin > sb->begin);
+}
+
+/* Samples are copied first and checked after, when head is known again.
+ * Sample of count n is overwritten by sample n + RING_SIZE, so ones up to
+ * new head - RING_SIZE may be torn (including one being written now). */
+static void append_samples(GArray *samples, GArray *tmp, MotoProfileRing *ring, guint frame)
+{
+    gboolean full = g_atomic_int_get(& ring->full);
+    guint head  = (guint)g_atomic_int_get(& ring->head);
+    guint first = (full) ? head - RING_SIZE : 0;
+
+    guint i;
+    g_array_set_size(tmp, 0);
+    for(i = first; i != head; i++)
+        g_array_append_val(tmp, ring->samples[i % RING_SIZE]);
+
+    guint new_head = (guint)g_atomic_int_get(& ring->head);
+    gint torn = (gint)(new_head + 1 - RING_SIZE - first);
+
+    for(i = CLAMP(torn, 0, (gint)tmp->len); i < tmp->len; i++)
+    {
+        MotoProfileSample *s = & g_array_index(tmp, MotoProfileSample, i);
+        if(MOTO_PROFILE_ALL_FRAMES == frame || s->frame == frame)
+            g_array_append_val(samples, *s);
+    }
+}
+
+GArray *moto_profiler_get_samples(guint frame)
+{
+    GArray *samples = g_array_new(FALSE, FALSE, sizeof(MotoProfileSample));
+    GArray *tmp = g_array_new(FALSE, FALSE, sizeof(MotoProfileSample));
+    guint stamp = g_atomic_int_get(& clear_stamp);
+
+    G_LOCK(rings);
+    MotoProfileRing *ring;
+    for(ring = rings; ring; ring = ring->next)
+    {
+        if(ring->stamp != stamp)
+            continue;
+
+        append_samples(samples, tmp, ring, frame);
+    }
+    G_UNLOCK(rings);
+    g_array_free(tmp, TRUE);
+
+    g_array_sort(samples, compare_begin);
+    return samples;
+}
+
+static gint compare_key(gconstpointer a, gconstpointer b)
+{
+    const MotoProfileSample *sa = (const MotoProfileSample *)a;
+    const MotoProfileSample *sb = (const MotoProfileSample *)b;
+    if(sa->category != sb->category)
+        return (sa->category < sb->category) ? -1 : 1;
+    if(sa->node != sb->node)
+        return (sa->node < sb->node) ? -1 : 1;
+    if(sa->name != sb->name)
+        return (sa->name < sb->name) ? -1 : 1;
+    return 0;
+}
+
+static gint compare_total(gconstpointer a, gconstpointer b)
+{
+    const MotoProfileStat *sa = (const MotoProfileStat *)a;
+    const MotoProfileStat *sb = (const MotoProfileStat *)b;
+    return (sa->total > sb->total) ? -1 : (sa->total < sb->total);
+}
+
+GArray *moto_profiler_get_stats(guint frame)
+{
+    GArray *samples = moto_profiler_get_samples(frame);
+    GArray *stats = g_array_new(FALSE, FALSE, sizeof(MotoProfileStat));
+
+    /* Names are interned or static, so pointers are compared. */
+    g_array_sort(samples, compare_key);
+
+    guint i;
+    MotoProfileStat *stat = NULL;
+    for(i = 0; i < samples->len; i++)
+    {
+        MotoProfileSample *s = & g_array_index(samples, MotoProfileSample, i);
+        if( ! stat || stat->category != s->category || stat->node != s->node || stat->name != s->name)
+        {
+            MotoProfileStat tmp = {s->node, s->name, s->category, 0, 0, 0};
+            g_array_append_val(stats, tmp);
+            stat = & g_array_index(stats, MotoProfileStat, stats->len - 1);
+        }
+
+        guint64 time = s->end - s->begin;
+        stat->calls++;
+        stat->total += time;
+        stat->max = MAX(stat->max, time);
+    }
+
+    g_array_free(samples, TRUE);
+
+    g_array_sort(stats, compare_total);
+    return stats;
+}
+
+/* Chrome trace */
+
+static void write_json_string(FILE *file, const gchar *str)
+{
+    fputc('"', file);
+    for(; *str; str++)
+    {
+        if('"' == *str || '\\' == *str)
+            fprintf(file, "\\%c", *str);
+        else if((guchar)*str < 0x20)
+            fprintf(file, "\\u%04x", (guchar)*str);
+        else
+            fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+gboolean moto_profiler_write_trace(const gchar *filename, guint frame)
+{
+    FILE *file = fopen(filename, "w");
+    if( ! file)
+    {
+        moto_error("Can't open file \"%s\" for writing", filename);
+        return FALSE;
+    }
+
+    GArray *samples = moto_profiler_get_samples(frame);
+
+    /* Complete events, one process with thread per ring. */
+    fprintf(file, "{\"traceEvents\":[\n");
+    guint i;
+    for(i = 0; i < samples->len; i++)
+    {
+        MotoProfileSample *s = & g_array_index(samples, MotoProfileSample, i);
+        fprintf(file, "%s{\"name\":", (i) ? ",\n" : "");
+        write_json_string(file, s->name);
+        fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" G_GUINT64_FORMAT
+                ",\"dur\":%" G_GUINT64_FORMAT ",\"pid\":1,\"tid\":%u,\"args\":{\"frame\":%u}}",
+                moto_profile_category_get_name(s->category),
+                s->begin, s->end - s->begin, s->thread, s->frame);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    g_array_free(samples, TRUE);
+
+    gboolean result = ! ferror(file);
+    if(fclose(file) || ! result)
+    {
+        moto_error("Can't write trace \"%s\"", filename);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Python */
+
+static PyObject *py_enable(PyObject *self, PyObject *args)
+{
+    gint enable = TRUE;
+    if( ! PyArg_ParseTuple(args, "|i", & enable))
+        return NULL;
+
+    moto_profiler_enable(enable);
+    Py_RETURN_NONE;
+}
+
+static PyObject *py_clear(PyObject *self, PyObject *args)
+{
+    moto_profiler_clear();
+    Py_RETURN_NONE;
+}
+
+static PyObject *py_frame(PyObject *self, PyObject *args)
+{
+    return PyInt_FromLong(moto_profiler_get_frame());
+}
+
+/* List of (name, category, calls, total ms, max ms). */
+static PyObject *py_stats(PyObject *self, PyObject *args)
+{
+    gint frame = -1;
+    if( ! PyArg_ParseTuple(args, "|i", & frame))
+        return NULL;
+
+    GArray *stats = moto_profiler_get_stats((frame < 0) ? MOTO_PROFILE_ALL_FRAMES : (guint)frame);
+    PyObject *list = PyList_New(stats->len);
+
+    guint i;
+    for(i = 0; i < stats->len; i++)
+    {
+        MotoProfileStat *s = & g_array_index(stats, MotoProfileStat, i);
+        PyList_SET_ITEM(list, i, Py_BuildValue("(ssIdd)", s->name,
+            moto_profile_category_get_name(s->category), s->calls, s->total/1000.0, s->max/1000.0));
+    }
+
+    g_array_free(stats, TRUE);
+    return list;
+}
+
+static PyObject *py_write_trace(PyObject *self, PyObject *args)
+{
+    const gchar *filename;
+    gint frame = -1;
+    if( ! PyArg_ParseTuple(args, "s|i", & filename, & frame))
+        return NULL;
+
+    gboolean result = \
+        moto_profiler_write_trace(filename, (frame < 0) ? MOTO_PROFILE_ALL_FRAMES : (guint)frame);
+    return PyBool_FromLong(result);
+}
+
+static PyMethodDef py_methods[] =
+{
+    {"enable", py_enable, METH_VARARGS, "enable([flag]) turns profiler on or off."},
+    {"clear", py_clear, METH_NOARGS, "clear() forgets all samples."},
+    {"frame", py_frame, METH_NOARGS, "frame() returns number of current frame."},
+    {"stats", py_stats, METH_VARARGS,
+        "stats([frame]) returns list of (name, category, calls, total ms, max ms), slowest first."},
+    {"write_trace", py_write_trace, METH_VARARGS,
+        "write_trace(filename[, frame]) writes Chrome trace event JSON."},
+    {NULL, NULL, 0, NULL}
+};
+
+void moto_profiler_init_python(void)
+{
+    Py_InitModule("motoprofiler", py_methods);
+}
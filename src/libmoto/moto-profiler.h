@@ -0,0 +1,112 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_PROFILER_H__
+#define __MOTO_PROFILER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Scoped timings of hot paths. Samples are written without locks into ring
+ * buffer of calling thread and are collected per node and per frame.
+ * While profiler is disabled each scope costs one check of flag. */
+
+typedef enum _MotoProfileCategory
+{
+    MOTO_PROFILE_UPDATE,
+    MOTO_PROFILE_PERFORM,
+    MOTO_PROFILE_NORMALS,
+    MOTO_PROFILE_TESSELATE,
+    MOTO_PROFILE_DRAW,
+    MOTO_PROFILE_SELECT,
+    MOTO_PROFILE_IO,
+    MOTO_PROFILE_BUILD,
+    MOTO_PROFILE_CATEGORIES_NUM
+} MotoProfileCategory;
+
+#define MOTO_PROFILE_ALL_FRAMES G_MAXUINT
+
+typedef struct _MotoProfileSample MotoProfileSample;
+typedef struct _MotoProfileStat MotoProfileStat;
+
+/* Times are in microseconds. */
+struct _MotoProfileSample
+{
+    gconstpointer node;
+    const gchar *name;
+    MotoProfileCategory category;
+    guint frame;
+    guint thread;
+    guint64 begin;
+    guint64 end;
+};
+
+struct _MotoProfileStat
+{
+    gconstpointer node;
+    const gchar *name;
+    MotoProfileCategory category;
+    guint calls;
+    guint64 total;
+    guint64 max;
+};
+
+extern volatile gboolean moto_profiler_enabled;
+
+void moto_profiler_enable(gboolean enable);
+#define moto_profiler_is_enabled() (moto_profiler_enabled)
+
+/* Forgets all samples. Rings are reset by their threads on next sample. */
+void moto_profiler_clear(void);
+
+/* Frame is advanced after each draw of scene. */
+void moto_profiler_next_frame(void);
+guint moto_profiler_get_frame(void);
+
+/* Never returns 0, so it may be used as flag of started scope. */
+guint64 moto_profiler_now(void);
+/* Name isn't copied, so it's interned (see moto_node_get_interned_name) or static. */
+void moto_profiler_add(guint64 begin, MotoProfileCategory category,
+        const gchar *name, gconstpointer node);
+
+#define MOTO_PROFILE_BEGIN(scope) \
+    guint64 scope = (moto_profiler_enabled) ? moto_profiler_now() : 0
+#define MOTO_PROFILE_END(scope, category, name, node) \
+    do { if(scope) moto_profiler_add(scope, category, name, node); } while(0)
+
+const gchar *moto_profile_category_get_name(MotoProfileCategory category);
+
+/* Samples of all threads ordered by begin. Samples of frame which is being
+ * drawn may be incomplete. Free with g_array_free. */
+GArray *moto_profiler_get_samples(guint frame);
+/* Samples of frame (or all) grouped by node, name and category. Slowest are first. */
+GArray *moto_profiler_get_stats(guint frame);
+
+/* JSON of Chrome trace event format (chrome://tracing, Perfetto). */
+gboolean moto_profiler_write_trace(const gchar *filename, guint frame);
+
+/* Adds "motoprofiler" module to embedded interpreter. */
+void moto_profiler_init_python(void);
+
+G_END_DECLS
+
+#endif /* __MOTO_PROFILER_H__ */
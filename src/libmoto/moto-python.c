@@ -378,6 +378,9 @@ PyObject *moto_PyFunction_from_args_and_body(const gchar *argsdef, const gchar *
         g_string_append(code, "\n");
     }
 
+    /* The same functions and constants as native expressions have. */
+    g_string_prepend(code, "import math\nfrom math import *\n");
+
     PyObject *module   = NULL;
     PyObject *func     = NULL;
     PyObject *compiled = Py_CompileString(code->str, "__moto__", Py_file_input);
@@ -50,6 +50,7 @@ gboolean moto_string_from_PyObject(gchar **v, PyObject *obj);
 
 gboolean moto_GValue_from_PyObject(GValue *v, PyObject *obj);
 
+/* Module of function has "math" imported and all its names. */
 PyObject *moto_PyFunction_from_args_and_body(const gchar *argsdef, const gchar *body);
 
 // moto -> Py
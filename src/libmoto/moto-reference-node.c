@@ -0,0 +1,143 @@
+#include <string.h>
+
+#include "moto-messager.h"
+#include "moto-filename.h"
+#include "moto-scene-node.h"
+#include "moto-scene-dump.h"
+#include "moto-reference-node.h"
+
+/* forwards */
+
+static void moto_reference_node_update(MotoNode *self);
+
+/* class MotoReferenceNode */
+
+typedef struct _MotoReferenceNodePriv MotoReferenceNodePriv;
+
+#define MOTO_REFERENCE_NODE_GET_PRIVATE(obj) \
+    G_TYPE_INSTANCE_GET_PRIVATE(obj, MOTO_TYPE_REFERENCE_NODE, MotoReferenceNodePriv)
+
+static GObjectClass *reference_node_parent_class = NULL;
+
+struct _MotoReferenceNodePriv
+{
+    GString *loaded; /* File from which children are loaded. */
+};
+
+static void
+moto_reference_node_finalize(GObject *obj)
+{
+    MotoReferenceNodePriv *priv = MOTO_REFERENCE_NODE_GET_PRIVATE(obj);
+
+    if(priv->loaded)
+        g_string_free(priv->loaded, TRUE);
+
+    reference_node_parent_class->finalize(obj);
+}
+
+static void
+moto_reference_node_init(MotoReferenceNode *self)
+{
+    MotoNode *node = (MotoNode *)self;
+    MotoReferenceNodePriv *priv = MOTO_REFERENCE_NODE_GET_PRIVATE(self);
+
+    priv->loaded = NULL;
+
+    moto_node_add_params(node,
+            "filename", "Filename", MOTO_TYPE_FILENAME, MOTO_PARAM_MODE_INOUT, "",   NULL, "Reference",
+            "load",     "Load",     MOTO_TYPE_BOOL,     MOTO_PARAM_MODE_INOUT, TRUE, NULL, "Reference",
+            NULL);
+}
+
+static void
+moto_reference_node_class_init(MotoReferenceNodeClass *klass)
+{
+    g_type_class_add_private(klass, sizeof(MotoReferenceNodePriv));
+
+    reference_node_parent_class = (GObjectClass *)g_type_class_peek_parent(klass);
+
+    GObjectClass *goclass = G_OBJECT_CLASS(klass);
+    MotoNodeClass *nclass = (MotoNodeClass *)klass;
+
+    goclass->finalize = moto_reference_node_finalize;
+
+    nclass->update = moto_reference_node_update;
+}
+
+G_DEFINE_TYPE(MotoReferenceNode, moto_reference_node, MOTO_TYPE_OBJECT_NODE);
+
+/* Methods of class MotoReferenceNode */
+
+MotoReferenceNode *moto_reference_node_new(const gchar *name)
+{
+    MotoReferenceNode *self = (MotoReferenceNode *)g_object_new(MOTO_TYPE_REFERENCE_NODE, NULL);
+    MotoNode *node = (MotoNode *)self;
+
+    moto_node_set_name(node, name);
+
+    return self;
+}
+
+/* Relative paths are relative to directory of scene file. */
+static gchar *resolve_filename(MotoReferenceNode *self, const gchar *filename)
+{
+    MotoSceneNode *scene = moto_node_get_scene_node((MotoNode *)self);
+    const gchar *scene_filename = (scene) ? moto_scene_node_get_filename(scene) : NULL;
+
+    if(g_path_is_absolute(filename) || ! scene_filename || ! *scene_filename)
+        return g_strdup(filename);
+
+    gchar *dir = g_path_get_dirname(scene_filename);
+    gchar *path = g_build_filename(dir, filename, NULL);
+    g_free(dir);
+    return path;
+}
+
+gboolean moto_reference_node_load(MotoReferenceNode *self)
+{
+    MotoReferenceNodePriv *priv = MOTO_REFERENCE_NODE_GET_PRIVATE(self);
+    MotoNode *node = (MotoNode *)self;
+
+    if(priv->loaded)
+        return TRUE;
+
+    MotoSceneNode *scene = moto_node_get_scene_node(node);
+    if( ! scene)
+    {
+        moto_error("Reference '%s' isn't in scene and can't be loaded", moto_node_get_name(node));
+        return FALSE;
+    }
+
+    const gchar *filename = NULL;
+    moto_node_get_param_string(node, "filename", & filename);
+    if( ! filename || ! *filename)
+        return FALSE;
+
+    gchar *path = resolve_filename(self, filename);
+    gboolean ok = moto_scene_dump_load_into(scene, node, path);
+    g_free(path);
+
+    /* Failed file isn't tried again on each update. */
+    priv->loaded = g_string_new(filename);
+
+    return ok;
+}
+
+gboolean moto_reference_node_is_loaded(MotoReferenceNode *self)
+{
+    return NULL != MOTO_REFERENCE_NODE_GET_PRIVATE(self)->loaded;
+}
+
+static void moto_reference_node_update(MotoNode *self)
+{
+    MotoReferenceNodePriv *priv = MOTO_REFERENCE_NODE_GET_PRIVATE(self);
+
+    /* Loading itself is done by scene before update, see moto_scene_node_update. */
+    const gchar *filename = NULL;
+    moto_node_get_param_string(self, "filename", & filename);
+    if(priv->loaded && filename && strcmp(filename, priv->loaded->str))
+        moto_warning("Reference '%s' is loaded from \"%s\", \"%s\" will be loaded only after reopening of scene",
+            moto_node_get_name(self), priv->loaded->str, filename);
+
+    ((MotoNodeClass *)reference_node_parent_class)->update(self);
+}
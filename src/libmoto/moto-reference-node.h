@@ -0,0 +1,67 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_REFERENCE_NODE_H__
+#define __MOTO_REFERENCE_NODE_H__
+
+#include "moto-object-node.h"
+
+G_BEGIN_DECLS
+
+typedef struct _MotoReferenceNode MotoReferenceNode;
+typedef struct _MotoReferenceNodeClass MotoReferenceNodeClass;
+
+/* class MotoReferenceNode */
+
+/* Sub-scene referenced from binary dump (see moto-scene-dump.h). Nodes of file
+ * become children of reference when it's loaded and they aren't saved with
+ * the scene. Meshes are loaded on first access and identical ones are shared
+ * by all references through library, so the same asset referenced many times
+ * takes memory once. Reference is loaded by scene update if "load" is on. */
+
+struct _MotoReferenceNode
+{
+    MotoObjectNode parent;
+};
+
+struct _MotoReferenceNodeClass
+{
+    MotoObjectNodeClass parent;
+};
+
+GType moto_reference_node_get_type(void);
+
+#define MOTO_TYPE_REFERENCE_NODE (moto_reference_node_get_type())
+#define MOTO_REFERENCE_NODE(obj)  (G_TYPE_CHECK_INSTANCE_CAST ((obj), MOTO_TYPE_REFERENCE_NODE, MotoReferenceNode))
+#define MOTO_REFERENCE_NODE_CLASS(klass)  (G_TYPE_CHECK_CLASS_CAST ((klass), MOTO_TYPE_REFERENCE_NODE, MotoReferenceNodeClass))
+#define MOTO_IS_REFERENCE_NODE(obj)  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),MOTO_TYPE_REFERENCE_NODE))
+#define MOTO_IS_REFERENCE_NODE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),MOTO_TYPE_REFERENCE_NODE))
+#define MOTO_REFERENCE_NODE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),MOTO_TYPE_REFERENCE_NODE, MotoReferenceNodeClass))
+
+MotoReferenceNode *moto_reference_node_new(const gchar *name);
+
+/* Must be called from the thread which owns the scene. */
+gboolean moto_reference_node_load(MotoReferenceNode *self);
+gboolean moto_reference_node_is_loaded(MotoReferenceNode *self);
+
+G_END_DECLS
+
+#endif /* __MOTO_REFERENCE_NODE_H__ */
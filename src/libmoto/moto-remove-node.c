@@ -29,6 +29,7 @@ moto_remove_node_class_init(MotoRemoveNodeClass *klass)
     MotoOpNodeClass *moclass = (MotoOpNodeClass *)klass;
 
     moclass->perform = moto_remove_node_perform;
+    moclass->cache_output = TRUE;
 }
 
 G_DEFINE_TYPE(MotoRemoveNode, moto_remove_node, MOTO_TYPE_OP_NODE);
@@ -0,0 +1,279 @@
+#include <stdarg.h>
+#include <string.h>
+
+#include "moto-messager.h"
+#include "moto-rib-stream.h"
+
+/* Binary RIB encoding, see RenderMan Interface Specification, appendix C. */
+#define RIB_INT32        0203
+#define RIB_SHORT_STRING 0220
+#define RIB_STRING8      0240
+#define RIB_STRING32     0243
+#define RIB_FLOAT        0244
+#define RIB_REQUEST      0246
+#define RIB_FLOAT_ARRAY  0313
+#define RIB_DEFINE       0314
+#define RIB_MAX_REQUESTS 256
+
+struct _MotoRibStream
+{
+    GString *data;
+    gboolean binary;
+    gboolean space; /* Separator is needed before next ASCII token. */
+
+    GHashTable *requests; /* name -> code + 1 */
+};
+
+MotoRibStream *moto_rib_stream_new(gboolean binary)
+{
+    MotoRibStream *self = g_slice_new(MotoRibStream);
+    self->data = g_string_sized_new(4096);
+    self->binary = binary;
+    self->space = FALSE;
+    self->requests = g_hash_table_new(g_str_hash, g_str_equal);
+    return self;
+}
+
+void moto_rib_stream_free(MotoRibStream *self)
+{
+    g_string_free(self->data, TRUE);
+    g_hash_table_destroy(self->requests);
+    g_slice_free(MotoRibStream, self);
+}
+
+void moto_rib_stream_clear(MotoRibStream *self)
+{
+    g_string_truncate(self->data, 0);
+    g_hash_table_remove_all(self->requests);
+    self->space = FALSE;
+}
+
+gboolean moto_rib_stream_is_binary(MotoRibStream *self)
+{
+    return self->binary;
+}
+
+gsize moto_rib_stream_get_size(MotoRibStream *self)
+{
+    return self->data->len;
+}
+
+gboolean moto_rib_stream_write_to(MotoRibStream *self, FILE *file)
+{
+    if( ! self->data->len)
+        return TRUE;
+    return fwrite(self->data->str, self->data->len, 1, file) == 1;
+}
+
+gboolean moto_rib_stream_write_file(MotoRibStream *self, const gchar *filename)
+{
+    FILE *file = fopen(filename, "wb");
+    if( ! file)
+    {
+        moto_error("Can't open file \"%s\" for writing", filename);
+        return FALSE;
+    }
+
+    gboolean ok = moto_rib_stream_write_to(self, file);
+    if(fclose(file) || ! ok)
+    {
+        moto_error("Can't write file \"%s\"", filename);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void append_be32(GString *data, guint32 value)
+{
+    value = GUINT32_TO_BE(value);
+    g_string_append_len(data, (const gchar *)& value, 4);
+}
+
+static void append_binary_float(GString *data, gfloat value)
+{
+    union {gfloat f; guint32 i;} u;
+    u.f = value;
+    append_be32(data, u.i);
+}
+
+static void append_binary_string(GString *data, const gchar *value)
+{
+    gsize len = strlen(value);
+    if(len < 16)
+        g_string_append_c(data, RIB_SHORT_STRING + len);
+    else if(len < 256)
+    {
+        g_string_append_c(data, RIB_STRING8);
+        g_string_append_c(data, len);
+    }
+    else
+    {
+        g_string_append_c(data, RIB_STRING32);
+        append_be32(data, len);
+    }
+    g_string_append_len(data, value, len);
+}
+
+static void separate(MotoRibStream *self)
+{
+    if(self->space)
+        g_string_append_c(self->data, ' ');
+    self->space = TRUE;
+}
+
+void moto_rib_stream_comment(MotoRibStream *self, const gchar *fmt, ...)
+{
+    if(self->binary)
+        return;
+
+    if(self->data->len)
+        g_string_append_c(self->data, '\n');
+    g_string_append_c(self->data, '#');
+
+    va_list ap;
+    va_start(ap, fmt);
+    g_string_append_vprintf(self->data, fmt, ap);
+    va_end(ap);
+
+    self->space = FALSE;
+}
+
+void moto_rib_stream_request(MotoRibStream *self, const gchar *name)
+{
+    if(self->binary)
+    {
+        guint code = GPOINTER_TO_UINT(g_hash_table_lookup(self->requests, name));
+        if( ! code)
+        {
+            code = g_hash_table_size(self->requests) + 1;
+            if(code <= RIB_MAX_REQUESTS)
+            {
+                /* Key is stored by pointer so names must be static strings. */
+                g_hash_table_insert(self->requests, (gpointer)name, GUINT_TO_POINTER(code));
+                g_string_append_c(self->data, RIB_DEFINE);
+                g_string_append_c(self->data, code - 1);
+                append_binary_string(self->data, name);
+            }
+            else
+                code = 0;
+        }
+
+        if(code)
+        {
+            g_string_append_c(self->data, RIB_REQUEST);
+            g_string_append_c(self->data, code - 1);
+            return;
+        }
+    }
+
+    /* ASCII requests may be mixed with binary tokens. */
+    if(self->data->len)
+        g_string_append_c(self->data, '\n');
+    g_string_append(self->data, name);
+    self->space = TRUE;
+}
+
+void moto_rib_stream_int(MotoRibStream *self, gint32 value)
+{
+    if(self->binary)
+    {
+        g_string_append_c(self->data, RIB_INT32);
+        append_be32(self->data, (guint32)value);
+        return;
+    }
+
+    separate(self);
+    g_string_append_printf(self->data, "%d", value);
+}
+
+void moto_rib_stream_float(MotoRibStream *self, gfloat value)
+{
+    if(self->binary)
+    {
+        g_string_append_c(self->data, RIB_FLOAT);
+        append_binary_float(self->data, value);
+        return;
+    }
+
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+    separate(self);
+    g_string_append(self->data, g_ascii_formatd(buf, sizeof(buf), "%.7g", value));
+}
+
+void moto_rib_stream_string(MotoRibStream *self, const gchar *value)
+{
+    if(self->binary)
+    {
+        append_binary_string(self->data, value);
+        return;
+    }
+
+    separate(self);
+    g_string_append_c(self->data, '"');
+    g_string_append(self->data, value);
+    g_string_append_c(self->data, '"');
+}
+
+void moto_rib_stream_array_begin(MotoRibStream *self)
+{
+    if( ! self->binary)
+        separate(self);
+    g_string_append_c(self->data, '[');
+    self->space = FALSE;
+}
+
+void moto_rib_stream_array_end(MotoRibStream *self)
+{
+    g_string_append_c(self->data, ']');
+    self->space = TRUE;
+}
+
+void moto_rib_stream_float_array(MotoRibStream *self,
+        const gfloat *data, guint num, guint dim, gsize stride)
+{
+    const gchar *p = (const gchar *)data;
+    guint i, j;
+
+    if(self->binary)
+    {
+        g_string_append_c(self->data, RIB_FLOAT_ARRAY);
+        append_be32(self->data, num*dim);
+        for(i = 0; i < num; i++, p += stride)
+            for(j = 0; j < dim; j++)
+                append_binary_float(self->data, ((const gfloat *)p)[j]);
+        return;
+    }
+
+    moto_rib_stream_array_begin(self);
+    for(i = 0; i < num; i++, p += stride)
+        for(j = 0; j < dim; j++)
+            moto_rib_stream_float(self, ((const gfloat *)p)[j]);
+    moto_rib_stream_array_end(self);
+}
+
+void moto_rib_stream_float_channels(MotoRibStream *self,
+        const gfloat * const *channels, guint num, guint dim)
+{
+    guint i, j;
+
+    if(self->binary)
+    {
+        g_string_append_c(self->data, RIB_FLOAT_ARRAY);
+        append_be32(self->data, num*dim);
+        for(i = 0; i < num; i++)
+            for(j = 0; j < dim; j++)
+                append_binary_float(self->data, channels[j][i]);
+        return;
+    }
+
+    moto_rib_stream_array_begin(self);
+    for(i = 0; i < num; i++)
+        for(j = 0; j < dim; j++)
+            moto_rib_stream_float(self, channels[j][i]);
+    moto_rib_stream_array_end(self);
+}
+
+void moto_rib_stream_matrix(MotoRibStream *self, const gfloat *m)
+{
+    moto_rib_stream_float_array(self, m, 16, 1, sizeof(gfloat));
+}
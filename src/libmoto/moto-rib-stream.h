@@ -0,0 +1,67 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_RIB_STREAM_H__
+#define __MOTO_RIB_STREAM_H__
+
+#include <stdio.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* In-memory RIB chunk. Requests are appended as ASCII or binary encoded
+ * tokens and the whole chunk is written to file at once, so chunks may be
+ * filled in parallel and written in order.
+ * In binary mode each stream defines encoded requests it uses itself. */
+
+typedef struct _MotoRibStream MotoRibStream;
+
+MotoRibStream *moto_rib_stream_new(gboolean binary);
+void moto_rib_stream_free(MotoRibStream *self);
+
+void moto_rib_stream_clear(MotoRibStream *self);
+gboolean moto_rib_stream_is_binary(MotoRibStream *self);
+gsize moto_rib_stream_get_size(MotoRibStream *self);
+gboolean moto_rib_stream_write_to(MotoRibStream *self, FILE *file);
+gboolean moto_rib_stream_write_file(MotoRibStream *self, const gchar *filename);
+
+/* Comments are kept only in ASCII mode. */
+void moto_rib_stream_comment(MotoRibStream *self, const gchar *fmt, ...);
+
+void moto_rib_stream_request(MotoRibStream *self, const gchar *name);
+void moto_rib_stream_int(MotoRibStream *self, gint32 value);
+void moto_rib_stream_float(MotoRibStream *self, gfloat value);
+void moto_rib_stream_string(MotoRibStream *self, const gchar *value);
+
+void moto_rib_stream_array_begin(MotoRibStream *self);
+void moto_rib_stream_array_end(MotoRibStream *self);
+
+/* Array of num elements each of dim floats, elements are stride bytes apart. */
+void moto_rib_stream_float_array(MotoRibStream *self,
+        const gfloat *data, guint num, guint dim, gsize stride);
+/* Array of num elements, component j of each element is taken from channels[j]. */
+void moto_rib_stream_float_channels(MotoRibStream *self,
+        const gfloat * const *channels, guint num, guint dim);
+void moto_rib_stream_matrix(MotoRibStream *self, const gfloat *m);
+
+G_END_DECLS
+
+#endif /* __MOTO_RIB_STREAM_H__ */
@@ -1,15 +1,20 @@
 #include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 #include <math.h>
 #include <glib/gprintf.h>
+#include <glib/gstdio.h>
 #include "moto-types.h"
 #include "moto-param-spec.h"
 #include "moto-copyable.h"
 #include "moto-point-cloud.h"
+#include "moto-messager.h"
 #include "moto-rman-node.h"
+#include "moto-rib-stream.h"
 #include "moto-scene-node.h"
 #include "moto-mesh.h"
 #include "moto-object-node.h"
+#include "moto-instance-node.h"
 #include "moto-light-node.h"
 #include "libmotoutil/xform.h"
 #include "libmotoutil/numdef.h"
@@ -41,14 +46,70 @@ GType moto_rman_target_get_type(void)
 
 static GObjectClass *rman_node_parent_class = NULL;
 
+/* Wider attributes aren't exported. */
+#define MAX_PRIMVAR_CHANNELS 16
+
 #define MOTO_RMAN_NODE_GET_PRIVATE(obj) \
     G_TYPE_INSTANCE_GET_PRIVATE(obj, MOTO_TYPE_RMAN_NODE, MotoRManNodePriv)
 
 typedef struct
 {
     FILE* out;
+    guint objects_num; /* Handles of ObjectBegin in current frame. */
+    guint frame; /* Number of exported frames. */
+
+    /* Geometry of static shapes is kept in archives between frames. */
+    GHashTable *archives; /* shape node id -> MotoRManArchive */
+
+    GThreadPool *pool;
+    GMutex *jobs_mutex;
+    GCond *jobs_cond;
 } MotoRManNodePriv;
 
+typedef struct _MotoRManArchive
+{
+    GTimeVal stamp; /* last_modified of shape node when it was exported */
+    gboolean subdiv;
+    guint frame; /* When archive was written. */
+    gchar *path; /* NULL while shape is changing. */
+} MotoRManArchive;
+
+/* One object serialised into its own chunk, possibly in worker thread. */
+typedef struct _MotoRManJob
+{
+    MotoNode *node;
+    MotoMesh *mesh;
+    gboolean subdiv;
+    gfloat matrix[16];
+    guint handle;
+
+    gchar *archive;
+    gboolean write_archive;
+
+    MotoRibStream *rib;
+    gboolean done;
+} MotoRManJob;
+
+static void free_archive(MotoRManArchive *archive)
+{
+    g_free(archive->path);
+    g_slice_free(MotoRManArchive, archive);
+}
+
+static void
+moto_rman_node_finalize(GObject *obj)
+{
+    MotoRManNodePriv* priv = MOTO_RMAN_NODE_GET_PRIVATE(obj);
+
+    if(priv->pool)
+        g_thread_pool_free(priv->pool, TRUE, TRUE);
+    g_hash_table_destroy(priv->archives);
+    g_mutex_free(priv->jobs_mutex);
+    g_cond_free(priv->jobs_cond);
+
+    rman_node_parent_class->finalize(obj);
+}
+
 static void
 moto_rman_node_init(MotoRManNode *self)
 {
@@ -56,6 +117,15 @@ moto_rman_node_init(MotoRManNode *self)
     MotoRManNodePriv* priv = MOTO_RMAN_NODE_GET_PRIVATE(self);
 
     priv->out = NULL;
+    priv->objects_num = 0;
+    priv->frame = 0;
+
+    priv->archives = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+        NULL, (GDestroyNotify)free_archive);
+
+    priv->pool = NULL;
+    priv->jobs_mutex = g_mutex_new();
+    priv->jobs_cond = g_cond_new();
 
     gfloat samples[] = {4, 4};
     gint bucket_size[] = {12, 12};
@@ -75,6 +145,11 @@ moto_rman_node_init(MotoRManNode *self)
             "gi_max_dist", "Max Distance", MOTO_TYPE_FLOAT, MOTO_PARAM_MODE_INOUT, 1e36, NULL, "Global Illumination",
             "use_custom_command", "Use Custom Command", MOTO_TYPE_BOOL, MOTO_PARAM_MODE_INOUT, FALSE, NULL, "Customization",
             "custom_command", "Custom Command", MOTO_TYPE_STRING, MOTO_PARAM_MODE_INOUT, "", NULL, "Customization",
+            "output", "Output", MOTO_TYPE_STRING, MOTO_PARAM_MODE_INOUT, "last-render.rib", NULL, "Export",
+            "binary", "Binary RIB", MOTO_TYPE_BOOL, MOTO_PARAM_MODE_INOUT, FALSE, NULL, "Export",
+            "use_archives", "Archive Static Geometry", MOTO_TYPE_BOOL, MOTO_PARAM_MODE_INOUT, TRUE, NULL, "Export",
+            "archive_dir", "Archive Directory", MOTO_TYPE_STRING, MOTO_PARAM_MODE_INOUT, "rib-archives", NULL, "Export",
+            "threads", "Threads", MOTO_TYPE_INT, MOTO_PARAM_MODE_INOUT, 4, NULL, "Export",
             NULL);
 }
 
@@ -84,6 +159,9 @@ moto_rman_node_class_init(MotoRManNodeClass *klass)
     rman_node_parent_class = (GObjectClass *)g_type_class_peek_parent(klass);
     g_type_class_add_private(klass, sizeof(MotoRManNodePriv));
 
+    GObjectClass *goclass = G_OBJECT_CLASS(klass);
+    goclass->finalize = moto_rman_node_finalize;
+
     MotoRenderNodeClass *rclass = (MotoRenderNodeClass*)klass;
     rclass->render = moto_rman_node_render;
 
@@ -115,13 +193,9 @@ void moto_rman_node_write(MotoRManNode *self, guint indent_num, const gchar *fmt
         return;
     FILE* out = priv->out;
 
-    GString *indent = g_string_new("");
     guint i;
     for(i = 0; i < indent_num; ++i)
-        g_string_append(indent, "    ");
-
-    g_fprintf(out, "%s", indent->str);
-    g_string_free(indent, TRUE);
+        fputs("    ", out);
 
     va_list ap;
     va_start(ap, fmt);
@@ -136,13 +210,9 @@ void moto_rman_node_writeln(MotoRManNode *self, guint indent_num, const gchar *f
         return;
     FILE* out = priv->out;
 
-    GString *indent = g_string_new("");
     guint i;
     for(i = 0; i < indent_num; ++i)
-        g_string_append(indent, "    ");
-
-    g_fprintf(out, "%s", indent->str);
-    g_string_free(indent, TRUE);
+        fputs("    ", out);
 
     va_list ap;
     va_start(ap, fmt);
@@ -223,189 +293,393 @@ static gboolean export_light(MotoSceneNode *scene_node, MotoNode *node, MotoRMan
     return TRUE;
 }
 
-static gboolean export_object(MotoSceneNode *scene_node, MotoNode *node, MotoRManNode *render)
+static void write_indices(MotoRibStream *rib, MotoMesh *mesh)
 {
-    if(!moto_render_node_check_time((MotoRenderNode*)render,
-                                    moto_node_get_last_modified(node)))
+    guint32 i;
+
+    moto_rib_stream_array_begin(rib);
+    guint32 prev_v_offset = 0;
+    for(i = 0; i < mesh->f_num; ++i)
     {
-        ;//return TRUE;
+        guint32 v_offset = (mesh->b32) ? mesh->f_data32[i].v_offset : mesh->f_data16[i].v_offset;
+        moto_rib_stream_int(rib, v_offset - prev_v_offset);
+        prev_v_offset = v_offset;
     }
+    moto_rib_stream_array_end(rib);
 
-    MotoParam* param = moto_node_get_param(node, "view");
-    if(!param)
-        return TRUE;
+    moto_rib_stream_array_begin(rib);
+    for(i = 0; i < prev_v_offset; ++i)
+        moto_rib_stream_int(rib, (mesh->b32) ? mesh->f_verts32[i] : mesh->f_verts16[i]);
+    moto_rib_stream_array_end(rib);
+}
 
-    MotoParam* source = moto_param_get_source(param);
-    if(!source)
-        return TRUE;
+/* Float and half attributes are written as primitive variables. Int and byte
+ * ones aren't since renderers don't interpolate them. */
+static void write_attrs(MotoRibStream *rib, MotoMesh *mesh)
+{
+    guint i, j, ch;
+    for(i = 0; i < moto_mesh_get_attrs_num(mesh); i++)
+    {
+        MotoMeshAttr *attr = moto_mesh_get_attr(mesh, i);
+        if( ! attr || attr->chnum > MAX_PRIMVAR_CHANNELS)
+            continue;
+        if(MOTO_MESH_ATTR_FLOAT != attr->type && MOTO_MESH_ATTR_HALF != attr->type)
+            continue;
+
+        const gchar *cls = "vertex";
+        if(MOTO_MESH_ATTR_FACE == attr->domain)
+            cls = "uniform";
+        else if(MOTO_MESH_ATTR_FACE_VERT == attr->domain)
+            cls = "facevarying";
+
+        gchar *decl = (1 == attr->chnum) ?
+            g_strdup_printf("%s float %s", cls, g_quark_to_string(attr->name)) :
+            g_strdup_printf("%s float[%u] %s", cls, attr->chnum, g_quark_to_string(attr->name));
+        moto_rib_stream_string(rib, decl);
+        g_free(decl);
+
+        if(MOTO_MESH_ATTR_FLOAT == attr->type)
+        {
+            /* Channels are read in place. */
+            const gfloat *channels[MAX_PRIMVAR_CHANNELS];
+            for(ch = 0; ch < attr->chnum; ch++)
+                channels[ch] = moto_mesh_attr_float(attr, ch);
+            moto_rib_stream_float_channels(rib, channels, attr->num, attr->chnum);
+        }
+        else
+        {
+            moto_rib_stream_array_begin(rib);
+            for(j = 0; j < attr->num; j++)
+                for(ch = 0; ch < attr->chnum; ch++)
+                    moto_rib_stream_float(rib, moto_mesh_attr_get_value(attr, ch, j));
+            moto_rib_stream_array_end(rib);
+        }
+    }
+}
 
-    MotoNode* source_node = moto_param_get_node(source);
-    if(!source_node)
-        return TRUE;
+static void write_mesh(MotoRibStream *rib, MotoMesh *mesh, gboolean subdiv)
+{
+    if( ! mesh->f_num || ! mesh->v_num)
+        return;
 
-    MotoMesh* mesh = NULL;
-    if(!moto_node_get_param_object(source_node, "mesh", (GObject**)&mesh))
-        return TRUE;
-    if(!mesh)
-        return TRUE;
+    if(subdiv)
+    {
+        moto_rib_stream_request(rib, "SubdivisionMesh");
+        moto_rib_stream_string(rib, "catmull-clark");
+        write_indices(rib, mesh);
+
+        moto_rib_stream_array_begin(rib);
+        moto_rib_stream_string(rib, "interpolateboundary");
+        moto_rib_stream_array_end(rib);
+        moto_rib_stream_array_begin(rib);
+        moto_rib_stream_int(rib, 0);
+        moto_rib_stream_int(rib, 0);
+        moto_rib_stream_array_end(rib);
+        moto_rib_stream_array_begin(rib);
+        moto_rib_stream_array_end(rib);
+        moto_rib_stream_array_begin(rib);
+        moto_rib_stream_array_end(rib);
+    }
+    else
+    {
+        moto_rib_stream_request(rib, "PointsGeneralPolygons");
 
-    gboolean subdiv = FALSE;
-    moto_node_get_param_boolean(source_node, "subdiv_render", &subdiv);
+        guint32 i;
+        moto_rib_stream_array_begin(rib);
+        for(i = 0; i < mesh->f_num; ++i)
+            moto_rib_stream_int(rib, 1);
+        moto_rib_stream_array_end(rib);
 
-    moto_rman_node_writeln(render, 0, "# Node '%s' of type '%s'",
-        moto_node_get_name(node), moto_node_get_type_name(node));
-    moto_rman_node_writeln(render, 0, "AttributeBegin");
+        write_indices(rib, mesh);
+    }
 
-    const gfloat* m = \
-        moto_object_node_get_matrix((MotoObjectNode*)node, TRUE);
+    if(moto_mesh_is_packed(mesh))
+    {
+        /* Packed mesh stays packed, verts are decoded only for writing. */
+        gfloat *verts = g_new(gfloat, mesh->v_num*6);
+        moto_mesh_decode_verts(mesh, 0, mesh->v_num,
+            verts, sizeof(gfloat)*6, verts + 3, sizeof(gfloat)*6);
+
+        moto_rib_stream_string(rib, "P");
+        moto_rib_stream_float_array(rib, verts, mesh->v_num, 3, sizeof(gfloat)*6);
+        moto_rib_stream_string(rib, "N");
+        moto_rib_stream_float_array(rib, verts + 3, mesh->v_num, 3, sizeof(gfloat)*6);
+        g_free(verts);
+    }
+    else
+    {
+        moto_rib_stream_string(rib, "P");
+        moto_rib_stream_float_array(rib, (gfloat *)mesh->v_coords, mesh->v_num, 3, sizeof(MotoVector));
+        moto_rib_stream_string(rib, "N");
+        moto_rib_stream_float_array(rib, (gfloat *)mesh->v_normals, mesh->v_num, 3, sizeof(MotoVector));
+    }
 
-    moto_rman_node_writeln(render, 1, "Surface \"plastic\"");
-    moto_rman_node_writeln(render, 1,
-        "ConcatTransform\n    [%f %f %f %f\n     %f %f %f %f\n     %f %f %f %f\n     %f %f %f %f]",
-            m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7],
-            m[8], m[9], m[10], m[11], m[12], m[13], m[14], m[15]);
+    write_attrs(rib, mesh);
+}
 
-    if(subdiv)
+static void write_geometry(MotoRibStream *rib, MotoRManJob *job)
+{
+    if(job->archive)
     {
-        moto_rman_node_write(render, 1, "SubdivisionMesh \"catmull-clark\"\n    [");
+        moto_rib_stream_request(rib, "ReadArchive");
+        moto_rib_stream_string(rib, job->archive);
+    }
+    else
+        write_mesh(rib, job->mesh, job->subdiv);
+}
 
-        guint32 prev_v_offset = 0;
-        guint32 i;
-        for(i = 0; i < (mesh->f_num - 1); ++i)
-        {
-            guint32 v_offset = mesh->f_data16[i].v_offset;
-            moto_rman_node_write(render, 0, "%d ", v_offset - prev_v_offset);
-            prev_v_offset = v_offset;
-        }
-        moto_rman_node_write(render, 0, "%d]\n    [", mesh->f_data16[i].v_offset - prev_v_offset);
+/* Shape is declared once and each instance only refers to it. */
+static void write_instances(MotoRibStream *rib, MotoRManJob *job)
+{
+    MotoInstanceNode *node = (MotoInstanceNode *)job->node;
 
-        prev_v_offset = 0;
-        i = 0;
-        for(; i < (mesh->f_num - 1); ++i)
-        {
-            guint32 v_offset = mesh->f_data16[i].v_offset;
-            guint32 v_num = v_offset - prev_v_offset;
-
-            guint32 j;
-            for(j = 0; j < v_num; ++j)
-            {
-                moto_rman_node_write(render, 0, "%d ", mesh->f_verts16[prev_v_offset + j]);
-            }
-            prev_v_offset = v_offset;
-        }
+    guint num = moto_instance_node_get_instances_num(node);
+    if( ! num)
+        return;
 
-        {
-            guint32 v_offset = mesh->f_data16[i].v_offset;
-            guint32 v_num = v_offset - prev_v_offset;
-
-            guint32 j;
-            for(j = 0; j < v_num; ++j)
-            {
-                moto_rman_node_write(render, 0, "%d ", mesh->f_verts16[prev_v_offset + j]);
-            }
-            moto_rman_node_write(render, 0, "]\n    [");
-        }
+    moto_rib_stream_request(rib, "ObjectBegin");
+    moto_rib_stream_int(rib, job->handle);
+    write_geometry(rib, job);
+    moto_rib_stream_request(rib, "ObjectEnd");
 
-        moto_rman_node_write(render, 0, "\"interpolateboundary\"] [0 0] [] []\n    \"P\" [");
+    moto_rib_stream_comment(rib, " Node '%s' of type '%s'",
+        moto_node_get_name(job->node), moto_node_get_type_name(job->node));
+    moto_rib_stream_request(rib, "AttributeBegin");
+    moto_rib_stream_request(rib, "Surface");
+    moto_rib_stream_string(rib, "plastic");
+    moto_rib_stream_request(rib, "ConcatTransform");
+    moto_rib_stream_matrix(rib, job->matrix);
 
-        // Points
-        for(i = 0; i < (mesh->v_num - 1); ++i)
-        {
-            moto_rman_node_write(render, 0, "%f %f %f ",
-                mesh->v_coords[i].x, mesh->v_coords[i].y, mesh->v_coords[i].z);
-        }
-        moto_rman_node_write(render, 0, "%f %f %f ]\n    \"N\" [",
-            mesh->v_coords[i].x, mesh->v_coords[i].y, mesh->v_coords[i].z);
+    gfloat m[16], color[4];
+    guint i;
+    for(i = 0; i < num; i++)
+    {
+        moto_instance_node_get_instance(node, i, m, color);
+
+        moto_rib_stream_request(rib, "AttributeBegin");
+        moto_rib_stream_request(rib, "ConcatTransform");
+        moto_rib_stream_matrix(rib, m);
+        moto_rib_stream_request(rib, "Color");
+        moto_rib_stream_float_array(rib, color, 1, 3, 0);
+        moto_rib_stream_request(rib, "ObjectInstance");
+        moto_rib_stream_int(rib, job->handle);
+        moto_rib_stream_request(rib, "AttributeEnd");
+    }
+
+    moto_rib_stream_request(rib, "AttributeEnd");
+}
 
-        // Normals
-        for(i = 0; i < (mesh->v_num - 1); ++i)
+static void write_object(MotoRibStream *rib, MotoRManJob *job)
+{
+    moto_rib_stream_comment(rib, " Node '%s' of type '%s'",
+        moto_node_get_name(job->node), moto_node_get_type_name(job->node));
+    moto_rib_stream_request(rib, "AttributeBegin");
+    moto_rib_stream_request(rib, "Surface");
+    moto_rib_stream_string(rib, "plastic");
+    moto_rib_stream_request(rib, "ConcatTransform");
+    moto_rib_stream_matrix(rib, job->matrix);
+    write_geometry(rib, job);
+    moto_rib_stream_request(rib, "AttributeEnd");
+}
+
+/* Doesn't touch scene or node state except reading, so may run in pool. */
+static void write_job(MotoRManJob *job)
+{
+    if(job->write_archive)
+    {
+        MotoRibStream *archive = moto_rib_stream_new(moto_rib_stream_is_binary(job->rib));
+        write_mesh(archive, job->mesh, job->subdiv);
+        if( ! moto_rib_stream_write_file(archive, job->archive))
         {
-            moto_rman_node_write(render, 0, "%f %f %f ",
-                mesh->v_normals[i].x, mesh->v_normals[i].y, mesh->v_normals[i].z);
+            g_free(job->archive);
+            job->archive = NULL;
         }
-        moto_rman_node_write(render, 0, "%f %f %f]\n",
-            mesh->v_normals[i].x, mesh->v_normals[i].y, mesh->v_normals[i].z);
+        moto_rib_stream_free(archive);
     }
+
+    if(MOTO_IS_INSTANCE_NODE(job->node))
+        write_instances(job->rib, job);
     else
-    {
-        moto_rman_node_write(render, 1, "PointsGeneralPolygons\n    [");
+        write_object(job->rib, job);
+}
 
-        guint32 i;
-        for(i = 0; i < (mesh->f_num - 1); ++i)
-            moto_rman_node_write(render, 0, "1 ", 1);
-        moto_rman_node_write(render, 0, "1]\n    [");
+static void write_job_in_pool(MotoRManJob *job, MotoRManNode *self)
+{
+    MotoRManNodePriv* priv = MOTO_RMAN_NODE_GET_PRIVATE(self);
 
-        guint32 prev_v_offset = 0;
-        for(i = 0; i < (mesh->f_num - 1); ++i)
-        {
-            guint32 v_offset = mesh->f_data16[i].v_offset;
-            moto_rman_node_write(render, 0, "%d ", v_offset - prev_v_offset);
-            prev_v_offset = v_offset;
-        }
-        moto_rman_node_write(render, 0, "%d]\n    [", mesh->f_data16[i].v_offset - prev_v_offset);
+    write_job(job);
 
-        prev_v_offset = 0;
-        i = 0;
-        for(; i < (mesh->f_num - 1); ++i)
-        {
-            guint32 v_offset = mesh->f_data16[i].v_offset;
-            guint32 v_num = v_offset - prev_v_offset;
-
-            guint32 j;
-            for(j = 0; j < v_num; ++j)
-            {
-                moto_rman_node_write(render, 0, "%d ", mesh->f_verts16[prev_v_offset + j]);
-            }
-            prev_v_offset = v_offset;
-        }
+    g_mutex_lock(priv->jobs_mutex);
+    job->done = TRUE;
+    g_cond_broadcast(priv->jobs_cond);
+    g_mutex_unlock(priv->jobs_mutex);
+}
 
-        {
-            guint32 v_offset = mesh->f_data16[i].v_offset;
-            guint32 v_num = v_offset - prev_v_offset;
-
-            guint32 j;
-            for(j = 0; j < v_num; ++j)
-            {
-                moto_rman_node_write(render, 0, "%d ", mesh->f_verts16[prev_v_offset + j]);
-            }
-            moto_rman_node_write(render, 0, "]\n    \"P\" [");
-        }
+static void flush_job(MotoRManNode *self, MotoRManJob *job)
+{
+    MotoRManNodePriv* priv = MOTO_RMAN_NODE_GET_PRIVATE(self);
 
-        // Points
-        for(i = 0; i < (mesh->v_num - 1); ++i)
-        {
-            moto_rman_node_write(render, 0, "%f %f %f ",
-                mesh->v_coords[i].x, mesh->v_coords[i].y, mesh->v_coords[i].z);
-        }
-        moto_rman_node_write(render, 0, "%f %f %f ]\n    \"N\" [",
-            mesh->v_coords[i].x, mesh->v_coords[i].y, mesh->v_coords[i].z);
+    g_mutex_lock(priv->jobs_mutex);
+    while( ! job->done)
+        g_cond_wait(priv->jobs_cond, priv->jobs_mutex);
+    g_mutex_unlock(priv->jobs_mutex);
 
-        // Normals
-        for(i = 0; i < (mesh->v_num - 1); ++i)
-        {
-            moto_rman_node_write(render, 0, "%f %f %f ",
-                mesh->v_normals[i].x, mesh->v_normals[i].y, mesh->v_normals[i].z);
-        }
-        moto_rman_node_write(render, 0, "%f %f %f]\n",
-            mesh->v_normals[i].x, mesh->v_normals[i].y, mesh->v_normals[i].z);
+    if( ! moto_rib_stream_write_to(job->rib, priv->out))
+        moto_error("Can't write geometry of node '%s'", moto_node_get_name(job->node));
+    fputc('\n', priv->out);
+
+    moto_rib_stream_free(job->rib);
+    g_free(job->archive);
+    g_slice_free(MotoRManJob, job);
+}
+
+/* Returns path of archive with geometry of shape node or NULL if geometry
+ * must be written inline. Animated shapes are never archived. Others are keyed
+ * by last_modified of the node: param timestamps record only user edits, not
+ * geometry produced by updates of upstream nodes. */
+static gchar *get_archive(MotoRManNode *self, MotoShapeNode *shape_node,
+        gboolean subdiv, gboolean *write)
+{
+    MotoNode *node = (MotoNode*)self;
+    MotoRManNodePriv* priv = MOTO_RMAN_NODE_GET_PRIVATE(self);
+
+    gboolean use_archives = TRUE;
+    moto_node_get_param_boolean(node, "use_archives", &use_archives);
+    if( ! use_archives || moto_node_is_animated((MotoNode*)shape_node))
+        return NULL;
+
+    guint id = moto_node_get_id((MotoNode*)shape_node);
+    const GTimeVal *modified = moto_node_get_last_modified((MotoNode*)shape_node);
+
+    MotoRManArchive *archive = g_hash_table_lookup(priv->archives, GUINT_TO_POINTER(id));
+    if( ! archive)
+    {
+        archive = g_slice_new(MotoRManArchive);
+        archive->stamp  = *modified;
+        archive->subdiv = subdiv;
+        archive->frame  = 0;
+        archive->path   = NULL;
+        g_hash_table_insert(priv->archives, GUINT_TO_POINTER(id), archive);
+    }
+    else if(archive->stamp.tv_sec != modified->tv_sec ||
+            archive->stamp.tv_usec != modified->tv_usec ||
+            archive->subdiv != subdiv)
+    {
+        archive->stamp  = *modified;
+        archive->subdiv = subdiv;
+        g_free(archive->path);
+        archive->path = NULL;
+        return NULL;
+    }
+
+    /* Archive scheduled in this frame may be not written yet. */
+    if(archive->path &&
+       (archive->frame == priv->frame || g_file_test(archive->path, G_FILE_TEST_EXISTS)))
+    {
+        *write = FALSE;
+        return g_strdup(archive->path);
     }
 
-    moto_rman_node_writeln(render, 0, "AttributeEnd");
+    const gchar *dir = "rib-archives";
+    moto_node_get_param_string(node, "archive_dir", &dir);
+    if(g_mkdir_with_parents(dir, 0755))
+    {
+        moto_warning("Can't create directory \"%s\" for RIB archives", dir);
+        return NULL;
+    }
 
+    g_free(archive->path);
+    archive->path  = g_strdup_printf("%s/shape%u.rib", dir, id);
+    archive->frame = priv->frame;
+    *write = TRUE;
+    return g_strdup(archive->path);
+}
+
+static gboolean collect_job(MotoSceneNode *scene_node, MotoNode *node, GPtrArray *jobs)
+{
+    MotoRManNode *render = (MotoRManNode *)g_ptr_array_index(jobs, 0);
+    MotoRManNodePriv* priv = MOTO_RMAN_NODE_GET_PRIVATE(render);
+
+    MotoShapeNode* shape_node = moto_object_node_get_shape((MotoObjectNode*)node);
+    if(!shape_node)
+        return TRUE;
+
+    MotoShape* shape = moto_shape_node_get_shape(shape_node);
+    if(!shape || !MOTO_IS_MESH(shape))
+        return TRUE;
+
+    gboolean binary = FALSE;
+    moto_node_get_param_boolean((MotoNode*)render, "binary", &binary);
+
+    MotoRManJob *job = g_slice_new(MotoRManJob);
+    job->node = node;
+    job->mesh = (MotoMesh*)shape;
+    job->subdiv = FALSE;
+    moto_node_get_param_boolean((MotoNode*)shape_node, "subdiv_render", &job->subdiv);
+
+    /* Matrices are cached lazily so they're taken in main thread. */
+    memcpy(job->matrix, moto_object_node_get_matrix((MotoObjectNode*)node, TRUE), sizeof(job->matrix));
+    job->handle = (MOTO_IS_INSTANCE_NODE(node)) ? ++priv->objects_num : 0;
+
+    job->write_archive = FALSE;
+    job->archive = get_archive(render, shape_node, job->subdiv, & job->write_archive);
+
+    job->rib = moto_rib_stream_new(binary);
+    job->done = FALSE;
+
+    g_ptr_array_add(jobs, job);
     return TRUE;
 }
 
-static gboolean moto_rman_node_render(MotoRenderNode *self)
+/* Objects are serialised in parallel and written in order of scene. Number of
+ * chunks held in memory is limited by window. */
+static void export_objects(MotoRManNode *self, MotoSceneNode *scene_node)
 {
-    MotoNode* node = (MotoNode*)self;
-    MotoRManNode* rman = (MotoRManNode*)self;
     MotoRManNodePriv* priv = MOTO_RMAN_NODE_GET_PRIVATE(self);
-    if(priv->out)
+
+    GPtrArray *jobs = g_ptr_array_new();
+    g_ptr_array_add(jobs, self);
+    moto_scene_node_foreach_node(scene_node, MOTO_TYPE_OBJECT_NODE,
+        (MotoSceneNodeForeachNodeFunc)collect_job, jobs);
+
+    gint threads = 4;
+    moto_node_get_param_int((MotoNode*)self, "threads", &threads);
+
+    GThreadPool *pool = NULL;
+    if(threads > 1 && jobs->len > 2)
     {
-        fclose(priv->out);
-        priv->out = NULL;
+        if( ! priv->pool)
+            priv->pool = g_thread_pool_new((GFunc)write_job_in_pool, self, threads, FALSE, NULL);
+        else
+            g_thread_pool_set_max_threads(priv->pool, threads, NULL);
+        pool = priv->pool;
+    }
+
+    guint window = (pool) ? threads*4 : 1;
+    guint pushed = 1, written = 1;
+    for(; pushed < jobs->len; pushed++)
+    {
+        MotoRManJob *job = (MotoRManJob *)g_ptr_array_index(jobs, pushed);
+        if(pool)
+            g_thread_pool_push(pool, job, NULL);
+        else
+        {
+            write_job(job);
+            job->done = TRUE;
+        }
+
+        while(pushed + 1 - written >= window)
+            flush_job(self, (MotoRManJob *)g_ptr_array_index(jobs, written++));
     }
+    while(written < jobs->len)
+        flush_job(self, (MotoRManJob *)g_ptr_array_index(jobs, written++));
 
+    g_ptr_array_free(jobs, TRUE);
+}
+
+static MotoSceneNode *get_scene(MotoRManNode *self)
+{
+    MotoNode *node = (MotoNode*)self;
     MotoSceneNode *scene_node = (MotoSceneNode*)moto_node_get_parent(node);
     while(scene_node && !MOTO_IS_SCENE_NODE(scene_node))
     {
@@ -413,16 +687,42 @@ static gboolean moto_rman_node_render(MotoRenderNode *self)
     }
 
     if(!scene_node || !MOTO_IS_SCENE_NODE(scene_node))
+        return NULL;
+    return scene_node;
+}
+
+/* Header and lights are written as ASCII, binary encoded chunks of objects
+ * may be mixed with them. */
+static gboolean export_frame(MotoRManNode *rman, MotoSceneNode *scene_node,
+        const gchar *filename, guint frame, gboolean framebuffer)
+{
+    MotoNode* node = (MotoNode*)rman;
+    MotoRManNodePriv* priv = MOTO_RMAN_NODE_GET_PRIVATE(rman);
+    if(priv->out)
+    {
+        fclose(priv->out);
+        priv->out = NULL;
+    }
+
+    priv->out = fopen(filename, "wb");
+    if(!priv->out)
+    {
+        moto_error("Can't open file \"%s\" for writing", filename);
         return FALSE;
+    }
+    priv->objects_num = 0;
+    priv->frame++;
 
     MotoObjectNode* camera = moto_scene_node_get_camera(scene_node);
 
-    priv->out = fopen("last-render.rib", "wb");
-
-    moto_rman_node_writeln(rman, 0, "# Moto last render");
+    moto_rman_node_writeln(rman, 0, "# Moto frame %u", frame);
 
-    moto_rman_node_writeln(rman, 0, "Display \"last-render.tiff\" \"file\" \"rgb\"");
-    moto_rman_node_writeln(rman, 0, "Display \"+last-render\" \"framebuffer\" \"rgb\"");
+    gchar *image = (g_str_has_suffix(filename, ".rib")) ? \
+        g_strndup(filename, strlen(filename) - 4) : g_strdup(filename);
+    moto_rman_node_writeln(rman, 0, "Display \"%s.tiff\" \"file\" \"rgb\"", image);
+    if(framebuffer)
+        moto_rman_node_writeln(rman, 0, "Display \"+%s\" \"framebuffer\" \"rgb\"", image);
+    g_free(image);
 
     gint size[2];
     moto_node_get_param_2iv(node, "size", size);
@@ -491,21 +791,84 @@ static gboolean moto_rman_node_render(MotoRenderNode *self)
                 m[8], m[9], m[10], m[11], m[12], m[13], m[14], m[15]);
     }
 
-    moto_rman_node_writeln(rman, 0, "FrameBegin 1");
+    moto_rman_node_writeln(rman, 0, "FrameBegin %u", frame);
     moto_rman_node_writeln(rman, 0, "WorldBegin");
 
     moto_scene_node_foreach_node(scene_node, MOTO_TYPE_OBJECT_NODE,
         (MotoSceneNodeForeachNodeFunc)export_light, rman);
 
-    moto_scene_node_foreach_node(scene_node, MOTO_TYPE_OBJECT_NODE,
-        (MotoSceneNodeForeachNodeFunc)export_object, rman);
+    export_objects(rman, scene_node);
 
     moto_rman_node_writeln(rman, 0, "WorldEnd");
     moto_rman_node_writeln(rman, 0, "FrameEnd");
 
-    fclose(priv->out);
+    gboolean ok = ! ferror(priv->out);
+    if(fclose(priv->out) || ! ok)
+    {
+        moto_error("Can't write file \"%s\"", filename);
+        ok = FALSE;
+    }
     priv->out = NULL;
 
+    return ok;
+}
+
+guint moto_rman_node_export_range(MotoRManNode *self,
+        gfloat start, gfloat end, gfloat step, const gchar *pattern)
+{
+    if(step <= 0)
+    {
+        moto_error("Step of frame range must be positive (%f)", step);
+        return 0;
+    }
+
+    MotoSceneNode *scene_node = get_scene(self);
+    if(!scene_node)
+    {
+        moto_error("Render node '%s' isn't in scene", moto_node_get_name((MotoNode*)self));
+        return 0;
+    }
+
+    guint frames = 0;
+    gfloat time;
+    for(time = start; time <= end + step*0.001; time = start + frames*step)
+    {
+        moto_scene_node_set_current_time(scene_node, time);
+        moto_scene_node_update(scene_node);
+
+        frames++;
+        gchar *filename = g_strdup_printf(pattern, frames);
+        gboolean ok = export_frame(self, scene_node, filename, frames, FALSE);
+        g_free(filename);
+        if( ! ok)
+        {
+            frames--;
+            break;
+        }
+    }
+
+    return frames;
+}
+
+static gboolean moto_rman_node_render(MotoRenderNode *self)
+{
+    MotoNode* node = (MotoNode*)self;
+    MotoRManNode* rman = (MotoRManNode*)self;
+
+    MotoSceneNode *scene_node = get_scene(rman);
+    if(!scene_node)
+        return FALSE;
+
+    const gchar *output = "last-render.rib";
+    moto_node_get_param_string(node, "output", &output);
+    gchar *filename = g_strdup(output);
+
+    if( ! export_frame(rman, scene_node, filename, 1, TRUE))
+    {
+        g_free(filename);
+        return FALSE;
+    }
+
     GString* command = g_string_new("renderdl");
 
     gboolean use_custom_command = FALSE;
@@ -519,12 +882,13 @@ static gboolean moto_rman_node_render(MotoRenderNode *self)
     }
 
     GString* command_full = g_string_new("");
-    g_string_printf(command_full, "%s last-render.rib", command->str);
+    g_string_printf(command_full, "%s %s", command->str, filename);
 
     system(command_full->str);
 
     g_string_free(command, TRUE);
     g_string_free(command_full, TRUE);
+    g_free(filename);
 
     // moto_render_node_update_last_render_time(self);
 
@@ -63,6 +63,12 @@ GType moto_rman_node_get_type(void);
 
 MotoRManNode *moto_rman_node_new(const gchar *name);
 
+/* Writes RIB file per frame of range. Pattern gets frame number starting from 1,
+ * e.g. "frame.%04d.rib". Unchanged shapes are written once into archives and
+ * referenced from following frames. Returns number of written frames. */
+guint moto_rman_node_export_range(MotoRManNode *self,
+        gfloat start, gfloat end, gfloat step, const gchar *pattern);
+
 G_END_DECLS
 
 #endif /* __MOTO_RMAN_NODE_H__ */
@@ -0,0 +1,1458 @@
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "moto-messager.h"
+#include "moto-mesh.h"
+#include "moto-shape-node.h"
+#include "moto-object-node.h"
+#include "moto-op-node.h"
+#include "moto-time-node.h"
+#include "moto-library.h"
+#include "moto-reference-node.h"
+#include "moto-scene-dump.h"
+#include "moto-profiler.h"
+
+#define DUMP_MAGIC "MOTOSCN"
+#define DUMP_VERSION 3
+#define DUMP_BYTE_ORDER 0x01020304
+/* Meshes are aligned so vectors may be used right from mapped memory. */
+#define DUMP_SECTION_ALIGN 64
+
+#define DUMP_SCENE_ROOT -1
+#define DUMP_SCENE_TIME -2
+
+enum
+{
+    SECTION_NODES = 1,
+    SECTION_LINKS,
+    SECTION_MESH,
+    SECTION_REF_LINKS,
+};
+
+typedef struct _MotoDumpHeader
+{
+    gchar magic[8];
+    guint32 version;
+    guint32 byte_order;
+    guint32 sections_num;
+    guint32 reserved;
+    guint64 directory;
+} MotoDumpHeader;
+
+typedef struct _MotoDumpSection
+{
+    guint32 kind;
+    guint32 node; /* Index in node table for meshes. */
+    guint64 offset;
+    guint64 size;
+    guint32 checksum;
+    guint32 reserved;
+} MotoDumpSection;
+
+/* Mapped file shared by lazy shapes and save cache. */
+typedef struct _MotoDumpFile
+{
+    gint ref_count;
+    GMappedFile *mapped;
+    const guint8 *data;
+    gsize size;
+    guint32 version; /* Sections are decoded by version of file. */
+} MotoDumpFile;
+
+/* Mesh section which is still valid for node. */
+typedef struct _MotoDumpShape
+{
+    GTimeVal stamp; /* last_modified of node */
+    MotoDumpFile *file;
+    MotoDumpSection section;
+} MotoDumpShape;
+
+#define DUMP_CACHE_KEY "moto-scene-dump-cache"
+#define DUMP_SOURCE_KEY "moto-scene-dump-source"
+#define DUMP_REF_LINKS_KEY "moto-scene-dump-ref-links"
+
+static MotoDumpFile *dump_file_ref(MotoDumpFile *file)
+{
+    g_atomic_int_inc(& file->ref_count);
+    return file;
+}
+
+static void dump_file_unref(MotoDumpFile *file)
+{
+    if( ! g_atomic_int_dec_and_test(& file->ref_count))
+        return;
+    g_mapped_file_free(file->mapped);
+    g_slice_free(MotoDumpFile, file);
+}
+
+static MotoDumpFile *dump_file_open(const gchar *filename)
+{
+    GError *error = NULL;
+    GMappedFile *mapped = g_mapped_file_new(filename, FALSE, & error);
+    if( ! mapped)
+    {
+        moto_error("Can't open scene dump \"%s\": %s", filename, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    MotoDumpFile *file = g_slice_new(MotoDumpFile);
+    file->ref_count = 1;
+    file->mapped = mapped;
+    file->data = (const guint8 *)g_mapped_file_get_contents(mapped);
+    file->size = g_mapped_file_get_length(mapped);
+    file->version = (file->size < sizeof(MotoDumpHeader)) ? 0 : ((const MotoDumpHeader *)file->data)->version;
+    return file;
+}
+
+static MotoDumpShape *dump_shape_new(MotoNode *node, MotoDumpFile *file, MotoDumpSection *section)
+{
+    MotoDumpShape *shape = g_slice_new(MotoDumpShape);
+    shape->stamp   = *moto_node_get_last_modified(node);
+    shape->file    = dump_file_ref(file);
+    shape->section = *section;
+    return shape;
+}
+
+static void dump_shape_free(MotoDumpShape *shape)
+{
+    dump_file_unref(shape->file);
+    g_slice_free(MotoDumpShape, shape);
+}
+
+/* Node id -> MotoDumpShape. Kept with scene between saves. */
+static GHashTable *get_cache(MotoSceneNode *scene)
+{
+    GHashTable *cache = g_object_get_data((GObject *)scene, DUMP_CACHE_KEY);
+    if( ! cache)
+    {
+        cache = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+            NULL, (GDestroyNotify)dump_shape_free);
+        g_object_set_data_full((GObject *)scene, DUMP_CACHE_KEY, cache,
+            (GDestroyNotify)g_hash_table_destroy);
+    }
+    return cache;
+}
+
+/* End of link in node which is loaded by reference. Node is the saved one,
+ * reference itself or any node outside of references, path has names of
+ * nodes from it down to the linked one. */
+typedef struct _MotoDumpRefEnd
+{
+    guint node; /* id */
+    gchar **path;
+    gchar *param;
+} MotoDumpRefEnd;
+
+typedef struct _MotoDumpRefLink
+{
+    MotoDumpRefEnd dst;
+    MotoDumpRefEnd src;
+} MotoDumpRefLink;
+
+/* Links into references which aren't loaded yet. Kept with scene,
+ * so they are restored by loading of reference and saved again if it's never loaded. */
+typedef struct _MotoDumpRefLinks
+{
+    GSList *links;
+} MotoDumpRefLinks;
+
+static void ref_link_free(MotoDumpRefLink *link)
+{
+    g_strfreev(link->dst.path);
+    g_free(link->dst.param);
+    g_strfreev(link->src.path);
+    g_free(link->src.param);
+    g_slice_free(MotoDumpRefLink, link);
+}
+
+static void ref_links_free(MotoDumpRefLinks *links)
+{
+    g_slist_foreach(links->links, (GFunc)ref_link_free, NULL);
+    g_slist_free(links->links);
+    g_slice_free(MotoDumpRefLinks, links);
+}
+
+static MotoDumpRefLinks *get_ref_links(MotoSceneNode *scene)
+{
+    MotoDumpRefLinks *links = g_object_get_data((GObject *)scene, DUMP_REF_LINKS_KEY);
+    if( ! links)
+    {
+        links = g_slice_new(MotoDumpRefLinks);
+        links->links = NULL;
+        g_object_set_data_full((GObject *)scene, DUMP_REF_LINKS_KEY, links,
+            (GDestroyNotify)ref_links_free);
+    }
+    return links;
+}
+
+static void collect_ids(MotoNode *node, GHashTable *nodes)
+{
+    GList *l = moto_node_get_children(node);
+    for(; l; l = g_list_next(l))
+    {
+        MotoNode *child = (MotoNode *)l->data;
+        g_hash_table_insert(nodes, GUINT_TO_POINTER(moto_node_get_id(child)), child);
+        collect_ids(child, nodes);
+    }
+}
+
+/* Node id -> node for all nodes of scene. */
+static GHashTable *get_nodes_by_id(MotoSceneNode *scene)
+{
+    GHashTable *nodes = g_hash_table_new(g_direct_hash, g_direct_equal);
+    MotoNode *time_node = (MotoNode *)moto_scene_node_get_time_node(scene);
+    g_hash_table_insert(nodes, GUINT_TO_POINTER(moto_node_get_id(time_node)), time_node);
+    collect_ids((MotoNode *)scene, nodes);
+    return nodes;
+}
+
+/* FNV-1a */
+static guint32 checksum(const guint8 *data, gsize size)
+{
+    guint32 h = 2166136261u;
+    const guint8 *end = data + size;
+    for(; data < end; data++)
+        h = (h ^ *data) * 16777619u;
+    return h;
+}
+
+static void append_uint(GByteArray *a, guint32 v)
+{
+    g_byte_array_append(a, (const guint8 *)& v, sizeof(v));
+}
+
+static void append_padded(GByteArray *a, gconstpointer data, gsize size)
+{
+    static const guint8 zero[4] = {0, 0, 0, 0};
+    g_byte_array_append(a, data, size);
+    if(size % 4)
+        g_byte_array_append(a, zero, 4 - size % 4);
+}
+
+static void append_string(GByteArray *a, const gchar *str)
+{
+    guint32 len = strlen(str);
+    append_uint(a, len);
+    append_padded(a, str, len);
+}
+
+typedef struct _MotoDumpReader
+{
+    const guint8 *data;
+    const guint8 *end;
+} MotoDumpReader;
+
+static gboolean read_uint(MotoDumpReader *r, guint32 *v)
+{
+    if(r->data + sizeof(guint32) > r->end)
+        return FALSE;
+    memcpy(v, r->data, sizeof(guint32));
+    r->data += sizeof(guint32);
+    return TRUE;
+}
+
+static gboolean read_bytes(MotoDumpReader *r, guint32 size, const guint8 **bytes)
+{
+    gsize padded = (size + 3) & ~(gsize)3;
+    if(padded > (gsize)(r->end - r->data))
+        return FALSE;
+    *bytes = r->data;
+    r->data += padded;
+    return TRUE;
+}
+
+static gchar *read_string(MotoDumpReader *r)
+{
+    guint32 len;
+    const guint8 *bytes;
+    if( ! read_uint(r, & len) || ! read_bytes(r, len, & bytes))
+        return NULL;
+    return g_strndup((const gchar *)bytes, len);
+}
+
+/* Mesh section:
+ *   guint32 v_num, e_num, f_num, f_v_num
+ *   v_num * {gfloat x, y, z, w}
+ *   f_num * guint32 v_offset
+ *   f_v_num * guint32 vertex
+ * Since version 2:
+ *   guint32 flags, blocks of MESH_HAS_* flags in this order:
+ *     e_num * {guint32 a, b}     edges which flags and creases below belong to
+ *     (e_num/32 + 1) * guint32   hard flags of edges
+ *     e_num * gfloat             creases
+ *     (f_num/32 + 1) * guint32   hidden flags of faces
+ *     v_num * {gfloat x, y, z, w} normals
+ *   guint32 attrs_num, attrs_num * {string name, guint32 type, domain, chnum, num,
+ *     chnum * padded channel} */
+enum
+{
+    MESH_HAS_EDGES   = 1 << 0,
+    MESH_HAS_HARD    = 1 << 1,
+    MESH_HAS_CREASES = 1 << 2,
+    MESH_HAS_HIDDEN  = 1 << 3,
+    MESH_HAS_NORMALS = 1 << 4
+};
+
+static gboolean has_set_flags(const guint32 *flags, guint32 num)
+{
+    guint32 i;
+    if( ! flags)
+        return FALSE;
+    for(i = 0; i < num/32 + 1; i++)
+        if(flags[i])
+            return TRUE;
+    return FALSE;
+}
+
+static guint32 get_mesh_flags(MotoMesh *mesh)
+{
+    guint32 flags = 0;
+    if(mesh->e_num && has_set_flags(mesh->e_hard_flags, mesh->e_num))
+        flags |= MESH_HAS_HARD;
+    if(mesh->e_num && mesh->e_use_creases && mesh->e_creases)
+        flags |= MESH_HAS_CREASES;
+    if(flags)
+        flags |= MESH_HAS_EDGES;
+    if(mesh->f_use_hidden && has_set_flags(mesh->f_hidden_flags, mesh->f_num))
+        flags |= MESH_HAS_HIDDEN;
+    if(mesh->v_normals || moto_mesh_is_packed(mesh))
+        flags |= MESH_HAS_NORMALS;
+    return flags;
+}
+
+static void encode_attrs(MotoMesh *mesh, GByteArray *a)
+{
+    guint i, ch, num = 0;
+    for(i = 0; i < mesh->attrs->len; i++)
+        if(g_ptr_array_index(mesh->attrs, i))
+            num++;
+    append_uint(a, num);
+
+    for(i = 0; i < mesh->attrs->len; i++)
+    {
+        MotoMeshAttr *attr = (MotoMeshAttr *)g_ptr_array_index(mesh->attrs, i);
+        if( ! attr)
+            continue;
+
+        append_string(a, g_quark_to_string(attr->name));
+        append_uint(a, attr->type);
+        append_uint(a, attr->domain);
+        append_uint(a, attr->chnum);
+        append_uint(a, attr->num);
+        for(ch = 0; ch < attr->chnum; ch++)
+            append_padded(a, moto_mesh_attr_channel(attr, ch),
+                attr->num*moto_mesh_attr_type_size(attr->type));
+    }
+}
+
+static void encode_mesh(MotoMesh *mesh, GByteArray *a)
+{
+    guint32 i;
+
+    append_uint(a, mesh->v_num);
+    append_uint(a, mesh->e_num);
+    append_uint(a, mesh->f_num);
+    append_uint(a, mesh->f_v_num);
+
+    MotoVector *normals = NULL;
+    if(moto_mesh_is_packed(mesh))
+    {
+        MotoVector *coords = g_new(MotoVector, mesh->v_num);
+        normals = g_new0(MotoVector, mesh->v_num);
+        moto_mesh_decode_verts(mesh, 0, mesh->v_num, (gfloat *)coords, sizeof(MotoVector),
+            (gfloat *)normals, sizeof(MotoVector));
+        for(i = 0; i < mesh->v_num; i++)
+            coords[i].w = 1;
+        g_byte_array_append(a, (const guint8 *)coords, mesh->v_num*sizeof(MotoVector));
+        g_free(coords);
+    }
+    else
+        g_byte_array_append(a, (const guint8 *)mesh->v_coords, mesh->v_num*sizeof(MotoVector));
+
+    for(i = 0; i < mesh->f_num; i++)
+        append_uint(a, (mesh->b32) ? mesh->f_data32[i].v_offset : mesh->f_data16[i].v_offset);
+
+    if(mesh->b32)
+        g_byte_array_append(a, (const guint8 *)mesh->f_verts32, mesh->f_v_num*sizeof(guint32));
+    else
+        for(i = 0; i < mesh->f_v_num; i++)
+            append_uint(a, mesh->f_verts16[i]);
+
+    guint32 flags = get_mesh_flags(mesh);
+    append_uint(a, flags);
+
+    if(flags & MESH_HAS_EDGES)
+    {
+        if(mesh->b32)
+            g_byte_array_append(a, (const guint8 *)mesh->e_verts32, mesh->e_num*2*sizeof(guint32));
+        else
+            for(i = 0; i < mesh->e_num*2; i++)
+                append_uint(a, mesh->e_verts16[i]);
+    }
+    if(flags & MESH_HAS_HARD)
+        g_byte_array_append(a, (const guint8 *)mesh->e_hard_flags, (mesh->e_num/32 + 1)*sizeof(guint32));
+    if(flags & MESH_HAS_CREASES)
+        g_byte_array_append(a, (const guint8 *)mesh->e_creases, mesh->e_num*sizeof(gfloat));
+    if(flags & MESH_HAS_HIDDEN)
+        g_byte_array_append(a, (const guint8 *)mesh->f_hidden_flags, (mesh->f_num/32 + 1)*sizeof(guint32));
+    if(flags & MESH_HAS_NORMALS)
+        g_byte_array_append(a, (const guint8 *)((normals) ? normals : mesh->v_normals),
+            mesh->v_num*sizeof(MotoVector));
+    g_free(normals);
+
+    encode_attrs(mesh, a);
+}
+
+/* Edges are built again by prepare, so edge data is matched by its verts.
+ * Element i of result is index in saved edges or G_MAXUINT32. */
+static guint32 *get_edge_map(MotoMesh *mesh, const guint32 *e_verts)
+{
+    guint32 *first = g_new(guint32, mesh->v_num);
+    guint32 *next  = g_new(guint32, mesh->e_num);
+    guint32 *map   = g_new(guint32, mesh->e_num);
+    guint32 i;
+
+    for(i = 0; i < mesh->v_num; i++)
+        first[i] = G_MAXUINT32;
+    for(i = 0; i < mesh->e_num; i++)
+    {
+        guint32 a = MIN(e_verts[i*2], e_verts[i*2+1]);
+        next[i] = first[a];
+        first[a] = i;
+    }
+
+    for(i = 0; i < mesh->e_num; i++)
+    {
+        guint32 va = (mesh->b32) ? mesh->e_verts32[i*2]   : mesh->e_verts16[i*2];
+        guint32 vb = (mesh->b32) ? mesh->e_verts32[i*2+1] : mesh->e_verts16[i*2+1];
+        guint32 a = MIN(va, vb), b = MAX(va, vb), ei;
+
+        map[i] = G_MAXUINT32;
+        for(ei = first[a]; ei != G_MAXUINT32; ei = next[ei])
+            if(MAX(e_verts[ei*2], e_verts[ei*2+1]) == b)
+            {
+                map[i] = ei;
+                break;
+            }
+    }
+
+    g_free(first);
+    g_free(next);
+    return map;
+}
+
+static gboolean decode_edges(MotoMesh *mesh, MotoDumpReader *r, guint32 flags)
+{
+    const guint8 *e_verts = NULL, *hard = NULL, *creases = NULL;
+    guint32 i;
+
+    if((flags & MESH_HAS_EDGES) && ! read_bytes(r, mesh->e_num*2*sizeof(guint32), & e_verts))
+        return FALSE;
+    if((flags & MESH_HAS_HARD) && ! read_bytes(r, (mesh->e_num/32 + 1)*sizeof(guint32), & hard))
+        return FALSE;
+    if((flags & MESH_HAS_CREASES) && ! read_bytes(r, mesh->e_num*sizeof(gfloat), & creases))
+        return FALSE;
+    if( ! e_verts)
+        return ! hard && ! creases;
+
+    for(i = 0; i < mesh->e_num*2; i++)
+        if(((const guint32 *)e_verts)[i] >= mesh->v_num)
+            return FALSE;
+
+    guint32 *map = get_edge_map(mesh, (const guint32 *)e_verts);
+
+    if(creases)
+    {
+        g_free(mesh->e_creases);
+        mesh->e_creases = g_new0(gfloat, mesh->e_num);
+        mesh->e_use_creases = TRUE;
+    }
+
+    for(i = 0; i < mesh->e_num; i++)
+    {
+        guint32 ei = map[i];
+        if(G_MAXUINT32 == ei)
+            continue;
+        if(hard && (((const guint32 *)hard)[ei/32] & (1u << (ei%32))))
+            mesh->e_hard_flags[i/32] |= 1u << (i%32);
+        if(creases)
+            mesh->e_creases[i] = ((const gfloat *)creases)[ei];
+    }
+
+    g_free(map);
+    return TRUE;
+}
+
+static gboolean decode_attrs(MotoMesh *mesh, MotoDumpReader *r)
+{
+    guint32 num, i, ch;
+    if( ! read_uint(r, & num))
+        return FALSE;
+
+    for(i = 0; i < num; i++)
+    {
+        gchar *name = read_string(r);
+        guint32 type, domain, chnum, elems;
+        if( ! name || ! read_uint(r, & type) || ! read_uint(r, & domain) ||
+            ! read_uint(r, & chnum) || ! read_uint(r, & elems) ||
+            type > MOTO_MESH_ATTR_BYTE || domain > MOTO_MESH_ATTR_FACE_VERT)
+        {
+            g_free(name);
+            return FALSE;
+        }
+
+        MotoMeshAttr *attr = moto_mesh_get_attr(mesh,
+            moto_mesh_add_attr(mesh, name, (MotoMeshAttrType)type, (MotoMeshAttrDomain)domain, chnum));
+        g_free(name);
+        if( ! attr || attr->num != elems)
+            return FALSE;
+
+        gsize size = elems*moto_mesh_attr_type_size(attr->type);
+        for(ch = 0; ch < chnum; ch++)
+        {
+            const guint8 *bytes;
+            if( ! read_bytes(r, size, & bytes))
+                return FALSE;
+            memcpy(moto_mesh_attr_channel(attr, ch), bytes, size);
+        }
+    }
+    return TRUE;
+}
+
+/* Fields after verts, which are in sections of version 2 and later. */
+static gboolean decode_mesh_data(MotoMesh *mesh, MotoDumpReader *r)
+{
+    guint32 flags;
+    const guint8 *bytes;
+
+    if( ! read_uint(r, & flags) || ! decode_edges(mesh, r, flags))
+        return FALSE;
+
+    if(flags & MESH_HAS_HIDDEN)
+    {
+        gsize size = (mesh->f_num/32 + 1)*sizeof(guint32);
+        if( ! read_bytes(r, size, & bytes))
+            return FALSE;
+        g_free(mesh->f_hidden_flags);
+        mesh->f_hidden_flags = (guint32 *)g_memdup(bytes, size);
+        mesh->f_use_hidden = TRUE;
+    }
+
+    if(flags & MESH_HAS_NORMALS)
+    {
+        if( ! read_bytes(r, mesh->v_num*sizeof(MotoVector), & bytes))
+            return FALSE;
+        memcpy(mesh->v_normals, bytes, mesh->v_num*sizeof(MotoVector));
+    }
+
+    return decode_attrs(mesh, r) && r->data == r->end;
+}
+
+static MotoMesh *decode_mesh(const guint8 *data, gsize size, guint32 version)
+{
+    const guint32 *h = (const guint32 *)data;
+    if(size < 4*sizeof(guint32))
+        return NULL;
+
+    guint32 v_num = h[0], e_num = h[1], f_num = h[2], f_v_num = h[3];
+    gsize coords_size = (gsize)v_num*sizeof(MotoVector);
+    gsize base_size = 4*sizeof(guint32) + coords_size + ((gsize)f_num + f_v_num)*sizeof(guint32);
+    if((version < 2) ? size != base_size : size < base_size)
+        return NULL;
+
+    MotoMesh *mesh = moto_mesh_new(v_num, e_num, f_num, f_v_num);
+    if( ! mesh)
+        return NULL;
+
+    memcpy(mesh->v_coords, h + 4, coords_size);
+
+    const guint32 *offsets = (const guint32 *)(data + 4*sizeof(guint32) + coords_size);
+    guint32 *verts = (guint32 *)(offsets + f_num);
+
+    guint32 fi, start = 0;
+    for(fi = 0; fi < f_num; fi++)
+    {
+        if(offsets[fi] <= start || offsets[fi] > f_v_num ||
+           ! moto_mesh_set_face(mesh, fi, offsets[fi], verts + start))
+        {
+            g_object_unref(mesh);
+            return NULL;
+        }
+        start = offsets[fi];
+    }
+
+    if( ! moto_mesh_prepare(mesh))
+    {
+        g_object_unref(mesh);
+        return NULL;
+    }
+
+    MotoDumpReader r = {data + base_size, data + size};
+    if(version >= 2 && ! decode_mesh_data(mesh, & r))
+    {
+        g_object_unref(mesh);
+        return NULL;
+    }
+
+    return mesh;
+}
+
+typedef struct _MotoDumpLazyShape
+{
+    MotoDumpFile *file;
+    MotoDumpSection section;
+} MotoDumpLazyShape;
+
+static void free_lazy_shape(MotoDumpLazyShape *lazy)
+{
+    dump_file_unref(lazy->file);
+    g_slice_free(MotoDumpLazyShape, lazy);
+}
+
+static MotoDumpLazyShape *lazy_shape_copy(MotoDumpLazyShape *lazy)
+{
+    MotoDumpLazyShape *copy = g_slice_new(MotoDumpLazyShape);
+    copy->file    = dump_file_ref(lazy->file);
+    copy->section = lazy->section;
+    return copy;
+}
+
+/* Key of mesh in asset cache of library. Checksum is already in directory,
+ * so candidates are found without reading meshes, see is_mesh_of_section. */
+static gchar *get_mesh_hash(MotoDumpLazyShape *lazy)
+{
+    const guint32 *h = (const guint32 *)(lazy->file->data + lazy->section.offset);
+    if(lazy->section.size < 4*sizeof(guint32))
+        return NULL;
+
+    return g_strdup_printf("mesh-%08x-%lu-%u-%u", lazy->section.checksum,
+        (gulong)lazy->section.size, h[0], h[3]);
+}
+
+/* Shared mesh keeps section it's decoded from, so key is never trusted alone. */
+static gboolean is_mesh_of_section(MotoMesh *mesh, MotoDumpLazyShape *lazy)
+{
+    MotoDumpLazyShape *source = g_object_get_data((GObject *)mesh, DUMP_SOURCE_KEY);
+    if( ! source || source->section.size != lazy->section.size)
+        return FALSE;
+    if(source->file == lazy->file && source->section.offset == lazy->section.offset)
+        return TRUE;
+
+    return ! memcmp(source->file->data + source->section.offset,
+        lazy->file->data + lazy->section.offset, lazy->section.size);
+}
+
+static void materialize_mesh(MotoParam *param, GValue *value, MotoDumpLazyShape *lazy)
+{
+    MotoNode *node = moto_param_get_node(param);
+    MotoLibrary *lib = moto_node_get_library(node);
+    gchar *hash = (lib) ? get_mesh_hash(lazy) : NULL;
+
+    MotoMesh *mesh = (hash) ? (MotoMesh *)moto_library_get_asset(lib, hash) : NULL;
+    if(mesh && ! is_mesh_of_section(mesh, lazy))
+    {
+        /* Different mesh with the same key, this one isn't shared. */
+        g_object_unref(mesh);
+        mesh = NULL;
+        g_free(hash);
+        hash = NULL;
+    }
+
+    if( ! mesh)
+    {
+        const guint8 *data = lazy->file->data + lazy->section.offset;
+        gsize size = lazy->section.size;
+
+        if(checksum(data, size) == lazy->section.checksum)
+            mesh = decode_mesh(data, size, lazy->file->version);
+
+        if( ! mesh)
+        {
+            moto_error("Shape of node '%s' in scene dump is corrupted", moto_node_get_name(node));
+            g_free(hash);
+            return;
+        }
+
+        if(hash)
+        {
+            g_object_set_data_full((GObject *)mesh, DUMP_SOURCE_KEY,
+                lazy_shape_copy(lazy), (GDestroyNotify)free_lazy_shape);
+
+            /* Other thread may add the same key first. */
+            MotoMesh *shared = (MotoMesh *)moto_library_add_asset(lib, hash, (GObject *)mesh);
+            if(shared != mesh && is_mesh_of_section(shared, lazy))
+            {
+                g_object_unref(mesh);
+                mesh = shared;
+            }
+            else
+                g_object_unref(shared);
+        }
+    }
+
+    g_value_set_object(value, mesh);
+    g_object_unref(mesh);
+    g_free(hash);
+}
+
+/* Saving */
+
+typedef struct _MotoDumpWriter
+{
+    FILE *out;
+    guint64 pos;
+    GArray *sections;
+    gboolean ok;
+} MotoDumpWriter;
+
+static void write_bytes(MotoDumpWriter *w, gconstpointer data, gsize size)
+{
+    if(w->ok && size)
+        w->ok = (fwrite(data, size, 1, w->out) == 1);
+    w->pos += size;
+}
+
+static void write_align(MotoDumpWriter *w, gsize align)
+{
+    static const guint8 zero[DUMP_SECTION_ALIGN] = {0,};
+    gsize pad = (align - w->pos % align) % align;
+    write_bytes(w, zero, pad);
+}
+
+static void write_section(MotoDumpWriter *w, guint32 kind, guint32 node,
+        const guint8 *data, gsize size, guint32 sum)
+{
+    write_align(w, DUMP_SECTION_ALIGN);
+
+    MotoDumpSection section = {kind, node, w->pos, size, sum, 0};
+    g_array_append_val(w->sections, section);
+
+    write_bytes(w, data, size);
+}
+
+/* Nodes loaded by reference are in its file and aren't saved again. */
+static GList *get_saved_children(MotoNode *node)
+{
+    if(MOTO_IS_REFERENCE_NODE(node))
+        return NULL;
+    return moto_node_get_children(node);
+}
+
+static void collect_tree(MotoNode *node, GPtrArray *nodes, GHashTable *set)
+{
+    GList *l = get_saved_children(node);
+    for(; l; l = g_list_next(l))
+    {
+        MotoNode *child = (MotoNode *)l->data;
+        if( ! set || g_hash_table_lookup(set, child))
+            g_ptr_array_add(nodes, child);
+        collect_tree(child, nodes, set);
+    }
+}
+
+static void add_with_sources(MotoNode *node, GHashTable *set);
+
+static void add_source(MotoNode *node, MotoParam *param, GHashTable *set)
+{
+    MotoParam *source = moto_param_get_source(param);
+    if(source && moto_param_get_node(source))
+        add_with_sources(moto_param_get_node(source), set);
+}
+
+static void add_with_sources(MotoNode *node, GHashTable *set)
+{
+    if(g_hash_table_lookup(set, node))
+        return;
+    g_hash_table_insert(set, node, node);
+
+    moto_node_foreach_param(node, (MotoNodeForeachParamFunc)add_source, set);
+
+    GList *l = get_saved_children(node);
+    for(; l; l = g_list_next(l))
+        add_with_sources((MotoNode *)l->data, set);
+}
+
+static void add_ancestors(MotoNode *node, GHashTable *set)
+{
+    MotoNode *parent = moto_node_get_parent(node);
+    for(; parent && ! MOTO_IS_SCENE_NODE(parent); parent = moto_node_get_parent(parent))
+        g_hash_table_insert(set, parent, parent);
+}
+
+/* Nodes in order of hierarchy so parents are created before children. */
+static GPtrArray *collect_nodes(MotoSceneNode *scene, GSList *selected)
+{
+    GPtrArray *nodes = g_ptr_array_new();
+    MotoNode *time_node = (MotoNode *)moto_scene_node_get_time_node(scene);
+
+    if( ! selected)
+    {
+        g_ptr_array_add(nodes, time_node);
+        collect_tree((MotoNode *)scene, nodes, NULL);
+        return nodes;
+    }
+
+    /* Selected nodes with all their dependencies. */
+    GHashTable *set = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for(; selected; selected = g_slist_next(selected))
+        add_with_sources((MotoNode *)selected->data, set);
+
+    GList *keys = g_hash_table_get_keys(set);
+    GList *k;
+    for(k = keys; k; k = g_list_next(k))
+        add_ancestors((MotoNode *)k->data, set);
+    g_list_free(keys);
+
+    if(g_hash_table_lookup(set, time_node))
+        g_ptr_array_add(nodes, time_node);
+    collect_tree((MotoNode *)scene, nodes, set);
+
+    g_hash_table_destroy(set);
+    return nodes;
+}
+
+typedef struct _MotoDumpLinks
+{
+    GByteArray *data;
+    GHashTable *indices;
+} MotoDumpLinks;
+
+static void add_link(MotoNode *node, MotoParam *param, MotoDumpLinks *links)
+{
+    MotoParam *source = moto_param_get_source(param);
+    if( ! source || ! g_hash_table_lookup(links->indices, moto_param_get_node(source)))
+        return;
+
+    (*(guint32 *)links->data->data)++;
+    append_uint(links->data, moto_param_get_id(param));
+    append_uint(links->data, moto_param_get_id(source));
+}
+
+/* Saved node and names of nodes from it down to node of param.
+ * Only references have children which aren't saved. */
+static gboolean get_ref_end(MotoNode *node, GHashTable *indices, guint32 *index, GPtrArray *path)
+{
+    g_ptr_array_set_size(path, 0);
+    for(; node && ! g_hash_table_lookup(indices, node); node = moto_node_get_parent(node))
+        g_ptr_array_add(path, (gpointer)moto_node_get_name(node));
+
+    if( ! node || (path->len && ! MOTO_IS_REFERENCE_NODE(node)))
+        return FALSE;
+
+    *index = GPOINTER_TO_UINT(g_hash_table_lookup(indices, node)) - 1;
+    return TRUE;
+}
+
+static void append_ref_end(GByteArray *a, guint32 index, GPtrArray *path, const gchar *param)
+{
+    append_uint(a, index);
+    append_uint(a, path->len);
+    guint i;
+    for(i = path->len; i > 0; i--)
+        append_string(a, (const gchar *)g_ptr_array_index(path, i - 1));
+    append_string(a, param);
+}
+
+typedef struct _MotoDumpRefWriter
+{
+    GByteArray *data;
+    GHashTable *indices;
+    GPtrArray *dst_path;
+    GPtrArray *src_path;
+} MotoDumpRefWriter;
+
+static void add_ref_link(MotoNode *node, MotoParam *param, MotoDumpRefWriter *w)
+{
+    MotoParam *source = moto_param_get_source(param);
+    if( ! source)
+        return;
+
+    guint32 dst, src;
+    if( ! get_ref_end(node, w->indices, & dst, w->dst_path) ||
+        ! get_ref_end(moto_param_get_node(source), w->indices, & src, w->src_path))
+        return;
+
+    /* Links between saved nodes are in links section and links inside
+     * of one reference are in its own file. */
+    if( ! w->dst_path->len && ! w->src_path->len)
+        return;
+    if(dst == src && w->dst_path->len && w->src_path->len)
+        return;
+
+    (*(guint32 *)w->data->data)++;
+    append_ref_end(w->data, dst, w->dst_path, moto_param_get_name(param));
+    append_ref_end(w->data, src, w->src_path, moto_param_get_name(source));
+}
+
+static void add_ref_links_of_tree(MotoNode *node, MotoDumpRefWriter *w)
+{
+    moto_node_foreach_param(node, (MotoNodeForeachParamFunc)add_ref_link, w);
+
+    GList *l = moto_node_get_children(node);
+    for(; l; l = g_list_next(l))
+        add_ref_links_of_tree((MotoNode *)l->data, w);
+}
+
+static gboolean get_pending_end(MotoDumpRefEnd *end, GHashTable *by_id, GHashTable *indices,
+        guint32 *index, GPtrArray *path)
+{
+    MotoNode *node = g_hash_table_lookup(by_id, GUINT_TO_POINTER(end->node));
+    if( ! node || ! g_hash_table_lookup(indices, node))
+        return FALSE;
+
+    *index = GPOINTER_TO_UINT(g_hash_table_lookup(indices, node)) - 1;
+    g_ptr_array_set_size(path, 0);
+    guint i = g_strv_length(end->path);
+    for(; i > 0; i--)
+        g_ptr_array_add(path, end->path[i - 1]);
+    return TRUE;
+}
+
+/* Ref links section: guint32 num, num * {dst end, src end}, where end is
+ * {guint32 node index, guint32 depth, depth * string name, string param}.
+ * Node is saved one and names lead from it to linked node in reference. */
+static void write_ref_links(MotoDumpWriter *w, MotoSceneNode *scene, GPtrArray *nodes,
+        GHashTable *indices, GByteArray *buf)
+{
+    g_byte_array_set_size(buf, 0);
+    append_uint(buf, 0);
+
+    MotoDumpRefWriter rw = {buf, indices, g_ptr_array_new(), g_ptr_array_new()};
+    guint i;
+    for(i = 0; i < nodes->len; i++)
+    {
+        MotoNode *node = (MotoNode *)g_ptr_array_index(nodes, i);
+        moto_node_foreach_param(node, (MotoNodeForeachParamFunc)add_ref_link, & rw);
+        if(MOTO_IS_REFERENCE_NODE(node))
+        {
+            GList *l = moto_node_get_children(node);
+            for(; l; l = g_list_next(l))
+                add_ref_links_of_tree((MotoNode *)l->data, & rw);
+        }
+    }
+
+    /* Links of references which are still not loaded. */
+    GSList *l = get_ref_links(scene)->links;
+    if(l)
+    {
+        GHashTable *by_id = get_nodes_by_id(scene);
+        guint32 dst, src;
+        for(; l; l = g_slist_next(l))
+        {
+            MotoDumpRefLink *link = (MotoDumpRefLink *)l->data;
+            if( ! get_pending_end(& link->dst, by_id, indices, & dst, rw.dst_path) ||
+                ! get_pending_end(& link->src, by_id, indices, & src, rw.src_path))
+                continue;
+
+            (*(guint32 *)buf->data)++;
+            append_ref_end(buf, dst, rw.dst_path, link->dst.param);
+            append_ref_end(buf, src, rw.src_path, link->src.param);
+        }
+        g_hash_table_destroy(by_id);
+    }
+
+    g_ptr_array_free(rw.dst_path, TRUE);
+    g_ptr_array_free(rw.src_path, TRUE);
+
+    if(*(guint32 *)buf->data)
+        write_section(w, SECTION_REF_LINKS, 0, buf->data, buf->len, checksum(buf->data, buf->len));
+}
+
+static MotoParam *get_mesh_param(MotoNode *node)
+{
+    if( ! MOTO_IS_SHAPE_NODE(node))
+        return NULL;
+
+    MotoParam *out = moto_node_get_param(node, "out");
+    if( ! out)
+        return NULL;
+
+    /* Not loaded yet, so it's still in the previous dump. */
+    if(moto_param_has_lazy_value(out))
+        return out;
+
+    if( ! MOTO_IS_MESH(moto_param_get_object(out)))
+        return NULL;
+    return out;
+}
+
+static void write_mesh(MotoDumpWriter *w, GHashTable *cache, MotoNode *node,
+        guint index, GByteArray *buf)
+{
+    MotoParam *out = get_mesh_param(node);
+    if( ! out)
+        return;
+
+    const GTimeVal *stamp = moto_node_get_last_modified(node);
+    MotoDumpShape *prev = \
+        g_hash_table_lookup(cache, GUINT_TO_POINTER(moto_node_get_id(node)));
+
+    /* Sections of older versions are encoded again. */
+    if(prev && prev->file->version == DUMP_VERSION &&
+       prev->stamp.tv_sec == stamp->tv_sec && prev->stamp.tv_usec == stamp->tv_usec)
+    {
+        write_section(w, SECTION_MESH, index, prev->file->data + prev->section.offset,
+            prev->section.size, prev->section.checksum);
+        return;
+    }
+
+    MotoShape *shape = (MotoShape *)moto_param_get_object(out);
+    if( ! MOTO_IS_MESH(shape))
+        return;
+
+    g_byte_array_set_size(buf, 0);
+    encode_mesh((MotoMesh *)shape, buf);
+    write_section(w, SECTION_MESH, index, buf->data, buf->len, checksum(buf->data, buf->len));
+}
+
+gboolean moto_scene_dump_save(MotoSceneNode *scene, const gchar *filename, GSList *selected)
+{
+    MOTO_PROFILE_BEGIN(scope);
+
+    GPtrArray *nodes = collect_nodes(scene, selected);
+    GHashTable *indices = g_hash_table_new(g_direct_hash, g_direct_equal);
+    MotoNode *time_node = (MotoNode *)moto_scene_node_get_time_node(scene);
+    guint i;
+
+    /* Stored as index + 1 to differ from missing. */
+    for(i = 0; i < nodes->len; i++)
+        g_hash_table_insert(indices, g_ptr_array_index(nodes, i), GUINT_TO_POINTER(i + 1));
+
+    gchar *tmp = g_strconcat(filename, ".tmp", NULL);
+    MotoDumpWriter w = {fopen(tmp, "wb"), 0, g_array_new(FALSE, FALSE, sizeof(MotoDumpSection)), TRUE};
+    if( ! w.out)
+    {
+        moto_error("Can't open file \"%s\" for writing", tmp);
+        g_array_free(w.sections, TRUE);
+        g_hash_table_destroy(indices);
+        g_ptr_array_free(nodes, TRUE);
+        g_free(tmp);
+        return FALSE;
+    }
+
+    MotoDumpHeader header = {DUMP_MAGIC, DUMP_VERSION, DUMP_BYTE_ORDER, 0, 0, 0};
+    write_bytes(& w, & header, sizeof(header));
+
+    /* Node table: guint32 nodes_num, nodes_num * {guint32 parent index, string type,
+     * string name, guint32 size, dump of params, since version 3:
+     * guint32 size, selection of op node (see moto_shape_selection_dump)} */
+    GByteArray *buf = g_byte_array_new();
+    GByteArray *selection = g_byte_array_new();
+    append_uint(buf, nodes->len);
+    for(i = 0; i < nodes->len; i++)
+    {
+        MotoNode *node = (MotoNode *)g_ptr_array_index(nodes, i);
+        MotoNode *parent = moto_node_get_parent(node);
+
+        gint32 parent_index = DUMP_SCENE_ROOT;
+        if(node == time_node)
+            parent_index = DUMP_SCENE_TIME;
+        else if(parent && g_hash_table_lookup(indices, parent))
+            parent_index = GPOINTER_TO_UINT(g_hash_table_lookup(indices, parent)) - 1;
+
+        append_uint(buf, (guint32)parent_index);
+        append_string(buf, moto_node_get_type_name(node));
+        append_string(buf, moto_node_get_name(node));
+
+        glong size;
+        gconstpointer dump = moto_node_get_dump(node, & size);
+        append_uint(buf, size);
+        append_padded(buf, dump, size);
+
+        g_byte_array_set_size(selection, 0);
+        if(MOTO_IS_OP_NODE(node) && moto_op_node_get_selection((MotoOpNode *)node))
+            moto_shape_selection_dump(moto_op_node_get_selection((MotoOpNode *)node), selection);
+        append_uint(buf, selection->len);
+        append_padded(buf, selection->data, selection->len);
+    }
+    g_byte_array_free(selection, TRUE);
+    write_section(& w, SECTION_NODES, 0, buf->data, buf->len, checksum(buf->data, buf->len));
+
+    /* Links */
+    g_byte_array_set_size(buf, 0);
+    append_uint(buf, 0);
+    MotoDumpLinks links = {buf, indices};
+    for(i = 0; i < nodes->len; i++)
+        moto_node_foreach_param((MotoNode *)g_ptr_array_index(nodes, i),
+            (MotoNodeForeachParamFunc)add_link, & links);
+    write_section(& w, SECTION_LINKS, 0, buf->data, buf->len, checksum(buf->data, buf->len));
+
+    write_ref_links(& w, scene, nodes, indices, buf);
+
+    /* Meshes */
+    GHashTable *cache = get_cache(scene);
+    for(i = 0; i < nodes->len; i++)
+        write_mesh(& w, cache, (MotoNode *)g_ptr_array_index(nodes, i), i, buf);
+    g_byte_array_free(buf, TRUE);
+
+    write_align(& w, DUMP_SECTION_ALIGN);
+    header.sections_num = w.sections->len;
+    header.directory = w.pos;
+    write_bytes(& w, w.sections->data, w.sections->len*sizeof(MotoDumpSection));
+
+    if(w.ok)
+        w.ok = ! fseek(w.out, 0, SEEK_SET) && fwrite(& header, sizeof(header), 1, w.out) == 1;
+    if(fclose(w.out))
+        w.ok = FALSE;
+
+    /* Previous file may be still mapped by lazy shapes, so it's replaced and not rewritten. */
+    if( ! w.ok || g_rename(tmp, filename))
+    {
+        moto_error("Can't write scene dump \"%s\"", filename);
+        g_unlink(tmp);
+        w.ok = FALSE;
+    }
+
+    if(w.ok)
+    {
+        /* Sections of new file are reused by next save. */
+        MotoDumpFile *file = dump_file_open(filename);
+        if(file)
+        {
+            for(i = 0; i < w.sections->len; i++)
+            {
+                MotoDumpSection *s = & g_array_index(w.sections, MotoDumpSection, i);
+                if(SECTION_MESH != s->kind)
+                    continue;
+
+                MotoNode *node = (MotoNode *)g_ptr_array_index(nodes, s->node);
+                g_hash_table_replace(cache, GUINT_TO_POINTER(moto_node_get_id(node)),
+                    dump_shape_new(node, file, s));
+            }
+            dump_file_unref(file);
+        }
+    }
+
+    g_array_free(w.sections, TRUE);
+    g_hash_table_destroy(indices);
+    g_ptr_array_free(nodes, TRUE);
+    g_free(tmp);
+
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_IO, "scene_dump_save", NULL);
+
+    return w.ok;
+}
+
+/* Loading */
+
+static gboolean check_section(MotoDumpFile *file, MotoDumpSection *s)
+{
+    return s->offset <= file->size && s->size <= file->size - s->offset;
+}
+
+static MotoDumpSection *find_section(MotoDumpSection *sections, guint num, guint32 kind)
+{
+    guint i;
+    for(i = 0; i < num; i++)
+        if(sections[i].kind == kind)
+            return sections + i;
+    return NULL;
+}
+
+static gboolean load_selection(MotoNode *node, MotoDumpReader *r)
+{
+    guint32 size;
+    const guint8 *data;
+    if( ! read_uint(r, & size) || ! read_bytes(r, size, & data))
+        return FALSE;
+    if( ! size || ! node || ! MOTO_IS_OP_NODE(node))
+        return TRUE;
+
+    gsize used = size;
+    MotoShapeSelection *selection = moto_shape_selection_new_from_dump(data, & used);
+    if( ! selection)
+        return FALSE;
+
+    moto_op_node_set_selection((MotoOpNode *)node, selection);
+    moto_shape_selection_free(selection);
+    return TRUE;
+}
+
+static gboolean load_nodes(MotoSceneNode *scene, MotoNode *root, MotoDumpReader *r,
+        GPtrArray *nodes, GHashTable *ids, guint32 version)
+{
+    guint32 num, i;
+    if( ! read_uint(r, & num))
+        return FALSE;
+
+    for(i = 0; i < num; i++)
+    {
+        guint32 parent_index, size;
+        const guint8 *dump;
+        if( ! read_uint(r, & parent_index))
+            return FALSE;
+
+        gchar *type_name = read_string(r);
+        gchar *name = (type_name) ? read_string(r) : NULL;
+        if( ! name || ! read_uint(r, & size) || ! read_bytes(r, size, & dump))
+        {
+            g_free(type_name);
+            g_free(name);
+            return FALSE;
+        }
+
+        MotoNode *node = NULL;
+        MotoNode *parent = NULL;
+        if(DUMP_SCENE_TIME == (gint32)parent_index)
+            node = (MotoNode *)moto_scene_node_get_time_node(scene);
+        else
+        {
+            parent = root;
+            if(DUMP_SCENE_ROOT != (gint32)parent_index)
+                parent = (parent_index < nodes->len) ? g_ptr_array_index(nodes, parent_index) : NULL;
+
+            if(parent)
+                node = moto_node_create_child_by_name(parent, type_name, name);
+        }
+
+        if(node)
+        {
+            moto_node_set_dump(node, dump, size, ids);
+            /* Objects nested in objects follow their transforms. */
+            if(parent && MOTO_IS_OBJECT_NODE(node) && MOTO_IS_OBJECT_NODE(parent))
+                moto_object_node_set_parent((MotoObjectNode *)node, (MotoObjectNode *)parent);
+        }
+        else
+            moto_warning("Node '%s' of type '%s' from dump isn't created", name, type_name);
+
+        g_ptr_array_add(nodes, node);
+        g_free(type_name);
+        g_free(name);
+
+        if(version >= 3 && ! load_selection(node, r))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean load_links(MotoDumpReader *r, GHashTable *ids)
+{
+    guint32 num, i;
+    if( ! read_uint(r, & num))
+        return FALSE;
+
+    for(i = 0; i < num; i++)
+    {
+        guint32 dst_id, src_id;
+        if( ! read_uint(r, & dst_id) || ! read_uint(r, & src_id))
+            return FALSE;
+
+        MotoParam *dst = g_hash_table_lookup(ids, GUINT_TO_POINTER(dst_id));
+        MotoParam *src = g_hash_table_lookup(ids, GUINT_TO_POINTER(src_id));
+        if(dst && src)
+            moto_param_link(dst, src);
+    }
+
+    return TRUE;
+}
+
+static gboolean read_ref_end(MotoDumpReader *r, GPtrArray *nodes, MotoDumpRefEnd *end)
+{
+    guint32 index, depth, i;
+    if( ! read_uint(r, & index) || ! read_uint(r, & depth) ||
+        depth > (guint32)(r->end - r->data)/sizeof(guint32))
+        return FALSE;
+
+    MotoNode *node = (index < nodes->len) ? g_ptr_array_index(nodes, index) : NULL;
+    end->node  = (node) ? moto_node_get_id(node) : 0;
+    end->path  = g_new0(gchar *, depth + 1);
+    end->param = NULL;
+    for(i = 0; i < depth; i++)
+        if( ! (end->path[i] = read_string(r)))
+            return FALSE;
+
+    end->param = read_string(r);
+    return NULL != end->param;
+}
+
+static gboolean load_ref_links(MotoSceneNode *scene, MotoDumpReader *r, GPtrArray *nodes)
+{
+    MotoDumpRefLinks *links = get_ref_links(scene);
+
+    guint32 num, i;
+    if( ! read_uint(r, & num))
+        return FALSE;
+
+    for(i = 0; i < num; i++)
+    {
+        MotoDumpRefLink *link = g_slice_new0(MotoDumpRefLink);
+        gboolean ok = read_ref_end(r, nodes, & link->dst) && read_ref_end(r, nodes, & link->src);
+        if( ! ok || ! link->dst.node || ! link->src.node)
+        {
+            ref_link_free(link);
+            if( ! ok)
+                return FALSE;
+            continue;
+        }
+        links->links = g_slist_prepend(links->links, link);
+    }
+
+    return TRUE;
+}
+
+static MotoParam *resolve_ref_end(MotoDumpRefEnd *end, GHashTable *by_id, gboolean *lost)
+{
+    MotoNode *node = g_hash_table_lookup(by_id, GUINT_TO_POINTER(end->node));
+    if( ! node)
+    {
+        *lost = TRUE;
+        return NULL;
+    }
+
+    gchar **name = end->path;
+    for(; node && *name; name++)
+        node = moto_node_get_child(node, *name);
+
+    return (node) ? moto_node_get_param(node, end->param) : NULL;
+}
+
+/* Links are restored when nodes of both ends exist, links of removed nodes are dropped. */
+static void restore_ref_links(MotoSceneNode *scene)
+{
+    MotoDumpRefLinks *links = get_ref_links(scene);
+    if( ! links->links)
+        return;
+
+    GHashTable *by_id = get_nodes_by_id(scene);
+    GSList *l = links->links, *rest = NULL;
+    for(; l; l = g_slist_next(l))
+    {
+        MotoDumpRefLink *link = (MotoDumpRefLink *)l->data;
+        gboolean lost = FALSE;
+        MotoParam *dst = resolve_ref_end(& link->dst, by_id, & lost);
+        MotoParam *src = resolve_ref_end(& link->src, by_id, & lost);
+
+        if(dst && src)
+            moto_param_link(dst, src);
+        if((dst && src) || lost)
+            ref_link_free(link);
+        else
+            rest = g_slist_prepend(rest, link);
+    }
+    g_slist_free(links->links);
+    links->links = rest;
+
+    g_hash_table_destroy(by_id);
+}
+
+static gboolean load_dump(MotoSceneNode *scene, MotoNode *root, const gchar *filename)
+{
+    MotoDumpFile *file = dump_file_open(filename);
+    if( ! file)
+        return FALSE;
+
+    const MotoDumpHeader *header = (const MotoDumpHeader *)file->data;
+    if(file->size < sizeof(MotoDumpHeader) || memcmp(header->magic, DUMP_MAGIC, sizeof(header->magic)))
+    {
+        moto_error("File \"%s\" isn't scene dump", filename);
+        dump_file_unref(file);
+        return FALSE;
+    }
+    if( ! header->version || header->version > DUMP_VERSION || header->byte_order != DUMP_BYTE_ORDER)
+    {
+        moto_error("Scene dump \"%s\" has unsupported version %u or byte order", filename, header->version);
+        dump_file_unref(file);
+        return FALSE;
+    }
+    if(header->directory > file->size ||
+       header->sections_num > (file->size - header->directory)/sizeof(MotoDumpSection))
+    {
+        moto_error("Scene dump \"%s\" is truncated", filename);
+        dump_file_unref(file);
+        return FALSE;
+    }
+
+    MotoDumpSection *sections = (MotoDumpSection *)(file->data + header->directory);
+    guint num = header->sections_num, i;
+
+    for(i = 0; i < num; i++)
+        if( ! check_section(file, sections + i))
+        {
+            moto_error("Scene dump \"%s\" is truncated", filename);
+            dump_file_unref(file);
+            return FALSE;
+        }
+
+    /* Small tables are checked at once, meshes are checked when loaded. */
+    MotoDumpSection *ns = find_section(sections, num, SECTION_NODES);
+    MotoDumpSection *ls = find_section(sections, num, SECTION_LINKS);
+    if( ! ns || ! ls ||
+        checksum(file->data + ns->offset, ns->size) != ns->checksum ||
+        checksum(file->data + ls->offset, ls->size) != ls->checksum)
+    {
+        moto_error("Scene dump \"%s\" is corrupted", filename);
+        dump_file_unref(file);
+        return FALSE;
+    }
+
+    GPtrArray *nodes = g_ptr_array_new();
+    GHashTable *ids = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    MotoDumpReader nr = {file->data + ns->offset, file->data + ns->offset + ns->size};
+    MotoDumpReader lr = {file->data + ls->offset, file->data + ls->offset + ls->size};
+    gboolean ok = load_nodes(scene, root, & nr, nodes, ids, file->version) && load_links(& lr, ids);
+
+    /* Links into references are restored when they are loaded, so it's checked later. */
+    MotoDumpSection *rs = find_section(sections, num, SECTION_REF_LINKS);
+    if(ok && rs)
+    {
+        MotoDumpReader rr = {file->data + rs->offset, file->data + rs->offset + rs->size};
+        ok = checksum(rr.data, rs->size) == rs->checksum && load_ref_links(scene, & rr, nodes);
+    }
+    if( ! ok)
+        moto_error("Scene dump \"%s\" is corrupted", filename);
+
+    GHashTable *cache = get_cache(scene);
+    for(i = 0; i < num && ok; i++)
+    {
+        MotoDumpSection *s = sections + i;
+        if(SECTION_MESH != s->kind || s->node >= nodes->len)
+            continue;
+
+        MotoNode *node = (MotoNode *)g_ptr_array_index(nodes, s->node);
+        MotoParam *out = (node && MOTO_IS_SHAPE_NODE(node)) ? moto_node_get_param(node, "out") : NULL;
+        if( ! out)
+            continue;
+
+        MotoDumpLazyShape *lazy = g_slice_new(MotoDumpLazyShape);
+        lazy->file = dump_file_ref(file);
+        lazy->section = *s;
+        moto_param_set_lazy_value(out, (MotoParamLazyFunc)materialize_mesh,
+            lazy, (GDestroyNotify)free_lazy_shape);
+
+        /* Shape isn't generated again, it's taken from dump when needed. */
+        moto_node_mark_as_updated(node);
+
+        /* Referenced shapes are never saved into the scene. */
+        if(root == (MotoNode *)scene)
+            g_hash_table_replace(cache, GUINT_TO_POINTER(moto_node_get_id(node)),
+                dump_shape_new(node, file, s));
+    }
+
+    /* Nodes of references loaded now may be ends of links. */
+    if(ok)
+        restore_ref_links(scene);
+
+    g_hash_table_destroy(ids);
+    g_ptr_array_free(nodes, TRUE);
+    dump_file_unref(file);
+
+    return ok;
+}
+
+gboolean moto_scene_dump_load(MotoSceneNode *scene, const gchar *filename)
+{
+    return moto_scene_dump_load_into(scene, (MotoNode *)scene, filename);
+}
+
+gboolean moto_scene_dump_load_into(MotoSceneNode *scene, MotoNode *parent, const gchar *filename)
+{
+    MOTO_PROFILE_BEGIN(scope);
+    gboolean ok = load_dump(scene, parent, filename);
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_IO, "scene_dump_load", NULL);
+
+    return ok;
+}
@@ -0,0 +1,51 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_SCENE_DUMP_H__
+#define __MOTO_SCENE_DUMP_H__
+
+#include "moto-scene-node.h"
+
+G_BEGIN_DECLS
+
+/* Binary scene format. File consists of header, sections and directory of
+ * sections at the end. Node table keeps types, names, hierarchy, dumps of
+ * params (see moto_node_get_dump) and selections of op nodes, links refer
+ * to saved param ids. Each mesh
+ * is in own aligned section and is decoded from mapped file only on first
+ * access, so opening doesn't depend on amount of geometry.
+ * Every section has checksum. Unchanged meshes are copied from previously
+ * saved file without encoding again. Nodes loaded by reference nodes aren't
+ * saved, only reference itself and links into and out of its nodes, which
+ * are restored when reference is loaded. */
+
+/* Saves given nodes or the whole scene if nodes is NULL. */
+gboolean moto_scene_dump_save(MotoSceneNode *scene, const gchar *filename, GSList *nodes);
+
+/* Creates nodes from file in scene. */
+gboolean moto_scene_dump_load(MotoSceneNode *scene, const gchar *filename);
+/* Same but nodes from the top of file become children of parent. Meshes are
+ * shared through assets of library, see moto_library_add_asset. */
+gboolean moto_scene_dump_load_into(MotoSceneNode *scene, MotoNode *parent, const gchar *filename);
+
+G_END_DECLS
+
+#endif /* __MOTO_SCENE_DUMP_H__ */
@@ -0,0 +1,281 @@
+#include <Python.h>
+#include <string.h>
+#include <math.h>
+
+#include "moto-messager.h"
+#include "moto-scene-generator.h"
+#include "moto-scene-dump.h"
+#include "moto-object-node.h"
+#include "moto-shape-node.h"
+#include "moto-material-node.h"
+#include "moto-plane-node.h"
+#include "moto-cube-node.h"
+#include "moto-sphere-node.h"
+#include "moto-twist-node.h"
+#include "moto-bend-node.h"
+#include "moto-mesh.h"
+
+void moto_scene_spec_init(MotoSceneSpec *self)
+{
+    self->objects  = 100;
+    self->depth    = 1;
+    self->ops      = 0;
+    self->animated = 0;
+    self->divs     = 10;
+    self->shape    = MOTO_SCENE_SPEC_SHAPE_PLANE;
+    self->seed     = 0;
+}
+
+static const gchar *shape_names[] = {"plane", "cube", "sphere", "mixed"};
+
+static gboolean parse_field(MotoSceneSpec *self, const gchar *key, const gchar *value)
+{
+    if(0 == strcmp(key, "shape"))
+    {
+        guint i;
+        for(i = 0; i < G_N_ELEMENTS(shape_names); i++)
+            if(0 == strcmp(value, shape_names[i]))
+            {
+                self->shape = (MotoSceneSpecShape)i;
+                return TRUE;
+            }
+        moto_error("Unknown shape \"%s\" in scene spec", value);
+        return FALSE;
+    }
+
+    gchar *end;
+    guint64 v = g_ascii_strtoull(value, & end, 10);
+    if(end == value || *end || v > G_MAXUINT)
+    {
+        moto_error("Bad value \"%s\" of \"%s\" in scene spec", value, key);
+        return FALSE;
+    }
+
+    if(0 == strcmp(key, "objects"))
+        self->objects = (guint)v;
+    else if(0 == strcmp(key, "depth"))
+        self->depth = MAX(1, (guint)v);
+    else if(0 == strcmp(key, "ops"))
+        self->ops = (guint)v;
+    else if(0 == strcmp(key, "animated"))
+        self->animated = (guint)v;
+    else if(0 == strcmp(key, "divs"))
+        self->divs = MAX(1, (guint)v);
+    else if(0 == strcmp(key, "seed"))
+        self->seed = (guint32)v;
+    else
+    {
+        moto_error("Unknown field \"%s\" in scene spec", key);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean moto_scene_spec_parse(MotoSceneSpec *self, const gchar *str)
+{
+    gchar **fields = g_strsplit_set(str, " ,;\t\n", -1);
+    gboolean result = TRUE;
+
+    gchar **f;
+    for(f = fields; *f && result; f++)
+    {
+        if( ! **f)
+            continue;
+
+        gchar *eq = strchr(*f, '=');
+        if( ! eq)
+        {
+            moto_error("Field \"%s\" of scene spec has no value", *f);
+            result = FALSE;
+            break;
+        }
+        *eq = '\0';
+        result = parse_field(self, *f, eq + 1);
+    }
+
+    g_strfreev(fields);
+    return result;
+}
+
+/* Generating */
+
+static GType get_shape_type(const MotoSceneSpec *spec, guint index)
+{
+    GType types[3] = {MOTO_TYPE_PLANE_NODE, MOTO_TYPE_CUBE_NODE, MOTO_TYPE_SPHERE_NODE};
+    if(MOTO_SCENE_SPEC_SHAPE_MIXED == spec->shape)
+        return types[index % 3];
+    return types[spec->shape];
+}
+
+static void set_divs(MotoNode *shape, guint divs)
+{
+    if(MOTO_IS_CUBE_NODE(shape))
+        moto_node_set_param_3i(shape, "divs", divs, divs, divs);
+    else if(MOTO_IS_SPHERE_NODE(shape))
+        moto_node_set_param_2i(shape, "rc", divs, divs);
+    else
+        moto_node_set_param_2i(shape, "divs", divs, divs);
+}
+
+/* Ops deform only with selection. All faces are selected, so selection is
+ * the same for all shapes of one type. */
+static MotoShapeSelection *create_selection(MotoNode *shape)
+{
+    moto_node_update(shape);
+    MotoShape *out = moto_shape_node_get_shape((MotoShapeNode *)shape);
+    if( ! out || ! MOTO_IS_MESH(out))
+        return NULL;
+
+    MotoShapeSelection *selection = moto_mesh_create_selection((MotoMesh *)out);
+    guint i;
+    for(i = 0; i < ((MotoMesh *)out)->f_num; i++)
+        moto_shape_selection_select_face(selection, i);
+    return selection;
+}
+
+guint moto_scene_generate(MotoSceneNode *scene, const MotoSceneSpec *spec)
+{
+    GRand *rand = g_rand_new_with_seed(spec->seed);
+    GPtrArray *animatable = g_ptr_array_new();
+    MotoShapeSelection *selections[3] = {NULL, NULL, NULL};
+
+    /* Roots are scattered over square with about one unit per object. */
+    gfloat spread = sqrt(spec->objects)*2;
+
+    MotoNode *parent = NULL;
+    guint depth = MAX(1, spec->depth);
+    guint i, j, num = 0;
+    for(i = 0; i < spec->objects; i++)
+    {
+        if(0 == i % depth)
+            parent = NULL;
+
+        gchar *name = g_strdup_printf("obj%u", i);
+        MotoNode *obj = moto_node_create_child((parent) ? parent : (MotoNode *)scene,
+                MOTO_TYPE_OBJECT_NODE, name);
+        g_free(name);
+
+        if(parent)
+        {
+            moto_object_node_set_parent((MotoObjectNode *)obj, (MotoObjectNode *)parent);
+            moto_object_node_set_translate((MotoObjectNode *)obj,
+                g_rand_double_range(rand, -1, 1), 2, g_rand_double_range(rand, -1, 1));
+        }
+        else
+            moto_object_node_set_translate((MotoObjectNode *)obj,
+                g_rand_double_range(rand, -spread, spread), 0, g_rand_double_range(rand, -spread, spread));
+
+        MotoNode *shape = moto_node_create_child(obj, get_shape_type(spec, i), "shape");
+        MotoNode *mat   = moto_node_create_child(obj, MOTO_TYPE_MATERIAL_NODE, "mat");
+        set_divs(shape, spec->divs);
+        moto_node_link(obj, "material", mat, "material");
+
+        MotoNode *last = shape;
+        guint type_index = (MOTO_SCENE_SPEC_SHAPE_MIXED == spec->shape) ? i % 3 : 0;
+        if(spec->ops && ! selections[type_index])
+            selections[type_index] = create_selection(shape);
+
+        for(j = 0; j < spec->ops; j++)
+        {
+            name = g_strdup_printf("op%u", j);
+            MotoNode *op = moto_node_create_child(obj, (j % 2) ? MOTO_TYPE_BEND_NODE : MOTO_TYPE_TWIST_NODE, name);
+            g_free(name);
+
+            moto_node_set_param_float(op, "angle", g_rand_double_range(rand, -45, 45));
+            if(selections[type_index])
+                moto_op_node_set_selection((MotoOpNode *)op, selections[type_index]);
+            moto_node_link(op, "in", last, "out");
+            g_ptr_array_add(animatable, moto_node_get_param(op, "angle"));
+            last = op;
+        }
+        moto_node_link(obj, "shape", last, "self");
+        g_ptr_array_add(animatable, moto_node_get_param(obj, "r"));
+
+        num += 3 + spec->ops;
+        parent = obj;
+    }
+
+    /* Animated params are spread evenly over the scene. */
+    guint animated = MIN(spec->animated, animatable->len);
+    if(animated < spec->animated)
+        moto_warning("Scene has only %u params to animate", animatable->len);
+    for(i = 0; i < animated; i++)
+    {
+        MotoParam *param = (MotoParam *)g_ptr_array_index(animatable, (guint64)i*animatable->len/animated);
+        gchar *body = g_strdup_printf("sin(t*%.2f + %u)*30", g_rand_double_range(rand, 0.5, 2), i);
+        moto_param_set_expression(param, body);
+        moto_param_set_use_expression(param, TRUE);
+        g_free(body);
+    }
+
+    for(i = 0; i < 3; i++)
+        if(selections[i])
+            moto_shape_selection_free(selections[i]);
+    g_ptr_array_free(animatable, TRUE);
+    g_rand_free(rand);
+
+    return num;
+}
+
+gboolean moto_scene_generate_to_file(MotoLibrary *lib, const MotoSceneSpec *spec,
+        const gchar *filename)
+{
+    MotoSceneNode *scene = moto_scene_node_new("generated", lib);
+    moto_scene_generate(scene, spec);
+    gboolean result = moto_scene_dump_save(scene, filename, NULL);
+    g_object_unref(scene);
+    return result;
+}
+
+/* Python */
+
+static MotoSystem *python_system = NULL;
+
+/* Returns number of nodes. Without filename nodes are added into current scene. */
+static PyObject *py_generate(PyObject *self, PyObject *args)
+{
+    const gchar *str;
+    const gchar *filename = NULL;
+    if( ! PyArg_ParseTuple(args, "s|s", & str, & filename))
+        return NULL;
+
+    MotoSceneSpec spec;
+    moto_scene_spec_init(& spec);
+    if( ! moto_scene_spec_parse(& spec, str))
+    {
+        PyErr_SetString(PyExc_ValueError, "Bad scene spec");
+        return NULL;
+    }
+
+    if(filename)
+    {
+        if( ! moto_scene_generate_to_file(moto_system_get_library(python_system), & spec, filename))
+        {
+            PyErr_Format(PyExc_IOError, "Can't save scene \"%s\"", filename);
+            return NULL;
+        }
+        return PyInt_FromLong(moto_scene_spec_get_nodes_num(& spec));
+    }
+
+    MotoSceneNode *scene = moto_system_get_current_scene(python_system);
+    if( ! scene)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "No current scene");
+        return NULL;
+    }
+    return PyInt_FromLong(moto_scene_generate(scene, & spec));
+}
+
+static PyMethodDef py_methods[] =
+{
+    {"generate", py_generate, METH_VARARGS,
+        "generate(spec[, filename]) builds scene like \"objects=100 depth=4 ops=2 animated=50 divs=10\" "
+        "and saves it or adds it into current scene. Returns number of nodes."},
+    {NULL, NULL, 0, NULL}
+};
+
+void moto_scene_generator_init_python(MotoSystem *system)
+{
+    python_system = system;
+    Py_InitModule("motoscenegen", py_methods);
+}
@@ -0,0 +1,74 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_SCENE_GENERATOR_H__
+#define __MOTO_SCENE_GENERATOR_H__
+
+#include "moto-system.h"
+#include "moto-scene-node.h"
+
+G_BEGIN_DECLS
+
+/* Procedural scenes of controlled shape for scaling tests. Each object gets
+ * primitive shape, material and chain of deformers. Objects are parented in
+ * chains, so depth of hierarchy is controlled too. Spec may be given as
+ * string like "objects=1000 depth=4 ops=3 animated=500 divs=20 shape=mixed". */
+
+typedef enum _MotoSceneSpecShape
+{
+    MOTO_SCENE_SPEC_SHAPE_PLANE,
+    MOTO_SCENE_SPEC_SHAPE_CUBE,
+    MOTO_SCENE_SPEC_SHAPE_SPHERE,
+    MOTO_SCENE_SPEC_SHAPE_MIXED
+} MotoSceneSpecShape;
+
+typedef struct _MotoSceneSpec MotoSceneSpec;
+
+struct _MotoSceneSpec
+{
+    guint objects;  /* Number of objects. */
+    guint depth;    /* Length of parent chains, 1 is flat scene. */
+    guint ops;      /* Deformers on shape of each object. */
+    guint animated; /* Params driven by time expressions. */
+    guint divs;     /* Divisions of primitives. */
+    MotoSceneSpecShape shape;
+    guint32 seed;   /* Placement of objects and values of params. */
+};
+
+void moto_scene_spec_init(MotoSceneSpec *self);
+/* Fields not mentioned in str keep their values. */
+gboolean moto_scene_spec_parse(MotoSceneSpec *self, const gchar *str);
+
+/* Nodes per object: object, shape, material and ops. */
+#define moto_scene_spec_get_nodes_num(spec) ((spec)->objects*(3 + (spec)->ops))
+
+/* Adds generated nodes to scene. Returns number of created nodes. */
+guint moto_scene_generate(MotoSceneNode *scene, const MotoSceneSpec *spec);
+/* Generates new scene and saves it with moto_scene_dump_save. */
+gboolean moto_scene_generate_to_file(MotoLibrary *lib, const MotoSceneSpec *spec,
+        const gchar *filename);
+
+/* Adds "motoscenegen" module to embedded interpreter. */
+void moto_scene_generator_init_python(MotoSystem *system);
+
+G_END_DECLS
+
+#endif /* __MOTO_SCENE_GENERATOR_H__ */
@@ -17,6 +17,11 @@
 #include "moto-intersection.h"
 #include "moto-transform-info.h"
 #include "moto-time-node.h"
+#include "moto-anim-node.h"
+#include "moto-scene-dump.h"
+#include "moto-profiler.h"
+#include "moto-reference-node.h"
+#include "moto-shape-cache.h"
 
 /* utils */
 
@@ -67,6 +72,13 @@ struct _MotoSceneNodePriv
     /* Animation */
     GTimer *timer;
     gfloat fps;
+    gfloat time;
+    GPtrArray *animated_nodes; /* Rebuilt only when time dependencies are changed. */
+    guint animated_stamp;
+    /* Anim nodes of animated_nodes driven by time of scene, curves are evaluated together. */
+    GPtrArray *anim_nodes;
+    GPtrArray *anim_curves;
+    GArray *anim_values;
 
     /* Misc */
     gboolean left_coords;
@@ -95,10 +107,17 @@ struct _MotoSceneNodePriv
 
     GThreadPool *thread_pool;
     gint max_thread_for_update;
-    gboolean updating_done;
-    GList *updateable_nodes;
+    GMutex *update_mutex;
+    GCond *update_cond;
+    gint updates_pending;
+    GPtrArray *update_level;  /* Reused between updates. */
+    GPtrArray *python_params; /* Reused between updates. */
+
+    MotoShapeCache *shape_cache;
 };
 
+#define SHAPE_CACHE_BUDGET (256 << 20)
+
 static void
 moto_scene_node_dispose(GObject *obj)
 {
@@ -106,6 +125,11 @@ moto_scene_node_dispose(GObject *obj)
     MotoSceneNodePriv *priv = self->priv;
 
     g_timer_destroy(priv->timer);
+    g_ptr_array_foreach(priv->animated_nodes, (GFunc)unref_gobject, NULL);
+    g_ptr_array_free(priv->animated_nodes, TRUE);
+    g_ptr_array_free(priv->anim_nodes, TRUE);
+    g_ptr_array_free(priv->anim_curves, TRUE);
+    g_array_free(priv->anim_values, TRUE);
 
     moto_factory_free_all(& priv->mutex_factory);
 
@@ -113,12 +137,19 @@ moto_scene_node_dispose(GObject *obj)
     g_slist_free(priv->nodes);
     g_slist_free(priv->selected_nodes);
 
-    g_string_free(priv->filename, TRUE);
-    g_slice_free(MotoSceneNodePriv, priv);
-
     if(priv->thread_pool)
         g_thread_pool_free(priv->thread_pool, TRUE, FALSE);
-    g_list_free(priv->updateable_nodes);
+    g_cond_free(priv->update_cond);
+    g_ptr_array_free(priv->update_level, TRUE);
+    g_ptr_array_free(priv->python_params, TRUE);
+    moto_shape_cache_free(priv->shape_cache);
+
+    /* Shared meshes of this scene may be not used anymore. */
+    if(priv->library)
+        moto_library_collect_assets(priv->library);
+
+    g_string_free(priv->filename, TRUE);
+    g_slice_free(MotoSceneNodePriv, priv);
 
     G_OBJECT_CLASS(scene_node_parent_class)->dispose(obj);
 }
@@ -159,6 +190,7 @@ moto_scene_node_init(MotoSceneNode *self)
     priv->root = NULL;
     priv->camera = NULL;
     priv->global_axes = NULL;
+    priv->time_node = NULL;
 
     /* Default camera settings */
     priv->fovy = 60*RAD_PER_DEG;
@@ -174,6 +206,13 @@ moto_scene_node_init(MotoSceneNode *self)
 
     /* Animation */
     priv->timer = g_timer_new();
+    priv->fps  = 24;
+    priv->time = 0;
+    priv->animated_nodes = g_ptr_array_new();
+    priv->animated_stamp = moto_node_get_time_dependency_stamp() - 1;
+    priv->anim_nodes  = g_ptr_array_new();
+    priv->anim_curves = g_ptr_array_new();
+    priv->anim_values = g_array_new(FALSE, FALSE, sizeof(gfloat));
 
     /* Misc */
     priv->node_list_mutex      = get_mutex(& self->priv->mutex_factory, "node_list_mutex");
@@ -181,6 +220,7 @@ moto_scene_node_init(MotoSceneNode *self)
     priv->root_object_mutex    = get_mutex(& self->priv->mutex_factory, "root_object_mutex");
     priv->camera_object_mutex  = get_mutex(& self->priv->mutex_factory, "camera_object_mutex");
     priv->axes_object_mutex    = get_mutex(& self->priv->mutex_factory, "axes_object_mutex");
+    priv->update_mutex         = get_mutex(& self->priv->mutex_factory, "update_mutex");
 
     // cache
     priv->prev_width = 640;
@@ -190,7 +230,12 @@ moto_scene_node_init(MotoSceneNode *self)
 
     priv->thread_pool = NULL;
     priv->max_thread_for_update = 4;
-    priv->updating_done = TRUE;
+    priv->update_cond = g_cond_new();
+    priv->updates_pending = 0;
+    priv->update_level  = g_ptr_array_new();
+    priv->python_params = g_ptr_array_new();
+
+    priv->shape_cache = moto_shape_cache_new(SHAPE_CACHE_BUDGET);
 
     moto_node_add_params(node,
             "cull_face", "Call Face", MOTO_TYPE_CULL_FACE_MODE, MOTO_PARAM_MODE_INOUT, MOTO_CULL_FACE_MODE_BACK, NULL, "View",
@@ -248,8 +293,8 @@ MotoSceneNode *moto_scene_node_new_from_dump(const gchar *filename, MotoLibrary
 {
     MotoSceneNode *self = moto_scene_node_new("", lib);
 
-    /* load scene_node from dump */
-        /* Loading ... */
+    if(moto_scene_dump_load(self, filename))
+        g_string_assign(self->priv->filename, filename);
 
     return self;
 }
@@ -259,6 +304,11 @@ const gchar *moto_scene_node_get_name(MotoSceneNode *self)
     return self->priv->name->str;
 }
 
+const gchar *moto_scene_node_get_filename(MotoSceneNode *self)
+{
+    return self->priv->filename->str;
+}
+
 void moto_scene_node_add_node(MotoSceneNode *self, MotoNode *node)
 {
     const char* name = moto_node_get_name(node);
@@ -311,10 +361,22 @@ MotoNode *moto_scene_node_create_node_by_name(MotoSceneNode *self,
     return node;
 }
 
-void moto_scene_node_binary_dump(MotoSceneNode *self,
+void moto_scene_node_dump(MotoSceneNode *self,
         const gchar *filename, gboolean change_filename)
 {
+    moto_scene_node_binary_dump(self, filename, change_filename);
+}
 
+void moto_scene_node_dump_selected(MotoSceneNode *self, const gchar *filename)
+{
+    moto_scene_node_binary_dump_selected(self, filename, FALSE);
+}
+
+void moto_scene_node_binary_dump(MotoSceneNode *self,
+        const gchar *filename, gboolean change_filename)
+{
+    if(moto_scene_dump_save(self, filename, NULL) && change_filename)
+        g_string_assign(self->priv->filename, filename);
 }
 
 void moto_scene_node_xml_dump(MotoSceneNode *self,
@@ -326,7 +388,14 @@ void moto_scene_node_xml_dump(MotoSceneNode *self,
 void moto_scene_node_binary_dump_selected(MotoSceneNode *self,
         const gchar *filename, gboolean change_filename)
 {
+    if( ! self->priv->selected_nodes)
+    {
+        moto_warning("Nothing is selected, scene \"%s\" isn't saved", filename);
+        return;
+    }
 
+    if(moto_scene_dump_save(self, filename, self->priv->selected_nodes) && change_filename)
+        g_string_assign(self->priv->filename, filename);
 }
 
 void moto_scene_node_xml_dump_selected(MotoSceneNode *self,
@@ -335,9 +404,49 @@ void moto_scene_node_xml_dump_selected(MotoSceneNode *self,
 
 }
 
+static void relink_time_param(MotoNode *node, MotoParam *param, MotoNode *time_nodes[2])
+{
+    MotoParam *source = moto_param_get_source(param);
+    if( ! source || moto_param_get_node(source) != time_nodes[0])
+        return;
+
+    moto_param_unlink_source(param);
+    moto_param_link(param, moto_node_get_param(time_nodes[1], moto_param_get_name(source)));
+}
+
+static void relink_time(MotoNode *node, MotoNode *time_nodes[2])
+{
+    moto_node_foreach_param(node, (MotoNodeForeachParamFunc)relink_time_param, time_nodes);
+
+    GList *l = moto_node_get_children(node);
+    for(; l; l = g_list_next(l))
+        relink_time((MotoNode *)l->data, time_nodes);
+}
+
 void moto_scene_node_merge(MotoSceneNode *self, MotoSceneNode *other)
 {
+    MotoNode *time_nodes[2] = {(MotoNode *)other->priv->time_node, NULL};
+    if(time_nodes[0])
+        time_nodes[1] = (MotoNode *)moto_scene_node_get_time_node(self);
+
+    /* List is changed while moving. */
+    GList *children = g_list_copy(moto_node_get_children((MotoNode *)other));
+    GList *l;
+    for(l = children; l; l = g_list_next(l))
+    {
+        MotoNode *node = (MotoNode *)l->data;
+        if(time_nodes[0])
+            relink_time(node, time_nodes);
+        moto_node_add_child((MotoNode *)self, node);
+    }
+    g_list_free(children);
+}
 
+void moto_scene_node_merge_from_file(MotoSceneNode *self, const gchar *filename)
+{
+    MotoSceneNode *other = moto_scene_node_new_from_dump(filename, self->priv->library);
+    moto_scene_node_merge(self, other);
+    g_object_unref(other);
 }
 
 MotoObjectNode *moto_scene_node_get_current_object(MotoSceneNode *self)
@@ -479,6 +588,8 @@ void moto_scene_node_draw(MotoSceneNode *self, gint width, gint height)
 
     if(self->priv->manipulator)
         moto_scene_node_manipulator_draw(self->priv->manipulator, self);
+
+    moto_profiler_next_frame();
 }
 
 void moto_scene_node_draw_fps_test(MotoSceneNode *self)
@@ -509,6 +620,16 @@ MotoLibrary *moto_scene_node_get_library(MotoSceneNode *self)
     return self->priv->library;
 }
 
+MotoShapeCache *moto_scene_node_get_shape_cache(MotoSceneNode *self)
+{
+    return self->priv->shape_cache;
+}
+
+void moto_scene_node_set_shape_cache_budget(MotoSceneNode *self, gsize budget)
+{
+    moto_shape_cache_set_budget(self->priv->shape_cache, budget);
+}
+
 MotoNode *moto_scene_node_get_node(MotoSceneNode *self, const gchar *name)
 {
     g_mutex_lock(self->priv->node_list_mutex);
@@ -640,11 +761,7 @@ static gboolean intersect_object(MotoSceneNode *scene_node, MotoNode *node, gpoi
     moto_ray_set_transformed(& ray, & idata->ray, iom);
     moto_ray_normalize(& ray);
 
-    MotoBound *b = moto_object_node_get_bound(obj, FALSE);
-    MotoBound bb;
-    moto_bound_set_extended(& bb, b, scene_node->priv->select_bound_extent);
-
-    if(!moto_ray_intersect_bound_dist(& ray, & dist, bb.bound))
+    if(!moto_object_node_intersect(obj, & ray, scene_node->priv->select_bound_extent, & dist))
         return TRUE;
 
     if((!idata->obj) || dist < idata->dist)
@@ -678,95 +795,263 @@ void moto_scene_node_stop_anim(MotoSceneNode *self)
     g_timer_stop(self->priv->timer);
 }
 
-static void update_node(MotoNode *node, MotoSceneNode *scene_node)
+gfloat moto_scene_node_get_fps(MotoSceneNode *self)
 {
-    moto_node_update(node);
+    return self->priv->fps;
 }
 
-void push_node(MotoNode *node, GThreadPool *tp)
+void moto_scene_node_set_fps(MotoSceneNode *self, gfloat fps)
 {
-    g_thread_pool_push(tp, node, NULL);
+    self->priv->fps = fps;
 }
 
-guint moto_scene_node_get_update_complexity(MotoSceneNode *self)
+gfloat moto_scene_node_get_current_time(MotoSceneNode *self)
 {
-    return 0; // TODO: Implement
+    return self->priv->time;
 }
 
-void moto_scene_node_prepare_updateable_nodes(MotoSceneNode *self)
+MotoTimeNode *moto_scene_node_get_time_node(MotoSceneNode *self)
 {
-    
+    MotoSceneNodePriv *priv = self->priv;
+
+    if( ! priv->time_node)
+    {
+        priv->time_node = (MotoTimeNode *)moto_scene_node_create_node(self,
+                MOTO_TYPE_TIME_NODE, "time", NULL);
+        moto_node_update((MotoNode *)priv->time_node);
+    }
+
+    return priv->time_node;
 }
 
+static void update_node(MotoNode *node, MotoSceneNode *scene_node)
+{
+    MotoSceneNodePriv *priv = scene_node->priv;
 
-static gboolean __update_node(MotoNode* node)
+    moto_node_update(node);
+
+    g_mutex_lock(priv->update_mutex);
+    if(0 == --priv->updates_pending)
+        g_cond_signal(priv->update_cond);
+    g_mutex_unlock(priv->update_mutex);
+}
+
+guint moto_scene_node_get_update_complexity(MotoSceneNode *self)
 {
-    gboolean smth_updated = FALSE;
+    return g_slist_length(self->priv->nodes);
+}
 
-    if(moto_node_is_ready_to_update(node) && moto_node_needs_update(node))
-    {
-        moto_node_update(node);
-        smth_updated = TRUE;
-    }
+static void collect_animated_nodes(MotoNode *node, GPtrArray *nodes)
+{
+    if(moto_node_is_animated(node) && ! moto_node_is_time_cut(node))
+        g_ptr_array_add(nodes, g_object_ref(node));
 
     GList* child = moto_node_get_children(node);
     for(; child; child = g_list_next(child))
-    {
-        if(__update_node((MotoNode*)child->data))
-            smth_updated = TRUE;
-    }
-
-    return smth_updated;
+        collect_animated_nodes((MotoNode*)child->data, nodes);
 }
 
-static void scene_node_update(MotoSceneNode *self)
+/* Nodes which depend on time. Flags are cached by nodes at link time so
+ * list is rebuilt only after changes of graph. */
+static GPtrArray *get_animated_nodes(MotoSceneNode *self)
 {
     MotoSceneNodePriv *priv = self->priv;
 
-    gboolean smth_updated = FALSE;
+    guint stamp = moto_node_get_time_dependency_stamp();
+    if(stamp == priv->animated_stamp)
+        return priv->animated_nodes;
+
+    g_ptr_array_foreach(priv->animated_nodes, (GFunc)unref_gobject, NULL);
+    g_ptr_array_set_size(priv->animated_nodes, 0);
 
     const GList* child = moto_node_get_children((MotoNode*)self);
     for(; child; child = g_list_next(child))
+        collect_animated_nodes((MotoNode*)child->data, priv->animated_nodes);
+
+    /* Time of these is exactly time of scene. */
+    MotoParam *scene_time = (priv->time_node) ? moto_node_get_param((MotoNode *)priv->time_node, "time") : NULL;
+    g_ptr_array_set_size(priv->anim_nodes, 0);
+    g_ptr_array_set_size(priv->anim_curves, 0);
+
+    guint i;
+    for(i = 0; scene_time && i < priv->animated_nodes->len; i++)
     {
-        MotoNode *node = (MotoNode*)child->data;
-        if(__update_node(node))
-            smth_updated = TRUE;
+        MotoNode *node = (MotoNode *)g_ptr_array_index(priv->animated_nodes, i);
+        if( ! MOTO_IS_ANIM_NODE(node))
+            continue;
+
+        MotoParam *time = moto_node_get_param(node, "time");
+        if(moto_param_get_source(time) != scene_time || moto_param_get_use_expression(time))
+            continue;
+
+        g_ptr_array_add(priv->anim_nodes, node);
+        g_ptr_array_add(priv->anim_curves, moto_anim_node_get_curve((MotoAnimNode *)node));
     }
+    g_array_set_size(priv->anim_values, priv->anim_nodes->len);
 
-    if(smth_updated)
-        scene_node_update(self);
+    priv->animated_stamp = stamp;
+    return priv->animated_nodes;
 }
 
-void moto_scene_node_update(MotoSceneNode *self)
+/* Curves are evaluated in one pass instead of updating anim nodes one by one. */
+static void eval_anim_nodes(MotoSceneNode *self)
 {
     MotoSceneNodePriv *priv = self->priv;
+    gfloat *values = (gfloat *)priv->anim_values->data;
+
+    moto_anim_curve_eval_array((MotoAnimCurve **)priv->anim_curves->pdata, priv->anim_curves->len,
+        priv->time, values);
+
+    guint i;
+    for(i = 0; i < priv->anim_nodes->len; i++)
+        moto_anim_node_set_value((MotoAnimNode *)g_ptr_array_index(priv->anim_nodes, i), values[i]);
+}
 
-    if(moto_scene_node_get_update_complexity(self) < 1000)
+static void collect_updateable_nodes(MotoNode *node, GPtrArray *level)
+{
+    if(moto_node_is_ready_to_update(node) && moto_node_needs_update(node))
+        g_ptr_array_add(level, node);
+
+    GList* child = moto_node_get_children(node);
+    for(; child; child = g_list_next(child))
+        collect_updateable_nodes((MotoNode*)child->data, level);
+}
+
+/* Nodes are updated by levels of dependency graph. Sources of all nodes in level
+ * are ready, so Python expressions of the whole level are evaluated in one
+ * interpreter entry. Other nodes are updated by thread pool (if any) meanwhile.
+ * Only given nodes are considered if nodes isn't NULL.
+ * Returns FALSE if there was nothing to update. */
+static gboolean update_level(MotoSceneNode *self, GThreadPool *pool, GPtrArray *nodes)
+{
+    MotoSceneNodePriv *priv = self->priv;
+    GPtrArray *level  = priv->update_level;
+    GPtrArray *params = priv->python_params;
+
+    guint i;
+    g_ptr_array_set_size(level, 0);
+    if(nodes)
     {
-        scene_node_update(self);
+        for(i = 0; i < nodes->len; i++)
+        {
+            MotoNode *node = (MotoNode*)g_ptr_array_index(nodes, i);
+            if(moto_node_is_ready_to_update(node) && moto_node_needs_update(node))
+                g_ptr_array_add(level, node);
+        }
     }
     else
     {
+        const GList* child = moto_node_get_children((MotoNode*)self);
+        for(; child; child = g_list_next(child))
+            collect_updateable_nodes((MotoNode*)child->data, level);
+    }
+
+    if( ! level->len)
+        return FALSE;
+
+    g_ptr_array_set_size(params, 0);
+
+    guint python_nodes_num = 0;
+    for(i = 0; i < level->len; i++)
+    {
+        MotoNode *node = (MotoNode*)g_ptr_array_index(level, i);
+
+        guint params_num = params->len;
+        moto_node_collect_python_params(node, params);
+
+        if(params->len > params_num)
+        {
+            /* Updated after evaluating of expressions. */
+            g_ptr_array_index(level, python_nodes_num++) = node;
+        }
+        else if(pool)
+        {
+            g_mutex_lock(priv->update_mutex);
+            priv->updates_pending++;
+            g_mutex_unlock(priv->update_mutex);
+
+            g_thread_pool_push(pool, node, NULL);
+        }
+        else
+        {
+            moto_node_update(node);
+        }
+    }
+
+    moto_param_eval_batch(params);
+    for(i = 0; i < python_nodes_num; i++)
+        moto_node_update((MotoNode*)g_ptr_array_index(level, i));
+
+    if(pool)
+    {
+        g_mutex_lock(priv->update_mutex);
+        while(priv->updates_pending > 0)
+            g_cond_wait(priv->update_cond, priv->update_mutex);
+        g_mutex_unlock(priv->update_mutex);
+    }
+
+    return TRUE;
+}
+
+static GThreadPool *get_update_pool(MotoSceneNode *self, guint complexity)
+{
+    MotoSceneNodePriv *priv = self->priv;
+
+    if(complexity < 1000)
+        return NULL;
+
+    if( ! priv->thread_pool)
         priv->thread_pool = \
             g_thread_pool_new((GFunc)update_node, self,
                               priv->max_thread_for_update,
                               TRUE, NULL);
+    return priv->thread_pool;
+}
 
-        moto_scene_node_prepare_updateable_nodes(self);
-        priv->updating_done = FALSE;
-        while(1)
-        {
-            g_list_foreach(priv->updateable_nodes, (GFunc)push_node, priv->thread_pool);
-            g_list_free(priv->updateable_nodes);
-            priv->updateable_nodes = NULL;
+/* References create nodes, so they are loaded here and not in update
+ * of nodes which may run in several threads. */
+static void load_references(MotoNode *node)
+{
+    gboolean load = FALSE;
+    if(MOTO_IS_REFERENCE_NODE(node) &&
+       ! moto_reference_node_is_loaded((MotoReferenceNode *)node) &&
+       moto_node_get_param_boolean(node, "load", & load) && load)
+    {
+        moto_reference_node_load((MotoReferenceNode *)node);
+    }
 
-            if(priv->updating_done)
-                break;
-        }
+    GList *l = moto_node_get_children(node);
+    for(; l; l = g_list_next(l))
+        load_references((MotoNode *)l->data);
+}
 
-        g_thread_pool_free(priv->thread_pool, FALSE, TRUE);
-        priv->thread_pool = NULL;
-    }
+void moto_scene_node_update(MotoSceneNode *self)
+{
+    load_references((MotoNode *)self);
+
+    GThreadPool *pool = get_update_pool(self, moto_scene_node_get_update_complexity(self));
+
+    while(update_level(self, pool, NULL));
+}
+
+void moto_scene_node_set_current_time(MotoSceneNode *self, gfloat time)
+{
+    MotoSceneNodePriv *priv = self->priv;
+
+    priv->time = time;
+    if(priv->time_node)
+        moto_node_update((MotoNode *)priv->time_node);
+
+    /* Static branches keep their outputs. Only time dependent subgraph is updated. */
+    GPtrArray *nodes = get_animated_nodes(self);
+
+    guint i;
+    for(i = 0; i < nodes->len; i++)
+        moto_node_mark_for_update((MotoNode *)g_ptr_array_index(nodes, i));
+    eval_anim_nodes(self);
+
+    GThreadPool *pool = get_update_pool(self, nodes->len);
+    while(update_level(self, pool, nodes));
 }
 
 /*  */
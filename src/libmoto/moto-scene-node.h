@@ -106,6 +106,14 @@ MotoSceneNode *moto_scene_node_new_from_dump(const gchar *filename, MotoLibrary
  */
 const gchar *moto_scene_node_get_name(MotoSceneNode *self);
 
+/**
+ * moto_scene_node_get_filename:
+ * @self: a #MotoSceneNode.
+ *
+ * Returns: the file from which scene_node is loaded or where it's saved last time.
+ */
+const gchar *moto_scene_node_get_filename(MotoSceneNode *self);
+
 /**
  * moto_scene_node_create_node:
  * @self: a #MotoSceneNode.
@@ -155,12 +163,19 @@ void moto_scene_node_dump(MotoSceneNode *self,
  */
 void moto_scene_node_dump_selected(MotoSceneNode *self, const gchar *filename);
 
+/* Same in binary format, see moto-scene-dump.h. */
+void moto_scene_node_binary_dump(MotoSceneNode *self,
+        const gchar *filename, gboolean change_filename);
+void moto_scene_node_binary_dump_selected(MotoSceneNode *self,
+        const gchar *filename, gboolean change_filename);
+
 /**
  * moto_scene_node_merge:
  * @self: a #MotoSceneNode to merge into.
  * @other: a @MotoSceneNode which will be merged.
  *
- * Megres other scene_node into first scene_node.
+ * Megres other scene_node into first scene_node. Nodes are moved from other
+ * and links to its time node are connected to time node of first one.
  */
 void moto_scene_node_merge(MotoSceneNode *self, MotoSceneNode *other);
 
@@ -274,6 +289,10 @@ void moto_scene_node_apply_default_camera(MotoSceneNode *self, gint width, gint
  */
 MotoLibrary *moto_scene_node_get_library(MotoSceneNode *self);
 
+/* Cache of shapes made by op nodes, see moto-shape-cache.h. Budget is in bytes. */
+MotoShapeCache *moto_scene_node_get_shape_cache(MotoSceneNode *self);
+void moto_scene_node_set_shape_cache_budget(MotoSceneNode *self, gsize budget);
+
 MotoNode *moto_scene_node_get_node(MotoSceneNode *self, const gchar *name);
 
 void moto_scene_node_foreach_node(MotoSceneNode *self, GType type,
@@ -300,6 +319,16 @@ void moto_scene_node_reset(MotoSceneNode *self);
 void moto_scene_node_start_anim(MotoSceneNode *self);
 void moto_scene_node_stop_anim(MotoSceneNode *self);
 
+gfloat moto_scene_node_get_fps(MotoSceneNode *self);
+void moto_scene_node_set_fps(MotoSceneNode *self, gfloat fps);
+
+/* Time in seconds. Setting of time updates only animated nodes. */
+gfloat moto_scene_node_get_current_time(MotoSceneNode *self);
+void moto_scene_node_set_current_time(MotoSceneNode *self, gfloat time);
+
+/* Source of time for the graph. Created on first call. */
+MotoTimeNode *moto_scene_node_get_time_node(MotoSceneNode *self);
+
 void moto_scene_node_update(MotoSceneNode *self);
 
 /* Signals??? (TODO: These must be signals not just functions.) */
@@ -0,0 +1,158 @@
+#include "moto-mesh.h"
+#include "moto-shape-cache.h"
+
+typedef struct _MotoShapeCacheEntry
+{
+    gchar *key;
+    MotoShape *shape;
+    gsize size;
+    GList *link; /* in lru */
+} MotoShapeCacheEntry;
+
+struct _MotoShapeCache
+{
+    GHashTable *entries;
+    GQueue lru; /* Most recently used are in the head. */
+    gsize budget;
+    gsize size;
+    GMutex *mutex;
+};
+
+/* Arrays of mesh with its normals, topology and tesselation. */
+static gsize estimate_size(MotoShape *shape)
+{
+    if( ! MOTO_IS_MESH(shape))
+        return sizeof(MotoShape);
+
+    MotoMesh *mesh = (MotoMesh *)shape;
+    gsize index = (mesh->b32) ? sizeof(guint32) : sizeof(guint16);
+
+    return sizeof(MotoMesh) +
+        mesh->v_num*(2*sizeof(MotoVector) + 2*index) +
+        mesh->e_num*(4*index + sizeof(guint32)) +
+        mesh->f_num*(sizeof(MotoVector) + 2*index) +
+        mesh->f_v_num*3*index +
+        mesh->f_tess_num*3*index;
+}
+
+static void entry_free(MotoShapeCacheEntry *entry)
+{
+    g_free(entry->key);
+    g_object_unref(entry->shape);
+    g_slice_free(MotoShapeCacheEntry, entry);
+}
+
+static void remove_entry(MotoShapeCache *self, MotoShapeCacheEntry *entry)
+{
+    g_queue_delete_link(& self->lru, entry->link);
+    self->size -= entry->size;
+    g_hash_table_remove(self->entries, entry->key);
+}
+
+/* Must be called with lock held. */
+static void trim(MotoShapeCache *self)
+{
+    while(self->size > self->budget && self->lru.tail)
+        remove_entry(self, (MotoShapeCacheEntry *)self->lru.tail->data);
+}
+
+MotoShapeCache *moto_shape_cache_new(gsize budget)
+{
+    MotoShapeCache *self = g_slice_new(MotoShapeCache);
+
+    /* Entry owns its key. */
+    self->entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+        NULL, (GDestroyNotify)entry_free);
+    g_queue_init(& self->lru);
+    self->budget = budget;
+    self->size = 0;
+    self->mutex = g_mutex_new();
+
+    return self;
+}
+
+void moto_shape_cache_free(MotoShapeCache *self)
+{
+    g_queue_clear(& self->lru);
+    g_hash_table_destroy(self->entries);
+    g_mutex_free(self->mutex);
+    g_slice_free(MotoShapeCache, self);
+}
+
+void moto_shape_cache_set_budget(MotoShapeCache *self, gsize budget)
+{
+    g_mutex_lock(self->mutex);
+    self->budget = budget;
+    trim(self);
+    g_mutex_unlock(self->mutex);
+}
+
+gsize moto_shape_cache_get_budget(MotoShapeCache *self)
+{
+    return self->budget;
+}
+
+gsize moto_shape_cache_get_size(MotoShapeCache *self)
+{
+    g_mutex_lock(self->mutex);
+    gsize size = self->size;
+    g_mutex_unlock(self->mutex);
+
+    return size;
+}
+
+MotoShape *moto_shape_cache_lookup(MotoShapeCache *self, const gchar *key)
+{
+    g_mutex_lock(self->mutex);
+
+    MotoShape *shape = NULL;
+    MotoShapeCacheEntry *entry = g_hash_table_lookup(self->entries, key);
+    if(entry)
+    {
+        g_queue_unlink(& self->lru, entry->link);
+        g_queue_push_head_link(& self->lru, entry->link);
+        shape = g_object_ref(entry->shape);
+    }
+
+    g_mutex_unlock(self->mutex);
+
+    return shape;
+}
+
+void moto_shape_cache_insert(MotoShapeCache *self, const gchar *key, MotoShape *shape)
+{
+    gsize size = estimate_size(shape);
+
+    g_mutex_lock(self->mutex);
+
+    MotoShapeCacheEntry *old = g_hash_table_lookup(self->entries, key);
+    if(old)
+        remove_entry(self, old);
+
+    /* Shape which doesn't fit at all would only push out everything else. */
+    if(size <= self->budget)
+    {
+        MotoShapeCacheEntry *entry = g_slice_new(MotoShapeCacheEntry);
+        entry->key   = g_strdup(key);
+        entry->shape = g_object_ref(shape);
+        entry->size  = size;
+
+        g_queue_push_head(& self->lru, entry);
+        entry->link = self->lru.head;
+        g_hash_table_insert(self->entries, entry->key, entry);
+        self->size += size;
+
+        trim(self);
+    }
+
+    g_mutex_unlock(self->mutex);
+}
+
+void moto_shape_cache_clear(MotoShapeCache *self)
+{
+    g_mutex_lock(self->mutex);
+    g_queue_clear(& self->lru);
+    g_hash_table_remove_all(self->entries);
+    self->size = 0;
+    g_mutex_unlock(self->mutex);
+}
@@ -0,0 +1,49 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_SHAPE_CACHE_H__
+#define __MOTO_SHAPE_CACHE_H__
+
+#include "moto-forward.h"
+#include "moto-shape.h"
+
+G_BEGIN_DECLS
+
+/* Shapes made by nodes keyed by hash of everything they depend on (see
+ * moto_op_node_get_cache_key). Least recently used shapes are dropped when
+ * total size is over budget. May be used from several update threads. */
+
+MotoShapeCache *moto_shape_cache_new(gsize budget);
+void moto_shape_cache_free(MotoShapeCache *self);
+
+void moto_shape_cache_set_budget(MotoShapeCache *self, gsize budget);
+gsize moto_shape_cache_get_budget(MotoShapeCache *self);
+/* Approximate memory used by cached shapes in bytes. */
+gsize moto_shape_cache_get_size(MotoShapeCache *self);
+
+/* Returns new reference or NULL. */
+MotoShape *moto_shape_cache_lookup(MotoShapeCache *self, const gchar *key);
+void moto_shape_cache_insert(MotoShapeCache *self, const gchar *key, MotoShape *shape);
+void moto_shape_cache_clear(MotoShapeCache *self);
+
+G_END_DECLS
+
+#endif /* __MOTO_SHAPE_CACHE_H__ */
@@ -8,6 +8,12 @@
 #include "moto-shape-node.h"
 #include "moto-shape.h"
 #include "moto-mesh.h"
+#include "moto-mesh-lod.h"
+#include "moto-profiler.h"
+
+#ifndef CALLBACK
+#define CALLBACK
+#endif
 
 static MotoBound*
 moto_shape_node_get_bound_DEFAULT(MotoShapeNode* self);
@@ -37,6 +43,37 @@ typedef enum
     VBUF_NUMBER
 } MotoVBufs;
 
+/* Retained render data for faces. Triangles are built over face corners
+ * and every corner holds position, face normal and vertex normal, so one
+ * index buffer is used both for flat and smooth drawing. */
+
+typedef enum
+{
+    RBUF_VERTEX,
+    RBUF_ELEMENT,
+    RBUF_NUMBER
+} MotoRBufs;
+
+#define RDATA_STRIDE 9
+#define RDATA_FLAT_NORMAL   3
+#define RDATA_SMOOTH_NORMAL 6
+
+typedef struct _MotoRenderData
+{
+    gboolean ready;
+    gboolean dirty; /* Coords or normals are changed since last build. */
+    MotoMesh *mesh;
+
+    guint verts_num;
+    GLfloat *verts;
+    guint indices_num;
+    GLuint *indices;
+    guint *f_offsets; /* End of each face in indices. */
+
+    gboolean use_vbo;
+    GLuint rbufs[RBUF_NUMBER];
+} MotoRenderData;
+
 typedef struct _MotoShapeNodePriv MotoShapeNodePriv;
 
 #define MOTO_SHAPE_NODE_GET_PRIVATE(obj) G_TYPE_INSTANCE_GET_PRIVATE(obj, MOTO_TYPE_SHAPE_NODE, MotoShapeNodePriv)
@@ -51,14 +88,33 @@ struct _MotoShapeNodePriv
 
     GLuint dlist;
     GLuint vbufs[VBUF_NUMBER];
+    MotoMesh *vbufs_mesh; /* Mesh which vbufs are filled from. */
+    gboolean vbufs_dirty;
+
+    MotoRenderData rdata;
+
+    /* Levels of detail are built in background for geometry which
+     * isn't changed between two drawings. */
+    MotoMeshLod *lod;
+    guint lod_stamp;
+    guint geometry_stamp;
+    guint drawn_geometry_stamp;
 };
 
+static void moto_render_data_free(MotoRenderData *rd);
+static void moto_shape_node_delete_buffers(MotoShapeNode *self);
+
 static void
 moto_shape_node_dispose(GObject *obj)
 {
     MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(obj);
 
     g_object_unref(priv->bound);
+    moto_shape_node_delete_buffers((MotoShapeNode *)obj);
+    moto_render_data_free(& priv->rdata);
+    if(priv->lod)
+        moto_mesh_lod_unref(priv->lod);
+    priv->lod = NULL;
 
     shape_node_parent_class->dispose(obj);
 }
@@ -83,6 +139,15 @@ moto_shape_node_init(MotoShapeNode *self)
             NULL);
 
     priv->ready = FALSE;
+    memset(priv->vbufs, 0, sizeof(priv->vbufs));
+    priv->vbufs_mesh  = NULL;
+    priv->vbufs_dirty = FALSE;
+    memset(& priv->rdata, 0, sizeof(MotoRenderData));
+
+    priv->lod = NULL;
+    priv->lod_stamp = 0;
+    priv->geometry_stamp = 0;
+    priv->drawn_geometry_stamp = 0;
 }
 
 static void
@@ -134,19 +199,469 @@ MotoShape* moto_shape_node_get_shape(MotoShapeNode* self)
 void moto_shape_node_draw(MotoShapeNode* self, MotoDrawMode draw_mode,
     MotoShapeSelection* selection, MotoSelectionMode selection_mode)
 {
+    MOTO_PROFILE_BEGIN(scope);
+
     MOTO_SHAPE_NODE_GET_CLASS(self)->draw(self,
         draw_mode, selection, selection_mode);
+
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_DRAW, moto_node_get_interned_name((MotoNode *)self), self);
 }
 
 static void moto_shape_node_delete_buffers(MotoShapeNode *self)
 {
     MotoShapeNodePriv* priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
 
-    if(moto_gl_is_vbo_supported())
-    {
+    if(moto_gl_is_vbo_supported() && priv->vbufs[VBUF_VERTEX])
         glDeleteBuffersARB(VBUF_NUMBER, priv->vbufs);
-        memset(priv->vbufs, 0, VBUF_NUMBER);
+    memset(priv->vbufs, 0, sizeof(priv->vbufs));
+
+    if(priv->vbufs_mesh)
+        g_object_unref(priv->vbufs_mesh);
+    priv->vbufs_mesh = NULL;
+}
+
+static gboolean moto_shape_node_use_vbo(MotoShapeNode *self)
+{
+    MotoSceneNode *scene_node = \
+        moto_node_get_scene_node((MotoNode *)self);
+
+    gboolean force_arrays = FALSE;
+    if(scene_node)
+        force_arrays = ! moto_scene_node_get_use_vbo(scene_node);
+
+    return moto_gl_is_vbo_supported() && ! force_arrays;
+}
+
+/* Render data */
+
+static void moto_render_data_free(MotoRenderData *rd)
+{
+    if(rd->use_vbo && moto_gl_is_vbo_supported())
+        glDeleteBuffersARB(RBUF_NUMBER, rd->rbufs);
+
+    g_free(rd->verts);
+    g_free(rd->indices);
+    g_free(rd->f_offsets);
+    if(rd->mesh)
+        g_object_unref(rd->mesh);
+
+    memset(rd, 0, sizeof(MotoRenderData));
+}
+
+static inline guint face_end(MotoMesh *mesh, guint fi)
+{
+    return (mesh->b32) ? mesh->f_data32[fi].v_offset : mesh->f_data16[fi].v_offset;
+}
+
+static inline guint face_vert(MotoMesh *mesh, guint i)
+{
+    return (mesh->b32) ? mesh->f_verts32[i] : mesh->f_verts16[i];
+}
+
+/* Positions and normals of face corners. */
+static void moto_render_data_fill_verts(GLfloat *v, MotoMesh *mesh)
+{
+    guint i, j, start = 0;
+    for(i = 0; i < mesh->f_num; i++)
+    {
+        guint end = face_end(mesh, i);
+        gfloat *fn = (mesh->f_normals) ? (gfloat *)(mesh->f_normals + i) : NULL;
+
+        for(j = start; j < end; j++, v += RDATA_STRIDE)
+        {
+            guint vi = face_vert(mesh, j);
+            gfloat *p, *n;
+            gfloat packed[6];
+            if(moto_mesh_is_packed(mesh))
+            {
+                moto_mesh_decode_verts(mesh, vi, vi+1, packed, 0, packed + 3, 0);
+                p = packed;
+                n = packed + 3;
+            }
+            else
+            {
+                p = (gfloat *)(mesh->v_coords + vi);
+                n = (mesh->v_normals) ? (gfloat *)(mesh->v_normals + vi) : fn;
+            }
+            gfloat *f = (fn) ? fn : n;
+
+            v[0] = p[0]; v[1] = p[1]; v[2] = p[2];
+            if(f)
+            {
+                v[RDATA_FLAT_NORMAL]     = f[0];
+                v[RDATA_FLAT_NORMAL + 1] = f[1];
+                v[RDATA_FLAT_NORMAL + 2] = f[2];
+                v[RDATA_SMOOTH_NORMAL]     = n[0];
+                v[RDATA_SMOOTH_NORMAL + 1] = n[1];
+                v[RDATA_SMOOTH_NORMAL + 2] = n[2];
+            }
+            else
+                memset(v + RDATA_FLAT_NORMAL, 0, sizeof(GLfloat)*6);
+        }
+
+        start = end;
+    }
+}
+
+typedef struct _MotoRenderTess
+{
+    GLuint *t;
+    GLuint *end;
+} MotoRenderTess;
+
+typedef struct _MotoRenderTessVertex
+{
+    GLdouble coords[3];
+    GLuint corner;
+} MotoRenderTessVertex;
+
+static void CALLBACK render_tess_cb_vertex_data(void *vertex_data, void *user_data)
+{
+    MotoRenderTess *rt = (MotoRenderTess *)user_data;
+
+    /* Tesselation of simple polygon never has more than v_num - 2 triangles. */
+    if(rt->t < rt->end)
+        *(rt->t++) = ((MotoRenderTessVertex *)vertex_data)->corner;
+}
+
+static void CALLBACK render_tess_cb_edge_flag(GLboolean flag)
+{
+    // Just do nothing to force GL_TRIANGLES.
+}
+
+static gboolean moto_render_data_build(MotoRenderData *rd, MotoMesh *mesh)
+{
+    /* Only 16-bit meshes have own tesselation, n-gons of others are tesselated here. */
+    gboolean use_tess = mesh->tesselated && ! mesh->b32 && mesh->f_tess_verts;
+
+    guint i, j;
+    guint indices_num = 0;
+    if(use_tess)
+        indices_num = mesh->f_tess_num*3;
+    else
+    {
+        for(i = 0; i < mesh->f_num; i++)
+        {
+            guint v_num = face_end(mesh, i) - ((0 == i) ? 0 : face_end(mesh, i-1));
+            if(v_num > 2)
+                indices_num += (v_num - 2)*3;
+        }
+    }
+
+    rd->verts_num   = mesh->f_v_num;
+    rd->indices_num = indices_num;
+    rd->verts     = g_try_malloc(sizeof(GLfloat)*RDATA_STRIDE*rd->verts_num);
+    rd->indices   = g_try_malloc(sizeof(GLuint)*rd->indices_num);
+    rd->f_offsets = g_try_malloc(sizeof(guint)*mesh->f_num);
+    if(( ! rd->verts && rd->verts_num) || ( ! rd->indices && rd->indices_num) ||
+       ( ! rd->f_offsets && mesh->f_num))
+    {
+        moto_error("Not enough memory for render data of mesh (%u faces)", mesh->f_num);
+        return FALSE;
+    }
+
+    moto_render_data_fill_verts(rd->verts, mesh);
+
+    GLUtesselator *tess = NULL;
+    MotoRenderTess rt = {NULL, NULL};
+    if( ! use_tess)
+    {
+        tess = gluNewTess();
+        gluTessCallback(tess, GLU_TESS_VERTEX_DATA, render_tess_cb_vertex_data);
+        gluTessCallback(tess, GLU_TESS_EDGE_FLAG, render_tess_cb_edge_flag); // Force GL_TRIANGLES.
+    }
+
+    GLuint *t  = rd->indices;
+    guint start = 0;
+    for(i = 0; i < mesh->f_num; i++)
+    {
+        guint end = face_end(mesh, i);
+
+        if(use_tess)
+        {
+            /* Tesselation refers to mesh verts, mapping them to face corners. */
+            guint tess_start = (0 == i) ? 0 : mesh->f_data16[i-1].v_tess_offset;
+            guint tess_end   = mesh->f_data16[i].v_tess_offset;
+            guint k;
+            for(k = tess_start; k < tess_end; k++)
+            {
+                guint vi = mesh->f_tess_verts16[k];
+                guint c = start;
+                for(j = start; j < end; j++)
+                {
+                    if(face_vert(mesh, j) == vi)
+                    {
+                        c = j;
+                        break;
+                    }
+                }
+                *(t++) = c;
+            }
+        }
+        else if(end - start == 3)
+        {
+            *(t++) = start;
+            *(t++) = start + 1;
+            *(t++) = start + 2;
+        }
+        else if(end - start > 3)
+        {
+            /* Corners are taken from render verts, so packed meshes are handled too. */
+            MotoRenderTessVertex tess_verts[end - start];
+
+            rt.t   = t;
+            rt.end = t + (end - start - 2)*3;
+
+            gluTessBeginPolygon(tess, & rt);
+            gluTessBeginContour(tess);
+            for(j = start; j < end; j++)
+            {
+                MotoRenderTessVertex *tv = tess_verts + j - start;
+                GLfloat *v = rd->verts + j*RDATA_STRIDE;
+                tv->coords[0] = v[0];
+                tv->coords[1] = v[1];
+                tv->coords[2] = v[2];
+                tv->corner = j;
+                gluTessVertex(tess, tv->coords, tv);
+            }
+            gluTessEndContour(tess);
+            gluTessEndPolygon(tess);
+
+            /* Degenerate triangles may be dropped. */
+            t = rt.t;
+        }
+
+        rd->f_offsets[i] = t - rd->indices;
+        start = end;
+    }
+
+    if(tess)
+        gluDeleteTess(tess);
+
+    /* Count for fans is an upper bound of tesselation. */
+    rd->indices_num = t - rd->indices;
+
+    return TRUE;
+}
+
+static gboolean moto_render_data_upload(MotoRenderData *rd)
+{
+    glGenBuffersARB(RBUF_NUMBER, rd->rbufs);
+
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, rd->rbufs[RBUF_VERTEX]);
+    glBufferDataARB(GL_ARRAY_BUFFER_ARB, sizeof(GLfloat)*RDATA_STRIDE*rd->verts_num,
+            rd->verts, GL_STATIC_DRAW_ARB);
+
+    glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, rd->rbufs[RBUF_ELEMENT]);
+    glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, sizeof(GLuint)*rd->indices_num,
+            rd->indices, GL_STATIC_DRAW_ARB);
+
+    GLenum error = glGetError();
+
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+    glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+
+    if(GL_NO_ERROR != error)
+    {
+        glDeleteBuffersARB(RBUF_NUMBER, rd->rbufs);
+        memset(rd->rbufs, 0, sizeof(rd->rbufs));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Refills only the vertex stream, indices stay as they are. */
+static gboolean moto_render_data_update_verts(MotoRenderData *rd, MotoMesh *mesh)
+{
+    if( ! rd->use_vbo)
+    {
+        moto_render_data_fill_verts(rd->verts, mesh);
+        return TRUE;
+    }
+
+    gsize size = sizeof(GLfloat)*RDATA_STRIDE*rd->verts_num;
+
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, rd->rbufs[RBUF_VERTEX]);
+
+    /* Orphaning old storage, so we don't wait while it's used by previous frame. */
+    glBufferDataARB(GL_ARRAY_BUFFER_ARB, size, NULL, GL_STREAM_DRAW_ARB);
+    GLfloat *v = (GLfloat *)glMapBufferARB(GL_ARRAY_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+    gboolean ok = FALSE;
+    if(v)
+    {
+        moto_render_data_fill_verts(v, mesh);
+        ok = glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
     }
+
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+    return ok;
+}
+
+static MotoRenderData *moto_shape_node_build_render_data(MotoShapeNode *self, MotoMesh *mesh)
+{
+    MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
+    MotoRenderData *rd = & priv->rdata;
+
+    if(rd->ready && mesh->f_v_num == rd->verts_num &&
+       moto_shape_is_struct_the_same((MotoShape *)rd->mesh, (MotoShape *)mesh))
+    {
+        if(moto_render_data_update_verts(rd, mesh))
+        {
+            g_object_ref(mesh);
+            g_object_unref(rd->mesh);
+            rd->mesh  = mesh;
+            rd->dirty = FALSE;
+            return rd;
+        }
+    }
+
+    moto_render_data_free(rd);
+
+    if( ! moto_render_data_build(rd, mesh))
+    {
+        moto_render_data_free(rd);
+        return NULL;
+    }
+
+    if(moto_shape_node_use_vbo(self) && rd->indices_num)
+    {
+        rd->use_vbo = moto_render_data_upload(rd);
+        if(rd->use_vbo)
+        {
+            /* Geometry is on the server side now. */
+            g_free(rd->verts);
+            g_free(rd->indices);
+            rd->verts   = NULL;
+            rd->indices = NULL;
+        }
+    }
+
+    rd->mesh  = g_object_ref(mesh);
+    rd->ready = TRUE;
+    return rd;
+}
+
+static MotoRenderData *moto_shape_node_get_render_data(MotoShapeNode *self, MotoMesh *mesh)
+{
+    MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
+    MotoRenderData *rd = & priv->rdata;
+
+    if(rd->ready && ! rd->dirty && rd->mesh == mesh)
+        return rd;
+
+    MOTO_PROFILE_BEGIN(scope);
+    rd = moto_shape_node_build_render_data(self, mesh);
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_BUILD, moto_node_get_interned_name((MotoNode *)self), self);
+
+    return rd;
+}
+
+/* Sets vertex and normal arrays from render data. Returns base of indices. */
+static const GLubyte *moto_render_data_bind(MotoRenderData *rd, gboolean smooth)
+{
+    const GLubyte *vbase = (rd->use_vbo) ? NULL : (GLubyte *)rd->verts;
+    const GLsizei stride = sizeof(GLfloat)*RDATA_STRIDE;
+    const guint normal = (smooth) ? RDATA_SMOOTH_NORMAL : RDATA_FLAT_NORMAL;
+
+    if(rd->use_vbo)
+    {
+        glBindBufferARB(GL_ARRAY_BUFFER_ARB, rd->rbufs[RBUF_VERTEX]);
+        glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, rd->rbufs[RBUF_ELEMENT]);
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, vbase);
+    glNormalPointer(GL_FLOAT, stride, vbase + sizeof(GLfloat)*normal);
+
+    return (rd->use_vbo) ? NULL : (GLubyte *)rd->indices;
+}
+
+static void moto_render_data_unbind(MotoRenderData *rd)
+{
+    if(rd->use_vbo)
+    {
+        glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+        glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+    }
+}
+
+/* Draws faces of mesh from retained render data with one call.
+ * If selection is not NULL only selected faces are drawn. */
+static void moto_shape_node_draw_faces(MotoShapeNode *self, MotoMesh *mesh,
+        gboolean smooth, MotoShapeSelection *selection)
+{
+    MotoRenderData *rd = moto_shape_node_get_render_data(self, mesh);
+    if( ! rd || ! rd->indices_num)
+        return;
+
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+    const GLubyte *ibase = moto_render_data_bind(rd, smooth);
+
+    if( ! selection)
+    {
+        glDrawElements(GL_TRIANGLES, rd->indices_num, GL_UNSIGNED_INT, ibase);
+    }
+    else
+    {
+        /* Runs of neighbour selected faces are drawn together. */
+        guint i, start = 0, run = 0;
+        for(i = 0; i < mesh->f_num; i++)
+        {
+            guint f_start = (0 == i) ? 0 : rd->f_offsets[i-1];
+            if( ! moto_shape_selection_check_face(selection, i))
+            {
+                if(run)
+                    glDrawElements(GL_TRIANGLES, run, GL_UNSIGNED_INT, ibase + sizeof(GLuint)*start);
+                run = 0;
+                continue;
+            }
+
+            if( ! run)
+                start = f_start;
+            run += rd->f_offsets[i] - f_start;
+        }
+        if(run)
+            glDrawElements(GL_TRIANGLES, run, GL_UNSIGNED_INT, ibase + sizeof(GLuint)*start);
+    }
+
+    moto_render_data_unbind(rd);
+
+    glPopClientAttrib();
+}
+
+gboolean moto_shape_node_draw_instanced(MotoShapeNode* self, MotoDrawMode draw_mode,
+    gint instances_num)
+{
+    if( ! GLEW_ARB_draw_instanced)
+        return FALSE;
+
+    if(MOTO_DRAW_MODE_SOLID != draw_mode && MOTO_DRAW_MODE_SMOOTH != draw_mode &&
+       MOTO_DRAW_MODE_SHADED != draw_mode)
+        return FALSE;
+
+    MotoShape* shape = moto_shape_node_get_shape(self);
+    if( ! MOTO_IS_MESH(shape))
+        return FALSE;
+
+    MotoRenderData *rd = moto_shape_node_get_render_data(self, (MotoMesh*)shape);
+    if( ! rd)
+        return FALSE;
+    if( ! rd->indices_num || instances_num <= 0)
+        return TRUE;
+
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+    const GLubyte *ibase = moto_render_data_bind(rd, MOTO_DRAW_MODE_SOLID != draw_mode);
+    glDrawElementsInstancedARB(GL_TRIANGLES, rd->indices_num, GL_UNSIGNED_INT, ibase, instances_num);
+    moto_render_data_unbind(rd);
+
+    glPopClientAttrib();
+
+    return TRUE;
 }
 
 static void moto_shape_node_draw_WIREFRAME_BBOX(MotoShapeNode* self, MotoShapeSelection* selection)
@@ -293,12 +808,93 @@ static void moto_shape_node_draw_WIREFRAME_OBJECT(MotoShapeNode* self, MotoShape
     glPopAttrib();
 }
 
-static void moto_shape_node_draw_WIREFRAME_VERTEX(MotoShapeNode* self, MotoShapeSelection* selection)
+static gboolean moto_shape_node_upload_vbufs(MotoShapeNode *self, MotoMesh *mesh)
 {
     MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
 
-    MotoSceneNode *scene_node = \
-        moto_node_get_scene_node((MotoNode *)self);
+    gsize v_size = mesh->v_num * sizeof(MotoVector);
+
+    if(glIsBufferARB(priv->vbufs[VBUF_VERTEX]))
+    {
+        if(priv->vbufs_mesh && moto_shape_is_struct_the_same((MotoShape *)priv->vbufs_mesh, (MotoShape *)mesh))
+        {
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_VERTEX]);
+            glBufferDataARB(GL_ARRAY_BUFFER_ARB, v_size, NULL, GL_STREAM_DRAW_ARB);
+            glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, v_size, mesh->v_coords);
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+            if(GL_NO_ERROR == glGetError())
+            {
+                g_object_ref(mesh);
+                g_object_unref(priv->vbufs_mesh);
+                priv->vbufs_mesh  = mesh;
+                priv->vbufs_dirty = FALSE;
+                return TRUE;
+            }
+        }
+
+        moto_shape_node_delete_buffers(self);
+    }
+
+    g_print("Initializng VBO for wireframe drawing modes ... ");
+
+    glGenBuffersARB(VBUF_NUMBER, priv->vbufs);
+
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_VERTEX]);
+    glBufferDataARB(GL_ARRAY_BUFFER_ARB, v_size, mesh->v_coords,  GL_STATIC_DRAW_ARB);
+
+    glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_LINE_ELEMENT]);
+    glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB,
+            moto_mesh_get_index_size(mesh) * mesh->e_num * 2,
+            mesh->e_verts, GL_STATIC_DRAW_ARB);
+
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+    glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+
+    GLenum error = glGetError();
+    switch(error)
+    {
+        case GL_NO_ERROR:
+            // Ok
+        break;
+        case GL_OUT_OF_MEMORY:
+        // break;
+        default:
+            // Unknown Error
+            moto_shape_node_delete_buffers(self);
+            g_print("Failed\n");
+        return FALSE;
+    }
+    g_print("OK\n");
+
+    priv->vbufs_mesh  = g_object_ref(mesh);
+    priv->vbufs_dirty = FALSE;
+
+    return TRUE;
+}
+
+/* Vertex buffer with coords and element buffer with edges shared by
+ * wireframe modes. When only coords are changed edges stay resident. */
+static gboolean moto_shape_node_prepare_vbufs(MotoShapeNode *self, MotoMesh *mesh)
+{
+    MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
+
+    if( ! moto_shape_node_use_vbo(self))
+        return FALSE;
+
+    if(glIsBufferARB(priv->vbufs[VBUF_VERTEX]) && ! priv->vbufs_dirty && priv->vbufs_mesh == mesh)
+        return TRUE;
+
+    MOTO_PROFILE_BEGIN(scope);
+    gboolean ok = moto_shape_node_upload_vbufs(self, mesh);
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_BUILD, moto_node_get_interned_name((MotoNode *)self), self);
+
+    return ok;
+}
+
+static void moto_shape_node_draw_WIREFRAME_VERTEX(MotoShapeNode* self, MotoShapeSelection* selection)
+{
+    MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
 
     MotoShape* shape = moto_shape_node_get_shape(self);
     if(MOTO_IS_MESH(shape))
@@ -314,91 +910,23 @@ static void moto_shape_node_draw_WIREFRAME_VERTEX(MotoShapeNode* self, MotoShape
         glEnableClientState(GL_VERTEX_ARRAY);
         glDepthFunc(GL_LEQUAL);
 
-        gboolean force_arrays = FALSE;
-        if(scene_node)
-            force_arrays = ! moto_scene_node_get_use_vbo(scene_node);
-
-        gboolean using_vbo = TRUE;
-        if(moto_gl_is_vbo_supported() && ! force_arrays) // vbo
+        if(moto_shape_node_prepare_vbufs(self, mesh))
         {
-            g_print("Initializng VBO for 'vertex' drawing mode ... ");
-            if( ! glIsBufferARB(priv->vbufs[VBUF_VERTEX]))
-            {
-                GLenum error;
-
-                glGenBuffersARB(VBUF_NUMBER, priv->vbufs);
-
-                glBindBufferARB(GL_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_VERTEX]);
-                glBufferDataARB(GL_ARRAY_BUFFER_ARB, mesh->v_num * sizeof(MotoVector), mesh->v_coords,  GL_STATIC_DRAW_ARB);
-
-                error = glGetError();
-                switch(error)
-                {
-                    case GL_NO_ERROR:
-                        // Ok
-                    break;
-                    case GL_OUT_OF_MEMORY:
-                    // break;
-                    default:
-                        // Unknown Error
-                        moto_shape_node_delete_buffers(self);
-                        using_vbo = FALSE;
-                    break;
-                }
-
-                glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_ELEMENT]);
-                glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB,
-                        moto_mesh_get_index_size(mesh) * mesh->e_num * 2,
-                        mesh->e_verts, GL_STATIC_DRAW_ARB);
-
-                error = glGetError();
-                switch(error)
-                {
-                    case GL_NO_ERROR:
-                        // Ok
-                    break;
-                    case GL_OUT_OF_MEMORY:
-                    // break;
-                    default:
-                        // Unknown Error
-                        moto_shape_node_delete_buffers(self);
-                        using_vbo = FALSE;
-                    break;
-                }
-
-                glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-                glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
-            }
-
-            if(using_vbo)
-            {
-                g_print("OK\n");
-
-                glBindBufferARB(GL_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_VERTEX]);
-                glVertexPointer(3, GL_FLOAT, sizeof(MotoVector), 0);
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_VERTEX]);
+            glVertexPointer(3, GL_FLOAT, sizeof(MotoVector), 0);
 
-                glColor4f(0.6, 0.6, 0.6, 1.0);
-                glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_ELEMENT]);
-                glDrawElements(GL_LINES, 2*mesh->e_num, mesh->index_gl_type, 0);
+            glColor4f(0.6, 0.6, 0.6, 1.0);
+            glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_LINE_ELEMENT]);
+            glDrawElements(GL_LINES, 2*mesh->e_num, mesh->index_gl_type, 0);
 
-                glColor4f(1, 0.1, 0.1, 1);
-                glPointSize(3);
-                glDrawArrays(GL_POINTS, 0, mesh->v_num);
+            glColor4f(1, 0.1, 0.1, 1);
+            glPointSize(3);
+            glDrawArrays(GL_POINTS, 0, mesh->v_num);
 
-                glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-                glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
-            }
-            else
-            {
-                g_print("Failed\n");
-            }
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+            glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
         }
         else // vertex arrays
-        {
-            using_vbo = FALSE;
-        }
-
-        if( ! using_vbo)
         {
             glVertexPointer(3, GL_FLOAT, sizeof(MotoVector), mesh->v_coords);
 
@@ -433,9 +961,6 @@ static void moto_shape_node_draw_WIREFRAME_EDGE(MotoShapeNode* self, MotoShapeSe
 {
     MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
 
-    MotoSceneNode* scene_node = \
-        moto_node_get_scene_node((MotoNode*)self);
-
     MotoShape* shape = moto_shape_node_get_shape(self);
     if(MOTO_IS_MESH(shape))
     {
@@ -451,29 +976,8 @@ static void moto_shape_node_draw_WIREFRAME_EDGE(MotoShapeNode* self, MotoShapeSe
 
         glEnableClientState(GL_VERTEX_ARRAY);
 
-        gboolean force_arrays = FALSE;
-        if(scene_node)
-            force_arrays = ! moto_scene_node_get_use_vbo(scene_node);
-        if(moto_gl_is_vbo_supported() && ! force_arrays) // vbo
+        if(moto_shape_node_prepare_vbufs(self, mesh))
         {
-            g_print("Initializng VBO for 'edge' drawing mode ... ");
-            if( ! glIsBufferARB(priv->vbufs[VBUF_VERTEX]))
-            {
-                glGenBuffersARB(VBUF_NUMBER, priv->vbufs);
-
-                glBindBufferARB(GL_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_VERTEX]);
-                glBufferDataARB(GL_ARRAY_BUFFER_ARB, mesh->v_num * sizeof(MotoVector), mesh->v_coords,  GL_STATIC_DRAW_ARB);
-
-                glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_LINE_ELEMENT]);
-                glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB,
-                        moto_mesh_get_index_size(mesh) * mesh->e_num * 2,
-                        mesh->e_verts, GL_STATIC_DRAW_ARB);
-
-                glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-                glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
-            }
-            g_print("OK\n");
-
             glBindBufferARB(GL_ARRAY_BUFFER_ARB, priv->vbufs[VBUF_VERTEX]);
             glVertexPointer(3, GL_FLOAT, sizeof(MotoVector), 0);
 
@@ -531,55 +1035,6 @@ static void moto_shape_node_draw_WIREFRAME_EDGE(MotoShapeNode* self, MotoShapeSe
     }
 }
 
-static void on_tess_vertex(void* vertex_data)
-{
-    glVertex3dv(vertex_data);
-}
-
-static void on_tess_vertex_normal(void* vertex_data)
-{
-    glNormal3dv(((GLdouble*)vertex_data)+3);
-    glVertex3dv(vertex_data);
-}
-
-static void on_tess_begin(GLenum which)
-{
-    glBegin(which);
-}
-
-static void on_tess_end(void)
-{
-    glEnd();
-}
-
-static void on_tess_error(GLenum errno)
-{
-    g_print("Tesselation error: %s (%d)\n", gluErrorString(errno), errno);
-}
-
-static void on_tess_combine(GLdouble coords[3],
-                            GLdouble* vertex_data[4],
-                            GLfloat weight[4], GLdouble** dataOut)
-{
-    GLdouble *vertex;
-
-    vertex = (GLdouble*)g_try_malloc(6*sizeof(GLdouble));
-    vertex[0] = coords[0];
-    vertex[1] = coords[1];
-    vertex[2] = coords[2];
-
-    gint i;
-    for(i = 3; i < 6 ; ++i)
-    {
-          vertex[i] = weight[0] * vertex_data[0][i] + \
-                      weight[1] * vertex_data[1][i] + \
-                      weight[2] * vertex_data[2][i] + \
-                      weight[3] * vertex_data[3][i];
-    }
-
-    *dataOut=vertex;
-}
-
 static unsigned long stipple_mask[] = {
   0xAAAAAAAA, 0x55555555, 0xAAAAAAAA, 0x55555555,
   0xAAAAAAAA, 0x55555555, 0xAAAAAAAA, 0x55555555,
@@ -593,8 +1048,6 @@ static unsigned long stipple_mask[] = {
 
 static void moto_shape_node_draw_WIREFRAME_FACE(MotoShapeNode* self, MotoShapeSelection* selection)
 {
-    MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
-
     MotoSceneNode *scene_node = \
         moto_node_get_scene_node((MotoNode *)self);
 
@@ -619,60 +1072,18 @@ static void moto_shape_node_draw_WIREFRAME_FACE(MotoShapeNode* self, MotoShapeSe
             glEnable(GL_CULL_FACE);
         glCullFace(GL_BACK);
 
-        MotoMeshFace16 *f_data = (MotoMeshFace16 *)mesh->f_data;
-        guint16 *f_verts = (guint16 *)mesh->f_verts;
-
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
         glEnable(GL_POLYGON_OFFSET_FILL);
         glPolygonOffset(2, 1);
 
-        GLUtesselator* tess = gluNewTess();
-
-        gluTessCallback(tess, GLU_TESS_VERTEX, on_tess_vertex);
-        gluTessCallback(tess, GLU_TESS_BEGIN, on_tess_begin);
-        gluTessCallback(tess, GLU_TESS_END, on_tess_end);
-        gluTessCallback(tess, GLU_TESS_ERROR, on_tess_error);
-        gluTessCallback(tess, GLU_TESS_COMBINE, on_tess_combine);
-
-        gboolean show_normals = moto_scene_node_get_show_normals(scene_node);
         MotoDrawMode draw_mode = moto_scene_node_get_draw_mode(scene_node);
 
         glEnable(GL_LIGHTING);
 
-        guint i, j;
         if(MOTO_DRAW_MODE_SOLID == draw_mode)
         {
-            gluTessCallback(tess, GLU_TESS_VERTEX, on_tess_vertex);
-            for(i = 0; i < mesh->f_num; ++i)
-            {
-                guint start = (0 == i) ? 0: f_data[i-1].v_offset;
-                guint v_num = f_data[i].v_offset - start;
-
-                glColor4f(1, 1, 1, 1);
-
-                if(!selection || !moto_shape_selection_check_face(selection, i))
-                {
-                    GLdouble verts[v_num*3];
-
-                    glNormal3fv((GLfloat*)( & mesh->f_normals[i]));
-                    gluTessBeginPolygon(tess, NULL);
-                    gluTessBeginContour(tess);
-                    guint j;
-                    for(j = 0; j < v_num; ++j)
-                    {
-                        float* v0 = (float*) & mesh->v_coords[f_verts[start + j]];
-                        float* n0 = (float*) & mesh->f_normals[i];
-                        GLdouble* v = verts + j*3;
-                        v[0] = v0[0];
-                        v[1] = v0[1];
-                        v[2] = v0[2];
-                        gluTessVertex(tess, v, v);
-                    }
-                    gluTessEndContour(tess);
-                    gluTessEndPolygon(tess);
-                }
-            }
+            moto_shape_node_draw_faces(self, mesh, FALSE, NULL);
         }
         else if(MOTO_DRAW_MODE_WIREFRAME == draw_mode)
         {
@@ -681,63 +1092,16 @@ static void moto_shape_node_draw_WIREFRAME_FACE(MotoShapeNode* self, MotoShapeSe
         }
         else
         {
-            gluTessCallback(tess, GLU_TESS_VERTEX, on_tess_vertex_normal);
-            for(i = 0; i < mesh->f_num; ++i)
-            {
-                guint start = (0 == i) ? 0: f_data[i-1].v_offset;
-                guint v_num = f_data[i].v_offset - start;
-
-                glColor4f(1, 1, 1, 1);
-
-                if(!selection || !moto_shape_selection_check_face(selection, i))
-                {
-                    GLdouble verts[v_num*6];
-
-                    gluTessBeginPolygon(tess, NULL);
-                    gluTessBeginContour(tess);
-                    guint j;
-                    for(j = 0; j < v_num; ++j)
-                    {
-                        guint vi = f_verts[start + j];
-                        float* v0 = (float*) & mesh->v_coords[vi];
-                        float* n0 = (float*) & mesh->v_normals[vi];
-                        GLdouble* v = verts + j*6;
-                        v[0] = v0[0];
-                        v[1] = v0[1];
-                        v[2] = v0[2];
-                        v[3] = n0[0];
-                        v[4] = n0[1];
-                        v[5] = n0[2];
-                        gluTessVertex(tess, v, v);
-                    }
-                    gluTessEndContour(tess);
-                    gluTessEndPolygon(tess);
-                }
-            }
+            moto_shape_node_draw_faces(self, mesh, TRUE, NULL);
         }
 
         glDisable(GL_LIGHTING);
         glDisable(GL_CULL_FACE);
 
-        for(i = 0; i < mesh->f_num; ++i)
-        {
-            guint start = (0 == i) ? 0: f_data[i-1].v_offset;
-            guint v_num = f_data[i].v_offset - start;
-
-            glColor4f(0, 1, 0, 1);
-
-            if(selection && moto_shape_selection_check_face(selection, i))
-            {
-                glBegin(GL_POLYGON);
-                for(j = 0; j < v_num; j++)
-                {
-                    glVertex3fv((GLfloat *)( & mesh->v_coords[f_verts[start + j]]));
-                }
-                glEnd();
-            }
-        }
-
-        gluDeleteTess(tess);
+        /* Selected faces over the same triangles. */
+        glColor4f(0, 1, 0, 1);
+        if(selection)
+            moto_shape_node_draw_faces(self, mesh, FALSE, selection);
 
         glDisable(GL_POLYGON_OFFSET_FILL);
 
@@ -745,15 +1109,63 @@ static void moto_shape_node_draw_WIREFRAME_FACE(MotoShapeNode* self, MotoShapeSe
 
         glDrawElements(GL_LINES, 2*mesh->e_num, mesh->index_gl_type, mesh->e_verts);
 
-        glPopAttrib();
         glPopClientAttrib();
+        glPopAttrib();
     }
 }
 
-static void moto_shape_node_draw_SOLID_OBJECT(MotoShapeNode* self, MotoShapeSelection* selection)
+/* Unselected verts are drawn at once, selected ones over them. */
+static void draw_verts(MotoMesh *mesh, MotoShapeSelection* selection)
 {
-    MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
+    glDepthFunc(GL_LEQUAL);
 
+    glPointSize(3);
+    glColor3f(1, 0, 0);
+    glDrawArrays(GL_POINTS, 0, mesh->v_num);
+
+    if( ! selection)
+        return;
+
+    guint i;
+    glPointSize(4);
+    glColor3f(0, 1, 0);
+    glBegin(GL_POINTS);
+    for(i = 0; i < mesh->v_num; i++)
+    {
+        if(moto_shape_selection_check_vertex(selection, i))
+            glVertex3fv((GLfloat *)(mesh->v_coords + i));
+    }
+    glEnd();
+}
+
+/* Unselected edges are drawn at once with current color, selected ones over them. */
+static void draw_edges(MotoMesh *mesh, MotoShapeSelection* selection)
+{
+    glDepthFunc(GL_LEQUAL);
+
+    glLineWidth(1.0);
+    glDrawElements(GL_LINES, 2*mesh->e_num, mesh->index_gl_type, mesh->e_verts);
+
+    if( ! selection)
+        return;
+
+    guint i;
+    glLineWidth(2.0);
+    glColor3f(0, 1, 0);
+    glBegin(GL_LINES);
+    for(i = 0; i < mesh->e_num; i++)
+    {
+        if(moto_shape_selection_check_edge(selection, i))
+        {
+            glVertex3fv((GLfloat*)(&mesh->v_coords[mesh->e_verts16[i*2]]));
+            glVertex3fv((GLfloat*)(&mesh->v_coords[mesh->e_verts16[i*2 + 1]]));
+        }
+    }
+    glEnd();
+}
+
+static void moto_shape_node_draw_SOLID_OBJECT(MotoShapeNode* self, MotoShapeSelection* selection)
+{
     MotoSceneNode* scene_node = \
         moto_node_get_scene_node((MotoNode*)self);
 
@@ -774,44 +1186,7 @@ static void moto_shape_node_draw_SOLID_OBJECT(MotoShapeNode* self, MotoShapeSele
         else
             glDisable(GL_CULL_FACE);
 
-        MotoMeshFace16 *f_data = mesh->f_data16;
-        guint16 *f_verts = (guint16 *)mesh->f_verts;
-
-        GLUtesselator* tess = gluNewTess();
-
-        gluTessCallback(tess, GLU_TESS_VERTEX, on_tess_vertex);
-        gluTessCallback(tess, GLU_TESS_BEGIN, on_tess_begin);
-        gluTessCallback(tess, GLU_TESS_END, on_tess_end);
-        gluTessCallback(tess, GLU_TESS_ERROR, on_tess_error);
-        gluTessCallback(tess, GLU_TESS_COMBINE, on_tess_combine);
-
-        guint i;
-        for(i = 0; i < mesh->f_num; ++i)
-        {
-            guint start = (0 == i) ? 0: f_data[i-1].v_offset;
-            guint v_num = f_data[i].v_offset - start;
-
-            glColor4f(1, 1, 1, 1);
-
-            GLdouble verts[v_num*3];
-
-            glNormal3fv((GLfloat*)( & mesh->f_normals[i]));
-            gluTessBeginPolygon(tess, NULL);
-            gluTessBeginContour(tess);
-            guint j;
-            for(j = 0; j < v_num; ++j)
-            {
-                float* v0 = (float*) & mesh->v_coords[f_verts[start + j]];
-                float* n0 = (float*) & mesh->f_normals[i];
-                GLdouble* v = verts + j*3;
-                v[0] = v0[0];
-                v[1] = v0[1];
-                v[2] = v0[2];
-                gluTessVertex(tess, v, v);
-            }
-            gluTessEndContour(tess);
-            gluTessEndPolygon(tess);
-        }
+        moto_shape_node_draw_faces(self, mesh, FALSE, NULL);
 
         glPopAttrib();
     }
@@ -844,28 +1219,11 @@ static void moto_shape_node_draw_SOLID_VERTEX(MotoShapeNode* self, MotoShapeSele
 
         glDrawElements(GL_LINES, 2*mesh->e_num, mesh->index_gl_type, mesh->e_verts);
 
-        guint i;
-
-        glPointSize(3);
-        glColor3f(1, 0, 0);
-        glBegin(GL_POINTS);
-        for(i = 0; i < mesh->v_num; i++)
-        {
-            if(!selection || !moto_shape_selection_check_vertex(selection, i))
-                glVertex3fv((GLfloat *)(mesh->v_coords + i));
-        }
-        glEnd();
-
-        glPointSize(4);
-        glColor3f(0, 1, 0);
-        glBegin(GL_POINTS);
-        for(i = 0; i < mesh->v_num; i++)
-        {
-            if(selection && moto_shape_selection_check_vertex(selection, i))
-                glVertex3fv((GLfloat *)(mesh->v_coords + i));
-        }
-        glEnd();
+        draw_verts(mesh, selection);
     }
+
+    glPopClientAttrib();
+    glPopAttrib();
 }
 
 static void moto_shape_node_draw_SOLID_EDGE(MotoShapeNode* self, MotoShapeSelection* selection)
@@ -888,25 +1246,10 @@ static void moto_shape_node_draw_SOLID_EDGE(MotoShapeNode* self, MotoShapeSelect
         glDisable(GL_LIGHTING);
         glEnableClientState(GL_VERTEX_ARRAY);
 
-        glBegin(GL_LINES);
-        glColor3f(0, 1, 0);
-        glLineWidth(2.0);
-
-        gint isize = moto_mesh_get_index_size(mesh);
-
-        guint i;
-        for(i = 0; i < mesh->e_num; i++)
-        {
-            if(selection && moto_shape_selection_check_edge(selection, i))
-                glColor3f(0, 1, 0);
-            else
-                glColor3f(0.9, 0.1, 0.1);
-
-            glVertex3fv((GLfloat*)(&mesh->v_coords[mesh->e_verts16[i*2]]));
-            glVertex3fv((GLfloat*)(&mesh->v_coords[mesh->e_verts16[i*2 + 1]]));
-        }
+        glVertexPointer(3, GL_FLOAT, sizeof(MotoVector), mesh->v_coords);
 
-        glEnd();
+        glColor3f(0.9, 0.1, 0.1);
+        draw_edges(mesh, selection);
     }
 
     glPopClientAttrib();
@@ -921,8 +1264,6 @@ static void moto_shape_node_draw_SOLID_FACE(MotoShapeNode* self, MotoShapeSelect
     glEnable(GL_POLYGON_OFFSET_FILL);
     glPolygonOffset(2, 1);
 
-    // moto_shape_node_draw_SOLID_OBJECT(self, selection);
-
     MotoSceneNode* scene_node = \
         moto_node_get_scene_node((MotoNode*)self);
 
@@ -947,54 +1288,15 @@ static void moto_shape_node_draw_SOLID_FACE(MotoShapeNode* self, MotoShapeSelect
         else
             glDisable(GL_CULL_FACE);
 
-        MotoMeshFace16 *f_data = mesh->f_data16;
-        guint16 *f_verts = (guint16 *)mesh->f_verts;
-
-        GLUtesselator* tess = gluNewTess();
-
-        gluTessCallback(tess, GLU_TESS_VERTEX, on_tess_vertex);
-        gluTessCallback(tess, GLU_TESS_BEGIN, on_tess_begin);
-        gluTessCallback(tess, GLU_TESS_END, on_tess_end);
-        gluTessCallback(tess, GLU_TESS_ERROR, on_tess_error);
-        gluTessCallback(tess, GLU_TESS_COMBINE, on_tess_combine);
-
-        guint i;
-        for(i = 0; i < mesh->f_num; ++i)
-        {
-            guint start = (0 == i) ? 0: f_data[i-1].v_offset;
-            guint v_num = f_data[i].v_offset - start;
-
-            if(selection && moto_shape_selection_check_face(selection, i))
-            {
-                glDisable(GL_LIGHTING);
-                glColor3f(0, 1, 0);
-            }
-            else
-            {
-                glEnable(GL_LIGHTING);
-            }
-
-            GLdouble verts[v_num*3];
-
-            glNormal3fv((GLfloat*)( & mesh->f_normals[i]));
-            gluTessBeginPolygon(tess, NULL);
-            gluTessBeginContour(tess);
-            guint j;
-            for(j = 0; j < v_num; ++j)
-            {
-                float* v0 = (float*) & mesh->v_coords[f_verts[start + j]];
-                float* n0 = (float*) & mesh->f_normals[i];
-                GLdouble* v = verts + j*3;
-                v[0] = v0[0];
-                v[1] = v0[1];
-                v[2] = v0[2];
-                gluTessVertex(tess, v, v);
-            }
-            gluTessEndContour(tess);
-            gluTessEndPolygon(tess);
-        }
+        glEnable(GL_LIGHTING);
+        glColor4f(1, 1, 1, 1);
+        moto_shape_node_draw_faces(self, mesh, FALSE, NULL);
 
-        glPopAttrib();
+        glDisable(GL_LIGHTING);
+        glDepthFunc(GL_LEQUAL);
+        glColor3f(0, 1, 0);
+        if(selection)
+            moto_shape_node_draw_faces(self, mesh, FALSE, selection);
     }
 
     glPopClientAttrib();
@@ -1003,8 +1305,6 @@ static void moto_shape_node_draw_SOLID_FACE(MotoShapeNode* self, MotoShapeSelect
 
 static void moto_shape_node_draw_SMOOTH_OBJECT(MotoShapeNode* self, MotoShapeSelection* selection)
 {
-    MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
-
     MotoSceneNode* scene_node = \
         moto_node_get_scene_node((MotoNode*)self);
 
@@ -1021,52 +1321,10 @@ static void moto_shape_node_draw_SMOOTH_OBJECT(MotoShapeNode* self, MotoShapeSel
 
         if(moto_scene_node_get_cull_faces(scene_node))
             glEnable(GL_CULL_FACE);
-        else
-            glDisable(GL_CULL_FACE);
-
-        MotoMeshFace16 *f_data = mesh->f_data16;
-        guint16 *f_verts = (guint16 *)mesh->f_verts;
-
-        GLUtesselator* tess = gluNewTess();
-
-        gluTessCallback(tess, GLU_TESS_VERTEX, on_tess_vertex_normal);
-        gluTessCallback(tess, GLU_TESS_BEGIN, on_tess_begin);
-        gluTessCallback(tess, GLU_TESS_END, on_tess_end);
-        gluTessCallback(tess, GLU_TESS_ERROR, on_tess_error);
-        gluTessCallback(tess, GLU_TESS_COMBINE, on_tess_combine);
-
-        guint i;
-        for(i = 0; i < mesh->f_num; ++i)
-        {
-            guint start = (0 == i) ? 0: f_data[i-1].v_offset;
-            guint v_num = f_data[i].v_offset - start;
-
-            glColor4f(1, 1, 1, 1);
-
-            GLdouble verts[v_num*6];
-
-            gluTessBeginPolygon(tess, NULL);
-            gluTessBeginContour(tess);
-            guint j;
-            for(j = 0; j < v_num; ++j)
-            {
-                guint vi = f_verts[start + j];
-                gfloat* v0 = (float*) & mesh->v_coords[vi];
-                gfloat* n0 = (float*) & mesh->v_normals[vi];
-                GLdouble* v = verts + j*6;
-                v[0] = v0[0];
-                v[1] = v0[1];
-                v[2] = v0[2];
-                v[3] = n0[0];
-                v[4] = n0[1];
-                v[5] = n0[2];
-                gluTessVertex(tess, v, v);
-            }
-            gluTessEndContour(tess);
-            gluTessEndPolygon(tess);
-        }
+        else
+            glDisable(GL_CULL_FACE);
 
-        gluDeleteTess(tess);
+        moto_shape_node_draw_faces(self, mesh, TRUE, NULL);
 
         glPopAttrib();
     }
@@ -1099,28 +1357,11 @@ static void moto_shape_node_draw_SMOOTH_VERTEX(MotoShapeNode* self, MotoShapeSel
 
         glDrawElements(GL_LINES, 2*mesh->e_num, mesh->index_gl_type, mesh->e_verts);
 
-        guint i;
-
-        glPointSize(3);
-        glColor3f(1, 0, 0);
-        glBegin(GL_POINTS);
-        for(i = 0; i < mesh->v_num; i++)
-        {
-            if(!selection || !moto_shape_selection_check_vertex(selection, i))
-                glVertex3fv((GLfloat *)(mesh->v_coords + i));
-        }
-        glEnd();
-
-        glPointSize(4);
-        glColor3f(0, 1, 0);
-        glBegin(GL_POINTS);
-        for(i = 0; i < mesh->v_num; i++)
-        {
-            if(selection && moto_shape_selection_check_vertex(selection, i))
-                glVertex3fv((GLfloat *)(mesh->v_coords + i));
-        }
-        glEnd();
+        draw_verts(mesh, selection);
     }
+
+    glPopClientAttrib();
+    glPopAttrib();
 }
 
 static void moto_shape_node_draw_SMOOTH_EDGE(MotoShapeNode* self, MotoShapeSelection* selection)
@@ -1143,25 +1384,10 @@ static void moto_shape_node_draw_SMOOTH_EDGE(MotoShapeNode* self, MotoShapeSelec
         glDisable(GL_LIGHTING);
         glEnableClientState(GL_VERTEX_ARRAY);
 
-        glBegin(GL_LINES);
-        glColor3f(0, 1, 0);
-        glLineWidth(2.0);
-
-        gint isize = moto_mesh_get_index_size(mesh);
-
-        guint i;
-        for(i = 0; i < mesh->e_num; i++)
-        {
-            if(selection && moto_shape_selection_check_edge(selection, i))
-                glColor3f(0, 1, 0);
-            else
-                glColor3f(0.1, 0.1, 0.1);
-
-            glVertex3fv((GLfloat*)(&mesh->v_coords[mesh->e_verts16[i*2]]));
-            glVertex3fv((GLfloat*)(&mesh->v_coords[mesh->e_verts16[i*2 + 1]]));
-        }
+        glVertexPointer(3, GL_FLOAT, sizeof(MotoVector), mesh->v_coords);
 
-        glEnd();
+        glColor3f(0.1, 0.1, 0.1);
+        draw_edges(mesh, selection);
     }
 
     glPopClientAttrib();
@@ -1200,58 +1426,15 @@ static void moto_shape_node_draw_SMOOTH_FACE(MotoShapeNode* self, MotoShapeSelec
         else
             glDisable(GL_CULL_FACE);
 
-        MotoMeshFace16 *f_data = mesh->f_data16;
-        guint16 *f_verts = (guint16 *)mesh->f_verts;
-
-        GLUtesselator* tess = gluNewTess();
-
-        gluTessCallback(tess, GLU_TESS_VERTEX, on_tess_vertex_normal);
-        gluTessCallback(tess, GLU_TESS_BEGIN, on_tess_begin);
-        gluTessCallback(tess, GLU_TESS_END, on_tess_end);
-        gluTessCallback(tess, GLU_TESS_ERROR, on_tess_error);
-        gluTessCallback(tess, GLU_TESS_COMBINE, on_tess_combine);
-
-        guint i;
-        for(i = 0; i < mesh->f_num; ++i)
-        {
-            guint start = (0 == i) ? 0: f_data[i-1].v_offset;
-            guint v_num = f_data[i].v_offset - start;
-
-            if(selection && moto_shape_selection_check_face(selection, i))
-            {
-                glDisable(GL_LIGHTING);
-                glColor3f(0, 1, 0);
-            }
-            else
-            {
-                glEnable(GL_LIGHTING);
-            }
-
-            GLdouble verts[v_num*6];
-
-            glNormal3fv((GLfloat*)( & mesh->f_normals[i]));
-            gluTessBeginPolygon(tess, NULL);
-            gluTessBeginContour(tess);
-            guint j;
-            for(j = 0; j < v_num; ++j)
-            {
-                guint vi = f_verts[start + j];
-                float* v0 = (float*)&mesh->v_coords[vi];
-                float* n0 = (float*)&mesh->v_normals[vi];
-                GLdouble* v = verts + j*6;
-                v[0] = v0[0];
-                v[1] = v0[1];
-                v[2] = v0[2];
-                v[3] = n0[0];
-                v[4] = n0[1];
-                v[5] = n0[2];
-                gluTessVertex(tess, v, v);
-            }
-            gluTessEndContour(tess);
-            gluTessEndPolygon(tess);
-        }
+        glEnable(GL_LIGHTING);
+        glColor4f(1, 1, 1, 1);
+        moto_shape_node_draw_faces(self, mesh, TRUE, NULL);
 
-        glPopAttrib();
+        glDisable(GL_LIGHTING);
+        glDepthFunc(GL_LEQUAL);
+        glColor3f(0, 1, 0);
+        if(selection)
+            moto_shape_node_draw_faces(self, mesh, TRUE, selection);
     }
 
     glPopClientAttrib();
@@ -1260,8 +1443,6 @@ static void moto_shape_node_draw_SMOOTH_FACE(MotoShapeNode* self, MotoShapeSelec
 
 static void moto_shape_node_draw_SHADED_OBJECT(MotoShapeNode* self, MotoShapeSelection* selection)
 {
-    MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
-
     MotoSceneNode* scene_node = \
         moto_node_get_scene_node((MotoNode*)self);
 
@@ -1281,49 +1462,7 @@ static void moto_shape_node_draw_SHADED_OBJECT(MotoShapeNode* self, MotoShapeSel
         else
             glDisable(GL_CULL_FACE);
 
-        MotoMeshFace16 *f_data = mesh->f_data16;
-        guint16 *f_verts = (guint16 *)mesh->f_verts;
-
-        GLUtesselator* tess = gluNewTess();
-
-        gluTessCallback(tess, GLU_TESS_VERTEX, on_tess_vertex_normal);
-        gluTessCallback(tess, GLU_TESS_BEGIN, on_tess_begin);
-        gluTessCallback(tess, GLU_TESS_END, on_tess_end);
-        gluTessCallback(tess, GLU_TESS_ERROR, on_tess_error);
-        gluTessCallback(tess, GLU_TESS_COMBINE, on_tess_combine);
-
-        guint i;
-        for(i = 0; i < mesh->f_num; ++i)
-        {
-            guint start = (0 == i) ? 0: f_data[i-1].v_offset;
-            guint v_num = f_data[i].v_offset - start;
-
-            glColor4f(1, 1, 1, 1);
-
-            GLdouble verts[v_num*6];
-
-            gluTessBeginPolygon(tess, NULL);
-            gluTessBeginContour(tess);
-            guint j;
-            for(j = 0; j < v_num; ++j)
-            {
-                guint vi = f_verts[start + j];
-                gfloat* v0 = (float*) & mesh->v_coords[vi];
-                gfloat* n0 = (float*) & mesh->v_normals[vi];
-                GLdouble* v = verts + j*6;
-                v[0] = v0[0];
-                v[1] = v0[1];
-                v[2] = v0[2];
-                v[3] = n0[0];
-                v[4] = n0[1];
-                v[5] = n0[2];
-                gluTessVertex(tess, v, v);
-            }
-            gluTessEndContour(tess);
-            gluTessEndPolygon(tess);
-        }
-
-        gluDeleteTess(tess);
+        moto_shape_node_draw_faces(self, mesh, TRUE, NULL);
 
         glPopAttrib();
     }
@@ -1355,28 +1494,11 @@ static void moto_shape_node_draw_SHADED_VERTEX(MotoShapeNode* self, MotoShapeSel
         glVertexPointer(3, GL_FLOAT, sizeof(MotoVector), mesh->v_coords);
         glDrawElements(GL_LINES, 2*mesh->e_num, mesh->index_gl_type, mesh->e_verts);
 
-        guint i;
-
-        glPointSize(3);
-        glColor3f(1, 0, 0);
-        glBegin(GL_POINTS);
-        for(i = 0; i < mesh->v_num; i++)
-        {
-            if(!selection || !moto_shape_selection_check_vertex(selection, i))
-                glVertex3fv((GLfloat *)(mesh->v_coords + i));
-        }
-        glEnd();
-
-        glPointSize(4);
-        glColor3f(0, 1, 0);
-        glBegin(GL_POINTS);
-        for(i = 0; i < mesh->v_num; i++)
-        {
-            if(moto_shape_selection_check_vertex(selection, i))
-                glVertex3fv((GLfloat *)(mesh->v_coords + i));
-        }
-        glEnd();
+        draw_verts(mesh, selection);
     }
+
+    glPopClientAttrib();
+    glPopAttrib();
 }
 
 static void moto_shape_node_draw_SHADED_EDGE(MotoShapeNode* self, MotoShapeSelection* selection)
@@ -1399,25 +1521,10 @@ static void moto_shape_node_draw_SHADED_EDGE(MotoShapeNode* self, MotoShapeSelec
         glDisable(GL_LIGHTING);
         glEnableClientState(GL_VERTEX_ARRAY);
 
-        glBegin(GL_LINES);
-        glColor3f(0, 1, 0);
-        glLineWidth(2.0);
-
-        gint isize = moto_mesh_get_index_size(mesh);
-
-        guint i;
-        for(i = 0; i < mesh->e_num; i++)
-        {
-            if(selection && moto_shape_selection_check_edge(selection, i))
-                glColor3f(0, 1, 0);
-            else
-                glColor3f(0.1, 0.1, 0.1);
-
-            glVertex3fv((GLfloat*)(&mesh->v_coords[mesh->e_verts16[i*2]]));
-            glVertex3fv((GLfloat*)(&mesh->v_coords[mesh->e_verts16[i*2 + 1]]));
-        }
+        glVertexPointer(3, GL_FLOAT, sizeof(MotoVector), mesh->v_coords);
 
-        glEnd();
+        glColor3f(0.1, 0.1, 0.1);
+        draw_edges(mesh, selection);
     }
 
     glPopClientAttrib();
@@ -1455,84 +1562,24 @@ static void moto_shape_node_draw_SHADED_FACE(MotoShapeNode* self, MotoShapeSelec
         else
             glDisable(GL_CULL_FACE);
 
-        MotoMeshFace16 *f_data = mesh->f_data16;
-        guint16 *f_verts = (guint16 *)mesh->f_verts;
-
-        GLUtesselator* tess = gluNewTess();
-
-        gluTessCallback(tess, GLU_TESS_VERTEX, on_tess_vertex_normal);
-        gluTessCallback(tess, GLU_TESS_BEGIN, on_tess_begin);
-        gluTessCallback(tess, GLU_TESS_END, on_tess_end);
-        gluTessCallback(tess, GLU_TESS_ERROR, on_tess_error);
-        gluTessCallback(tess, GLU_TESS_COMBINE, on_tess_combine);
-
-        guint i;
-        for(i = 0; i < mesh->f_num; ++i)
-        {
-            guint start = (0 == i) ? 0: f_data[i-1].v_offset;
-            guint v_num = f_data[i].v_offset - start;
-
-            if(selection && moto_shape_selection_check_face(selection, i))
-            {
-                glDisable(GL_LIGHTING);
-                glColor3f(0, 1, 0);
-            }
-            else
-            {
-                glEnable(GL_LIGHTING);
-            }
-
-            GLdouble verts[v_num*6];
-
-            glNormal3fv((GLfloat*)( & mesh->f_normals[i]));
-            gluTessBeginPolygon(tess, NULL);
-            gluTessBeginContour(tess);
-            guint j;
-            for(j = 0; j < v_num; ++j)
-            {
-                guint vi = f_verts[start + j];
-                float* v0 = (float*)&mesh->v_coords[vi];
-                float* n0 = (float*)&mesh->v_normals[vi];
-                GLdouble* v = verts + j*6;
-                v[0] = v0[0];
-                v[1] = v0[1];
-                v[2] = v0[2];
-                v[3] = n0[0];
-                v[4] = n0[1];
-                v[5] = n0[2];
-                gluTessVertex(tess, v, v);
-            }
-            gluTessEndContour(tess);
-            gluTessEndPolygon(tess);
-        }
+        glEnable(GL_LIGHTING);
+        glColor4f(1, 1, 1, 1);
+        moto_shape_node_draw_faces(self, mesh, TRUE, NULL);
 
-        glPopAttrib();
+        glDisable(GL_LIGHTING);
+        glDepthFunc(GL_LEQUAL);
+        glColor3f(0, 1, 0);
+        if(selection)
+            moto_shape_node_draw_faces(self, mesh, TRUE, selection);
     }
 
     glPopClientAttrib();
     glPopAttrib();
 }
 
-void moto_shape_node_draw_DEFUALT(MotoShapeNode* self, MotoDrawMode draw_mode,
+static void moto_shape_node_draw_mode(MotoShapeNode* self, MotoDrawMode draw_mode,
     MotoShapeSelection* selection, MotoSelectionMode selection_mode)
 {
-    MotoShapeNodePriv* priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
-
-    if(priv->ready)
-    {
-        glCallList(priv->dlist);
-        return;
-    }
-
-    if(!glIsList(priv->dlist))
-    {
-        priv->dlist = glGenLists(1);
-        if(0 == priv->dlist)
-            return;
-    }
-
-    glNewList(priv->dlist, GL_COMPILE_AND_EXECUTE);
-
     switch(draw_mode)
     {
         case MOTO_DRAW_MODE_WIREFRAME_BBOX:
@@ -1624,12 +1671,157 @@ void moto_shape_node_draw_DEFUALT(MotoShapeNode* self, MotoDrawMode draw_mode,
         default:
         break;
     }
+}
+
+/* Such modes read verts of packed mesh only through render data. */
+static gboolean draws_packed(MotoDrawMode draw_mode, MotoSelectionMode selection_mode)
+{
+    switch(draw_mode)
+    {
+        case MOTO_DRAW_MODE_WIREFRAME_BBOX:
+        case MOTO_DRAW_MODE_SOLID_BBOX:
+            return TRUE;
+        case MOTO_DRAW_MODE_SOLID:
+        case MOTO_DRAW_MODE_SMOOTH:
+        case MOTO_DRAW_MODE_SHADED:
+            return MOTO_SELECTION_MODE_OBJECT == selection_mode;
+        default:
+        break;
+    }
+    return FALSE;
+}
+
+static gboolean uses_buffers(MotoShapeNode* self, MotoDrawMode draw_mode, MotoSelectionMode selection_mode)
+{
+    switch(draw_mode)
+    {
+        case MOTO_DRAW_MODE_SOLID:
+        case MOTO_DRAW_MODE_SMOOTH:
+        case MOTO_DRAW_MODE_SHADED:
+            return TRUE;
+        case MOTO_DRAW_MODE_WIREFRAME:
+            if(MOTO_SELECTION_MODE_FACE == selection_mode)
+                return TRUE;
+            if(MOTO_SELECTION_MODE_VERTEX == selection_mode || MOTO_SELECTION_MODE_EDGE == selection_mode)
+                return moto_shape_node_use_vbo(self);
+        break;
+        default:
+        break;
+    }
+    return FALSE;
+}
+
+void moto_shape_node_draw_DEFUALT(MotoShapeNode* self, MotoDrawMode draw_mode,
+    MotoShapeSelection* selection, MotoSelectionMode selection_mode)
+{
+    MotoShapeNodePriv* priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
+
+    MotoShape *shape = moto_shape_node_get_shape(self);
+    if(MOTO_IS_MESH(shape) && ! draws_packed(draw_mode, selection_mode))
+        moto_mesh_unpack((MotoMesh *)shape);
+
+    /* Retained buffers must not be compiled into display list,
+     * they are updated in place when geometry is changed. */
+    if(uses_buffers(self, draw_mode, selection_mode) && MOTO_IS_MESH(moto_shape_node_get_shape(self)))
+    {
+        moto_shape_node_draw_mode(self, draw_mode, selection, selection_mode);
+        return;
+    }
+
+    if(priv->ready)
+    {
+        glCallList(priv->dlist);
+        return;
+    }
+
+    if(!glIsList(priv->dlist))
+    {
+        priv->dlist = glGenLists(1);
+        if(0 == priv->dlist)
+            return;
+    }
+
+    glNewList(priv->dlist, GL_COMPILE_AND_EXECUTE);
+
+    moto_shape_node_draw_mode(self, draw_mode, selection, selection_mode);
 
     glEndList();
 
     priv->ready = TRUE;
 }
 
+#define LOD_MIN_TRIANGLES 4096
+#define LOD_TOLERANCE 1.0
+
+gboolean moto_shape_node_draw_lod(MotoShapeNode* self, MotoDrawMode draw_mode,
+    gfloat pixels_per_unit)
+{
+    MotoShapeNodePriv* priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
+
+    if(MOTO_DRAW_MODE_SOLID != draw_mode && MOTO_DRAW_MODE_SMOOTH != draw_mode &&
+       MOTO_DRAW_MODE_SHADED != draw_mode)
+        return FALSE;
+
+    MotoShape* shape = moto_shape_node_get_shape(self);
+    if( ! MOTO_IS_MESH(shape))
+        return FALSE;
+    MotoMesh* mesh = (MotoMesh*)shape;
+
+    /* Levels of changed geometry are dropped, unfinished job is cancelled. */
+    if(priv->lod && priv->lod_stamp != priv->geometry_stamp)
+    {
+        moto_mesh_lod_unref(priv->lod);
+        priv->lod = NULL;
+    }
+
+    /* Animated geometry is drawn as is. */
+    gboolean stable = (priv->drawn_geometry_stamp == priv->geometry_stamp);
+    priv->drawn_geometry_stamp = priv->geometry_stamp;
+
+    if( ! priv->lod)
+    {
+        guint t_num = (mesh->tesselated) ? mesh->f_tess_num : mesh->f_num*2;
+        if( ! stable || t_num < LOD_MIN_TRIANGLES)
+            return FALSE;
+
+        priv->lod = moto_mesh_lod_new(mesh, TRUE);
+        priv->lod_stamp = priv->geometry_stamp;
+    }
+
+    guint index = moto_mesh_lod_choose_level(priv->lod, pixels_per_unit, LOD_TOLERANCE);
+    if(0 == index)
+        return FALSE;
+
+    MotoMeshLodLevel *level = moto_mesh_lod_get_level(priv->lod, index - 1);
+
+    MotoSceneNode* scene_node = \
+        moto_node_get_scene_node((MotoNode*)self);
+
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+    glColor4f(1, 1, 1, 1);
+    glEnable(GL_LIGHTING);
+    if(MOTO_DRAW_MODE_SOLID == draw_mode)
+        glShadeModel(GL_FLAT);
+
+    if(scene_node && moto_scene_node_get_cull_faces(scene_node))
+        glEnable(GL_CULL_FACE);
+    else
+        glDisable(GL_CULL_FACE);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, level->v_coords);
+    glNormalPointer(GL_FLOAT, 0, level->v_normals);
+    glDrawElements(GL_TRIANGLES, level->t_num*3, GL_UNSIGNED_INT, level->t_verts);
+
+    glPopClientAttrib();
+    glPopAttrib();
+
+    return TRUE;
+}
+
 void moto_shape_node_select_more(MotoShapeNode* self,
     MotoShapeSelection* selection, MotoSelectionMode mode)
 {
@@ -1904,6 +2096,12 @@ moto_shape_node_select(MotoShapeNode *self,
 {
     gboolean result = FALSE;
 
+    MOTO_PROFILE_BEGIN(scope);
+
+    MotoShape *shape = moto_shape_node_get_shape(self);
+    if(MOTO_IS_MESH(shape) && MOTO_SELECTION_MODE_OBJECT != mode)
+        moto_mesh_unpack((MotoMesh *)shape);
+
     switch(mode)
     {
         case MOTO_SELECTION_MODE_OBJECT:
@@ -1936,6 +2134,8 @@ moto_shape_node_select(MotoShapeNode *self,
         break;
     }
 
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_SELECT, moto_node_get_interned_name((MotoNode *)self), self);
+
     return result;
 }
 
@@ -1950,5 +2150,12 @@ moto_shape_node_get_bound_DEFAULT(MotoShapeNode* self)
 
 static void moto_shape_node_update(MotoNode* self)
 {
+    /* Geometry may be changed, selection changes only reset display list.
+     * Buffers are refreshed lazily on drawing where GL context is current. */
+    MotoShapeNodePriv *priv = MOTO_SHAPE_NODE_GET_PRIVATE(self);
+    priv->rdata.dirty = TRUE;
+    priv->vbufs_dirty = TRUE;
+    priv->geometry_stamp++;
+
     moto_shape_node_reset((MotoShapeNode*)self);
 }
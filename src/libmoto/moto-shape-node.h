@@ -80,6 +80,18 @@ MotoShape* moto_shape_node_get_shape(MotoShapeNode* self);
 void moto_shape_node_draw(MotoShapeNode* self, MotoDrawMode draw_mode,
     MotoShapeSelection* selection, MotoSelectionMode selection_mode);
 
+/* Draws simplified level of mesh if it's ready and error of level is less than
+ * pixel when one unit of shape space takes pixels_per_unit on screen.
+ * Returns FALSE if shape must be drawn as usual. */
+gboolean moto_shape_node_draw_lod(MotoShapeNode* self, MotoDrawMode draw_mode,
+    gfloat pixels_per_unit);
+
+/* Draws faces of shape instances_num times with one call. Transform and color
+ * of every instance must be already set up by caller as instanced vertex attributes.
+ * Returns FALSE if instanced drawing isn't supported for draw_mode or by GL. */
+gboolean moto_shape_node_draw_instanced(MotoShapeNode* self, MotoDrawMode draw_mode,
+    gint instances_num);
+
 void moto_shape_node_select_more(MotoShapeNode* self,
     MotoShapeSelection* selection, MotoSelectionMode mode);
 void moto_shape_node_select_less(MotoShapeNode* self,
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "moto-shape.h"
 #include "moto-types.h"
 
@@ -11,8 +13,12 @@ static GObjectClass *shape_parent_class = NULL;
 typedef struct _MotoShapePriv
 {
     MotoBound* bound;
+    guint stamp;
 } MotoShapePriv;
 
+/* Stamps are unique for all shapes, so equal stamps mean the same content. */
+static gint last_stamp = 0;
+
 static void
 moto_shape_dispose(GObject *obj)
 {
@@ -27,6 +33,7 @@ moto_shape_init(MotoShape *self)
     MotoShapePriv* priv = MOTO_SHAPE_GET_PRIVATE(self);
 
     priv->bound = moto_bound_new(0, 0, 0, 0, 0, 0);
+    priv->stamp = (guint)g_atomic_int_exchange_and_add(& last_stamp, 1) + 1;
 }
 
 static void
@@ -66,10 +73,22 @@ MotoBound* moto_shape_get_bound(MotoShape *self)
     return MOTO_SHAPE_GET_PRIVATE(self)->bound;
 }
 
+guint moto_shape_get_stamp(MotoShape *self)
+{
+    return MOTO_SHAPE_GET_PRIVATE(self)->stamp;
+}
+
+void moto_shape_touch(MotoShape *self)
+{
+    MOTO_SHAPE_GET_PRIVATE(self)->stamp = (guint)g_atomic_int_exchange_and_add(& last_stamp, 1) + 1;
+}
+
 gboolean moto_shape_prepare(MotoShape *self)
 {
     MotoShapeClass *klass = MOTO_SHAPE_GET_CLASS(self);
 
+    moto_shape_touch(self);
+
     if(klass->prepare)
         return klass->prepare(self);
 
@@ -153,6 +172,71 @@ void moto_shape_selection_free(MotoShapeSelection *self)
     g_free(self);
 }
 
+static void dump_bitmask(MotoBitmask *bitmask, GByteArray *dump)
+{
+    g_byte_array_append(dump, (const guint8 *)bitmask->bits,
+        (bitmask->bits_num/32 + 1)*sizeof(guint32));
+}
+
+void moto_shape_selection_dump(MotoShapeSelection *self, GByteArray *dump)
+{
+    guint32 nums[3] = {moto_shape_selection_get_v_num(self),
+                       moto_shape_selection_get_e_num(self),
+                       moto_shape_selection_get_f_num(self)};
+    g_byte_array_append(dump, (const guint8 *)nums, sizeof(nums));
+
+    dump_bitmask(self->verts, dump);
+    dump_bitmask(self->edges, dump);
+    dump_bitmask(self->faces, dump);
+}
+
+static gboolean undump_bitmask(MotoBitmask *bitmask, const guint8 **data, const guint8 *end)
+{
+    gsize size = (bitmask->bits_num/32 + 1)*sizeof(guint32);
+    if(size > (gsize)(end - *data))
+        return FALSE;
+
+    memcpy(bitmask->bits, *data, size);
+    /* Bits beyond number of bits must be clear. */
+    if(bitmask->bits_num % 32)
+        bitmask->bits[bitmask->bits_num/32] &= (1u << (bitmask->bits_num % 32)) - 1;
+    else
+        bitmask->bits[bitmask->bits_num/32] = 0;
+    bitmask->set_num = moto_bitmask_calc_set_num(bitmask);
+
+    *data += size;
+    return TRUE;
+}
+
+MotoShapeSelection *moto_shape_selection_new_from_dump(gconstpointer dump, gsize *size)
+{
+    const guint8 *data = (const guint8 *)dump;
+    const guint8 *end = data + *size;
+
+    guint32 nums[3];
+    if(*size < sizeof(nums))
+        return NULL;
+    memcpy(nums, data, sizeof(nums));
+    data += sizeof(nums);
+
+    /* Each bit takes at least one bit of dump. */
+    gsize limit = 8*(gsize)(end - data);
+    if(nums[0] > limit || nums[1] > limit || nums[2] > limit)
+        return NULL;
+
+    MotoShapeSelection *self = moto_shape_selection_new(nums[0], nums[1], nums[2]);
+    if( ! undump_bitmask(self->verts, & data, end) ||
+        ! undump_bitmask(self->edges, & data, end) ||
+        ! undump_bitmask(self->faces, & data, end))
+    {
+        moto_shape_selection_free(self);
+        return NULL;
+    }
+
+    *size = data - (const guint8 *)dump;
+    return self;
+}
+
 guint32 moto_shape_selection_get_v_num(MotoShapeSelection *self)
 {
     return moto_bitmask_get_bits_num(self->verts);
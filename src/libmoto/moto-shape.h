@@ -76,6 +76,11 @@ GType moto_shape_get_type(void);
 MotoBound* moto_shape_update_bound(MotoShape *self);
 MotoBound* moto_shape_get_bound(MotoShape *self);
 
+/* Stamp identifies content of shape. It's changed by prepare, so code which
+ * changes shape in place must call prepare or touch after it. */
+guint moto_shape_get_stamp(MotoShape *self);
+void moto_shape_touch(MotoShape *self);
+
 gboolean moto_shape_prepare(MotoShape *self);
 gboolean moto_shape_is_struct_the_same(MotoShape *self, MotoShape *other);
 
@@ -98,6 +103,11 @@ MotoShapeSelection *moto_shape_selection_copy(MotoShapeSelection *other);
 void moto_shape_selection_copy_smth(MotoShapeSelection *self, MotoShapeSelection *other);
 void moto_shape_selection_free(MotoShapeSelection *self);
 
+/* Appends guint32 v_num, e_num, f_num and words of bitmasks of verts, edges and faces. */
+void moto_shape_selection_dump(MotoShapeSelection *self, GByteArray *dump);
+/* Returns NULL if dump is invalid. Number of read bytes is stored into size. */
+MotoShapeSelection *moto_shape_selection_new_from_dump(gconstpointer dump, gsize *size);
+
 guint32 moto_shape_selection_get_v_num(MotoShapeSelection *self);
 guint32 moto_shape_selection_get_e_num(MotoShapeSelection *self);
 guint32 moto_shape_selection_get_f_num(MotoShapeSelection *self);
@@ -2,6 +2,7 @@
 
 #include "moto-types.h"
 #include "moto-param-spec.h"
+#include "moto-parallel.h"
 #include "moto-sphere-node.h"
 #include "moto-mesh.h"
 #include "moto-enums.h"
@@ -25,6 +26,11 @@ struct _MotoSphereNodePriv
     gboolean disposed;
 
     MotoMesh *mesh;
+    /* Topology of mesh. While it's the same only coords and normals are rewritten. */
+    guint rows, cols;
+    MotoAxis orientation;
+    gint signs;
+    gfloat normal_sign; /* zero if normals can't be calculated analytically */
 
     MotoBound *bound;
     gboolean bound_calculated;
@@ -60,6 +66,11 @@ moto_sphere_node_init(MotoSphereNode *self)
     priv->disposed = FALSE;
 
     priv->mesh = NULL;
+    priv->rows = 0;
+    priv->cols = 0;
+    priv->orientation = MOTO_AXIS_Y;
+    priv->signs = 0;
+    priv->normal_sign = 0;
 
     gfloat radius[3] = {1, 1, 1};
     gint   rc[2]     = {10, 10};
@@ -114,6 +125,81 @@ MotoSphereNode *moto_sphere_node_new(const gchar *name)
     return self;
 }
 
+/* Coords are calculated in parallel when sphere is dense enough. */
+#define PARALLEL_MIN_VERTS 4096
+
+typedef struct _SphereCoords
+{
+    MotoMesh *mesh;
+    guint rows, cols;
+    guint axes[3];      /* Axes of mesh for x, y and z of sphere, z goes through poles. */
+    gfloat dir;         /* Direction from first pole to last one. */
+    gfloat radius[3];
+    gfloat normal_sign; /* Normals aren't written if zero. */
+} SphereCoords;
+
+static void sphere_point(SphereCoords *sc, guint vi, gfloat *p, gfloat *n)
+{
+    guint v_num = sc->mesh->v_num;
+    guint cols  = sc->cols;
+    guint rows  = sc->rows;
+
+    gfloat q[3];
+    if(0 == vi || v_num-1 == vi)
+    {
+        q[0] = q[1] = 0;
+        q[2] = ((vi) ? sc->dir : -sc->dir) * sc->radius[2];
+    }
+    else
+    {
+        guint i = (vi-1)/cols + 1;
+        guint j = (vi-1)%cols;
+
+        gfloat u = (PI2*j)/cols;
+        gfloat v = (PI*i)/rows - (PI_HALF-(PI_HALF/rows));
+        gfloat vc = cos(v);
+
+        q[0] = sc->dir*vc*cos(u)*sc->radius[0];
+        q[1] = sc->dir*vc*sin(u)*sc->radius[1];
+        q[2] = sc->dir*sin(v)*sc->radius[2];
+    }
+
+    guint k;
+    for(k = 0; k < 3; k++)
+        p[sc->axes[k]] = q[k];
+
+    if( ! n)
+        return;
+
+    /* Gradient of ellipsoid. */
+    gfloat len = 0;
+    for(k = 0; k < 3; k++)
+    {
+        gfloat g = q[k]/(sc->radius[k]*sc->radius[k]);
+        n[sc->axes[k]] = g;
+        len += g*g;
+    }
+    len = sc->normal_sign/sqrt(len);
+    for(k = 0; k < 3; k++)
+        n[k] *= len;
+}
+
+static void sphere_coords_range(gpointer data, guint chunk, guint begin, guint end)
+{
+    SphereCoords *sc = (SphereCoords *)data;
+    MotoMesh *mesh = sc->mesh;
+
+    guint vi;
+    for(vi = begin; vi < end; vi++)
+        sphere_point(sc, vi, (gfloat *)(mesh->v_coords + vi),
+                     (sc->normal_sign) ? (gfloat *)(mesh->v_normals + vi) : NULL);
+}
+
+static gint get_signs(gfloat x, gfloat y, gfloat z)
+{
+    return ((x > 0) - (x < 0) + 1) | (((y > 0) - (y < 0) + 1) << 2) | (((z > 0) - (z < 0) + 1) << 4);
+}
+
 #define get_v(r, c) ((r) ? (((r) != (rows-1)) ? ((r)-1)*cols + (c) + 1 : v_num-1) : 0)
 
 static void moto_sphere_node_update_mesh(MotoSphereNode *self)
@@ -121,10 +207,6 @@ static void moto_sphere_node_update_mesh(MotoSphereNode *self)
     MotoNode *node = (MotoNode*)self;
     MotoSphereNodePriv *priv = MOTO_SPHERE_NODE_GET_PRIVATE(self);
 
-    // FIXME: Rewrite with moto_value_[g|s]et_[boolean|int|float]_[2|3|4] when them will be implemented!
-    gfloat *radius = (gfloat *)g_value_peek_pointer(moto_node_get_param_value((MotoNode *)self, "radius"));
-    gint   *rc     = (gint *)g_value_peek_pointer(moto_node_get_param_value((MotoNode *)self, "rc"));
-
     gfloat radius_x, radius_y, radius_z;
     moto_node_get_param_3f(node, "radius", &radius_x, &radius_y, &radius_z);
 
@@ -142,114 +224,52 @@ static void moto_sphere_node_update_mesh(MotoSphereNode *self)
     guint f_num = (rows-1)*cols;
     guint f_v_num = (rows-2)*cols*4 + 6*cols;
 
-    gboolean new_mesh = FALSE;
-    if(priv->mesh)
+    gint signs = get_signs(radius_x, radius_y, radius_z);
+
+    gboolean new_mesh = ( ! priv->mesh) || rows != priv->rows || cols != priv->cols ||
+                        orientation != priv->orientation || signs != priv->signs;
+    if(new_mesh)
     {
-        if(v_num != priv->mesh->v_num || e_num != priv->mesh->e_num || f_num != priv->mesh->f_num)
-        {
+        if(priv->mesh)
             g_object_unref(priv->mesh);
-            priv->mesh = moto_mesh_new(v_num, e_num, f_num, f_v_num);
-            new_mesh = TRUE;
-        }
-    }
-    else
-    {
         priv->mesh = moto_mesh_new(v_num, e_num, f_num, f_v_num);
-        new_mesh = TRUE;
+        priv->rows = rows;
+        priv->cols = cols;
+        priv->orientation = orientation;
+        priv->signs = signs;
     }
 
     MotoMesh *mesh = priv->mesh;
 
-    guint32 i, j, v_offset = 0;
-    guint32 vi = 0, fi = 0;
-    if(MOTO_AXIS_X == orientation)
-    {
-        mesh->v_coords[vi].z = 0;
-        mesh->v_coords[vi].y = 0;
-        mesh->v_coords[vi].x = radius_z;
-        vi++;
-        for(i = 1; i < rows-1; i++)
-        {
-            for(j = 0; j < cols; j++)
-            {
-                gfloat u = (PI2*j)/cols;
-                gfloat v = (PI*i)/rows - (PI_HALF-(PI_HALF/rows));
-                gfloat us = sin(u);
-                gfloat uc = cos(u);
-                gfloat vs = sin(v);
-                gfloat vc = cos(v);
-
-                mesh->v_coords[vi].z = -vc*uc*radius_x;
-                mesh->v_coords[vi].y = -vc*us*radius_y;
-                mesh->v_coords[vi].x = -vs*radius_z;
-
-                vi++;
-            }
-        }
-        mesh->v_coords[vi].z = 0;
-        mesh->v_coords[vi].y = 0;
-        mesh->v_coords[vi].x = -radius_z;
-        vi++;
-    }
-    else if(MOTO_AXIS_Y == orientation)
-    {
-        mesh->v_coords[vi].x = 0;
-        mesh->v_coords[vi].z = 0;
-        mesh->v_coords[vi].y = radius_z;
-        vi++;
-        for(i = 1; i < rows-1; i++)
-        {
-            for(j = 0; j < cols; j++)
-            {
-                gfloat u = (PI2*j)/cols;
-                gfloat v = (PI*i)/rows - (PI_HALF-(PI_HALF/rows));
-                gfloat us = sin(u);
-                gfloat uc = cos(u);
-                gfloat vs = sin(v);
-                gfloat vc = cos(v);
-
-                mesh->v_coords[vi].x = -vc*uc*radius_x;
-                mesh->v_coords[vi].z = -vc*us*radius_y;
-                mesh->v_coords[vi].y = -vs*radius_z;
-
-                vi++;
-            }
-        }
-        mesh->v_coords[vi].x = 0;
-        mesh->v_coords[vi].z = 0;
-        mesh->v_coords[vi].y = -radius_z;
-        vi++;
-    }
-    else if(MOTO_AXIS_Z == orientation)
+    SphereCoords sc;
+    sc.mesh = mesh;
+    sc.rows = rows;
+    sc.cols = cols;
+    sc.radius[0] = radius_x;
+    sc.radius[1] = radius_y;
+    sc.radius[2] = radius_z;
+    sc.normal_sign = (new_mesh) ? 0 : priv->normal_sign;
+    switch(orientation)
     {
-        mesh->v_coords[vi].x = 0;
-        mesh->v_coords[vi].y = 0;
-        mesh->v_coords[vi].z = -radius_z;
-        vi++;
-        for(i = 1; i < rows-1; i++)
-        {
-            for(j = 0; j < cols; j++)
-            {
-                gfloat u = (PI2*j)/cols;
-                gfloat v = (PI*i)/rows - (PI_HALF-(PI_HALF/rows));
-                gfloat us = sin(u);
-                gfloat uc = cos(u);
-                gfloat vs = sin(v);
-                gfloat vc = cos(v);
-
-                mesh->v_coords[vi].x = vc*uc*radius_x;
-                mesh->v_coords[vi].y = vc*us*radius_y;
-                mesh->v_coords[vi].z = vs*radius_z;
-
-                vi++;
-            }
-        }
-        mesh->v_coords[vi].x = 0;
-        mesh->v_coords[vi].y = 0;
-        mesh->v_coords[vi].z = radius_z;
-        vi++;
+        case MOTO_AXIS_X:
+            sc.axes[0] = 2; sc.axes[1] = 1; sc.axes[2] = 0;
+            sc.dir = -1;
+        break;
+        case MOTO_AXIS_Z:
+            sc.axes[0] = 0; sc.axes[1] = 1; sc.axes[2] = 2;
+            sc.dir = 1;
+        break;
+        default:
+            sc.axes[0] = 0; sc.axes[1] = 2; sc.axes[2] = 1;
+            sc.dir = -1;
+        break;
     }
 
+    moto_parallel_for(sphere_coords_range, & sc, v_num, PARALLEL_MIN_VERTS);
+
+    guint32 i, j, v_offset = 0;
+    guint32 fi = 0;
+
     if(new_mesh)
     {
         guint32 verts[4];
@@ -295,7 +315,28 @@ static void moto_sphere_node_update_mesh(MotoSphereNode *self)
     }
 
     priv->bound_calculated = FALSE;
-    moto_shape_prepare((MotoShape*)mesh);
+
+    if(new_mesh)
+    {
+        moto_shape_prepare((MotoShape*)mesh);
+
+        /* Analytic normals are turned the same way as calculated ones. */
+        priv->normal_sign = 0;
+        if(0 != radius_x && 0 != radius_y && 0 != radius_z)
+        {
+            gfloat p[3], n[3];
+            sc.normal_sign = 1;
+            sphere_point(& sc, 0, p, n);
+            gfloat *mn = (gfloat *)mesh->v_normals;
+            priv->normal_sign = (n[0]*mn[0] + n[1]*mn[1] + n[2]*mn[2] < 0) ? -1 : 1;
+
+            sc.normal_sign = priv->normal_sign;
+            moto_parallel_for(sphere_coords_range, & sc, v_num, PARALLEL_MIN_VERTS);
+        }
+    }
+    else
+        moto_mesh_update_coords(mesh, 0 == priv->normal_sign);
+
     moto_node_set_param_object((MotoNode*)self, "out", (GObject*)mesh);
 }
 #undef get_v
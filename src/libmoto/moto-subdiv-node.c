@@ -0,0 +1,140 @@
+#include "moto-types.h"
+#include "moto-param-spec.h"
+#include "moto-mesh.h"
+#include "moto-mesh-subdiv.h"
+#include "moto-subdiv-node.h"
+
+/* forwards */
+
+static MotoShape *moto_subdiv_node_perform(MotoOpNode *self, MotoShape *in, gboolean *the_same);
+
+/* class MotoSubdivNode */
+
+#define MOTO_SUBDIV_NODE_GET_PRIVATE(obj) \
+    G_TYPE_INSTANCE_GET_PRIVATE(obj, MOTO_TYPE_SUBDIV_NODE, MotoSubdivNodePriv)
+
+static GObjectClass *subdiv_node_parent_class = NULL;
+
+/* Stencils of last result. While topology of cage is the same only positions are updated. */
+typedef struct _MotoSubdivNodePriv
+{
+    MotoMeshSubdiv *subdiv;
+    MotoMesh *mesh;
+} MotoSubdivNodePriv;
+
+static void forget_subdiv(MotoSubdivNodePriv *priv)
+{
+    if(priv->mesh)
+        g_object_unref(priv->mesh);
+    priv->mesh = NULL;
+
+    if(priv->subdiv)
+        moto_mesh_subdiv_free(priv->subdiv);
+    priv->subdiv = NULL;
+}
+
+static void
+moto_subdiv_node_dispose(GObject *obj)
+{
+    forget_subdiv(MOTO_SUBDIV_NODE_GET_PRIVATE(obj));
+
+    subdiv_node_parent_class->dispose(obj);
+}
+
+static void
+moto_subdiv_node_init(MotoSubdivNode *self)
+{
+    MotoNode *node = (MotoNode *)self;
+    MotoSubdivNodePriv *priv = MOTO_SUBDIV_NODE_GET_PRIVATE(self);
+
+    priv->subdiv = NULL;
+    priv->mesh   = NULL;
+
+    /* params */
+    MotoParamSpec *levels_spec = moto_param_spec_intnew(2, 0, 6, 1, 1);
+    moto_node_add_params(node,
+            "levels",   "Levels",   MOTO_TYPE_INT,  MOTO_PARAM_MODE_INOUT, 2,     levels_spec, "Arguments",
+            "adaptive", "Adaptive", MOTO_TYPE_BOOL, MOTO_PARAM_MODE_INOUT, FALSE, NULL,        "Arguments",
+            NULL);
+    g_object_unref(levels_spec);
+}
+
+static void
+moto_subdiv_node_class_init(MotoSubdivNodeClass *klass)
+{
+    g_type_class_add_private(klass, sizeof(MotoSubdivNodePriv));
+
+    subdiv_node_parent_class = (GObjectClass *)g_type_class_peek_parent(klass);
+
+    GObjectClass *goclass = G_OBJECT_CLASS(klass);
+    goclass->dispose = moto_subdiv_node_dispose;
+
+    /* Output isn't cached since it's changed in place when only cage positions change. */
+    MotoOpNodeClass *moclass = (MotoOpNodeClass *)klass;
+    moclass->perform = moto_subdiv_node_perform;
+}
+
+G_DEFINE_TYPE(MotoSubdivNode, moto_subdiv_node, MOTO_TYPE_OP_NODE);
+
+/* Methods of class MotoSubdivNode */
+
+MotoSubdivNode *moto_subdiv_node_new(const gchar *name)
+{
+    MotoSubdivNode *self = (MotoSubdivNode *)g_object_new(MOTO_TYPE_SUBDIV_NODE, NULL);
+    MotoNode *node = (MotoNode *)self;
+
+    moto_node_set_name(node, name);
+
+    return self;
+}
+
+static MotoShape *moto_subdiv_node_perform(MotoOpNode *self, MotoShape *in, gboolean *the_same)
+{
+    *the_same = FALSE;
+
+    MotoNode *node = (MotoNode *)self;
+    MotoSubdivNodePriv *priv = MOTO_SUBDIV_NODE_GET_PRIVATE(self);
+
+    if( ! g_type_is_a(G_TYPE_FROM_INSTANCE(in), MOTO_TYPE_MESH))
+        return in;
+
+    MotoMesh *cage = (MotoMesh *)in;
+
+    gint levels = 0;
+    moto_node_get_param_int(node, "levels", & levels);
+    gboolean adaptive = FALSE;
+    moto_node_get_param_boolean(node, "adaptive", & adaptive);
+
+    if(levels < 1)
+    {
+        forget_subdiv(priv);
+        return in;
+    }
+
+    /* Animated cage costs only weighted sums of stencils. */
+    if(priv->subdiv && priv->mesh && moto_mesh_subdiv_matches(priv->subdiv, cage, levels, adaptive))
+    {
+        moto_mesh_subdiv_apply(priv->subdiv, cage, priv->mesh);
+
+        /* Op node keeps its reference only while mesh is its output. */
+        GObject *out = NULL;
+        moto_node_get_param_object(node, "out", & out);
+        *the_same = (out == (GObject *)priv->mesh);
+        return (MotoShape *)((*the_same) ? priv->mesh : g_object_ref(priv->mesh));
+    }
+
+    forget_subdiv(priv);
+    priv->subdiv = moto_mesh_subdiv_new(cage, levels, adaptive);
+    if( ! priv->subdiv)
+        return in;
+
+    MotoMesh *mesh = moto_mesh_subdiv_create_mesh(priv->subdiv, cage);
+    if( ! mesh)
+    {
+        forget_subdiv(priv);
+        return in;
+    }
+
+    priv->mesh = g_object_ref(mesh);
+    return (MotoShape *)mesh;
+}
@@ -5,6 +5,8 @@
 #include "moto-library.h"
 #include "moto-node.h"
 #include "moto-messager.h"
+#include "moto-profiler.h"
+#include "moto-scene-generator.h"
 
 // #include "moto-image-loader.h"
 #include "moto-mesh-loader.h"
@@ -16,8 +18,12 @@
 #include "moto-twist-node.h"
 #include "moto-bend-node.h"
 #include "moto-extrude-node.h"
+#include "moto-subdiv-node.h"
+#include "moto-weld-node.h"
 #include "moto-remove-node.h"
 #include "moto-object-node.h"
+#include "moto-instance-node.h"
+#include "moto-reference-node.h"
 #include "moto-material-node.h"
 #include "moto-grid-node.h"
 #include "moto-axes-node.h"
@@ -29,10 +35,12 @@
 #include "moto-cylinder-node.h"
 // #include "moto-curve-node.h"
 #include "moto-mesh-file-node.h"
+#include "moto-anim-node.h"
+#include "moto-cache-node.h"
 // #include "moto-revolve-node.h"
 // #include "moto-extrude-node.h"
 // #include "moto-bevel-node.h"
-// #include "moto-time-node.h"
+#include "moto-time-node.h"
 
 /* image loaders */
 /*
@@ -67,6 +75,10 @@ static void unref_gobject(gpointer data, gpointer user_data)
 
 static GObjectClass *system_parent_class = NULL;
 
+/* Set when interpreter is initialized by systems, not by application. */
+static PyThreadState *main_thread_state = NULL;
+static guint systems_num = 0;
+
 struct _MotoSystemPriv
 {
     MotoLibrary *library;
@@ -92,7 +104,12 @@ moto_system_dispose(GObject *obj)
 static void
 moto_system_finalize(GObject *obj)
 {
-    Py_Finalize();
+    if(0 == --systems_num && main_thread_state)
+    {
+        PyEval_RestoreThread(main_thread_state);
+        main_thread_state = NULL;
+        Py_Finalize();
+    }
 
     system_parent_class->finalize(obj);
 }
@@ -100,7 +117,24 @@ moto_system_finalize(GObject *obj)
 static void
 moto_system_init(MotoSystem *self)
 {
-    Py_Initialize();
+    /* First system initializes interpreter and releases GIL, then it's taken
+     * only for evaluating of Python code, so scene can be updated from several
+     * threads. Nothing else may hold thread state of interpreter at this point.
+     * If application initialized Python itself, GIL is left to it. */
+    gboolean owner = 0 == systems_num++ && ! Py_IsInitialized();
+    if(owner)
+    {
+        Py_Initialize();
+        PyEval_InitThreads();
+    }
+
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    moto_profiler_init_python();
+    moto_scene_generator_init_python(self);
+    PyGILState_Release(gstate);
+
+    if(owner)
+        main_thread_state = PyEval_SaveThread();
 
     self->priv = g_slice_new(MotoSystemPriv);
 
@@ -139,9 +173,12 @@ moto_system_class_init(MotoSystemClass *klass)
 
     /* init node types */
     MOTO_TYPE_NODE;
+        MOTO_TYPE_TIME_NODE;
         MOTO_TYPE_RENDER_NODE;
             MOTO_TYPE_RMAN_NODE;
         MOTO_TYPE_OBJECT_NODE;
+            MOTO_TYPE_INSTANCE_NODE;
+            MOTO_TYPE_REFERENCE_NODE;
         MOTO_TYPE_SHAPE_NODE;
             MOTO_TYPE_PLANE_NODE;
             MOTO_TYPE_CUBE_NODE;
@@ -151,12 +188,16 @@ moto_system_class_init(MotoSystemClass *klass)
             MOTO_TYPE_GRID_NODE;
             MOTO_TYPE_AXES_NODE;
             MOTO_TYPE_LIGHT_NODE;
+            MOTO_TYPE_CACHE_NODE;
         MOTO_TYPE_MATERIAL_NODE;
         MOTO_TYPE_DISPLACE_NODE;
         MOTO_TYPE_TWIST_NODE;
         MOTO_TYPE_BEND_NODE;
         MOTO_TYPE_EXTRUDE_NODE;
         MOTO_TYPE_REMOVE_NODE;
+        MOTO_TYPE_SUBDIV_NODE;
+        MOTO_TYPE_WELD_NODE;
+        MOTO_TYPE_ANIM_NODE;
 }
 
 G_DEFINE_TYPE(MotoSystem, moto_system, G_TYPE_OBJECT);
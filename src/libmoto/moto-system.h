@@ -53,6 +53,8 @@ GType moto_system_get_type(void);
 #define MOTO_IS_SYSTEM_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),MOTO_TYPE_SYSTEM))
 #define MOTO_SYSTEM_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),MOTO_TYPE_SYSTEM, MotoSystemClass))
 
+/* First system initializes Python (unless application did it) and releases GIL.
+ * Code calling Python then must take GIL with PyGILState_Ensure(). */
 MotoSystem *moto_system_new();
 
 MotoSceneNode *moto_system_get_scene(MotoSystem *self, const gchar *name);
@@ -32,6 +32,7 @@ moto_time_node_dispose(GObject *obj)
     if(self->priv->disposed)
         return;
     self->priv->disposed = TRUE;
+    time_node_parent_class->dispose(obj);
 }
 
 static void
@@ -54,8 +55,11 @@ moto_time_node_init(MotoTimeNode *self)
     self->priv->frame   = 1.0;
 
     moto_node_add_params((MotoNode*)self,
-        "time", "Time", MOTO_TYPE_FLOAT, MOTO_PARAM_MODE_OUT, 0.0, NULL, "Time",
+        "time",  "Time",  MOTO_TYPE_FLOAT, MOTO_PARAM_MODE_OUT, 0.0f, NULL, "Time",
+        "frame", "Frame", MOTO_TYPE_FLOAT, MOTO_PARAM_MODE_OUT, 1.0f, NULL, "Time",
         NULL);
+
+    moto_node_set_time_source((MotoNode*)self, TRUE);
 }
 
 static void
@@ -87,18 +91,16 @@ MotoTimeNode *moto_time_node_new(const gchar *name)
 
 static void _moto_time_node_update(MotoNode *self)
 {
+    MotoTimeNode *time_node = (MotoTimeNode *)self;
+
     MotoSceneNode *scene_node = moto_node_get_scene_node(self);
     if( ! scene_node)
-    {
-        /* TODO: Print smth? =) */
         return;
-    }
 
-    /*
-    self->priv->time = moto_scene_node_get_current_time(scene_node);
-    self->priv->frame = 1.0f + (gfloat)(moto_scene_node_get_current_time(scene_node) / moto_scene_node_get_fps(scene_node));
-    */
+    time_node->priv->time  = moto_scene_node_get_current_time(scene_node);
+    time_node->priv->frame = 1.0f + time_node->priv->time*moto_scene_node_get_fps(scene_node);
 
-    /* Chain up updates to all nodes which depend on this. */
-    // moto_node_update_all_param_dests(self);
+    /* Setting of params marks all nodes which depend on this for update. */
+    moto_node_set_param_float(self, "time",  time_node->priv->time);
+    moto_node_set_param_float(self, "frame", time_node->priv->frame);
 }
@@ -26,10 +26,6 @@
 
 G_BEGIN_DECLS
 
-typedef struct _MotoTimeNode MotoTimeNode;
-typedef struct _MotoTimeNodeClass MotoTimeNodeClass;
-typedef struct _MotoTimeNodePriv MotoTimeNodePriv;
-
 /* class MotoTimeNode */
 
 struct _MotoTimeNode
@@ -0,0 +1,77 @@
+#include "moto-types.h"
+#include "moto-messager.h"
+#include "moto-param-spec.h"
+#include "moto-mesh.h"
+#include "moto-mesh-weld.h"
+#include "moto-weld-node.h"
+
+/* forwards */
+
+static MotoShape *moto_weld_node_perform(MotoOpNode *self, MotoShape *in, gboolean *the_same);
+
+/* class MotoWeldNode */
+
+static GObjectClass *weld_node_parent_class = NULL;
+
+static void
+moto_weld_node_init(MotoWeldNode *self)
+{
+    MotoNode *node = (MotoNode *)self;
+
+    /* params */
+    MotoParamSpec *distance_spec = moto_param_spec_floatnew(0.0001f, 0.0f, 1000000.0f, 0.0001f, 0.01f);
+    moto_node_add_params(node,
+            "distance", "Distance",        MOTO_TYPE_FLOAT, MOTO_PARAM_MODE_INOUT, 0.0001f, distance_spec, "Arguments",
+            "faces",    "Duplicate Faces", MOTO_TYPE_BOOL,  MOTO_PARAM_MODE_INOUT, TRUE,    NULL,          "Arguments",
+            NULL);
+    g_object_unref(distance_spec);
+}
+
+static void
+moto_weld_node_class_init(MotoWeldNodeClass *klass)
+{
+    weld_node_parent_class = (GObjectClass *)g_type_class_peek_parent(klass);
+
+    MotoOpNodeClass *moclass = (MotoOpNodeClass *)klass;
+
+    moclass->perform = moto_weld_node_perform;
+    moclass->cache_output = TRUE;
+}
+
+G_DEFINE_TYPE(MotoWeldNode, moto_weld_node, MOTO_TYPE_OP_NODE);
+
+/* Methods of class MotoWeldNode */
+
+MotoWeldNode *moto_weld_node_new(const gchar *name)
+{
+    MotoWeldNode *self = (MotoWeldNode *)g_object_new(MOTO_TYPE_WELD_NODE, NULL);
+    MotoNode *node = (MotoNode *)self;
+
+    moto_node_set_name(node, name);
+
+    return self;
+}
+
+static MotoShape *moto_weld_node_perform(MotoOpNode *self, MotoShape *in, gboolean *the_same)
+{
+    *the_same = FALSE;
+
+    MotoNode *node = (MotoNode *)self;
+
+    if( ! g_type_is_a(G_TYPE_FROM_INSTANCE(in), MOTO_TYPE_MESH))
+        return in;
+
+    gfloat distance = 0;
+    moto_node_get_param_float(node, "distance", & distance);
+    gboolean faces = TRUE;
+    moto_node_get_param_boolean(node, "faces", & faces);
+
+    MotoMesh *mesh = moto_mesh_weld((MotoMesh *)in, distance, faces);
+    if( ! mesh)
+    {
+        moto_warning("Node \"%s\" can't weld mesh, input is passed as is", moto_node_get_name(node));
+        return in;
+    }
+
+    return (MotoShape *)mesh;
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmotoutil/numdef.h"
+#include "libmoto/moto-anim-curve.h"
+
+static MotoAnimCurve *new_curve(MotoKeyInterp interp)
+{
+    MotoAnimCurve *curve = moto_anim_curve_new();
+    moto_anim_curve_set_key(curve, 0, 1, interp);
+    moto_anim_curve_set_key(curve, 10, 5, interp);
+    return curve;
+}
+
+static gboolean equal(gfloat a, gfloat b)
+{
+    return fabs(a - b) < 0.001;
+}
+
+void test_constant()
+{
+    MotoAnimCurve *curve = new_curve(MOTO_KEY_INTERP_CONSTANT);
+
+    assert(equal(moto_anim_curve_eval(curve, -1), 1));
+    assert(equal(moto_anim_curve_eval(curve, 5), 1));
+    assert(equal(moto_anim_curve_eval(curve, 10), 5));
+    assert(equal(moto_anim_curve_eval(curve, 20), 5));
+
+    moto_anim_curve_free(curve);
+}
+
+void test_linear()
+{
+    MotoAnimCurve *curve = new_curve(MOTO_KEY_INTERP_LINEAR);
+
+    assert(equal(moto_anim_curve_eval(curve, 2.5), 2));
+    assert(equal(moto_anim_curve_eval(curve, 5), 3));
+
+    /* Key with the same time is replaced. */
+    guint i = moto_anim_curve_set_key(curve, 10, 11, MOTO_KEY_INTERP_LINEAR);
+    assert(1 == i);
+    assert(2 == moto_anim_curve_get_keys_num(curve));
+    assert(equal(moto_anim_curve_eval(curve, 5), 6));
+
+    moto_anim_curve_free(curve);
+}
+
+void test_bezier()
+{
+    MotoAnimCurve *curve = new_curve(MOTO_KEY_INTERP_BEZIER);
+
+    /* Automatic handles are flat. */
+    assert(equal(moto_anim_curve_eval(curve, 0), 1));
+    assert(equal(moto_anim_curve_eval(curve, 2.5), 1.625));
+    assert(equal(moto_anim_curve_eval(curve, 5), 3));
+    assert(equal(moto_anim_curve_eval(curve, 10), 5));
+
+    /* Handles along the segment make it linear. */
+    moto_anim_curve_set_key_handles(curve, 0, 0, 0, 10.0/3, 4.0/3);
+    moto_anim_curve_set_key_handles(curve, 1, -10.0/3, -4.0/3, 0, 0);
+    assert(equal(moto_anim_curve_eval(curve, 2.5), 2));
+    assert(equal(moto_anim_curve_eval(curve, 7.5), 4));
+
+    moto_anim_curve_free(curve);
+}
+
+void test_hermite()
+{
+    MotoAnimCurve *curve = new_curve(MOTO_KEY_INTERP_HERMITE);
+
+    /* Zero tangents. */
+    assert(equal(moto_anim_curve_eval(curve, 2.5), 1.625));
+    assert(equal(moto_anim_curve_eval(curve, 5), 3));
+
+    /* Tangents with slope of the segment make it linear. */
+    moto_anim_curve_set_key_handles(curve, 0, 0, 0, 1, 0.4);
+    moto_anim_curve_set_key_handles(curve, 1, -1, -0.4, 0, 0);
+    assert(equal(moto_anim_curve_eval(curve, 2.5), 2));
+    assert(equal(moto_anim_curve_eval(curve, 7.5), 4));
+
+    moto_anim_curve_free(curve);
+}
+
+void test_eval_array()
+{
+    MotoAnimCurve *curves[4];
+    MotoAnimCurve *copies[4];
+    curves[0] = new_curve(MOTO_KEY_INTERP_CONSTANT);
+    curves[1] = new_curve(MOTO_KEY_INTERP_LINEAR);
+    curves[2] = new_curve(MOTO_KEY_INTERP_BEZIER);
+    curves[3] = new_curve(MOTO_KEY_INTERP_HERMITE);
+
+    guint i;
+    for(i = 0; i < 4; i++)
+    {
+        moto_anim_curve_set_key(curves[i], 20, -2, MOTO_KEY_INTERP_LINEAR);
+        copies[i] = moto_anim_curve_new_copy(curves[i]);
+    }
+
+    /* Playback forward and jump back. */
+    gfloat times[] = {-1, 0, 3, 9.5, 10, 12, 19, 25, 4};
+    gfloat values[4];
+    guint t;
+    for(t = 0; t < sizeof(times)/sizeof(gfloat); t++)
+    {
+        moto_anim_curve_eval_array(curves, 4, times[t], values);
+        for(i = 0; i < 4; i++)
+            assert(values[i] == moto_anim_curve_eval(copies[i], times[t]));
+    }
+
+    for(i = 0; i < 4; i++)
+    {
+        moto_anim_curve_free(curves[i]);
+        moto_anim_curve_free(copies[i]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-anim-curve.h\" ... ");
+
+    test_constant();
+    test_linear();
+    test_bezier();
+    test_hermite();
+    test_eval_array();
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#include "libmoto/moto-library.h"
+#include "libmoto/moto-scene-node.h"
+#include "libmoto/moto-autosave.h"
+#include "libmoto/moto-mesh.h"
+#include "libmoto/moto-cube-node.h"
+#include "libmoto/moto-extrude-node.h"
+
+#define FILENAME "autosave-test.journal"
+
+static gsize get_file_size(const gchar *filename)
+{
+    struct stat st;
+    if(g_stat(filename, & st))
+        return 0;
+    return st.st_size;
+}
+
+/* Writer may be busy with previous snapshot. */
+static void snapshot(MotoAutosave *autosave)
+{
+    while( ! moto_autosave_snapshot(autosave))
+        g_usleep(1000);
+}
+
+static void wait_writer(MotoAutosave *autosave)
+{
+    /* Snapshot without changes is accepted only when writer is idle. */
+    snapshot(autosave);
+}
+
+static void select_face(MotoNode *extrude, MotoMesh *mesh, guint index)
+{
+    MotoShapeSelection *selection = moto_mesh_create_selection(mesh);
+    moto_shape_selection_select_face(selection, index);
+    moto_op_node_set_selection((MotoOpNode *)extrude, selection);
+    moto_shape_selection_free(selection);
+}
+
+void test_recover()
+{
+    MotoLibrary *lib = moto_library_new();
+    MotoSceneNode *scene = moto_scene_node_new("scene", lib);
+
+    MotoNode *cube    = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_CUBE_NODE, "cube");
+    MotoNode *extrude = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_EXTRUDE_NODE, "extrude");
+    moto_node_update(cube);
+    MotoMesh *mesh = NULL;
+    moto_node_get_param_object(cube, "out", (GObject **)& mesh);
+
+    select_face(extrude, mesh, 1);
+    moto_node_link(extrude, "in", cube, "out");
+    moto_node_set_param_3f(extrude, "lt", 0, 0, 2);
+
+    MotoAutosave *autosave = moto_autosave_new(scene, FILENAME);
+    assert(autosave);
+    snapshot(autosave);
+    wait_writer(autosave);
+    gsize size = get_file_size(FILENAME);
+    assert(size > 0);
+
+    /* Nothing changed, nothing is written. */
+    wait_writer(autosave);
+    assert(get_file_size(FILENAME) == size);
+
+    /* Change of selection alone is journaled. */
+    select_face(extrude, mesh, 3);
+    snapshot(autosave);
+    wait_writer(autosave);
+    assert(get_file_size(FILENAME) > size);
+    moto_autosave_free(autosave);
+
+    MotoSceneNode *recovered = moto_scene_node_new("recovered", lib);
+    gboolean r = moto_autosave_recover(recovered, FILENAME);
+    assert(r);
+
+    MotoNode *rcube    = moto_node_get_child((MotoNode *)recovered, "cube");
+    MotoNode *rextrude = moto_node_get_child((MotoNode *)recovered, "extrude");
+    assert(rcube && rextrude);
+
+    MotoParam *source = moto_param_get_source(moto_node_get_param(rextrude, "in"));
+    assert(source && moto_param_get_node(source) == rcube);
+
+    gfloat lt[3];
+    r = moto_node_get_param_3fv(rextrude, "lt", lt);
+    assert(r);
+    assert(0 == lt[0] && 0 == lt[1] && 2 == lt[2]);
+
+    MotoShapeSelection *selection = moto_op_node_get_selection((MotoOpNode *)rextrude);
+    assert(selection);
+    assert(1 == moto_shape_selection_get_selected_f_num(selection));
+    assert(moto_shape_selection_check_face(selection, 3));
+
+    g_unlink(FILENAME);
+    g_object_unref(recovered);
+    g_object_unref(scene);
+    g_object_unref(lib);
+}
+
+/* Journal which grows too much is rewritten from the latest captures. */
+void test_compact()
+{
+    MotoLibrary *lib = moto_library_new();
+    MotoSceneNode *scene = moto_scene_node_new("scene", lib);
+
+    MotoNode *cubes[50];
+    guint i, j;
+    for(i = 0; i < 50; i++)
+        cubes[i] = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_CUBE_NODE, "cube");
+
+    MotoAutosave *autosave = moto_autosave_new(scene, FILENAME);
+    assert(autosave);
+
+    gsize written = 0, size = 0;
+    for(j = 0; j < 300; j++)
+    {
+        for(i = 0; i < 50; i++)
+            moto_node_set_param_3f(cubes[i], "size", j, i, 1);
+        snapshot(autosave);
+        wait_writer(autosave);
+
+        gsize new_size = get_file_size(FILENAME);
+        written += (new_size > size) ? new_size - size : new_size;
+        size = new_size;
+    }
+    moto_autosave_free(autosave);
+
+    assert(size < written);
+    assert(size < 2*(1 << 20));
+
+    MotoSceneNode *recovered = moto_scene_node_new("recovered", lib);
+    gboolean r = moto_autosave_recover(recovered, FILENAME);
+    assert(r);
+    assert(50 == g_list_length(moto_node_get_children((MotoNode *)recovered)));
+
+    GList *l = moto_node_get_children((MotoNode *)recovered);
+    for(; l; l = g_list_next(l))
+    {
+        gfloat s[3];
+        r = moto_node_get_param_3fv((MotoNode *)l->data, "size", s);
+        assert(r);
+        assert(299 == s[0] && 1 == s[2]);
+    }
+
+    g_unlink(FILENAME);
+    g_object_unref(recovered);
+    g_object_unref(scene);
+    g_object_unref(lib);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-autosave.h\" ... ");
+
+    g_type_init();
+    g_thread_init(NULL);
+
+    test_recover();
+    test_compact();
+
+    printf("OK\n");
+
+    return 0;
+}
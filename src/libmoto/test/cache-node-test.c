@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmoto/moto-library.h"
+#include "libmoto/moto-scene-node.h"
+#include "libmoto/moto-mesh.h"
+#include "libmoto/moto-cube-node.h"
+#include "libmoto/moto-twist-node.h"
+#include "libmoto/moto-cache-node.h"
+
+static MotoMesh *get_out(MotoNode *node)
+{
+    MotoMesh *mesh = NULL;
+    moto_node_get_param_object(node, "out", (GObject **)& mesh);
+    return mesh;
+}
+
+static gboolean mesh_equal(MotoMesh *a, MotoMesh *b)
+{
+    if( ! a || ! b || a->v_num != b->v_num)
+        return FALSE;
+
+    guint i;
+    for(i = 0; i < a->v_num; i++)
+        if(fabs(a->v_coords[i].x - b->v_coords[i].x) > 1e-5 ||
+           fabs(a->v_coords[i].y - b->v_coords[i].y) > 1e-5 ||
+           fabs(a->v_coords[i].z - b->v_coords[i].z) > 1e-5)
+            return FALSE;
+    return TRUE;
+}
+
+/* Time node drives both the twist and the cache, as in usual scene. */
+void test_bake_and_play()
+{
+    MotoLibrary *lib = moto_library_new();
+    MotoSceneNode *scene = moto_scene_node_new("scene", lib);
+    MotoNode *time = (MotoNode *)moto_scene_node_get_time_node(scene);
+
+    MotoNode *cube  = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_CUBE_NODE, "cube");
+    MotoNode *twist = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_TWIST_NODE, "twist");
+    MotoNode *cache = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_CACHE_NODE, "cache");
+
+    moto_node_update(cube);
+    MotoMesh *cube_mesh = get_out(cube);
+    MotoShapeSelection *selection = moto_mesh_create_selection(cube_mesh);
+    guint i;
+    for(i = 0; i < cube_mesh->f_num; i++)
+        moto_shape_selection_select_face(selection, i);
+    moto_op_node_set_selection((MotoOpNode *)twist, selection);
+    moto_shape_selection_free(selection);
+
+    moto_node_link(twist, "in", cube, "out");
+    moto_node_link(twist, "angle", time, "time");
+    moto_node_link(cache, "in", twist, "out");
+    moto_node_link(cache, "time", time, "time");
+    moto_scene_node_update(scene);
+
+    /* Without frames input is passed. */
+    MotoMesh *frames[3];
+    for(i = 0; i < 3; i++)
+    {
+        moto_scene_node_set_current_time(scene, i*30);
+        assert(mesh_equal(get_out(cache), get_out(twist)));
+        frames[i] = moto_mesh_new_copy(get_out(twist));
+    }
+    assert( ! mesh_equal(frames[0], frames[1]));
+
+    gboolean r = moto_cache_node_bake((MotoCacheNode *)cache, scene, 0, 60, 30);
+    assert(r);
+    assert(3 == moto_cache_node_get_frames_num((MotoCacheNode *)cache));
+
+    /* Frames are played while the upstream graph is left as is. */
+    moto_scene_node_set_current_time(scene, 0);
+    moto_scene_node_set_current_time(scene, 30);
+    assert( ! moto_node_needs_update(cache));
+    assert(mesh_equal(get_out(cache), frames[1]));
+    assert(moto_node_needs_update(twist));
+
+    moto_scene_node_set_current_time(scene, 60);
+    assert( ! moto_node_needs_update(cache));
+    assert(mesh_equal(get_out(cache), frames[2]));
+
+    /* Stopped playback follows input again. */
+    moto_node_set_param_boolean(cache, "playback", FALSE);
+    moto_scene_node_set_current_time(scene, 30);
+    assert( ! moto_node_needs_update(twist));
+    assert( ! moto_node_needs_update(cache));
+    assert(mesh_equal(get_out(cache), frames[1]));
+    assert(get_out(cache) == get_out(twist));
+
+    for(i = 0; i < 3; i++)
+        g_object_unref(frames[i]);
+    g_object_unref(scene);
+    g_object_unref(lib);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-cache-node.h\" ... ");
+
+    g_type_init();
+
+    test_bake_and_play();
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmotoutil/numdef.h"
+#include "libmoto/moto-expression.h"
+
+static MotoExpressionContext ctx;
+
+static void set_value(MotoExpressionValue *v, guint size, gfloat x, gfloat y, gfloat z)
+{
+    v->size = size;
+    v->v[0] = x;
+    v->v[1] = y;
+    v->v[2] = z;
+    v->v[3] = 0;
+    v->is_int = FALSE;
+}
+
+static gfloat eval1(const gchar *body)
+{
+    MotoExpressionValue r;
+    MotoExpression *e = moto_expression_new(body);
+    assert(e);
+    gboolean ok = moto_expression_eval(e, & ctx, & r);
+    assert(ok);
+    assert(1 == r.size);
+    moto_expression_free(e);
+    return r.v[0];
+}
+
+void test_scalar()
+{
+    set_value(& ctx.value, 1, 2, 0, 0);
+    ctx.has_source = FALSE;
+    ctx.time = 0.5;
+
+    assert(fabs(eval1("1 + 2*3") - 7) < MICRO);
+    assert(fabs(eval1("-2**2") + 4) < MICRO);
+    assert(fabs(eval1("2**3**2") - 512) < MICRO);
+    assert(fabs(eval1("(1 + 2)*3") - 9) < MICRO);
+    assert(fabs(eval1("-7 % 3") - 2) < MICRO);
+    assert(fabs(eval1("v*10") - 20) < MICRO);
+    assert(fabs(eval1("sin(pi/2)") - 1) < MICRO);
+    assert(fabs(eval1("math.cos(0) + t") - 1.5) < MICRO);
+    assert(fabs(eval1("max(1, v, 0.5)") - 2) < MICRO);
+    assert(fabs(eval1("min(1, v)") - 1) < MICRO);
+    assert(fabs(eval1("1e1 + .5") - 10.5) < MICRO);
+}
+
+void test_vector()
+{
+    MotoExpressionValue r;
+    MotoExpression *e;
+    gboolean ok;
+
+    set_value(& ctx.value, 3, 1, 2, 3);
+    set_value(& ctx.source, 3, 1, 1, 1);
+    ctx.has_source = TRUE;
+
+    e = moto_expression_new("v*2 + s");
+    assert(e);
+    assert((MOTO_EXPRESSION_VAR_VALUE|MOTO_EXPRESSION_VAR_SOURCE) == moto_expression_get_vars(e));
+    ok = moto_expression_eval(e, & ctx, & r);
+    assert(ok);
+    assert(3 == r.size);
+    assert(fabs(r.v[0] - 3) < MICRO && fabs(r.v[1] - 5) < MICRO && fabs(r.v[2] - 7) < MICRO);
+    moto_expression_free(e);
+
+    e = moto_expression_new("(v[2], 0, sin(t))");
+    assert(e);
+    ok = moto_expression_eval(e, & ctx, & r);
+    assert(ok);
+    assert(3 == r.size);
+    assert(fabs(r.v[0] - 3) < MICRO && fabs(r.v[2] - sin(0.5)) < MICRO);
+    moto_expression_free(e);
+
+    /* Size mismatch. */
+    e = moto_expression_new("v + (1, 2)");
+    assert(e);
+    ok = moto_expression_eval(e, & ctx, & r);
+    assert( ! ok);
+    moto_expression_free(e);
+
+    /* No source. */
+    ctx.has_source = FALSE;
+    e = moto_expression_new("s");
+    assert(e);
+    ok = moto_expression_eval(e, & ctx, & r);
+    assert( ! ok);
+    moto_expression_free(e);
+}
+
+void test_int()
+{
+    /* Division of ints floors as in Python 2. */
+    set_value(& ctx.value, 1, 7, 0, 0);
+    ctx.value.is_int = TRUE;
+    ctx.has_source = FALSE;
+    ctx.time = 0.5;
+
+    assert(fabs(eval1("v/2") - 3) < MICRO);
+    assert(fabs(eval1("-v/2") + 4) < MICRO);
+    assert(fabs(eval1("7/2") - 3) < MICRO);
+    assert(fabs(eval1("(v + 1)/abs(-3)") - 2) < MICRO);
+    assert(fabs(eval1("v/2.0") - 3.5) < MICRO);
+    assert(fabs(eval1("v/t") - 14) < MICRO);
+    assert(fabs(eval1("2**-1/1") - 0.5) < MICRO);
+    assert(fabs(eval1("sqrt(4)/3") - 2.0/3) < MICRO);
+
+    ctx.value.is_int = FALSE;
+    assert(fabs(eval1("v/2") - 3.5) < MICRO);
+}
+
+void test_fallback()
+{
+    /* Constructs which are left to Python. */
+    assert( ! moto_expression_new("p + 'x'"));
+    assert( ! moto_expression_new("v if v > 0 else 0"));
+    assert( ! moto_expression_new("v // 2"));
+    assert( ! moto_expression_new("import math\nreturn math.sin(v)"));
+    assert( ! moto_expression_new("foo(v)"));
+    assert( ! moto_expression_new("1 +"));
+    assert( ! moto_expression_new("(1, 2"));
+    assert( ! moto_expression_new("010 + v"));
+    assert( ! moto_expression_new("0x10 + v"));
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-expression.h\" ... ");
+
+    test_scalar();
+    test_vector();
+    test_int();
+    test_fallback();
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmoto/moto-mesh.h"
+#include "libmoto/moto-instance-node.h"
+
+void test_scatter()
+{
+    MotoMesh *mesh = moto_mesh_new(3, 0, 0, 0);
+
+    guint i;
+    for(i = 0; i < 3; i++)
+    {
+        mesh->v_coords[i].x = i + 1;
+        mesh->v_coords[i].y = 2*i;
+        mesh->v_coords[i].z = -(gfloat)i;
+        mesh->v_coords[i].w = 1;
+        mesh->v_normals[i].x = 0;
+        mesh->v_normals[i].y = 0;
+        mesh->v_normals[i].z = 1;
+    }
+
+    MotoNode *node = (MotoNode *)moto_instance_node_new("instances");
+    moto_node_set_param_object(node, "points", (GObject *)mesh);
+    moto_node_update(node);
+
+    MotoInstanceNode *inst = (MotoInstanceNode *)node;
+    assert(3 == moto_instance_node_get_instances_num(inst));
+
+    /* Every instance is placed on its own point. */
+    gfloat m[16];
+    for(i = 0; i < 3; i++)
+    {
+        moto_instance_node_get_instance(inst, i, m, NULL);
+        assert(fabs(m[12] - (i + 1)) < 1e-5);
+        assert(fabs(m[13] - 2*i) < 1e-5);
+        assert(fabs(m[14] + i) < 1e-5);
+        assert(fabs(m[10] - 1) < 1e-5);
+    }
+
+    g_object_unref(node);
+    g_object_unref(mesh);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-instance-node.h\" ... ");
+
+    g_type_init();
+
+    test_scatter();
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "libmoto/moto-mem-pool.h"
+
+void test_pool()
+{
+    gpointer a = moto_mem_pool_alloc(100000);
+    assert(0 == ((gsize)a % MOTO_MEM_POOL_ALIGN));
+    moto_mem_pool_free(a);
+
+    /* Block of close size is given back. */
+    gpointer b = moto_mem_pool_alloc(95000);
+    assert(a == b);
+    moto_mem_pool_free(b);
+
+    moto_mem_pool_trim();
+}
+
+void test_scratch()
+{
+    gchar *a = (gchar *)moto_scratch_alloc(10);
+    gchar *b = (gchar *)moto_scratch_alloc(300000);
+    moto_scratch_alloc(1000);
+
+    moto_scratch_free(b);
+    gpointer p = moto_scratch_alloc(300000);
+    assert(p == b);
+
+    moto_scratch_free(a);
+    p = moto_scratch_alloc(10);
+    assert(p == a);
+    moto_scratch_free(a);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-mem-pool.h\" ... ");
+
+    test_pool();
+    test_scratch();
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "libmoto/moto-mesh.h"
+
+/* Quad split into two triangles. */
+static MotoMesh *two_triangles()
+{
+    MotoMesh *mesh = moto_mesh_new(4, 0, 2, 6);
+
+    guint32 a[3] = {0, 1, 2};
+    guint32 b[3] = {0, 2, 3};
+    moto_mesh_set_face(mesh, 0, 3, a);
+    moto_mesh_set_face(mesh, 1, 6, b);
+
+    return mesh;
+}
+
+void test_attrs()
+{
+    MotoMesh *mesh = two_triangles();
+
+    MotoMeshAttrHandle uv = moto_mesh_add_attr(mesh, "uv", MOTO_MESH_ATTR_FLOAT, MOTO_MESH_ATTR_FACE_VERT, 2);
+    MotoMeshAttrHandle id = moto_mesh_add_attr(mesh, "id", MOTO_MESH_ATTR_INT, MOTO_MESH_ATTR_FACE, 1);
+    assert(MOTO_MESH_ATTR_INVALID != uv && MOTO_MESH_ATTR_INVALID != id);
+    assert(moto_mesh_find_attr(mesh, "uv") == uv);
+    assert(moto_mesh_add_attr(mesh, "id", MOTO_MESH_ATTR_BYTE, MOTO_MESH_ATTR_FACE, 1) == MOTO_MESH_ATTR_INVALID);
+
+    MotoMeshAttr *attr = moto_mesh_get_attr(mesh, uv);
+    assert(attr->num == 6);
+    assert(0 == ((gsize)moto_mesh_attr_channel(attr, 1) % 16));
+
+    guint i;
+    for(i = 0; i < 6; i++)
+        moto_mesh_attr_float(attr, 1)[i] = i;
+    moto_mesh_attr_int(moto_mesh_get_attr(mesh, id), 0)[1] = 7;
+
+    /* Second face only. */
+    MotoMesh *part = moto_mesh_new(3, 0, 1, 3);
+    guint32 v_map[3]  = {0, 2, 3};
+    guint32 f_map[1]  = {1};
+    guint32 fv_map[3] = {3, 4, 5};
+    moto_mesh_copy_attrs(part, mesh, v_map, f_map, fv_map);
+
+    MotoMeshAttr *part_uv = moto_mesh_get_attr(part, moto_mesh_find_attr(part, "uv"));
+    assert(part_uv && 5 == moto_mesh_attr_float(part_uv, 1)[2]);
+    assert(7 == moto_mesh_attr_get_value(moto_mesh_get_attr(part, moto_mesh_find_attr(part, "id")), 0, 0));
+
+    moto_mesh_remove_attr(mesh, uv);
+    assert(NULL == moto_mesh_get_attr(mesh, uv));
+
+    g_object_unref(part);
+    g_object_unref(mesh);
+}
+
+void test_half()
+{
+    assert(0.5 == moto_half_to_float(moto_float_to_half(0.5)));
+    assert(-65504 == moto_half_to_float(moto_float_to_half(-65504)));
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-mesh.h\" attributes ... ");
+
+    g_type_init();
+
+    test_attrs();
+    test_half();
+
+    printf("OK\n");
+
+    return 0;
+}
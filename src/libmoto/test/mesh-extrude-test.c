@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmoto/moto-mesh.h"
+
+static MotoMesh *cube()
+{
+    static const gfloat coords[8][3] = {{-1, -1, -1}, {1, -1, -1}, {1, 1, -1}, {-1, 1, -1},
+                                        {-1, -1,  1}, {1, -1,  1}, {1, 1,  1}, {-1, 1,  1}};
+    static const guint faces[6][4] = {{0, 3, 2, 1}, {4, 5, 6, 7}, {0, 1, 5, 4},
+                                      {1, 2, 6, 5}, {2, 3, 7, 6}, {3, 0, 4, 7}};
+
+    MotoMesh *mesh = moto_mesh_new(8, 12, 6, 24);
+
+    guint i, j;
+    for(i = 0; i < 8; i++)
+    {
+        mesh->v_coords[i].x = coords[i][0];
+        mesh->v_coords[i].y = coords[i][1];
+        mesh->v_coords[i].z = coords[i][2];
+    }
+    for(i = 0; i < 6; i++)
+    {
+        mesh->f_data16[i].v_offset = (i + 1)*4;
+        for(j = 0; j < 4; j++)
+            mesh->f_verts16[i*4 + j] = faces[i][j];
+    }
+
+    gboolean prepared = moto_mesh_prepare(mesh);
+    assert(prepared);
+    return mesh;
+}
+
+static gboolean vectors_equal(MotoVector *a, MotoVector *b, guint num)
+{
+    guint i;
+    for(i = 0; i < num; i++)
+        if(fabs(a[i].x - b[i].x) > 1e-5 || fabs(a[i].y - b[i].y) > 1e-5 || fabs(a[i].z - b[i].z) > 1e-5)
+            return FALSE;
+    return TRUE;
+}
+
+static void check_equal(MotoMesh *a, MotoMesh *b)
+{
+    assert(a->v_num == b->v_num && a->f_num == b->f_num && a->f_v_num == b->f_v_num);
+    assert(vectors_equal(a->v_coords, b->v_coords, a->v_num));
+    assert(vectors_equal(a->v_normals, b->v_normals, a->v_num));
+    assert(vectors_equal(a->f_normals, b->f_normals, a->f_num));
+
+    gfloat *ab = moto_shape_get_bound((MotoShape *)a)->bound;
+    gfloat *bb = moto_shape_get_bound((MotoShape *)b)->bound;
+    guint i;
+    for(i = 0; i < 6; i++)
+        assert(fabs(ab[i] - bb[i]) < 1e-5);
+}
+
+/* Mesh updated in place for new arguments is the same as extruded again. */
+void test_update()
+{
+    MotoMesh *mesh = cube();
+    MotoShapeSelection *selection = moto_mesh_create_selection(mesh);
+    moto_shape_selection_select_face(selection, 1);
+    moto_shape_selection_select_face(selection, 3);
+
+    MotoMesh *updated = moto_mesh_extrude_faces(mesh, selection, 2, 0, 0, 1, 0, 0, 0, 1, 1, 1);
+    assert(updated);
+
+    gboolean r = moto_mesh_extrude_faces_update(updated, mesh, selection, 2,
+        0.5, 0.25, 3, 10, 20, 30, 0.5, 2, 1.5);
+    assert(r);
+
+    MotoMesh *rebuilt = moto_mesh_extrude_faces(mesh, selection, 2,
+        0.5, 0.25, 3, 10, 20, 30, 0.5, 2, 1.5);
+    assert(rebuilt);
+    check_equal(updated, rebuilt);
+
+    /* Other sections or selection don't match. */
+    assert( ! moto_mesh_extrude_faces_update(updated, mesh, selection, 3,
+        0, 0, 1, 0, 0, 0, 1, 1, 1));
+    moto_shape_selection_select_face(selection, 0);
+    assert( ! moto_mesh_extrude_faces_update(updated, mesh, selection, 2,
+        0, 0, 1, 0, 0, 0, 1, 1, 1));
+
+    g_object_unref(rebuilt);
+    g_object_unref(updated);
+    moto_shape_selection_free(selection);
+    g_object_unref(mesh);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-mesh.h\" extrusion ... ");
+
+    g_type_init();
+
+    test_update();
+
+    printf("OK\n");
+
+    return 0;
+}
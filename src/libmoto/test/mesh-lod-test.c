@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmotoutil/numdef.h"
+#include "libmoto/moto-mesh-lod.h"
+
+#define GRID_DIVS 32
+#define SPHERE_RINGS 32
+#define SPHERE_SEGMENTS 64
+
+static void grid(gfloat **v_coords, guint *v_num, guint32 **t_verts, guint *t_num)
+{
+    guint i, j, n = GRID_DIVS;
+
+    *v_num = (n + 1)*(n + 1);
+    *t_num = n*n*2;
+    *v_coords = g_new(gfloat, *v_num*3);
+    *t_verts  = g_new(guint32, *t_num*3);
+
+    for(i = 0; i <= n; i++)
+        for(j = 0; j <= n; j++)
+        {
+            gfloat *v = *v_coords + (i*(n + 1) + j)*3;
+            v[0] = (gfloat)i/n;
+            v[1] = (gfloat)j/n;
+            v[2] = 0;
+        }
+
+    guint32 *t = *t_verts;
+    for(i = 0; i < n; i++)
+        for(j = 0; j < n; j++)
+        {
+            guint32 a = i*(n + 1) + j, b = a + n + 1;
+            t[0] = a; t[1] = b; t[2] = b + 1;
+            t[3] = a; t[4] = b + 1; t[5] = a + 1;
+            t += 6;
+        }
+}
+
+/* Closed UV sphere of radius 1. */
+static void sphere(gfloat **v_coords, guint *v_num, guint32 **t_verts, guint *t_num)
+{
+    guint i, j, r = SPHERE_RINGS, s = SPHERE_SEGMENTS;
+
+    *v_num = (r - 1)*s + 2;
+    *t_num = (r - 2)*s*2 + s*2;
+    *v_coords = g_new(gfloat, *v_num*3);
+    *t_verts  = g_new(guint32, *t_num*3);
+
+    gfloat *v = *v_coords;
+    v[0] = 0; v[1] = 0; v[2] = 1;
+    v += 3;
+    for(i = 1; i < r; i++)
+        for(j = 0; j < s; j++, v += 3)
+        {
+            gfloat theta = G_PI*i/r;
+            gfloat phi = 2*G_PI*j/s;
+            v[0] = sin(theta)*cos(phi);
+            v[1] = sin(theta)*sin(phi);
+            v[2] = cos(theta);
+        }
+    v[0] = 0; v[1] = 0; v[2] = -1;
+
+    guint32 *t = *t_verts;
+    guint32 south = *v_num - 1;
+    for(j = 0; j < s; j++, t += 3)
+    {
+        t[0] = 0; t[1] = 1 + j; t[2] = 1 + (j + 1)%s;
+    }
+    for(i = 0; i < r - 2; i++)
+        for(j = 0; j < s; j++, t += 6)
+        {
+            guint32 a = 1 + i*s + j, b = 1 + i*s + (j + 1)%s;
+            guint32 c = a + s, d = b + s;
+            t[0] = a; t[1] = c; t[2] = d;
+            t[3] = a; t[4] = d; t[5] = b;
+        }
+    for(j = 0; j < s; j++, t += 3)
+    {
+        guint32 base = 1 + (r - 2)*s;
+        t[0] = south; t[1] = base + (j + 1)%s; t[2] = base + j;
+    }
+}
+
+static void check_level(MotoMeshLodLevel *l)
+{
+    guint i;
+    for(i = 0; i < l->t_num*3; i++)
+        assert(l->t_verts[i] < l->v_num);
+    for(i = 0; i < l->v_num; i++)
+    {
+        gfloat *n = l->v_normals + i*3;
+        assert(fabs(sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]) - 1) < 0.001);
+    }
+}
+
+void test_planar()
+{
+    gfloat *v_coords;
+    guint32 *t_verts;
+    guint v_num, t_num;
+    grid(& v_coords, & v_num, & t_verts, & t_num);
+
+    MotoMeshLodLevel *l = \
+        moto_mesh_lod_level_new_simplified(v_coords, v_num, t_verts, t_num, 8, 0);
+    check_level(l);
+
+    /* Flat surface collapses without error and borders stay in place. */
+    assert(l->t_num <= 8);
+    assert(l->error < 0.001);
+
+    gfloat bound[4] = {1, 0, 1, 0};
+    guint i;
+    for(i = 0; i < l->v_num; i++)
+    {
+        gfloat *v = l->v_coords + i*3;
+        assert(fabs(v[2]) < 0.001);
+        bound[0] = min(bound[0], v[0]); bound[1] = max(bound[1], v[0]);
+        bound[2] = min(bound[2], v[1]); bound[3] = max(bound[3], v[1]);
+    }
+    assert(bound[0] < 0.001 && bound[1] > 0.999);
+    assert(bound[2] < 0.001 && bound[3] > 0.999);
+
+    moto_mesh_lod_level_free(l);
+    g_free(v_coords);
+    g_free(t_verts);
+}
+
+void test_sphere()
+{
+    gfloat *v_coords;
+    guint32 *t_verts;
+    guint v_num, t_num;
+    sphere(& v_coords, & v_num, & t_verts, & t_num);
+
+    gfloat prev_error = 0;
+    guint target;
+    for(target = t_num/2; target >= t_num/16; target /= 2)
+    {
+        MotoMeshLodLevel *l = \
+            moto_mesh_lod_level_new_simplified(v_coords, v_num, t_verts, t_num, target, 0);
+        check_level(l);
+
+        assert(l->t_num <= target);
+        assert(l->error >= prev_error);
+        prev_error = l->error;
+
+        /* Verts stay near the surface. */
+        guint i;
+        for(i = 0; i < l->v_num; i++)
+        {
+            gfloat *v = l->v_coords + i*3;
+            gfloat r = sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+            assert(fabs(r - 1) < 0.1);
+        }
+
+        moto_mesh_lod_level_free(l);
+    }
+    assert(prev_error > 0);
+
+    /* Error limit stops collapsing. Limit is for mean distance, so max one is a bit greater. */
+    MotoMeshLodLevel *l = \
+        moto_mesh_lod_level_new_simplified(v_coords, v_num, t_verts, t_num, 0, 0.001);
+    check_level(l);
+    assert(l->error <= 0.005);
+    assert(l->t_num > t_num/16);
+    moto_mesh_lod_level_free(l);
+
+    /* Error is distance in units of mesh, so it's scaled with mesh. */
+    l = moto_mesh_lod_level_new_simplified(v_coords, v_num, t_verts, t_num, t_num/8, 0);
+    gfloat error = l->error;
+    moto_mesh_lod_level_free(l);
+
+    guint i;
+    for(i = 0; i < v_num*3; i++)
+        v_coords[i] *= 10;
+    l = moto_mesh_lod_level_new_simplified(v_coords, v_num, t_verts, t_num, t_num/8, 0);
+    assert(fabs(l->error/error - 10) < 1);
+    moto_mesh_lod_level_free(l);
+
+    g_free(v_coords);
+    g_free(t_verts);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-mesh-lod.h\" ... ");
+
+    test_planar();
+    test_sphere();
+
+    printf("OK\n");
+
+    return 0;
+}
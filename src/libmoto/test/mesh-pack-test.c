@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmoto/moto-mesh.h"
+
+static MotoMesh *quad()
+{
+    MotoMesh *mesh = moto_mesh_new(4, 0, 1, 4);
+
+    guint32 verts[4] = {0, 1, 2, 3};
+    moto_mesh_set_face(mesh, 0, 4, verts);
+
+    gfloat coords[4][3] = {{-1, 0, -2}, {3, 0, -2}, {3, 0.5, 2}, {-1, 0.5, 2}};
+    guint i;
+    for(i = 0; i < 4; i++)
+    {
+        mesh->v_coords[i].x = coords[i][0];
+        mesh->v_coords[i].y = coords[i][1];
+        mesh->v_coords[i].z = coords[i][2];
+        mesh->v_normals[i].x = 0;
+        mesh->v_normals[i].y = (i < 2) ? -1 : 1;
+        mesh->v_normals[i].z = 0;
+    }
+
+    return mesh;
+}
+
+void test_pack()
+{
+    MotoMesh *mesh = quad();
+
+    gboolean ok = moto_mesh_pack(mesh);
+    assert(ok);
+    assert(moto_mesh_is_packed(mesh) && ! mesh->v_coords);
+    assert(4 == mesh->f_v_num);
+
+    /* Corners of bound are exact, normals along axes too. */
+    gfloat coords[4*3], normals[4*3];
+    moto_mesh_decode_verts(mesh, 0, 4, coords, sizeof(gfloat)*3, normals, sizeof(gfloat)*3);
+    assert(fabs(coords[3] - 3) < 1e-5 && fabs(coords[8] - 2) < 1e-5);
+    assert(fabs(normals[1] + 1) < 1e-4 && fabs(normals[10] - 1) < 1e-4);
+
+    MotoMesh *copy = moto_mesh_new_copy(mesh);
+    assert( ! moto_mesh_is_packed(copy));
+    assert(fabs(copy->v_coords[2].y - 0.5) < 1e-4);
+
+    ok = moto_mesh_unpack(mesh);
+    assert(ok);
+    assert( ! moto_mesh_is_packed(mesh));
+    assert(fabs(mesh->v_coords[0].x + 1) < 1e-5 && 1 == mesh->v_coords[0].w);
+
+    g_object_unref(copy);
+    g_object_unref(mesh);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-mesh.h\" packing ... ");
+
+    g_type_init();
+
+    test_pack();
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmotoutil/numdef.h"
+#include "libmoto/moto-mesh-subdiv.h"
+
+static MotoMesh *cube()
+{
+    static const gfloat coords[8][3] = {{-1, -1, -1}, {1, -1, -1}, {1, 1, -1}, {-1, 1, -1},
+                                        {-1, -1,  1}, {1, -1,  1}, {1, 1,  1}, {-1, 1,  1}};
+    static const guint faces[6][4] = {{0, 3, 2, 1}, {4, 5, 6, 7}, {0, 1, 5, 4},
+                                      {1, 2, 6, 5}, {2, 3, 7, 6}, {3, 0, 4, 7}};
+
+    MotoMesh *mesh = moto_mesh_new(8, 12, 6, 24);
+
+    guint i, j;
+    for(i = 0; i < 8; i++)
+    {
+        mesh->v_coords[i].x = coords[i][0];
+        mesh->v_coords[i].y = coords[i][1];
+        mesh->v_coords[i].z = coords[i][2];
+    }
+    for(i = 0; i < 6; i++)
+    {
+        mesh->f_data16[i].v_offset = (i + 1)*4;
+        for(j = 0; j < 4; j++)
+            mesh->f_verts16[i*4 + j] = faces[i][j];
+    }
+
+    gboolean prepared = moto_mesh_prepare(mesh);
+    assert(prepared);
+    return mesh;
+}
+
+static void get_radius(MotoMesh *mesh, gfloat *min_r, gfloat *max_r)
+{
+    *min_r = 1000;
+    *max_r = 0;
+
+    guint i;
+    for(i = 0; i < mesh->v_num; i++)
+    {
+        MotoVector *v = mesh->v_coords + i;
+        gfloat r = sqrt(v->x*v->x + v->y*v->y + v->z*v->z);
+        *min_r = min(*min_r, r);
+        *max_r = max(*max_r, r);
+    }
+}
+
+void test_uniform()
+{
+    MotoMesh *cage = cube();
+
+    /* Each level makes 4 quads of a quad. */
+    guint levels;
+    guint f_num = 6;
+    for(levels = 1; levels <= 4; levels++)
+    {
+        f_num *= 4;
+
+        MotoMeshSubdiv *subdiv = moto_mesh_subdiv_new(cage, levels, FALSE);
+        MotoMesh *mesh = moto_mesh_subdiv_create_mesh(subdiv, cage);
+
+        assert(moto_mesh_subdiv_get_levels(subdiv) == levels);
+        assert(mesh->f_num == f_num);
+        assert(mesh->v_num == f_num + 2);
+        assert(mesh->f_v_num == mesh->e_num*2);
+
+        /* Limit surface of cube is inside it and outside of inscribed sphere. */
+        gfloat min_r, max_r;
+        get_radius(mesh, & min_r, & max_r);
+        assert(min_r > 0.8 && max_r < sqrt(3));
+
+        g_object_unref(mesh);
+        moto_mesh_subdiv_free(subdiv);
+    }
+
+    /* Corner of cube on first level. */
+    MotoMeshSubdiv *subdiv = moto_mesh_subdiv_new(cage, 1, FALSE);
+    MotoMesh *mesh = moto_mesh_subdiv_create_mesh(subdiv, cage);
+    assert(fabs(mesh->v_coords[6].x - 5.0/9) < 0.0001);
+    g_object_unref(mesh);
+    moto_mesh_subdiv_free(subdiv);
+
+    g_object_unref(cage);
+}
+
+void test_apply()
+{
+    MotoMesh *cage = cube();
+    MotoMeshSubdiv *subdiv = moto_mesh_subdiv_new(cage, 3, FALSE);
+    MotoMesh *mesh = moto_mesh_subdiv_create_mesh(subdiv, cage);
+
+    /* Scaled cage gives scaled refined mesh without rebuilding stencils. */
+    guint i;
+    for(i = 0; i < cage->v_num; i++)
+    {
+        cage->v_coords[i].x *= 2;
+        cage->v_coords[i].y *= 2;
+        cage->v_coords[i].z *= 2;
+    }
+    assert(moto_mesh_subdiv_matches(subdiv, cage, 3, FALSE));
+    assert( ! moto_mesh_subdiv_matches(subdiv, cage, 2, FALSE));
+
+    MotoMesh *copy = moto_mesh_new_copy(mesh);
+    moto_mesh_subdiv_apply(subdiv, cage, mesh);
+    for(i = 0; i < mesh->v_num; i++)
+    {
+        assert(fabs(mesh->v_coords[i].x - copy->v_coords[i].x*2) < 0.0001);
+        assert(fabs(mesh->v_coords[i].y - copy->v_coords[i].y*2) < 0.0001);
+        assert(fabs(mesh->v_coords[i].z - copy->v_coords[i].z*2) < 0.0001);
+    }
+
+    g_object_unref(copy);
+    g_object_unref(mesh);
+    moto_mesh_subdiv_free(subdiv);
+    g_object_unref(cage);
+}
+
+void test_creases()
+{
+    MotoMesh *cage = cube();
+    cage->e_use_creases = TRUE;
+    cage->e_creases = g_new0(gfloat, cage->e_num);
+
+    guint i;
+    for(i = 0; i < cage->e_num; i++)
+        cage->e_creases[i] = 10;
+
+    /* Fully creased cube keeps its shape, corners are fixed. */
+    MotoMeshSubdiv *subdiv = moto_mesh_subdiv_new(cage, 3, FALSE);
+    MotoMesh *mesh = moto_mesh_subdiv_create_mesh(subdiv, cage);
+    for(i = 0; i < mesh->v_num; i++)
+    {
+        MotoVector *v = mesh->v_coords + i;
+        assert(max(fabs(v->x), max(fabs(v->y), fabs(v->z))) > 0.9999);
+    }
+    for(i = 0; i < cage->v_num; i++)
+        assert(fabs(mesh->v_coords[i].x - cage->v_coords[i].x) < 0.0001);
+
+    g_object_unref(mesh);
+    moto_mesh_subdiv_free(subdiv);
+    g_object_unref(cage);
+}
+
+void test_adaptive()
+{
+    MotoMesh *cage = cube();
+
+    /* All verts of cube are extraordinary, but only faces around them are refined further. */
+    MotoMeshSubdiv *uniform = moto_mesh_subdiv_new(cage, 4, FALSE);
+    MotoMeshSubdiv *adaptive = moto_mesh_subdiv_new(cage, 4, TRUE);
+    MotoMesh *mesh = moto_mesh_subdiv_create_mesh(adaptive, cage);
+
+    assert(moto_mesh_subdiv_get_f_num(adaptive) < moto_mesh_subdiv_get_f_num(uniform));
+    /* Closed and without cracks. */
+    assert(mesh->f_v_num == mesh->e_num*2);
+
+    g_object_unref(mesh);
+    moto_mesh_subdiv_free(uniform);
+    moto_mesh_subdiv_free(adaptive);
+    g_object_unref(cage);
+}
+
+void test_b32()
+{
+    MotoMesh *cage = cube();
+
+    /* 6*4^7 faces don't fit in 16 bit indices. */
+    MotoMeshSubdiv *subdiv = moto_mesh_subdiv_new(cage, 7, FALSE);
+    MotoMesh *mesh = moto_mesh_subdiv_create_mesh(subdiv, cage);
+    assert(moto_mesh_subdiv_get_levels(subdiv) == 7);
+    assert(mesh->b32);
+    assert(mesh->f_num == 6*16384);
+    assert(mesh->v_num == mesh->f_num + 2);
+
+    /* Mesh with 32 bit indices is a cage too. */
+    MotoMeshSubdiv *subdiv2 = moto_mesh_subdiv_new(mesh, 1, FALSE);
+    MotoMesh *mesh2 = moto_mesh_subdiv_create_mesh(subdiv2, mesh);
+    assert(mesh2->f_num == mesh->f_num*4);
+    assert(mesh2->v_num == mesh2->f_num + 2);
+
+    g_object_unref(mesh2);
+    moto_mesh_subdiv_free(subdiv2);
+    g_object_unref(mesh);
+    moto_mesh_subdiv_free(subdiv);
+    g_object_unref(cage);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-mesh-subdiv.h\" ... ");
+
+    g_type_init();
+
+    test_uniform();
+    test_apply();
+    test_creases();
+    test_adaptive();
+    test_b32();
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmoto/moto-mesh-weld.h"
+
+/* Faces of cube don't share verts, last face repeats the first one. */
+static MotoMesh *separate_cube()
+{
+    static const gfloat coords[8][3] = {{-1, -1, -1}, {1, -1, -1}, {1, 1, -1}, {-1, 1, -1},
+                                        {-1, -1,  1}, {1, -1,  1}, {1, 1,  1}, {-1, 1,  1}};
+    static const guint faces[7][4] = {{0, 3, 2, 1}, {4, 5, 6, 7}, {0, 1, 5, 4},
+                                      {1, 2, 6, 5}, {2, 3, 7, 6}, {3, 0, 4, 7}, {3, 2, 1, 0}};
+
+    MotoMesh *mesh = moto_mesh_new(28, 0, 7, 28);
+
+    guint i, j;
+    for(i = 0; i < 7; i++)
+    {
+        guint32 verts[4];
+        for(j = 0; j < 4; j++)
+        {
+            guint vi = i*4 + j;
+            mesh->v_coords[vi].x = coords[faces[i][j]][0] + (vi % 3)*0.00001;
+            mesh->v_coords[vi].y = coords[faces[i][j]][1];
+            mesh->v_coords[vi].z = coords[faces[i][j]][2];
+            verts[j] = vi;
+        }
+        moto_mesh_set_face(mesh, i, (i + 1)*4, verts);
+    }
+
+    return mesh;
+}
+
+void test_weld()
+{
+    MotoMesh *mesh = separate_cube();
+
+    MotoMesh *welded = moto_mesh_weld(mesh, 0.001, TRUE);
+    assert(welded);
+    assert(welded->v_num == 8);
+    assert(welded->f_num == 6);
+    assert(welded->e_num == 12);
+    g_object_unref(welded);
+
+    g_object_unref(mesh);
+}
+
+static gboolean is_near(MotoVector *a, MotoVector *b)
+{
+    return fabs(a->x - b->x) < 0.001 && fabs(a->y - b->y) < 0.001 && fabs(a->z - b->z) < 0.001;
+}
+
+/* Attributes keep values of source verts and corners, creases of merged edges. */
+void test_weld_attrs()
+{
+    MotoMesh *mesh = separate_cube();
+    gboolean r = moto_mesh_prepare(mesh);
+    assert(r);
+
+    MotoMeshAttr *id = moto_mesh_get_attr(mesh,
+        moto_mesh_add_attr(mesh, "id", MOTO_MESH_ATTR_INT, MOTO_MESH_ATTR_VERT, 1));
+    MotoMeshAttr *uv = moto_mesh_get_attr(mesh,
+        moto_mesh_add_attr(mesh, "uv", MOTO_MESH_ATTR_FLOAT, MOTO_MESH_ATTR_FACE_VERT, 2));
+    guint i;
+    for(i = 0; i < mesh->v_num; i++)
+        moto_mesh_attr_int(id, 0)[i] = i;
+    for(i = 0; i < mesh->f_v_num; i++)
+        moto_mesh_attr_float(uv, 1)[i] = i;
+
+    /* Edges of the first face are creased. */
+    mesh->e_use_creases = TRUE;
+    mesh->e_creases = g_new0(gfloat, mesh->e_num);
+    for(i = 0; i < mesh->e_num; i++)
+        if(mesh->e_verts16[i*2] < 4 && mesh->e_verts16[i*2 + 1] < 4)
+            mesh->e_creases[i] = 1;
+
+    MotoMesh *welded = moto_mesh_weld(mesh, 0.001, TRUE);
+    assert(welded);
+
+    id = moto_mesh_get_attr(welded, moto_mesh_find_attr(welded, "id"));
+    uv = moto_mesh_get_attr(welded, moto_mesh_find_attr(welded, "uv"));
+    assert(id && uv);
+    for(i = 0; i < welded->v_num; i++)
+        assert(is_near(welded->v_coords + i, mesh->v_coords + moto_mesh_attr_int(id, 0)[i]));
+    for(i = 0; i < welded->f_v_num; i++)
+    {
+        guint32 src = (guint32)moto_mesh_attr_float(uv, 1)[i];
+        assert(is_near(welded->v_coords + welded->f_verts16[i], mesh->v_coords + mesh->f_verts16[src]));
+    }
+
+    guint creased = 0;
+    assert(welded->e_use_creases);
+    for(i = 0; i < welded->e_num; i++)
+        if(1 == welded->e_creases[i])
+            creased++;
+    assert(4 == creased);
+
+    g_object_unref(welded);
+    g_object_unref(mesh);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-mesh-weld.h\" ... ");
+
+    g_type_init();
+
+    test_weld();
+    test_weld_attrs();
+
+    printf("OK\n");
+
+    return 0;
+}
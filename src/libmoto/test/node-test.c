@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmotoutil/numdef.h"
+#include "libmoto/moto-system.h"
+#include "libmoto/moto-library.h"
+#include "libmoto/moto-scene-node.h"
+#include "libmoto/moto-twist-node.h"
+
+static MotoSystem *msystem = NULL;
+
+static gfloat eval_angle(MotoNode *node)
+{
+    MotoParam *param = moto_node_get_param(node, "angle");
+    gboolean r = moto_param_eval(param);
+    assert(r);
+
+    gfloat angle;
+    r = moto_node_get_param_float(node, "angle", & angle);
+    assert(r);
+    return angle;
+}
+
+/* Python fallback has the same names as native expressions. */
+void test_python_expression()
+{
+    MotoSceneNode *scene = moto_scene_node_new("scene", moto_system_get_library(msystem));
+    MotoNode *twist = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_TWIST_NODE, "twist");
+    MotoParam *angle = moto_node_get_param(twist, "angle");
+
+    moto_scene_node_set_current_time(scene, 0.5);
+    gfloat t = moto_scene_node_get_current_time(scene);
+    moto_node_set_param_float(twist, "angle", 1);
+
+    moto_param_set_expression(angle, "sin(t) if v else 0");
+    moto_param_set_use_expression(angle, TRUE);
+    assert(moto_param_needs_python(angle));
+    assert(fabs(eval_angle(twist) - sin(t)) < MICRO);
+
+    moto_node_set_param_float(twist, "angle", 1);
+    moto_param_set_expression(angle, "math.pi*time if v > 0 else pi");
+    assert(moto_param_needs_python(angle));
+    assert(fabs(eval_angle(twist) - M_PI*t) < MICRO);
+
+    /* Native expression replaces Python function. */
+    moto_param_set_expression(angle, "2*t");
+    assert( ! moto_param_needs_python(angle));
+    assert(fabs(eval_angle(twist) - 2*t) < MICRO);
+
+    g_object_unref(scene);
+}
+
+#define BATCH_NODES_NUM 16
+
+/* Python expressions of one level are evaluated together holding GIL once. */
+void test_eval_batch()
+{
+    MotoSceneNode *scene = moto_scene_node_new("scene", moto_system_get_library(msystem));
+    MotoNode *nodes[BATCH_NODES_NUM];
+    guint i;
+    for(i = 0; i < BATCH_NODES_NUM; i++)
+    {
+        nodes[i] = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_TWIST_NODE, "twist");
+
+        gchar *body = g_strdup_printf("%u + t if p == 'angle' else -1", i);
+        MotoParam *angle = moto_node_get_param(nodes[i], "angle");
+        moto_param_set_expression(angle, body);
+        moto_param_set_use_expression(angle, TRUE);
+        assert(moto_param_needs_python(angle));
+        g_free(body);
+    }
+    /* Native one in the same level isn't batched. */
+    MotoNode *native = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_TWIST_NODE, "native");
+    moto_param_set_expression(moto_node_get_param(native, "angle"), "2*t");
+    moto_param_set_use_expression(moto_node_get_param(native, "angle"), TRUE);
+
+    GPtrArray *params = g_ptr_array_new();
+    for(i = 0; i < BATCH_NODES_NUM; i++)
+        moto_node_collect_python_params(nodes[i], params);
+    moto_node_collect_python_params(native, params);
+    assert(BATCH_NODES_NUM == params->len);
+
+    /* Results of batch are taken by next update. */
+    moto_scene_node_set_current_time(scene, 1);
+    moto_param_eval_batch(params);
+    for(i = 0; i < BATCH_NODES_NUM; i++)
+    {
+        moto_node_update(nodes[i]);
+        gfloat angle;
+        moto_node_get_param_float(nodes[i], "angle", & angle);
+        assert(fabs(angle - (i + 1)) < MICRO);
+    }
+    g_ptr_array_free(params, TRUE);
+
+    /* Level of scene is batched when time is changed. */
+    moto_scene_node_set_current_time(scene, 5);
+    gfloat t = moto_scene_node_get_current_time(scene);
+    for(i = 0; i < BATCH_NODES_NUM; i++)
+    {
+        gfloat angle;
+        moto_node_get_param_float(nodes[i], "angle", & angle);
+        assert(fabs(angle - (i + t)) < MICRO);
+        assert( ! moto_node_needs_update(nodes[i]));
+    }
+    gfloat angle;
+    moto_node_get_param_float(native, "angle", & angle);
+    assert(fabs(angle - 2*t) < MICRO);
+
+    g_object_unref(scene);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-node.h\" ... ");
+
+    g_type_init();
+    g_thread_init(NULL);
+    msystem = moto_system_new();
+
+    test_python_expression();
+    test_eval_batch();
+
+    g_object_unref(msystem);
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmoto/moto-library.h"
+#include "libmoto/moto-scene-node.h"
+#include "libmoto/moto-enums.h"
+#include "libmoto/moto-mesh.h"
+#include "libmoto/moto-cube-node.h"
+#include "libmoto/moto-sphere-node.h"
+#include "libmoto/moto-cylinder-node.h"
+#include "libmoto/moto-plane-node.h"
+
+typedef void (*SetFormFunc)(MotoNode *node, gfloat k);
+
+static MotoSceneNode *scene = NULL;
+
+static MotoMesh *get_out(MotoNode *node)
+{
+    MotoMesh *mesh = NULL;
+    moto_node_get_param_object(node, "out", (GObject **)& mesh);
+    return mesh;
+}
+
+static gboolean vectors_equal(MotoVector *a, MotoVector *b, guint num)
+{
+    if( ! a || ! b)
+        return a == b;
+
+    guint i;
+    for(i = 0; i < num; i++)
+        if(fabs(a[i].x - b[i].x) > 1e-5 || fabs(a[i].y - b[i].y) > 1e-5 || fabs(a[i].z - b[i].z) > 1e-5)
+            return FALSE;
+    return TRUE;
+}
+
+static void check_equal(MotoMesh *a, MotoMesh *b)
+{
+    assert(a->v_num == b->v_num && a->f_num == b->f_num && a->f_v_num == b->f_v_num);
+    assert(vectors_equal(a->v_coords, b->v_coords, a->v_num));
+    assert(vectors_equal(a->v_normals, b->v_normals, a->v_num));
+    assert(vectors_equal(a->f_normals, b->f_normals, a->f_num));
+
+    gfloat *ab = moto_shape_get_bound((MotoShape *)a)->bound;
+    gfloat *bb = moto_shape_get_bound((MotoShape *)b)->bound;
+    guint i;
+    for(i = 0; i < 6; i++)
+        assert(fabs(ab[i] - bb[i]) < 1e-5);
+}
+
+/* Regenerates node for form k and compares it with a new node of the same form.
+ * Returns TRUE if mesh was rewritten in place. */
+static gboolean regenerate(MotoNode *node, SetFormFunc set_form, gfloat k)
+{
+    MotoMesh *prev = get_out(node);
+    set_form(node, k);
+    moto_node_update(node);
+
+    MotoNode *fresh = moto_node_create_child((MotoNode *)scene, G_OBJECT_TYPE(node), "fresh");
+    set_form(fresh, k);
+    moto_node_update(fresh);
+    check_equal(get_out(node), get_out(fresh));
+
+    return get_out(node) == prev;
+}
+
+static void test_form(GType type, SetFormFunc set_form)
+{
+    MotoNode *node = moto_node_create_child((MotoNode *)scene, type, "node");
+    set_form(node, 1);
+    moto_node_update(node);
+
+    assert(regenerate(node, set_form, 2));
+    assert(regenerate(node, set_form, 0.5));
+
+    /* Mirrored form has faces turned the other way. */
+    regenerate(node, set_form, -1.5);
+    assert(regenerate(node, set_form, -3));
+}
+
+static void set_cube_form(MotoNode *node, gfloat k)
+{
+    moto_node_set_param_3f(node, "size", k, 2*fabs(k), 3);
+}
+
+static void set_sphere_form(MotoNode *node, gfloat k)
+{
+    moto_node_set_param_3f(node, "radius", k, fabs(k), fabs(k));
+}
+
+static void set_cylinder_form(MotoNode *node, gfloat k)
+{
+    moto_node_set_param_4f(node, "radius", fabs(k), fabs(k), 2*fabs(k), 2*fabs(k));
+    moto_node_set_param_float(node, "height", 3*k);
+}
+
+static void set_plane_form(MotoNode *node, gfloat k)
+{
+    moto_node_set_param_2f(node, "size", k, 2*fabs(k));
+}
+
+static void set_plane_xy_form(MotoNode *node, gfloat k)
+{
+    set_plane_form(node, k);
+    moto_node_set_param_enum(node, "orientation", MOTO_ORIENTATION_XY);
+}
+
+static void set_cylinder_x_form(MotoNode *node, gfloat k)
+{
+    set_cylinder_form(node, k);
+    moto_node_set_param_enum(node, "orientation", MOTO_AXIS_X);
+}
+
+void test_regeneration()
+{
+    test_form(MOTO_TYPE_CUBE_NODE, set_cube_form);
+    test_form(MOTO_TYPE_SPHERE_NODE, set_sphere_form);
+    test_form(MOTO_TYPE_CYLINDER_NODE, set_cylinder_form);
+    test_form(MOTO_TYPE_PLANE_NODE, set_plane_form);
+}
+
+/* Other orientation makes a new mesh, normals of sphere are analytic. */
+void test_orientation()
+{
+    MotoNode *sphere = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_SPHERE_NODE, "sphere");
+    set_sphere_form(sphere, 2);
+    moto_node_update(sphere);
+
+    MotoAxis axes[] = {MOTO_AXIS_X, MOTO_AXIS_Z, MOTO_AXIS_Y};
+    guint i, j;
+    for(i = 0; i < 3; i++)
+    {
+        MotoMesh *prev = get_out(sphere);
+        moto_node_set_param_enum(sphere, "orientation", axes[i]);
+        moto_node_update(sphere);
+        assert(get_out(sphere) != prev);
+
+        MotoNode *fresh = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_SPHERE_NODE, "fresh");
+        set_sphere_form(fresh, 2);
+        moto_node_set_param_enum(fresh, "orientation", axes[i]);
+        moto_node_update(fresh);
+        check_equal(get_out(sphere), get_out(fresh));
+
+        /* Normal of uniform sphere is its point divided by radius. */
+        MotoMesh *mesh = get_out(sphere);
+        gfloat sign = 0;
+        for(j = 0; j < mesh->v_num; j++)
+        {
+            MotoVector *p = mesh->v_coords + j;
+            MotoVector *n = mesh->v_normals + j;
+            gfloat d = (p->x*n->x + p->y*n->y + p->z*n->z)/2;
+            if( ! sign)
+                sign = (d < 0) ? -1 : 1;
+            assert(fabs(d - sign) < 1e-4);
+        }
+    }
+
+    /* Plane gets new mesh for other orientation, cylinder is rewritten in place. */
+    MotoNode *plane = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_PLANE_NODE, "plane");
+    set_plane_form(plane, 1);
+    moto_node_update(plane);
+    assert( ! regenerate(plane, set_plane_xy_form, 2));
+
+    MotoNode *cylinder = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_CYLINDER_NODE, "cylinder");
+    set_cylinder_form(cylinder, 1);
+    moto_node_update(cylinder);
+    assert(regenerate(cylinder, set_cylinder_x_form, 2));
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing primitive nodes ... ");
+
+    g_type_init();
+
+    MotoLibrary *lib = moto_library_new();
+    scene = moto_scene_node_new("scene", lib);
+
+    test_regeneration();
+    test_orientation();
+
+    g_object_unref(scene);
+    g_object_unref(lib);
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "libmoto/moto-profiler.h"
+
+static void node_scope(gconstpointer node, const gchar *name)
+{
+    MOTO_PROFILE_BEGIN(scope);
+    g_usleep(100);
+    MOTO_PROFILE_END(scope, MOTO_PROFILE_UPDATE, name, node);
+}
+
+void test_stats()
+{
+    gint a, b;
+
+    /* Nothing is recorded while profiler is disabled. */
+    node_scope(& a, "a");
+    GArray *samples = moto_profiler_get_samples(MOTO_PROFILE_ALL_FRAMES);
+    assert(0 == samples->len);
+    g_array_free(samples, TRUE);
+
+    moto_profiler_enable(TRUE);
+
+    guint frame = moto_profiler_get_frame();
+    node_scope(& a, "a");
+    node_scope(& a, "a");
+    node_scope(& b, "b");
+    moto_profiler_next_frame();
+    node_scope(& b, "b");
+
+    GArray *stats = moto_profiler_get_stats(frame);
+    assert(2 == stats->len);
+    MotoProfileStat *first = & g_array_index(stats, MotoProfileStat, 0);
+    assert(& a == first->node && 2 == first->calls && 0 == strcmp("a", first->name));
+    assert(first->total >= 200 && first->max <= first->total);
+    g_array_free(stats, TRUE);
+
+    stats = moto_profiler_get_stats(MOTO_PROFILE_ALL_FRAMES);
+    assert(2 == g_array_index(stats, MotoProfileStat, 1).calls);
+    g_array_free(stats, TRUE);
+
+    moto_profiler_clear();
+    samples = moto_profiler_get_samples(MOTO_PROFILE_ALL_FRAMES);
+    assert(0 == samples->len);
+    g_array_free(samples, TRUE);
+
+    moto_profiler_enable(FALSE);
+}
+
+void test_trace()
+{
+    moto_profiler_enable(TRUE);
+    {
+        MOTO_PROFILE_BEGIN(scope);
+        MOTO_PROFILE_END(scope, MOTO_PROFILE_IO, "\"quoted\"", NULL);
+    }
+    moto_profiler_enable(FALSE);
+
+    const gchar *filename = "profiler-test.json";
+    gboolean ok = moto_profiler_write_trace(filename, MOTO_PROFILE_ALL_FRAMES);
+    assert(ok);
+
+    gchar *contents;
+    ok = g_file_get_contents(filename, & contents, NULL, NULL);
+    assert(ok);
+    assert(g_str_has_prefix(contents, "{\"traceEvents\":["));
+    assert(strstr(contents, "\"name\":\"\\\"quoted\\\"\",\"cat\":\"io\",\"ph\":\"X\""));
+    g_free(contents);
+    remove(filename);
+}
+
+/* Only the latest samples are kept when ring is overflowed, without gaps. */
+void test_overflow()
+{
+    moto_profiler_enable(TRUE);
+    moto_profiler_clear();
+
+    guint i, num = 40000;
+    for(i = 1; i <= num; i++)
+        moto_profiler_add(i, MOTO_PROFILE_UPDATE, "loop", NULL);
+
+    GArray *samples = moto_profiler_get_samples(MOTO_PROFILE_ALL_FRAMES);
+    assert(samples->len > 0 && samples->len < num);
+    for(i = 0; i < samples->len; i++)
+        assert(num - samples->len + i + 1 == g_array_index(samples, MotoProfileSample, i).begin);
+    g_array_free(samples, TRUE);
+
+    moto_profiler_clear();
+    moto_profiler_enable(FALSE);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-profiler.h\" ... ");
+
+    g_thread_init(NULL);
+
+    test_stats();
+    test_trace();
+    test_overflow();
+
+    printf("OK\n");
+
+    return 0;
+}
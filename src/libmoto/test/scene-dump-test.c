@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+#include <glib/gstdio.h>
+
+#include "libmoto/moto-library.h"
+#include "libmoto/moto-scene-node.h"
+#include "libmoto/moto-scene-dump.h"
+#include "libmoto/moto-mesh.h"
+#include "libmoto/moto-cube-node.h"
+#include "libmoto/moto-extrude-node.h"
+#include "libmoto/moto-twist-node.h"
+#include "libmoto/moto-reference-node.h"
+
+#define FILENAME "scene-dump-test.mscn"
+#define ASSET_FILENAME "scene-dump-test-asset.mscn"
+
+static MotoMesh *get_out(MotoNode *node)
+{
+    MotoMesh *mesh = NULL;
+    moto_node_get_param_object(node, "out", (GObject **)& mesh);
+    return mesh;
+}
+
+static gboolean mesh_equal(MotoMesh *a, MotoMesh *b)
+{
+    if( ! a || ! b || a->v_num != b->v_num || a->f_num != b->f_num || a->f_v_num != b->f_v_num)
+        return FALSE;
+
+    guint i;
+    for(i = 0; i < a->v_num; i++)
+        if(fabs(a->v_coords[i].x - b->v_coords[i].x) > 1e-5 ||
+           fabs(a->v_coords[i].y - b->v_coords[i].y) > 1e-5 ||
+           fabs(a->v_coords[i].z - b->v_coords[i].z) > 1e-5)
+            return FALSE;
+    return TRUE;
+}
+
+void test_selection()
+{
+    MotoLibrary *lib = moto_library_new();
+    MotoSceneNode *scene = moto_scene_node_new("scene", lib);
+
+    MotoNode *cube    = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_CUBE_NODE, "cube");
+    MotoNode *extrude = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_EXTRUDE_NODE, "extrude");
+
+    moto_node_update(cube);
+    MotoShapeSelection *selection = moto_mesh_create_selection(get_out(cube));
+    moto_shape_selection_select_face(selection, 0);
+    moto_shape_selection_select_face(selection, 2);
+    moto_op_node_set_selection((MotoOpNode *)extrude, selection);
+    moto_shape_selection_free(selection);
+
+    moto_node_link(extrude, "in", cube, "out");
+    moto_node_set_param_3f(extrude, "lt", 0, 0, 1);
+    moto_scene_node_update(scene);
+    assert(get_out(extrude)->f_num > get_out(cube)->f_num);
+
+    gboolean r = moto_scene_dump_save(scene, FILENAME, NULL);
+    assert(r);
+
+    MotoSceneNode *loaded = moto_scene_node_new("loaded", lib);
+    r = moto_scene_dump_load(loaded, FILENAME);
+    assert(r);
+
+    MotoNode *loaded_extrude = moto_node_get_child((MotoNode *)loaded, "extrude");
+    assert(loaded_extrude);
+    selection = moto_op_node_get_selection((MotoOpNode *)loaded_extrude);
+    assert(selection);
+    assert(2 == moto_shape_selection_get_selected_f_num(selection));
+    assert(moto_shape_selection_check_face(selection, 0));
+    assert(moto_shape_selection_check_face(selection, 2));
+
+    /* Output is evaluated again and not taken from dump. */
+    moto_node_mark_for_update(loaded_extrude);
+    moto_scene_node_update(loaded);
+    assert(mesh_equal(get_out(loaded_extrude), get_out(extrude)));
+
+    g_unlink(FILENAME);
+    g_object_unref(loaded);
+    g_object_unref(scene);
+    g_object_unref(lib);
+}
+
+static MotoNode *get_source_node(MotoNode *node, const gchar *name)
+{
+    MotoParam *source = moto_param_get_source(moto_node_get_param(node, name));
+    return (source) ? moto_param_get_node(source) : NULL;
+}
+
+static MotoNode *create_reference(MotoSceneNode *scene, const gchar *name)
+{
+    MotoNode *ref = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_REFERENCE_NODE, name);
+    moto_param_set_string(moto_node_get_param(ref, "filename"), ASSET_FILENAME);
+    return ref;
+}
+
+/* Links of shot into and out of referenced asset. */
+static void check_reference_links(MotoSceneNode *scene)
+{
+    MotoNode *ref   = moto_node_get_child((MotoNode *)scene, "ref");
+    MotoNode *local = moto_node_get_child((MotoNode *)scene, "local");
+    assert(ref && local);
+    assert(moto_reference_node_is_loaded((MotoReferenceNode *)ref));
+
+    MotoNode *box  = moto_node_get_child(ref, "box");
+    MotoNode *bend = moto_node_get_child(ref, "bend");
+    assert(box && bend);
+
+    assert(get_source_node(bend, "in") == box);
+    assert(get_source_node(bend, "angle") == (MotoNode *)moto_scene_node_get_time_node(scene));
+    assert(get_source_node(local, "in") == bend);
+}
+
+void test_reference()
+{
+    MotoLibrary *lib = moto_library_new();
+
+    MotoSceneNode *asset = moto_scene_node_new("asset", lib);
+    MotoNode *box  = moto_node_create_child((MotoNode *)asset, MOTO_TYPE_CUBE_NODE, "box");
+    MotoNode *bend = moto_node_create_child((MotoNode *)asset, MOTO_TYPE_TWIST_NODE, "bend");
+    moto_node_link(bend, "in", box, "out");
+    moto_scene_node_update(asset);
+    gboolean r = moto_scene_dump_save(asset, ASSET_FILENAME, NULL);
+    assert(r);
+
+    MotoSceneNode *shot = moto_scene_node_new("shot", lib);
+    MotoNode *time  = (MotoNode *)moto_scene_node_get_time_node(shot);
+    MotoNode *ref   = create_reference(shot, "ref");
+    MotoNode *local = moto_node_create_child((MotoNode *)shot, MOTO_TYPE_TWIST_NODE, "local");
+    moto_scene_node_update(shot);
+    assert(moto_reference_node_is_loaded((MotoReferenceNode *)ref));
+
+    moto_node_link(moto_node_get_child(ref, "bend"), "angle", time, "time");
+    moto_node_link(local, "in", moto_node_get_child(ref, "bend"), "out");
+    check_reference_links(shot);
+
+    /* Both references share the same mesh of asset. */
+    MotoNode *other = create_reference(shot, "other");
+    moto_scene_node_update(shot);
+    assert(get_out(moto_node_get_child(ref, "box")) == get_out(moto_node_get_child(other, "box")));
+
+    r = moto_scene_dump_save(shot, FILENAME, NULL);
+    assert(r);
+
+    /* Links are restored when reference is loaded. */
+    MotoSceneNode *loaded = moto_scene_node_new("loaded", lib);
+    r = moto_scene_dump_load(loaded, FILENAME);
+    assert(r);
+    assert( ! get_source_node(moto_node_get_child((MotoNode *)loaded, "local"), "in"));
+    moto_scene_node_update(loaded);
+    check_reference_links(loaded);
+
+    /* Links of reference which isn't loaded are saved again. */
+    MotoSceneNode *unloaded = moto_scene_node_new("unloaded", lib);
+    r = moto_scene_dump_load(unloaded, FILENAME);
+    assert(r);
+    ref = moto_node_get_child((MotoNode *)unloaded, "ref");
+    moto_node_set_param_boolean(ref, "load", FALSE);
+    moto_scene_node_update(unloaded);
+    assert( ! moto_reference_node_is_loaded((MotoReferenceNode *)ref));
+    r = moto_scene_dump_save(unloaded, FILENAME, NULL);
+    assert(r);
+
+    MotoSceneNode *reloaded = moto_scene_node_new("reloaded", lib);
+    r = moto_scene_dump_load(reloaded, FILENAME);
+    assert(r);
+    moto_node_set_param_boolean(moto_node_get_child((MotoNode *)reloaded, "ref"), "load", TRUE);
+    moto_scene_node_update(reloaded);
+    check_reference_links(reloaded);
+
+    g_unlink(FILENAME);
+    g_unlink(ASSET_FILENAME);
+    g_object_unref(reloaded);
+    g_object_unref(unloaded);
+    g_object_unref(loaded);
+    g_object_unref(shot);
+    g_object_unref(asset);
+    g_object_unref(lib);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-scene-dump.h\" ... ");
+
+    g_type_init();
+
+    test_selection();
+    test_reference();
+
+    printf("OK\n");
+
+    return 0;
+}
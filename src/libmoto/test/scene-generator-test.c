@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "libmoto/moto-scene-generator.h"
+#include "libmoto/moto-library.h"
+
+void test_spec()
+{
+    MotoSceneSpec spec;
+    moto_scene_spec_init(& spec);
+    assert(1 == spec.depth && 0 == spec.ops);
+
+    gboolean r = moto_scene_spec_parse(& spec, "objects=1000 depth=4,ops=3 animated=500 shape=mixed");
+    assert(r);
+    assert(1000 == spec.objects && 4 == spec.depth && 3 == spec.ops && 500 == spec.animated);
+    assert(MOTO_SCENE_SPEC_SHAPE_MIXED == spec.shape && 10 == spec.divs);
+    assert(6000 == moto_scene_spec_get_nodes_num(& spec));
+
+    /* Zero depth means flat scene. */
+    r = moto_scene_spec_parse(& spec, "depth=0");
+    assert(r);
+    assert(1 == spec.depth);
+
+    r = moto_scene_spec_parse(& spec, "objects=ten");
+    assert( ! r);
+    r = moto_scene_spec_parse(& spec, "nodes=10");
+    assert( ! r);
+    r = moto_scene_spec_parse(& spec, "shape=torus");
+    assert( ! r);
+    r = moto_scene_spec_parse(& spec, "objects");
+    assert( ! r);
+    assert(1000 == spec.objects);
+}
+
+void test_animated()
+{
+    MotoLibrary *lib = moto_library_new();
+    MotoSceneNode *scene = moto_scene_node_new("scene", lib);
+
+    /* Angles and rotates alternate, so every angle gets expression. */
+    MotoSceneSpec spec;
+    moto_scene_spec_init(& spec);
+    spec.objects  = 4;
+    spec.ops      = 1;
+    spec.animated = 4;
+    guint num = moto_scene_generate(scene, & spec);
+    assert(12 == num);
+
+    guint i;
+    for(i = 0; i < spec.objects; i++)
+    {
+        gchar *name = g_strdup_printf("obj%u", i);
+        MotoNode *obj = moto_node_get_child((MotoNode *)scene, name);
+        g_free(name);
+        assert(obj);
+
+        MotoParam *angle = moto_node_get_param(moto_node_get_child(obj, "op0"), "angle");
+        assert(moto_param_get_use_expression(angle));
+        assert(moto_param_is_animated(angle));
+    }
+
+    g_object_unref(scene);
+    g_object_unref(lib);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-scene-generator.h\" ... ");
+
+    g_type_init();
+
+    test_spec();
+    test_animated();
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "libmoto/moto-library.h"
+#include "libmoto/moto-scene-node.h"
+#include "libmoto/moto-profiler.h"
+#include "libmoto/moto-mesh.h"
+#include "libmoto/moto-cube-node.h"
+#include "libmoto/moto-twist-node.h"
+
+static MotoMesh *get_out(MotoNode *node)
+{
+    MotoMesh *mesh = NULL;
+    moto_node_get_param_object(node, "out", (GObject **)& mesh);
+    return mesh;
+}
+
+static void select_all(MotoNode *op, MotoNode *source)
+{
+    MotoMesh *mesh = get_out(source);
+    MotoShapeSelection *selection = moto_mesh_create_selection(mesh);
+    guint i;
+    for(i = 0; i < mesh->f_num; i++)
+        moto_shape_selection_select_face(selection, i);
+    moto_op_node_set_selection((MotoOpNode *)op, selection);
+    moto_shape_selection_free(selection);
+}
+
+/* Updates of node since last clear of profiler. */
+static guint get_updates_num(MotoNode *node)
+{
+    GArray *samples = moto_profiler_get_samples(MOTO_PROFILE_ALL_FRAMES);
+    guint i, num = 0;
+    for(i = 0; i < samples->len; i++)
+    {
+        MotoProfileSample *s = & g_array_index(samples, MotoProfileSample, i);
+        if(MOTO_PROFILE_UPDATE == s->category && s->node == node)
+            num++;
+    }
+    g_array_free(samples, TRUE);
+    return num;
+}
+
+static void set_time(MotoSceneNode *scene, gfloat time)
+{
+    moto_profiler_clear();
+    moto_scene_node_set_current_time(scene, time);
+}
+
+/* Only nodes depending on time are updated when time is changed. */
+void test_animated_subset()
+{
+    MotoLibrary *lib = moto_library_new();
+    MotoSceneNode *scene = moto_scene_node_new("scene", lib);
+    MotoNode *time = (MotoNode *)moto_scene_node_get_time_node(scene);
+
+    MotoNode *cube    = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_CUBE_NODE, "cube");
+    MotoNode *twist   = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_TWIST_NODE, "twist");
+    MotoNode *other   = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_CUBE_NODE, "other");
+    MotoNode *still   = moto_node_create_child((MotoNode *)scene, MOTO_TYPE_TWIST_NODE, "still");
+
+    moto_node_update(cube);
+    moto_node_update(other);
+    select_all(twist, cube);
+    select_all(still, other);
+
+    moto_node_link(twist, "in", cube, "out");
+    moto_node_link(twist, "angle", time, "time");
+    moto_node_link(still, "in", other, "out");
+    moto_node_set_param_float(still, "angle", 30);
+    moto_scene_node_update(scene);
+
+    moto_profiler_enable(TRUE);
+
+    set_time(scene, 10);
+    assert(1 == get_updates_num(time));
+    assert(1 == get_updates_num(twist));
+    assert(0 == get_updates_num(cube));
+    assert(0 == get_updates_num(other));
+    assert(0 == get_updates_num(still));
+    MotoMesh *first = moto_mesh_new_copy(get_out(twist));
+    MotoMesh *still_out = get_out(still);
+
+    set_time(scene, 20);
+    assert(1 == get_updates_num(time));
+    assert(1 == get_updates_num(twist));
+    assert(0 == get_updates_num(still));
+    assert(fabs(first->v_coords[0].x - get_out(twist)->v_coords[0].x) > 1e-5 ||
+           fabs(first->v_coords[0].z - get_out(twist)->v_coords[0].z) > 1e-5);
+    assert(get_out(still) == still_out);
+
+    /* Linking to time changes the subset. */
+    guint stamp = moto_node_get_time_dependency_stamp();
+    moto_node_link(still, "angle", time, "time");
+    assert(moto_node_get_time_dependency_stamp() != stamp);
+
+    set_time(scene, 30);
+    assert(1 == get_updates_num(time));
+    assert(1 == get_updates_num(twist));
+    assert(1 == get_updates_num(still));
+    assert(0 == get_updates_num(other));
+
+    /* And unlinking changes it back. */
+    stamp = moto_node_get_time_dependency_stamp();
+    moto_param_unlink_source(moto_node_get_param(twist, "angle"));
+    assert(moto_node_get_time_dependency_stamp() != stamp);
+
+    set_time(scene, 40);
+    assert(1 == get_updates_num(time));
+    assert(0 == get_updates_num(twist));
+    assert(1 == get_updates_num(still));
+
+    moto_profiler_enable(FALSE);
+
+    g_object_unref(first);
+    g_object_unref(scene);
+    g_object_unref(lib);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("Testing \"moto-scene-node.h\" ... ");
+
+    g_type_init();
+    g_thread_init(NULL);
+
+    test_animated_subset();
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -117,6 +117,16 @@ static void perform_remove(MotoShelf *shelf, MotoSystem *system)
     perform_op(shelf, system, "MotoRemoveNode", "remove");
 }
 
+static void perform_subdiv(MotoShelf *shelf, MotoSystem *system)
+{
+    perform_op(shelf, system, "MotoSubdivNode", "subdiv");
+}
+
+static void perform_weld(MotoShelf *shelf, MotoSystem *system)
+{
+    perform_op(shelf, system, "MotoWeldNode", "weld");
+}
+
 static void perform_twist(MotoShelf *shelf, MotoSystem *system)
 {
     perform_op(shelf, system, "MotoTwistNode", "twist");
@@ -249,6 +259,8 @@ GtkWidget *moto_shelf_new(MotoSystem *system, GtkWindow *window)
     moto_shelf_add_tab(self,  "Model");
     moto_shelf_add_item(self, "Model", "Remove",  perform_remove);
     moto_shelf_add_item(self, "Model", "Extrude",  perform_extrude);
+    moto_shelf_add_item(self, "Model", "Subdiv",  perform_subdiv);
+    moto_shelf_add_item(self, "Model", "Weld",     perform_weld);
     moto_shelf_add_item(self, "Model", "Bevel",    NULL);
     moto_shelf_add_item(self, "Model", "Collapse", NULL);
 
@@ -21,6 +21,7 @@
 #include "libmoto/moto-object-node.h"
 #include "libmoto/moto-shape-node.h"
 #include "libmoto/moto-mesh.h"
+#include "libmoto/moto-autosave.h"
 #include "libmotoutil/numdef.h"
 
 #include "moto-shelf.h"
@@ -66,6 +67,9 @@ struct _MotoTestWindowPriv
     MotoNode *vtest;
     MotoVariation *v1, *v2;
 
+    MotoAutosave *autosave;
+    guint autosave_source;
+
     gboolean disposed;
 };
 
@@ -78,6 +82,12 @@ moto_test_window_dispose(GObject *obj)
         return;
     self->priv->disposed = TRUE;
 
+    if(self->priv->autosave)
+    {
+        g_source_remove(self->priv->autosave_source);
+        moto_autosave_free(self->priv->autosave);
+    }
+
     g_object_unref(self->priv->system);
 
     test_window_parent_class->dispose(obj);
@@ -92,6 +102,12 @@ moto_test_window_finalize(GObject *obj)
     test_window_parent_class->finalize(obj);
 }
 
+static gboolean autosave(MotoTestWindow *self)
+{
+    moto_autosave_snapshot(self->priv->autosave);
+    return TRUE;
+}
+
 static void quit(MotoTestWindow *self)
 {
     gtk_main_quit();
@@ -379,6 +395,13 @@ moto_test_window_init(MotoTestWindow *self)
 
     moto_scene_node_update(self->priv->scene_node);
 
+    // Autosave. Snapshot takes only changed nodes so it may be frequent.
+    gchar *journal = g_build_filename(g_get_tmp_dir(), "moto-autosave.journal", NULL);
+    self->priv->autosave = moto_autosave_new(self->priv->scene_node, journal);
+    if(self->priv->autosave)
+        self->priv->autosave_source = g_timeout_add(30000, (GSourceFunc)autosave, self);
+    g_free(journal);
+
     GtkBox *hbox = (GtkBox *)gtk_hbox_new(FALSE, 1);
 
     gtk_box_pack_start(hbox, moto_tool_box_new(self->priv->system), FALSE, FALSE, 0);
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <math.h>
+
+#include <glib/gstdio.h>
+
+#include "moto-bench.h"
+#include "libmoto/moto-mesh.h"
+#include "libmoto/moto-ray.h"
+#include "libmoto/moto-twist-node.h"
+#include "libmoto/moto-wobj-mesh-loader.h"
+
+/* Wavy grid of quads in XZ plane with about faces_num faces. */
+static MotoMesh *create_grid(guint faces_num, gboolean prepare)
+{
+    guint n = (guint)(sqrt(faces_num) + 0.5);
+    guint f_num = n*n;
+    MotoMesh *mesh = moto_mesh_new((n+1)*(n+1), 0, f_num, f_num*4);
+
+    guint i, j;
+    for(i = 0; i <= n; i++)
+        for(j = 0; j <= n; j++)
+        {
+            MotoVector *v = mesh->v_coords + i*(n+1) + j;
+            v->x = (gfloat)i/n - 0.5f;
+            v->y = 0.05f*sin(i*0.3f)*cos(j*0.2f);
+            v->z = (gfloat)j/n - 0.5f;
+            v->w = 1;
+        }
+
+    for(i = 0; i < n; i++)
+        for(j = 0; j < n; j++)
+        {
+            guint32 vi = i*(n+1) + j;
+            guint32 verts[4] = {vi, vi + 1, vi + n + 2, vi + n + 1};
+            guint fi = i*n + j;
+            moto_mesh_set_face(mesh, fi, (fi + 1)*4, verts);
+        }
+
+    if(prepare)
+        moto_mesh_prepare(mesh);
+    return mesh;
+}
+
+typedef struct _MeshBench
+{
+    guint size;
+    MotoMesh *mesh;
+    gpointer data;
+    gpointer base;
+    gchar *filename;
+} MeshBench;
+
+static gpointer mesh_bench_new(guint size)
+{
+    MeshBench *b = g_slice_new0(MeshBench);
+    b->size = size;
+    return b;
+}
+
+static gpointer mesh_bench_new_with_grid(guint size)
+{
+    MeshBench *b = (MeshBench *)mesh_bench_new(size);
+    b->mesh = create_grid(size, TRUE);
+    return b;
+}
+
+static void unref_mesh(gpointer data)
+{
+    MeshBench *b = (MeshBench *)data;
+    if(b->mesh)
+        g_object_unref(b->mesh);
+    b->mesh = NULL;
+}
+
+static void mesh_bench_free(gpointer data)
+{
+    unref_mesh(data);
+    g_slice_free(MeshBench, data);
+}
+
+/* Construction */
+
+static void construct(gpointer data)
+{
+    MeshBench *b = (MeshBench *)data;
+    b->mesh = create_grid(b->size, TRUE);
+}
+
+/* Normals and tesselation */
+
+static void calc_normals(gpointer data)
+{
+    moto_mesh_calc_normals(((MeshBench *)data)->mesh);
+}
+
+static void tesselate(gpointer data)
+{
+    moto_mesh_tesselate_faces(((MeshBench *)data)->mesh);
+}
+
+/* Selection */
+
+static gpointer select_setup(guint size)
+{
+    MeshBench *b = (MeshBench *)mesh_bench_new_with_grid(size);
+    MotoShapeSelection *base = moto_mesh_create_selection(b->mesh);
+
+    guint i;
+    for(i = 0; i < b->mesh->f_num; i += 97)
+        moto_shape_selection_select_face(base, i);
+
+    b->base = base;
+    b->data = moto_shape_selection_copy(base);
+    return b;
+}
+
+static void select_more(gpointer data)
+{
+    MeshBench *b = (MeshBench *)data;
+    moto_mesh_select_more_faces(b->mesh, (MotoShapeSelection *)b->data);
+}
+
+static void select_reset(gpointer data)
+{
+    MeshBench *b = (MeshBench *)data;
+    moto_shape_selection_free((MotoShapeSelection *)b->data);
+    b->data = moto_shape_selection_copy((MotoShapeSelection *)b->base);
+}
+
+static void select_teardown(gpointer data)
+{
+    MeshBench *b = (MeshBench *)data;
+    moto_shape_selection_free((MotoShapeSelection *)b->data);
+    moto_shape_selection_free((MotoShapeSelection *)b->base);
+    mesh_bench_free(b);
+}
+
+/* Picking as in selection of faces: nearest face hit by ray. */
+
+static void pick(gpointer data)
+{
+    MeshBench *b = (MeshBench *)data;
+    MotoRay ray = {{0.1f, 1, 0.1f}, {0.05f, -1, 0.02f}};
+    moto_ray_normalize(& ray);
+
+    gfloat dist, nearest = G_MAXFLOAT;
+    guint i;
+    for(i = 0; i < b->mesh->f_num; i++)
+        if(moto_mesh_intersect_face(b->mesh, i, & ray, & dist) && dist < nearest)
+            nearest = dist;
+}
+
+/* OBJ loading */
+
+#ifdef MOTO_WITH_WOBJ_MESH_LOADER
+
+static gpointer obj_setup(guint size)
+{
+    MeshBench *b = (MeshBench *)mesh_bench_new(size);
+    MotoMesh *grid = create_grid(size, FALSE);
+
+    gint fd = g_file_open_tmp("moto-bench-XXXXXX.obj", & b->filename, NULL);
+    FILE *file = (fd < 0) ? NULL : fdopen(fd, "w");
+    if(file)
+    {
+        guint i, j;
+        for(i = 0; i < grid->v_num; i++)
+            fprintf(file, "v %f %f %f\n", grid->v_coords[i].x, grid->v_coords[i].y, grid->v_coords[i].z);
+
+        guint n = (guint)(sqrt(grid->v_num) + 0.5) - 1;
+        for(i = 0; i < n; i++)
+            for(j = 0; j < n; j++)
+            {
+                guint vi = i*(n+1) + j + 1;
+                fprintf(file, "f %u %u %u %u\n", vi, vi + 1, vi + n + 2, vi + n + 1);
+            }
+        fclose(file);
+    }
+
+    g_object_unref(grid);
+    b->data = moto_wobj_mesh_loader_new();
+    return b;
+}
+
+static void obj_load(gpointer data)
+{
+    MeshBench *b = (MeshBench *)data;
+    b->mesh = moto_mesh_loader_load((MotoMeshLoader *)b->data, b->filename);
+}
+
+static void obj_teardown(gpointer data)
+{
+    MeshBench *b = (MeshBench *)data;
+    g_unlink(b->filename);
+    g_free(b->filename);
+    g_object_unref(b->data);
+    mesh_bench_free(b);
+}
+
+#endif
+
+/* Deformers */
+
+static gpointer twist_setup(guint size)
+{
+    MeshBench *b = (MeshBench *)mesh_bench_new_with_grid(size);
+    MotoNode *twist = (MotoNode *)moto_twist_node_new("twist");
+    moto_node_set_param_float(twist, "angle", 45);
+    b->data = twist;
+    return b;
+}
+
+static void twist(gpointer data)
+{
+    MeshBench *b = (MeshBench *)data;
+    gboolean the_same;
+    moto_op_node_perform((MotoOpNode *)b->data, (MotoShape *)b->mesh, & the_same);
+}
+
+static void twist_teardown(gpointer data)
+{
+    MeshBench *b = (MeshBench *)data;
+    g_object_unref(b->data);
+    mesh_bench_free(b);
+}
+
+void moto_collect_mesh_benchmarks(void)
+{
+    /* Faces are triangulated and picked only in 16-bit meshes. */
+    moto_bench_add("mesh/construct", 10000, mesh_bench_new, construct, unref_mesh, mesh_bench_free);
+    moto_bench_add("mesh/construct", 1000000, mesh_bench_new, construct, unref_mesh, mesh_bench_free);
+    moto_bench_add("mesh/construct", 10000000, mesh_bench_new, construct, unref_mesh, mesh_bench_free);
+    moto_bench_add("mesh/normals", 10000, mesh_bench_new_with_grid, calc_normals, NULL, mesh_bench_free);
+    moto_bench_add("mesh/normals", 1000000, mesh_bench_new_with_grid, calc_normals, NULL, mesh_bench_free);
+    moto_bench_add("mesh/tesselate", 10000, mesh_bench_new_with_grid, tesselate, NULL, mesh_bench_free);
+    moto_bench_add("mesh/select_more", 10000, select_setup, select_more, select_reset, select_teardown);
+    moto_bench_add("mesh/select_more", 1000000, select_setup, select_more, select_reset, select_teardown);
+    moto_bench_add("mesh/pick", 10000, mesh_bench_new_with_grid, pick, NULL, mesh_bench_free);
+#ifdef MOTO_WITH_WOBJ_MESH_LOADER
+    moto_bench_add("mesh/load_obj", 10000, obj_setup, obj_load, unref_mesh, obj_teardown);
+    moto_bench_add("mesh/load_obj", 1000000, obj_setup, obj_load, unref_mesh, obj_teardown);
+#endif
+    moto_bench_add("deform/twist", 10000, twist_setup, twist, NULL, twist_teardown);
+    moto_bench_add("deform/twist", 1000000, twist_setup, twist, NULL, twist_teardown);
+}
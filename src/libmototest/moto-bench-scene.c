@@ -0,0 +1,103 @@
+#include <math.h>
+
+#include "moto-bench.h"
+#include "libmoto/moto-messager.h"
+#include "libmoto/moto-system.h"
+#include "libmoto/moto-scene-generator.h"
+#include "libmotoutil/xform.h"
+
+#define OPS_NUM 5
+
+static MotoSystem *bench_system = NULL;
+
+typedef struct _SceneBench
+{
+    MotoSceneNode *scene;
+    gfloat time;
+} SceneBench;
+
+static guint count_animated(MotoNode *node)
+{
+    guint num = moto_node_is_animated(node) ? 1 : 0;
+
+    GList *child = moto_node_get_children(node);
+    for(; child; child = g_list_next(child))
+        num += count_animated((MotoNode *)child->data);
+    return num;
+}
+
+/* Generated scene with size nodes, most of deformers are animated. */
+static gpointer scene_setup(guint size)
+{
+    if( ! bench_system)
+        bench_system = moto_system_new();
+
+    SceneBench *b = g_slice_new(SceneBench);
+    b->scene = moto_scene_node_new("bench", moto_system_get_library(bench_system));
+    b->time = 0;
+
+    MotoSceneSpec spec;
+    moto_scene_spec_init(& spec);
+    spec.ops      = OPS_NUM;
+    spec.objects  = size/(3 + OPS_NUM);
+    spec.animated = spec.objects*OPS_NUM;
+    moto_scene_generate(b->scene, & spec);
+
+    moto_scene_node_update(b->scene);
+
+    /* Otherwise changing time updates nothing and timings are meaningless. */
+    if( ! count_animated((MotoNode *)b->scene))
+        moto_error("Benchmark scene of %u nodes has no animated nodes", size);
+    return b;
+}
+
+static void scene_update(gpointer data)
+{
+    SceneBench *b = (SceneBench *)data;
+    b->time += 1;
+    moto_scene_node_set_current_time(b->scene, b->time);
+}
+
+static void scene_teardown(gpointer data)
+{
+    SceneBench *b = (SceneBench *)data;
+    g_object_unref(b->scene);
+    g_slice_free(SceneBench, b);
+}
+
+/* Matrix math as in transforms of object nodes. */
+
+static gpointer matrix_setup(guint size)
+{
+    return GUINT_TO_POINTER(size);
+}
+
+static void matrix_math(gpointer data)
+{
+    guint i, num = GPOINTER_TO_UINT(data);
+    gfloat m[16], m2[16], r[16], inv[16], ambuf[16], det;
+    gfloat v[3] = {1, 2, 3}, tv[3], sum = 0;
+
+    matrix44_identity(r);
+    for(i = 0; i < num; i++)
+    {
+        matrix44_rotate_from_axis(m, i*0.001f, 0, 1, 0);
+        matrix44_copy(m2, r);
+        matrix44_mult(r, m2, m);
+        matrix44_inverse(inv, r, ambuf, det);
+        vector3_transform(tv, inv, v);
+        sum += tv[0];
+    }
+
+    /* Keeps loop from being optimized out. */
+    if(isnan(sum))
+        g_printerr("%f\n", sum);
+}
+
+void moto_collect_scene_benchmarks(void)
+{
+    moto_bench_add("scene/update", 100, scene_setup, scene_update, NULL, scene_teardown);
+    moto_bench_add("scene/update", 1000, scene_setup, scene_update, NULL, scene_teardown);
+    moto_bench_add("scene/update", 10000, scene_setup, scene_update, NULL, scene_teardown);
+    moto_bench_add("math/matrix", 1000000, matrix_setup, matrix_math, NULL, NULL);
+}
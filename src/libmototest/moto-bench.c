@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "moto-bench.h"
+
+typedef struct _MotoBenchCase
+{
+    gchar *name;
+    guint size;
+    MotoBenchSetupFunc setup;
+    MotoBenchFunc func;
+    MotoBenchFunc cleanup;
+    MotoBenchFunc teardown;
+} MotoBenchCase;
+
+typedef struct _MotoBenchResult
+{
+    MotoBenchCase *bench;
+    GArray *samples; /* milliseconds */
+    gdouble mean, median, stddev, min, max;
+} MotoBenchResult;
+
+static GArray *benchmarks = NULL;
+
+static gint warmup = 2;
+static gint repetitions = 10;
+static gint max_size = 0;
+static gchar *output = NULL;
+static gchar *filter = NULL;
+static gchar *commit = NULL;
+
+static GOptionEntry entries[] =
+{
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, & output, "Write JSON results to FILE", "FILE"},
+    {"warmup", 'w', 0, G_OPTION_ARG_INT, & warmup, "Untimed runs before measuring", "N"},
+    {"repetitions", 'r', 0, G_OPTION_ARG_INT, & repetitions, "Timed runs of each benchmark", "N"},
+    {"filter", 'f', 0, G_OPTION_ARG_STRING, & filter, "Run only benchmarks which names contain STR", "STR"},
+    {"max-size", 's', 0, G_OPTION_ARG_INT, & max_size, "Skip benchmarks larger than N", "N"},
+    {"commit", 'c', 0, G_OPTION_ARG_STRING, & commit, "Commit recorded in results", "ID"},
+    {NULL}
+};
+
+void moto_bench_add(const gchar *name, guint size,
+        MotoBenchSetupFunc setup, MotoBenchFunc func,
+        MotoBenchFunc cleanup, MotoBenchFunc teardown)
+{
+    if( ! benchmarks)
+        benchmarks = g_array_new(FALSE, FALSE, sizeof(MotoBenchCase));
+
+    MotoBenchCase bench = {g_strdup(name), size, setup, func, cleanup, teardown};
+    g_array_append_val(benchmarks, bench);
+}
+
+static gint compare_double(gconstpointer a, gconstpointer b)
+{
+    gdouble da = *(const gdouble *)a;
+    gdouble db = *(const gdouble *)b;
+    return (da < db) ? -1 : (da > db);
+}
+
+static void calc_stats(MotoBenchResult *r)
+{
+    GArray *sorted = g_array_sized_new(FALSE, FALSE, sizeof(gdouble), r->samples->len);
+    g_array_append_vals(sorted, r->samples->data, r->samples->len);
+    g_array_sort(sorted, compare_double);
+
+    guint i, num = sorted->len;
+    gdouble sum = 0;
+    for(i = 0; i < num; i++)
+        sum += g_array_index(sorted, gdouble, i);
+    r->mean = sum/num;
+
+    gdouble var = 0;
+    for(i = 0; i < num; i++)
+    {
+        gdouble d = g_array_index(sorted, gdouble, i) - r->mean;
+        var += d*d;
+    }
+    r->stddev = (num > 1) ? sqrt(var/(num - 1)) : 0;
+
+    r->min = g_array_index(sorted, gdouble, 0);
+    r->max = g_array_index(sorted, gdouble, num - 1);
+    r->median = (num % 2) ? g_array_index(sorted, gdouble, num/2) :
+        (g_array_index(sorted, gdouble, num/2 - 1) + g_array_index(sorted, gdouble, num/2))/2;
+
+    g_array_free(sorted, TRUE);
+}
+
+static void run_case(MotoBenchCase *bench, MotoBenchResult *r)
+{
+    r->bench = bench;
+    r->samples = g_array_new(FALSE, FALSE, sizeof(gdouble));
+
+    gpointer data = (bench->setup) ? bench->setup(bench->size) : NULL;
+    GTimer *timer = g_timer_new();
+
+    gint i;
+    for(i = 0; i < warmup + repetitions; i++)
+    {
+        g_timer_start(timer);
+        bench->func(data);
+        gdouble ms = g_timer_elapsed(timer, NULL)*1000;
+
+        if(i >= warmup)
+            g_array_append_val(r->samples, ms);
+        if(bench->cleanup)
+            bench->cleanup(data);
+    }
+
+    g_timer_destroy(timer);
+    if(bench->teardown)
+        bench->teardown(data);
+
+    calc_stats(r);
+}
+
+static void write_json(FILE *file, MotoBenchResult *results, guint num)
+{
+    gchar *date = NULL;
+    GTimeVal now;
+    g_get_current_time(& now);
+    date = g_time_val_to_iso8601(& now);
+
+    const gchar *id = (commit) ? commit : g_getenv("MOTO_BENCH_COMMIT");
+    fprintf(file, "{\n  \"commit\": \"%s\",\n  \"date\": \"%s\",\n  \"benchmarks\": [\n",
+            (id) ? id : "", date);
+    g_free(date);
+
+    guint i, j;
+    for(i = 0; i < num; i++)
+    {
+        MotoBenchResult *r = results + i;
+        fprintf(file, "    {\"name\": \"%s\", \"size\": %u, \"unit\": \"ms\", "
+                "\"warmup\": %d, \"repetitions\": %u,\n"
+                "     \"mean\": %.6f, \"median\": %.6f, \"stddev\": %.6f, \"min\": %.6f, \"max\": %.6f,\n"
+                "     \"samples\": [",
+                r->bench->name, r->bench->size, warmup, r->samples->len,
+                r->mean, r->median, r->stddev, r->min, r->max);
+        for(j = 0; j < r->samples->len; j++)
+            fprintf(file, "%s%.6f", (j) ? ", " : "", g_array_index(r->samples, gdouble, j));
+        fprintf(file, "]}%s\n", (i < num - 1) ? "," : "");
+    }
+
+    fprintf(file, "  ]\n}\n");
+}
+
+gint moto_bench_run(gint *argc, gchar **argv[])
+{
+    GError *error = NULL;
+    GOptionContext *context = g_option_context_new("- run benchmarks of Moto");
+    g_option_context_add_main_entries(context, entries, NULL);
+    if( ! g_option_context_parse(context, argc, argv, & error))
+    {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return 1;
+    }
+    g_option_context_free(context);
+
+    if(repetitions < 1 || warmup < 0)
+    {
+        g_printerr("Number of repetitions must be positive\n");
+        return 1;
+    }
+
+    moto_collect_mesh_benchmarks();
+    moto_collect_scene_benchmarks();
+
+    MotoBenchResult *results = g_new0(MotoBenchResult, benchmarks->len);
+    guint i, num = 0;
+    for(i = 0; i < benchmarks->len; i++)
+    {
+        MotoBenchCase *bench = & g_array_index(benchmarks, MotoBenchCase, i);
+        if((filter && ! strstr(bench->name, filter)) || (max_size > 0 && bench->size > (guint)max_size))
+            continue;
+
+        /* Progress goes to stderr, so JSON may be written to stdout. */
+        g_printerr("%-24s %10u ... ", bench->name, bench->size);
+        run_case(bench, results + num);
+        g_printerr("%10.3f ms +- %.3f\n", results[num].mean, results[num].stddev);
+        num++;
+    }
+
+    FILE *file = (output && strcmp(output, "-")) ? fopen(output, "w") : stdout;
+    if( ! file)
+    {
+        g_printerr("Can't open file \"%s\" for writing\n", output);
+        return 1;
+    }
+    write_json(file, results, num);
+    gint code = (ferror(file)) ? 1 : 0;
+    if(file != stdout)
+        fclose(file);
+
+    for(i = 0; i < num; i++)
+        g_array_free(results[i].samples, TRUE);
+    g_free(results);
+
+    return code;
+}
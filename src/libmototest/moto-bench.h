@@ -0,0 +1,50 @@
+/* ##################################################################################
+#
+#  Moto Animation System (http://motoanim.sf.net)
+#  Copyleft (C) 2008 Konstantin Evdokimenko a.k.a Qew[erty] (qewerty@gmail.com)
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+################################################################################## */
+
+#ifndef __MOTO_BENCH_H__
+#define __MOTO_BENCH_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Benchmarks are registered by moto_collect_*_benchmarks and run by
+ * moto_bench_run. Each one is set up once, then timed func is called
+ * warmup + repetitions times with untimed cleanup after each call. */
+
+typedef gpointer (*MotoBenchSetupFunc)(guint size);
+typedef void (*MotoBenchFunc)(gpointer data);
+
+void moto_bench_add(const gchar *name, guint size,
+        MotoBenchSetupFunc setup, MotoBenchFunc func,
+        MotoBenchFunc cleanup, MotoBenchFunc teardown);
+
+/* Options: --output FILE (JSON, stdout by default), --warmup N,
+ * --repetitions N, --filter SUBSTRING, --max-size N, --commit ID.
+ * Returns exit code. */
+gint moto_bench_run(gint *argc, gchar **argv[]);
+
+void moto_collect_mesh_benchmarks(void);
+void moto_collect_scene_benchmarks(void);
+
+G_END_DECLS
+
+#endif /* __MOTO_BENCH_H__ */
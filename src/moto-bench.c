@@ -0,0 +1,14 @@
+#include <glib-object.h>
+
+#include "libmoto/moto-types.h"
+#include "libmototest/moto-bench.h"
+
+int main(int argc, char *argv[])
+{
+    g_type_init();
+    g_thread_init(NULL);
+
+    moto_types_init();
+
+    return moto_bench_run(& argc, & argv);
+}
@@ -24,6 +24,8 @@ def create_options(filename, args):
     opts = Variables(filename, args)
     opts.AddVariables(
         ('MOTO_GUI',    'Name of the target file of moto gui application', 'moto-gui'),
+        ('MOTO_BENCH',  'Name of the target file of benchmarks', 'moto-bench'),
+        ('BENCH_ARGS',  'Arguments of benchmarks run by "bench" target', ''),
         ListVariable('PLUGINS', 'List of plugins to build (from %s%ssrc%splugins)' % (os.pardir, os.sep, os.sep), [],
             find_plugins()),
         ('CC',          'The C compiler', ''),